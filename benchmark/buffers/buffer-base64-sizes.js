@@ -0,0 +1,31 @@
+'use strict';
+const common = require('../common.js');
+
+// Encodes or decodes `total` bytes of binary data in pieces of `size` bytes,
+// to cover both the per-call overhead and the throughput of the kernels.
+const bench = common.createBenchmark(main, {
+  op: ['encode', 'decode'],
+  encoding: ['base64', 'base64url'],
+  size: [1024, 64 * 1024, 1024 * 1024, 64 * 1024 * 1024],
+  total: [256 * 1024 * 1024]
+}, {
+  test: { size: 1024, total: 4096 }
+});
+
+function main({ op, encoding, size, total }) {
+  const n = Math.max(1, total / size);
+  const buffer = Buffer.allocUnsafe(size);
+  for (let i = 0; i < size; i++) buffer[i] = (i * 7919) >> 3;
+  const encoded = buffer.toString(encoding);
+  const decoded = Buffer.allocUnsafe(size);
+
+  if (op === 'encode') {
+    bench.start();
+    for (let i = 0; i < n; i++) buffer.toString(encoding);
+    bench.end(n);
+  } else {
+    bench.start();
+    for (let i = 0; i < n; i++) decoded.write(encoded, encoding);
+    bench.end(n);
+  }
+}
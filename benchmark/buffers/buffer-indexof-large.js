@@ -0,0 +1,54 @@
+'use strict';
+const common = require('../common.js');
+const fs = require('fs');
+const path = require('path');
+
+// Searches `size` bytes of text for needles of `len` bytes that only occur
+// at the very end. The needles are taken from the text with a NUL byte in
+// the middle, so that their first and last bytes are as common as in the
+// text around them.
+const bench = common.createBenchmark(main, {
+  op: ['indexOf', 'lastIndexOf', 'indexOfAny'],
+  len: [1, 2, 4, 8, 16, 32, 64],
+  size: [100 * 1024 * 1024],
+  n: [10]
+}, {
+  test: { size: 1024, n: 1 }
+});
+
+function needleAt(text, offset, len) {
+  const needle = Buffer.from(text.subarray(offset, offset + len));
+  needle[len >> 1] = 0;
+  return needle;
+}
+
+function main({ op, len, size, n }) {
+  const text = fs.readFileSync(
+    path.resolve(__dirname, '../fixtures/alice.html')
+  );
+  const needles = [];
+  for (let i = 0; i < 4; i++)
+    needles.push(needleAt(text, 1000 + i * 5000, len));
+
+  const haystack = Buffer.allocUnsafe(size);
+  haystack.fill(text);
+  needles[0].copy(haystack, op === 'lastIndexOf' ? 0 : size - len);
+
+  switch (op) {
+    case 'indexOf':
+      bench.start();
+      for (let i = 0; i < n; i++) haystack.indexOf(needles[0]);
+      bench.end(n);
+      break;
+    case 'lastIndexOf':
+      bench.start();
+      for (let i = 0; i < n; i++) haystack.lastIndexOf(needles[0]);
+      bench.end(n);
+      break;
+    case 'indexOfAny':
+      bench.start();
+      for (let i = 0; i < n; i++) haystack.indexOfAny(needles);
+      bench.end(n);
+      break;
+  }
+}
@@ -0,0 +1,57 @@
+'use strict';
+const common = require('../common.js');
+
+// Converts `total` characters of text between strings and UTF-8 in pieces of
+// `size` characters, for text that is all ASCII, mostly ASCII with some
+// Latin-1 and CJK with some ASCII punctuation.
+const bench = common.createBenchmark(main, {
+  op: ['toString', 'write', 'byteLength', 'encode', 'encodeInto'],
+  corpus: ['ascii', 'latin', 'cjk'],
+  size: [64, 4 * 1024, 1024 * 1024],
+  total: [64 * 1024 * 1024]
+}, {
+  test: { size: 64, total: 256 }
+});
+
+const corpora = {
+  ascii: 'The quick brown fox jumps over the lazy dog. ',
+  latin: 'Größenwahn à la française, déjà vu en España. ',
+  cjk: '東京都の天気は晴れ、気温は摂氏二十度です。今日は良い日だ。 '
+};
+
+function main({ op, corpus, size, total }) {
+  const n = Math.max(1, total / size);
+  const text = corpora[corpus].repeat(Math.ceil(size / corpora[corpus].length))
+                              .slice(0, size);
+  const encoded = Buffer.from(text, 'utf8');
+  const dest = Buffer.allocUnsafe(encoded.length);
+  const encoder = new TextEncoder();
+
+  switch (op) {
+    case 'toString':
+      bench.start();
+      for (let i = 0; i < n; i++) encoded.toString('utf8');
+      bench.end(n);
+      break;
+    case 'write':
+      bench.start();
+      for (let i = 0; i < n; i++) dest.write(text, 'utf8');
+      bench.end(n);
+      break;
+    case 'byteLength':
+      bench.start();
+      for (let i = 0; i < n; i++) Buffer.byteLength(text, 'utf8');
+      bench.end(n);
+      break;
+    case 'encode':
+      bench.start();
+      for (let i = 0; i < n; i++) encoder.encode(text);
+      bench.end(n);
+      break;
+    case 'encodeInto':
+      bench.start();
+      for (let i = 0; i < n; i++) encoder.encodeInto(text, dest);
+      bench.end(n);
+      break;
+  }
+}
@@ -0,0 +1,57 @@
+'use strict';
+
+// Saves `size` bytes of state every `interval` frames through Krom's
+// asynchronous storage while measuring how long the frames take.
+// The interesting number is the slowest frame, which should stay close to the
+// others as long as saving does not block the main thread.
+
+const common = require('../common.js');
+const krom = require('krom');
+
+const bench = common.createBenchmark(main, {
+  size: [50 * 1024 * 1024],
+  interval: [10],
+  n: [300]
+}, {
+  test: { size: 1024, n: 20 }
+});
+
+const KROM_API = 6;
+
+function main({ size, interval, n }) {
+  krom.init('autosave', 640, 480, 1, false, 0, 0, KROM_API);
+
+  const state = new Uint8Array(size);
+  for (let i = 0; i < size; ++i) state[i] = i & 0xff;
+
+  let frames = 0;
+  let saving = false;
+  let saves = 0;
+  let slowest = 0;
+  let last;
+  krom.setCallback(() => {
+    const now = process.hrtime.bigint();
+    if (frames === 0) {
+      bench.start();
+    } else {
+      const ms = Number(now - last) / 1e6;
+      if (ms > slowest) slowest = ms;
+    }
+    last = now;
+
+    // The buffer is handed over without a copy, so only one save at a time
+    if (frames % interval === 0 && !saving) {
+      saving = true;
+      krom.writeStorageAsync('autosave', state.buffer, (success) => {
+        saving = false;
+        if (success) ++saves;
+      });
+    }
+
+    if (++frames === n) {
+      console.log(`${saves} saves, slowest frame ${slowest.toFixed(2)} ms`);
+      bench.end(n);
+      krom.requestShutdown();
+    }
+  });
+}
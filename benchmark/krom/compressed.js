@@ -0,0 +1,112 @@
+'use strict';
+
+// Builds a fixture set of block compressed textures with full mip chains
+// (BC1 and BC7 in DDS, ETC2 in KTX2) and decodes them with
+// krom.transcodeImage, the CPU fallback loadImage uses when the graphics
+// backend can not take a format. Reports the memory the containers take
+// against the decoded RGBA32 chains and the decode throughput. Nothing
+// here needs a window or a GPU.
+
+const common = require('../common.js');
+const krom = require('krom');
+
+const bench = common.createBenchmark(main, {
+  format: ['bc1', 'bc7', 'etc2'],
+  size: [1024, 4096],
+  n: [4]
+}, {
+  test: { size: 64, n: 1 }
+});
+
+const FORMATS = {
+  bc1: { blockSize: 8, dxgi: 71 },
+  bc7: { blockSize: 16, dxgi: 98 },
+  etc2: { blockSize: 8, vkFormat: 147 }
+};
+
+function levelSizes(size, blockSize) {
+  const sizes = [];
+  for (let s = size; s >= 1; s >>= 1) {
+    sizes.push(Math.ceil(s / 4) * Math.ceil(s / 4) * blockSize);
+  }
+  return sizes;
+}
+
+// Random blocks, with every BC7 mode showing up
+function fillBlocks(bytes, format, blockSize) {
+  let seed = 12345;
+  for (let i = 0; i < bytes.length; ++i) {
+    seed = (seed * 1103515245 + 12345) >>> 0;
+    bytes[i] = seed >>> 24;
+  }
+  if (format === 'bc7') {
+    for (let i = 0; i < bytes.length; i += blockSize) {
+      const mode = (i / blockSize) & 7;
+      bytes[i] = ((bytes[i] << (mode + 1)) | (1 << mode)) & 0xff;
+    }
+  }
+}
+
+function createDds(size, { blockSize, dxgi }, format) {
+  const sizes = levelSizes(size, blockSize);
+  const payload = sizes.reduce((a, b) => a + b, 0);
+  const buffer = new ArrayBuffer(148 + payload);
+  const view = new DataView(buffer);
+  new Uint8Array(buffer).set([0x44, 0x44, 0x53, 0x20], 0); // 'DDS '
+  view.setUint32(4, 124, true);
+  view.setUint32(8, 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000, true);
+  view.setUint32(12, size, true);
+  view.setUint32(16, size, true);
+  view.setUint32(28, sizes.length, true);
+  view.setUint32(76, 32, true);
+  view.setUint32(80, 0x4, true);
+  new Uint8Array(buffer).set([0x44, 0x58, 0x31, 0x30], 84); // 'DX10'
+  view.setUint32(128, dxgi, true);
+  view.setUint32(132, 3, true);
+  view.setUint32(140, 1, true);
+  fillBlocks(new Uint8Array(buffer, 148), format, blockSize);
+  return buffer;
+}
+
+function createKtx2(size, { blockSize, vkFormat }, format) {
+  const sizes = levelSizes(size, blockSize);
+  const header = 80 + sizes.length * 24;
+  const payload = sizes.reduce((a, b) => a + b, 0);
+  const buffer = new ArrayBuffer(header + payload);
+  const view = new DataView(buffer);
+  new Uint8Array(buffer).set([0xab, 0x4b, 0x54, 0x58, 0x20, 0x32, 0x30, 0xbb, 0x0d, 0x0a, 0x1a, 0x0a], 0);
+  view.setUint32(12, vkFormat, true);
+  view.setUint32(16, 1, true);
+  view.setUint32(20, size, true);
+  view.setUint32(24, size, true);
+  view.setUint32(36, 1, true);
+  view.setUint32(40, sizes.length, true);
+  let offset = header;
+  sizes.forEach((length, i) => {
+    view.setBigUint64(80 + i * 24, BigInt(offset), true);
+    view.setBigUint64(80 + i * 24 + 8, BigInt(length), true);
+    view.setBigUint64(80 + i * 24 + 16, BigInt(length), true);
+    offset += length;
+  });
+  fillBlocks(new Uint8Array(buffer, header), format, blockSize);
+  return buffer;
+}
+
+function main({ format, size, n }) {
+  const description = FORMATS[format];
+  const file = description.dxgi !== undefined ?
+    createDds(size, description, format) :
+    createKtx2(size, description, format);
+
+  let info;
+  bench.start();
+  for (let i = 0; i < n; ++i) {
+    info = krom.transcodeImage(file);
+  }
+  bench.end(n);
+
+  const megabytes = (bytes) => (bytes / (1024 * 1024)).toFixed(1);
+  console.log(`${format} ${info.width}x${info.height}, ${info.levels} levels: ` +
+              `${megabytes(info.compressedBytes)} MB compressed, ` +
+              `${megabytes(info.decodedBytes)} MB as RGBA32`);
+}
@@ -0,0 +1,44 @@
+'use strict';
+
+// Calls krom.log `n` times in bursts of `burst` messages per frame and
+// reports calls per second plus the main thread time spent per call.
+// Writing happens on Krom's logger thread, so the time per call should stay
+// flat whether the output goes to a terminal or to a --stdout file.
+
+const common = require('../common.js');
+const krom = require('krom');
+
+const bench = common.createBenchmark(main, {
+  burst: [100, 10000],
+  length: [40, 1000],
+  n: [100000]
+}, {
+  test: { burst: 10, n: 100 }
+});
+
+const KROM_API = 6;
+
+function main({ burst, length, n }) {
+  krom.init('log', 640, 480, 1, false, 0, 0, KROM_API);
+  krom.setLogRateLimit(0);
+
+  const message = 'x'.repeat(length);
+  let calls = 0;
+  let nanoseconds = 0;
+  bench.start();
+  krom.setCallback(() => {
+    const start = process.hrtime.bigint();
+    for (let i = 0; i < burst && calls < n; ++i, ++calls) {
+      krom.log(message);
+    }
+    nanoseconds += Number(process.hrtime.bigint() - start);
+
+    if (calls === n) {
+      bench.end(n);
+      const stats = krom.getLogStats();
+      console.log(`${(nanoseconds / n).toFixed(0)} ns per call on the main thread, ` +
+                  `${stats.written} written, ${stats.dropped} dropped`);
+      krom.requestShutdown();
+    }
+  });
+}
@@ -0,0 +1,91 @@
+'use strict';
+
+// Builds the mip chain of a `size` x `size` RGBA texture `n` times, either
+// in JavaScript the way Kha's Image.generateMipmaps does it (a box filter per
+// level, each level uploaded through createTextureFromBytes and setMipmaps)
+// or natively through the mipmapFilter argument of createTextureFromBytes,
+// and reports source megapixels filtered per second.
+
+const common = require('../common.js');
+const krom = require('krom');
+
+const bench = common.createBenchmark(main, {
+  size: [1024, 4096],
+  filter: ['js', 'box', 'kaiser'],
+  srgb: [0, 1],
+  n: [10]
+}, {
+  test: { size: 64, n: 1 }
+});
+
+const KROM_API = 6;
+const FORMAT_RGBA32 = 0;
+const FILTERS = { js: 0, box: 1, kaiser: 2 };
+
+function boxFilter(source, width, height) {
+  const w = Math.max(1, width >> 1);
+  const h = Math.max(1, height >> 1);
+  const destination = new Uint8Array(w * h * 4);
+  for (let y = 0; y < h; ++y) {
+    const y0 = Math.min(y * 2, height - 1);
+    const y1 = Math.min(y * 2 + 1, height - 1);
+    for (let x = 0; x < w; ++x) {
+      const x0 = Math.min(x * 2, width - 1);
+      const x1 = Math.min(x * 2 + 1, width - 1);
+      for (let c = 0; c < 4; ++c) {
+        destination[(y * w + x) * 4 + c] =
+          (source[(y0 * width + x0) * 4 + c] + source[(y0 * width + x1) * 4 + c] +
+           source[(y1 * width + x0) * 4 + c] + source[(y1 * width + x1) * 4 + c] + 2) >> 2;
+      }
+    }
+  }
+  return destination;
+}
+
+function generateInJs(texture, pixels, size) {
+  const levels = [];
+  let source = pixels;
+  let width = size;
+  let height = size;
+  while (width > 1 || height > 1) {
+    source = boxFilter(source, width, height);
+    width = Math.max(1, width >> 1);
+    height = Math.max(1, height >> 1);
+    const level = krom.createTextureFromBytes(source.buffer, width, height, FORMAT_RGBA32, true);
+    levels.push({ texture_: level });
+  }
+  krom.setMipmaps(texture, levels);
+  for (const level of levels) krom.unloadImage(level);
+}
+
+function main({ size, filter, srgb, n }) {
+  krom.init('mipmaps', 640, 480, 1, false, 0, 0, KROM_API);
+
+  const pixels = new Uint8Array(size * size * 4);
+  for (let i = 0; i < pixels.length; ++i) pixels[i] = (i * 31) & 0xff;
+
+  let iterations = 0;
+  let seconds = 0;
+  bench.start();
+  krom.setCallback(() => {
+    const start = process.hrtime.bigint();
+    let texture;
+    if (filter === 'js') {
+      texture = krom.createTextureFromBytes(pixels.buffer, size, size, FORMAT_RGBA32, false);
+      generateInJs(texture, pixels, size);
+    } else {
+      texture = krom.createTextureFromBytes(pixels.buffer, size, size, FORMAT_RGBA32, false,
+                                            FILTERS[filter], srgb === 1);
+    }
+    seconds += Number(process.hrtime.bigint() - start) / 1e9;
+    krom.unloadImage({ texture_: texture });
+
+    if (++iterations === n) {
+      bench.end(n);
+      // Every level reads the one before, so a chain filters 4/3 of the base level
+      const megapixels = n * size * size * 4 / 3 / 1e6;
+      console.log(`${filter}: ${(megapixels / seconds).toFixed(0)} megapixels per second`);
+      krom.requestShutdown();
+    }
+  });
+}
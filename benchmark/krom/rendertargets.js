@@ -0,0 +1,67 @@
+'use strict';
+
+// Runs a post-processing style chain of `passes` full screen passes per
+// frame for `n` frames, changing the resolution every `resize` frames.
+// Intermediate targets either come from createRenderTarget and unloadImage
+// every frame or from acquireRenderTarget, which pools them. Each pass only
+// reads the one before, so the pool gets by with two targets per size.
+// Reports render target allocations, the reuse rate and peak bytes, which
+// works the same with a null graphics backend.
+
+const common = require('../common.js');
+const krom = require('krom');
+
+const bench = common.createBenchmark(main, {
+  mode: ['create', 'pool'],
+  passes: [8],
+  resize: [100],
+  n: [600]
+}, {
+  test: { n: 10 }
+});
+
+const KROM_API = 6;
+const FORMAT_RGBA32 = 0;
+const SIZES = [[1280, 720], [1920, 1080], [960, 540]];
+
+function main({ mode, passes, resize, n }) {
+  krom.init('rendertargets', 640, 480, 1, false, 0, 0, KROM_API);
+
+  let frames = 0;
+  let allocations = 0;
+  bench.start();
+  krom.setCallback(() => {
+    const [width, height] = SIZES[Math.floor(frames / resize) % SIZES.length];
+    let previous = null;
+    for (let pass = 0; pass < passes; ++pass) {
+      let target;
+      if (mode === 'pool') {
+        target = krom.acquireRenderTarget(width, height, 0, FORMAT_RGBA32, 0);
+      } else {
+        target = krom.createRenderTarget(width, height, 0, FORMAT_RGBA32, 0);
+        ++allocations;
+      }
+      krom.begin({ renderTarget_: target }, null);
+      krom.end();
+      // The previous pass's output has been read now
+      if (previous !== null) krom.unloadImage({ renderTarget_: previous });
+      previous = target;
+    }
+    krom.unloadImage({ renderTarget_: previous });
+    krom.begin(null, null);
+    krom.end();
+
+    if (++frames === n) {
+      bench.end(n);
+      if (mode === 'pool') {
+        const stats = krom.getRenderTargetPoolStats();
+        console.log(`${stats.allocations} allocations for ${stats.acquires} passes, ` +
+                    `${(stats.reuseRate * 100).toFixed(1)}% reused, ` +
+                    `${(stats.peakBytes / (1024 * 1024)).toFixed(1)} MB peak`);
+      } else {
+        console.log(`${allocations} allocations for ${n * passes} passes`);
+      }
+      krom.requestShutdown();
+    }
+  });
+}
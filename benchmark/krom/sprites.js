@@ -0,0 +1,116 @@
+'use strict';
+
+// Draws `sprites` textured quads per frame through Krom's native sprite batcher.
+// Meant to be run by a Krom build using Kinc's null graphics backend, so that
+// the measured time is the CPU side of batching and not the GPU.
+
+const common = require('../common.js');
+const krom = require('krom');
+
+const bench = common.createBenchmark(main, {
+  sprites: [100000],
+  textures: [1, 16],
+  sort: ['true', 'false'],
+  n: [100]
+}, {
+  test: { sprites: 1000, n: 2 }
+});
+
+const SPRITE_FLOATS = 18;
+const KROM_API = 6;
+
+function createPipeline() {
+  const vs = krom.createVertexShader(new ArrayBuffer(0), 'painter-image.vert');
+  const fs = krom.createFragmentShader(new ArrayBuffer(0), 'painter-image.frag');
+  const pipeline = krom.createPipeline();
+  const structure = {
+    instanced: false,
+    elements: [
+      { name: 'vertexPosition', data: 3 },
+      { name: 'vertexUV', data: 2 },
+      { name: 'vertexColor', data: 4 }
+    ]
+  };
+  const mask = [true, true, true, true, true, true, true, true];
+  krom.compilePipeline(pipeline, structure, null, null, null, 1, vs, fs,
+                       null, null, null, {
+                         cullMode: 2,
+                         depthWrite: false,
+                         depthMode: 0,
+                         stencilMode: 0,
+                         stencilBothPass: 0,
+                         stencilDepthFail: 0,
+                         stencilFail: 0,
+                         stencilReferenceValue: 0,
+                         stencilReadMask: 0xff,
+                         stencilWriteMask: 0xff,
+                         blendSource: 1,
+                         blendDestination: 0,
+                         alphaBlendSource: 1,
+                         alphaBlendDestination: 0,
+                         colorWriteMaskRed: mask,
+                         colorWriteMaskGreen: mask,
+                         colorWriteMaskBlue: mask,
+                         colorWriteMaskAlpha: mask,
+                         conservativeRasterization: false
+                       });
+  return pipeline;
+}
+
+function fillSprites(records, sprites, textures) {
+  const colors = new Uint32Array(records.buffer);
+  for (let i = 0; i < sprites; ++i) {
+    const o = i * SPRITE_FLOATS;
+    records[o + 0] = i % textures;
+    records[o + 1] = 0;
+    colors[o + 2] = 0xffffffff;
+    records[o + 3] = 0.5;
+    records[o + 4] = (i * 7) % 1024;
+    records[o + 5] = (i * 13) % 768;
+    records[o + 6] = 32;
+    records[o + 7] = 32;
+    records[o + 8] = 0;
+    records[o + 9] = 0;
+    records[o + 10] = 1;
+    records[o + 11] = 1;
+    records[o + 12] = 1;
+    records[o + 13] = 0;
+    records[o + 14] = 0;
+    records[o + 15] = 0;
+    records[o + 16] = 1;
+    records[o + 17] = 0;
+  }
+}
+
+function main({ sprites, textures, sort, n }) {
+  krom.init('sprites', 1024, 768, 1, false, 0, 0, KROM_API);
+
+  const pipeline = createPipeline();
+  const unit = krom.getTextureUnit(pipeline, 'tex');
+  const images = [];
+  for (let i = 0; i < textures; ++i) {
+    images.push({ texture_: krom.createTexture(64, 64, 0), renderTarget_: null });
+  }
+  const batcher = krom.createSpriteBatcher(16384);
+  const records = new Float32Array(sprites * SPRITE_FLOATS);
+  fillSprites(records, sprites, textures);
+
+  let frames = 0;
+  let cpu;
+  krom.setCallback(() => {
+    if (frames === 0) {
+      cpu = process.cpuUsage();
+      bench.start();
+    }
+    krom.drawSprites(batcher, records.buffer, sprites, images, [pipeline],
+                     [unit], sort === 'true');
+    if (++frames === n) {
+      const usage = process.cpuUsage(cpu);
+      console.log(`${((usage.user + usage.system) / 1000 / n).toFixed(3)} ` +
+                  'ms CPU per frame');
+      bench.end(n);
+      krom.deleteSpriteBatcher(batcher);
+      krom.requestShutdown();
+    }
+  });
+}
@@ -0,0 +1,88 @@
+'use strict';
+
+// Runs `n` asset converter invocations, compressing a generated file with
+// gzip, either one after the other through sysCommand, which blocks the frame
+// loop for every process, or through sysCommandAsync with up to `parallel`
+// processes at a time (`parallel` does not change the system mode). Reports
+// the wall time for the whole batch and the slowest frame while it ran.
+
+const common = require('../common.js');
+const fs = require('fs');
+const path = require('path');
+const krom = require('krom');
+const tmpdir = require('../../test/common/tmpdir');
+
+const bench = common.createBenchmark(main, {
+  mode: ['system', 'async'],
+  parallel: [1, 4, 8],
+  size: [1024 * 1024],
+  n: [200]
+}, {
+  test: { size: 1024, n: 4 }
+});
+
+const KROM_API = 6;
+
+function converterCommand(input, output) {
+  if (process.platform === 'win32') {
+    return `copy /b "${input}" "${output}" > nul`;
+  }
+  return `gzip -9 -c "${input}" > "${output}"`;
+}
+
+function main({ mode, parallel, size, n }) {
+  tmpdir.refresh();
+  const input = path.join(tmpdir.path, 'asset.bin');
+  const data = Buffer.alloc(size);
+  let seed = 12345;
+  for (let i = 0; i < size; ++i) {
+    seed = (seed * 1103515245 + 12345) >>> 0;
+    // Compressible, but not trivially so
+    data[i] = (seed >>> 28) + 65;
+  }
+  fs.writeFileSync(input, data);
+  const commands = [];
+  for (let i = 0; i < n; ++i) {
+    commands.push(converterCommand(input, path.join(tmpdir.path, `asset${i}.gz`)));
+  }
+
+  krom.init('syscommand', 640, 480, 1, false, 0, 0, KROM_API);
+  krom.setSysCommandLimit(parallel);
+
+  let started = false;
+  let finished = 0;
+  let failed = 0;
+  let slowest = 0;
+  let last;
+  krom.setCallback(() => {
+    const now = process.hrtime.bigint();
+    if (last !== undefined) slowest = Math.max(slowest, Number(now - last) / 1e6);
+    last = now;
+
+    if (!started) {
+      started = true;
+      bench.start();
+      if (mode === 'system') {
+        // All in one frame, which is what the blocking path amounts to
+        for (const command of commands) {
+          if (krom.sysCommand(command) !== 0) ++failed;
+          ++finished;
+        }
+      } else {
+        for (const command of commands) {
+          krom.sysCommandAsync(command, (result) => {
+            if (result.status !== 0) ++failed;
+            ++finished;
+          });
+        }
+      }
+    }
+
+    if (finished === n) {
+      bench.end(n);
+      console.log(`${failed} failed, slowest frame ${slowest.toFixed(1)} ms`);
+      krom.requestShutdown();
+      finished = -1;
+    }
+  });
+}
@@ -0,0 +1,108 @@
+'use strict';
+
+// Uploads a generated mesh with separate position, normal, texture coordinate
+// and color arrays `n` times. `js` interleaves the arrays into a 32 bit float
+// buffer in JavaScript between lockVertexBuffer and unlockVertexBuffer,
+// `float32` hands the same arrays to uploadVertexArrays and `packed` does so
+// for a buffer with snorm16 normals, unorm16 texture coordinates and unorm8
+// colors. Reports vertices per second and the bytes one copy of the mesh
+// takes on the GPU.
+
+const common = require('../common.js');
+const krom = require('krom');
+
+const bench = common.createBenchmark(main, {
+  mode: ['js', 'float32', 'packed'],
+  vertices: [1024 * 1024],
+  n: [20]
+}, {
+  test: { vertices: 1024, n: 2 }
+});
+
+const KROM_API = 6;
+const USAGE_DYNAMIC = 1;
+
+// Kha's VertexData values
+const Float32_2X = 1;
+const Float32_3X = 2;
+const Float32_4X = 3;
+const UInt8_4X_Normalized = 16;
+const UInt16_2X_Normalized = 24;
+const Int16_4X_Normalized = 27;
+
+function createMesh(vertices) {
+  const positions = new Float32Array(vertices * 3);
+  const normals = new Float32Array(vertices * 4);
+  const texCoords = new Float32Array(vertices * 2);
+  const colors = new Float32Array(vertices * 4);
+  let seed = 12345;
+  const random = () => {
+    seed = (seed * 1103515245 + 12345) >>> 0;
+    return seed / 0x100000000;
+  };
+  for (let i = 0; i < vertices; ++i) {
+    const x = random() * 2 - 1;
+    const y = random() * 2 - 1;
+    const z = random() * 2 - 1;
+    const length = Math.hypot(x, y, z) || 1;
+    positions[i * 3] = x * 100;
+    positions[i * 3 + 1] = y * 100;
+    positions[i * 3 + 2] = z * 100;
+    normals[i * 4] = x / length;
+    normals[i * 4 + 1] = y / length;
+    normals[i * 4 + 2] = z / length;
+    texCoords[i * 2] = random();
+    texCoords[i * 2 + 1] = random();
+    for (let j = 0; j < 4; ++j) colors[i * 4 + j] = random();
+  }
+  return [positions, normals, texCoords, colors];
+}
+
+function structure(packed) {
+  return [
+    { name: 'pos', data: Float32_3X },
+    { name: 'normal', data: packed ? Int16_4X_Normalized : Float32_4X },
+    { name: 'tex', data: packed ? UInt16_2X_Normalized : Float32_2X },
+    { name: 'color', data: packed ? UInt8_4X_Normalized : Float32_4X },
+  ];
+}
+
+function interleave(buffer, arrays, vertices) {
+  const [positions, normals, texCoords, colors] = arrays;
+  const out = new Float32Array(krom.lockVertexBuffer(buffer, 0, vertices));
+  for (let i = 0, o = 0; i < vertices; ++i) {
+    out[o++] = positions[i * 3];
+    out[o++] = positions[i * 3 + 1];
+    out[o++] = positions[i * 3 + 2];
+    for (let j = 0; j < 4; ++j) out[o++] = normals[i * 4 + j];
+    out[o++] = texCoords[i * 2];
+    out[o++] = texCoords[i * 2 + 1];
+    for (let j = 0; j < 4; ++j) out[o++] = colors[i * 4 + j];
+  }
+  krom.unlockVertexBuffer(buffer, vertices);
+}
+
+function main({ mode, vertices, n }) {
+  const arrays = createMesh(vertices);
+
+  krom.init('vertices', 640, 480, 1, false, 0, 0, KROM_API);
+  const buffer = krom.createVertexBuffer(vertices, structure(mode === 'packed'), USAGE_DYNAMIC, 0);
+
+  let done = false;
+  krom.setCallback(() => {
+    if (done) return;
+    done = true;
+    bench.start();
+    for (let i = 0; i < n; ++i) {
+      if (mode === 'js') {
+        interleave(buffer, arrays, vertices);
+      } else if (!krom.uploadVertexArrays(buffer, arrays)) {
+        throw new Error('uploadVertexArrays rejected the mesh');
+      }
+    }
+    bench.end(vertices * n);
+    const stride = mode === 'packed' ? 12 + 8 + 4 + 4 : 4 * (3 + 4 + 2 + 4);
+    console.log(`${vertices * stride} bytes per mesh`);
+    krom.requestShutdown();
+  });
+}
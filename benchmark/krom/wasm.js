@@ -0,0 +1,92 @@
+'use strict';
+
+// Compiles a generated WebAssembly module of about `size` bytes through
+// WebAssembly.compileStreaming, waits for Krom to store the compiled code in
+// its cache and compiles it again. The difference between the two is the
+// compile time the cache saves on every later launch.
+
+const common = require('../common.js');
+const krom = require('krom');
+
+const bench = common.createBenchmark(main, {
+  size: [10 * 1024 * 1024],
+  n: [1]
+}, {
+  test: { size: 64 * 1024 }
+});
+
+const KROM_API = 6;
+
+function leb(value) {
+  const bytes = [];
+  do {
+    let byte = value & 0x7f;
+    value >>>= 7;
+    if (value !== 0) byte |= 0x80;
+    bytes.push(byte);
+  } while (value !== 0);
+  return bytes;
+}
+
+function section(id, content) {
+  return [id, ...leb(content.length), ...content];
+}
+
+// Functions returning the sum of a long chain of constants, different per
+// run so that an earlier run's cache entry is not picked up
+function createModule(size) {
+  const seed = Date.now() & 0x3f;
+  const chain = 2000;
+  const functions = Math.max(1, Math.floor(size / (chain * 3)));
+  const body = [0, 0x41, seed];
+  for (let i = 0; i < chain; ++i) body.push(0x41, i & 0x3f, 0x6a);
+  body.push(0x0b);
+
+  const code = [...leb(functions)];
+  for (let i = 0; i < functions; ++i) code.push(...leb(body.length), ...body);
+  const functionIndices = [...leb(functions)];
+  for (let i = 0; i < functions; ++i) functionIndices.push(0);
+
+  return new Uint8Array([
+    0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00,
+    ...section(1, [1, 0x60, 0, 1, 0x7f]),
+    ...section(3, functionIndices),
+    ...section(10, code)
+  ]);
+}
+
+function main({ size, n }) {
+  krom.init('wasm', 640, 480, 1, false, 0, 0, KROM_API);
+
+  const bytes = createModule(size);
+  let cold = 0;
+  let waitFrames = -1;
+  let state = 'start';
+
+  krom.setCallback(() => {
+    if (state === 'start') {
+      state = 'compiling';
+      const start = process.hrtime.bigint();
+      WebAssembly.compileStreaming(bytes).then(() => {
+        cold = Number(process.hrtime.bigint() - start) / 1e6;
+        state = 'storing';
+      });
+    } else if (state === 'storing' && krom.getWasmCacheStats().stores > 0) {
+      // The write itself is done on Krom's storage thread
+      state = 'waiting';
+      waitFrames = 60;
+    } else if (state === 'waiting' && --waitFrames === 0) {
+      state = 'compiling';
+      bench.start();
+      const start = process.hrtime.bigint();
+      WebAssembly.compileStreaming(bytes).then(() => {
+        const warm = Number(process.hrtime.bigint() - start) / 1e6;
+        bench.end(n);
+        const stats = krom.getWasmCacheStats();
+        console.log(`${bytes.length} bytes: ${cold.toFixed(1)} ms compiling, ` +
+                    `${warm.toFixed(1)} ms from the cache (${stats.hits} hits)`);
+        krom.requestShutdown();
+      });
+    }
+  });
+}
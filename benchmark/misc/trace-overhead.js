@@ -0,0 +1,67 @@
+'use strict';
+
+// Cost of recording trace events with tracing off, writing JSON and writing
+// Perfetto protobuf. Each configuration runs in a child process started with
+// the matching flags. `measure` picks the rate that is reported: events per
+// second of wall time, or events per second of CPU time of the whole process,
+// which includes the tracing thread that writes the file.
+
+const common = require('../common.js');
+const { spawnSync } = require('child_process');
+const path = require('path');
+
+const isChild = process.argv[2] === 'child';
+
+const bench = isChild ? null : common.createBenchmark(main, {
+  mode: ['off', 'json', 'perfetto'],
+  measure: ['wall', 'cpu'],
+  n: [1e6]
+}, {
+  test: { n: 1000 }
+});
+
+function runChild(n) {
+  const {
+    TRACE_EVENT_PHASE_NESTABLE_ASYNC_BEGIN: kBeforeEvent,
+    TRACE_EVENT_PHASE_NESTABLE_ASYNC_END: kAfterEvent
+  } = common.binding('constants').trace;
+  const { trace } = common.binding('trace_events');
+
+  const cpu = process.cpuUsage();
+  const start = process.hrtime.bigint();
+  for (let i = 0; i < n; i++) {
+    trace(kBeforeEvent, 'foo', 'test', i, 'test');
+    trace(kAfterEvent, 'foo', 'test', i, 'test');
+  }
+  const elapsed = process.hrtime.bigint() - start;
+  const { user, system } = process.cpuUsage(cpu);
+  process.stdout.write(JSON.stringify({
+    elapsed: elapsed.toString(),
+    cpu: user + system
+  }));
+}
+
+function main({ mode, measure, n }) {
+  const tmpdir = require('../../test/common/tmpdir');
+  tmpdir.refresh();
+  const args = ['--expose-internals', '--no-warnings'];
+  if (mode !== 'off') {
+    const extension = mode === 'json' ? 'log' : 'pftrace';
+    args.push('--trace-event-categories', 'foo',
+              '--trace-event-file-pattern',
+              path.join(tmpdir.path, `trace.\${rotation}.${extension}`));
+  }
+  args.push(__filename, 'child', `${n}`);
+
+  const child = spawnSync(process.execPath, args, { encoding: 'utf8' });
+  if (child.status !== 0)
+    throw new Error(`child failed: ${child.stderr}`);
+  const { elapsed, cpu } = JSON.parse(child.stdout);
+  const events = n * 2;
+  // CPU time is in microseconds.
+  const seconds = measure === 'cpu' ? cpu / 1e6 : Number(elapsed) / 1e9;
+  bench.report(events / seconds, BigInt(elapsed));
+}
+
+if (isChild)
+  runChild(+process.argv[3]);
@@ -0,0 +1,62 @@
+'use strict';
+// Starts a process that loads a generated project, which resolves its modules
+// without extensions, through packages and directories with index.js.
+const common = require('../common.js');
+const { spawnSync } = require('child_process');
+const fs = require('fs');
+const path = require('path');
+
+const tmpdir = require('../../test/common/tmpdir');
+const projectDirectory = path.join(tmpdir.path, 'nodejs-benchmark-startup');
+
+const bench = common.createBenchmark(main, {
+  files: [2e3],
+  packages: [20],
+  n: [10],
+});
+
+function writeModule(file, requests) {
+  const source = requests.map((request) => `require('${request}');`);
+  fs.writeFileSync(file, `${source.join('\n')}\nmodule.exports = 1;\n`);
+}
+
+// Every package has a package.json, a lib directory that is required through
+// its index.js and as many modules as fit into its share of files, each of
+// which requires the next one and a module of the next package.
+function createProject(files, packages) {
+  const perPackage = Math.floor(files / packages);
+  const main = [];
+  for (let p = 0; p < packages; p++) {
+    const packageDirectory =
+      path.join(projectDirectory, 'node_modules', `pkg${p}`);
+    const lib = path.join(packageDirectory, 'lib');
+    fs.mkdirSync(lib, { recursive: true });
+    fs.writeFileSync(path.join(packageDirectory, 'package.json'),
+                     `{"name": "pkg${p}", "main": "lib"}`);
+    writeModule(path.join(lib, 'index.js'), ['./m0']);
+    for (let i = 0; i < perPackage; i++) {
+      const requests = [];
+      if (i + 1 < perPackage) requests.push(`./m${i + 1}`);
+      if (p + 1 < packages) requests.push(`pkg${p + 1}/lib/m${i}`);
+      writeModule(path.join(lib, `m${i}.js`), requests);
+    }
+    main.push(`pkg${p}`);
+  }
+  writeModule(path.join(projectDirectory, 'index.js'), main);
+}
+
+function main({ files, packages, n }) {
+  tmpdir.refresh();
+  createProject(files, packages);
+  const script = path.join(projectDirectory, 'index.js');
+
+  bench.start();
+  for (let i = 0; i < n; i++) {
+    const child = spawnSync(process.execPath, [script]);
+    if (child.status !== 0)
+      throw new Error(child.stderr.toString());
+  }
+  bench.end(n);
+
+  tmpdir.refresh();
+}
@@ -0,0 +1,75 @@
+// Test the speed of corked writes that mix many small strings with a body,
+// like an HTTP response does, which reach the socket in a single writev.
+'use strict';
+
+const common = require('../common.js');
+const net = require('net');
+const PORT = common.PORT;
+
+const bench = common.createBenchmark(main, {
+  headers: [4, 32],
+  body: ['buffer', 'small-buffers', 'external-string'],
+  len: [1024, 64 * 1024, 2 * 1024 * 1024],
+  dur: [5],
+});
+
+function main({ dur, headers, body, len }) {
+  const strings = [];
+  for (let i = 0; i < headers; i++)
+    strings.push(`X-Header-${i}: ${'v'.repeat(i % 40)}\r\n`);
+
+  let chunks;
+  let encoding;
+  switch (body) {
+    case 'buffer':
+      chunks = [Buffer.alloc(len, 'x')];
+      break;
+    case 'small-buffers':
+      chunks = [];
+      for (let i = 0; i < len; i += 128)
+        chunks.push(Buffer.alloc(Math.min(128, len - i), 'x'));
+      break;
+    case 'external-string':
+      // Strings of this size that are made from a Buffer are external.
+      chunks = [Buffer.alloc(len, 'x').toString('latin1')];
+      encoding = 'latin1';
+      break;
+    default:
+      throw new Error(`invalid body: ${body}`);
+  }
+
+  let received = 0;
+  const server = net.createServer((socket) => {
+    socket.on('data', (data) => {
+      received += data.length;
+    });
+  });
+
+  server.listen(PORT, () => {
+    const socket = net.connect(PORT);
+    socket.on('connect', () => {
+      bench.start();
+
+      socket.on('drain', send);
+      send();
+
+      setTimeout(() => {
+        const gbits = (received * 8) / (1024 * 1024 * 1024);
+        bench.end(gbits);
+        process.exit(0);
+      }, dur * 1000);
+
+      function send() {
+        let more;
+        do {
+          socket.cork();
+          for (const string of strings)
+            socket.write(string, 'latin1');
+          for (const chunk of chunks)
+            more = socket.write(chunk, encoding);
+          socket.uncork();
+        } while (more);
+      }
+    });
+  });
+}
@@ -0,0 +1,90 @@
+// Test the speed of messages between threads: either one worker that answers
+// every message of the main thread (ping-pong), or many workers that all post
+// messages to the main thread at the same time (fan-in).
+'use strict';
+
+const common = require('../common.js');
+const { Worker } = require('worker_threads');
+
+const bench = common.createBenchmark(main, {
+  pattern: ['ping-pong', 'fan-in'],
+  workers: [1, 4],
+  payload: ['object', 'uint8array-small', 'uint8array-large'],
+  n: [1e5],
+});
+
+const workerSource = `
+  const { parentPort, workerData } = require('worker_threads');
+  const { pattern, n, payload } = workerData;
+  if (pattern === 'ping-pong') {
+    parentPort.on('message', (message) => parentPort.postMessage(message));
+  } else {
+    parentPort.once('message', () => {
+      for (let i = 0; i < n; i++)
+        parentPort.postMessage(payload);
+    });
+  }
+`;
+
+function createPayload(type) {
+  switch (type) {
+    case 'object':
+      return { action: 'pewpewpew', powerLevel: 9001 };
+    case 'uint8array-small':
+      return new Uint8Array(64);
+    case 'uint8array-large':
+      return new Uint8Array(64 * 1024);
+    default:
+      throw new Error('Unsupported payload type');
+  }
+}
+
+function main({ pattern, workers, payload: payloadType, n }) {
+  const payload = createPayload(payloadType);
+  // Every worker posts its share of the messages.
+  const perWorker = Math.ceil(n / workers);
+  const expected = pattern === 'fan-in' ? perWorker * workers : n;
+
+  const workerObjs = [];
+  let online = 0;
+  let received = 0;
+  let sent = 0;
+
+  for (let i = 0; i < workers; i++) {
+    const worker = new Worker(workerSource, {
+      eval: true,
+      workerData: { pattern, n: perWorker, payload },
+    });
+    workerObjs.push(worker);
+    worker.on('online', onOnline);
+    worker.on('message', onMessage);
+  }
+
+  function onOnline() {
+    if (++online !== workers) return;
+    bench.start();
+    if (pattern === 'fan-in') {
+      for (const worker of workerObjs)
+        worker.postMessage('start');
+    } else {
+      // Keep one message in flight for every worker.
+      for (const worker of workerObjs) {
+        sent++;
+        worker.postMessage(payload);
+      }
+    }
+  }
+
+  function onMessage(message) {
+    if (++received === expected) {
+      bench.end(expected);
+      for (const worker of workerObjs)
+        worker.terminate();
+      return;
+    }
+    if (pattern === 'ping-pong' && sent < n) {
+      sent++;
+      this.postMessage(message);
+    }
+  }
+}
@@ -0,0 +1,49 @@
+// Test the throughput of compressing a large buffer on a growing number of
+// threads.
+'use strict';
+const common = require('../common.js');
+const zlib = require('zlib');
+
+const bench = common.createBenchmark(main, {
+  method: ['gzip', 'gzipSync', 'deflate', 'deflateSync'],
+  threads: [1, 2, 4, 8],
+  level: [1, 6],
+  len: [64 * 1024 * 1024],
+  n: [4],
+});
+
+// Text with some noise, which compresses about as well as source code does.
+function makeInput(len) {
+  const words = ['function', 'return', 'const', 'buffer', 'length', 'zlib',
+                 '(', ')', '{', '}', ';', '\n', ' ', '  ', '=', '.'];
+  const input = Buffer.alloc(len);
+  let seed = 1;
+  for (let i = 0; i < len;) {
+    seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+    i += input.write(words[(seed >> 8) % words.length], i, 'latin1');
+  }
+  return input;
+}
+
+function main({ method, threads, level, len, n }) {
+  const input = makeInput(len);
+  const options = { threads, level };
+  const fn = zlib[method];
+
+  if (method.endsWith('Sync')) {
+    bench.start();
+    for (let i = 0; i < n; i++)
+      fn(input, options);
+    bench.end((n * len) / (1024 * 1024));
+    return;
+  }
+
+  let i = 0;
+  bench.start();
+  (function next(err) {
+    if (err) throw err;
+    if (i++ === n)
+      return bench.end((n * len) / (1024 * 1024));
+    fn(input, options, next);
+  })();
+}
@@ -117,6 +117,7 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
   struct epoll_event events[1024];
   struct epoll_event* pe;
   struct epoll_event e;
+  uv__loop_internal_fields_t* lfields;
   int real_timeout;
   QUEUE* q;
   uv__io_t* w;
@@ -132,8 +133,13 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
   int i;
   int user_timeout;
   int reset_timeout;
+  int ringfd;
 
-  if (loop->nfds == 0) {
+  /* File system requests in flight on io_uring are waited for even when no
+   * file descriptors are watched.
+   */
+  lfields = uv__get_internal_fields(loop);
+  if (loop->nfds == 0 && lfields->iou.in_flight == 0) {
     assert(QUEUE_EMPTY(&loop->watcher_queue));
     return;
   }
@@ -187,7 +193,7 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
   count = 48; /* Benchmarks suggest this gives the best throughput. */
   real_timeout = timeout;
 
-  if (uv__get_internal_fields(loop)->flags & UV_METRICS_IDLE_TIME) {
+  if (lfields->flags & UV_METRICS_IDLE_TIME) {
     reset_timeout = 1;
     user_timeout = timeout;
     timeout = 0;
@@ -206,6 +212,10 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
   no_epoll_wait = uv__load_relaxed(&no_epoll_wait_cached);
 
   for (;;) {
+    /* Submit the requests that were queued since the last time, in one go. */
+    uv__iou_flush(loop);
+    ringfd = lfields->iou.ringfd;
+
     /* Only need to set the provider_entry_time if timeout != 0. The function
      * will return early if the loop isn't configured with UV_METRICS_IDLE_TIME.
      */
@@ -322,6 +332,12 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
       if (fd == -1)
         continue;
 
+      if (fd == ringfd) {
+        uv__iou_poll(loop);
+        nevents++;
+        continue;
+      }
+
       assert(fd >= 0);
       assert((unsigned) fd < loop->nwatchers);
 
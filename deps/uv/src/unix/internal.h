@@ -325,6 +325,16 @@ UV_UNUSED(static char* uv__basename_r(const char* path)) {
 
 #if defined(__linux__)
 int uv__inotify_fork(uv_loop_t* loop, void* old_watchers);
+unsigned uv__kernel_version(void);
+void uv__statx_to_stat(const struct uv__statx* statxbuf, uv_stat_t* buf);
+void uv__iou_init(uv_loop_t* loop);
+void uv__iou_delete(uv_loop_t* loop);
+int uv__iou_fs_submit(uv_loop_t* loop, uv_fs_t* req);
+void uv__iou_flush(uv_loop_t* loop);
+void uv__iou_poll(uv_loop_t* loop);
+void uv__fs_post_work(uv_loop_t* loop, uv_fs_t* req);
+#else
+#define uv__iou_fs_submit(loop, req) 0
 #endif
 
 typedef int (*uv__peersockfunc)(int, struct sockaddr*, socklen_t*);
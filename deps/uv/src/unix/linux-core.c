@@ -83,11 +83,17 @@ static void read_speeds(unsigned int numcpus, uv_cpu_info_t* ci);
 static uint64_t read_cpufreq(unsigned int cpunum);
 
 int uv__platform_loop_init(uv_loop_t* loop) {
-  
+  int err;
+
   loop->inotify_fd = -1;
   loop->inotify_watchers = NULL;
 
-  return uv__epoll_init(loop);
+  err = uv__epoll_init(loop);
+  if (err)
+    return err;
+
+  uv__iou_init(loop);
+  return 0;
 }
 
 
@@ -95,6 +101,13 @@ int uv__io_fork(uv_loop_t* loop) {
   int err;
   void* old_watchers;
 
+  /* The child shares the ring with the parent and would see the completions
+   * of requests that the parent runs callbacks for too, or none at all once
+   * the ring is replaced. Forking can only be done when there are none.
+   */
+  if (uv__get_internal_fields(loop)->iou.in_flight > 0)
+    return UV_EBUSY;
+
   old_watchers = loop->inotify_watchers;
 
   uv__close(loop->backend_fd);
@@ -110,6 +123,8 @@ int uv__io_fork(uv_loop_t* loop) {
 
 
 void uv__platform_loop_delete(uv_loop_t* loop) {
+  uv__iou_delete(loop);
+
   if (loop->inotify_fd == -1) return;
   uv__io_stop(loop, &loop->inotify_read_watcher, POLLIN);
   uv__close(loop->inotify_fd);
@@ -0,0 +1,693 @@
+/* Copyright libuv contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* File system requests that have a callback are run through io_uring when
+ * the kernel supports it, instead of on the thread pool. Requests are queued
+ * on the submission ring as they are made and handed to the kernel with a
+ * single io_uring_enter() call right before the event loop polls for I/O.
+ * The ring's file descriptor is part of the epoll set, which reports it as
+ * readable when completions are waiting.
+ *
+ * io_uring is not used when it is unavailable, e.g. because the kernel is
+ * too old or a seccomp filter rejects io_uring_setup(), on Android, when the
+ * ring is full, or when UV_USE_IO_URING=0 is set in the environment. Requests
+ * then go to the thread pool like before. So do the queued ones if the
+ * kernel refuses to take them for any other reason than being busy.
+ */
+
+#include "uv.h"
+#include "internal.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef __NR_io_uring_setup
+# define __NR_io_uring_setup 425
+#endif
+
+#ifndef __NR_io_uring_enter
+# define __NR_io_uring_enter 426
+#endif
+
+#ifndef __NR_io_uring_register
+# define __NR_io_uring_register 427
+#endif
+
+/* Submission queue depth. The completion queue is twice as deep. */
+#define UV__IOU_ENTRIES 256
+
+enum {
+  UV__IORING_OP_READV = 1,
+  UV__IORING_OP_WRITEV = 2,
+  UV__IORING_OP_FSYNC = 3,
+  UV__IORING_OP_OPENAT = 18,
+  UV__IORING_OP_CLOSE = 19,
+  UV__IORING_OP_STATX = 21
+};
+
+enum {
+  UV__IORING_ENTER_GETEVENTS = 1u
+};
+
+enum {
+  UV__IORING_FEAT_SINGLE_MMAP = 1u,
+  UV__IORING_FEAT_NODROP = 2u,
+  UV__IORING_FEAT_RW_CUR_POS = 8u
+};
+
+enum {
+  UV__IORING_FSYNC_DATASYNC = 1u
+};
+
+enum {
+  UV__IORING_REGISTER_PROBE = 8,
+  UV__IO_URING_OP_SUPPORTED = 1u
+};
+
+#define UV__IORING_OFF_SQ_RING 0ull
+#define UV__IORING_OFF_SQES 0x10000000ull
+
+struct uv__io_sqring_offsets {
+  uint32_t head;
+  uint32_t tail;
+  uint32_t ring_mask;
+  uint32_t ring_entries;
+  uint32_t flags;
+  uint32_t dropped;
+  uint32_t array;
+  uint32_t reserved0;
+  uint64_t reserved1;
+};
+
+struct uv__io_cqring_offsets {
+  uint32_t head;
+  uint32_t tail;
+  uint32_t ring_mask;
+  uint32_t ring_entries;
+  uint32_t overflow;
+  uint32_t cqes;
+  uint64_t reserved0;
+  uint64_t reserved1;
+};
+
+struct uv__io_uring_params {
+  uint32_t sq_entries;
+  uint32_t cq_entries;
+  uint32_t flags;
+  uint32_t sq_thread_cpu;
+  uint32_t sq_thread_idle;
+  uint32_t features;
+  uint32_t reserved[4];
+  struct uv__io_sqring_offsets sq_off;
+  struct uv__io_cqring_offsets cq_off;
+};
+
+struct uv__io_uring_sqe {
+  uint8_t opcode;
+  uint8_t flags;
+  uint16_t ioprio;
+  int32_t fd;
+  uint64_t off;  /* Also the struct statx pointer of IORING_OP_STATX. */
+  uint64_t addr;
+  uint32_t len;
+  uint32_t op_flags;  /* rw_flags, fsync_flags, open_flags, etc. */
+  uint64_t user_data;
+  uint64_t pad[3];
+};
+
+struct uv__io_uring_cqe {
+  uint64_t user_data;
+  int32_t res;
+  uint32_t flags;
+};
+
+struct uv__io_uring_probe_op {
+  uint8_t op;
+  uint8_t resv;
+  uint16_t flags;
+  uint32_t resv2;
+};
+
+struct uv__io_uring_probe {
+  uint8_t last_op;
+  uint8_t ops_len;
+  uint16_t resv;
+  uint32_t resv2[3];
+  struct uv__io_uring_probe_op ops[256];
+};
+
+STATIC_ASSERT(40 + 40 + 40 == sizeof(struct uv__io_uring_params));
+STATIC_ASSERT(64 == sizeof(struct uv__io_uring_sqe));
+STATIC_ASSERT(16 == sizeof(struct uv__io_uring_cqe));
+STATIC_ASSERT(sizeof(uv_buf_t) == sizeof(struct iovec));
+
+
+static int uv__io_uring_setup(unsigned entries,
+                              struct uv__io_uring_params* params) {
+  return syscall(__NR_io_uring_setup, entries, params);
+}
+
+
+static int uv__io_uring_enter(int fd,
+                              unsigned to_submit,
+                              unsigned min_complete,
+                              unsigned flags) {
+  /* The last two arguments are the signal mask and its size. */
+  return syscall(__NR_io_uring_enter,
+                 fd,
+                 to_submit,
+                 min_complete,
+                 flags,
+                 NULL,
+                 0L);
+}
+
+
+static int uv__io_uring_register(int fd,
+                                 unsigned opcode,
+                                 void* arg,
+                                 unsigned nargs) {
+  return syscall(__NR_io_uring_register, fd, opcode, arg, nargs);
+}
+
+
+#define UV__FS_TYPE_BIT(type) ((uint64_t) 1 << (type))
+
+STATIC_ASSERT(UV_FS_LUTIME < 64);
+
+
+static struct uv__iou* uv__get_iou(uv_loop_t* loop) {
+  return &uv__get_internal_fields(loop)->iou;
+}
+
+
+static int uv__use_io_uring(void) {
+  static int use_io_uring;  /* 0 if not decided yet, 1 to use, -1 not to. */
+  const char* val;
+  int use;
+
+  use = uv__load_relaxed(&use_io_uring);
+  if (use != 0)
+    return use > 0;
+
+#if defined(__ANDROID__)
+  /* The seccomp filter of Android apps does not allow io_uring, and may kill
+   * the process instead of failing the system call.
+   */
+  use = -1;
+#else
+  val = getenv("UV_USE_IO_URING");
+  use = 1;
+  if (val != NULL && atoi(val) == 0)
+    use = -1;
+
+  /* Older kernels have io_uring bugs that are not worth working around. */
+  if (uv__kernel_version() < /* 5.10.186 */ 0x050ABA)
+    use = -1;
+#endif
+
+  uv__store_relaxed(&use_io_uring, use);
+  return use > 0;
+}
+
+
+static uint64_t uv__iou_fs_types(int ringfd) {
+  struct uv__io_uring_probe* probe;
+  uint64_t fs_types;
+  unsigned i;
+
+  probe = uv__calloc(1, sizeof(*probe));
+  if (probe == NULL)
+    return 0;
+
+  fs_types = 0;
+  if (uv__io_uring_register(ringfd,
+                            UV__IORING_REGISTER_PROBE,
+                            probe,
+                            ARRAY_SIZE(probe->ops)) == 0) {
+    for (i = 0; i < probe->ops_len && i < ARRAY_SIZE(probe->ops); i++) {
+      if (!(probe->ops[i].flags & UV__IO_URING_OP_SUPPORTED))
+        continue;
+
+      switch (probe->ops[i].op) {
+      case UV__IORING_OP_READV:
+        fs_types |= UV__FS_TYPE_BIT(UV_FS_READ);
+        break;
+      case UV__IORING_OP_WRITEV:
+        fs_types |= UV__FS_TYPE_BIT(UV_FS_WRITE);
+        break;
+      case UV__IORING_OP_FSYNC:
+        fs_types |= UV__FS_TYPE_BIT(UV_FS_FSYNC);
+        fs_types |= UV__FS_TYPE_BIT(UV_FS_FDATASYNC);
+        break;
+      case UV__IORING_OP_OPENAT:
+        fs_types |= UV__FS_TYPE_BIT(UV_FS_OPEN);
+        break;
+      case UV__IORING_OP_CLOSE:
+        fs_types |= UV__FS_TYPE_BIT(UV_FS_CLOSE);
+        break;
+      case UV__IORING_OP_STATX:
+        fs_types |= UV__FS_TYPE_BIT(UV_FS_STAT);
+        fs_types |= UV__FS_TYPE_BIT(UV_FS_LSTAT);
+        fs_types |= UV__FS_TYPE_BIT(UV_FS_FSTAT);
+        break;
+      }
+    }
+  }
+
+  uv__free(probe);
+  return fs_types;
+}
+
+
+void uv__iou_init(uv_loop_t* loop) {
+  struct uv__io_uring_params params;
+  struct epoll_event e;
+  struct uv__iou* iou;
+  uint32_t* sqarray;
+  uint64_t fs_types;
+  size_t sqlen;
+  size_t cqlen;
+  size_t maxlen;
+  size_t sqelen;
+  uint32_t i;
+  char* sq;
+  char* sqe;
+  int ringfd;
+
+  iou = uv__get_iou(loop);
+  memset(iou, 0, sizeof(*iou));
+  iou->ringfd = -1;
+
+  if (!uv__use_io_uring())
+    return;
+
+  /* Fails with ENOSYS on old kernels, EPERM when seccomp forbids it and
+   * ENOMEM when the ring would exceed RLIMIT_MEMLOCK. The thread pool is
+   * used instead in all of those cases.
+   */
+  memset(&params, 0, sizeof(params));
+  ringfd = uv__io_uring_setup(UV__IOU_ENTRIES, &params);
+  if (ringfd == -1)
+    return;
+
+  sq = MAP_FAILED;
+  sqe = MAP_FAILED;
+
+  if (!(params.features & UV__IORING_FEAT_SINGLE_MMAP))
+    goto fail;
+
+  /* Completions are not dropped when the completion queue is full. */
+  if (!(params.features & UV__IORING_FEAT_NODROP))
+    goto fail;
+
+  /* Reads and writes at offset -1 use the file position. */
+  if (!(params.features & UV__IORING_FEAT_RW_CUR_POS))
+    goto fail;
+
+  sqlen = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  cqlen = params.cq_off.cqes +
+          params.cq_entries * sizeof(struct uv__io_uring_cqe);
+  maxlen = sqlen < cqlen ? cqlen : sqlen;
+  sqelen = params.sq_entries * sizeof(struct uv__io_uring_sqe);
+
+  sq = mmap(0,
+            maxlen,
+            PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE,
+            ringfd,
+            UV__IORING_OFF_SQ_RING);
+
+  sqe = mmap(0,
+             sqelen,
+             PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE,
+             ringfd,
+             UV__IORING_OFF_SQES);
+
+  if (sq == MAP_FAILED || sqe == MAP_FAILED)
+    goto fail;
+
+  fs_types = uv__iou_fs_types(ringfd);
+  if (fs_types == 0)
+    goto fail;
+
+  memset(&e, 0, sizeof(e));
+  e.events = POLLIN;
+  e.data.fd = ringfd;
+
+  if (epoll_ctl(loop->backend_fd, EPOLL_CTL_ADD, ringfd, &e))
+    goto fail;
+
+  /* Submission queue entries are used in the order of the ring. */
+  sqarray = (uint32_t*) (sq + params.sq_off.array);
+  for (i = 0; i < params.sq_entries; i++)
+    sqarray[i] = i;
+
+  iou->sqhead = (uint32_t*) (sq + params.sq_off.head);
+  iou->sqtail = (uint32_t*) (sq + params.sq_off.tail);
+  iou->sqmask = *(uint32_t*) (sq + params.sq_off.ring_mask);
+  iou->sqentries = params.sq_entries;
+  iou->cqhead = (uint32_t*) (sq + params.cq_off.head);
+  iou->cqtail = (uint32_t*) (sq + params.cq_off.tail);
+  iou->cqmask = *(uint32_t*) (sq + params.cq_off.ring_mask);
+  iou->cqentries = params.cq_entries;
+  iou->sq = sq;
+  iou->cqe = sq + params.cq_off.cqes;
+  iou->sqe = sqe;
+  iou->sqlen = maxlen;
+  iou->sqelen = sqelen;
+  iou->fs_types = fs_types;
+  iou->ringfd = ringfd;
+
+  return;
+
+fail:
+  if (sq != MAP_FAILED)
+    munmap(sq, maxlen);
+
+  if (sqe != MAP_FAILED)
+    munmap(sqe, sqelen);
+
+  uv__close(ringfd);
+}
+
+
+void uv__iou_delete(uv_loop_t* loop) {
+  struct uv__iou* iou;
+
+  iou = uv__get_iou(loop);
+  if (iou->ringfd == -1)
+    return;
+
+  munmap(iou->sq, iou->sqlen);
+  munmap(iou->sqe, iou->sqelen);
+  uv__close(iou->ringfd);
+  iou->ringfd = -1;
+  iou->fs_types = 0;
+}
+
+
+/* Takes the requests that the kernel did not accept back from the submission
+ * ring and runs them on the thread pool. The ring stays around for the
+ * requests the kernel has, but no new ones are queued on it.
+ */
+static void uv__iou_fall_back(uv_loop_t* loop, struct uv__iou* iou) {
+  struct uv__io_uring_sqe* sqe;
+  uv_fs_t* req;
+  uint32_t tail;
+  uint32_t i;
+
+  iou->fs_types = 0;
+  tail = *iou->sqtail - iou->pending;
+
+  for (i = tail; i != *iou->sqtail; i++) {
+    sqe = (struct uv__io_uring_sqe*) iou->sqe + (i & iou->sqmask);
+    req = (uv_fs_t*) (uintptr_t) sqe->user_data;
+
+    if (req->fs_type == UV_FS_STAT ||
+        req->fs_type == UV_FS_LSTAT ||
+        req->fs_type == UV_FS_FSTAT) {
+      uv__free(req->ptr);  /* The statx buffer. */
+      req->ptr = NULL;
+    }
+
+    uv__fs_post_work(loop, req);
+  }
+
+  __atomic_store_n(iou->sqtail, tail, __ATOMIC_RELEASE);
+  iou->in_flight -= iou->pending;
+  iou->pending = 0;
+}
+
+
+/* Hands the queued requests to the kernel. */
+void uv__iou_flush(uv_loop_t* loop) {
+  struct uv__iou* iou;
+  unsigned min_complete;
+  unsigned flags;
+  int rc;
+
+  iou = uv__get_iou(loop);
+  min_complete = 0;
+  flags = 0;
+
+  while (iou->pending > 0) {
+    rc = uv__io_uring_enter(iou->ringfd, iou->pending, min_complete, flags);
+
+    if (rc > 0) {
+      iou->pending -= rc;
+      continue;
+    }
+
+    if (rc == -1 && errno == EINTR)
+      continue;
+
+    /* The kernel is out of resources for new requests. Wait for one of the
+     * submitted ones to complete when there is one to wait for.
+     */
+    if (rc == -1 &&
+        (errno == EAGAIN || errno == EBUSY) &&
+        iou->in_flight > iou->pending) {
+      min_complete = 1;
+      flags = UV__IORING_ENTER_GETEVENTS;
+      continue;
+    }
+
+    uv__iou_fall_back(loop, iou);
+  }
+}
+
+
+static struct uv__io_uring_sqe* uv__iou_get_sqe(uv_loop_t* loop,
+                                                struct uv__iou* iou,
+                                                uv_fs_t* req) {
+  struct uv__io_uring_sqe* sqe;
+  uint32_t head;
+  uint32_t tail;
+
+  /* Keep the completion queue from overflowing, the kernel would have to
+   * buffer the completions that do not fit.
+   */
+  if (iou->in_flight >= iou->cqentries)
+    return NULL;
+
+  head = __atomic_load_n(iou->sqhead, __ATOMIC_ACQUIRE);
+  tail = *iou->sqtail;
+
+  if (tail - head >= iou->sqentries) {
+    uv__iou_flush(loop);
+    head = __atomic_load_n(iou->sqhead, __ATOMIC_ACQUIRE);
+    if (tail - head >= iou->sqentries)
+      return NULL;
+  }
+
+  sqe = (struct uv__io_uring_sqe*) iou->sqe + (tail & iou->sqmask);
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->user_data = (uintptr_t) req;
+
+  /* Makes uv_cancel() fail with UV_EBUSY, like for requests that a thread
+   * pool thread has started working on.
+   */
+  req->work_req.loop = loop;
+  req->work_req.work = NULL;
+  req->work_req.done = NULL;
+  QUEUE_INIT(&req->work_req.wq);
+
+  return sqe;
+}
+
+
+static void uv__iou_queue_sqe(struct uv__iou* iou) {
+  __atomic_store_n(iou->sqtail, *iou->sqtail + 1, __ATOMIC_RELEASE);
+  iou->pending++;
+  iou->in_flight++;
+}
+
+
+/* Returns 1 if the request was queued, or 0 if it has to go to the thread
+ * pool instead.
+ */
+int uv__iou_fs_submit(uv_loop_t* loop, uv_fs_t* req) {
+  struct uv__io_uring_sqe* sqe;
+  struct uv__statx* statxbuf;
+  struct uv__iou* iou;
+  unsigned int iovmax;
+
+  iou = uv__get_iou(loop);
+  if (!(iou->fs_types & UV__FS_TYPE_BIT(req->fs_type)))
+    return 0;
+
+  /* The thread pool writes everything in several calls. */
+  iovmax = uv__getiovmax();
+  if (req->fs_type == UV_FS_WRITE && req->nbufs > iovmax)
+    return 0;
+
+  statxbuf = NULL;
+  if (req->fs_type == UV_FS_STAT ||
+      req->fs_type == UV_FS_LSTAT ||
+      req->fs_type == UV_FS_FSTAT) {
+    statxbuf = uv__malloc(sizeof(*statxbuf));
+    if (statxbuf == NULL)
+      return 0;
+  }
+
+  sqe = uv__iou_get_sqe(loop, iou, req);
+  if (sqe == NULL) {
+    uv__free(statxbuf);
+    return 0;
+  }
+
+  switch (req->fs_type) {
+  case UV_FS_CLOSE:
+    sqe->opcode = UV__IORING_OP_CLOSE;
+    sqe->fd = req->file;
+    break;
+  case UV_FS_FDATASYNC:
+  case UV_FS_FSYNC:
+    sqe->opcode = UV__IORING_OP_FSYNC;
+    sqe->fd = req->file;
+    if (req->fs_type == UV_FS_FDATASYNC)
+      sqe->op_flags = UV__IORING_FSYNC_DATASYNC;
+    break;
+  case UV_FS_OPEN:
+    sqe->opcode = UV__IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uintptr_t) req->path;
+    sqe->len = req->mode;
+    sqe->op_flags = req->flags | O_CLOEXEC;
+#ifdef O_LARGEFILE
+    /* Like open() does with _FILE_OFFSET_BITS=64. */
+    sqe->op_flags |= O_LARGEFILE;
+#endif
+    break;
+  case UV_FS_READ:
+  case UV_FS_WRITE:
+    if (req->nbufs > iovmax)
+      req->nbufs = iovmax;
+    sqe->opcode = req->fs_type == UV_FS_READ ? UV__IORING_OP_READV
+                                             : UV__IORING_OP_WRITEV;
+    sqe->fd = req->file;
+    sqe->addr = (uintptr_t) req->bufs;
+    sqe->len = req->nbufs;
+    sqe->off = req->off < 0 ? (uint64_t) -1 : (uint64_t) req->off;
+    break;
+  case UV_FS_FSTAT:
+  case UV_FS_LSTAT:
+  case UV_FS_STAT:
+    sqe->opcode = UV__IORING_OP_STATX;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uintptr_t) req->path;
+    sqe->len = 0xFFF; /* STATX_BASIC_STATS + STATX_BTIME */
+    sqe->off = (uintptr_t) statxbuf;
+    if (req->fs_type == UV_FS_FSTAT) {
+      sqe->fd = req->file;
+      sqe->addr = (uintptr_t) "";
+      sqe->op_flags = 0x1000; /* AT_EMPTY_PATH */
+    } else if (req->fs_type == UV_FS_LSTAT) {
+      sqe->op_flags = AT_SYMLINK_NOFOLLOW;
+    }
+    req->ptr = statxbuf;
+    break;
+  default:
+    abort();
+  }
+
+  uv__iou_queue_sqe(iou);
+  return 1;
+}
+
+
+static void uv__iou_fs_done(uv_loop_t* loop, uv_fs_t* req, int32_t res) {
+  struct uv__statx* statxbuf;
+
+  uv__req_unregister(loop, req);
+
+  switch (req->fs_type) {
+  case UV_FS_CLOSE:
+    if (res == UV__ERR(EINTR) || res == UV__ERR(EINPROGRESS))
+      res = 0;  /* The close is in progress, not an error. */
+    break;
+  case UV_FS_READ:
+  case UV_FS_WRITE:
+    if (req->bufs != req->bufsml)
+      uv__free(req->bufs);
+    req->bufs = NULL;
+    req->nbufs = 0;
+    break;
+  case UV_FS_FSTAT:
+  case UV_FS_LSTAT:
+  case UV_FS_STAT:
+    statxbuf = req->ptr;
+    req->ptr = NULL;
+    if (res == 0) {
+      uv__statx_to_stat(statxbuf, &req->statbuf);
+      req->ptr = &req->statbuf;
+    }
+    uv__free(statxbuf);
+    break;
+  default:
+    break;
+  }
+
+  req->result = res;
+  req->cb(req);
+}
+
+
+/* Runs the callbacks of the completed requests. */
+void uv__iou_poll(uv_loop_t* loop) {
+  struct uv__io_uring_cqe* cqe;
+  struct uv__iou* iou;
+  uv_fs_t* req;
+  uint32_t head;
+  uint32_t tail;
+  int32_t res;
+
+  iou = uv__get_iou(loop);
+  head = *iou->cqhead;
+  tail = __atomic_load_n(iou->cqtail, __ATOMIC_ACQUIRE);
+
+  if (head != tail)
+    uv__metrics_update_idle_time(loop);
+
+  for (; head != tail; head++) {
+    cqe = (struct uv__io_uring_cqe*) iou->cqe + (head & iou->cqmask);
+    req = (uv_fs_t*) (uintptr_t) cqe->user_data;
+    res = cqe->res;
+
+    /* Give the entry back before the callback, which may start new requests
+     * that complete right away.
+     */
+    __atomic_store_n(iou->cqhead, head + 1, __ATOMIC_RELEASE);
+    iou->in_flight--;
+
+    uv__iou_fs_done(loop, req, res);
+  }
+}
@@ -365,9 +365,37 @@ struct uv__loop_metrics_s {
 void uv__metrics_update_idle_time(uv_loop_t* loop);
 void uv__metrics_set_provider_entry_time(uv_loop_t* loop);
 
+#ifdef __linux__
+/* An io_uring instance that file system requests are submitted to, see
+ * src/unix/linux-iouring.c. ringfd is -1 when io_uring is not used.
+ */
+struct uv__iou {
+  uint32_t* sqhead;
+  uint32_t* sqtail;
+  uint32_t sqmask;
+  uint32_t sqentries;
+  uint32_t* cqhead;
+  uint32_t* cqtail;
+  uint32_t cqmask;
+  uint32_t cqentries;
+  void* sq;  /* Mapping of the submission and completion rings. */
+  void* cqe;
+  void* sqe;
+  size_t sqlen;
+  size_t sqelen;
+  uint64_t fs_types;  /* Bit set of the uv_fs_type values it supports. */
+  uint32_t pending;  /* Queued but not yet submitted to the kernel. */
+  uint32_t in_flight;  /* Queued or submitted, and not completed yet. */
+  int ringfd;
+};
+#endif  /* __linux__ */
+
 struct uv__loop_internal_fields_s {
   unsigned int flags;
   uv__loop_metrics_t loop_metrics;
+#ifdef __linux__
+  struct uv__iou iou;
+#endif  /* __linux__ */
 };
 
 #endif /* UV_COMMON_H_ */
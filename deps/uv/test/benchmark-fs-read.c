@@ -0,0 +1,151 @@
+/* Copyright libuv contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "task.h"
+#include "uv.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FILE_NAME             "fs_read_random_file"
+#define FILE_SIZE             (64 * 1024 * 1024)
+#define BLOCK_SIZE            4096
+#define NUM_READS             (1 * (int) 1e5)
+#define MAX_CONCURRENT_REQS   256
+
+struct read_req {
+  uv_fs_t fs_req;
+  uv_buf_t buf;
+  char data[BLOCK_SIZE];
+};
+
+static struct read_req reqs[MAX_CONCURRENT_REQS];
+static uv_file file;
+static int reads_left;
+static unsigned int seed;
+
+
+/* An xorshift generator, so that every run reads the same blocks. */
+static int64_t random_offset(void) {
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return (int64_t) (seed % (FILE_SIZE / BLOCK_SIZE)) * BLOCK_SIZE;
+}
+
+
+static void read_cb(uv_fs_t* fs_req);
+
+
+static void start_read(struct read_req* req) {
+  reads_left--;
+  req->buf = uv_buf_init(req->data, sizeof(req->data));
+  ASSERT(0 == uv_fs_read(uv_default_loop(),
+                         &req->fs_req,
+                         file,
+                         &req->buf,
+                         1,
+                         random_offset(),
+                         read_cb));
+}
+
+
+static void read_cb(uv_fs_t* fs_req) {
+  struct read_req* req = container_of(fs_req, struct read_req, fs_req);
+  ASSERT(fs_req->result == BLOCK_SIZE);
+  uv_fs_req_cleanup(fs_req);
+  if (reads_left > 0)
+    start_read(req);
+}
+
+
+static void create_file(void) {
+  uv_fs_t req;
+  uv_buf_t buf;
+  char* data;
+  int64_t off;
+  int r;
+
+  data = malloc(1024 * 1024);
+  ASSERT_NOT_NULL(data);
+  memset(data, 'x', 1024 * 1024);
+  buf = uv_buf_init(data, 1024 * 1024);
+
+  r = uv_fs_open(NULL,
+                 &req,
+                 FILE_NAME,
+                 UV_FS_O_RDWR | UV_FS_O_CREAT | UV_FS_O_TRUNC,
+                 0644,
+                 NULL);
+  ASSERT(r >= 0);
+  file = r;
+  uv_fs_req_cleanup(&req);
+
+  for (off = 0; off < FILE_SIZE; off += buf.len) {
+    ASSERT(uv_fs_write(NULL, &req, file, &buf, 1, off, NULL) == (int) buf.len);
+    uv_fs_req_cleanup(&req);
+  }
+
+  free(data);
+}
+
+
+/* Reads 4 KB blocks at random offsets of a file that is in the page cache,
+ * with up to MAX_CONCURRENT_REQS requests in flight. Run it from a directory
+ * on the file system of interest, e.g. tmpfs or ext4, and compare with
+ * UV_USE_IO_URING=0 in the environment to measure the thread pool.
+ */
+BENCHMARK_IMPL(fs_read_random) {
+  uint64_t before;
+  uint64_t after;
+  uv_fs_t req;
+  int depth;
+  int i;
+
+  create_file();
+
+  for (depth = 1; depth <= MAX_CONCURRENT_REQS; depth *= 2) {
+    reads_left = NUM_READS;
+    seed = 2463534242u;
+
+    before = uv_hrtime();
+    for (i = 0; i < depth; i++)
+      start_read(reqs + i);
+    ASSERT(0 == uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+    after = uv_hrtime();
+
+    printf("%s random 4 KB reads (%d concurrent): %.2fs (%s/s)\n",
+           fmt(1.0 * NUM_READS),
+           depth,
+           (after - before) / 1e9,
+           fmt((1.0 * NUM_READS) / ((after - before) / 1e9)));
+    fflush(stdout);
+  }
+
+  ASSERT(0 == uv_fs_close(NULL, &req, file, NULL));
+  uv_fs_req_cleanup(&req);
+  ASSERT(0 == uv_fs_unlink(NULL, &req, FILE_NAME, NULL));
+  uv_fs_req_cleanup(&req);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
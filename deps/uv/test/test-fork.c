@@ -116,6 +116,79 @@ TEST_IMPL(fork_timer) {
 }
 
 
+static int fork_read_cb_called;
+
+
+static void fork_read_cb(uv_fs_t* req) {
+  ASSERT(req->result == 1);
+  fork_read_cb_called++;
+  uv_fs_req_cleanup(req);
+}
+
+
+TEST_IMPL(fork_fs_read_in_flight) {
+  /* On Linux, a loop can not be forked while file system requests are on
+   * io_uring. It can be once they are done.
+   */
+  uv_fs_t read_req;
+  uv_buf_t buf;
+  pid_t child_pid;
+  char byte;
+  int fds[2];
+  int r;
+
+  ASSERT(0 == pipe(fds));
+  buf = uv_buf_init(&byte, 1);
+  ASSERT(0 == uv_fs_read(uv_default_loop(),
+                         &read_req,
+                         fds[0],
+                         &buf,
+                         1,
+                         -1,
+                         fork_read_cb));
+  /* Hands the read to the kernel, where nothing comes for it yet. */
+  ASSERT(1 == uv_run(uv_default_loop(), UV_RUN_NOWAIT));
+
+  child_pid = fork();
+  ASSERT(child_pid != -1);
+
+  if (child_pid == 0) {
+    /* child, UV_EBUSY when the read is on io_uring */
+    r = uv_loop_fork(uv_default_loop());
+#ifdef __linux__
+    ASSERT(r == 0 || r == UV_EBUSY);
+#else
+    ASSERT(r == 0);
+#endif
+    _exit(0);
+  }
+
+  /* parent, the read is still there */
+  assert_wait_child(child_pid);
+  ASSERT(1 == write(fds[1], "x", 1));
+  ASSERT(0 == uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+  ASSERT(1 == fork_read_cb_called);
+  ASSERT(byte == 'x');
+
+  child_pid = fork();
+  ASSERT(child_pid != -1);
+
+  if (child_pid != 0) {
+    /* parent */
+    assert_wait_child(child_pid);
+  } else {
+    /* child */
+    ASSERT(0 == uv_loop_fork(uv_default_loop()));
+    run_timer_loop_once();
+  }
+
+  ASSERT(0 == close(fds[0]));
+  ASSERT(0 == close(fds[1]));
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
 TEST_IMPL(fork_socketpair) {
   /* A socket opened in the parent and accept'd in the
      child works after a fork. */
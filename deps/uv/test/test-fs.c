@@ -3151,6 +3151,65 @@ TEST_IMPL(fs_read_bufs) {
 }
 
 
+static uv_fs_t concurrent_reqs[1000];
+static uv_buf_t concurrent_bufs[ARRAY_SIZE(concurrent_reqs)];
+static char concurrent_bytes[ARRAY_SIZE(concurrent_reqs)];
+static char concurrent_file[446];
+static int concurrent_read_cb_count;
+
+static void concurrent_read_cb(uv_fs_t* req) {
+  size_t i;
+
+  i = req - concurrent_reqs;
+  ASSERT(req->fs_type == UV_FS_READ);
+  ASSERT(req->result == 1);
+  ASSERT(concurrent_bytes[i] == concurrent_file[i % sizeof(concurrent_file)]);
+  concurrent_read_cb_count++;
+  uv_fs_req_cleanup(req);
+}
+
+
+/* More requests than fit in the queues of the kernel, if any. */
+TEST_IMPL(fs_read_many_concurrent) {
+  uv_buf_t buf;
+  size_t i;
+  int r;
+
+  loop = uv_default_loop();
+  r = uv_fs_open(NULL, &open_req1, "test/fixtures/lorem_ipsum.txt",
+                 O_RDONLY, 0, NULL);
+  ASSERT(r >= 0);
+  uv_fs_req_cleanup(&open_req1);
+
+  buf = uv_buf_init(concurrent_file, sizeof(concurrent_file));
+  r = uv_fs_read(NULL, &read_req, open_req1.result, &buf, 1, 0, NULL);
+  ASSERT(r == sizeof(concurrent_file));
+  uv_fs_req_cleanup(&read_req);
+
+  for (i = 0; i < ARRAY_SIZE(concurrent_reqs); i++) {
+    concurrent_bufs[i] = uv_buf_init(concurrent_bytes + i, 1);
+    r = uv_fs_read(loop,
+                   concurrent_reqs + i,
+                   open_req1.result,
+                   concurrent_bufs + i,
+                   1,
+                   i % sizeof(concurrent_file),
+                   concurrent_read_cb);
+    ASSERT(r == 0);
+  }
+
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(concurrent_read_cb_count == ARRAY_SIZE(concurrent_reqs));
+
+  r = uv_fs_close(NULL, &close_req, open_req1.result, NULL);
+  ASSERT(r == 0);
+  uv_fs_req_cleanup(&close_req);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
 static void fs_read_file_eof(int add_flags) {
 #if defined(__CYGWIN__) || defined(__MSYS__)
   RETURN_SKIP("Cygwin pread at EOF may (incorrectly) return data!");
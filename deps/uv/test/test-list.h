@@ -370,6 +370,7 @@ TEST_DECLARE   (fs_file_open_append)
 TEST_DECLARE   (fs_statfs)
 TEST_DECLARE   (fs_stat_missing_path)
 TEST_DECLARE   (fs_read_bufs)
+TEST_DECLARE   (fs_read_many_concurrent)
 TEST_DECLARE   (fs_read_file_eof)
 TEST_DECLARE   (fs_event_watch_dir)
 TEST_DECLARE   (fs_event_watch_dir_recursive)
@@ -515,6 +516,7 @@ TEST_DECLARE   (readable_on_eof)
 
 #ifndef _WIN32
 TEST_DECLARE  (fork_timer)
+TEST_DECLARE  (fork_fs_read_in_flight)
 TEST_DECLARE  (fork_socketpair)
 TEST_DECLARE  (fork_socketpair_started)
 TEST_DECLARE  (fork_signal_to_child)
@@ -1033,6 +1035,7 @@ TASK_LIST_START
   TEST_ENTRY  (fs_statfs)
   TEST_ENTRY  (fs_stat_missing_path)
   TEST_ENTRY  (fs_read_bufs)
+  TEST_ENTRY  (fs_read_many_concurrent)
   TEST_ENTRY  (fs_read_file_eof)
   TEST_ENTRY  (fs_file_open_append)
   TEST_ENTRY  (fs_event_watch_dir)
@@ -1122,6 +1125,7 @@ TASK_LIST_START
 
 #ifndef _WIN32
   TEST_ENTRY  (fork_timer)
+  TEST_ENTRY  (fork_fs_read_in_flight)
   TEST_ENTRY  (fork_socketpair)
   TEST_ENTRY  (fork_socketpair_started)
   TEST_ENTRY  (fork_signal_to_child)
@@ -284,6 +284,11 @@ TEST_IMPL(threadpool_cancel_fs) {
   unsigned n;
   uv_buf_t iov;
 
+  /* Requests that Linux runs on io_uring do not wait for the thread pool and
+   * cannot be cancelled.
+   */
+  ASSERT(0 == uv_os_setenv("UV_USE_IO_URING", "0"));
+
   INIT_CANCEL_INFO(&ci, reqs);
   loop = uv_default_loop();
   saturate_threadpool();
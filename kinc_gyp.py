@@ -18,6 +18,17 @@ gypi = {
 }
 
 gypi['sources'].append('src/krom/main.cpp')
+gypi['sources'].append('src/krom/block_compression.cpp')
+gypi['sources'].append('src/krom/compressed.cpp')
+gypi['sources'].append('src/krom/font.cpp')
+gypi['sources'].append('src/krom/jobs.cpp')
+gypi['sources'].append('src/krom/logger.cpp')
+gypi['sources'].append('src/krom/mipmaps.cpp')
+gypi['sources'].append('src/krom/processes.cpp')
+gypi['sources'].append('src/krom/render_state.cpp')
+gypi['sources'].append('src/krom/streaming.cpp')
+gypi['sources'].append('src/krom/streaming_policy.cpp')
+gypi['sources'].append('src/krom/vertices.cpp')
 for file in data['files']:
 	gypi['sources'].append(file.replace('\\', '/'))
 
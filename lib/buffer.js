@@ -55,6 +55,7 @@ const {
   compareOffset,
   createFromString,
   fill: bindingFill,
+  indexOfAny: _indexOfAny,
   indexOfBuffer,
   indexOfNumber,
   indexOfString,
@@ -969,6 +970,44 @@ Buffer.prototype.includes = function includes(val, byteOffset, encoding) {
   return this.indexOf(val, byteOffset, encoding) !== -1;
 };
 
+// Finds the first index in `this` at offset >= `byteOffset` at which any of
+// `values` occurs. Values are strings, Buffers, Uint8Arrays or numbers, like
+// the value of indexOf(), and all of them are searched for in one pass.
+Buffer.prototype.indexOfAny = function indexOfAny(values, byteOffset,
+                                                  encoding) {
+  validateArray(values, 'values');
+
+  if (typeof byteOffset === 'string') {
+    encoding = byteOffset;
+    byteOffset = undefined;
+  } else if (byteOffset > 0x7fffffff) {
+    byteOffset = 0x7fffffff;
+  } else if (byteOffset < -0x80000000) {
+    byteOffset = -0x80000000;
+  }
+  byteOffset = +byteOffset;
+  if (NumberIsNaN(byteOffset))
+    byteOffset = 0;
+
+  const needles = new Array(values.length);
+  for (let i = 0; i < values.length; i++) {
+    const val = values[i];
+    if (typeof val === 'string') {
+      needles[i] = Buffer.from(val, encoding);
+    } else if (typeof val === 'number') {
+      needles[i] = new FastBuffer(1);
+      needles[i][0] = val >>> 0;
+    } else if (isUint8Array(val)) {
+      needles[i] = val;
+    } else {
+      throw new ERR_INVALID_ARG_TYPE(
+        `values[${i}]`, ['number', 'string', 'Buffer', 'Uint8Array'], val
+      );
+    }
+  }
+  return _indexOfAny(this, needles, byteOffset);
+};
+
 // Usage:
 //    buffer.fill(number[, offset[, end]])
 //    buffer.fill(buffer[, offset[, end]])
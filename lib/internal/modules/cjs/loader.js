@@ -146,6 +146,9 @@ const relativeResolveCache = ObjectCreate(null);
 
 let requireDepth = 0;
 let statCache = null;
+// Counts the lifetimes of statCache. internalModuleStat() trusts directories
+// that it has checked during the same one.
+let statCachePass = 0;
 let isPreloading = false;
 
 function stat(filename) {
@@ -154,7 +157,8 @@ function stat(filename) {
     const result = statCache.get(filename);
     if (result !== undefined) return result;
   }
-  const result = internalModuleStat(filename);
+  const result = internalModuleStat(filename,
+                                    statCache !== null ? statCachePass : 0);
   if (statCache !== null && result >= 0) {
     // Only set cache when `internalModuleStat(filename)` succeeds.
     statCache.set(filename, result);
@@ -1089,7 +1093,10 @@ Module.prototype._compile = function(content, filename) {
   const exports = this.exports;
   const thisValue = exports;
   const module = this;
-  if (requireDepth === 0) statCache = new SafeMap();
+  if (requireDepth === 0) {
+    statCache = new SafeMap();
+    statCachePass++;
+  }
   if (inspectorWrapper) {
     result = inspectorWrapper(compiledWrapper, thisValue, exports,
                               require, module, filename, dirname);
@@ -142,6 +142,37 @@ const {
   getConstantLocationCompute,
   getTextureUnitCompute,
   compute,
+  getFilteredCallCount,
+  createSpriteBatcher,
+  deleteSpriteBatcher,
+  drawSprites,
+  createFont,
+  deleteFont,
+  getFontAtlas,
+  getFontMetrics,
+  getTextWidth,
+  layoutText,
+  getFontStats,
+  writeStorageAsync,
+  readStorageAsync,
+  fileSaveBytesAsync,
+  setLogRateLimit,
+  getLogStats,
+  getWasmCacheStats,
+  getMipmapStats,
+  getCompressedTextureStats,
+  transcodeImage,
+  acquireRenderTarget,
+  getRenderTargetPoolStats,
+  loadStreamingImage,
+  setStreamingHints,
+  setTextureBudget,
+  getStreamingStats,
+  sysCommandAsync,
+  setSysCommandLimit,
+  getSysCommandStats,
+  uploadVertexArrays,
+  getVertexPackStats,
   start
 } = internalBinding('krom');
 
@@ -287,5 +318,36 @@ module.exports = {
   getConstantLocationCompute,
   getTextureUnitCompute,
   compute,
+  getFilteredCallCount,
+  createSpriteBatcher,
+  deleteSpriteBatcher,
+  drawSprites,
+  createFont,
+  deleteFont,
+  getFontAtlas,
+  getFontMetrics,
+  getTextWidth,
+  layoutText,
+  getFontStats,
+  writeStorageAsync,
+  readStorageAsync,
+  fileSaveBytesAsync,
+  setLogRateLimit,
+  getLogStats,
+  getWasmCacheStats,
+  getMipmapStats,
+  getCompressedTextureStats,
+  transcodeImage,
+  acquireRenderTarget,
+  getRenderTargetPoolStats,
+  loadStreamingImage,
+  setStreamingHints,
+  setTextureBudget,
+  getStreamingStats,
+  sysCommandAsync,
+  setSysCommandLimit,
+  getSysCommandStats,
+  uploadVertexArrays,
+  getVertexPackStats,
   start
 };
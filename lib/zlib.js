@@ -71,11 +71,18 @@ const {
 const { owner_symbol } = require('internal/async_hooks').symbols;
 const {
   validateFunction,
+  validateInt32,
   validateNumber,
 } = require('internal/validators');
 
 const kFlushFlag = Symbol('kFlushFlag');
 const kError = Symbol('kError');
+const kParallelOptions = Symbol('kParallelOptions');
+
+// With the `threads` option, inputs that are larger than this are compressed
+// in blocks of this size, each on one of the threads.
+const kParallelBlockSize = 128 * 1024;
+const kMaxParallelThreads = 1024;
 
 const constants = internalBinding('constants').zlib;
 const {
@@ -119,6 +126,15 @@ function zlibBuffer(engine, buffer, callback) {
   } else if (isAnyArrayBuffer(buffer)) {
     buffer = Buffer.from(buffer);
   }
+  if (engine[kParallelOptions] !== undefined) {
+    if (typeof buffer === 'string')
+      buffer = Buffer.from(buffer);
+    if (isUint8Array(buffer) && buffer.byteLength > kParallelBlockSize) {
+      engine.cb = callback;
+      createParallelDeflate(engine).compress(buffer, engine._maxOutputLength);
+      return;
+    }
+  }
   engine.buffers = null;
   engine.nread = 0;
   engine.cb = callback;
@@ -175,12 +191,56 @@ function zlibBufferSync(engine, buffer) {
       );
     }
   }
-  buffer = processChunkSync(engine, buffer, engine._finishFlushFlag);
+  if (engine[kParallelOptions] !== undefined &&
+      buffer.byteLength > kParallelBlockSize) {
+    buffer = parallelDeflateSync(engine, buffer);
+  } else {
+    buffer = processChunkSync(engine, buffer, engine._finishFlushFlag);
+  }
   if (engine._info)
     return { buffer, engine };
   return buffer;
 }
 
+function createParallelDeflate(engine) {
+  const { mode, windowBits, memLevel, threads } = engine[kParallelOptions];
+  const handle = new binding.ParallelDeflate(mode,
+                                             engine._level,
+                                             windowBits,
+                                             memLevel,
+                                             engine._strategy,
+                                             kParallelBlockSize,
+                                             threads);
+  handle[owner_symbol] = engine;
+  handle.ondone = parallelDeflateOnDone;
+  return handle;
+}
+
+function parallelDeflateSync(engine, buffer) {
+  const result = createParallelDeflate(engine)
+    .compressSync(buffer, engine._maxOutputLength);
+  _close(engine);
+  if (typeof result === 'number') {
+    if (result === codes.Z_BUF_ERROR)
+      throw new ERR_BUFFER_TOO_LARGE(engine._maxOutputLength);
+    throw new ERR_ZLIB_INITIALIZATION_FAILED();
+  }
+  return result;
+}
+
+function parallelDeflateOnDone(result) {
+  const engine = this[owner_symbol];
+  engine.close();
+  if (result === codes.Z_BUF_ERROR)
+    engine.cb(new ERR_BUFFER_TOO_LARGE(engine._maxOutputLength));
+  else if (typeof result === 'number')
+    engine.cb(new ERR_ZLIB_INITIALIZATION_FAILED());
+  else if (engine._info)
+    engine.cb(null, { buffer: result, engine });
+  else
+    engine.cb(null, result);
+}
+
 function zlibOnError(message, errno, code) {
   const self = this[owner_symbol];
   // There is no way to cleanly recover.
@@ -633,6 +693,7 @@ function Zlib(opts, mode) {
   let memLevel = Z_DEFAULT_MEMLEVEL;
   let strategy = Z_DEFAULT_STRATEGY;
   let dictionary;
+  let threads = 1;
 
   if (opts) {
     // windowBits is special. On the compression side, 0 is an invalid value.
@@ -675,6 +736,11 @@ function Zlib(opts, mode) {
         );
       }
     }
+
+    if (opts.threads !== undefined) {
+      validateInt32(opts.threads, 'options.threads', 1, kMaxParallelThreads);
+      threads = opts.threads;
+    }
   }
 
   const handle = new binding.Zlib(mode);
@@ -694,6 +760,11 @@ function Zlib(opts, mode) {
 
   this._level = level;
   this._strategy = strategy;
+  // Blocks cannot be primed with a dictionary that is not part of the input.
+  if (threads > 1 && dictionary === undefined &&
+      (mode === DEFLATE || mode === GZIP || mode === DEFLATERAW)) {
+    this[kParallelOptions] = { mode, windowBits, memLevel, threads };
+  }
 }
 ObjectSetPrototypeOf(Zlib.prototype, ZlibBase.prototype);
 ObjectSetPrototypeOf(Zlib, ZlibBase);
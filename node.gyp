@@ -456,6 +456,7 @@
         'src/api/hooks.cc',
         'src/api/utils.cc',
         'src/async_wrap.cc',
+        'src/base64.cc',
         'src/cares_wrap.cc',
         'src/connect_wrap.cc',
         'src/connection_wrap.cc',
@@ -473,6 +474,7 @@
         'src/js_stream.cc',
         'src/json_utils.cc',
         'src/js_udp_wrap.cc',
+        'src/module_stat_cache.cc',
         'src/module_wrap.cc',
         'src/node.cc',
         'src/node_api.cc',
@@ -532,16 +534,19 @@
         'src/stream_wrap.cc',
         'src/string_bytes.cc',
         'src/string_decoder.cc',
+        'src/string_search.cc',
         'src/tcp_wrap.cc',
         'src/timers.cc',
         'src/timer_wrap.cc',
         'src/tracing/agent.cc',
         'src/tracing/node_trace_buffer.cc',
         'src/tracing/node_trace_writer.cc',
+        'src/tracing/perfetto_encoder.cc',
         'src/tracing/trace_event.cc',
         'src/tracing/traced_value.cc',
         'src/tty_wrap.cc',
         'src/udp_wrap.cc',
+        'src/utf8.cc',
         'src/util.cc',
         'src/uv.cc',
         # headers to make for a more pleasant IDE experience
@@ -573,7 +578,10 @@
         'src/large_pages/node_large_page.h',
         'src/memory_tracker.h',
         'src/memory_tracker-inl.h',
+        'src/module_stat_cache.h',
         'src/module_wrap.h',
+        'src/mpsc_queue.h',
+        'src/mpsc_queue-inl.h',
         'src/node.h',
         'src/node_api.h',
         'src/node_api_types.h',
@@ -641,6 +649,7 @@
         'src/tracing/agent.h',
         'src/tracing/node_trace_buffer.h',
         'src/tracing/node_trace_writer.h',
+        'src/tracing/perfetto_encoder.h',
         'src/tracing/trace_event.h',
         'src/tracing/trace_event_common.h',
         'src/tracing/traced_value.h',
@@ -648,6 +657,7 @@
         'src/timer_wrap-inl.h',
         'src/tty_wrap.h',
         'src/udp_wrap.h',
+        'src/utf8.h',
         'src/util.h',
         'src/util-inl.h',
         # Dependency headers
@@ -1212,10 +1222,18 @@
         'test/cctest/test_per_process.cc',
         'test/cctest/test_platform.cc',
         'test/cctest/test_json_utils.cc',
+        'test/cctest/test_krom_compressed.cc',
+        'test/cctest/test_krom_render_state.cc',
+        'test/cctest/test_krom_streaming.cc',
+        'test/cctest/test_module_stat_cache.cc',
+        'test/cctest/test_mpsc_queue.cc',
         'test/cctest/test_sockaddr.cc',
+        'test/cctest/test_string_search.cc',
+        'test/cctest/test_trace_buffer.cc',
         'test/cctest/test_traced_value.cc',
         'test/cctest/test_util.cc',
         'test/cctest/test_url.cc',
+        'test/cctest/test_utf8.cc',
       ],
 
       'conditions': [
@@ -68,7 +68,18 @@ size_t base64_decode_fast(char* const dst, const size_t dstlen,
   size_t max_i = srclen / 4 * 4;
   size_t i = 0;
   size_t k = 0;
+  // The vectorized kernel takes over again after every group the scalar code
+  // had to decode slowly, so that line breaks in wrapped input only cost the
+  // groups around them. Two-byte strings always take the scalar path.
+  bool vectorize = sizeof(TypeName) == 1;
   while (i < max_i && k < max_k) {
+    if (vectorize) {
+      base64_decode_simd(dst, max_k, reinterpret_cast<const char*>(src), max_i,
+                         &i, &k);
+      vectorize = false;
+      if (i >= max_i || k >= max_k)
+        break;
+    }
     const unsigned char txt[] = {
         static_cast<unsigned char>(unbase64(static_cast<uint8_t>(src[i + 0]))),
         static_cast<unsigned char>(unbase64(static_cast<uint8_t>(src[i + 1]))),
@@ -82,6 +93,7 @@ size_t base64_decode_fast(char* const dst, const size_t dstlen,
       if (!base64_decode_group_slow(dst, dstlen, src, srclen, &i, &k))
         return k;
       max_i = i + (srclen - i) / 4 * 4;  // Align max_i again.
+      vectorize = sizeof(TypeName) == 1;
     } else {
       dst[k + 0] = ((v >> 22) & 0xFC) | ((v >> 20) & 0x03);
       dst[k + 1] = ((v >> 12) & 0xF0) | ((v >> 10) & 0x0F);
@@ -140,9 +152,9 @@ inline size_t base64_encode(const char* src,
 
   const char* table = base64_select_table(mode);
 
-  i = 0;
-  k = 0;
   n = slen / 3 * 3;
+  i = static_cast<unsigned>(base64_encode_simd(src, slen, dst, mode));
+  k = i / 3 * 4;
 
   while (i < n) {
     a = src[i + 0] & 0xff;
@@ -0,0 +1,382 @@
+#include "base64-inl.h"
+
+#include <cstring>
+
+// GCC and clang compile the x86 kernels for their instruction sets through
+// target attributes and check the CPU at runtime. Other compilers use the
+// scalar code on x86. AArch64 always has NEON.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NODE_BASE64_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define NODE_BASE64_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace node {
+
+namespace {
+
+#ifdef NODE_BASE64_X86
+
+#define SSSE3_TARGET __attribute__((target("ssse3")))
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+// Spreads the 12 bytes at the start of each 16 byte lane over 16 bytes with
+// one 6 bit index each, as described by Wojciech Muła in "Base64 encoding with
+// SIMD instructions".
+#define BASE64_SPLIT(bits, prefix, suffix)                                     \
+  prefix##_or_##suffix(                                                        \
+      prefix##_mulhi_epu16(                                                    \
+          prefix##_and_##suffix(bits, prefix##_set1_epi32(0x0fc0fc00)),        \
+          prefix##_set1_epi32(0x04000040)),                                    \
+      prefix##_mullo_epi16(                                                    \
+          prefix##_and_##suffix(bits, prefix##_set1_epi32(0x003f03f0)),        \
+          prefix##_set1_epi32(0x01000010)))
+
+// Indices 0-25 map to 13, 26-51 to 0, 52-61 to 1-10, 62 to 11 and 63 to 12,
+// which select what has to be added to the index to get its character.
+SSSE3_TARGET inline __m128i EncodeOffsets(Base64Mode mode) {
+  const char c62 = mode == Base64Mode::URL ? '-' : '+';
+  const char c63 = mode == Base64Mode::URL ? '_' : '/';
+  return _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                       '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                       '0' - 52, c62 - 62, c63 - 63, 'A', 0, 0);
+}
+
+SSSE3_TARGET size_t EncodeSSSE3(const char* src, size_t slen, char* dst,
+                                Base64Mode mode) {
+  const __m128i spread = _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4,
+                                       7, 6, 8, 7, 10, 9, 11, 10);
+  const __m128i offsets = EncodeOffsets(mode);
+  size_t i = 0;
+  size_t k = 0;
+  // Loads 16 bytes to encode 12 of them.
+  while (i + 16 <= slen) {
+    const __m128i in =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    const __m128i indices =
+        BASE64_SPLIT(_mm_shuffle_epi8(in, spread), _mm, si128);
+    __m128i offset = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    offset = _mm_or_si128(
+        offset,
+        _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indices),
+                      _mm_set1_epi8(13)));
+    const __m128i out =
+        _mm_add_epi8(_mm_shuffle_epi8(offsets, offset), indices);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + k), out);
+    i += 12;
+    k += 16;
+  }
+  return i;
+}
+
+AVX2_TARGET size_t EncodeAVX2(const char* src, size_t slen, char* dst,
+                              Base64Mode mode) {
+  const __m256i spread = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4,
+                                          7, 6, 8, 7, 10, 9, 11, 10,
+                                          1, 0, 2, 1, 4, 3, 5, 4,
+                                          7, 6, 8, 7, 10, 9, 11, 10);
+  const __m256i offsets = _mm256_broadcastsi128_si256(EncodeOffsets(mode));
+  size_t i = 0;
+  size_t k = 0;
+  // Loads 28 bytes to encode 24 of them, 12 per lane.
+  while (i + 28 <= slen) {
+    const __m128i lo =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    const __m128i hi =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 12));
+    const __m256i in =
+        _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+    const __m256i indices =
+        BASE64_SPLIT(_mm256_shuffle_epi8(in, spread), _mm256, si256);
+    __m256i offset = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    offset = _mm256_or_si256(
+        offset,
+        _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices),
+                         _mm256_set1_epi8(13)));
+    const __m256i out =
+        _mm256_add_epi8(_mm256_shuffle_epi8(offsets, offset), indices);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + k), out);
+    i += 24;
+    k += 32;
+  }
+  return i;
+}
+
+#undef BASE64_SPLIT
+
+// Maps the characters of both alphabets to their values, the same as
+// unbase64_table. Whitespace, '=' and everything else make the block invalid.
+#define BASE64_VALUES(c, values, valid, prefix, suffix)                        \
+  do {                                                                         \
+    const auto upper = prefix##_sub_epi8(c, prefix##_set1_epi8('A'));          \
+    const auto lower = prefix##_sub_epi8(c, prefix##_set1_epi8('a'));          \
+    const auto digit = prefix##_sub_epi8(c, prefix##_set1_epi8('0'));          \
+    const auto is_upper = prefix##_cmpeq_epi8(                                 \
+        prefix##_min_epu8(upper, prefix##_set1_epi8(25)), upper);              \
+    const auto is_lower = prefix##_cmpeq_epi8(                                 \
+        prefix##_min_epu8(lower, prefix##_set1_epi8(25)), lower);              \
+    const auto is_digit = prefix##_cmpeq_epi8(                                 \
+        prefix##_min_epu8(digit, prefix##_set1_epi8(9)), digit);               \
+    const auto is_62 =                                                         \
+        prefix##_or_##suffix(prefix##_cmpeq_epi8(c, prefix##_set1_epi8('+')),  \
+                             prefix##_cmpeq_epi8(c, prefix##_set1_epi8('-'))); \
+    const auto is_63 =                                                         \
+        prefix##_or_##suffix(prefix##_cmpeq_epi8(c, prefix##_set1_epi8('/')),  \
+                             prefix##_cmpeq_epi8(c, prefix##_set1_epi8('_'))); \
+    values = prefix##_and_##suffix(is_upper, upper);                           \
+    values = prefix##_or_##suffix(                                             \
+        values,                                                                \
+        prefix##_and_##suffix(                                                 \
+            is_lower, prefix##_add_epi8(lower, prefix##_set1_epi8(26))));      \
+    values = prefix##_or_##suffix(                                             \
+        values,                                                                \
+        prefix##_and_##suffix(                                                 \
+            is_digit, prefix##_add_epi8(digit, prefix##_set1_epi8(52))));      \
+    values = prefix##_or_##suffix(                                             \
+        values, prefix##_and_##suffix(is_62, prefix##_set1_epi8(62)));         \
+    values = prefix##_or_##suffix(                                             \
+        values, prefix##_and_##suffix(is_63, prefix##_set1_epi8(63)));         \
+    valid = prefix##_or_##suffix(                                              \
+        prefix##_or_##suffix(prefix##_or_##suffix(is_upper, is_lower),         \
+                             prefix##_or_##suffix(is_digit, is_62)),           \
+        is_63);                                                                \
+  } while (0)
+
+// Joins four 6 bit values into three bytes in the low 12 bytes of each lane.
+#define BASE64_PACK(values, prefix)                                            \
+  prefix##_shuffle_epi8(                                                       \
+      prefix##_madd_epi16(                                                     \
+          prefix##_maddubs_epi16(values, prefix##_set1_epi32(0x01400140)),     \
+          prefix##_set1_epi32(0x00011000)),                                    \
+      pack)
+
+SSSE3_TARGET void DecodeSSSE3(char* const dst, const size_t dstlen,
+                              const char* const src, const size_t srclen,
+                              size_t* const i, size_t* const k) {
+  const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                     -1, -1, -1, -1);
+  while (*i + 16 <= srclen && *k + 12 <= dstlen) {
+    const __m128i c =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + *i));
+    __m128i values;
+    __m128i valid;
+    BASE64_VALUES(c, values, valid, _mm, si128);
+    if (_mm_movemask_epi8(valid) != 0xffff)
+      return;
+    const __m128i out = BASE64_PACK(values, _mm);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + *k), out);
+    const uint32_t tail = _mm_cvtsi128_si32(_mm_srli_si128(out, 8));
+    memcpy(dst + *k + 8, &tail, sizeof(tail));
+    *i += 16;
+    *k += 12;
+  }
+}
+
+AVX2_TARGET void DecodeAVX2(char* const dst, const size_t dstlen,
+                            const char* const src, const size_t srclen,
+                            size_t* const i, size_t* const k) {
+  const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                        -1, -1, -1, -1,
+                                        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                        -1, -1, -1, -1);
+  const __m256i compact = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+  while (*i + 32 <= srclen && *k + 24 <= dstlen) {
+    const __m256i c =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + *i));
+    __m256i values;
+    __m256i valid;
+    BASE64_VALUES(c, values, valid, _mm256, si256);
+    if (static_cast<uint32_t>(_mm256_movemask_epi8(valid)) != 0xffffffff)
+      return;
+    const __m256i out =
+        _mm256_permutevar8x32_epi32(BASE64_PACK(values, _mm256), compact);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + *k),
+                     _mm256_castsi256_si128(out));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + *k + 16),
+                     _mm256_extracti128_si256(out, 1));
+    *i += 32;
+    *k += 24;
+  }
+}
+
+#undef BASE64_VALUES
+#undef BASE64_PACK
+#undef SSSE3_TARGET
+#undef AVX2_TARGET
+
+#endif  // NODE_BASE64_X86
+
+#ifdef NODE_BASE64_NEON
+
+size_t EncodeNEON(const char* src, size_t slen, char* dst, Base64Mode mode) {
+  const uint8_t* table =
+      reinterpret_cast<const uint8_t*>(base64_select_table(mode));
+  uint8x16x4_t lookup;
+  lookup.val[0] = vld1q_u8(table);
+  lookup.val[1] = vld1q_u8(table + 16);
+  lookup.val[2] = vld1q_u8(table + 32);
+  lookup.val[3] = vld1q_u8(table + 48);
+  const uint8x16_t mask = vdupq_n_u8(0x3f);
+  size_t i = 0;
+  size_t k = 0;
+  while (i + 48 <= slen) {
+    const uint8x16x3_t in = vld3q_u8(reinterpret_cast<const uint8_t*>(src + i));
+    uint8x16x4_t out;
+    out.val[0] = vshrq_n_u8(in.val[0], 2);
+    out.val[1] = vandq_u8(
+        vorrq_u8(vshlq_n_u8(in.val[0], 4), vshrq_n_u8(in.val[1], 4)), mask);
+    out.val[2] = vandq_u8(
+        vorrq_u8(vshlq_n_u8(in.val[1], 2), vshrq_n_u8(in.val[2], 6)), mask);
+    out.val[3] = vandq_u8(in.val[2], mask);
+    for (int j = 0; j < 4; j++)
+      out.val[j] = vqtbl4q_u8(lookup, out.val[j]);
+    vst4q_u8(reinterpret_cast<uint8_t*>(dst + k), out);
+    i += 48;
+    k += 64;
+  }
+  return i;
+}
+
+// Maps the characters of both alphabets to their values, the same as
+// unbase64_table, and sets the lanes of *valid that hold one of them.
+inline uint8x16_t DecodeValuesNEON(uint8x16_t c, uint8x16_t* valid) {
+  const uint8x16_t upper = vsubq_u8(c, vdupq_n_u8('A'));
+  const uint8x16_t lower = vsubq_u8(c, vdupq_n_u8('a'));
+  const uint8x16_t digit = vsubq_u8(c, vdupq_n_u8('0'));
+  const uint8x16_t is_upper = vcleq_u8(upper, vdupq_n_u8(25));
+  const uint8x16_t is_lower = vcleq_u8(lower, vdupq_n_u8(25));
+  const uint8x16_t is_digit = vcleq_u8(digit, vdupq_n_u8(9));
+  const uint8x16_t is_62 = vorrq_u8(vceqq_u8(c, vdupq_n_u8('+')),
+                                    vceqq_u8(c, vdupq_n_u8('-')));
+  const uint8x16_t is_63 = vorrq_u8(vceqq_u8(c, vdupq_n_u8('/')),
+                                    vceqq_u8(c, vdupq_n_u8('_')));
+  uint8x16_t values = vandq_u8(is_upper, upper);
+  values = vorrq_u8(values,
+                    vandq_u8(is_lower, vaddq_u8(lower, vdupq_n_u8(26))));
+  values = vorrq_u8(values,
+                    vandq_u8(is_digit, vaddq_u8(digit, vdupq_n_u8(52))));
+  values = vorrq_u8(values, vandq_u8(is_62, vdupq_n_u8(62)));
+  values = vorrq_u8(values, vandq_u8(is_63, vdupq_n_u8(63)));
+  *valid = vandq_u8(*valid,
+                    vorrq_u8(vorrq_u8(vorrq_u8(is_upper, is_lower),
+                                      vorrq_u8(is_digit, is_62)),
+                             is_63));
+  return values;
+}
+
+void DecodeNEON(char* const dst, const size_t dstlen,
+                const char* const src, const size_t srclen,
+                size_t* const i, size_t* const k) {
+  while (*i + 64 <= srclen && *k + 48 <= dstlen) {
+    const uint8x16x4_t in =
+        vld4q_u8(reinterpret_cast<const uint8_t*>(src + *i));
+    uint8x16_t valid = vdupq_n_u8(0xff);
+    const uint8x16_t a = DecodeValuesNEON(in.val[0], &valid);
+    const uint8x16_t b = DecodeValuesNEON(in.val[1], &valid);
+    const uint8x16_t c = DecodeValuesNEON(in.val[2], &valid);
+    const uint8x16_t d = DecodeValuesNEON(in.val[3], &valid);
+    if (vminvq_u8(valid) != 0xff)
+      return;
+    uint8x16x3_t out;
+    out.val[0] = vorrq_u8(vshlq_n_u8(a, 2), vshrq_n_u8(b, 4));
+    out.val[1] = vorrq_u8(vshlq_n_u8(b, 4), vshrq_n_u8(c, 2));
+    out.val[2] = vorrq_u8(vshlq_n_u8(c, 6), d);
+    vst3q_u8(reinterpret_cast<uint8_t*>(dst + *k), out);
+    *i += 64;
+    *k += 48;
+  }
+}
+
+#endif  // NODE_BASE64_NEON
+
+Base64Kernel BestKernel() {
+  if (base64_kernel_supported(Base64Kernel::AVX2))
+    return Base64Kernel::AVX2;
+  if (base64_kernel_supported(Base64Kernel::SSSE3))
+    return Base64Kernel::SSSE3;
+  if (base64_kernel_supported(Base64Kernel::NEON))
+    return Base64Kernel::NEON;
+  return Base64Kernel::SCALAR;
+}
+
+Base64Kernel selected_kernel = BestKernel();
+
+}  // anonymous namespace
+
+bool base64_kernel_supported(Base64Kernel kernel) {
+  switch (kernel) {
+    case Base64Kernel::SCALAR:
+      return true;
+#ifdef NODE_BASE64_X86
+    case Base64Kernel::SSSE3:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("ssse3");
+    case Base64Kernel::AVX2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2");
+#endif
+#ifdef NODE_BASE64_NEON
+    case Base64Kernel::NEON:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+Base64Kernel base64_kernel() {
+  return selected_kernel;
+}
+
+void base64_set_kernel(Base64Kernel kernel) {
+  CHECK(base64_kernel_supported(kernel));
+  selected_kernel = kernel;
+}
+
+size_t base64_encode_simd(const char* src, size_t slen, char* dst,
+                          Base64Mode mode) {
+  switch (selected_kernel) {
+#ifdef NODE_BASE64_X86
+    case Base64Kernel::AVX2: {
+      // The 16 byte kernel picks up what is left of the 24 byte blocks.
+      const size_t i = EncodeAVX2(src, slen, dst, mode);
+      return i + EncodeSSSE3(src + i, slen - i, dst + i / 3 * 4, mode);
+    }
+    case Base64Kernel::SSSE3:
+      return EncodeSSSE3(src, slen, dst, mode);
+#endif
+#ifdef NODE_BASE64_NEON
+    case Base64Kernel::NEON:
+      return EncodeNEON(src, slen, dst, mode);
+#endif
+    default:
+      return 0;
+  }
+}
+
+void base64_decode_simd(char* const dst, const size_t dstlen,
+                        const char* const src, const size_t srclen,
+                        size_t* const i, size_t* const k) {
+  switch (selected_kernel) {
+#ifdef NODE_BASE64_X86
+    case Base64Kernel::AVX2:
+      DecodeAVX2(dst, dstlen, src, srclen, i, k);
+      DecodeSSSE3(dst, dstlen, src, srclen, i, k);
+      break;
+    case Base64Kernel::SSSE3:
+      DecodeSSSE3(dst, dstlen, src, srclen, i, k);
+      break;
+#endif
+#ifdef NODE_BASE64_NEON
+    case Base64Kernel::NEON:
+      DecodeNEON(dst, dstlen, src, srclen, i, k);
+      break;
+#endif
+    default:
+      break;
+  }
+}
+
+}  // namespace node
@@ -61,6 +61,34 @@ inline size_t base64_encode(const char* src,
                             char* dst,
                             size_t dlen,
                             Base64Mode mode = Base64Mode::NORMAL);
+
+// Vectorized kernels for the bulk of long inputs, see base64.cc. The best one
+// the CPU supports is picked at startup. Tests switch between them to compare
+// their results with the scalar code.
+enum class Base64Kernel {
+  SCALAR,
+  SSSE3,
+  AVX2,
+  NEON
+};
+
+bool base64_kernel_supported(Base64Kernel kernel);
+Base64Kernel base64_kernel();
+void base64_set_kernel(Base64Kernel kernel);
+
+// Encodes whole blocks of src, never reading past src + slen, and returns how
+// many bytes of src it consumed, a multiple of 3. The scalar code encodes the
+// rest.
+size_t base64_encode_simd(const char* src, size_t slen, char* dst,
+                          Base64Mode mode);
+
+// Decodes whole blocks of src for as long as they consist of base64
+// characters only, without writing past dst + dstlen. Advances *i and *k like
+// base64_decode_group_slow; whitespace, padding and invalid characters are
+// left to the scalar code.
+void base64_decode_simd(char* const dst, const size_t dstlen,
+                        const char* const src, const size_t srclen,
+                        size_t* const i, size_t* const k);
 }  // namespace node
 
 
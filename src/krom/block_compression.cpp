@@ -0,0 +1,657 @@
+#include "block_compression.h"
+
+#include <string.h>
+
+namespace {
+	const int maxDimension = 1 << 16; // way beyond what GPUs take, keeps sizes far from overflowing
+
+	uint32_t readU32(const uint8_t *data) {
+		uint32_t value;
+		memcpy(&value, data, 4);
+		return value;
+	}
+
+	uint64_t readU64(const uint8_t *data) {
+		uint64_t value;
+		memcpy(&value, data, 8);
+		return value;
+	}
+
+	void setFormat(KromCompressedImage *image, KromBlockFormat format, bool srgb) {
+		image->format = format;
+		image->srgb = srgb;
+		image->blockWidth = 4;
+		image->blockHeight = 4;
+		image->blockSize = format == KROM_BLOCK_BC1 || format == KROM_BLOCK_BC4 || format == KROM_BLOCK_ETC2_RGB || format == KROM_BLOCK_ETC2_RGBA1 ? 8 : 16;
+	}
+
+	size_t levelSize(const KromCompressedImage *image, int width, int height) {
+		size_t blocksX = ((size_t)width + image->blockWidth - 1) / image->blockWidth;
+		size_t blocksY = ((size_t)height + image->blockHeight - 1) / image->blockHeight;
+		return blocksX * blocksY * image->blockSize;
+	}
+
+	bool parseDds(const uint8_t *data, size_t size, KromCompressedImage *image) {
+		if (size < 128 || readU32(&data[4]) != 124) {
+			return false;
+		}
+		const uint8_t *header = &data[4];
+		int height = (int)readU32(&header[8]);
+		int width = (int)readU32(&header[12]);
+		int depth = (int)readU32(&header[20]);
+		int levelCount = (int)readU32(&header[24]);
+		uint32_t pixelFlags = readU32(&header[76]);
+		const uint8_t *fourCC = &header[80];
+		uint32_t caps2 = readU32(&header[108]);
+		size_t offset = 128;
+
+		const uint32_t fourCCFlag = 0x4, cubemapFlag = 0x200, volumeFlag = 0x200000;
+		if ((pixelFlags & fourCCFlag) == 0 || (caps2 & (cubemapFlag | volumeFlag)) != 0 || depth > 1) {
+			return false;
+		}
+		if (width < 1 || height < 1 || width > maxDimension || height > maxDimension) {
+			return false;
+		}
+
+		if (memcmp(fourCC, "DX10", 4) == 0) {
+			// DDS_HEADER_DXT10: dxgiFormat, resourceDimension, miscFlag, arraySize, miscFlags2
+			const uint32_t texture2D = 3, textureCubeFlag = 0x4;
+			if (size < 148 || readU32(&data[132]) != texture2D || (readU32(&data[136]) & textureCubeFlag) != 0 || readU32(&data[140]) > 1) {
+				return false;
+			}
+			switch (readU32(&data[128])) {
+			case 71: setFormat(image, KROM_BLOCK_BC1, false); break;
+			case 72: setFormat(image, KROM_BLOCK_BC1, true); break;
+			case 74: setFormat(image, KROM_BLOCK_BC2, false); break;
+			case 75: setFormat(image, KROM_BLOCK_BC2, true); break;
+			case 77: setFormat(image, KROM_BLOCK_BC3, false); break;
+			case 78: setFormat(image, KROM_BLOCK_BC3, true); break;
+			case 80: setFormat(image, KROM_BLOCK_BC4, false); break;
+			case 83: setFormat(image, KROM_BLOCK_BC5, false); break;
+			case 98: setFormat(image, KROM_BLOCK_BC7, false); break;
+			case 99: setFormat(image, KROM_BLOCK_BC7, true); break;
+			default: return false;
+			}
+			offset = 148;
+		}
+		else if (memcmp(fourCC, "DXT1", 4) == 0) {
+			setFormat(image, KROM_BLOCK_BC1, false);
+		}
+		else if (memcmp(fourCC, "DXT3", 4) == 0) {
+			setFormat(image, KROM_BLOCK_BC2, false);
+		}
+		else if (memcmp(fourCC, "DXT5", 4) == 0) {
+			setFormat(image, KROM_BLOCK_BC3, false);
+		}
+		else if (memcmp(fourCC, "ATI1", 4) == 0 || memcmp(fourCC, "BC4U", 4) == 0) {
+			setFormat(image, KROM_BLOCK_BC4, false);
+		}
+		else if (memcmp(fourCC, "ATI2", 4) == 0 || memcmp(fourCC, "BC5U", 4) == 0) {
+			setFormat(image, KROM_BLOCK_BC5, false);
+		}
+		else {
+			return false;
+		}
+
+		image->width = width;
+		image->height = height;
+		image->levelCount = levelCount < 1 ? 1 : (levelCount > maxCompressedLevels ? maxCompressedLevels : levelCount);
+		for (int i = 0; i < image->levelCount; ++i) {
+			KromCompressedLevel *level = &image->levels[i];
+			level->width = width > 1 ? width : 1;
+			level->height = height > 1 ? height : 1;
+			level->size = levelSize(image, level->width, level->height);
+			if (offset + level->size > size) {
+				if (i == 0) {
+					return false;
+				}
+				image->levelCount = i;
+				break;
+			}
+			level->data = &data[offset];
+			offset += level->size;
+			width /= 2;
+			height /= 2;
+		}
+		return true;
+	}
+
+	bool parseKtx2(const uint8_t *data, size_t size, KromCompressedImage *image) {
+		if (size < 80) {
+			return false;
+		}
+		uint32_t vkFormat = readU32(&data[12]);
+		int width = (int)readU32(&data[20]);
+		int height = (int)readU32(&data[24]);
+		uint32_t depth = readU32(&data[28]);
+		uint32_t layerCount = readU32(&data[32]);
+		uint32_t faceCount = readU32(&data[36]);
+		uint32_t levelCount = readU32(&data[40]);
+		uint32_t supercompression = readU32(&data[44]);
+		if (depth > 1 || layerCount > 1 || faceCount != 1 || supercompression != 0) {
+			return false;
+		}
+		if (width < 1 || height < 1 || width > maxDimension || height > maxDimension) {
+			return false;
+		}
+
+		// ASTC formats come in unorm/srgb pairs from 157 on, in this order of block sizes
+		static const int astcBlocks[][2] = {{4, 4}, {5, 4}, {5, 5}, {6, 5}, {6, 6}, {8, 5}, {8, 6}, {8, 8}, {10, 5}, {10, 6}, {10, 8}, {10, 10}, {12, 10}, {12, 12}};
+		if (vkFormat >= 157 && vkFormat <= 184) {
+			setFormat(image, KROM_BLOCK_ASTC, (vkFormat - 157) % 2 == 1);
+			image->blockWidth = astcBlocks[(vkFormat - 157) / 2][0];
+			image->blockHeight = astcBlocks[(vkFormat - 157) / 2][1];
+		}
+		else {
+			switch (vkFormat) {
+			case 131: case 133: setFormat(image, KROM_BLOCK_BC1, false); break;
+			case 132: case 134: setFormat(image, KROM_BLOCK_BC1, true); break;
+			case 135: setFormat(image, KROM_BLOCK_BC2, false); break;
+			case 136: setFormat(image, KROM_BLOCK_BC2, true); break;
+			case 137: setFormat(image, KROM_BLOCK_BC3, false); break;
+			case 138: setFormat(image, KROM_BLOCK_BC3, true); break;
+			case 139: setFormat(image, KROM_BLOCK_BC4, false); break;
+			case 141: setFormat(image, KROM_BLOCK_BC5, false); break;
+			case 145: setFormat(image, KROM_BLOCK_BC7, false); break;
+			case 146: setFormat(image, KROM_BLOCK_BC7, true); break;
+			case 147: setFormat(image, KROM_BLOCK_ETC2_RGB, false); break;
+			case 148: setFormat(image, KROM_BLOCK_ETC2_RGB, true); break;
+			case 149: setFormat(image, KROM_BLOCK_ETC2_RGBA1, false); break;
+			case 150: setFormat(image, KROM_BLOCK_ETC2_RGBA1, true); break;
+			case 151: setFormat(image, KROM_BLOCK_ETC2_RGBA, false); break;
+			case 152: setFormat(image, KROM_BLOCK_ETC2_RGBA, true); break;
+			default: return false;
+			}
+		}
+
+		image->width = width;
+		image->height = height;
+		image->levelCount = levelCount < 1 ? 1 : (levelCount > maxCompressedLevels ? maxCompressedLevels : (int)levelCount);
+		if (80 + (size_t)image->levelCount * 24 > size) {
+			return false;
+		}
+		for (int i = 0; i < image->levelCount; ++i) {
+			KromCompressedLevel *level = &image->levels[i];
+			uint64_t offset = readU64(&data[80 + i * 24]);
+			uint64_t length = readU64(&data[80 + i * 24 + 8]);
+			level->width = width > 1 ? width : 1;
+			level->height = height > 1 ? height : 1;
+			level->size = levelSize(image, level->width, level->height);
+			if (length < level->size || offset > size || length > size - offset) {
+				if (i == 0) {
+					return false;
+				}
+				image->levelCount = i;
+				break;
+			}
+			level->data = &data[offset];
+			width /= 2;
+			height /= 2;
+		}
+		return true;
+	}
+
+	// BC1 to BC5
+
+	void decodeColorBlock(const uint8_t *block, uint8_t *out, bool alwaysFourColors) {
+		uint16_t c0 = block[0] | (block[1] << 8);
+		uint16_t c1 = block[2] | (block[3] << 8);
+		uint8_t colors[4][4];
+		for (int i = 0; i < 2; ++i) {
+			uint16_t c = i == 0 ? c0 : c1;
+			int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+			colors[i][0] = (uint8_t)((r << 3) | (r >> 2));
+			colors[i][1] = (uint8_t)((g << 2) | (g >> 4));
+			colors[i][2] = (uint8_t)((b << 3) | (b >> 2));
+			colors[i][3] = 255;
+		}
+		for (int c = 0; c < 3; ++c) {
+			if (alwaysFourColors || c0 > c1) {
+				colors[2][c] = (uint8_t)((2 * colors[0][c] + colors[1][c]) / 3);
+				colors[3][c] = (uint8_t)((colors[0][c] + 2 * colors[1][c]) / 3);
+			}
+			else {
+				colors[2][c] = (uint8_t)((colors[0][c] + colors[1][c]) / 2);
+				colors[3][c] = 0;
+			}
+		}
+		colors[2][3] = 255;
+		colors[3][3] = alwaysFourColors || c0 > c1 ? 255 : 0;
+
+		uint32_t indices = readU32(&block[4]);
+		for (int i = 0; i < 16; ++i) {
+			memcpy(&out[i * 4], colors[(indices >> (i * 2)) & 3], 4);
+		}
+	}
+
+	// The BC3 alpha block, also used for the channels of BC4 and BC5
+	void decodeChannelBlock(const uint8_t *block, uint8_t *out, int stride) {
+		int a0 = block[0], a1 = block[1];
+		uint8_t values[8];
+		values[0] = (uint8_t)a0;
+		values[1] = (uint8_t)a1;
+		if (a0 > a1) {
+			for (int i = 1; i < 7; ++i) {
+				values[i + 1] = (uint8_t)(((7 - i) * a0 + i * a1) / 7);
+			}
+		}
+		else {
+			for (int i = 1; i < 5; ++i) {
+				values[i + 1] = (uint8_t)(((5 - i) * a0 + i * a1) / 5);
+			}
+			values[6] = 0;
+			values[7] = 255;
+		}
+		uint64_t indices = 0;
+		for (int i = 0; i < 6; ++i) {
+			indices |= (uint64_t)block[2 + i] << (i * 8);
+		}
+		for (int i = 0; i < 16; ++i) {
+			out[i * stride] = values[(indices >> (i * 3)) & 7];
+		}
+	}
+
+	// BC7
+
+	struct BitReader {
+		const uint8_t *data;
+		int position;
+
+		uint32_t read(int bits) {
+			uint32_t value = 0;
+			for (int i = 0; i < bits; ++i, ++position) {
+				value |= (uint32_t)((data[position >> 3] >> (position & 7)) & 1) << i;
+			}
+			return value;
+		}
+	};
+
+	struct Bc7Mode {
+		int subsets, partitionBits, rotationBits, indexSelectionBits, colorBits, alphaBits, endpointPBits, sharedPBits, indexBits, secondaryIndexBits;
+	};
+
+	const Bc7Mode bc7Modes[8] = {{3, 4, 0, 0, 4, 0, 1, 0, 3, 0}, {2, 6, 0, 0, 6, 0, 0, 1, 3, 0}, {3, 6, 0, 0, 5, 0, 0, 0, 2, 0},
+	                             {2, 6, 0, 0, 7, 0, 1, 0, 2, 0}, {1, 0, 2, 1, 5, 6, 0, 0, 2, 3}, {1, 0, 2, 0, 7, 8, 0, 0, 2, 2},
+	                             {1, 0, 0, 0, 7, 7, 1, 0, 4, 0}, {2, 6, 0, 0, 5, 5, 1, 0, 2, 0}};
+
+	// One bit per pixel, set for subset 1
+	const uint16_t bc7Partitions2[64] = {0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80, 0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8,
+	                                     0xff00, 0xfff0, 0xf000, 0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce, 0x088c, 0x3110,
+	                                     0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c, 0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696,
+	                                     0xa55a, 0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660, 0x0272, 0x04e4, 0x4e40, 0x2720,
+	                                     0xc936, 0x936c, 0x39c6, 0x639c, 0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22};
+
+	const uint8_t bc7Partitions3[64][16] = {
+	    {0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 1, 2, 2, 2, 2}, {0, 0, 0, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 2, 1}, {0, 0, 0, 0, 2, 0, 0, 1, 2, 2, 1, 1, 2, 2, 1, 1},
+	    {0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 1, 0, 1, 1, 1}, {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2}, {0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 2, 2},
+	    {0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1}, {0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1}, {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2},
+	    {0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2}, {0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2}, {0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2},
+	    {0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2}, {0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2}, {0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2, 1, 2, 2, 2},
+	    {0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0, 2, 2, 2, 0}, {0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2}, {0, 1, 1, 1, 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0},
+	    {0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2}, {0, 0, 2, 2, 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1}, {0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2, 0, 2, 2, 2},
+	    {0, 0, 0, 1, 0, 0, 0, 1, 2, 2, 2, 1, 2, 2, 2, 1}, {0, 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2}, {0, 0, 0, 0, 1, 1, 0, 0, 2, 2, 1, 0, 2, 2, 1, 0},
+	    {0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1, 0, 0, 0, 0}, {0, 0, 1, 2, 0, 0, 1, 2, 1, 1, 2, 2, 2, 2, 2, 2}, {0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1, 0, 1, 1, 0},
+	    {0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1}, {0, 0, 2, 2, 1, 1, 0, 2, 1, 1, 0, 2, 0, 0, 2, 2}, {0, 1, 1, 0, 0, 1, 1, 0, 2, 0, 0, 2, 2, 2, 2, 2},
+	    {0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1}, {0, 0, 0, 0, 2, 0, 0, 0, 2, 2, 1, 1, 2, 2, 2, 1}, {0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 2, 2, 2},
+	    {0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 2, 0, 0, 1, 1}, {0, 0, 1, 1, 0, 0, 1, 2, 0, 0, 2, 2, 0, 2, 2, 2}, {0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0},
+	    {0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0}, {0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0}, {0, 1, 2, 0, 2, 0, 1, 2, 1, 2, 0, 1, 0, 1, 2, 0},
+	    {0, 0, 1, 1, 2, 2, 0, 0, 1, 1, 2, 2, 0, 0, 1, 1}, {0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0, 1, 1}, {0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2},
+	    {0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1}, {0, 0, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2, 1, 1, 2, 2}, {0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 1, 1},
+	    {0, 2, 2, 0, 1, 2, 2, 1, 0, 2, 2, 0, 1, 2, 2, 1}, {0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 0, 1, 0, 1}, {0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1},
+	    {0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2}, {0, 2, 2, 2, 0, 1, 1, 1, 0, 2, 2, 2, 0, 1, 1, 1}, {0, 0, 0, 2, 1, 1, 1, 2, 0, 0, 0, 2, 1, 1, 1, 2},
+	    {0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2}, {0, 2, 2, 2, 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2}, {0, 0, 0, 2, 1, 1, 1, 2, 1, 1, 1, 2, 0, 0, 0, 2},
+	    {0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2}, {0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2}, {0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2, 2, 2, 2, 2},
+	    {0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2}, {0, 0, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2}, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2},
+	    {0, 0, 0, 2, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 1}, {0, 2, 2, 2, 1, 2, 2, 2, 0, 2, 2, 2, 1, 2, 2, 2}, {0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2},
+	    {0, 1, 1, 1, 2, 0, 1, 1, 2, 2, 0, 1, 2, 2, 2, 0}};
+
+	const uint8_t bc7Anchors2[64] = {15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+	                                 15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6, 6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15};
+	const uint8_t bc7Anchors3a[64] = {3, 3, 15, 15, 8, 3, 15, 15, 8, 8, 6, 6, 6, 5, 3, 3, 3, 3, 8, 15, 3, 3, 6, 10, 5, 8, 8, 6, 8, 5, 15, 15,
+	                                  8, 15, 3, 5, 6, 10, 8, 15, 15, 3, 15, 5, 15, 15, 15, 15, 3, 15, 5, 5, 5, 8, 5, 10, 5, 10, 8, 13, 15, 12, 3, 3};
+	const uint8_t bc7Anchors3b[64] = {15, 8, 8, 3, 15, 15, 3, 8, 15, 15, 15, 15, 15, 15, 15, 8, 15, 8, 15, 3, 15, 8, 15, 8, 3, 15, 6, 10, 15, 15, 10, 8,
+	                                  15, 3, 15, 10, 10, 8, 9, 10, 6, 15, 8, 15, 3, 6, 6, 8, 15, 3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 3, 15, 15, 8};
+
+	const uint8_t bc7Weights2[4] = {0, 21, 43, 64};
+	const uint8_t bc7Weights3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+	const uint8_t bc7Weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+	uint8_t bc7Interpolate(int e0, int e1, int index, int bits) {
+		int weight = bits == 2 ? bc7Weights2[index] : (bits == 3 ? bc7Weights3[index] : bc7Weights4[index]);
+		return (uint8_t)(((64 - weight) * e0 + weight * e1 + 32) >> 6);
+	}
+
+	void decodeBc7Block(const uint8_t *block, uint8_t *out) {
+		int modeIndex = 0;
+		while (modeIndex < 8 && (block[0] & (1 << modeIndex)) == 0) {
+			++modeIndex;
+		}
+		if (modeIndex == 8) {
+			memset(out, 0, 64); // reserved, decodes to transparent black
+			return;
+		}
+		const Bc7Mode &mode = bc7Modes[modeIndex];
+		BitReader bits = {block, modeIndex + 1};
+		int partition = bits.read(mode.partitionBits);
+		int rotation = bits.read(mode.rotationBits);
+		int indexSelection = bits.read(mode.indexSelectionBits);
+
+		int endpoints[3][2][4]; // subset, endpoint, channel
+		for (int c = 0; c < 3; ++c) {
+			for (int s = 0; s < mode.subsets; ++s) {
+				endpoints[s][0][c] = bits.read(mode.colorBits);
+				endpoints[s][1][c] = bits.read(mode.colorBits);
+			}
+		}
+		for (int s = 0; s < mode.subsets; ++s) {
+			endpoints[s][0][3] = mode.alphaBits > 0 ? bits.read(mode.alphaBits) : 255;
+			endpoints[s][1][3] = mode.alphaBits > 0 ? bits.read(mode.alphaBits) : 255;
+		}
+
+		int pBits[3][2] = {};
+		if (mode.endpointPBits) {
+			for (int s = 0; s < mode.subsets; ++s) {
+				pBits[s][0] = bits.read(1);
+				pBits[s][1] = bits.read(1);
+			}
+		}
+		else if (mode.sharedPBits) {
+			for (int s = 0; s < mode.subsets; ++s) {
+				pBits[s][0] = pBits[s][1] = bits.read(1);
+			}
+		}
+		bool hasPBits = mode.endpointPBits || mode.sharedPBits;
+		for (int s = 0; s < mode.subsets; ++s) {
+			for (int e = 0; e < 2; ++e) {
+				for (int c = 0; c < 4; ++c) {
+					int precision = c < 3 ? mode.colorBits : mode.alphaBits;
+					if (precision == 0) {
+						continue;
+					}
+					int value = endpoints[s][e][c];
+					if (hasPBits) {
+						value = (value << 1) | pBits[s][e];
+						++precision;
+					}
+					value <<= 8 - precision;
+					endpoints[s][e][c] = value | (value >> precision);
+				}
+			}
+		}
+
+		uint8_t subsetOf[16];
+		uint8_t anchors[3] = {0, 0, 0};
+		for (int i = 0; i < 16; ++i) {
+			subsetOf[i] = mode.subsets == 1 ? 0 : (mode.subsets == 2 ? (bc7Partitions2[partition] >> i) & 1 : bc7Partitions3[partition][i]);
+		}
+		if (mode.subsets == 2) {
+			anchors[1] = bc7Anchors2[partition];
+		}
+		else if (mode.subsets == 3) {
+			anchors[1] = bc7Anchors3a[partition];
+			anchors[2] = bc7Anchors3b[partition];
+		}
+
+		int indices[16], secondaryIndices[16];
+		for (int i = 0; i < 16; ++i) {
+			bool anchor = i == anchors[subsetOf[i]];
+			indices[i] = bits.read(anchor ? mode.indexBits - 1 : mode.indexBits);
+		}
+		if (mode.secondaryIndexBits > 0) {
+			for (int i = 0; i < 16; ++i) {
+				secondaryIndices[i] = bits.read(i == 0 ? mode.secondaryIndexBits - 1 : mode.secondaryIndexBits);
+			}
+		}
+
+		for (int i = 0; i < 16; ++i) {
+			const int(*e)[4] = endpoints[subsetOf[i]];
+			uint8_t *pixel = &out[i * 4];
+			if (mode.secondaryIndexBits > 0) {
+				int colorIndex = indexSelection ? secondaryIndices[i] : indices[i];
+				int colorBits = indexSelection ? mode.secondaryIndexBits : mode.indexBits;
+				int alphaIndex = indexSelection ? indices[i] : secondaryIndices[i];
+				int alphaBits = indexSelection ? mode.indexBits : mode.secondaryIndexBits;
+				for (int c = 0; c < 3; ++c) {
+					pixel[c] = bc7Interpolate(e[0][c], e[1][c], colorIndex, colorBits);
+				}
+				pixel[3] = bc7Interpolate(e[0][3], e[1][3], alphaIndex, alphaBits);
+			}
+			else {
+				for (int c = 0; c < 4; ++c) {
+					pixel[c] = bc7Interpolate(e[0][c], e[1][c], indices[i], mode.indexBits);
+				}
+			}
+			if (rotation > 0) {
+				uint8_t swap = pixel[3];
+				pixel[3] = pixel[rotation - 1];
+				pixel[rotation - 1] = swap;
+			}
+		}
+	}
+
+	// ETC2
+
+	const int etcModifiers[8][4] = {{2, 8, -2, -8},       {5, 17, -5, -17},     {9, 29, -9, -29},     {13, 42, -13, -42},
+	                                {18, 60, -18, -60},   {24, 80, -24, -80},   {33, 106, -33, -106}, {47, 183, -47, -183}};
+	const int etcDistances[8] = {3, 6, 11, 16, 23, 32, 41, 64};
+
+	const int eacModifiers[16][8] = {{-3, -6, -9, -15, 2, 5, 8, 14}, {-3, -7, -10, -13, 2, 6, 9, 12}, {-2, -5, -8, -13, 1, 4, 7, 12},
+	                                 {-2, -4, -6, -13, 1, 3, 5, 12}, {-3, -6, -8, -12, 2, 5, 7, 11}, {-3, -7, -9, -11, 2, 6, 8, 10},
+	                                 {-4, -7, -8, -11, 3, 6, 7, 10}, {-3, -5, -8, -11, 2, 4, 7, 10}, {-2, -6, -8, -10, 1, 5, 7, 9},
+	                                 {-2, -5, -8, -10, 1, 4, 7, 9},  {-2, -4, -8, -10, 1, 3, 7, 9},  {-2, -5, -7, -10, 1, 4, 6, 9},
+	                                 {-3, -4, -7, -10, 2, 3, 6, 9},  {-1, -2, -3, -10, 0, 1, 2, 9},  {-4, -6, -8, -9, 3, 5, 7, 8},
+	                                 {-3, -5, -7, -9, 2, 4, 6, 8}};
+
+	uint8_t clampByte(int value) {
+		return (uint8_t)(value < 0 ? 0 : (value > 255 ? 255 : value));
+	}
+
+	int extend4(int value) {
+		return (value << 4) | value;
+	}
+
+	int extend5(int value) {
+		return (value << 3) | (value >> 2);
+	}
+
+	// Pixel indices are stored column by column, out is row by row
+	void setEtcPixel(uint8_t *out, int index, int r, int g, int b, int a) {
+		uint8_t *pixel = &out[((index & 3) * 4 + (index >> 2)) * 4];
+		pixel[0] = clampByte(r);
+		pixel[1] = clampByte(g);
+		pixel[2] = clampByte(b);
+		pixel[3] = (uint8_t)a;
+	}
+
+	void decodeEtc2Block(const uint8_t *block, uint8_t *out, bool punchthrough) {
+		uint64_t bits = 0;
+		for (int i = 0; i < 8; ++i) {
+			bits = (bits << 8) | block[i];
+		}
+		uint32_t pixelBits = (uint32_t)bits;
+		// With punchthrough alpha the bit that usually picks differential mode says whether the block is opaque instead
+		bool differential = punchthrough || (block[3] & 2) != 0;
+		bool opaque = !punchthrough || (block[3] & 2) != 0;
+
+		int base[2][3];
+		if (!differential) {
+			for (int c = 0; c < 3; ++c) {
+				base[0][c] = extend4(block[c] >> 4);
+				base[1][c] = extend4(block[c] & 0xf);
+			}
+		}
+		else {
+			int sums[3];
+			for (int c = 0; c < 3; ++c) {
+				int value = block[c] >> 3;
+				int delta = (block[c] & 7) >= 4 ? (block[c] & 7) - 8 : (block[c] & 7);
+				sums[c] = value + delta;
+				base[0][c] = extend5(value);
+				base[1][c] = extend5(sums[c] & 31);
+			}
+
+			if (sums[0] < 0 || sums[0] > 31) { // T mode
+				int colors[2][3] = {{extend4(((block[0] >> 1) & 0xc) | (block[0] & 3)), extend4(block[1] >> 4), extend4(block[1] & 0xf)},
+				                    {extend4(block[2] >> 4), extend4(block[2] & 0xf), extend4(block[3] >> 4)}};
+				int distance = etcDistances[((block[3] >> 1) & 6) | (block[3] & 1)];
+				int paints[4][3];
+				for (int c = 0; c < 3; ++c) {
+					paints[0][c] = colors[0][c];
+					paints[1][c] = colors[1][c] + distance;
+					paints[2][c] = colors[1][c];
+					paints[3][c] = colors[1][c] - distance;
+				}
+				for (int i = 0; i < 16; ++i) {
+					int index = (((pixelBits >> (i + 16)) & 1) << 1) | ((pixelBits >> i) & 1);
+					if (!opaque && index == 2) {
+						setEtcPixel(out, i, 0, 0, 0, 0);
+					}
+					else {
+						setEtcPixel(out, i, paints[index][0], paints[index][1], paints[index][2], 255);
+					}
+				}
+				return;
+			}
+			if (sums[1] < 0 || sums[1] > 31) { // H mode
+				int r0 = (block[0] >> 3) & 0xf;
+				int g0 = ((block[0] & 7) << 1) | ((block[1] >> 4) & 1);
+				int b0 = (block[1] & 8) | ((block[1] & 3) << 1) | (block[2] >> 7);
+				int r1 = (block[2] >> 3) & 0xf;
+				int g1 = ((block[2] & 7) << 1) | (block[3] >> 7);
+				int b1 = (block[3] >> 3) & 0xf;
+				int order = ((r0 << 8) | (g0 << 4) | b0) >= ((r1 << 8) | (g1 << 4) | b1) ? 1 : 0;
+				int distance = etcDistances[(block[3] & 4) | ((block[3] & 1) << 1) | order];
+				int colors[2][3] = {{extend4(r0), extend4(g0), extend4(b0)}, {extend4(r1), extend4(g1), extend4(b1)}};
+				int paints[4][3];
+				for (int c = 0; c < 3; ++c) {
+					paints[0][c] = colors[0][c] + distance;
+					paints[1][c] = colors[0][c] - distance;
+					paints[2][c] = colors[1][c] + distance;
+					paints[3][c] = colors[1][c] - distance;
+				}
+				for (int i = 0; i < 16; ++i) {
+					int index = (((pixelBits >> (i + 16)) & 1) << 1) | ((pixelBits >> i) & 1);
+					if (!opaque && index == 2) {
+						setEtcPixel(out, i, 0, 0, 0, 0);
+					}
+					else {
+						setEtcPixel(out, i, paints[index][0], paints[index][1], paints[index][2], 255);
+					}
+				}
+				return;
+			}
+			if (sums[2] < 0 || sums[2] > 31) { // planar mode, always opaque
+				int ro = (int)((bits >> 57) & 63);
+				int go = (int)((((bits >> 56) & 1) << 6) | ((bits >> 49) & 63));
+				int bo = (int)((((bits >> 48) & 1) << 5) | (((bits >> 43) & 3) << 3) | ((bits >> 39) & 7));
+				int rh = (int)((((bits >> 34) & 31) << 1) | ((bits >> 32) & 1));
+				int gh = (int)((bits >> 25) & 127);
+				int bh = (int)((bits >> 19) & 63);
+				int rv = (int)((bits >> 13) & 63);
+				int gv = (int)((bits >> 6) & 127);
+				int bv = (int)(bits & 63);
+				int origin[3] = {(ro << 2) | (ro >> 4), (go << 1) | (go >> 6), (bo << 2) | (bo >> 4)};
+				int horizontal[3] = {(rh << 2) | (rh >> 4), (gh << 1) | (gh >> 6), (bh << 2) | (bh >> 4)};
+				int vertical[3] = {(rv << 2) | (rv >> 4), (gv << 1) | (gv >> 6), (bv << 2) | (bv >> 4)};
+				for (int y = 0; y < 4; ++y) {
+					for (int x = 0; x < 4; ++x) {
+						uint8_t *pixel = &out[(y * 4 + x) * 4];
+						for (int c = 0; c < 3; ++c) {
+							pixel[c] = clampByte((x * (horizontal[c] - origin[c]) + y * (vertical[c] - origin[c]) + 4 * origin[c] + 2) >> 2);
+						}
+						pixel[3] = 255;
+					}
+				}
+				return;
+			}
+		}
+
+		int tables[2] = {block[3] >> 5, (block[3] >> 2) & 7};
+		bool flip = (block[3] & 1) != 0;
+		for (int i = 0; i < 16; ++i) {
+			int x = i >> 2, y = i & 3;
+			int subblock = flip ? (y >= 2 ? 1 : 0) : (x >= 2 ? 1 : 0);
+			int index = (((pixelBits >> (i + 16)) & 1) << 1) | ((pixelBits >> i) & 1);
+			if (!opaque && index == 2) {
+				setEtcPixel(out, i, 0, 0, 0, 0);
+				continue;
+			}
+			int modifier = !opaque && index == 0 ? 0 : etcModifiers[tables[subblock]][index];
+			setEtcPixel(out, i, base[subblock][0] + modifier, base[subblock][1] + modifier, base[subblock][2] + modifier, 255);
+		}
+	}
+
+	void decodeEacAlphaBlock(const uint8_t *block, uint8_t *out) {
+		int base = block[0];
+		int multiplier = block[1] >> 4;
+		const int *modifiers = eacModifiers[block[1] & 0xf];
+		uint64_t indices = 0;
+		for (int i = 2; i < 8; ++i) {
+			indices = (indices << 8) | block[i];
+		}
+		for (int i = 0; i < 16; ++i) {
+			int index = (int)((indices >> (45 - i * 3)) & 7);
+			out[((i & 3) * 4 + (i >> 2)) * 4 + 3] = clampByte(base + modifiers[index] * multiplier);
+		}
+	}
+}
+
+bool parseCompressedImage(const uint8_t *data, size_t size, KromCompressedImage *image) {
+	static const uint8_t ktx2Identifier[12] = {0xab, 'K', 'T', 'X', ' ', '2', '0', 0xbb, '\r', '\n', 0x1a, '\n'};
+	if (size >= 4 && memcmp(data, "DDS ", 4) == 0) {
+		return parseDds(data, size, image) && image->width > 0 && image->height > 0;
+	}
+	if (size >= 12 && memcmp(data, ktx2Identifier, 12) == 0) {
+		return parseKtx2(data, size, image) && image->width > 0 && image->height > 0;
+	}
+	return false;
+}
+
+void decodeCompressedBlock(KromBlockFormat format, const uint8_t *block, uint8_t *out) {
+	switch (format) {
+	case KROM_BLOCK_BC1:
+		decodeColorBlock(block, out, false);
+		break;
+	case KROM_BLOCK_BC2:
+		decodeColorBlock(&block[8], out, true);
+		for (int i = 0; i < 16; ++i) {
+			int alpha = (block[i / 2] >> ((i & 1) * 4)) & 0xf;
+			out[i * 4 + 3] = (uint8_t)(alpha * 17);
+		}
+		break;
+	case KROM_BLOCK_BC3:
+		decodeColorBlock(&block[8], out, true);
+		decodeChannelBlock(block, &out[3], 4);
+		break;
+	case KROM_BLOCK_BC4:
+		decodeChannelBlock(block, out, 4);
+		for (int i = 0; i < 16; ++i) {
+			out[i * 4 + 1] = out[i * 4 + 2] = out[i * 4];
+			out[i * 4 + 3] = 255;
+		}
+		break;
+	case KROM_BLOCK_BC5:
+		decodeChannelBlock(block, out, 4);
+		decodeChannelBlock(&block[8], &out[1], 4);
+		for (int i = 0; i < 16; ++i) {
+			out[i * 4 + 2] = 0;
+			out[i * 4 + 3] = 255;
+		}
+		break;
+	case KROM_BLOCK_BC7:
+		decodeBc7Block(block, out);
+		break;
+	case KROM_BLOCK_ETC2_RGB:
+		decodeEtc2Block(block, out, false);
+		break;
+	case KROM_BLOCK_ETC2_RGBA1:
+		decodeEtc2Block(block, out, true);
+		break;
+	case KROM_BLOCK_ETC2_RGBA:
+		decodeEtc2Block(&block[8], out, false);
+		decodeEacAlphaBlock(block, out);
+		break;
+	case KROM_BLOCK_ASTC:
+		break;
+	}
+}
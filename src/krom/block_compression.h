@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// DDS and KTX2 parsing and the CPU block decoders, kept free of any graphics code so they can be tested.
+
+enum KromBlockFormat {
+	KROM_BLOCK_BC1,
+	KROM_BLOCK_BC2,
+	KROM_BLOCK_BC3,
+	KROM_BLOCK_BC4,
+	KROM_BLOCK_BC5,
+	KROM_BLOCK_BC7,
+	KROM_BLOCK_ETC2_RGB,
+	KROM_BLOCK_ETC2_RGBA1,
+	KROM_BLOCK_ETC2_RGBA,
+	KROM_BLOCK_ASTC
+};
+
+const int maxCompressedLevels = 16;
+
+struct KromCompressedLevel {
+	const uint8_t *data; // points into the container
+	size_t size;
+	int width, height;
+};
+
+struct KromCompressedImage {
+	KromBlockFormat format;
+	int blockWidth, blockHeight, blockSize;
+	bool srgb;
+	int width, height;
+	int levelCount;
+	KromCompressedLevel levels[maxCompressedLevels];
+};
+
+// Parses a DDS or KTX2 container without copying anything. Only single 2D images with a block compressed format
+// and no supercompression are accepted, false is returned for everything else.
+bool parseCompressedImage(const uint8_t *data, size_t size, KromCompressedImage *image);
+
+// Decodes one block of a 4x4 format to 16 RGBA32 pixels, row by row. ASTC blocks are left alone.
+void decodeCompressedBlock(KromBlockFormat format, const uint8_t *block, uint8_t *out);
@@ -0,0 +1,173 @@
+#include "compressed.h"
+
+#include "jobs.h"
+
+#include <kinc/io/filereader.h>
+#include <kinc/log.h>
+#include <kinc/system.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+	const int blockRowsPerChunk = 16;
+
+	KromCompressedStats stats = {};
+
+	struct TranscodeJob {
+		const KromCompressedImage *image;
+		const KromCompressedLevel *level;
+		uint8_t *pixels;
+	};
+
+	void transcodeBlockRows(void *data, int first, int last) {
+		const TranscodeJob *job = (const TranscodeJob *)data;
+		const KromCompressedLevel *level = job->level;
+		int blocksX = (level->width + 3) / 4;
+		uint8_t decoded[64];
+		for (int by = first; by < last; ++by) {
+			for (int bx = 0; bx < blocksX; ++bx) {
+				decodeCompressedBlock(job->image->format, &level->data[((size_t)by * blocksX + bx) * job->image->blockSize], decoded);
+				// Blocks hang over the edges of levels that are not a multiple of 4
+				int width = level->width - bx * 4 < 4 ? level->width - bx * 4 : 4;
+				int height = level->height - by * 4 < 4 ? level->height - by * 4 : 4;
+				for (int y = 0; y < height; ++y) {
+					memcpy(&job->pixels[(((size_t)by * 4 + y) * level->width + bx * 4) * 4], &decoded[y * 16], width * 4);
+				}
+			}
+		}
+	}
+
+	bool nativeCompression(const KromCompressedImage *image, kinc_image_compression_t *compression, unsigned *internalFormat) {
+#if defined(KORE_OPENGL) && defined(KORE_WINDOWS)
+		if (image->format == KROM_BLOCK_BC3) {
+			*compression = KINC_IMAGE_COMPRESSION_DXT5;
+			*internalFormat = 0;
+			return true;
+		}
+#endif
+#if defined(KORE_OPENGL) && (defined(KORE_ANDROID) || defined(KORE_IOS))
+		if (image->format == KROM_BLOCK_ASTC) {
+			*compression = KINC_IMAGE_COMPRESSION_ASTC;
+			*internalFormat = (image->blockWidth << 8) | image->blockHeight;
+			return true;
+		}
+#endif
+		return false;
+	}
+}
+
+bool isCompressedImageFile(const char *filename) {
+	size_t length = strlen(filename);
+	return (length > 4 && strcmp(&filename[length - 4], ".dds") == 0) || (length > 5 && strcmp(&filename[length - 5], ".ktx2") == 0);
+}
+
+
+bool transcodeCompressedLevel(const KromCompressedImage *image, int level, uint8_t *pixels) {
+	if (image->format == KROM_BLOCK_ASTC) {
+		return false;
+	}
+	TranscodeJob job;
+	job.image = image;
+	job.level = &image->levels[level];
+	job.pixels = pixels;
+	parallelFor((job.level->height + 3) / 4, blockRowsPerChunk, transcodeBlockRows, &job);
+	return true;
+}
+
+bool loadCompressedTexture(const char *filename, kinc_g4_texture_t *texture, kinc_image_t *image, bool readable, size_t *textureSize) {
+	double start = kinc_time();
+	kinc_file_reader_t reader;
+	if (!kinc_file_reader_open(&reader, filename, KINC_FILE_TYPE_ASSET)) {
+		kinc_log(KINC_LOG_LEVEL_WARNING, "Could not open %s.", filename);
+		return false;
+	}
+	size_t size = kinc_file_reader_size(&reader);
+	uint8_t *data = (uint8_t *)malloc(size);
+	kinc_file_reader_read(&reader, data, size);
+	kinc_file_reader_close(&reader);
+
+	KromCompressedImage compressed;
+	if (!parseCompressedImage(data, size, &compressed)) {
+		kinc_log(KINC_LOG_LEVEL_WARNING, "%s is not a 2D block compressed image Krom can load.", filename);
+		free(data);
+		return false;
+	}
+	stats.fileBytes += (double)size;
+	stats.loadSeconds += kinc_time() - start;
+
+	kinc_image_compression_t compression;
+	unsigned internalFormat;
+	if (nativeCompression(&compressed, &compression, &internalFormat)) {
+		// The blocks are uploaded straight from the file, kinc_g4_texture_set_mipmap only takes uncompressed levels so the rest of the chain is left out
+		kinc_image_t blocks;
+		memset(&blocks, 0, sizeof(blocks));
+		blocks.width = compressed.width;
+		blocks.height = compressed.height;
+		blocks.depth = 1;
+		blocks.format = KINC_IMAGE_FORMAT_RGBA32;
+		blocks.compression = compression;
+		blocks.internal_format = internalFormat;
+		blocks.data = (void *)compressed.levels[0].data;
+		blocks.data_size = (int)compressed.levels[0].size;
+		kinc_g4_texture_init_from_image(texture, &blocks);
+
+		*textureSize = compressed.levels[0].size;
+		stats.nativeTextures += 1;
+		stats.gpuBytes += (double)*textureSize;
+
+		// Decoded only when the pixels are asked for
+		size_t pixelSize = (size_t)compressed.width * compressed.height * 4;
+		uint8_t *pixels = readable ? (uint8_t *)malloc(pixelSize) : nullptr;
+		if (pixels != nullptr && !transcodeCompressedLevel(&compressed, 0, pixels)) {
+			memset(pixels, 0, pixelSize);
+		}
+		kinc_image_init_from_bytes(image, pixels, compressed.width, compressed.height, KINC_IMAGE_FORMAT_RGBA32);
+		free(data);
+		return true;
+	}
+
+	if (compressed.format == KROM_BLOCK_ASTC) {
+		kinc_log(KINC_LOG_LEVEL_WARNING, "%s is ASTC compressed, which this graphics backend does not support.", filename);
+		free(data);
+		return false;
+	}
+
+	start = kinc_time();
+	uint8_t *levels[maxCompressedLevels];
+	for (int i = 0; i < compressed.levelCount; ++i) {
+		levels[i] = (uint8_t *)malloc((size_t)compressed.levels[i].width * compressed.levels[i].height * 4);
+		transcodeCompressedLevel(&compressed, i, levels[i]);
+	}
+	stats.transcodeSeconds += kinc_time() - start;
+	free(data);
+
+	kinc_image_init_from_bytes(image, levels[0], compressed.width, compressed.height, KINC_IMAGE_FORMAT_RGBA32);
+	kinc_g4_texture_init_from_image(texture, image);
+	*textureSize = (size_t)compressed.width * compressed.height * 4;
+	// Padded textures can not take the chain, see generateMipmapChain
+	if (texture->tex_width == compressed.width && texture->tex_height == compressed.height) {
+		for (int i = 1; i < compressed.levelCount; ++i) {
+			kinc_image_t mipmap;
+			kinc_image_init_from_bytes(&mipmap, levels[i], compressed.levels[i].width, compressed.levels[i].height, KINC_IMAGE_FORMAT_RGBA32);
+			kinc_g4_texture_set_mipmap(texture, &mipmap, i);
+			kinc_image_destroy(&mipmap);
+			*textureSize += (size_t)compressed.levels[i].width * compressed.levels[i].height * 4;
+		}
+	}
+	for (int i = 1; i < compressed.levelCount; ++i) {
+		free(levels[i]);
+	}
+	if (!readable) {
+		free(levels[0]);
+		image->data = nullptr;
+	}
+
+	stats.transcodedTextures += 1;
+	stats.gpuBytes += (double)*textureSize;
+	return true;
+}
+
+void compressedStats(KromCompressedStats *out) {
+	*out = stats;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <kinc/graphics4/texture.h>
+#include <kinc/image.h>
+
+#include "block_compression.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Whether filename ends in .dds or .ktx2
+bool isCompressedImageFile(const char *filename);
+
+// Decodes one level to RGBA32, split across the job pool. pixels needs room for width * height * 4 bytes.
+// Returns false when there is no CPU decoder for the format (ASTC).
+bool transcodeCompressedLevel(const KromCompressedImage *image, int level, uint8_t *pixels);
+
+// Loads a .dds or .ktx2 file into texture. The blocks go to the backend as they are when it supports the format and are decoded
+// to RGBA32 otherwise. When readable, image receives level 0 as RGBA32 with data allocated by malloc, otherwise only its size and format.
+// textureSize receives the bytes the texture takes on the GPU. Returns false when the file could not be loaded.
+bool loadCompressedTexture(const char *filename, kinc_g4_texture_t *texture, kinc_image_t *image, bool readable, size_t *textureSize);
+
+struct KromCompressedStats {
+	int nativeTextures;
+	int transcodedTextures;
+	double fileBytes;       // as the containers were read
+	double gpuBytes;        // as uploaded, after any decoding
+	double loadSeconds;     // reading and parsing
+	double transcodeSeconds;
+};
+
+void compressedStats(KromCompressedStats *stats);
@@ -10,10 +10,6 @@
 #include <assert.h>
 #include <vector>
 
-#ifndef KORE_WINDOWS
-#include <unistd.h>
-#endif
-
 namespace {
 	void CHAKRA_CALLBACK debugCallback(JsDiagDebugEvent debugEvent, JsValueRef eventData, void *callbackState) {
 		if (debugEvent == JsDiagDebugEventBreakpoint || debugEvent == JsDiagDebugEventAsyncBreak || debugEvent == JsDiagDebugEventStepComplete ||
@@ -24,15 +20,10 @@ namespace {
 			sendMessage(&message, 1);
 
 			for (;;) {
-				Message message = receiveMessage();
+				Message message = waitForMessage();
 				if (handleDebugMessage(message, true)) {
 					break;
 				}
-#ifdef KORE_WINDOWS
-				Sleep(100);
-#else
-				usleep(100 * 1000);
-#endif
 			}
 		}
 		else if (debugEvent == JsDiagDebugEventCompileError) {
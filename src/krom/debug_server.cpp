@@ -2,6 +2,7 @@
 #include "pch.h"
 
 #include <kinc/log.h>
+#include <kinc/threads/event.h>
 #include <kinc/threads/mutex.h>
 #include <kinc/threads/thread.h>
 
@@ -13,6 +14,7 @@
 #include <string.h>
 #include <time.h>
 
+#include <deque>
 #include <vector>
 
 #ifdef KORE_WINDOWS
@@ -22,6 +24,7 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -34,13 +37,14 @@ namespace {
 	int PORT = 0;
 
 	kinc_mutex_t mutex;
-	std::vector<Message> queuedMessages;
-	volatile int step = 0;
+	kinc_event_t messageEvent;
+	std::deque<Message> queuedMessages;
 
+	kinc_mutex_t sendMutex;
 #ifdef KORE_WINDOWS
-	SOCKET client_socket;
+	SOCKET client_socket = INVALID_SOCKET;
 #else
-	int client_socket;
+	int client_socket = -1;
 #endif
 
 	static void error_exit(const char *error_message) {
@@ -52,23 +56,61 @@ namespace {
 		exit(EXIT_FAILURE);
 	}
 
+#ifdef KORE_WINDOWS
+	bool receiveAll(SOCKET socket, char *data, int size)
+#else
+	bool receiveAll(int socket, char *data, int size)
+#endif
+	{
+		while (size > 0) {
+			int received = recv(socket, data, size, 0);
+			if (received <= 0) {
+				return false;
+			}
+			data += received;
+			size -= received;
+		}
+		return true;
+	}
+
+	// Every packet is a little endian uint32 byte count followed by the payload, incoming payloads are int32 arrays
 #ifdef KORE_WINDOWS
 	void echo(SOCKET client_socket)
 #else
 	void echo(int client_socket)
 #endif
 	{
+		kinc_mutex_lock(&sendMutex);
 		::client_socket = client_socket;
+		kinc_mutex_unlock(&sendMutex);
 		for (;;) {
+			uint32_t length;
+			if (!receiveAll(client_socket, (char *)&length, sizeof(length))) {
+				break;
+			}
 			Message message;
-			if ((message.size = recv(client_socket, (char *)message.data, RCVBUFSIZE, 0)) < 0) {
-				error_exit("recv() error");
+			if (length > sizeof(message.data) || length % sizeof(int) != 0) {
+				kinc_log(KINC_LOG_LEVEL_WARNING, "Dropping debugger connection after a malformed packet of %u bytes.", length);
+				break;
+			}
+			if (!receiveAll(client_socket, (char *)message.data, length)) {
+				break;
 			}
+			message.size = length / sizeof(int);
 
 			kinc_mutex_lock(&mutex);
 			queuedMessages.push_back(message);
 			kinc_mutex_unlock(&mutex);
+			kinc_event_signal(&messageEvent);
 		}
+		kinc_mutex_lock(&sendMutex);
+#ifdef KORE_WINDOWS
+		::client_socket = INVALID_SOCKET;
+#else
+		::client_socket = -1;
+#endif
+		kinc_mutex_unlock(&sendMutex);
+		kinc_log(KINC_LOG_LEVEL_INFO, "Debugger disconnected");
 	}
 
 	void startServerInThread(void *) {
@@ -103,6 +145,11 @@ namespace {
 			fd = accept(sock, (struct sockaddr *)&client, &len);
 			if (fd < 0) error_exit("accept() error");
 			kinc_log(KINC_LOG_LEVEL_INFO, "Data from address: %s", inet_ntoa(client.sin_addr));
+
+			// Replies are small and latency bound
+			int noDelay = 1;
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char *)&noDelay, sizeof(noDelay));
+
 			echo(fd);
 
 #ifdef KORE_WINDOWS
@@ -113,32 +160,83 @@ namespace {
 		}
 	}
 
-	int lastMessage[1024 * 1024];
+	bool sendAll(const char *data, size_t size) {
+		while (size > 0) {
+			int sent = send(client_socket, data, (int)size, 0);
+			if (sent <= 0) {
+				return false;
+			}
+			data += sent;
+			size -= sent;
+		}
+		return true;
+	}
+
+	void sendPacket(const char *data, size_t size) {
+		uint32_t length = (uint32_t)size;
+		kinc_mutex_lock(&sendMutex);
+#ifdef KORE_WINDOWS
+		bool connected = client_socket != INVALID_SOCKET;
+#else
+		bool connected = client_socket >= 0;
+#endif
+		if (connected && sendAll((const char *)&length, sizeof(length))) {
+			sendAll(data, size);
+		}
+		kinc_mutex_unlock(&sendMutex);
+	}
+}
+
+void OutgoingMessage::writeInt(int value) {
+	size_t offset = data.size();
+	data.resize(offset + sizeof(value));
+	memcpy(&data[offset], &value, sizeof(value));
+}
+
+void OutgoingMessage::writeString(const char *text, size_t length) {
+	writeInt((int)length);
+	data.insert(data.end(), text, text + length);
 }
 
 void sendMessage(int *data, int size) {
-	send(client_socket, (char *)data, size * 4, 0);
+	sendPacket((const char *)data, size * sizeof(int));
+}
+
+void sendMessage(const OutgoingMessage &message) {
+	sendPacket(message.data.data(), message.data.size());
 }
 
 Message receiveMessage() {
 	kinc_mutex_lock(&mutex);
-	if (queuedMessages.size() < 1) {
+	if (queuedMessages.empty()) {
 		kinc_mutex_unlock(&mutex);
 		Message message;
 		message.size = 0;
 		return message;
 	}
 	else {
-		Message message = queuedMessages[0];
-		queuedMessages.erase(queuedMessages.begin());
+		Message message = queuedMessages.front();
+		queuedMessages.pop_front();
 		kinc_mutex_unlock(&mutex);
 		return message;
 	}
 }
 
+Message waitForMessage() {
+	for (;;) {
+		Message message = receiveMessage();
+		if (message.size > 0) {
+			return message;
+		}
+		kinc_event_wait(&messageEvent);
+	}
+}
+
 void startServer(int port) {
 	PORT = port;
 	kinc_mutex_init(&mutex);
+	kinc_mutex_init(&sendMutex);
+	kinc_event_init(&messageEvent, true);
 	kinc_thread_t thread;
 	kinc_thread_init(&thread, startServerInThread, nullptr);
 }
@@ -202,24 +300,20 @@ namespace {
 			trace.trace.push_back(stack);
 		}
 
-		std::vector<int> message;
-		message.push_back(IDE_MESSAGE_STACKTRACE);
-		message.push_back(responseId);
-		message.push_back(trace.trace.size());
+		OutgoingMessage message;
+		message.writeInt(IDE_MESSAGE_STACKTRACE);
+		message.writeInt(responseId);
+		message.writeInt((int)trace.trace.size());
 		for (size_t i = 0; i < trace.trace.size(); ++i) {
-			message.push_back(trace.trace[i].index);
-			message.push_back(trace.trace[i].scriptId);
-			message.push_back(trace.trace[i].line);
-			message.push_back(trace.trace[i].column);
-			message.push_back(trace.trace[i].sourceLength);
-			message.push_back(trace.trace[i].functionHandle);
-			size_t stringLength = strlen(trace.trace[i].sourceText);
-			message.push_back(stringLength);
-			for (size_t i2 = 0; i2 < stringLength; ++i2) {
-				message.push_back(trace.trace[i].sourceText[i2]);
-			}
+			message.writeInt(trace.trace[i].index);
+			message.writeInt(trace.trace[i].scriptId);
+			message.writeInt(trace.trace[i].line);
+			message.writeInt(trace.trace[i].column);
+			message.writeInt(trace.trace[i].sourceLength);
+			message.writeInt(trace.trace[i].functionHandle);
+			message.writeString(trace.trace[i].sourceText, strlen(trace.trace[i].sourceText));
 		}
-		sendMessage(message.data(), message.size());
+		sendMessage(message);
 	}
 
 	void sendVariables(int responseId) {
@@ -232,10 +326,10 @@ namespace {
 		int length;
 		JsNumberToInt(lengthObj, &length);
 
-		std::vector<int> message;
-		message.push_back(IDE_MESSAGE_VARIABLES);
-		message.push_back(responseId);
-		message.push_back(length);
+		OutgoingMessage message;
+		message.writeInt(IDE_MESSAGE_VARIABLES);
+		message.writeInt(responseId);
+		message.writeInt(length);
 
 		for (int i = 0; i < length; ++i) {
 			JsValueRef index;
@@ -251,18 +345,12 @@ namespace {
 			size_t length;
 			JsCopyString(nameObj, name, 255, &length);
 			name[length] = 0;
-			message.push_back(length);
-			for (size_t i2 = 0; i2 < length; ++i2) {
-				message.push_back(name[i2]);
-			}
+			message.writeString(name, length);
 
 			char type[256];
 			JsCopyString(typeObj, type, 255, &length);
 			type[length] = 0;
-			message.push_back(length);
-			for (size_t i2 = 0; i2 < length; ++i2) {
-				message.push_back(type[i2]);
-			}
+			message.writeString(type, length);
 
 			char varValue[256];
 			if (strcmp(type, "object") == 0) {
@@ -273,13 +361,10 @@ namespace {
 				JsCopyString(valueObj, varValue, 255, &length);
 				varValue[length] = 0;
 			}
-			message.push_back(length);
-			for (size_t i2 = 0; i2 < length; ++i2) {
-				message.push_back(varValue[i2]);
-			}
+			message.writeString(varValue, length);
 		}
 
-		sendMessage(message.data(), message.size());
+		sendMessage(message);
 	}
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 enum DebuggerMessageType {
 	DEBUGGER_MESSAGE_BREAKPOINT = 0,
@@ -29,9 +30,21 @@ struct Message {
 	int size;
 };
 
+// Strings go out as their byte length followed by the bytes instead of one int per character
+struct OutgoingMessage {
+	std::vector<char> data;
+
+	void writeInt(int value);
+	void writeString(const char* text, size_t length);
+};
+
 void startServer(int port);
 void sendMessage(int* data, int size);
+void sendMessage(const OutgoingMessage& message);
+// Returns a message with size 0 when nothing is queued
 Message receiveMessage();
+// Sleeps until the IDE sends something
+Message waitForMessage();
 bool handleDebugMessage(Message& message, bool halted);
 
 typedef void *JsRef;
@@ -0,0 +1,892 @@
+#include "font.h"
+
+#include <kinc/log.h>
+#include <kinc/system.h>
+#include <kinc/threads/event.h>
+#include <kinc/threads/mutex.h>
+#include <kinc/threads/thread.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+namespace {
+	struct Glyph {
+		bool ready;
+		int x, y, width, height; // position in the atlas
+		int left, top;           // bitmap offset relative to the pen position, top points up
+	};
+
+	struct Shelf {
+		int y, height, x;
+	};
+}
+
+struct KromFont {
+	uint8_t *data;
+	size_t size;
+
+	int numGlyphs;
+	int unitsPerEm;
+	int indexToLocFormat;
+	int ascender, descender, lineGap;
+	int numberOfHMetrics;
+	uint32_t cmap; // offset of the chosen cmap subtable
+	uint32_t loca, glyf, hmtx, kern;
+
+	int atlasWidth, atlasHeight;
+	uint8_t *atlasPixels;
+	kinc_g4_texture_t atlas;
+	std::vector<Shelf> shelves;
+	std::map<uint64_t, Glyph> glyphs;
+	int dirtyLeft, dirtyTop, dirtyRight, dirtyBottom;
+
+	int pendingRequests; // main thread only, the font is freed once released and no more requests are in flight
+	bool released;
+};
+
+namespace {
+	struct Request {
+		KromFont *font;
+		uint64_t key;
+		int glyph;
+		float scale;
+	};
+
+	struct Result {
+		KromFont *font;
+		uint64_t key;
+		uint8_t *pixels;
+		int width, height, left, top;
+	};
+
+	struct Point {
+		float x, y;
+	};
+
+	kinc_thread_t thread;
+	bool threadStarted = false;
+	kinc_mutex_t mutex;
+	kinc_event_t requestEvent;
+	std::vector<Request> requests;
+	std::vector<Result> results;
+	std::vector<KromFont *> fonts;
+
+	int glyphsRasterized = 0;
+	double rasterizeSeconds = 0.0;
+	size_t lastUploadBytes = 0;
+
+	uint16_t u16(const uint8_t *p) {
+		return (uint16_t)((p[0] << 8) | p[1]);
+	}
+
+	int16_t i16(const uint8_t *p) {
+		return (int16_t)u16(p);
+	}
+
+	uint32_t u32(const uint8_t *p) {
+		return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+	}
+
+	bool inside(KromFont *font, uint32_t offset, uint32_t length) {
+		return offset <= font->size && length <= font->size - offset;
+	}
+
+	uint32_t findTable(KromFont *font, const char *tag) {
+		if (!inside(font, 0, 12)) return 0;
+		int numTables = u16(font->data + 4);
+		for (int i = 0; i < numTables; ++i) {
+			uint32_t record = 12 + i * 16;
+			if (!inside(font, record, 16)) return 0;
+			if (memcmp(font->data + record, tag, 4) == 0) {
+				uint32_t offset = u32(font->data + record + 8);
+				uint32_t length = u32(font->data + record + 12);
+				return inside(font, offset, length) ? offset : 0;
+			}
+		}
+		return 0;
+	}
+
+	// Prefers full Unicode tables (format 12) over BMP-only ones (format 4)
+	uint32_t findCmap(KromFont *font, uint32_t cmap) {
+		uint32_t bmp = 0;
+		int numTables = u16(font->data + cmap + 2);
+		for (int i = 0; i < numTables; ++i) {
+			uint32_t record = cmap + 4 + i * 8;
+			if (!inside(font, record, 8)) break;
+			int platform = u16(font->data + record);
+			int encoding = u16(font->data + record + 2);
+			uint32_t offset = cmap + u32(font->data + record + 4);
+			if (!inside(font, offset, 4)) continue;
+			int format = u16(font->data + offset);
+			bool unicode = platform == 0 || (platform == 3 && (encoding == 1 || encoding == 10));
+			if (!unicode) continue;
+			if (format == 12) return offset;
+			if (format == 4 && bmp == 0) bmp = offset;
+		}
+		return bmp;
+	}
+
+	int lookupGlyph(KromFont *font, uint32_t codepoint) {
+		const uint8_t *data = font->data;
+		uint32_t table = font->cmap;
+		int format = u16(data + table);
+		if (format == 4) {
+			if (codepoint > 0xffff) return 0;
+			if (!inside(font, table, 14)) return 0;
+			int segCountX2 = u16(data + table + 6);
+			uint32_t endCodes = table + 14;
+			uint32_t startCodes = endCodes + segCountX2 + 2;
+			uint32_t idDeltas = startCodes + segCountX2;
+			uint32_t idRangeOffsets = idDeltas + segCountX2;
+			if (!inside(font, endCodes, segCountX2 * 4 + 2)) return 0;
+			int low = 0;
+			int high = segCountX2 / 2 - 1;
+			while (low <= high) {
+				int mid = (low + high) / 2;
+				if (u16(data + endCodes + mid * 2) < codepoint) low = mid + 1;
+				else high = mid - 1;
+			}
+			if (low >= segCountX2 / 2) return 0;
+			uint32_t start = u16(data + startCodes + low * 2);
+			if (codepoint < start) return 0;
+			int delta = u16(data + idDeltas + low * 2);
+			int rangeOffset = u16(data + idRangeOffsets + low * 2);
+			if (rangeOffset == 0) return (codepoint + delta) & 0xffff;
+			uint32_t address = idRangeOffsets + low * 2 + rangeOffset + (codepoint - start) * 2;
+			if (!inside(font, address, 2)) return 0;
+			int glyph = u16(data + address);
+			return glyph == 0 ? 0 : (glyph + delta) & 0xffff;
+		}
+		else if (format == 12) {
+			if (!inside(font, table, 16)) return 0;
+			uint32_t numGroups = u32(data + table + 12);
+			if (numGroups > font->size / 12 || !inside(font, table + 16, numGroups * 12)) return 0;
+			uint32_t low = 0;
+			uint32_t high = numGroups;
+			while (low < high) {
+				uint32_t mid = (low + high) / 2;
+				const uint8_t *group = data + table + 16 + mid * 12;
+				if (codepoint < u32(group)) high = mid;
+				else if (codepoint > u32(group + 4)) low = mid + 1;
+				else return (int)(u32(group + 8) + codepoint - u32(group));
+			}
+		}
+		return 0;
+	}
+
+	int advanceWidth(KromFont *font, int glyph) {
+		int metric = glyph < font->numberOfHMetrics ? glyph : font->numberOfHMetrics - 1;
+		return u16(font->data + font->hmtx + metric * 4);
+	}
+
+	int kerning(KromFont *font, int left, int right) {
+		if (font->kern == 0 || !inside(font, font->kern, 18)) return 0;
+		const uint8_t *table = font->data + font->kern;
+		// Only the first subtable and only horizontal format 0 kerning, which is what old school fonts ship
+		if (u16(table + 2) < 1 || u16(table + 8) != 1) return 0;
+		int numPairs = u16(table + 10);
+		if (!inside(font, font->kern + 18, numPairs * 6)) return 0;
+		uint32_t pair = ((uint32_t)left << 16) | (uint32_t)right;
+		int low = 0;
+		int high = numPairs - 1;
+		while (low <= high) {
+			int mid = (low + high) / 2;
+			uint32_t current = u32(table + 18 + mid * 6);
+			if (pair < current) high = mid - 1;
+			else if (pair > current) low = mid + 1;
+			else return i16(table + 22 + mid * 6);
+		}
+		return 0;
+	}
+
+	bool glyphRange(KromFont *font, int glyph, uint32_t *offset, uint32_t *length) {
+		if (glyph >= font->numGlyphs) return false;
+		uint32_t start, end;
+		if (font->indexToLocFormat == 0) {
+			start = u16(font->data + font->loca + glyph * 2) * 2;
+			end = u16(font->data + font->loca + glyph * 2 + 2) * 2;
+		}
+		else {
+			start = u32(font->data + font->loca + glyph * 4);
+			end = u32(font->data + font->loca + glyph * 4 + 4);
+		}
+		if (end <= start || !inside(font, font->glyf + start, end - start) || end - start < 10) return false;
+		*offset = font->glyf + start;
+		*length = end - start;
+		return true;
+	}
+
+	Point transform(const float *m, float x, float y) {
+		Point p;
+		p.x = m[0] * x + m[1] * y + m[2];
+		p.y = m[3] * x + m[4] * y + m[5];
+		return p;
+	}
+
+	void addLine(std::vector<float> &lines, Point a, Point b) {
+		lines.push_back(a.x);
+		lines.push_back(a.y);
+		lines.push_back(b.x);
+		lines.push_back(b.y);
+	}
+
+	void addQuad(std::vector<float> &lines, Point a, Point control, Point b) {
+		float devx = a.x - 2.0f * control.x + b.x;
+		float devy = a.y - 2.0f * control.y + b.y;
+		float devsq = devx * devx + devy * devy;
+		if (devsq < 0.333f) {
+			addLine(lines, a, b);
+			return;
+		}
+		int segments = 1 + (int)floorf(sqrtf(sqrtf(3.0f * devsq)));
+		Point previous = a;
+		for (int i = 1; i <= segments; ++i) {
+			float t = (float)i / segments;
+			float mt = 1.0f - t;
+			Point p;
+			p.x = mt * mt * a.x + 2.0f * mt * t * control.x + t * t * b.x;
+			p.y = mt * mt * a.y + 2.0f * mt * t * control.y + t * t * b.y;
+			addLine(lines, previous, p);
+			previous = p;
+		}
+	}
+
+	Point midpoint(Point a, Point b) {
+		Point p;
+		p.x = (a.x + b.x) * 0.5f;
+		p.y = (a.y + b.y) * 0.5f;
+		return p;
+	}
+
+	bool appendSimpleGlyph(KromFont *font, uint32_t offset, uint32_t length, const float *m, std::vector<float> &lines) {
+		const uint8_t *data = font->data + offset;
+		const uint8_t *end = data + length;
+		int numberOfContours = i16(data);
+		const uint8_t *endPoints = data + 10;
+		if (endPoints + numberOfContours * 2 + 2 > end) return false;
+		int numPoints = u16(endPoints + (numberOfContours - 1) * 2) + 1;
+		int instructionLength = u16(endPoints + numberOfContours * 2);
+		const uint8_t *p = endPoints + numberOfContours * 2 + 2 + instructionLength;
+
+		std::vector<uint8_t> flags(numPoints);
+		for (int i = 0; i < numPoints;) {
+			if (p >= end) return false;
+			uint8_t flag = *p++;
+			int repeat = 0;
+			if (flag & 8) {
+				if (p >= end) return false;
+				repeat = *p++;
+			}
+			for (int r = 0; r <= repeat && i < numPoints; ++r) {
+				flags[i++] = flag;
+			}
+		}
+
+		std::vector<Point> points(numPoints);
+		int value = 0;
+		for (int i = 0; i < numPoints; ++i) {
+			if (flags[i] & 2) {
+				if (p + 1 > end) return false;
+				value += (flags[i] & 16) ? *p : -*p;
+				p += 1;
+			}
+			else if (!(flags[i] & 16)) {
+				if (p + 2 > end) return false;
+				value += i16(p);
+				p += 2;
+			}
+			points[i].x = (float)value;
+		}
+		value = 0;
+		for (int i = 0; i < numPoints; ++i) {
+			if (flags[i] & 4) {
+				if (p + 1 > end) return false;
+				value += (flags[i] & 32) ? *p : -*p;
+				p += 1;
+			}
+			else if (!(flags[i] & 32)) {
+				if (p + 2 > end) return false;
+				value += i16(p);
+				p += 2;
+			}
+			points[i].y = (float)value;
+		}
+		for (int i = 0; i < numPoints; ++i) {
+			points[i] = transform(m, points[i].x, points[i].y);
+		}
+
+		int start = 0;
+		for (int c = 0; c < numberOfContours; ++c) {
+			int last = u16(endPoints + c * 2);
+			if (last >= numPoints || last < start) return false;
+			int count = last - start + 1;
+			if (count < 2) {
+				start = last + 1;
+				continue;
+			}
+
+			int first = -1;
+			for (int k = 0; k < count; ++k) {
+				if (flags[start + k] & 1) {
+					first = k;
+					break;
+				}
+			}
+			Point begin;
+			int k = 1;
+			if (first >= 0) {
+				begin = points[start + first];
+			}
+			else {
+				// No point on the curve, the contour starts between the last and the first control point
+				begin = midpoint(points[last], points[start]);
+				first = 0;
+				k = 0;
+			}
+
+			Point current = begin;
+			Point control;
+			bool hasControl = false;
+			for (; k < count; ++k) {
+				int index = start + (first + k) % count;
+				Point point = points[index];
+				if (flags[index] & 1) {
+					if (hasControl) addQuad(lines, current, control, point);
+					else addLine(lines, current, point);
+					current = point;
+					hasControl = false;
+				}
+				else {
+					if (hasControl) {
+						Point mid = midpoint(control, point);
+						addQuad(lines, current, control, mid);
+						current = mid;
+					}
+					control = point;
+					hasControl = true;
+				}
+			}
+			if (hasControl) addQuad(lines, current, control, begin);
+			else addLine(lines, current, begin);
+
+			start = last + 1;
+		}
+		return true;
+	}
+
+	bool appendGlyph(KromFont *font, int glyph, const float *m, std::vector<float> &lines, int depth) {
+		uint32_t offset, length;
+		if (!glyphRange(font, glyph, &offset, &length)) return true; // empty glyph like a space
+		if (depth > 8) return false;
+
+		int numberOfContours = i16(font->data + offset);
+		if (numberOfContours >= 0) {
+			return appendSimpleGlyph(font, offset, length, m, lines);
+		}
+
+		const uint8_t *p = font->data + offset + 10;
+		const uint8_t *end = font->data + offset + length;
+		for (;;) {
+			if (p + 4 > end) return false;
+			int flags = u16(p);
+			int component = u16(p + 2);
+			p += 4;
+
+			float dx = 0.0f;
+			float dy = 0.0f;
+			if (flags & 1) {
+				if (p + 4 > end) return false;
+				if (flags & 2) {
+					dx = i16(p);
+					dy = i16(p + 2);
+				}
+				p += 4;
+			}
+			else {
+				if (p + 2 > end) return false;
+				if (flags & 2) {
+					dx = (int8_t)p[0];
+					dy = (int8_t)p[1];
+				}
+				p += 2;
+			}
+			// Point matched components (flag 2 cleared) are rare and placed without offset
+
+			float a = 1.0f, b = 0.0f, c = 0.0f, d = 1.0f;
+			if (flags & 8) {
+				if (p + 2 > end) return false;
+				a = d = i16(p) / 16384.0f;
+				p += 2;
+			}
+			else if (flags & 0x40) {
+				if (p + 4 > end) return false;
+				a = i16(p) / 16384.0f;
+				d = i16(p + 2) / 16384.0f;
+				p += 4;
+			}
+			else if (flags & 0x80) {
+				if (p + 8 > end) return false;
+				a = i16(p) / 16384.0f;
+				b = i16(p + 2) / 16384.0f;
+				c = i16(p + 4) / 16384.0f;
+				d = i16(p + 6) / 16384.0f;
+				p += 8;
+			}
+
+			float cm[6];
+			cm[0] = m[0] * a + m[1] * b;
+			cm[1] = m[0] * c + m[1] * d;
+			cm[2] = m[0] * dx + m[1] * dy + m[2];
+			cm[3] = m[3] * a + m[4] * b;
+			cm[4] = m[3] * c + m[4] * d;
+			cm[5] = m[3] * dx + m[4] * dy + m[5];
+			if (!appendGlyph(font, component, cm, lines, depth + 1)) return false;
+
+			if (!(flags & 0x20)) break;
+		}
+		return true;
+	}
+
+	// Signed area accumulation, every line adds its coverage to the cells it crosses and a running
+	// sum over each scanline turns that into the final alpha. Scanlines are width + 2 floats apart,
+	// which leaves room for the cells right of the last column. Outlines outside of the bitmap, from
+	// wrong bounding boxes or point matched components, are clamped to it: whatever lies left of it
+	// covers column 0 and whatever lies right of it covers nothing.
+	const int rowPadding = 2;
+
+	void drawLine(float *accumulation, int width, int height, float x0, float y0, float x1, float y1) {
+		if (fabsf(y0 - y1) <= 1e-6f) return;
+		float dir = 1.0f;
+		if (y0 > y1) {
+			dir = -1.0f;
+			std::swap(x0, x1);
+			std::swap(y0, y1);
+		}
+		float dxdy = (x1 - x0) / (y1 - y0);
+		float x = x0;
+		if (y0 < 0.0f) {
+			x -= y0 * dxdy;
+		}
+		int yEnd = std::min(height, (int)ceilf(y1));
+		for (int y = std::max(0, (int)y0); y < yEnd; ++y) {
+			float *line = &accumulation[y * (width + rowPadding)];
+			float dy = std::min((float)(y + 1), y1) - std::max((float)y, y0);
+			float xnext = x + dxdy * dy;
+			float d = dy * dir;
+			float xa = std::min(std::max(std::min(x, xnext), 0.0f), (float)width);
+			float xb = std::min(std::max(std::max(x, xnext), 0.0f), (float)width);
+			float xaFloor = floorf(xa);
+			int xai = (int)xaFloor;
+			float xbCeil = ceilf(xb);
+			int xbi = (int)xbCeil;
+			if (xbi <= xai + 1) {
+				float xmf = 0.5f * (xa + xb) - xaFloor;
+				line[xai] += d - d * xmf;
+				line[xai + 1] += d * xmf;
+			}
+			else {
+				float s = 1.0f / (xb - xa);
+				float xaf = xa - xaFloor;
+				float a0 = 0.5f * s * (1.0f - xaf) * (1.0f - xaf);
+				float xbf = xb - xbCeil + 1.0f;
+				float am = 0.5f * s * xbf * xbf;
+				line[xai] += d * a0;
+				if (xbi == xai + 2) {
+					line[xai + 1] += d * (1.0f - a0 - am);
+				}
+				else {
+					float a1 = s * (1.5f - xaf);
+					line[xai + 1] += d * (a1 - a0);
+					for (int xi = xai + 2; xi < xbi - 1; ++xi) {
+						line[xi] += d * s;
+					}
+					float a2 = a1 + (xbi - xai - 3) * s;
+					line[xbi - 1] += d * (1.0f - a2 - am);
+				}
+				line[xbi] += d * am;
+			}
+			x = xnext;
+		}
+	}
+
+	void rasterize(const Request &request, Result *result) {
+		KromFont *font = request.font;
+		float scale = request.scale;
+		result->font = font;
+		result->key = request.key;
+		result->pixels = nullptr;
+		result->width = result->height = result->left = result->top = 0;
+
+		uint32_t offset, length;
+		if (!glyphRange(font, request.glyph, &offset, &length)) return;
+
+		const uint8_t *header = font->data + offset;
+		int left = (int)floorf(i16(header + 2) * scale) - 1;
+		int bottom = (int)floorf(i16(header + 4) * scale) - 1;
+		int right = (int)ceilf(i16(header + 6) * scale) + 1;
+		int top = (int)ceilf(i16(header + 8) * scale) + 1;
+		int width = right - left;
+		int height = top - bottom;
+		if (width <= 0 || height <= 0 || width > 4096 || height > 4096) return;
+
+		float m[6] = {scale, 0.0f, (float)-left, 0.0f, -scale, (float)top};
+		std::vector<float> lines;
+		if (!appendGlyph(font, request.glyph, m, lines, 0) || lines.size() == 0) return;
+
+		std::vector<float> accumulation((width + rowPadding) * height, 0.0f);
+		for (size_t i = 0; i < lines.size(); i += 4) {
+			drawLine(accumulation.data(), width, height, lines[i], lines[i + 1], lines[i + 2], lines[i + 3]);
+		}
+
+		uint8_t *pixels = (uint8_t *)malloc(width * height);
+		for (int y = 0; y < height; ++y) {
+			const float *line = &accumulation[y * (width + rowPadding)];
+			float sum = 0.0f;
+			for (int x = 0; x < width; ++x) {
+				sum += line[x];
+				float alpha = std::min(fabsf(sum), 1.0f);
+				pixels[y * width + x] = (uint8_t)(alpha * 255.0f + 0.5f);
+			}
+		}
+
+		result->pixels = pixels;
+		result->width = width;
+		result->height = height;
+		result->left = left;
+		result->top = top;
+	}
+
+	void rasterizeThread(void *) {
+		std::vector<Request> work;
+		for (;;) {
+			kinc_event_wait(&requestEvent);
+
+			kinc_mutex_lock(&mutex);
+			work.swap(requests);
+			kinc_mutex_unlock(&mutex);
+
+			for (size_t i = 0; i < work.size(); ++i) {
+				double start = kinc_time();
+				Result result;
+				rasterize(work[i], &result);
+				double seconds = kinc_time() - start;
+
+				kinc_mutex_lock(&mutex);
+				results.push_back(result);
+				++glyphsRasterized;
+				rasterizeSeconds += seconds;
+				kinc_mutex_unlock(&mutex);
+			}
+			work.clear();
+		}
+	}
+
+	void freeFont(KromFont *font) {
+		kinc_g4_texture_destroy(&font->atlas);
+		free(font->atlasPixels);
+		free(font->data);
+		delete font;
+	}
+
+	void markDirty(KromFont *font, int x, int y, int width, int height) {
+		if (font->dirtyRight <= font->dirtyLeft) {
+			font->dirtyLeft = x;
+			font->dirtyTop = y;
+			font->dirtyRight = x + width;
+			font->dirtyBottom = y + height;
+		}
+		else {
+			font->dirtyLeft = std::min(font->dirtyLeft, x);
+			font->dirtyTop = std::min(font->dirtyTop, y);
+			font->dirtyRight = std::max(font->dirtyRight, x + width);
+			font->dirtyBottom = std::max(font->dirtyBottom, y + height);
+		}
+	}
+
+	void clearAtlas(KromFont *font) {
+		font->shelves.clear();
+		font->glyphs.clear();
+		memset(font->atlasPixels, 0, font->atlasWidth * font->atlasHeight);
+		markDirty(font, 0, 0, font->atlasWidth, font->atlasHeight);
+	}
+
+	// Shelf packing, glyphs go into the lowest shelf they fit in and new shelves are opened below
+	bool pack(KromFont *font, int width, int height, int *x, int *y) {
+		int paddedWidth = width + 1;
+		int paddedHeight = height + 1;
+		Shelf *best = nullptr;
+		for (size_t i = 0; i < font->shelves.size(); ++i) {
+			Shelf &shelf = font->shelves[i];
+			if (shelf.height >= paddedHeight && shelf.x + paddedWidth <= font->atlasWidth && (best == nullptr || shelf.height < best->height)) {
+				best = &shelf;
+			}
+		}
+		if (best == nullptr) {
+			int shelfY = font->shelves.size() > 0 ? font->shelves.back().y + font->shelves.back().height : 0;
+			if (shelfY + paddedHeight > font->atlasHeight || paddedWidth > font->atlasWidth) return false;
+			Shelf shelf;
+			shelf.y = shelfY;
+			shelf.height = paddedHeight;
+			shelf.x = 0;
+			font->shelves.push_back(shelf);
+			best = &font->shelves.back();
+		}
+		*x = best->x;
+		*y = best->y;
+		best->x += paddedWidth;
+		return true;
+	}
+
+	void insertGlyph(KromFont *font, const Result &result) {
+		Glyph glyph;
+		glyph.ready = true;
+		glyph.x = glyph.y = 0;
+		glyph.width = result.width;
+		glyph.height = result.height;
+		glyph.left = result.left;
+		glyph.top = result.top;
+
+		if (result.pixels != nullptr) {
+			if (!pack(font, result.width, result.height, &glyph.x, &glyph.y)) {
+				// Full, start over and let the visible glyphs come back on their own
+				clearAtlas(font);
+				if (!pack(font, result.width, result.height, &glyph.x, &glyph.y)) {
+					kinc_log(KINC_LOG_LEVEL_WARNING, "Glyph of %ix%i pixels does not fit into the font atlas.", result.width, result.height);
+					glyph.width = glyph.height = 0;
+					font->glyphs[result.key] = glyph;
+					return;
+				}
+			}
+			for (int row = 0; row < result.height; ++row) {
+				memcpy(&font->atlasPixels[(glyph.y + row) * font->atlasWidth + glyph.x], &result.pixels[row * result.width], result.width);
+			}
+			markDirty(font, glyph.x, glyph.y, result.width, result.height);
+		}
+		font->glyphs[result.key] = glyph;
+	}
+
+	void upload(KromFont *font) {
+		if (font->dirtyRight <= font->dirtyLeft) return;
+		uint8_t *pixels = kinc_g4_texture_lock(&font->atlas);
+		int stride = kinc_g4_texture_stride(&font->atlas);
+		int width = font->dirtyRight - font->dirtyLeft;
+		for (int y = font->dirtyTop; y < font->dirtyBottom; ++y) {
+			memcpy(&pixels[y * stride + font->dirtyLeft], &font->atlasPixels[y * font->atlasWidth + font->dirtyLeft], width);
+		}
+		kinc_g4_texture_unlock(&font->atlas);
+		lastUploadBytes += (size_t)width * (font->dirtyBottom - font->dirtyTop);
+		font->dirtyLeft = font->dirtyRight = font->dirtyTop = font->dirtyBottom = 0;
+	}
+
+	uint64_t glyphKey(int glyph, float size) {
+		return ((uint64_t)(uint32_t)(size * 4.0f + 0.5f) << 32) | (uint32_t)glyph;
+	}
+
+	float scaleForSize(KromFont *font, float size) {
+		return size / (font->ascender - font->descender);
+	}
+
+	// Decodes one code point and advances the index, lone surrogates come out as U+FFFD
+	uint32_t nextCodepoint(const uint16_t *text, int length, int *index) {
+		uint32_t c = text[(*index)++];
+		if (c >= 0xd800 && c < 0xdc00) {
+			if (*index < length && text[*index] >= 0xdc00 && text[*index] < 0xe000) {
+				uint32_t low = text[(*index)++];
+				return 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+			}
+			return 0xfffd;
+		}
+		if (c >= 0xdc00 && c < 0xe000) return 0xfffd;
+		return c;
+	}
+}
+
+KromFont *createFont(const void *data, size_t size, int atlasWidth, int atlasHeight) {
+	KromFont *font = new KromFont;
+	font->data = (uint8_t *)malloc(size);
+	memcpy(font->data, data, size);
+	font->size = size;
+
+	uint32_t head = findTable(font, "head");
+	uint32_t maxp = findTable(font, "maxp");
+	uint32_t hhea = findTable(font, "hhea");
+	uint32_t cmap = findTable(font, "cmap");
+	font->hmtx = findTable(font, "hmtx");
+	font->loca = findTable(font, "loca");
+	font->glyf = findTable(font, "glyf");
+	font->kern = findTable(font, "kern");
+	if (head == 0 || maxp == 0 || hhea == 0 || cmap == 0 || font->hmtx == 0 || font->loca == 0 || font->glyf == 0 || !inside(font, head, 54) ||
+	    !inside(font, maxp, 6) || !inside(font, hhea, 36)) {
+		free(font->data);
+		delete font;
+		return nullptr;
+	}
+
+	font->unitsPerEm = u16(font->data + head + 18);
+	font->indexToLocFormat = i16(font->data + head + 50);
+	font->numGlyphs = u16(font->data + maxp + 4);
+	font->ascender = i16(font->data + hhea + 4);
+	font->descender = i16(font->data + hhea + 6);
+	font->lineGap = i16(font->data + hhea + 8);
+	font->numberOfHMetrics = u16(font->data + hhea + 34);
+	font->cmap = findCmap(font, cmap);
+	uint32_t locaLength = (font->numGlyphs + 1) * (font->indexToLocFormat == 0 ? 2 : 4);
+	if (font->cmap == 0 || font->numberOfHMetrics == 0 || font->ascender == font->descender || !inside(font, font->loca, locaLength) ||
+	    !inside(font, font->hmtx, font->numberOfHMetrics * 4)) {
+		free(font->data);
+		delete font;
+		return nullptr;
+	}
+
+	font->atlasWidth = atlasWidth;
+	font->atlasHeight = atlasHeight;
+	font->atlasPixels = (uint8_t *)calloc(atlasWidth * atlasHeight, 1);
+	kinc_g4_texture_init(&font->atlas, atlasWidth, atlasHeight, KINC_IMAGE_FORMAT_GREY8);
+	font->dirtyLeft = font->dirtyRight = font->dirtyTop = font->dirtyBottom = 0;
+	markDirty(font, 0, 0, atlasWidth, atlasHeight);
+	font->pendingRequests = 0;
+	font->released = false;
+
+	if (!threadStarted) {
+		kinc_mutex_init(&mutex);
+		kinc_event_init(&requestEvent, true);
+		kinc_thread_init(&thread, rasterizeThread, nullptr);
+		threadStarted = true;
+	}
+	fonts.push_back(font);
+	return font;
+}
+
+void destroyFont(KromFont *font) {
+	font->released = true;
+	fonts.erase(std::remove(fonts.begin(), fonts.end(), font), fonts.end());
+	if (font->pendingRequests == 0) {
+		freeFont(font);
+	}
+}
+
+size_t fontByteSize(KromFont *font) {
+	return font->size + (size_t)font->atlasWidth * font->atlasHeight * 2;
+}
+
+kinc_g4_texture_t *fontAtlas(KromFont *font) {
+	return &font->atlas;
+}
+
+void fontMetrics(KromFont *font, float size, float *ascent, float *descent, float *lineGap) {
+	float scale = scaleForSize(font, size);
+	*ascent = font->ascender * scale;
+	*descent = -font->descender * scale;
+	*lineGap = font->lineGap * scale;
+}
+
+float textWidth(KromFont *font, float size, const uint16_t *text, int length) {
+	float scale = scaleForSize(font, size);
+	int width = 0;
+	int previous = -1;
+	for (int i = 0; i < length;) {
+		int glyph = lookupGlyph(font, nextCodepoint(text, length, &i));
+		if (previous >= 0) width += kerning(font, previous, glyph);
+		width += advanceWidth(font, glyph);
+		previous = glyph;
+	}
+	return width * scale;
+}
+
+int layoutText(KromFont *font, float size, const uint16_t *text, int length, float x, float y, KromGlyphQuad *quads, int maxQuads) {
+	float scale = scaleForSize(font, size);
+	float penX = x;
+	float baseline = floorf(y + 0.5f);
+	int previous = -1;
+	int count = 0;
+	bool requested = false;
+
+	for (int i = 0; i < length;) {
+		int glyphId = lookupGlyph(font, nextCodepoint(text, length, &i));
+		if (previous >= 0) penX += kerning(font, previous, glyphId) * scale;
+
+		uint64_t key = glyphKey(glyphId, size);
+		std::map<uint64_t, Glyph>::iterator it = font->glyphs.find(key);
+		if (it == font->glyphs.end()) {
+			Glyph glyph;
+			glyph.ready = false;
+			font->glyphs[key] = glyph;
+
+			Request request;
+			request.font = font;
+			request.key = key;
+			request.glyph = glyphId;
+			request.scale = scale;
+			kinc_mutex_lock(&mutex);
+			requests.push_back(request);
+			kinc_mutex_unlock(&mutex);
+			++font->pendingRequests;
+			requested = true;
+		}
+		else if (it->second.ready && it->second.width > 0 && count < maxQuads) {
+			const Glyph &glyph = it->second;
+			KromGlyphQuad &quad = quads[count++];
+			quad.x = floorf(penX + 0.5f) + glyph.left;
+			quad.y = baseline - glyph.top;
+			quad.width = (float)glyph.width;
+			quad.height = (float)glyph.height;
+			quad.u0 = (float)glyph.x / font->atlasWidth;
+			quad.v0 = (float)glyph.y / font->atlasHeight;
+			quad.u1 = (float)(glyph.x + glyph.width) / font->atlasWidth;
+			quad.v1 = (float)(glyph.y + glyph.height) / font->atlasHeight;
+		}
+
+		penX += advanceWidth(font, glyphId) * scale;
+		previous = glyphId;
+	}
+
+	if (requested) {
+		kinc_event_signal(&requestEvent);
+	}
+	return count;
+}
+
+void updateFontAtlases() {
+	if (!threadStarted) return;
+
+	std::vector<Result> finished;
+	kinc_mutex_lock(&mutex);
+	finished.swap(results);
+	kinc_mutex_unlock(&mutex);
+
+	for (size_t i = 0; i < finished.size(); ++i) {
+		KromFont *font = finished[i].font;
+		--font->pendingRequests;
+		if (font->released) {
+			if (font->pendingRequests == 0) {
+				freeFont(font);
+			}
+		}
+		else {
+			insertGlyph(font, finished[i]);
+		}
+		free(finished[i].pixels);
+	}
+
+	lastUploadBytes = 0;
+	for (size_t i = 0; i < fonts.size(); ++i) {
+		upload(fonts[i]);
+	}
+}
+
+void fontStats(KromFontStats *stats) {
+	if (!threadStarted) {
+		stats->glyphsPerSecond = 0.0;
+		stats->uploadBytes = 0;
+		return;
+	}
+	kinc_mutex_lock(&mutex);
+	stats->glyphsPerSecond = rasterizeSeconds > 0.0 ? glyphsRasterized / rasterizeSeconds : 0.0;
+	kinc_mutex_unlock(&mutex);
+	stats->uploadBytes = lastUploadBytes;
+}
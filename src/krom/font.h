@@ -0,0 +1,34 @@
+#pragma once
+
+#include <kinc/graphics4/texture.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct KromFont;
+
+struct KromGlyphQuad {
+	float x, y, width, height;
+	float u0, v0, u1, v1;
+};
+
+struct KromFontStats {
+	double glyphsPerSecond;
+	size_t uploadBytes; // copied into atlases during the previous frame
+};
+
+// Copies the TrueType data, returns nullptr when it can not be parsed.
+KromFont *createFont(const void *data, size_t size, int atlasWidth, int atlasHeight);
+void destroyFont(KromFont *font);
+size_t fontByteSize(KromFont *font);
+kinc_g4_texture_t *fontAtlas(KromFont *font);
+void fontMetrics(KromFont *font, float size, float *ascent, float *descent, float *lineGap);
+float textWidth(KromFont *font, float size, const uint16_t *text, int length);
+
+// Writes one quad per visible glyph of the UTF-16 text, with y being the baseline. Glyphs that are not in
+// the atlas yet are queued for rasterization and skipped, they show up once updateFontAtlases picked them up.
+int layoutText(KromFont *font, float size, const uint16_t *text, int length, float x, float y, KromGlyphQuad *quads, int maxQuads);
+
+// Main thread only: packs freshly rasterized glyphs and uploads the changed parts of the atlases.
+void updateFontAtlases();
+void fontStats(KromFontStats *stats);
@@ -0,0 +1,111 @@
+#include "jobs.h"
+
+#include <kinc/system.h>
+#include <kinc/threads/event.h>
+#include <kinc/threads/mutex.h>
+#include <kinc/threads/thread.h>
+
+namespace {
+	const int maxThreads = 8;
+
+	struct Job {
+		int count;
+		int chunkSize;
+		void (*func)(void *data, int first, int last);
+		void *data;
+	};
+
+	kinc_thread_t threads[maxThreads];
+	kinc_event_t wakeEvents[maxThreads];
+	int threadCount = -1;
+	kinc_mutex_t callMutex;
+	kinc_mutex_t jobMutex;
+	kinc_event_t doneEvent;
+	const Job *currentJob = nullptr;
+	int nextItem, itemsDone;
+
+	// Hands out chunks until the job is done, used by the pool threads and the calling thread alike
+	void runChunks() {
+		for (;;) {
+			kinc_mutex_lock(&jobMutex);
+			const Job *job = currentJob;
+			int first = nextItem;
+			if (job == nullptr || first >= job->count) {
+				kinc_mutex_unlock(&jobMutex);
+				return;
+			}
+			int last = first + job->chunkSize < job->count ? first + job->chunkSize : job->count;
+			nextItem = last;
+			kinc_mutex_unlock(&jobMutex);
+
+			job->func(job->data, first, last);
+
+			kinc_mutex_lock(&jobMutex);
+			itemsDone += last - first;
+			bool finished = itemsDone == job->count;
+			kinc_mutex_unlock(&jobMutex);
+			if (finished) {
+				kinc_event_signal(&doneEvent);
+			}
+		}
+	}
+
+	void poolThread(void *param) {
+		kinc_event_t *wakeEvent = (kinc_event_t *)param;
+		for (;;) {
+			kinc_event_wait(wakeEvent);
+			runChunks();
+		}
+	}
+}
+
+void startJobPool() {
+	if (threadCount >= 0) {
+		return;
+	}
+	kinc_mutex_init(&callMutex);
+	kinc_mutex_init(&jobMutex);
+	kinc_event_init(&doneEvent, true);
+	int count = kinc_hardware_threads() - 1;
+	count = count < 0 ? 0 : (count > maxThreads ? maxThreads : count);
+	for (int i = 0; i < count; ++i) {
+		kinc_event_init(&wakeEvents[i], true);
+		kinc_thread_init(&threads[i], poolThread, &wakeEvents[i]);
+	}
+	threadCount = count;
+}
+
+void parallelFor(int count, int chunkSize, void (*func)(void *data, int first, int last), void *data) {
+	if (count <= 0) {
+		return;
+	}
+	// Not worth waking anybody up for, or the pool is busy with another thread's job. Waiting for that one could
+	// stall the frame behind a whole texture decode of the streaming thread, so this thread gets by on its own.
+	if (count <= chunkSize || threadCount < 0 || !kinc_mutex_try_to_lock(&callMutex)) {
+		func(data, 0, count);
+		return;
+	}
+
+	Job job;
+	job.count = count;
+	job.chunkSize = chunkSize;
+	job.func = func;
+	job.data = data;
+
+	kinc_mutex_lock(&jobMutex);
+	currentJob = &job;
+	nextItem = 0;
+	itemsDone = 0;
+	kinc_mutex_unlock(&jobMutex);
+
+	for (int i = 0; i < threadCount; ++i) {
+		kinc_event_signal(&wakeEvents[i]);
+	}
+	runChunks();
+	kinc_event_wait(&doneEvent);
+
+	kinc_mutex_lock(&jobMutex);
+	currentJob = nullptr;
+	kinc_mutex_unlock(&jobMutex);
+	kinc_mutex_unlock(&callMutex);
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+// Starts the pool threads. Called by krom_init before any thread that could submit jobs is started, parallelFor runs
+// everything on the calling thread until then.
+void startJobPool();
+
+// Calls func for every chunk of chunkSize items out of count, spread over a small pool of threads.
+// The calling thread works on chunks too and returns once all of them are done. The pool takes one call at a time,
+// a call that comes in while another thread has it runs all chunks on its own thread instead of waiting.
+void parallelFor(int count, int chunkSize, void (*func)(void *data, int first, int last), void *data);
@@ -0,0 +1,367 @@
+#include "logger.h"
+
+#include <kinc/log.h>
+#include <kinc/threads/event.h>
+#include <kinc/threads/thread.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#ifdef KORE_WINDOWS
+#include <Windows.h>
+#else
+#include <signal.h>
+#include <unistd.h>
+#if defined(__linux__) || defined(__APPLE__)
+#include "v8-wasm-trap-handler-posix.h"
+#endif
+#endif
+
+namespace {
+	const size_t ringSize = 1024;   // power of two
+	const size_t inlineSize = 240; // longer messages are allocated by the producer
+	const size_t batchSize = 64 * 1024;
+
+	// Bounded multi-producer ring, producers claim a slot by bumping enqueuePos and publish it through its sequence
+	struct Slot {
+		std::atomic<size_t> sequence;
+		char *longText;
+		size_t length;
+		char text[inlineSize];
+	};
+
+	Slot ring[ringSize];
+	std::atomic<size_t> enqueuePos{0};
+	std::atomic<size_t> dequeuePos{0};
+	std::atomic<bool> consuming{false}; // owned by whoever drains, the writer thread or a flush
+	std::atomic<bool> started{false};
+
+	kinc_thread_t writerThread;
+	kinc_event_t writerEvent;
+	std::atomic<bool> writerWaiting{false};
+
+	FILE *logFile = nullptr;
+	int logFd = -1; // fileno(logFile) for crashes, fileno takes the stream's lock on some systems
+	char batch[batchSize]; // plain storage, the writer keeps running while static destructors run at exit
+	size_t batchLength = 0;
+
+	std::atomic<int> rateLimit{0};
+	std::atomic<long long> rateWindow{0};
+	std::atomic<int> rateCount{0};
+
+	std::atomic<uint64_t> written{0};
+	std::atomic<uint64_t> dropped{0};
+	std::atomic<uint64_t> unreportedDrops{0};
+
+	bool rateLimited() {
+		int limit = rateLimit.load(std::memory_order_relaxed);
+		if (limit <= 0) {
+			return false;
+		}
+		long long second = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		long long window = rateWindow.load(std::memory_order_relaxed);
+		if (window != second && rateWindow.compare_exchange_strong(window, second, std::memory_order_relaxed)) {
+			rateCount.store(0, std::memory_order_relaxed);
+		}
+		return rateCount.fetch_add(1, std::memory_order_relaxed) >= limit;
+	}
+
+	void drop() {
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		unreportedDrops.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	bool enqueue(const char *format, va_list args) {
+		size_t pos = enqueuePos.load(std::memory_order_relaxed);
+		Slot *slot;
+		for (;;) {
+			slot = &ring[pos & (ringSize - 1)];
+			size_t sequence = slot->sequence.load(std::memory_order_acquire);
+			intptr_t difference = (intptr_t)sequence - (intptr_t)pos;
+			if (difference == 0) {
+				if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			}
+			else if (difference < 0) {
+				return false;
+			}
+			else {
+				pos = enqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+
+		va_list copy;
+		va_copy(copy, args);
+		int length = vsnprintf(slot->text, inlineSize, format, copy);
+		va_end(copy);
+		slot->longText = nullptr;
+		if (length < 0) {
+			slot->text[0] = 0;
+			length = 0;
+		}
+		else if ((size_t)length >= inlineSize) {
+			slot->longText = (char *)malloc(length + 1);
+			vsnprintf(slot->longText, length + 1, format, args);
+		}
+		slot->length = length;
+		slot->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Crashing skips stdio and kinc_log, the thread that crashed might be inside them
+	void writeOut(const char *text, size_t length, bool crashing) {
+#ifndef KORE_WINDOWS
+		if (crashing) {
+			int fd = logFd >= 0 ? logFd : STDOUT_FILENO;
+			ssize_t result = write(fd, text, length);
+			result = write(fd, "\n", 1);
+			(void)result;
+			return;
+		}
+#endif
+		if (logFile != nullptr) {
+			if (batchLength + length + 1 > batchSize) {
+				fwrite(batch, 1, batchLength, logFile);
+				batchLength = 0;
+			}
+			if (length + 1 > batchSize) {
+				fwrite(text, 1, length, logFile);
+				fputc('\n', logFile);
+				return;
+			}
+			memcpy(&batch[batchLength], text, length);
+			batch[batchLength + length] = '\n';
+			batchLength += length + 1;
+		}
+		else {
+			kinc_log(KINC_LOG_LEVEL_INFO, "%s", text);
+		}
+	}
+
+	// No snprintf, crashes have to format this as well
+	size_t formatDrops(char *message, uint64_t drops) {
+		char digits[24];
+		size_t count = 0;
+		do {
+			digits[count++] = (char)('0' + drops % 10);
+			drops /= 10;
+		} while (drops > 0);
+		size_t length = 0;
+		while (count > 0) {
+			message[length++] = digits[--count];
+		}
+		const char suffix[] = " log messages dropped";
+		memcpy(&message[length], suffix, sizeof(suffix));
+		return length + sizeof(suffix) - 1;
+	}
+
+	// Crashing leaks long messages, free is not async-signal-safe
+	void drain(bool crashing) {
+		uint64_t count = 0;
+		for (;;) {
+			size_t pos = dequeuePos.load(std::memory_order_relaxed);
+			Slot *slot = &ring[pos & (ringSize - 1)];
+			if (slot->sequence.load(std::memory_order_acquire) != pos + 1) {
+				break;
+			}
+			writeOut(slot->longText != nullptr ? slot->longText : slot->text, slot->length, crashing);
+			if (!crashing) {
+				free(slot->longText);
+			}
+			slot->longText = nullptr;
+			slot->sequence.store(pos + ringSize, std::memory_order_release);
+			dequeuePos.store(pos + 1, std::memory_order_relaxed);
+			++count;
+		}
+		written.fetch_add(count, std::memory_order_relaxed);
+
+		uint64_t drops = unreportedDrops.exchange(0, std::memory_order_relaxed);
+		if (drops > 0) {
+			char message[64];
+			size_t length = formatDrops(message, drops);
+			writeOut(message, length, crashing);
+		}
+
+		if (logFile != nullptr && !crashing) {
+			fwrite(batch, 1, batchLength, logFile);
+			batchLength = 0;
+			fflush(logFile);
+		}
+	}
+
+	bool pending() {
+		size_t pos = dequeuePos.load(std::memory_order_relaxed);
+		return ring[pos & (ringSize - 1)].sequence.load(std::memory_order_acquire) == pos + 1 || unreportedDrops.load(std::memory_order_relaxed) > 0;
+	}
+
+	bool tryDrain(bool crashing) {
+		if (consuming.exchange(true, std::memory_order_acquire)) {
+			return false;
+		}
+		drain(crashing);
+		consuming.store(false, std::memory_order_release);
+		return true;
+	}
+
+	void writerThreadFunc(void *) {
+		for (;;) {
+			tryDrain(false);
+			writerWaiting.store(true);
+			if (!pending()) {
+				kinc_event_try_to_wait(&writerEvent, 0.25);
+			}
+			writerWaiting.store(false);
+		}
+	}
+
+	void flushOnCrash() {
+		// Give the writer a moment to finish its batch, it might be the thread that crashed though
+		for (int i = 0; i < 1000; ++i) {
+			if (tryDrain(true)) {
+				return;
+			}
+			std::this_thread::yield();
+		}
+	}
+
+#ifdef KORE_WINDOWS
+	LPTOP_LEVEL_EXCEPTION_FILTER previousFilter = nullptr;
+
+	LONG WINAPI crashFilter(EXCEPTION_POINTERS *exception) {
+		flushOnCrash();
+		return previousFilter != nullptr ? previousFilter(exception) : EXCEPTION_CONTINUE_SEARCH;
+	}
+
+	void installCrashHandlers() {
+		previousFilter = SetUnhandledExceptionFilter(crashFilter);
+	}
+#else
+	const int crashSignals[] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT};
+	struct sigaction previousActions[sizeof(crashSignals) / sizeof(crashSignals[0])];
+
+	// Passes the signal on to whatever handled it before, like Node's handler for WebAssembly traps. Without
+	// one the default action is restored and the handler returns, faults then fire again and abort() raises again.
+	void chainSignal(const struct sigaction &previous, int signal, siginfo_t *info, void *context) {
+		if (previous.sa_flags & SA_SIGINFO) {
+			if (previous.sa_sigaction != nullptr) {
+				previous.sa_sigaction(signal, info, context);
+				return;
+			}
+		}
+		else if (previous.sa_handler != SIG_DFL && previous.sa_handler != SIG_IGN) {
+			previous.sa_handler(signal);
+			return;
+		}
+		struct sigaction action;
+		memset(&action, 0, sizeof(action));
+		action.sa_handler = SIG_DFL;
+		sigemptyset(&action.sa_mask);
+		sigaction(signal, &action, nullptr);
+	}
+
+	void crashHandler(int signal, siginfo_t *info, void *context) {
+#if defined(__linux__) || defined(__APPLE__)
+		// Out of bounds accesses to WebAssembly memory fault as well, V8 turns them into exceptions and the program goes on
+		if ((signal == SIGSEGV || signal == SIGBUS) && v8::TryHandleWebAssemblyTrapPosix(signal, info, context)) {
+			return;
+		}
+#endif
+		flushOnCrash();
+		for (size_t i = 0; i < sizeof(crashSignals) / sizeof(crashSignals[0]); ++i) {
+			if (crashSignals[i] == signal) {
+				chainSignal(previousActions[i], signal, info, context);
+			}
+		}
+	}
+
+	void installCrashHandlers() {
+		struct sigaction action;
+		memset(&action, 0, sizeof(action));
+		action.sa_sigaction = crashHandler;
+		action.sa_flags = SA_SIGINFO;
+		sigemptyset(&action.sa_mask);
+		for (size_t i = 0; i < sizeof(crashSignals) / sizeof(crashSignals[0]); ++i) {
+			sigaction(crashSignals[i], &action, &previousActions[i]);
+		}
+	}
+#endif
+}
+
+void startLogger(const char *filePath) {
+	if (started.load()) {
+		return;
+	}
+
+	for (size_t i = 0; i < ringSize; ++i) {
+		ring[i].sequence.store(i, std::memory_order_relaxed);
+		ring[i].longText = nullptr;
+	}
+	if (filePath != nullptr) {
+		logFile = fopen(filePath, "w");
+		if (logFile == nullptr) {
+			kinc_log(KINC_LOG_LEVEL_ERROR, "Could not open %s for logging.", filePath);
+		}
+#ifndef KORE_WINDOWS
+		else {
+			logFd = fileno(logFile);
+		}
+#endif
+	}
+
+	kinc_event_init(&writerEvent, true);
+	kinc_thread_init(&writerThread, writerThreadFunc, nullptr);
+	installCrashHandlers();
+	atexit(flushLogger);
+	started.store(true);
+}
+
+void logMessage(const char *format, va_list args) {
+	if (!started.load(std::memory_order_acquire)) {
+		va_list copy;
+		va_copy(copy, args);
+		int length = vsnprintf(nullptr, 0, format, copy);
+		va_end(copy);
+		std::string message(length > 0 ? length : 0, '\0');
+		vsnprintf(&message[0], message.size() + 1, format, args);
+		kinc_log(KINC_LOG_LEVEL_INFO, "%s", message.c_str());
+		return;
+	}
+
+	if (rateLimited()) {
+		drop();
+		return;
+	}
+	// A full ring means the writer can not keep up, wait for it rather than losing messages
+	while (!enqueue(format, args)) {
+		kinc_event_signal(&writerEvent);
+		std::this_thread::yield();
+	}
+	if (writerWaiting.load()) {
+		kinc_event_signal(&writerEvent);
+	}
+}
+
+void flushLogger() {
+	if (!started.load()) {
+		return;
+	}
+	while (!tryDrain(false)) {
+		std::this_thread::yield();
+	}
+}
+
+void setLogRateLimit(int messagesPerSecond) {
+	rateLimit.store(messagesPerSecond, std::memory_order_relaxed);
+}
+
+void loggerStats(KromLogStats *stats) {
+	stats->written = written.load(std::memory_order_relaxed);
+	stats->dropped = dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdarg.h>
+#include <stdint.h>
+
+struct KromLogStats {
+	uint64_t written;
+	uint64_t dropped; // over the rate limit
+};
+
+// Starts the writer thread. Messages go to filePath instead of the console when it is not nullptr, which is how --stdout is honored.
+// Everything logged before this is written synchronously.
+void startLogger(const char *filePath);
+
+// Formats the message on the calling thread and hands it to the writer, safe to call from any thread.
+// Only waits when the writer falls a whole ring behind.
+void logMessage(const char *format, va_list args);
+
+// Writes everything that is queued right now on the calling thread, used at exit and when crashing.
+void flushLogger();
+
+// Messages per second beyond which further messages are dropped, 0 disables the limit.
+void setLogRateLimit(int messagesPerSecond);
+void loggerStats(KromLogStats *stats);
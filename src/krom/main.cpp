@@ -65,17 +65,29 @@ args[0].As<Object>()->Set(env->isolate()->GetCurrentContext(), String::NewFromUt
 #include <kinc/log.h>
 #include <kinc/math/random.h>
 #include <kinc/system.h>
+#include <kinc/threads/event.h>
 #include <kinc/threads/mutex.h>
 #include <kinc/threads/thread.h>
 #include <kinc/window.h>
 
+#include "compressed.h"
 #include "debug.h"
 #include "debug_server.h"
+#include "font.h"
+#include "jobs.h"
+#include "logger.h"
+#include "mipmaps.h"
+#include "processes.h"
+#include "render_state.h"
+#include "streaming.h"
+#include "vertices.h"
 #include "worker.h"
 
 #include <algorithm>
 #include <assert.h>
+#include <atomic>
 #include <fstream>
+#include <limits.h>
 #include <map>
 #include <sstream>
 #include <stdarg.h>
@@ -83,6 +95,7 @@ args[0].As<Object>()->Set(env->isolate()->GetCurrentContext(), String::NewFromUt
 
 #ifdef KORE_WINDOWS
 #include <Windows.h> // AttachConsole
+#include <io.h>      // _commit
 #endif
 
 #ifndef KORE_WINDOWS
@@ -90,6 +103,7 @@ args[0].As<Object>()->Set(env->isolate()->GetCurrentContext(), String::NewFromUt
 #endif
 
 #include "env-inl.h"
+#include "memory_tracker-inl.h"
 #include "node_external_reference.h"
 #include "string_bytes.h"
 
@@ -106,6 +120,14 @@ args[0].As<Object>()->Set(env->isolate()->GetCurrentContext(), String::NewFromUt
 #include <cerrno>
 #include <cstring>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KROM_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define KROM_NEON
+#include <arm_neon.h>
+#endif
+
 using v8::Array;
 using v8::ArrayBuffer;
 using v8::Boolean;
@@ -128,11 +150,14 @@ using v8::Object;
 using v8::ObjectTemplate;
 using v8::String;
 using v8::TryCatch;
+using v8::TypedArray;
 using v8::Uint32Array;
 using v8::Value;
+using v8::WeakCallbackInfo;
+using v8::WeakCallbackType;
 
 const int KROM_API = 6;
-const int KROM_DEBUG_API = 2;
+const int KROM_DEBUG_API = 3;
 
 bool AttachProcess(HANDLE hmod);
 
@@ -186,6 +211,8 @@ kinc_mutex_t audioMutex;
 int audioSamples = 0;
 int audioReadLocation = 0;
 
+static node::Environment *globalEnv;
+
 void update();
 void updateAudio(kinc_a2_buffer_t *buffer, int samples);
 void dropFiles(wchar_t *filePath);
@@ -209,6 +236,8 @@ void penUp(int window, int x, int y, float pressure);
 void penMove(int window, int x, int y, float pressure);
 void gamepadAxis(int pad, int axis, float value);
 void gamepadButton(int pad, int button, float value);
+static void startStorageThread();
+static void startRenderState();
 
 const int tempStringSize = 1024 * 1024 - 1;
 char tempString[tempStringSize + 1];
@@ -218,9 +247,7 @@ char tempStringFS[tempStringSize + 1];
 JsPropertyIdRef buffer_id;
 
 void sendLogMessageArgs(const char *format, va_list args) {
-	char msg[4096];
-	vsnprintf(msg, sizeof(msg) - 2, format, args);
-	kinc_log(KINC_LOG_LEVEL_INFO, "%s", msg);
+	logMessage(format, args);
 
 	/*if (debugMode) {
 	  std::vector<int> message;
@@ -244,6 +271,14 @@ void sendLogMessage(const char *format, ...) {
 static void krom_init(const FunctionCallbackInfo<Value> &args) {
 	node::Environment *env = node::Environment::GetCurrent(args);
 
+	const char *logPath = nullptr;
+	for (size_t i = 0; i + 1 < env->argv().size(); ++i) {
+		if (env->argv()[i] == "--stdout") {
+			logPath = env->argv()[i + 1].c_str();
+		}
+	}
+	startLogger(logPath);
+
 	node::BufferValue title(env->isolate(), args[0]);
 	int width = args[1].As<Int32>()->Value();
 	int height = args[2].As<Int32>()->Value();
@@ -286,6 +321,12 @@ static void krom_init(const FunctionCallbackInfo<Value> &args) {
 	frame.samples_per_pixel = samplesPerPixel;
 	kinc_init(*title, width, height, &win, &frame);
 
+	startRenderState();
+
+	// Started here so that other threads, like the ones caching WebAssembly code, can submit jobs
+	startStorageThread();
+	startJobPool();
+
 	kinc_mutex_init(&mutex);
 	kinc_mutex_init(&audioMutex);
 	if (enableSound) {
@@ -326,7 +367,25 @@ static void krom_log(const FunctionCallbackInfo<Value> &args) {
 
 	node::Environment *env = node::Environment::GetCurrent(args);
 	node::BufferValue stringValue(env->isolate(), args[0]);
-	sendLogMessage(*stringValue);
+	sendLogMessage("%s", *stringValue);
+}
+
+static void krom_set_log_rate_limit(const FunctionCallbackInfo<Value> &args) {
+	setLogRateLimit(args[0].As<Int32>()->Value());
+}
+
+static void krom_get_log_stats(const FunctionCallbackInfo<Value> &args) {
+	node::Environment *env = node::Environment::GetCurrent(args);
+
+	KromLogStats stats;
+	loggerStats(&stats);
+
+	Local<Object> obj = Object::New(env->isolate());
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "written").ToLocalChecked(),
+	         Number::New(env->isolate(), (double)stats.written));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "dropped").ToLocalChecked(),
+	         Number::New(env->isolate(), (double)stats.dropped));
+	args.GetReturnValue().Set(obj);
 }
 
 static void krom_graphics_clear(const FunctionCallbackInfo<Value> &args) {
@@ -466,6 +525,456 @@ static void krom_set_audio_callback(const FunctionCallbackInfo<Value> &args) {
 	audioFunction.Reset(env->isolate(), Local<Function>::Cast(args[0]));
 }
 
+namespace {
+	int lastFrameFilteredCalls = 0;
+}
+
+// Where render_state.cpp sends the calls it does not filter
+static void kincSetPipeline(void *pipeline) {
+	kinc_g4_set_pipeline((kinc_g4_pipeline_t *)pipeline);
+}
+
+static void kincSetIndexBuffer(void *buffer) {
+	kinc_g4_set_index_buffer((kinc_g4_index_buffer_t *)buffer);
+}
+
+static void kincSetVertexBuffers(void **buffers, int count) {
+	if (count == 1) {
+		kinc_g4_set_vertex_buffer((kinc_g4_vertex_buffer_t *)buffers[0]);
+	}
+	else {
+		kinc_g4_set_vertex_buffers((kinc_g4_vertex_buffer_t **)buffers, count);
+	}
+}
+
+static void kincSetTexture(const void *unit, void *texture) {
+	kinc_g4_set_texture(*(const kinc_g4_texture_unit_t *)unit, (kinc_g4_texture_t *)texture);
+}
+
+static void kincSetTextureParameters(const void *unitData, const int parameters[5]) {
+	kinc_g4_texture_unit_t unit = *(const kinc_g4_texture_unit_t *)unitData;
+	kinc_g4_set_texture_addressing(unit, KINC_G4_TEXTURE_DIRECTION_U, (kinc_g4_texture_addressing_t)parameters[0]);
+	kinc_g4_set_texture_addressing(unit, KINC_G4_TEXTURE_DIRECTION_V, (kinc_g4_texture_addressing_t)parameters[1]);
+	kinc_g4_set_texture_minification_filter(unit, (kinc_g4_texture_filter_t)parameters[2]);
+	kinc_g4_set_texture_magnification_filter(unit, (kinc_g4_texture_filter_t)parameters[3]);
+	kinc_g4_set_texture_mipmap_filter(unit, (kinc_g4_mipmap_filter_t)parameters[4]);
+}
+
+static void kincSetUniform(const void *locationData, KromUniformType type, const void *data, int count) {
+	kinc_g4_constant_location_t location = *(const kinc_g4_constant_location_t *)locationData;
+	const int *ints = (const int *)data;
+	const float *from = (const float *)data;
+	switch (type) {
+	case KROM_UNIFORM_BOOL:
+		kinc_g4_set_bool(location, ints[0] != 0);
+		break;
+	case KROM_UNIFORM_INT:
+		kinc_g4_set_int(location, ints[0]);
+		break;
+	case KROM_UNIFORM_FLOAT:
+		kinc_g4_set_float(location, from[0]);
+		break;
+	case KROM_UNIFORM_FLOAT2:
+		kinc_g4_set_float2(location, from[0], from[1]);
+		break;
+	case KROM_UNIFORM_FLOAT3:
+		kinc_g4_set_float3(location, from[0], from[1], from[2]);
+		break;
+	case KROM_UNIFORM_FLOAT4:
+		kinc_g4_set_float4(location, from[0], from[1], from[2], from[3]);
+		break;
+	case KROM_UNIFORM_FLOATS:
+		kinc_g4_set_floats(location, (float *)from, count);
+		break;
+	case KROM_UNIFORM_MATRIX3: {
+		kinc_matrix3x3_t m;
+		for (int y = 0; y < 3; ++y) {
+			for (int x = 0; x < 3; ++x) {
+				kinc_matrix3x3_set(&m, x, y, from[y * 3 + x]);
+			}
+		}
+		kinc_g4_set_matrix3(location, &m);
+		break;
+	}
+	case KROM_UNIFORM_MATRIX4: {
+		kinc_matrix4x4_t m;
+		for (int y = 0; y < 4; ++y) {
+			for (int x = 0; x < 4; ++x) {
+				kinc_matrix4x4_set(&m, x, y, from[y * 4 + x]);
+			}
+		}
+		kinc_g4_set_matrix4(location, &m);
+		break;
+	}
+	}
+}
+
+static void startRenderState() {
+	static const KromRenderCalls calls = {kincSetPipeline, kincSetIndexBuffer, kincSetVertexBuffers, kincSetTexture, kincSetTextureParameters, kincSetUniform};
+	initRenderState(&calls, sizeof(kinc_g4_texture_unit_t), sizeof(kinc_g4_constant_location_t));
+}
+
+static void bindVertexBuffer(kinc_g4_vertex_buffer_t *buffer) {
+	void *buffers[1] = {buffer};
+	bindVertexBuffers(buffers, 1);
+}
+
+int formatByteSize(kinc_image_format_t format);
+
+static int renderTargetFormatByteSize(kinc_g4_render_target_format_t format) {
+	switch (format) {
+	case KINC_G4_RENDER_TARGET_FORMAT_128BIT_FLOAT:
+		return 16;
+	case KINC_G4_RENDER_TARGET_FORMAT_64BIT_FLOAT:
+		return 8;
+	case KINC_G4_RENDER_TARGET_FORMAT_16BIT_DEPTH:
+	case KINC_G4_RENDER_TARGET_FORMAT_16BIT_RED_FLOAT:
+		return 2;
+	case KINC_G4_RENDER_TARGET_FORMAT_8BIT_RED:
+		return 1;
+	case KINC_G4_RENDER_TARGET_FORMAT_32BIT:
+	case KINC_G4_RENDER_TARGET_FORMAT_32BIT_RED_FLOAT:
+	default:
+		return 4;
+	}
+}
+
+struct SpriteBatcher {
+	kinc_g4_vertex_buffer_t vertexBuffer;
+	kinc_g4_index_buffer_t indexBuffer;
+	int capacity; // in sprites
+};
+
+enum KromResourceType {
+	KROM_RESOURCE_TEXTURE,
+	KROM_RESOURCE_RENDER_TARGET,
+	KROM_RESOURCE_VERTEX_BUFFER,
+	KROM_RESOURCE_INDEX_BUFFER,
+	KROM_RESOURCE_SPRITE_BATCHER,
+	KROM_RESOURCE_FONT,
+	KROM_RESOURCE_STREAMING_TEXTURE
+};
+
+// Native side of a texture, render target or buffer wrapper. The size is reported to V8
+// as external memory so that the GC knows how much a wrapper is really holding on to.
+class KromResource : public node::MemoryRetainer {
+public:
+	Isolate *isolate;
+	KromResourceType type;
+	void *handle;
+	kinc_image_t *image; // CPU copy of readable textures
+	size_t size;
+	Global<Object> wrapper;
+
+	void MemoryInfo(node::MemoryTracker *tracker) const override {
+		tracker->TrackFieldWithSize("native", size, "KromNativeMemory");
+	}
+
+	std::string MemoryInfoName() const override {
+		switch (type) {
+		case KROM_RESOURCE_TEXTURE:
+			return "KromTexture";
+		case KROM_RESOURCE_RENDER_TARGET:
+			return "KromRenderTarget";
+		case KROM_RESOURCE_VERTEX_BUFFER:
+			return "KromVertexBuffer";
+		case KROM_RESOURCE_SPRITE_BATCHER:
+			return "KromSpriteBatcher";
+		case KROM_RESOURCE_FONT:
+			return "KromFont";
+		case KROM_RESOURCE_STREAMING_TEXTURE:
+			return "KromStreamingTexture";
+		case KROM_RESOURCE_INDEX_BUFFER:
+		default:
+			return "KromIndexBuffer";
+		}
+	}
+
+	size_t SelfSize() const override {
+		return sizeof(KromResource);
+	}
+
+	Local<Object> WrappedObject() const override {
+		return node::PersistentToLocal::Weak(isolate, wrapper);
+	}
+};
+
+namespace {
+	std::map<void *, KromResource *> resources;
+	std::vector<KromResource *> releasedResources;
+	bool embedderGraphCallbackAdded = false;
+	// Element formats of every vertex buffer, for uploadVertexArrays
+	std::map<kinc_g4_vertex_buffer_t *, std::vector<kinc_g4_vertex_data_t>> vertexLayouts;
+}
+
+static void destroyResource(KromResource *resource) {
+	switch (resource->type) {
+	case KROM_RESOURCE_TEXTURE:
+		kinc_g4_texture_destroy((kinc_g4_texture_t *)resource->handle);
+		break;
+	case KROM_RESOURCE_RENDER_TARGET:
+		kinc_g4_render_target_destroy((kinc_g4_render_target_t *)resource->handle);
+		break;
+	case KROM_RESOURCE_VERTEX_BUFFER:
+		kinc_g4_vertex_buffer_destroy((kinc_g4_vertex_buffer_t *)resource->handle);
+		vertexLayouts.erase((kinc_g4_vertex_buffer_t *)resource->handle);
+		break;
+	case KROM_RESOURCE_INDEX_BUFFER:
+		kinc_g4_index_buffer_destroy((kinc_g4_index_buffer_t *)resource->handle);
+		break;
+	case KROM_RESOURCE_SPRITE_BATCHER: {
+		SpriteBatcher *batcher = (SpriteBatcher *)resource->handle;
+		kinc_g4_vertex_buffer_destroy(&batcher->vertexBuffer);
+		kinc_g4_index_buffer_destroy(&batcher->indexBuffer);
+		break;
+	}
+	case KROM_RESOURCE_FONT:
+		// Frees itself once the glyph thread is done with it
+		destroyFont((KromFont *)resource->handle);
+		break;
+	case KROM_RESOURCE_STREAMING_TEXTURE:
+		// Same, with the load thread
+		destroyStreamingTexture(findStreamingTexture((kinc_g4_texture_t *)resource->handle));
+		break;
+	}
+	if (resource->type != KROM_RESOURCE_FONT && resource->type != KROM_RESOURCE_STREAMING_TEXTURE) {
+		free(resource->handle);
+	}
+
+	if (resource->image != nullptr) {
+		free(resource->image->data);
+		kinc_image_destroy(resource->image);
+		free(resource->image);
+	}
+
+	resource->isolate->AdjustAmountOfExternalAllocatedMemory(-(int64_t)resource->size);
+	delete resource;
+}
+
+static void buildEmbedderGraph(Isolate *isolate, v8::EmbedderGraph *graph, void *data) {
+	node::MemoryTracker tracker(isolate, graph);
+	for (std::map<void *, KromResource *>::iterator it = resources.begin(); it != resources.end(); ++it) {
+		tracker.Track(it->second);
+	}
+}
+
+// Runs inside of the GC, so the resource is only queued here and destroyed in releaseGarbageResources.
+static void resourceWeakCallback(const WeakCallbackInfo<KromResource> &info) {
+	KromResource *resource = info.GetParameter();
+	resource->wrapper.Reset();
+	resources.erase(resource->handle);
+	releasedResources.push_back(resource);
+}
+
+static void trackResource(Isolate *isolate, Local<Object> wrapper, KromResourceType type, void *handle, size_t size, kinc_image_t *image = nullptr) {
+	if (!embedderGraphCallbackAdded) {
+		isolate->GetHeapProfiler()->AddBuildEmbedderGraphCallback(buildEmbedderGraph, nullptr);
+		embedderGraphCallbackAdded = true;
+	}
+
+	KromResource *resource = new KromResource;
+	resource->isolate = isolate;
+	resource->type = type;
+	resource->handle = handle;
+	resource->image = image;
+	resource->size = size;
+	resource->wrapper.Reset(isolate, wrapper);
+	resource->wrapper.SetWeak(resource, resourceWeakCallback, WeakCallbackType::kParameter);
+	resources[handle] = resource;
+
+	isolate->AdjustAmountOfExternalAllocatedMemory((int64_t)size);
+}
+
+// Explicit deletes from Kha free the resource right away, the wrapper stays around but no longer owns anything.
+static void releaseResource(void *handle) {
+	std::map<void *, KromResource *>::iterator it = resources.find(handle);
+	if (it == resources.end()) {
+		return;
+	}
+	KromResource *resource = it->second;
+	resources.erase(it);
+	resource->wrapper.Reset();
+	destroyResource(resource);
+	invalidateGraphicsState();
+}
+
+// Called between frames when no kinc resources are bound anymore.
+static void releaseGarbageResources() {
+	if (releasedResources.size() > 0) {
+		invalidateGraphicsState();
+	}
+	for (size_t i = 0; i < releasedResources.size(); ++i) {
+		destroyResource(releasedResources[i]);
+	}
+	releasedResources.clear();
+}
+
+// Hot-reloaded textures get a new handle, the old one can still be in use by this frame's draws.
+static void replaceResourceHandle(void *oldHandle, void *newHandle, size_t oldSize, size_t newSize) {
+	std::map<void *, KromResource *>::iterator it = resources.find(oldHandle);
+	if (it == resources.end()) {
+		return;
+	}
+	KromResource *resource = it->second;
+	resources.erase(it);
+
+	KromResource *oldResource = new KromResource;
+	oldResource->isolate = resource->isolate;
+	oldResource->type = resource->type;
+	oldResource->handle = oldHandle;
+	oldResource->image = nullptr;
+	oldResource->size = oldSize;
+	releasedResources.push_back(oldResource);
+
+	resource->handle = newHandle;
+	resource->size = resource->size - oldSize + newSize;
+	resources[newHandle] = resource;
+	resource->isolate->AdjustAmountOfExternalAllocatedMemory((int64_t)newSize);
+}
+
+static size_t textureByteSize(kinc_g4_texture_t *texture) {
+	int depth = texture->tex_depth > 0 ? texture->tex_depth : 1;
+	return (size_t)formatByteSize(texture->format) * texture->tex_width * texture->tex_height * depth;
+}
+
+static size_t imageByteSize(kinc_image_t *image) {
+	int depth = image->depth > 0 ? image->depth : 1;
+	return (size_t)formatByteSize(image->format) * image->width * image->height * depth;
+}
+
+static size_t renderTargetByteSize(kinc_g4_render_target_t *renderTarget, kinc_g4_render_target_format_t format, int depthBufferBits, int stencilBufferBits,
+                                   int faces) {
+	size_t pixelSize = renderTargetFormatByteSize(format) + (depthBufferBits + stencilBufferBits) / 8;
+	return pixelSize * renderTarget->width * renderTarget->height * faces;
+}
+
+// Render targets handed out by acquireRenderTarget for intermediate passes. They go back to the pool when
+// released or at the end of the frame and are destroyed once nothing asked for that size for a while.
+// Their JS handles hold the number of the acquisition instead of a pointer, handles that are used after
+// the target went back to the pool resolve to nothing, see renderTargetFromObject.
+struct TransientRenderTarget {
+	kinc_g4_render_target_t *renderTarget;
+	int width, height, depthBufferBits, format, stencilBufferBits;
+	size_t size;
+	bool inUse;
+	int lastUsedFrame;
+	int64_t acquisition;
+};
+
+namespace {
+	const int transientRenderTargetFrames = 120;
+
+	std::vector<TransientRenderTarget> transientRenderTargets;
+	int transientFrame = 0;
+	int transientAcquires = 0;
+	int transientReuses = 0;
+	int transientAllocations = 0;
+	size_t transientBytes = 0;
+	size_t transientPeakBytes = 0;
+	size_t transientFramePeakBytes = 0; // of targets in use at the same time, this frame
+	size_t transientFrameBytes = 0;
+	size_t lastTransientFramePeakBytes = 0;
+	int64_t lastTransientAcquisition = 0; // stays exact as a JS number for 2^53 acquisitions
+}
+
+static TransientRenderTarget *acquireTransientRenderTarget(Isolate *isolate, int width, int height, int depthBufferBits, int format, int stencilBufferBits) {
+	++transientAcquires;
+	TransientRenderTarget *target = nullptr;
+	for (size_t i = 0; i < transientRenderTargets.size(); ++i) {
+		TransientRenderTarget *candidate = &transientRenderTargets[i];
+		if (!candidate->inUse && candidate->width == width && candidate->height == height && candidate->format == format &&
+		    candidate->depthBufferBits == depthBufferBits && candidate->stencilBufferBits == stencilBufferBits) {
+			target = candidate;
+			++transientReuses;
+			break;
+		}
+	}
+
+	if (target == nullptr) {
+		TransientRenderTarget created;
+		created.renderTarget = (kinc_g4_render_target_t *)malloc(sizeof(kinc_g4_render_target_t));
+		kinc_g4_render_target_init(created.renderTarget, width, height, depthBufferBits, false, (kinc_g4_render_target_format_t)format, stencilBufferBits, 0);
+		created.width = width;
+		created.height = height;
+		created.depthBufferBits = depthBufferBits;
+		created.format = format;
+		created.stencilBufferBits = stencilBufferBits;
+		created.size = renderTargetByteSize(created.renderTarget, (kinc_g4_render_target_format_t)format, depthBufferBits, stencilBufferBits, 1);
+		transientRenderTargets.push_back(created);
+		target = &transientRenderTargets.back();
+
+		++transientAllocations;
+		transientBytes += target->size;
+		transientPeakBytes = transientBytes > transientPeakBytes ? transientBytes : transientPeakBytes;
+		isolate->AdjustAmountOfExternalAllocatedMemory((int64_t)target->size);
+	}
+
+	target->inUse = true;
+	target->lastUsedFrame = transientFrame;
+	target->acquisition = ++lastTransientAcquisition;
+	transientFrameBytes += target->size;
+	transientFramePeakBytes = transientFrameBytes > transientFramePeakBytes ? transientFrameBytes : transientFramePeakBytes;
+	return target;
+}
+
+static TransientRenderTarget *findTransientRenderTarget(double acquisition) {
+	for (size_t i = 0; i < transientRenderTargets.size(); ++i) {
+		TransientRenderTarget *target = &transientRenderTargets[i];
+		if (target->inUse && (double)target->acquisition == acquisition) {
+			return target;
+		}
+	}
+	return nullptr;
+}
+
+// Returns a target to the pool before the frame ends, so that later passes of the same frame can use it.
+// Handles of earlier acquisitions are ignored.
+static void releaseTransientRenderTarget(double acquisition) {
+	TransientRenderTarget *target = findTransientRenderTarget(acquisition);
+	if (target != nullptr) {
+		target->inUse = false;
+		transientFrameBytes -= target->size;
+	}
+}
+
+// Returns nullptr for handles of transient render targets that went back to the pool.
+static kinc_g4_render_target_t *renderTargetFromObject(Local<Object> object) {
+	Local<Value> field = object->GetInternalField(0);
+	if (field->IsExternal()) {
+		return (kinc_g4_render_target_t *)field.As<External>()->Value();
+	}
+	TransientRenderTarget *target = findTransientRenderTarget(field.As<Number>()->Value());
+	return target != nullptr ? target->renderTarget : nullptr;
+}
+
+// Called between frames when no kinc resources are bound anymore.
+static void recycleTransientRenderTargets(Isolate *isolate) {
+	bool destroyed = false;
+	for (size_t i = 0; i < transientRenderTargets.size();) {
+		TransientRenderTarget *target = &transientRenderTargets[i];
+		target->inUse = false;
+		if (transientFrame - target->lastUsedFrame >= transientRenderTargetFrames) {
+			kinc_g4_render_target_destroy(target->renderTarget);
+			free(target->renderTarget);
+			transientBytes -= target->size;
+			isolate->AdjustAmountOfExternalAllocatedMemory(-(int64_t)target->size);
+			transientRenderTargets[i] = transientRenderTargets.back();
+			transientRenderTargets.pop_back();
+			destroyed = true;
+		}
+		else {
+			++i;
+		}
+	}
+	if (destroyed) {
+		invalidateGraphicsState();
+	}
+	lastTransientFramePeakBytes = transientFramePeakBytes;
+	transientFramePeakBytes = 0;
+	transientFrameBytes = 0;
+	++transientFrame;
+}
+
 static void krom_create_indexbuffer(const FunctionCallbackInfo<Value> &args) {
 	node::Environment *env = node::Environment::GetCurrent(args);
 
@@ -477,16 +986,14 @@ static void krom_create_indexbuffer(const FunctionCallbackInfo<Value> &args) {
 
 	Local<Object> obj = templ->NewInstance(env->isolate()->GetCurrentContext()).ToLocalChecked();
 	obj->SetInternalField(0, External::New(env->isolate(), buffer));
+	trackResource(env->isolate(), obj, KROM_RESOURCE_INDEX_BUFFER, buffer, kinc_g4_index_buffer_count(buffer) * sizeof(int));
 	args.GetReturnValue().Set(obj);
 }
 
 static void krom_delete_indexbuffer(const FunctionCallbackInfo<Value> &args) {
-	node::Environment *env = node::Environment::GetCurrent(args);
-
 	Local<External> field = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
 	kinc_g4_index_buffer_t *buffer = (kinc_g4_index_buffer_t *)field->Value();
-	kinc_g4_index_buffer_destroy(buffer);
-	free(buffer);
+	releaseResource(buffer);
 }
 
 static void do_not_actually_delete(void *data, size_t length, void *deleter_data) {}
@@ -497,6 +1004,7 @@ static void krom_lock_index_buffer(const FunctionCallbackInfo<Value> &args) {
 	Local<External> field = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
 	kinc_g4_index_buffer_t *buffer = (kinc_g4_index_buffer_t *)field->Value();
 	int *indices = kinc_g4_index_buffer_lock(buffer);
+	invalidateBufferState();
 
 	std::shared_ptr<v8::BackingStore> store =
 	    v8::ArrayBuffer::NewBackingStore(indices, kinc_g4_index_buffer_count(buffer) * sizeof(int), do_not_actually_delete, nullptr);
@@ -512,13 +1020,14 @@ static void krom_unlock_index_buffer(const FunctionCallbackInfo<Value> &args) {
 
 	kinc_g4_index_buffer_t *buffer = (kinc_g4_index_buffer_t *)field->Value();
 	kinc_g4_index_buffer_unlock(buffer);
+	invalidateBufferState();
 }
 
 static void krom_set_indexbuffer(const FunctionCallbackInfo<Value> &args) {
 	Local<External> field = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
 
 	kinc_g4_index_buffer_t *buffer = (kinc_g4_index_buffer_t *)field->Value();
-	kinc_g4_set_index_buffer(buffer);
+	bindIndexBuffer(buffer);
 }
 
 static kinc_g4_vertex_data_t convert_vertex_data(int kha_vertex_data) {
@@ -618,6 +1127,7 @@ static void krom_create_vertexbuffer(const FunctionCallbackInfo<Value> &args) {
 	                     ->Value();
 	kinc_g4_vertex_structure_t structure;
 	kinc_g4_vertex_structure_init(&structure);
+	std::vector<kinc_g4_vertex_data_t> layout;
 	for (int32_t i = 0; i < length; ++i) {
 		Local<Object> element = jsstructure->Get(env->isolate()->GetCurrentContext(), i).ToLocalChecked().As<Object>();
 		Local<Value> str = element->Get(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "name").ToLocalChecked()).ToLocalChecked();
@@ -629,19 +1139,21 @@ static void krom_create_vertexbuffer(const FunctionCallbackInfo<Value> &args) {
 		char *name = new char[256]; // TODO
 		strcpy(name, *utf8_value);
 		kinc_g4_vertex_structure_add(&structure, name, convert_vertex_data(data));
+		layout.push_back(convert_vertex_data(data));
 	}
 
 	kinc_g4_vertex_buffer_t *buffer = (kinc_g4_vertex_buffer_t *)malloc(sizeof(kinc_g4_vertex_buffer_t));
 	kinc_g4_vertex_buffer_init(buffer, args[0].As<Int32>()->Value(), &structure, (kinc_g4_usage_t)args[2].As<Int32>()->Value(), args[3].As<Int32>()->Value());
 	obj->SetInternalField(0, External::New(env->isolate(), buffer));
+	vertexLayouts[buffer] = layout;
+	trackResource(env->isolate(), obj, KROM_RESOURCE_VERTEX_BUFFER, buffer, (size_t)kinc_g4_vertex_buffer_count(buffer) * kinc_g4_vertex_buffer_stride(buffer));
 	args.GetReturnValue().Set(obj);
 }
 
 static void krom_delete_vertexbuffer(const FunctionCallbackInfo<Value> &args) {
 	Local<External> field = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
 	kinc_g4_vertex_buffer_t *buffer = (kinc_g4_vertex_buffer_t *)field->Value();
-	kinc_g4_vertex_buffer_destroy(buffer);
-	free(buffer);
+	releaseResource(buffer);
 }
 
 static void krom_lock_vertex_buffer(const FunctionCallbackInfo<Value> &args) {
@@ -652,6 +1164,7 @@ static void krom_lock_vertex_buffer(const FunctionCallbackInfo<Value> &args) {
 	int start = args[1].As<Int32>()->Value();
 	int count = args[2].As<Int32>()->Value();
 	float *vertices = kinc_g4_vertex_buffer_lock(buffer, start, count);
+	invalidateBufferState();
 
 	std::shared_ptr<v8::BackingStore> store =
 	    v8::ArrayBuffer::NewBackingStore(vertices, count * kinc_g4_vertex_buffer_stride(buffer), do_not_actually_delete, nullptr);
@@ -665,12 +1178,115 @@ static void krom_unlock_vertex_buffer(const FunctionCallbackInfo<Value> &args) {
 	int count = args[1].As<Int32>()->Value();
 	kinc_g4_vertex_buffer_t *buffer = (kinc_g4_vertex_buffer_t *)field->Value();
 	kinc_g4_vertex_buffer_unlock(buffer, count);
+	invalidateBufferState();
+}
+
+static bool vertexSource(Local<Value> value, KromVertexSource *source) {
+	if (!value->IsTypedArray()) {
+		return false;
+	}
+	if (value->IsFloat32Array()) {
+		source->type = KROM_VERTEX_SOURCE_FLOAT32;
+	}
+	else if (value->IsInt8Array()) {
+		source->type = KROM_VERTEX_SOURCE_INT8;
+	}
+	else if (value->IsUint8Array()) {
+		source->type = KROM_VERTEX_SOURCE_UINT8;
+	}
+	else if (value->IsInt16Array()) {
+		source->type = KROM_VERTEX_SOURCE_INT16;
+	}
+	else if (value->IsUint16Array()) {
+		source->type = KROM_VERTEX_SOURCE_UINT16;
+	}
+	else if (value->IsInt32Array()) {
+		source->type = KROM_VERTEX_SOURCE_INT32;
+	}
+	else if (value->IsUint32Array()) {
+		source->type = KROM_VERTEX_SOURCE_UINT32;
+	}
+	else {
+		return false;
+	}
+	Local<TypedArray> array = value.As<TypedArray>();
+	source->data = (uint8_t *)array->Buffer()->GetBackingStore()->Data() + array->ByteOffset();
+	source->length = array->Length();
+	return true;
+}
+
+// Takes one typed array per element of the vertex structure, in the same order, and packs them into the
+// buffer in its own formats without the interleaving and conversion happening in JavaScript.
+// Returns false and leaves the buffer alone when the arrays do not match the structure.
+static void krom_upload_vertex_arrays(const FunctionCallbackInfo<Value> &args) {
+	node::Environment *env = node::Environment::GetCurrent(args);
+
+	Local<External> field = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
+	kinc_g4_vertex_buffer_t *buffer = (kinc_g4_vertex_buffer_t *)field->Value();
+	std::map<kinc_g4_vertex_buffer_t *, std::vector<kinc_g4_vertex_data_t>>::iterator layout = vertexLayouts.find(buffer);
+	if (layout == vertexLayouts.end() || !args[1]->IsArray()) {
+		args.GetReturnValue().Set(false);
+		return;
+	}
+
+	Local<Array> arrays = args[1].As<Array>();
+	int elementCount = (int)layout->second.size();
+	if ((int)arrays->Length() != elementCount || elementCount == 0) {
+		args.GetReturnValue().Set(false);
+		return;
+	}
+	std::vector<KromVertexSource> sources(elementCount);
+	for (int i = 0; i < elementCount; ++i) {
+		if (!vertexSource(arrays->Get(env->isolate()->GetCurrentContext(), i).ToLocalChecked(), &sources[i])) {
+			args.GetReturnValue().Set(false);
+			return;
+		}
+	}
+
+	int start = args[2]->IsInt32() ? args[2].As<Int32>()->Value() : 0;
+	int count;
+	if (args[3]->IsInt32()) {
+		count = args[3].As<Int32>()->Value();
+	}
+	else {
+		int components = vertexDataComponents(layout->second[0]);
+		size_t length = components > 0 ? sources[0].length / components : 0;
+		count = length > INT_MAX ? INT_MAX : (int)length;
+	}
+	int stride = kinc_g4_vertex_buffer_stride(buffer);
+	// Compared without adding, start + count can overflow int
+	if (start < 0 || count < 0 || start > kinc_g4_vertex_buffer_count(buffer) || count > kinc_g4_vertex_buffer_count(buffer) - start ||
+	    !checkVertexSources(layout->second.data(), sources.data(), elementCount, count, stride)) {
+		args.GetReturnValue().Set(false);
+		return;
+	}
+
+	float *vertices = kinc_g4_vertex_buffer_lock(buffer, start, count);
+	packVertices(layout->second.data(), sources.data(), elementCount, count, (uint8_t *)vertices, stride);
+	kinc_g4_vertex_buffer_unlock(buffer, count);
+	invalidateBufferState();
+	args.GetReturnValue().Set(true);
+}
+
+static void krom_get_vertex_pack_stats(const FunctionCallbackInfo<Value> &args) {
+	node::Environment *env = node::Environment::GetCurrent(args);
+
+	KromVertexStats stats;
+	vertexStats(&stats);
+	Local<Object> obj = Object::New(env->isolate());
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "verticesPerSecond").ToLocalChecked(),
+	         Number::New(env->isolate(), stats.verticesPerSecond));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "packedBytes").ToLocalChecked(),
+	         Number::New(env->isolate(), (double)stats.packedBytes));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "float32Bytes").ToLocalChecked(),
+	         Number::New(env->isolate(), (double)stats.float32Bytes));
+	args.GetReturnValue().Set(obj);
 }
 
 static void krom_set_vertexbuffer(const FunctionCallbackInfo<Value> &args) {
 	Local<External> field = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
 	kinc_g4_vertex_buffer_t *buffer = (kinc_g4_vertex_buffer_t *)field->Value();
-	kinc_g4_set_vertex_buffer(buffer);
+	bindVertexBuffer(buffer);
 }
 
 static void krom_set_vertexbuffers(const FunctionCallbackInfo<Value> &args) {
@@ -690,7 +1306,7 @@ static void krom_set_vertexbuffers(const FunctionCallbackInfo<Value> &args) {
 		Local<External> bufferfield = Local<External>::Cast(bufferobj->GetInternalField(0));
 		vertexBuffers[i] = (kinc_g4_vertex_buffer_t *)bufferfield->Value();
 	}
-	kinc_g4_set_vertex_buffers(vertexBuffers, length);
+	bindVertexBuffers((void **)vertexBuffers, length);
 }
 
 static void krom_draw_indexed_vertices(const FunctionCallbackInfo<Value> &args) {
@@ -716,6 +1332,406 @@ static void krom_draw_indexed_vertices_instanced(const FunctionCallbackInfo<Valu
 	}
 }
 
+// Sprite records as written by Kha's graphics2 into a Float32Array, SPRITE_FLOATS per sprite.
+// The color is a Kha ARGB color stored bit-for-bit in a float slot.
+const int SPRITE_FLOATS = 18;
+const int SPRITE_IMAGE = 0;
+const int SPRITE_PIPELINE = 1;
+const int SPRITE_COLOR = 2;
+const int SPRITE_Z = 3;
+const int SPRITE_RECT = 4;      // x, y, width, height
+const int SPRITE_UV = 8;        // left, top, right, bottom
+const int SPRITE_TRANSFORM = 12; // _00, _10, _20, _01, _11, _21 of a FastMatrix3
+
+const int SPRITE_VERTEX_FLOATS = 9; // vertexPosition (float3), vertexUV (float2), vertexColor (float4)
+
+const int maxSpriteBatcherCapacity = 1 << 20; // keeps the vertex and index counts far from overflowing
+const int maxSpriteSlot = 0xffff;              // images and pipelines are 16 bits of the sort key
+
+namespace {
+	std::vector<uint64_t> spriteOrder;
+}
+
+// The image or pipeline index a sprite record holds, -1 when it is not one (negative, too large, NaN).
+static int spriteSlot(float value) {
+	return value >= 0.0f && value < maxSpriteSlot + 1.0f ? (int)value : -1;
+}
+
+// Writes the four corners in the order Kha's image painter uses (bottom left, top left, top right, bottom right).
+static void writeSpriteVertices(const float *sprite, float *out) {
+	uint32_t color;
+	memcpy(&color, &sprite[SPRITE_COLOR], sizeof(color));
+	float a = ((color >> 24) & 0xff) / 255.0f;
+	float r = ((color >> 16) & 0xff) / 255.0f;
+	float g = ((color >> 8) & 0xff) / 255.0f;
+	float b = (color & 0xff) / 255.0f;
+
+	float z = sprite[SPRITE_Z];
+	float left = sprite[SPRITE_RECT];
+	float top = sprite[SPRITE_RECT + 1];
+	float right = left + sprite[SPRITE_RECT + 2];
+	float bottom = top + sprite[SPRITE_RECT + 3];
+	const float *m = &sprite[SPRITE_TRANSFORM];
+
+	float u[4] = {sprite[SPRITE_UV], sprite[SPRITE_UV], sprite[SPRITE_UV + 2], sprite[SPRITE_UV + 2]};
+	float v[4] = {sprite[SPRITE_UV + 3], sprite[SPRITE_UV + 1], sprite[SPRITE_UV + 1], sprite[SPRITE_UV + 3]};
+	float x[4];
+	float y[4];
+
+#if defined(KROM_SSE2)
+	__m128 cornersX = _mm_setr_ps(left, left, right, right);
+	__m128 cornersY = _mm_setr_ps(bottom, top, top, bottom);
+	_mm_storeu_ps(x, _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[0]), cornersX), _mm_mul_ps(_mm_set1_ps(m[1]), cornersY)), _mm_set1_ps(m[2])));
+	_mm_storeu_ps(y, _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[3]), cornersX), _mm_mul_ps(_mm_set1_ps(m[4]), cornersY)), _mm_set1_ps(m[5])));
+	for (int i = 0; i < 4; ++i) {
+		_mm_storeu_ps(&out[i * SPRITE_VERTEX_FLOATS], _mm_setr_ps(x[i], y[i], z, u[i]));
+		_mm_storeu_ps(&out[i * SPRITE_VERTEX_FLOATS + 4], _mm_setr_ps(v[i], r, g, b));
+		out[i * SPRITE_VERTEX_FLOATS + 8] = a;
+	}
+#elif defined(KROM_NEON)
+	float cx[4] = {left, left, right, right};
+	float cy[4] = {bottom, top, top, bottom};
+	float32x4_t cornersX = vld1q_f32(cx);
+	float32x4_t cornersY = vld1q_f32(cy);
+	vst1q_f32(x, vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(m[2]), cornersX, m[0]), cornersY, m[1]));
+	vst1q_f32(y, vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(m[5]), cornersX, m[3]), cornersY, m[4]));
+	for (int i = 0; i < 4; ++i) {
+		float first[4] = {x[i], y[i], z, u[i]};
+		float second[4] = {v[i], r, g, b};
+		vst1q_f32(&out[i * SPRITE_VERTEX_FLOATS], vld1q_f32(first));
+		vst1q_f32(&out[i * SPRITE_VERTEX_FLOATS + 4], vld1q_f32(second));
+		out[i * SPRITE_VERTEX_FLOATS + 8] = a;
+	}
+#else
+	float cx[4] = {left, left, right, right};
+	float cy[4] = {bottom, top, top, bottom};
+	for (int i = 0; i < 4; ++i) {
+		x[i] = m[0] * cx[i] + m[1] * cy[i] + m[2];
+		y[i] = m[3] * cx[i] + m[4] * cy[i] + m[5];
+	}
+	for (int i = 0; i < 4; ++i) {
+		float *vertex = &out[i * SPRITE_VERTEX_FLOATS];
+		vertex[0] = x[i];
+		vertex[1] = y[i];
+		vertex[2] = z;
+		vertex[3] = u[i];
+		vertex[4] = v[i];
+		vertex[5] = r;
+		vertex[6] = g;
+		vertex[7] = b;
+		vertex[8] = a;
+	}
+#endif
+}
+
+static void krom_create_sprite_batcher(const FunctionCallbackInfo<Value> &args) {
+	node::Environment *env = node::Environment::GetCurrent(args);
+
+	int capacity = args[0].As<Int32>()->Value();
+	capacity = std::max(1, std::min(capacity, maxSpriteBatcherCapacity));
+
+	SpriteBatcher *batcher = (SpriteBatcher *)malloc(sizeof(SpriteBatcher));
+	batcher->capacity = capacity;
+
+	kinc_g4_vertex_structure_t structure;
+	kinc_g4_vertex_structure_init(&structure);
+	kinc_g4_vertex_structure_add(&structure, "vertexPosition", KINC_G4_VERTEX_DATA_F32_3X);
+	kinc_g4_vertex_structure_add(&structure, "vertexUV", KINC_G4_VERTEX_DATA_F32_2X);
+	kinc_g4_vertex_structure_add(&structure, "vertexColor", KINC_G4_VERTEX_DATA_F32_4X);
+	kinc_g4_vertex_buffer_init(&batcher->vertexBuffer, capacity * 4, &structure, KINC_G4_USAGE_DYNAMIC, 0);
+
+	// Every sprite is a quad, so the indices never change
+	kinc_g4_index_buffer_init(&batcher->indexBuffer, capacity * 6, KINC_G4_INDEX_BUFFER_FORMAT_32BIT, KINC_G4_USAGE_STATIC);
+	int *indices = kinc_g4_index_buffer_lock(&batcher->indexBuffer);
+	for (int i = 0; i < capacity; ++i) {
+		indices[i * 6 + 0] = i * 4 + 0;
+		indices[i * 6 + 1] = i * 4 + 1;
+		indices[i * 6 + 2] = i * 4 + 2;
+		indices[i * 6 + 3] = i * 4 + 0;
+		indices[i * 6 + 4] = i * 4 + 2;
+		indices[i * 6 + 5] = i * 4 + 3;
+	}
+	kinc_g4_index_buffer_unlock(&batcher->indexBuffer);
+	invalidateBufferState();
+
+	Local<ObjectTemplate> templ = ObjectTemplate::New(env->isolate());
+	templ->SetInternalFieldCount(1);
+
+	Local<Object> obj = templ->NewInstance(env->isolate()->GetCurrentContext()).ToLocalChecked();
+	obj->SetInternalField(0, External::New(env->isolate(), batcher));
+	trackResource(env->isolate(), obj, KROM_RESOURCE_SPRITE_BATCHER, batcher, (size_t)capacity * (4 * SPRITE_VERTEX_FLOATS * sizeof(float) + 6 * sizeof(int)));
+	args.GetReturnValue().Set(obj);
+}
+
+static void krom_delete_sprite_batcher(const FunctionCallbackInfo<Value> &args) {
+	Local<External> field = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
+	releaseResource(field->Value());
+}
+
+// Draws count sprite records with as few draw calls as possible. Consecutive sprites sharing image and pipeline
+// are merged into one draw. With sort set, sprites are additionally grouped by pipeline and image first, which
+// changes the draw order and is only correct when overlapping sprites do not depend on it.
+static void krom_draw_sprites(const FunctionCallbackInfo<Value> &args) {
+	node::Environment *env = node::Environment::GetCurrent(args);
+	Local<Context> context = env->isolate()->GetCurrentContext();
+
+	Local<External> batcherfield = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
+	SpriteBatcher *batcher = (SpriteBatcher *)batcherfield->Value();
+
+	Local<ArrayBuffer> buffer = Local<ArrayBuffer>::Cast(args[1]);
+	auto store = buffer->GetBackingStore();
+	const float *sprites = (const float *)store->Data();
+	int count = args[2].As<Int32>()->Value();
+	if (count > (int)(store->ByteLength() / (SPRITE_FLOATS * sizeof(float)))) {
+		count = (int)(store->ByteLength() / (SPRITE_FLOATS * sizeof(float)));
+	}
+	if (count <= 0) {
+		return;
+	}
+
+	Local<Object> images = args[3].As<Object>();
+	Local<Object> pipelines = args[4].As<Object>();
+	Local<Object> textureUnits = args[5].As<Object>();
+	bool sort = args[6].As<Boolean>()->Value();
+
+	spriteOrder.resize(count);
+	for (int i = 0; i < count; ++i) {
+		const float *sprite = &sprites[i * SPRITE_FLOATS];
+		// Invalid slots sort last, they are skipped when drawing
+		uint64_t key = ((uint64_t)(spriteSlot(sprite[SPRITE_PIPELINE]) & maxSpriteSlot) << 16) | (spriteSlot(sprite[SPRITE_IMAGE]) & maxSpriteSlot);
+		spriteOrder[i] = sort ? (key << 32) | (uint32_t)i : (uint32_t)i;
+	}
+	if (sort) {
+		// The sprite index in the low bits keeps the order stable
+		std::sort(spriteOrder.begin(), spriteOrder.end());
+	}
+
+	int lastImage = -1;
+	int lastPipeline = -1;
+	kinc_g4_texture_unit_t *unit = nullptr;
+
+	for (int chunkStart = 0; chunkStart < count; chunkStart += batcher->capacity) {
+		int chunkCount = std::min(batcher->capacity, count - chunkStart);
+
+		float *vertices = kinc_g4_vertex_buffer_lock(&batcher->vertexBuffer, 0, chunkCount * 4);
+		for (int i = 0; i < chunkCount; ++i) {
+			uint32_t index = (uint32_t)spriteOrder[chunkStart + i];
+			writeSpriteVertices(&sprites[index * SPRITE_FLOATS], &vertices[i * 4 * SPRITE_VERTEX_FLOATS]);
+		}
+		kinc_g4_vertex_buffer_unlock(&batcher->vertexBuffer, chunkCount * 4);
+		invalidateBufferState();
+
+		bindVertexBuffer(&batcher->vertexBuffer);
+		bindIndexBuffer(&batcher->indexBuffer);
+
+		int runStart = 0;
+		while (runStart < chunkCount) {
+			const float *first = &sprites[(uint32_t)spriteOrder[chunkStart + runStart] * SPRITE_FLOATS];
+			int image = spriteSlot(first[SPRITE_IMAGE]);
+			int pipeline = spriteSlot(first[SPRITE_PIPELINE]);
+
+			int runEnd = runStart + 1;
+			while (runEnd < chunkCount) {
+				const float *next = &sprites[(uint32_t)spriteOrder[chunkStart + runEnd] * SPRITE_FLOATS];
+				if (spriteSlot(next[SPRITE_IMAGE]) != image || spriteSlot(next[SPRITE_PIPELINE]) != pipeline) break;
+				++runEnd;
+			}
+
+			// Sprites with an image or pipeline that is not in the arrays are not drawn
+			Local<Value> pipelineobj, unitobj, imageobj;
+			if (pipeline < 0 || image < 0 || !pipelines->Get(context, pipeline).ToLocal(&pipelineobj) || !pipelineobj->IsObject() ||
+			    !textureUnits->Get(context, pipeline).ToLocal(&unitobj) || !unitobj->IsObject() || !images->Get(context, image).ToLocal(&imageobj) ||
+			    !imageobj->IsObject()) {
+				runStart = runEnd;
+				continue;
+			}
+
+			if (pipeline != lastPipeline) {
+				Local<External> pipelinefield = Local<External>::Cast(pipelineobj.As<Object>()->GetInternalField(0));
+				bindPipeline((kinc_g4_pipeline_t *)pipelinefield->Value());
+
+				Local<External> unitfield = Local<External>::Cast(unitobj.As<Object>()->GetInternalField(0));
+				unit = (kinc_g4_texture_unit_t *)unitfield->Value();
+				lastPipeline = pipeline;
+				lastImage = -1;
+			}
+
+			if (image != lastImage) {
+				Local<Value> rt = imageobj.As<Object>()->Get(context, String::NewFromUtf8(env->isolate(), "renderTarget_").ToLocalChecked()).ToLocalChecked();
+				if (!rt->IsNull() && !rt->IsUndefined()) {
+					kinc_g4_render_target_t *renderTarget = renderTargetFromObject(rt.As<Object>());
+					if (renderTarget != nullptr) {
+						forgetTexture(unit);
+						kinc_g4_render_target_use_color_as_texture(renderTarget, *unit);
+					}
+				}
+				else {
+					Local<Value> tex = imageobj.As<Object>()->Get(context, String::NewFromUtf8(env->isolate(), "texture_").ToLocalChecked()).ToLocalChecked();
+					Local<External> texfield = Local<External>::Cast(tex.As<Object>()->GetInternalField(0));
+					bindTexture(unit, (kinc_g4_texture_t *)texfield->Value());
+				}
+				lastImage = image;
+			}
+
+			kinc_g4_draw_indexed_vertices_from_to(runStart * 6, (runEnd - runStart) * 6);
+			runStart = runEnd;
+		}
+	}
+}
+
+namespace {
+	std::vector<uint16_t> textScratch;
+	std::vector<KromGlyphQuad> glyphScratch;
+}
+
+static int readText(Isolate *isolate, Local<Value> value) {
+	Local<String> text = value.As<String>();
+	int length = text->Length();
+	textScratch.resize(length + 1);
+	text->Write(isolate, textScratch.data(), 0, length, String::NO_NULL_TERMINATION);
+	return length;
+}
+
+static void krom_create_font(const FunctionCallbackInfo<Value> &args) {
+	node::Environment *env = node::Environment::GetCurrent(args);
+
+	Local<ArrayBuffer> buffer = Local<ArrayBuffer>::Cast(args[0]);
+	auto store = buffer->GetBackingStore();
+	int atlasWidth = args[1].As<Int32>()->Value();
+	int atlasHeight = args[2].As<Int32>()->Value();
+
+	KromFont *font = createFont(store->Data(), store->ByteLength(), atlasWidth, atlasHeight);
+	if (font == nullptr) {
+		sendLogMessage("Could not parse font, only TrueType outlines are supported.");
+		args.GetReturnValue().Set(Null(env->isolate()));
+		return;
+	}
+
+	Local<ObjectTemplate> templ = ObjectTemplate::New(env->isolate());
+	templ->SetInternalFieldCount(1);
+
+	Local<Object> obj = templ->NewInstance(env->isolate()->GetCurrentContext()).ToLocalChecked();
+	obj->SetInternalField(0, External::New(env->isolate(), font));
+	trackResource(env->isolate(), obj, KROM_RESOURCE_FONT, font, fontByteSize(font));
+	args.GetReturnValue().Set(obj);
+}
+
+static void krom_delete_font(const FunctionCallbackInfo<Value> &args) {
+	Local<External> field = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
+	releaseResource(field->Value());
+}
+
+// The atlas belongs to the font, the returned texture must not outlive it
+static void krom_get_font_atlas(const FunctionCallbackInfo<Value> &args) {
+	node::Environment *env = node::Environment::GetCurrent(args);
+
+	Local<External> field = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
+	KromFont *font = (KromFont *)field->Value();
+
+	Local<ObjectTemplate> templ = ObjectTemplate::New(env->isolate());
+	templ->SetInternalFieldCount(1);
+
+	Local<Object> obj = templ->NewInstance(env->isolate()->GetCurrentContext()).ToLocalChecked();
+	obj->SetInternalField(0, External::New(env->isolate(), fontAtlas(font)));
+	args.GetReturnValue().Set(obj);
+}
+
+static void krom_get_font_metrics(const FunctionCallbackInfo<Value> &args) {
+	node::Environment *env = node::Environment::GetCurrent(args);
+
+	Local<External> field = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
+	KromFont *font = (KromFont *)field->Value();
+	float size = (float)args[1].As<Number>()->Value();
+
+	float ascent, descent, lineGap;
+	fontMetrics(font, size, &ascent, &descent, &lineGap);
+
+	Local<Object> obj = Object::New(env->isolate());
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "ascent").ToLocalChecked(), Number::New(env->isolate(), ascent));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "descent").ToLocalChecked(), Number::New(env->isolate(), descent));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "lineGap").ToLocalChecked(), Number::New(env->isolate(), lineGap));
+	args.GetReturnValue().Set(obj);
+}
+
+static void krom_get_text_width(const FunctionCallbackInfo<Value> &args) {
+	node::Environment *env = node::Environment::GetCurrent(args);
+
+	Local<External> field = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
+	KromFont *font = (KromFont *)field->Value();
+	float size = (float)args[1].As<Number>()->Value();
+	int length = readText(env->isolate(), args[2]);
+
+	args.GetReturnValue().Set(Number::New(env->isolate(), textWidth(font, size, textScratch.data(), length)));
+}
+
+// Writes sprite records for drawSprites starting at record offset and returns how many were written.
+// The records use the font's atlas as image and identity transforms.
+static void krom_layout_text(const FunctionCallbackInfo<Value> &args) {
+	node::Environment *env = node::Environment::GetCurrent(args);
+
+	Local<External> field = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
+	KromFont *font = (KromFont *)field->Value();
+	float size = (float)args[1].As<Number>()->Value();
+	int length = readText(env->isolate(), args[2]);
+	float x = (float)args[3].As<Number>()->Value();
+	float y = (float)args[4].As<Number>()->Value();
+	uint32_t color = (uint32_t)args[5].As<Int32>()->Value();
+
+	Local<ArrayBuffer> buffer = Local<ArrayBuffer>::Cast(args[6]);
+	auto store = buffer->GetBackingStore();
+	int offset = args[7].As<Int32>()->Value();
+	float image = (float)args[8].As<Int32>()->Value();
+	float pipeline = (float)args[9].As<Int32>()->Value();
+
+	int capacity = (int)(store->ByteLength() / (SPRITE_FLOATS * sizeof(float))) - offset;
+	if (capacity <= 0) {
+		args.GetReturnValue().Set(0);
+		return;
+	}
+
+	glyphScratch.resize(length);
+	int count = layoutText(font, size, textScratch.data(), length, x, y, glyphScratch.data(), std::min(length, capacity));
+
+	float *records = (float *)store->Data() + offset * SPRITE_FLOATS;
+	for (int i = 0; i < count; ++i) {
+		const KromGlyphQuad &quad = glyphScratch[i];
+		float *record = &records[i * SPRITE_FLOATS];
+		record[SPRITE_IMAGE] = image;
+		record[SPRITE_PIPELINE] = pipeline;
+		memcpy(&record[SPRITE_COLOR], &color, sizeof(color));
+		record[SPRITE_Z] = 0.0f;
+		record[SPRITE_RECT] = quad.x;
+		record[SPRITE_RECT + 1] = quad.y;
+		record[SPRITE_RECT + 2] = quad.width;
+		record[SPRITE_RECT + 3] = quad.height;
+		record[SPRITE_UV] = quad.u0;
+		record[SPRITE_UV + 1] = quad.v0;
+		record[SPRITE_UV + 2] = quad.u1;
+		record[SPRITE_UV + 3] = quad.v1;
+		record[SPRITE_TRANSFORM] = 1.0f;
+		record[SPRITE_TRANSFORM + 1] = 0.0f;
+		record[SPRITE_TRANSFORM + 2] = 0.0f;
+		record[SPRITE_TRANSFORM + 3] = 0.0f;
+		record[SPRITE_TRANSFORM + 4] = 1.0f;
+		record[SPRITE_TRANSFORM + 5] = 0.0f;
+	}
+	args.GetReturnValue().Set(count);
+}
+
+static void krom_get_font_stats(const FunctionCallbackInfo<Value> &args) {
+	node::Environment *env = node::Environment::GetCurrent(args);
+
+	KromFontStats stats;
+	fontStats(&stats);
+
+	Local<Object> obj = Object::New(env->isolate());
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "glyphsPerSecond").ToLocalChecked(),
+	         Number::New(env->isolate(), stats.glyphsPerSecond));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "uploadBytes").ToLocalChecked(),
+	         Number::New(env->isolate(), (double)stats.uploadBytes));
+	args.GetReturnValue().Set(obj);
+}
+
 static std::string replace(std::string str, char a, char b) {
 	for (size_t i = 0; i < str.size(); ++i) {
 		if (str[i] == a) str[i] = b;
@@ -870,6 +1886,7 @@ static void krom_create_pipeline(const FunctionCallbackInfo<Value> &args) {
 static void krom_delete_pipeline(const FunctionCallbackInfo<Value> &args) {
 	Local<External> field = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
 	kinc_g4_pipeline_t *pipeline = (kinc_g4_pipeline_t *)field->Value();
+	forgetPipeline(pipeline);
 	kinc_g4_pipeline_destroy(pipeline);
 	free(pipeline);
 }
@@ -1146,6 +2163,7 @@ static void krom_compile_pipeline(const FunctionCallbackInfo<Value> &args) {
 	        .As<Boolean>()
 	        ->Value();
 
+	forgetPipeline(pipeline);
 	kinc_g4_pipeline_compile(pipeline);
 }
 
@@ -1251,7 +2269,7 @@ static void krom_set_pipeline(const FunctionCallbackInfo<Value> &args) {
 		}
 	}
 
-	kinc_g4_set_pipeline(pipeline);
+	bindPipeline(pipeline);
 }
 
 static void krom_load_image(const FunctionCallbackInfo<Value> &args) {
@@ -1259,14 +2277,35 @@ static void krom_load_image(const FunctionCallbackInfo<Value> &args) {
 
 	String::Utf8Value filename(env->isolate(), args[0]);
 	bool readable = args[1].As<Boolean>()->Value();
+	KromMipmapFilter mipmapFilter = args.Length() > 2 ? (KromMipmapFilter)args[2].As<Int32>()->Value() : KROM_MIPMAP_NONE;
+	bool srgb = args.Length() > 3 && args[3].As<Boolean>()->Value();
 
 	kinc_image_t image;
-	size_t size = kinc_image_size_from_file(*filename);
-	void *memory = malloc(size);
-	kinc_image_init_from_file(&image, memory, *filename);
-
 	kinc_g4_texture_t *texture = (kinc_g4_texture_t *)malloc(sizeof(kinc_g4_texture_t));
-	kinc_g4_texture_init_from_image(texture, &image);
+	size_t size;
+	void *memory;
+	size_t gpuSize;
+	if (isCompressedImageFile(*filename)) {
+		// Brings its own mip chain
+		if (!loadCompressedTexture(*filename, texture, &image, readable, &gpuSize)) {
+			free(texture);
+			return;
+		}
+		memory = image.data;
+		size = readable ? imageByteSize(&image) : 0;
+		invalidateTextureState();
+	}
+	else {
+		size = kinc_image_size_from_file(*filename);
+		memory = malloc(size);
+		kinc_image_init_from_file(&image, memory, *filename);
+
+		kinc_g4_texture_init_from_image(texture, &image);
+		if (generateMipmapChain(texture, &image, mipmapFilter, srgb) > 0) {
+			invalidateTextureState();
+		}
+		gpuSize = textureByteSize(texture);
+	}
 
 	Local<ObjectTemplate> templ = ObjectTemplate::New(env->isolate());
 	templ->SetInternalFieldCount(1);
@@ -1281,20 +2320,154 @@ static void krom_load_image(const FunctionCallbackInfo<Value> &args) {
 	         Int32::New(env->isolate(), texture->tex_height));
 	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "filename").ToLocalChecked(), args[0]);
 
-	if (readable) {
-		kinc_image_t *imagePtr = (kinc_image_t *)malloc(sizeof(kinc_image_t));
-		memcpy(imagePtr, &image, sizeof(image));
+	if (readable) {
+		kinc_image_t *imagePtr = (kinc_image_t *)malloc(sizeof(kinc_image_t));
+		memcpy(imagePtr, &image, sizeof(image));
+
+		Local<Object> imageObject = templ->NewInstance(env->isolate()->GetCurrentContext()).ToLocalChecked();
+		imageObject->SetInternalField(0, External::New(env->isolate(), imagePtr));
+
+		obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "image").ToLocalChecked(), imageObject);
+		trackResource(env->isolate(), obj, KROM_RESOURCE_TEXTURE, texture, gpuSize + size, imagePtr);
+	}
+	else {
+		kinc_image_destroy(&image);
+		free(memory);
+		trackResource(env->isolate(), obj, KROM_RESOURCE_TEXTURE, texture, gpuSize);
+	}
+
+	args.GetReturnValue().Set(obj);
+}
+
+static void krom_load_streaming_image(const FunctionCallbackInfo<Value> &args) {
+	node::Environment *env = node::Environment::GetCurrent(args);
+
+	String::Utf8Value filename(env->isolate(), args[0]);
+	int startSize = args.Length() > 1 ? args[1].As<Int32>()->Value() : 64;
+	bool srgb = args.Length() > 2 && args[2].As<Boolean>()->Value();
+
+	KromStreamingTexture *streaming = createStreamingTexture(*filename, startSize, srgb);
+	if (streaming == nullptr) {
+		return;
+	}
+	int width, height;
+	streamingTextureSize(streaming, &width, &height);
+
+	Local<ObjectTemplate> templ = ObjectTemplate::New(env->isolate());
+	templ->SetInternalFieldCount(1);
+
+	Local<Object> obj = templ->NewInstance(env->isolate()->GetCurrentContext()).ToLocalChecked();
+	obj->SetInternalField(0, External::New(env->isolate(), streamingTextureHandle(streaming)));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "width").ToLocalChecked(), Int32::New(env->isolate(), width));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "height").ToLocalChecked(), Int32::New(env->isolate(), height));
+	// The resident levels change, the full size is what texture coordinates refer to
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "realWidth").ToLocalChecked(), Int32::New(env->isolate(), width));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "realHeight").ToLocalChecked(), Int32::New(env->isolate(), height));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "filename").ToLocalChecked(), args[0]);
+
+	trackResource(env->isolate(), obj, KROM_RESOURCE_STREAMING_TEXTURE, streamingTextureHandle(streaming), streamingTextureByteSize(streaming));
+	args.GetReturnValue().Set(obj);
+}
+
+static void krom_set_streaming_hints(const FunctionCallbackInfo<Value> &args) {
+	Local<External> field = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
+	KromStreamingTexture *streaming = findStreamingTexture((kinc_g4_texture_t *)field->Value());
+	if (streaming == nullptr) {
+		return;
+	}
+	int priority = args[1].As<Int32>()->Value();
+	int finestLevel = args.Length() > 2 ? args[2].As<Int32>()->Value() : 0;
+	setStreamingHints(streaming, priority, finestLevel);
+}
+
+static void krom_set_texture_budget(const FunctionCallbackInfo<Value> &args) {
+	double bytes = args[0].As<Number>()->Value();
+	setTextureBudget(bytes > 0.0 ? (size_t)bytes : 0);
+}
+
+static void krom_get_streaming_stats(const FunctionCallbackInfo<Value> &args) {
+	node::Environment *env = node::Environment::GetCurrent(args);
+
+	KromStreamingStats stats;
+	streamingStats(&stats);
+	Local<Object> obj = Object::New(env->isolate());
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "textures").ToLocalChecked(), Int32::New(env->isolate(), stats.textures));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "loadsInFlight").ToLocalChecked(),
+	         Int32::New(env->isolate(), stats.loadsInFlight));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "loads").ToLocalChecked(), Int32::New(env->isolate(), stats.loads));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "evictions").ToLocalChecked(), Int32::New(env->isolate(), stats.evictions));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "residentBytes").ToLocalChecked(),
+	         Number::New(env->isolate(), (double)stats.residentBytes));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "committedBytes").ToLocalChecked(),
+	         Number::New(env->isolate(), (double)stats.committedBytes));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "cpuBytes").ToLocalChecked(), Number::New(env->isolate(), (double)stats.cpuBytes));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "budget").ToLocalChecked(), Number::New(env->isolate(), (double)stats.budget));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "loadSeconds").ToLocalChecked(), Number::New(env->isolate(), stats.loadSeconds));
+	args.GetReturnValue().Set(obj);
+}
+
+static void krom_get_mipmap_stats(const FunctionCallbackInfo<Value> &args) {
+	node::Environment *env = node::Environment::GetCurrent(args);
+
+	KromMipmapStats stats;
+	mipmapStats(&stats);
+	Local<Object> obj = Object::New(env->isolate());
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "megapixelsPerSecond").ToLocalChecked(),
+	         Number::New(env->isolate(), stats.megapixelsPerSecond));
+	args.GetReturnValue().Set(obj);
+}
+
+static void krom_get_compressed_texture_stats(const FunctionCallbackInfo<Value> &args) {
+	node::Environment *env = node::Environment::GetCurrent(args);
+
+	KromCompressedStats stats;
+	compressedStats(&stats);
+	Local<Object> obj = Object::New(env->isolate());
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "nativeTextures").ToLocalChecked(),
+	         Int32::New(env->isolate(), stats.nativeTextures));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "transcodedTextures").ToLocalChecked(),
+	         Int32::New(env->isolate(), stats.transcodedTextures));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "fileBytes").ToLocalChecked(), Number::New(env->isolate(), stats.fileBytes));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "gpuBytes").ToLocalChecked(), Number::New(env->isolate(), stats.gpuBytes));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "loadSeconds").ToLocalChecked(), Number::New(env->isolate(), stats.loadSeconds));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "transcodeSeconds").ToLocalChecked(),
+	         Number::New(env->isolate(), stats.transcodeSeconds));
+	args.GetReturnValue().Set(obj);
+}
 
-		Local<Object> imageObject = templ->NewInstance(env->isolate()->GetCurrentContext()).ToLocalChecked();
-		obj->SetInternalField(0, External::New(env->isolate(), imagePtr));
+// Decodes a DDS or KTX2 file given as an ArrayBuffer to RGBA32 without touching the GPU, returns null when it can not be decoded.
+static void krom_transcode_image(const FunctionCallbackInfo<Value> &args) {
+	node::Environment *env = node::Environment::GetCurrent(args);
 
-		obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "image").ToLocalChecked(), imageObject);
+	Local<ArrayBuffer> buffer = Local<ArrayBuffer>::Cast(args[0]);
+	auto store = buffer->GetBackingStore();
+
+	KromCompressedImage image;
+	if (!parseCompressedImage((const uint8_t *)store->Data(), store->ByteLength(), &image)) {
+		args.GetReturnValue().SetNull();
+		return;
 	}
-	else {
-		kinc_image_destroy(&image);
-		free(memory);
+	std::shared_ptr<v8::BackingStore> pixels = v8::ArrayBuffer::NewBackingStore(env->isolate(), (size_t)image.width * image.height * 4);
+	if (!transcodeCompressedLevel(&image, 0, (uint8_t *)pixels->Data())) {
+		args.GetReturnValue().SetNull();
+		return;
+	}
+	size_t compressedSize = 0;
+	size_t decodedSize = 0;
+	for (int i = 0; i < image.levelCount; ++i) {
+		compressedSize += image.levels[i].size;
+		decodedSize += (size_t)image.levels[i].width * image.levels[i].height * 4;
 	}
 
+	Local<Object> obj = Object::New(env->isolate());
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "width").ToLocalChecked(), Int32::New(env->isolate(), image.width));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "height").ToLocalChecked(), Int32::New(env->isolate(), image.height));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "levels").ToLocalChecked(), Int32::New(env->isolate(), image.levelCount));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "compressedBytes").ToLocalChecked(),
+	         Number::New(env->isolate(), (double)compressedSize));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "decodedBytes").ToLocalChecked(),
+	         Number::New(env->isolate(), (double)decodedSize));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "pixels").ToLocalChecked(), ArrayBuffer::New(env->isolate(), pixels));
 	args.GetReturnValue().Set(obj);
 }
 
@@ -1309,25 +2482,16 @@ static void krom_unload_image(const FunctionCallbackInfo<Value> &args) {
 
 	if (tex->IsObject()) {
 		Local<External> texfield = Local<External>::Cast(tex.As<Object>()->GetInternalField(0));
-		kinc_g4_texture_t *texture = (kinc_g4_texture_t *)texfield->Value();
-		kinc_g4_texture_destroy(texture);
-		free(texture);
-
-		Local<Value> imageObj =
-		    tex.As<Object>()->Get(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "image").ToLocalChecked()).ToLocalChecked();
-		if (imageObj->IsNull() || imageObj->IsUndefined()) {
-			Local<External> field = Local<External>::Cast(imageObj.As<Object>()->GetInternalField(0));
-			kinc_image_t *image = (kinc_image_t *)field->Value();
-			free(image->data);
-			kinc_image_destroy(image);
-			free(image);
-		}
+		releaseResource(texfield->Value());
 	}
 	else if (rt->IsObject()) {
-		Local<External> rtfield = Local<External>::Cast(rt.As<Object>()->GetInternalField(0));
-		kinc_g4_render_target_t *renderTarget = (kinc_g4_render_target_t *)rtfield->Value();
-		kinc_g4_render_target_destroy(renderTarget);
-		free(renderTarget);
+		Local<Value> rtfield = rt.As<Object>()->GetInternalField(0);
+		if (rtfield->IsExternal()) {
+			releaseResource(rtfield.As<External>()->Value());
+		}
+		else {
+			releaseTransientRenderTarget(rtfield.As<Number>()->Value());
+		}
 	}
 }
 
@@ -1446,7 +2610,9 @@ static void krom_set_texture(const FunctionCallbackInfo<Value> &args) {
 		String::Utf8Value filename(
 		    env->isolate(),
 		    args[1].As<Object>()->Get(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "filename").ToLocalChecked()).ToLocalChecked());
-		if (imageChanges[*filename]) {
+		Local<External> texfield = Local<External>::Cast(args[1].As<Object>()->GetInternalField(0));
+		// Streaming textures read the file again with every load
+		if (imageChanges[*filename] && findStreamingTexture((kinc_g4_texture_t *)texfield->Value()) == nullptr) {
 			imageChanges[*filename] = false;
 			sendLogMessage("Image %s changed.", *filename);
 
@@ -1459,6 +2625,11 @@ static void krom_set_texture(const FunctionCallbackInfo<Value> &args) {
 
 			texture = (kinc_g4_texture_t *)malloc(sizeof(kinc_g4_texture_t));
 			kinc_g4_texture_init_from_image(texture, &image);
+			kinc_image_destroy(&image);
+			free(memory);
+
+			kinc_g4_texture_t *oldTexture = (kinc_g4_texture_t *)texfield->Value();
+			replaceResourceHandle(oldTexture, texture, textureByteSize(oldTexture), textureByteSize(texture));
 
 			args[1].As<Object>()->SetInternalField(0, External::New(env->isolate(), texture));
 			imageChanged = true;
@@ -1468,15 +2639,17 @@ static void krom_set_texture(const FunctionCallbackInfo<Value> &args) {
 		Local<External> texfield = Local<External>::Cast(args[1].As<Object>()->GetInternalField(0));
 		texture = (kinc_g4_texture_t *)texfield->Value();
 	}
-	kinc_g4_set_texture(*unit, texture);
+	touchStreamingTexture(texture);
+	bindTexture(unit, texture);
 }
 
 static void krom_set_render_target(const FunctionCallbackInfo<Value> &args) {
 	Local<External> unitfield = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
 	kinc_g4_texture_unit_t *unit = (kinc_g4_texture_unit_t *)unitfield->Value();
 
-	Local<External> rtfield = Local<External>::Cast(args[1].As<Object>()->GetInternalField(0));
-	kinc_g4_render_target_t *renderTarget = (kinc_g4_render_target_t *)rtfield->Value();
+	kinc_g4_render_target_t *renderTarget = renderTargetFromObject(args[1].As<Object>());
+	if (renderTarget == nullptr) return;
+	forgetTexture(unit);
 	kinc_g4_render_target_use_color_as_texture(renderTarget, *unit);
 }
 
@@ -1484,8 +2657,9 @@ static void krom_set_texture_depth(const FunctionCallbackInfo<Value> &args) {
 	Local<External> unitfield = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
 	kinc_g4_texture_unit_t *unit = (kinc_g4_texture_unit_t *)unitfield->Value();
 
-	Local<External> rtfield = Local<External>::Cast(args[1].As<Object>()->GetInternalField(0));
-	kinc_g4_render_target_t *renderTarget = (kinc_g4_render_target_t *)rtfield->Value();
+	kinc_g4_render_target_t *renderTarget = renderTargetFromObject(args[1].As<Object>());
+	if (renderTarget == nullptr) return;
+	forgetTexture(unit);
 	kinc_g4_render_target_use_depth_as_texture(renderTarget, *unit);
 }
 
@@ -1495,6 +2669,7 @@ static void krom_set_image_texture(const FunctionCallbackInfo<Value> &args) {
 
 	Local<External> texfield = Local<External>::Cast(args[1].As<Object>()->GetInternalField(0));
 	kinc_g4_texture_t *texture = (kinc_g4_texture_t *)texfield->Value();
+	forgetTexture(unit);
 	kinc_g4_set_image_texture(*unit, texture);
 }
 
@@ -1508,11 +2683,8 @@ static void krom_set_texture_parameters(const FunctionCallbackInfo<Value> &args)
 	int max = args[4].As<Int32>()->Value();
 	int mip = args[5].As<Int32>()->Value();
 
-	kinc_g4_set_texture_addressing(*unit, KINC_G4_TEXTURE_DIRECTION_U, (kinc_g4_texture_addressing_t)u);
-	kinc_g4_set_texture_addressing(*unit, KINC_G4_TEXTURE_DIRECTION_V, (kinc_g4_texture_addressing_t)v);
-	kinc_g4_set_texture_minification_filter(*unit, (kinc_g4_texture_filter_t)min);
-	kinc_g4_set_texture_magnification_filter(*unit, (kinc_g4_texture_filter_t)max);
-	kinc_g4_set_texture_mipmap_filter(*unit, (kinc_g4_mipmap_filter_t)mip);
+	int parameters[5] = {u, v, min, max, mip};
+	bindTextureParameters(unit, parameters);
 }
 
 static void krom_set_texture_3d_parameters(const FunctionCallbackInfo<Value> &args) {
@@ -1556,8 +2728,8 @@ static void krom_set_bool(const FunctionCallbackInfo<Value> &args) {
 	Local<External> locfield = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
 	kinc_g4_constant_location_t *location = (kinc_g4_constant_location_t *)locfield->Value();
 
-	bool value = args[1].As<Boolean>()->Value();
-	kinc_g4_set_bool(*location, value);
+	int value = args[1].As<Boolean>()->Value() ? 1 : 0;
+	bindUniform(location, KROM_UNIFORM_BOOL, &value, 1);
 }
 
 static void krom_set_int(const FunctionCallbackInfo<Value> &args) {
@@ -1565,7 +2737,7 @@ static void krom_set_int(const FunctionCallbackInfo<Value> &args) {
 	kinc_g4_constant_location_t *location = (kinc_g4_constant_location_t *)locfield->Value();
 
 	int value = args[1].As<Int32>()->Value();
-	kinc_g4_set_int(*location, value);
+	bindUniform(location, KROM_UNIFORM_INT, &value, 1);
 }
 
 static void krom_set_float(const FunctionCallbackInfo<Value> &args) {
@@ -1573,7 +2745,7 @@ static void krom_set_float(const FunctionCallbackInfo<Value> &args) {
 	kinc_g4_constant_location_t *location = (kinc_g4_constant_location_t *)locfield->Value();
 
 	float value = (float)args[1].As<Number>()->Value();
-	kinc_g4_set_float(*location, value);
+	bindUniform(location, KROM_UNIFORM_FLOAT, &value, 1);
 }
 
 static void krom_set_float2(const FunctionCallbackInfo<Value> &args) {
@@ -1582,7 +2754,8 @@ static void krom_set_float2(const FunctionCallbackInfo<Value> &args) {
 
 	float value1 = (float)args[1].As<Number>()->Value();
 	float value2 = (float)args[2].As<Number>()->Value();
-	kinc_g4_set_float2(*location, value1, value2);
+	float values[2] = {value1, value2};
+	bindUniform(location, KROM_UNIFORM_FLOAT2, values, 1);
 }
 
 static void krom_set_float3(const FunctionCallbackInfo<Value> &args) {
@@ -1592,7 +2765,8 @@ static void krom_set_float3(const FunctionCallbackInfo<Value> &args) {
 	float value1 = (float)args[1].As<Number>()->Value();
 	float value2 = (float)args[2].As<Number>()->Value();
 	float value3 = (float)args[3].As<Number>()->Value();
-	kinc_g4_set_float3(*location, value1, value2, value3);
+	float values[3] = {value1, value2, value3};
+	bindUniform(location, KROM_UNIFORM_FLOAT3, values, 1);
 }
 
 static void krom_set_float4(const FunctionCallbackInfo<Value> &args) {
@@ -1603,7 +2777,8 @@ static void krom_set_float4(const FunctionCallbackInfo<Value> &args) {
 	float value2 = (float)args[2].As<Number>()->Value();
 	float value3 = (float)args[3].As<Number>()->Value();
 	float value4 = (float)args[4].As<Number>()->Value();
-	kinc_g4_set_float4(*location, value1, value2, value3, value4);
+	float values[4] = {value1, value2, value3, value4};
+	bindUniform(location, KROM_UNIFORM_FLOAT4, values, 1);
 }
 
 static void krom_set_floats(const FunctionCallbackInfo<Value> &args) {
@@ -1615,7 +2790,7 @@ static void krom_set_floats(const FunctionCallbackInfo<Value> &args) {
 
 	float *from = (float *)store->Data();
 
-	kinc_g4_set_floats(*location, from, int(store->ByteLength() / 4));
+	bindUniform(location, KROM_UNIFORM_FLOATS, from, int(store->ByteLength() / 4));
 }
 
 static void krom_set_matrix(const FunctionCallbackInfo<Value> &args) {
@@ -1626,25 +2801,7 @@ static void krom_set_matrix(const FunctionCallbackInfo<Value> &args) {
 	auto store = buffer->GetBackingStore();
 
 	float *from = (float *)store->Data();
-	kinc_matrix4x4_t m;
-	kinc_matrix4x4_set(&m, 0, 0, from[0]);
-	kinc_matrix4x4_set(&m, 1, 0, from[1]);
-	kinc_matrix4x4_set(&m, 2, 0, from[2]);
-	kinc_matrix4x4_set(&m, 3, 0, from[3]);
-	kinc_matrix4x4_set(&m, 0, 1, from[4]);
-	kinc_matrix4x4_set(&m, 1, 1, from[5]);
-	kinc_matrix4x4_set(&m, 2, 1, from[6]);
-	kinc_matrix4x4_set(&m, 3, 1, from[7]);
-	kinc_matrix4x4_set(&m, 0, 2, from[8]);
-	kinc_matrix4x4_set(&m, 1, 2, from[9]);
-	kinc_matrix4x4_set(&m, 2, 2, from[10]);
-	kinc_matrix4x4_set(&m, 3, 2, from[11]);
-	kinc_matrix4x4_set(&m, 0, 3, from[12]);
-	kinc_matrix4x4_set(&m, 1, 3, from[13]);
-	kinc_matrix4x4_set(&m, 2, 3, from[14]);
-	kinc_matrix4x4_set(&m, 3, 3, from[15]);
-
-	kinc_g4_set_matrix4(*location, &m);
+	bindUniform(location, KROM_UNIFORM_MATRIX4, from, 1);
 }
 
 static void krom_set_matrix3(const FunctionCallbackInfo<Value> &args) {
@@ -1655,18 +2812,7 @@ static void krom_set_matrix3(const FunctionCallbackInfo<Value> &args) {
 	auto store = buffer->GetBackingStore();
 
 	float *from = (float *)store->Data();
-	kinc_matrix3x3_t m;
-	kinc_matrix3x3_set(&m, 0, 0, from[0]);
-	kinc_matrix3x3_set(&m, 1, 0, from[1]);
-	kinc_matrix3x3_set(&m, 2, 0, from[2]);
-	kinc_matrix3x3_set(&m, 0, 1, from[3]);
-	kinc_matrix3x3_set(&m, 1, 1, from[4]);
-	kinc_matrix3x3_set(&m, 2, 1, from[5]);
-	kinc_matrix3x3_set(&m, 0, 2, from[6]);
-	kinc_matrix3x3_set(&m, 1, 2, from[7]);
-	kinc_matrix3x3_set(&m, 2, 2, from[8]);
-
-	kinc_g4_set_matrix3(*location, &m);
+	bindUniform(location, KROM_UNIFORM_MATRIX3, from, 1);
 }
 
 static void krom_get_time(const FunctionCallbackInfo<Value> &args) {
@@ -1749,17 +2895,400 @@ static void krom_read_storage(const FunctionCallbackInfo<Value> &args) {
 	kinc_file_reader_t reader;
 	if (!kinc_file_reader_open(&reader, *filename, KINC_FILE_TYPE_SAVE)) return;
 
-	void *buffer = malloc(kinc_file_reader_size(&reader));
+	std::shared_ptr<v8::BackingStore> store = v8::ArrayBuffer::NewBackingStore(env->isolate(), kinc_file_reader_size(&reader));
 
-	kinc_file_reader_read(&reader, buffer, kinc_file_reader_size(&reader));
+	kinc_file_reader_read(&reader, store->Data(), kinc_file_reader_size(&reader));
 	kinc_file_reader_close(&reader);
 
-	std::shared_ptr<v8::BackingStore> store = v8::ArrayBuffer::NewBackingStore(buffer, kinc_file_reader_size(&reader), do_not_actually_delete, nullptr);
 	Local<ArrayBuffer> abuffer = ArrayBuffer::New(env->isolate(), store);
 
 	args.GetReturnValue().Set(abuffer);
 }
 
+static void freeStorageData(void *data, size_t length, void *deleterData) {
+	free(data);
+}
+
+// Asynchronous storage. Requests are handled in order by one IO thread so that a read always sees earlier writes
+// to the same file. Writes go to a temporary file which replaces the target only once it is completely on disk,
+// a crash in between leaves the previous save intact. Writes to the same file within one frame are merged and
+// only the last one reaches the disk.
+struct StorageJob {
+	bool write;
+	std::string path;
+	std::shared_ptr<v8::BackingStore> data; // what to write, only released on the main thread
+	void *result;                           // what was read, malloced
+	size_t resultSize;
+	bool success;
+	std::vector<Global<Function>> callbacks;
+};
+
+namespace {
+	kinc_thread_t storageThread;
+	bool storageThreadStarted = false;
+	bool storageThreadStopping = false;
+	kinc_mutex_t storageMutex;
+	kinc_event_t storageEvent;
+	std::vector<StorageJob *> storageQueue;
+	std::vector<StorageJob *> finishedStorageJobs;
+	std::map<std::string, StorageJob *> pendingStorageWrites;
+}
+
+static bool writeFileAtomically(const std::string &path, const void *data, size_t size) {
+	std::string temp = path + ".tmp";
+	FILE *file = fopen(temp.c_str(), "wb");
+	if (file == nullptr) {
+		return false;
+	}
+	bool success = fwrite(data, 1, size, file) == size && fflush(file) == 0;
+#ifdef KORE_WINDOWS
+	success = success && _commit(_fileno(file)) == 0;
+#else
+	success = success && fsync(fileno(file)) == 0;
+#endif
+	success = fclose(file) == 0 && success;
+	if (!success) {
+		remove(temp.c_str());
+		return false;
+	}
+#ifdef KORE_WINDOWS
+	return MoveFileExA(temp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	return rename(temp.c_str(), path.c_str()) == 0;
+#endif
+}
+
+static void readFile(StorageJob *job) {
+	FILE *file = fopen(job->path.c_str(), "rb");
+	if (file == nullptr) {
+		return;
+	}
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if (size >= 0) {
+		job->result = malloc(size > 0 ? size : 1);
+		job->resultSize = fread(job->result, 1, size, file);
+		job->success = job->resultSize == (size_t)size;
+	}
+	fclose(file);
+}
+
+static void storageThreadFunc(void *) {
+	std::vector<StorageJob *> jobs;
+	for (;;) {
+		kinc_event_wait(&storageEvent);
+
+		kinc_mutex_lock(&storageMutex);
+		jobs.swap(storageQueue);
+		bool stopping = storageThreadStopping;
+		kinc_mutex_unlock(&storageMutex);
+
+		for (size_t i = 0; i < jobs.size(); ++i) {
+			StorageJob *job = jobs[i];
+			if (job->write) {
+				job->success = writeFileAtomically(job->path, job->data->Data(), job->data->ByteLength());
+			}
+			else {
+				readFile(job);
+			}
+
+			kinc_mutex_lock(&storageMutex);
+			finishedStorageJobs.push_back(job);
+			kinc_mutex_unlock(&storageMutex);
+		}
+		jobs.clear();
+		if (stopping) {
+			return;
+		}
+	}
+}
+
+static void startStorageThread() {
+	if (!storageThreadStarted) {
+		kinc_mutex_init(&storageMutex);
+		kinc_event_init(&storageEvent, true);
+		kinc_thread_init(&storageThread, storageThreadFunc, nullptr);
+		storageThreadStarted = true;
+	}
+}
+
+static void submitStorageJob(StorageJob *job) {
+	startStorageThread();
+	kinc_mutex_lock(&storageMutex);
+	storageQueue.push_back(job);
+	kinc_mutex_unlock(&storageMutex);
+	kinc_event_signal(&storageEvent);
+}
+
+static StorageJob *createStorageJob(bool write, const std::string &path) {
+	StorageJob *job = new StorageJob;
+	job->write = write;
+	job->path = path;
+	job->result = nullptr;
+	job->resultSize = 0;
+	job->success = false;
+	return job;
+}
+
+// Called at the end of a frame, everything written during the frame goes to disk now.
+static void flushStorageWrites() {
+	for (std::map<std::string, StorageJob *>::iterator it = pendingStorageWrites.begin(); it != pendingStorageWrites.end(); ++it) {
+		submitStorageJob(it->second);
+	}
+	pendingStorageWrites.clear();
+}
+
+// Writes everything that is still queued and waits for it, the callbacks are not called anymore.
+static void stopStorageThread() {
+	flushStorageWrites();
+	if (!storageThreadStarted || storageThreadStopping) {
+		return;
+	}
+	kinc_mutex_lock(&storageMutex);
+	storageThreadStopping = true;
+	kinc_mutex_unlock(&storageMutex);
+	kinc_event_signal(&storageEvent);
+	kinc_thread_wait_and_destroy(&storageThread);
+}
+
+static void finishStorageJobs() {
+	if (!storageThreadStarted) {
+		return;
+	}
+
+	std::vector<StorageJob *> jobs;
+	kinc_mutex_lock(&storageMutex);
+	jobs.swap(finishedStorageJobs);
+	kinc_mutex_unlock(&storageMutex);
+
+	Isolate *isolate = globalEnv->isolate();
+	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
+	for (size_t i = 0; i < jobs.size(); ++i) {
+		StorageJob *job = jobs[i];
+		Local<Value> result;
+		if (job->write) {
+			result = Boolean::New(isolate, job->success);
+		}
+		else if (job->success) {
+			std::shared_ptr<v8::BackingStore> store = ArrayBuffer::NewBackingStore(job->result, job->resultSize, freeStorageData, nullptr);
+			result = ArrayBuffer::New(isolate, store);
+		}
+		else {
+			free(job->result);
+			result = Null(isolate);
+		}
+
+		for (size_t j = 0; j < job->callbacks.size(); ++j) {
+			TryCatch tryCatch(isolate);
+			Local<Function> callback = Local<Function>::New(isolate, job->callbacks[j]);
+			if (callback->Call(context, context->Global(), 1, &result).IsEmpty()) {
+				v8::String::Utf8Value stackTrace(isolate, tryCatch.StackTrace(context).ToLocalChecked());
+				sendLogMessage("Trace: %s", *stackTrace);
+			}
+		}
+		delete job;
+	}
+}
+
+static void addStorageCallback(StorageJob *job, Isolate *isolate, Local<Value> callback) {
+	if (callback->IsFunction()) {
+		job->callbacks.push_back(Global<Function>(isolate, callback.As<Function>()));
+	}
+}
+
+static void queueStorageWrite(Isolate *isolate, const std::string &path, Local<Value> buffer, Local<Value> callback) {
+	StorageJob *job;
+	std::map<std::string, StorageJob *>::iterator it = pendingStorageWrites.find(path);
+	if (it != pendingStorageWrites.end()) {
+		job = it->second;
+	}
+	else {
+		job = createStorageJob(true, path);
+		pendingStorageWrites[path] = job;
+	}
+	// The buffer is written as is, without a copy, so it must not be modified before the callback ran
+	job->data = buffer.As<ArrayBuffer>()->GetBackingStore();
+	addStorageCallback(job, isolate, callback);
+}
+
+static void queueStorageRead(Isolate *isolate, const std::string &path, Local<Value> callback) {
+	std::map<std::string, StorageJob *>::iterator it = pendingStorageWrites.find(path);
+	if (it != pendingStorageWrites.end()) {
+		submitStorageJob(it->second);
+		pendingStorageWrites.erase(it);
+	}
+	StorageJob *job = createStorageJob(false, path);
+	addStorageCallback(job, isolate, callback);
+	submitStorageJob(job);
+}
+
+static void krom_write_storage_async(const FunctionCallbackInfo<Value> &args) {
+	node::Environment *env = node::Environment::GetCurrent(args);
+	node::Utf8Value filename(env->isolate(), args[0]);
+	queueStorageWrite(env->isolate(), std::string(kinc_internal_save_path()) + *filename, args[1], args[2]);
+}
+
+static void krom_read_storage_async(const FunctionCallbackInfo<Value> &args) {
+	node::Environment *env = node::Environment::GetCurrent(args);
+	node::Utf8Value filename(env->isolate(), args[0]);
+	queueStorageRead(env->isolate(), std::string(kinc_internal_save_path()) + *filename, args[1]);
+}
+
+static void krom_file_save_bytes_async(const FunctionCallbackInfo<Value> &args) {
+	node::Environment *env = node::Environment::GetCurrent(args);
+	node::Utf8Value filename(env->isolate(), args[0]);
+	queueStorageWrite(env->isolate(), *filename, args[1], args[2]);
+}
+
+namespace {
+	std::atomic<int> wasmCacheHits{0};
+	std::atomic<int> wasmCacheMisses{0};
+	std::atomic<int> wasmCacheStores{0};
+}
+
+// Not cryptographic, but the cache only ever sees modules the game itself ships
+static void hashWasmBytes(const uint8_t *data, size_t size, uint64_t *a, uint64_t *b) {
+	*a = 0xcbf29ce484222325ull ^ size;
+	*b = 0x9e3779b97f4a7c15ull ^ size;
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t word;
+		memcpy(&word, &data[i], 8);
+		*a = (*a ^ word) * 0x100000001b3ull;
+		*a ^= *a >> 32;
+		*b = (*b ^ word) * 0xff51afd7ed558ccdull;
+		*b ^= *b >> 29;
+	}
+	for (; i < size; ++i) {
+		*a = (*a ^ data[i]) * 0x100000001b3ull;
+		*b = (*b ^ data[i]) * 0xff51afd7ed558ccdull;
+	}
+}
+
+// Serialized code only fits the V8 version that produced it, so that is part of the name
+static std::string wasmCachePath(const uint8_t *data, size_t size) {
+	const char *savePath = kinc_internal_save_path();
+	if (savePath == nullptr || savePath[0] == 0) {
+		return std::string();
+	}
+	uint64_t a, b;
+	hashWasmBytes(data, size, &a, &b);
+	char name[64];
+	snprintf(name, sizeof(name), "wasm-%016llx%016llx-", (unsigned long long)a, (unsigned long long)b);
+	return std::string(savePath) + name + v8::V8::GetVersion() + ".cache";
+}
+
+static void deleteWasmCacheData(void *data, size_t length, void *deleterData) {
+	delete[](uint8_t *) data;
+}
+
+// Called once the optimized code is ready, possibly on a compiler thread. V8 only calls it for modules it compiled,
+// never for deserialized ones, so when cached bytes were offered they failed to deserialize and the hit that was
+// counted for them becomes a miss. The stale file is overwritten, or deleted if there is nothing to replace it.
+class WasmCacheClient : public v8::WasmStreaming::Client {
+public:
+	WasmCacheClient(const std::string &path, bool cacheOffered) : path(path), cacheOffered(cacheOffered) {}
+
+	void OnModuleCompiled(v8::CompiledWasmModule compiledModule) override {
+		if (cacheOffered) {
+			--wasmCacheHits;
+			++wasmCacheMisses;
+		}
+		v8::OwnedBuffer serialized;
+		if (storageThreadStarted) {
+			serialized = compiledModule.Serialize();
+		}
+		if (serialized.size == 0) {
+			if (cacheOffered) {
+				remove(path.c_str());
+			}
+			return;
+		}
+		StorageJob *job = createStorageJob(true, path);
+		job->data = ArrayBuffer::NewBackingStore((void *)serialized.buffer.release(), serialized.size, deleteWasmCacheData, nullptr);
+		submitStorageJob(job);
+		++wasmCacheStores;
+	}
+
+private:
+	std::string path;
+	bool cacheOffered;
+};
+
+// Backs WebAssembly.compileStreaming and instantiateStreaming, which Krom feeds with ArrayBuffers or views
+// instead of fetch responses. Modules compiled before are deserialized from the save path.
+static void wasmStreamingCallback(const FunctionCallbackInfo<Value> &args) {
+	Isolate *isolate = args.GetIsolate();
+	std::shared_ptr<v8::WasmStreaming> streaming = v8::WasmStreaming::Unpack(isolate, args.Data());
+
+	std::shared_ptr<v8::BackingStore> store;
+	const uint8_t *bytes;
+	size_t size;
+	if (args[0]->IsArrayBufferView()) {
+		Local<v8::ArrayBufferView> view = args[0].As<v8::ArrayBufferView>();
+		store = view->Buffer()->GetBackingStore();
+		bytes = (const uint8_t *)store->Data() + view->ByteOffset();
+		size = view->ByteLength();
+	}
+	else if (args[0]->IsArrayBuffer()) {
+		store = args[0].As<ArrayBuffer>()->GetBackingStore();
+		bytes = (const uint8_t *)store->Data();
+		size = store->ByteLength();
+	}
+	else {
+		streaming->Abort(v8::Exception::TypeError(
+		    String::NewFromUtf8(isolate, "Krom compiles WebAssembly from an ArrayBuffer or a typed array").ToLocalChecked()));
+		return;
+	}
+
+	std::string path = wasmCachePath(bytes, size);
+	StorageJob cached;
+	cached.path = path;
+	cached.result = nullptr;
+	cached.resultSize = 0;
+	cached.success = false;
+	if (!path.empty()) {
+		readFile(&cached);
+	}
+
+	// The cached bytes only have to outlive Finish, which deserializes right away. SetCompiledModuleBytes only checks
+	// the header, so the hit is tentative until the client reports a compile instead.
+	bool cacheOffered = false;
+	if (cached.success) {
+		cacheOffered = streaming->SetCompiledModuleBytes((const uint8_t *)cached.result, cached.resultSize);
+		if (!cacheOffered) {
+			remove(path.c_str());
+		}
+	}
+	if (cacheOffered) {
+		++wasmCacheHits;
+	}
+	else {
+		++wasmCacheMisses;
+	}
+	if (!path.empty()) {
+		streaming->SetClient(std::make_shared<WasmCacheClient>(path, cacheOffered));
+	}
+	streaming->OnBytesReceived(bytes, size);
+	streaming->Finish();
+	free(cached.result);
+}
+
+static void krom_get_wasm_cache_stats(const FunctionCallbackInfo<Value> &args) {
+	node::Environment *env = node::Environment::GetCurrent(args);
+
+	Local<Object> obj = Object::New(env->isolate());
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "hits").ToLocalChecked(),
+	         Int32::New(env->isolate(), wasmCacheHits.load()));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "misses").ToLocalChecked(),
+	         Int32::New(env->isolate(), wasmCacheMisses.load()));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "stores").ToLocalChecked(),
+	         Int32::New(env->isolate(), wasmCacheStores.load()));
+	args.GetReturnValue().Set(obj);
+}
+
 static void krom_create_render_target(const FunctionCallbackInfo<Value> &args) {
 	node::Environment *env = node::Environment::GetCurrent(args);
 
@@ -1777,7 +3306,35 @@ static void krom_create_render_target(const FunctionCallbackInfo<Value> &args) {
 
 	Local<Object> obj = templ->NewInstance(env->isolate()->GetCurrentContext()).ToLocalChecked();
 	obj->SetInternalField(0, External::New(env->isolate(), renderTarget));
+	trackResource(env->isolate(), obj, KROM_RESOURCE_RENDER_TARGET, renderTarget,
+	              renderTargetByteSize(renderTarget, (kinc_g4_render_target_format_t)value4, value3, value5, 1));
+
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "width").ToLocalChecked(),
+	         Int32::New(env->isolate(), renderTarget->width));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "height").ToLocalChecked(),
+	         Int32::New(env->isolate(), renderTarget->height));
+
+	args.GetReturnValue().Set(obj);
+}
 
+// Like createRenderTarget, but the target only lives until unloadImage or the end of the frame and is pooled.
+static void krom_acquire_render_target(const FunctionCallbackInfo<Value> &args) {
+	node::Environment *env = node::Environment::GetCurrent(args);
+
+	int value1 = args[0].As<Int32>()->Value();
+	int value2 = args[1].As<Int32>()->Value();
+	int value3 = args[2].As<Int32>()->Value();
+	int value4 = args[3].As<Int32>()->Value();
+	int value5 = args[4].As<Int32>()->Value();
+
+	TransientRenderTarget *target = acquireTransientRenderTarget(env->isolate(), value1, value2, value3, value4, value5);
+	kinc_g4_render_target_t *renderTarget = target->renderTarget;
+
+	Local<ObjectTemplate> templ = ObjectTemplate::New(env->isolate());
+	templ->SetInternalFieldCount(1);
+
+	Local<Object> obj = templ->NewInstance(env->isolate()->GetCurrentContext()).ToLocalChecked();
+	obj->SetInternalField(0, Number::New(env->isolate(), (double)target->acquisition));
 	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "width").ToLocalChecked(),
 	         Int32::New(env->isolate(), renderTarget->width));
 	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "height").ToLocalChecked(),
@@ -1786,6 +3343,26 @@ static void krom_create_render_target(const FunctionCallbackInfo<Value> &args) {
 	args.GetReturnValue().Set(obj);
 }
 
+static void krom_get_render_target_pool_stats(const FunctionCallbackInfo<Value> &args) {
+	node::Environment *env = node::Environment::GetCurrent(args);
+
+	Local<Object> obj = Object::New(env->isolate());
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "acquires").ToLocalChecked(), Int32::New(env->isolate(), transientAcquires));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "reuses").ToLocalChecked(), Int32::New(env->isolate(), transientReuses));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "allocations").ToLocalChecked(),
+	         Int32::New(env->isolate(), transientAllocations));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "reuseRate").ToLocalChecked(),
+	         Number::New(env->isolate(), transientAcquires > 0 ? (double)transientReuses / transientAcquires : 0.0));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "pooled").ToLocalChecked(),
+	         Int32::New(env->isolate(), (int)transientRenderTargets.size()));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "bytes").ToLocalChecked(), Number::New(env->isolate(), (double)transientBytes));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "peakBytes").ToLocalChecked(),
+	         Number::New(env->isolate(), (double)transientPeakBytes));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "lastFramePeakBytes").ToLocalChecked(),
+	         Number::New(env->isolate(), (double)lastTransientFramePeakBytes));
+	args.GetReturnValue().Set(obj);
+}
+
 static void krom_create_render_target_cube_map(const FunctionCallbackInfo<Value> &args) {
 	node::Environment *env = node::Environment::GetCurrent(args);
 
@@ -1802,6 +3379,8 @@ static void krom_create_render_target_cube_map(const FunctionCallbackInfo<Value>
 
 	Local<Object> obj = templ->NewInstance(env->isolate()->GetCurrentContext()).ToLocalChecked();
 	obj->SetInternalField(0, External::New(env->isolate(), renderTarget));
+	trackResource(env->isolate(), obj, KROM_RESOURCE_RENDER_TARGET, renderTarget,
+	              renderTargetByteSize(renderTarget, (kinc_g4_render_target_format_t)value3, value2, value4, 6));
 
 	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "width").ToLocalChecked(),
 	         Int32::New(env->isolate(), renderTarget->width));
@@ -1826,6 +3405,7 @@ static void krom_create_texture(const FunctionCallbackInfo<Value> &args) {
 
 	Local<Object> obj = templ->NewInstance(env->isolate()->GetCurrentContext()).ToLocalChecked();
 	obj->SetInternalField(0, External::New(env->isolate(), texture));
+	trackResource(env->isolate(), obj, KROM_RESOURCE_TEXTURE, texture, textureByteSize(texture));
 
 	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "width").ToLocalChecked(), args[0]);
 	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "height").ToLocalChecked(), args[1]);
@@ -1853,6 +3433,7 @@ static void krom_create_texture_3d(const FunctionCallbackInfo<Value> &args) {
 
 	Local<Object> obj = templ->NewInstance(env->isolate()->GetCurrentContext()).ToLocalChecked();
 	obj->SetInternalField(0, External::New(env->isolate(), texture));
+	trackResource(env->isolate(), obj, KROM_RESOURCE_TEXTURE, texture, textureByteSize(texture));
 
 	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "width").ToLocalChecked(), args[0]);
 	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "height").ToLocalChecked(), args[1]);
@@ -1875,6 +3456,8 @@ static void krom_create_texture_from_bytes(const FunctionCallbackInfo<Value> &ar
 	int value3 = args[2].As<Int32>()->Value();
 	int value4 = args[3].As<Int32>()->Value();
 	bool readable = args[4].As<Boolean>()->Value();
+	KromMipmapFilter mipmapFilter = args.Length() > 5 ? (KromMipmapFilter)args[5].As<Int32>()->Value() : KROM_MIPMAP_NONE;
+	bool srgb = args.Length() > 6 && args[6].As<Boolean>()->Value();
 
 	void *data = malloc(store->ByteLength());
 	memcpy(data, store->Data(), store->ByteLength());
@@ -1884,6 +3467,9 @@ static void krom_create_texture_from_bytes(const FunctionCallbackInfo<Value> &ar
 
 	kinc_g4_texture_t *texture = (kinc_g4_texture_t *)malloc(sizeof(kinc_g4_texture_t));
 	kinc_g4_texture_init_from_image(texture, &image);
+	if (generateMipmapChain(texture, &image, mipmapFilter, srgb) > 0) {
+		invalidateTextureState();
+	}
 
 	Local<ObjectTemplate> templ = ObjectTemplate::New(env->isolate());
 	templ->SetInternalFieldCount(1);
@@ -1909,9 +3495,12 @@ static void krom_create_texture_from_bytes(const FunctionCallbackInfo<Value> &ar
 		imageObject->SetInternalField(0, External::New(env->isolate(), imagePtr));
 
 		value->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "image").ToLocalChecked(), imageObject);
+		trackResource(env->isolate(), value, KROM_RESOURCE_TEXTURE, texture, textureByteSize(texture) + imageByteSize(imagePtr), imagePtr);
 	}
 	else {
 		kinc_image_destroy(&image);
+		free(data);
+		trackResource(env->isolate(), value, KROM_RESOURCE_TEXTURE, texture, textureByteSize(texture));
 	}
 
 	args.GetReturnValue().Set(value);
@@ -1963,9 +3552,12 @@ static void krom_create_texture_from_bytes_3d(const FunctionCallbackInfo<Value>
 		imageObject->SetInternalField(0, External::New(env->isolate(), imagePtr));
 
 		value->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "image").ToLocalChecked(), imageObject);
+		trackResource(env->isolate(), value, KROM_RESOURCE_TEXTURE, texture, textureByteSize(texture) + imageByteSize(imagePtr), imagePtr);
 	}
 	else {
 		kinc_image_destroy(&image);
+		free(data);
+		trackResource(env->isolate(), value, KROM_RESOURCE_TEXTURE, texture, textureByteSize(texture));
 	}
 
 	args.GetReturnValue().Set(value);
@@ -2012,10 +3604,12 @@ static void krom_create_texture_from_encoded_bytes(const FunctionCallbackInfo<Va
 		imageObject->SetInternalField(0, External::New(env->isolate(), imagePtr));
 
 		value->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "image").ToLocalChecked(), imageObject);
+		trackResource(env->isolate(), value, KROM_RESOURCE_TEXTURE, texture, textureByteSize(texture) + size, imagePtr);
 	}
 	else {
 		kinc_image_destroy(&image);
 		free(memory);
+		trackResource(env->isolate(), value, KROM_RESOURCE_TEXTURE, texture, textureByteSize(texture));
 	}
 
 	args.GetReturnValue().Set(value);
@@ -2072,13 +3666,14 @@ static void krom_get_texture_pixels(const FunctionCallbackInfo<Value> &args) {
 }
 
 static void krom_get_render_target_pixels(const FunctionCallbackInfo<Value> &args) {
-	Local<External> field = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
-	kinc_g4_render_target_t *rt = (kinc_g4_render_target_t *)field->Value();
+	kinc_g4_render_target_t *rt = renderTargetFromObject(args[0].As<Object>());
+	if (rt == nullptr) return;
 
 	Local<ArrayBuffer> buffer = Local<ArrayBuffer>::Cast(args[1]);
 	auto store = buffer->GetBackingStore();
 
 	kinc_g4_render_target_get_pixels(rt, (uint8_t *)store->Data()); // TODO: Create and return new array-buffer instead
+	invalidateTextureState();
 }
 
 static void krom_lock_texture(const FunctionCallbackInfo<Value> &args) {
@@ -2088,6 +3683,7 @@ static void krom_lock_texture(const FunctionCallbackInfo<Value> &args) {
 	kinc_g4_texture_t *texture = (kinc_g4_texture_t *)field->Value();
 
 	uint8_t *tex = kinc_g4_texture_lock(texture);
+	invalidateTextureState();
 
 	args[0].As<Object>()->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "stride").ToLocalChecked(),
 	                          Int32::New(env->isolate(), kinc_g4_texture_stride(texture)));
@@ -2103,6 +3699,7 @@ static void krom_unlock_texture(const FunctionCallbackInfo<Value> &args) {
 	Local<External> field = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
 	kinc_g4_texture_t *texture = (kinc_g4_texture_t *)field->Value();
 	kinc_g4_texture_unlock(texture);
+	invalidateTextureState();
 }
 
 static void krom_clear_texture(const FunctionCallbackInfo<Value> &args) {
@@ -2118,6 +3715,7 @@ static void krom_clear_texture(const FunctionCallbackInfo<Value> &args) {
 	int color = args[7].As<Int32>()->Value();
 
 	kinc_g4_texture_clear(texture, x, y, z, width, height, depth, color);
+	invalidateTextureState();
 }
 
 static void krom_generate_texture_mipmaps(const FunctionCallbackInfo<Value> &args) {
@@ -2126,14 +3724,16 @@ static void krom_generate_texture_mipmaps(const FunctionCallbackInfo<Value> &arg
 
 	int levels = args[1].As<Int32>()->Value();
 	kinc_g4_texture_generate_mipmaps(texture, levels);
+	invalidateTextureState();
 }
 
 static void krom_generate_render_target_mipmaps(const FunctionCallbackInfo<Value> &args) {
-	Local<External> field = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
-	kinc_g4_render_target_t *rt = (kinc_g4_render_target_t *)field->Value();
+	kinc_g4_render_target_t *rt = renderTargetFromObject(args[0].As<Object>());
+	if (rt == nullptr) return;
 
 	int levels = args[1].As<Int32>()->Value();
 	kinc_g4_render_target_generate_mipmaps(rt, levels);
+	invalidateTextureState();
 }
 
 static void krom_set_mipmaps(const FunctionCallbackInfo<Value> &args) {
@@ -2167,14 +3767,13 @@ static void krom_set_mipmaps(const FunctionCallbackInfo<Value> &args) {
 			kinc_g4_texture_set_mipmap(texture, image, i + 1);
 		}
 	}
+	invalidateTextureState();
 }
 
 static void krom_set_depth_stencil_from(const FunctionCallbackInfo<Value> &args) {
-	Local<External> field1 = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
-	kinc_g4_render_target_t *renderTarget = (kinc_g4_render_target_t *)field1->Value();
-
-	Local<External> field2 = Local<External>::Cast(args[1].As<Object>()->GetInternalField(0));
-	kinc_g4_render_target_t *sourceTarget = (kinc_g4_render_target_t *)field2->Value();
+	kinc_g4_render_target_t *renderTarget = renderTargetFromObject(args[0].As<Object>());
+	kinc_g4_render_target_t *sourceTarget = renderTargetFromObject(args[1].As<Object>());
+	if (renderTarget == nullptr || sourceTarget == nullptr) return;
 
 	kinc_g4_render_target_set_depth_stencil_from(renderTarget, sourceTarget);
 }
@@ -2206,6 +3805,8 @@ static void krom_render_targets_inverted_y(const FunctionCallbackInfo<Value> &ar
 }
 
 static void krom_begin(const FunctionCallbackInfo<Value> &args) {
+	// Some backends drop bound state when switching render targets
+	invalidateGraphicsState();
 	if (args[0]->IsNull() || args[0]->IsUndefined()) {
 		kinc_g4_restore_render_target();
 	}
@@ -2217,8 +3818,8 @@ static void krom_begin(const FunctionCallbackInfo<Value> &args) {
 		                      ->Get(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "renderTarget_").ToLocalChecked())
 		                      .ToLocalChecked();
 
-		Local<External> field = Local<External>::Cast(rt.As<Object>()->GetInternalField(0));
-		kinc_g4_render_target_t *renderTarget = (kinc_g4_render_target_t *)field->Value();
+		kinc_g4_render_target_t *renderTarget = renderTargetFromObject(rt.As<Object>());
+		if (renderTarget == nullptr) return;
 
 		if (args[1]->IsNull() || args[1]->IsUndefined()) {
 			kinc_g4_set_render_targets(&renderTarget, 1);
@@ -2244,8 +3845,8 @@ static void krom_begin(const FunctionCallbackInfo<Value> &args) {
 				                       ->Get(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "renderTarget_").ToLocalChecked())
 				                       .ToLocalChecked();
 
-				Local<External> field = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
-				kinc_g4_render_target_t *art = (kinc_g4_render_target_t *)field->Value();
+				kinc_g4_render_target_t *art = renderTargetFromObject(args[0].As<Object>());
+				if (art == nullptr) return;
 
 				renderTargets[i + 1] = art;
 			}
@@ -2260,10 +3861,11 @@ static void krom_begin_face(const FunctionCallbackInfo<Value> &args) {
 	Local<Value> rt =
 	    args[0].As<Object>()->Get(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "renderTarget_").ToLocalChecked()).ToLocalChecked();
 
-	Local<External> field = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
-	kinc_g4_render_target_t *renderTarget = (kinc_g4_render_target_t *)field->Value();
+	kinc_g4_render_target_t *renderTarget = renderTargetFromObject(args[0].As<Object>());
+	if (renderTarget == nullptr) return;
 
 	int face = args[1].As<Int32>()->Value();
+	invalidateGraphicsState();
 	kinc_g4_set_render_target_face(renderTarget, face);
 }
 
@@ -2292,6 +3894,80 @@ static void krom_sys_command(const FunctionCallbackInfo<Value> &args) {
 	args.GetReturnValue().Set(result);
 }
 
+// Commands started by sysCommandAsync, their callbacks run from update once the process exited
+namespace {
+	std::map<int, Global<Function>> processCallbacks;
+}
+
+static void finishProcesses() {
+	std::vector<KromProcessResult> finished;
+	updateProcesses(&finished);
+	if (finished.empty()) {
+		return;
+	}
+
+	Isolate *isolate = globalEnv->isolate();
+	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
+	for (size_t i = 0; i < finished.size(); ++i) {
+		const KromProcessResult &process = finished[i];
+		std::map<int, Global<Function>>::iterator it = processCallbacks.find(process.id);
+		if (it == processCallbacks.end()) {
+			continue;
+		}
+		Local<Function> callback = Local<Function>::New(isolate, it->second);
+		processCallbacks.erase(it);
+
+		Local<Object> result = Object::New(isolate);
+		// -1 like system() when the shell could not be started
+		result->Set(context, String::NewFromUtf8(isolate, "status").ToLocalChecked(), Number::New(isolate, process.spawned ? (double)process.exitStatus : -1.0));
+		result->Set(context, String::NewFromUtf8(isolate, "signal").ToLocalChecked(), Int32::New(isolate, process.termSignal));
+		result->Set(context, String::NewFromUtf8(isolate, "stdout").ToLocalChecked(),
+		            String::NewFromUtf8(isolate, process.output.data(), NewStringType::kNormal, (int)process.output.size()).ToLocalChecked());
+		result->Set(context, String::NewFromUtf8(isolate, "stderr").ToLocalChecked(),
+		            String::NewFromUtf8(isolate, process.errors.data(), NewStringType::kNormal, (int)process.errors.size()).ToLocalChecked());
+		result->Set(context, String::NewFromUtf8(isolate, "seconds").ToLocalChecked(), Number::New(isolate, process.seconds));
+		if (!process.spawned) {
+			result->Set(context, String::NewFromUtf8(isolate, "error").ToLocalChecked(),
+			            String::NewFromUtf8(isolate, uv_strerror((int)process.exitStatus)).ToLocalChecked());
+		}
+
+		TryCatch tryCatch(isolate);
+		Local<Value> argv[1] = {result};
+		if (callback->Call(context, context->Global(), 1, argv).IsEmpty()) {
+			v8::String::Utf8Value stackTrace(isolate, tryCatch.StackTrace(context).ToLocalChecked());
+			sendLogMessage("Trace: %s", *stackTrace);
+		}
+	}
+}
+
+static void krom_sys_command_async(const FunctionCallbackInfo<Value> &args) {
+	node::Environment *env = node::Environment::GetCurrent(args);
+	node::Utf8Value command(env->isolate(), args[0]);
+	int id = queueProcess(*command);
+	if (args[1]->IsFunction()) {
+		processCallbacks[id] = Global<Function>(env->isolate(), args[1].As<Function>());
+	}
+	args.GetReturnValue().Set(id);
+}
+
+static void krom_set_sys_command_limit(const FunctionCallbackInfo<Value> &args) {
+	setProcessLimit(args[0].As<Int32>()->Value());
+}
+
+static void krom_get_sys_command_stats(const FunctionCallbackInfo<Value> &args) {
+	node::Environment *env = node::Environment::GetCurrent(args);
+
+	KromProcessStats stats;
+	processStats(&stats);
+	Local<Object> obj = Object::New(env->isolate());
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "queued").ToLocalChecked(), Int32::New(env->isolate(), stats.queued));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "running").ToLocalChecked(), Int32::New(env->isolate(), stats.running));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "limit").ToLocalChecked(), Int32::New(env->isolate(), stats.limit));
+	obj->Set(env->isolate()->GetCurrentContext(), String::NewFromUtf8(env->isolate(), "finished").ToLocalChecked(), Int32::New(env->isolate(), stats.finished));
+	args.GetReturnValue().Set(obj);
+}
+
 // TODO: Remove this if possible
 static void krom_save_path(const FunctionCallbackInfo<Value> &args) {
 	node::Environment *env = node::Environment::GetCurrent(args);
@@ -2429,8 +4105,8 @@ static void krom_set_render_target_compute(const FunctionCallbackInfo<Value> &ar
 	Local<External> field1 = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
 	kinc_compute_texture_unit_t *unit = (kinc_compute_texture_unit_t *)field1->Value();
 
-	Local<External> field2 = Local<External>::Cast(args[1].As<Object>()->GetInternalField(0));
-	kinc_g4_render_target_t *renderTarget = (kinc_g4_render_target_t *)field2->Value();
+	kinc_g4_render_target_t *renderTarget = renderTargetFromObject(args[1].As<Object>());
+	if (renderTarget == nullptr) return;
 
 	int access = args[2].As<Int32>()->Value();
 
@@ -2451,8 +4127,8 @@ static void krom_set_sampled_render_target_compute(const FunctionCallbackInfo<Va
 	Local<External> field1 = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
 	kinc_compute_texture_unit_t *unit = (kinc_compute_texture_unit_t *)field1->Value();
 
-	Local<External> field2 = Local<External>::Cast(args[1].As<Object>()->GetInternalField(0));
-	kinc_g4_render_target_t *renderTarget = (kinc_g4_render_target_t *)field2->Value();
+	kinc_g4_render_target_t *renderTarget = renderTargetFromObject(args[1].As<Object>());
+	if (renderTarget == nullptr) return;
 
 	kinc_compute_set_sampled_render_target(*unit, renderTarget);
 }
@@ -2461,8 +4137,8 @@ static void krom_set_sampled_depth_texture_compute(const FunctionCallbackInfo<Va
 	Local<External> field1 = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
 	kinc_compute_texture_unit_t *unit = (kinc_compute_texture_unit_t *)field1->Value();
 
-	Local<External> field2 = Local<External>::Cast(args[1].As<Object>()->GetInternalField(0));
-	kinc_g4_render_target_t *renderTarget = (kinc_g4_render_target_t *)field2->Value();
+	kinc_g4_render_target_t *renderTarget = renderTargetFromObject(args[1].As<Object>());
+	if (renderTarget == nullptr) return;
 
 	kinc_compute_set_sampled_depth_from_render_target(*unit, renderTarget);
 }
@@ -2507,10 +4183,15 @@ static void krom_max_bound_textures(const FunctionCallbackInfo<Value> &args) {
 	args.GetReturnValue().Set(kinc_g4_max_bound_textures());
 }
 
+static void krom_get_filtered_call_count(const FunctionCallbackInfo<Value> &args) {
+	args.GetReturnValue().Set(lastFrameFilteredCalls);
+}
+
 static void krom_set_shader_compute(const FunctionCallbackInfo<Value> &args) {
 	Local<External> field = Local<External>::Cast(args[0].As<Object>()->GetInternalField(0));
 	kinc_compute_shader_t *shader = (kinc_compute_shader_t *)field->Value();
 	kinc_compute_set_shader(shader);
+	invalidateGraphicsState();
 }
 
 static void krom_create_shader_compute(const FunctionCallbackInfo<Value> &args) {
@@ -2585,6 +4266,7 @@ static void krom_compute(const FunctionCallbackInfo<Value> &args) {
 	int y = args[1].As<Int32>()->Value();
 	int z = args[2].As<Int32>()->Value();
 	kinc_compute(x, y, z);
+	invalidateGraphicsState();
 }
 
 #if 0
@@ -2733,8 +4415,6 @@ void serializeScript(char* code, char* outpath) {
     JsDisposeRuntime(runtime);
 }*/
 
-static node::Environment *globalEnv;
-
 void updateAudio(kinc_a2_buffer_t *buffer, int samples) {
 	kinc_mutex_lock(&audioMutex);
 	audioSamples += samples;
@@ -2787,12 +4467,26 @@ void update() {
 	    kinc_mutex_unlock(&audioMutex);
 	}*/
 
+	lastFrameFilteredCalls = takeFilteredRenderCalls();
+	invalidateGraphicsState();
+
 	kinc_g4_begin(0);
 
+	// Glyphs rasterized and texture levels streamed in since the last frame become visible now
+	updateFontAtlases();
+	updateStreamingTextures();
+	invalidateTextureState();
+
+	finishStorageJobs();
+	finishProcesses();
 	runV8();
 
 	kinc_g4_end(0);
 	kinc_g4_swap_buffers();
+
+	flushStorageWrites();
+	releaseGarbageResources();
+	recycleTransientRenderTargets(globalEnv->isolate());
 }
 
 void dropFiles(wchar_t *filePath) {
@@ -2967,6 +4661,9 @@ void shutdown() {
 		v8::String::Utf8Value stack_trace(globalEnv->isolate(), try_catch.StackTrace(context).ToLocalChecked());
 		sendLogMessage("Trace: %s", *stack_trace);
 	}
+
+	// Saves from the last frame and from the shutdown callback would be lost with the process otherwise
+	stopStorageThread();
 }
 
 void keyDown(int code) {
@@ -3668,8 +5365,8 @@ int kickstart(int argc, char **argv) {
 	if (debugMode) {
 		startDebugger(runtime, port);
 		for (;;) {
-			Message message = receiveMessage();
-			if (message.size > 0 && message.data[0] == DEBUGGER_MESSAGE_START) {
+			Message message = waitForMessage();
+			if (message.data[0] == DEBUGGER_MESSAGE_START) {
 				if (message.data[1] != KROM_DEBUG_API) {
 					const char *outdated;
 					if (message.data[1] < KROM_DEBUG_API) {
@@ -3685,11 +5382,6 @@ int kickstart(int argc, char **argv) {
 				}
 				break;
 			}
-#ifdef KORE_WINDOWS
-			Sleep(100);
-#else
-			usleep(100 * 1000);
-#endif
 		}
 	}
 
@@ -3887,6 +5579,37 @@ static void bindFunctions(Local<Context> context, Local<Object> target) {
 	addFunction(getConstantLocationCompute, krom_get_constant_location_compute);
 	addFunction(getTextureUnitCompute, krom_get_texture_unit_compute);
 	addFunction(compute, krom_compute);
+	addFunction(getFilteredCallCount, krom_get_filtered_call_count);
+	addFunction(createSpriteBatcher, krom_create_sprite_batcher);
+	addFunction(deleteSpriteBatcher, krom_delete_sprite_batcher);
+	addFunction(drawSprites, krom_draw_sprites);
+	addFunction(createFont, krom_create_font);
+	addFunction(deleteFont, krom_delete_font);
+	addFunction(getFontAtlas, krom_get_font_atlas);
+	addFunction(getFontMetrics, krom_get_font_metrics);
+	addFunction(getTextWidth, krom_get_text_width);
+	addFunction(layoutText, krom_layout_text);
+	addFunction(getFontStats, krom_get_font_stats);
+	addFunction(writeStorageAsync, krom_write_storage_async);
+	addFunction(readStorageAsync, krom_read_storage_async);
+	addFunction(fileSaveBytesAsync, krom_file_save_bytes_async);
+	addFunction(setLogRateLimit, krom_set_log_rate_limit);
+	addFunction(getLogStats, krom_get_log_stats);
+	addFunction(getWasmCacheStats, krom_get_wasm_cache_stats);
+	addFunction(getMipmapStats, krom_get_mipmap_stats);
+	addFunction(getCompressedTextureStats, krom_get_compressed_texture_stats);
+	addFunction(transcodeImage, krom_transcode_image);
+	addFunction(acquireRenderTarget, krom_acquire_render_target);
+	addFunction(getRenderTargetPoolStats, krom_get_render_target_pool_stats);
+	addFunction(loadStreamingImage, krom_load_streaming_image);
+	addFunction(setStreamingHints, krom_set_streaming_hints);
+	addFunction(setTextureBudget, krom_set_texture_budget);
+	addFunction(getStreamingStats, krom_get_streaming_stats);
+	addFunction(sysCommandAsync, krom_sys_command_async);
+	addFunction(setSysCommandLimit, krom_set_sys_command_limit);
+	addFunction(getSysCommandStats, krom_get_sys_command_stats);
+	addFunction(uploadVertexArrays, krom_upload_vertex_arrays);
+	addFunction(getVertexPackStats, krom_get_vertex_pack_stats);
 	addFunction(start, krom_start);
 
 #undef addFunction
@@ -4036,6 +5759,37 @@ static void registerFunctions(node::ExternalReferenceRegistry *registry) {
 	registerFunction(getConstantLocationCompute, krom_get_constant_location_compute);
 	registerFunction(getTextureUnitCompute, krom_get_texture_unit_compute);
 	registerFunction(compute, krom_compute);
+	registerFunction(getFilteredCallCount, krom_get_filtered_call_count);
+	registerFunction(createSpriteBatcher, krom_create_sprite_batcher);
+	registerFunction(deleteSpriteBatcher, krom_delete_sprite_batcher);
+	registerFunction(drawSprites, krom_draw_sprites);
+	registerFunction(createFont, krom_create_font);
+	registerFunction(deleteFont, krom_delete_font);
+	registerFunction(getFontAtlas, krom_get_font_atlas);
+	registerFunction(getFontMetrics, krom_get_font_metrics);
+	registerFunction(getTextWidth, krom_get_text_width);
+	registerFunction(layoutText, krom_layout_text);
+	registerFunction(getFontStats, krom_get_font_stats);
+	registerFunction(writeStorageAsync, krom_write_storage_async);
+	registerFunction(readStorageAsync, krom_read_storage_async);
+	registerFunction(fileSaveBytesAsync, krom_file_save_bytes_async);
+	registerFunction(setLogRateLimit, krom_set_log_rate_limit);
+	registerFunction(getLogStats, krom_get_log_stats);
+	registerFunction(getWasmCacheStats, krom_get_wasm_cache_stats);
+	registerFunction(getMipmapStats, krom_get_mipmap_stats);
+	registerFunction(getCompressedTextureStats, krom_get_compressed_texture_stats);
+	registerFunction(transcodeImage, krom_transcode_image);
+	registerFunction(acquireRenderTarget, krom_acquire_render_target);
+	registerFunction(getRenderTargetPoolStats, krom_get_render_target_pool_stats);
+	registerFunction(loadStreamingImage, krom_load_streaming_image);
+	registerFunction(setStreamingHints, krom_set_streaming_hints);
+	registerFunction(setTextureBudget, krom_set_texture_budget);
+	registerFunction(getStreamingStats, krom_get_streaming_stats);
+	registerFunction(sysCommandAsync, krom_sys_command_async);
+	registerFunction(setSysCommandLimit, krom_set_sys_command_limit);
+	registerFunction(getSysCommandStats, krom_get_sys_command_stats);
+	registerFunction(uploadVertexArrays, krom_upload_vertex_arrays);
+	registerFunction(getVertexPackStats, krom_get_vertex_pack_stats);
 	registerFunction(start, krom_start);
 
 #undef registerFunction
@@ -4044,6 +5798,7 @@ static void registerFunctions(node::ExternalReferenceRegistry *registry) {
 namespace krom {
 	void Initialize(Local<Object> target, Local<Value> unused, Local<Context> context, void *priv) {
 		bindFunctions(context, target);
+		context->GetIsolate()->SetWasmStreamingCallback(wasmStreamingCallback);
 	}
 
 	void RegisterExternalReferences(node::ExternalReferenceRegistry *registry) {
@@ -0,0 +1,494 @@
+#include "mipmaps.h"
+
+#include "jobs.h"
+
+#include <kinc/log.h>
+#include <kinc/system.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KROM_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define KROM_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+	const int maxTaps = 8;
+	const int rowsPerChunk = 8;
+
+	struct Kernel {
+		int taps;
+		int offset; // of the first tap relative to twice the destination coordinate
+		float weights[maxTaps];
+	};
+
+	struct Level {
+		uint8_t *data;
+		int width, height;
+	};
+
+	struct Job {
+		const Level *source;
+		Level *destination;
+		kinc_image_format_t format;
+		int channels;
+		bool srgb;
+		const Kernel *kernel;
+	};
+
+	Kernel boxKernel;
+	Kernel kaiserKernel;
+	float srgbToLinear[256];
+	uint8_t linearToSrgb[4096];
+	bool tablesReady = false;
+
+	double lastMegapixelsPerSecond = 0.0;
+
+	// Rows of the source level converted to floats, keyed by row so that neighbouring destination rows share them
+	struct Scratch {
+		std::vector<float> rows;
+		int rowIndices[maxTaps];
+		std::vector<float> vertical;
+	};
+
+	thread_local Scratch scratch;
+
+	double besselI0(double x) {
+		double sum = 1.0, term = 1.0;
+		for (int k = 1; k < 32; ++k) {
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+		}
+		return sum;
+	}
+
+	void initTables() {
+		boxKernel.taps = 2;
+		boxKernel.offset = 0;
+		boxKernel.weights[0] = boxKernel.weights[1] = 0.5f;
+
+		// Windowed sinc over 8 source pixels, alpha 4 as in common mip generators
+		const double alpha = 4.0, radius = 2.0, pi = 3.14159265358979323846;
+		kaiserKernel.taps = 8;
+		kaiserKernel.offset = -3;
+		double sum = 0.0;
+		double weights[maxTaps];
+		for (int i = 0; i < 8; ++i) {
+			double d = (i - 3.5) / 2.0; // distance to the destination pixel center in destination pixels
+			double sinc = d == 0.0 ? 1.0 : sin(pi * d) / (pi * d);
+			double window = besselI0(alpha * sqrt(1.0 - (d / radius) * (d / radius))) / besselI0(alpha);
+			weights[i] = sinc * window;
+			sum += weights[i];
+		}
+		for (int i = 0; i < 8; ++i) {
+			kaiserKernel.weights[i] = (float)(weights[i] / sum);
+		}
+
+		for (int i = 0; i < 256; ++i) {
+			double c = i / 255.0;
+			srgbToLinear[i] = (float)(c <= 0.04045 ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4));
+		}
+		for (int i = 0; i < 4096; ++i) {
+			double l = i / 4095.0;
+			double c = l <= 0.0031308 ? l * 12.92 : 1.055 * pow(l, 1.0 / 2.4) - 0.055;
+			linearToSrgb[i] = (uint8_t)(c * 255.0 + 0.5);
+		}
+		tablesReady = true;
+	}
+
+	float halfToFloat(uint16_t half) {
+		uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+		uint32_t exponent = (half >> 10) & 0x1f;
+		uint32_t mantissa = half & 0x3ff;
+		uint32_t bits;
+		if (exponent == 0) {
+			if (mantissa == 0) {
+				bits = sign;
+			}
+			else {
+				exponent = 127 - 14;
+				while ((mantissa & 0x400) == 0) {
+					mantissa <<= 1;
+					--exponent;
+				}
+				bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+			}
+		}
+		else if (exponent == 31) {
+			bits = sign | 0x7f800000 | (mantissa << 13);
+		}
+		else {
+			bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+		}
+		float value;
+		memcpy(&value, &bits, 4);
+		return value;
+	}
+
+	uint16_t floatToHalf(float value) {
+		uint32_t bits;
+		memcpy(&bits, &value, 4);
+		uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+		int exponent = (int)((bits >> 23) & 0xff) - 127 + 15;
+		uint32_t mantissa = bits & 0x7fffff;
+		if (((bits >> 23) & 0xff) == 0xff) {
+			return sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0);
+		}
+		if (exponent >= 31) {
+			return sign | 0x7c00;
+		}
+		if (exponent <= 0) {
+			if (exponent < -10) {
+				return sign;
+			}
+			mantissa = (mantissa | 0x800000) >> (1 - exponent);
+			return sign | (uint16_t)((mantissa + 0x1000) >> 13);
+		}
+		uint16_t half = sign | (uint16_t)(exponent << 10) | (uint16_t)(mantissa >> 13);
+		if (mantissa & 0x1000) {
+			++half; // rounds into the exponent correctly
+		}
+		return half;
+	}
+
+	int channelsOf(kinc_image_format_t format) {
+		switch (format) {
+		case KINC_IMAGE_FORMAT_RGBA32:
+		case KINC_IMAGE_FORMAT_BGRA32:
+		case KINC_IMAGE_FORMAT_RGBA64:
+		case KINC_IMAGE_FORMAT_RGBA128:
+			return 4;
+		case KINC_IMAGE_FORMAT_GREY8:
+		case KINC_IMAGE_FORMAT_A16:
+		case KINC_IMAGE_FORMAT_A32:
+			return 1;
+		default:
+			return 0;
+		}
+	}
+
+	void loadRow(const Job *job, int y, float *out) {
+		const Level *level = job->source;
+		int count = level->width * job->channels;
+		switch (job->format) {
+		case KINC_IMAGE_FORMAT_RGBA32:
+		case KINC_IMAGE_FORMAT_BGRA32:
+		case KINC_IMAGE_FORMAT_GREY8: {
+			const uint8_t *row = &level->data[(size_t)y * count];
+			if (job->srgb) {
+				// Alpha stays linear
+				for (int i = 0; i < count; ++i) {
+					out[i] = (job->channels == 4 && (i & 3) == 3) ? row[i] * (1.0f / 255.0f) : srgbToLinear[row[i]];
+				}
+				break;
+			}
+			int i = 0;
+#if defined(KROM_SSE2)
+			const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+			const __m128i zero = _mm_setzero_si128();
+			for (; i + 16 <= count; i += 16) {
+				__m128i bytes = _mm_loadu_si128((const __m128i *)&row[i]);
+				__m128i low = _mm_unpacklo_epi8(bytes, zero);
+				__m128i high = _mm_unpackhi_epi8(bytes, zero);
+				_mm_storeu_ps(&out[i], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), scale));
+				_mm_storeu_ps(&out[i + 4], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)), scale));
+				_mm_storeu_ps(&out[i + 8], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), scale));
+				_mm_storeu_ps(&out[i + 12], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)), scale));
+			}
+#elif defined(KROM_NEON)
+			const float32x4_t scale = vdupq_n_f32(1.0f / 255.0f);
+			for (; i + 16 <= count; i += 16) {
+				uint8x16_t bytes = vld1q_u8(&row[i]);
+				uint16x8_t low = vmovl_u8(vget_low_u8(bytes));
+				uint16x8_t high = vmovl_u8(vget_high_u8(bytes));
+				vst1q_f32(&out[i], vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(low))), scale));
+				vst1q_f32(&out[i + 4], vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(low))), scale));
+				vst1q_f32(&out[i + 8], vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(high))), scale));
+				vst1q_f32(&out[i + 12], vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(high))), scale));
+			}
+#endif
+			for (; i < count; ++i) {
+				out[i] = row[i] * (1.0f / 255.0f);
+			}
+			break;
+		}
+		case KINC_IMAGE_FORMAT_RGBA64:
+		case KINC_IMAGE_FORMAT_A16: {
+			const uint16_t *row = (const uint16_t *)level->data + (size_t)y * count;
+			for (int i = 0; i < count; ++i) {
+				out[i] = halfToFloat(row[i]);
+			}
+			break;
+		}
+		default:
+			memcpy(out, (const float *)level->data + (size_t)y * count, count * sizeof(float));
+			break;
+		}
+	}
+
+	void storeRow(const Job *job, int y, float *in) {
+		Level *level = job->destination;
+		int count = level->width * job->channels;
+		switch (job->format) {
+		case KINC_IMAGE_FORMAT_RGBA32:
+		case KINC_IMAGE_FORMAT_BGRA32:
+		case KINC_IMAGE_FORMAT_GREY8: {
+			uint8_t *row = &level->data[(size_t)y * count];
+			if (job->srgb) {
+				for (int i = 0; i < count; ++i) {
+					float value = in[i] < 0.0f ? 0.0f : (in[i] > 1.0f ? 1.0f : in[i]);
+					row[i] = (job->channels == 4 && (i & 3) == 3) ? (uint8_t)(value * 255.0f + 0.5f) : linearToSrgb[(int)(value * 4095.0f + 0.5f)];
+				}
+				break;
+			}
+			int i = 0;
+#if defined(KROM_SSE2)
+			const __m128 scale = _mm_set1_ps(255.0f);
+			for (; i + 16 <= count; i += 16) {
+				// cvtps rounds to nearest, the saturating packs clamp what the Kaiser lobes overshoot
+				__m128i a = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(&in[i]), scale));
+				__m128i b = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(&in[i + 4]), scale));
+				__m128i c = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(&in[i + 8]), scale));
+				__m128i d = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(&in[i + 12]), scale));
+				_mm_storeu_si128((__m128i *)&row[i], _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+			}
+#elif defined(KROM_NEON)
+			const float32x4_t scale = vdupq_n_f32(255.0f);
+			const float32x4_t half = vdupq_n_f32(0.5f);
+			const float32x4_t zero = vdupq_n_f32(0.0f);
+			for (; i + 16 <= count; i += 16) {
+				uint32x4_t a = vcvtq_u32_f32(vmaxq_f32(vmlaq_f32(half, vld1q_f32(&in[i]), scale), zero));
+				uint32x4_t b = vcvtq_u32_f32(vmaxq_f32(vmlaq_f32(half, vld1q_f32(&in[i + 4]), scale), zero));
+				uint32x4_t c = vcvtq_u32_f32(vmaxq_f32(vmlaq_f32(half, vld1q_f32(&in[i + 8]), scale), zero));
+				uint32x4_t d = vcvtq_u32_f32(vmaxq_f32(vmlaq_f32(half, vld1q_f32(&in[i + 12]), scale), zero));
+				uint16x8_t low = vcombine_u16(vqmovn_u32(a), vqmovn_u32(b));
+				uint16x8_t high = vcombine_u16(vqmovn_u32(c), vqmovn_u32(d));
+				vst1q_u8(&row[i], vcombine_u8(vqmovn_u16(low), vqmovn_u16(high)));
+			}
+#endif
+			for (; i < count; ++i) {
+				float value = in[i] < 0.0f ? 0.0f : (in[i] > 1.0f ? 1.0f : in[i]);
+				row[i] = (uint8_t)(value * 255.0f + 0.5f);
+			}
+			break;
+		}
+		case KINC_IMAGE_FORMAT_RGBA64:
+		case KINC_IMAGE_FORMAT_A16: {
+			uint16_t *row = (uint16_t *)level->data + (size_t)y * count;
+			for (int i = 0; i < count; ++i) {
+				row[i] = floatToHalf(in[i]);
+			}
+			break;
+		}
+		default:
+			memcpy((float *)level->data + (size_t)y * count, in, count * sizeof(float));
+			break;
+		}
+	}
+
+	const float *sourceRow(const Job *job, int y) {
+		const Level *source = job->source;
+		y = y < 0 ? 0 : (y >= source->height ? source->height - 1 : y);
+		int count = source->width * job->channels;
+		int slot = y % maxTaps;
+		float *row = &scratch.rows[(size_t)slot * count];
+		if (scratch.rowIndices[slot] != y) {
+			loadRow(job, y, row);
+			scratch.rowIndices[slot] = y;
+		}
+		return row;
+	}
+
+	void filterRows(const Job *job, int first, int last) {
+		const Kernel *kernel = job->kernel;
+		const Level *source = job->source;
+		int channels = job->channels;
+		int count = source->width * channels;
+		scratch.rows.resize((size_t)maxTaps * count);
+		scratch.vertical.resize(count + (size_t)job->destination->width * channels);
+		for (int i = 0; i < maxTaps; ++i) {
+			scratch.rowIndices[i] = -1;
+		}
+		float *vertical = scratch.vertical.data();
+		float *out = vertical + count;
+
+		for (int y = first; y < last; ++y) {
+			// Vertical pass into one row of floats
+			for (int tap = 0; tap < kernel->taps; ++tap) {
+				const float *row = sourceRow(job, y * 2 + kernel->offset + tap);
+				float weight = kernel->weights[tap];
+				int i = 0;
+#if defined(KROM_SSE2)
+				__m128 w = _mm_set1_ps(weight);
+				if (tap == 0) {
+					for (; i + 4 <= count; i += 4) _mm_storeu_ps(&vertical[i], _mm_mul_ps(_mm_loadu_ps(&row[i]), w));
+				}
+				else {
+					for (; i + 4 <= count; i += 4) _mm_storeu_ps(&vertical[i], _mm_add_ps(_mm_loadu_ps(&vertical[i]), _mm_mul_ps(_mm_loadu_ps(&row[i]), w)));
+				}
+#elif defined(KROM_NEON)
+				float32x4_t w = vdupq_n_f32(weight);
+				if (tap == 0) {
+					for (; i + 4 <= count; i += 4) vst1q_f32(&vertical[i], vmulq_f32(vld1q_f32(&row[i]), w));
+				}
+				else {
+					for (; i + 4 <= count; i += 4) vst1q_f32(&vertical[i], vmlaq_f32(vld1q_f32(&vertical[i]), vld1q_f32(&row[i]), w));
+				}
+#endif
+				for (; i < count; ++i) {
+					vertical[i] = (tap == 0 ? 0.0f : vertical[i]) + row[i] * weight;
+				}
+			}
+
+			// Horizontal pass, four channel pixels fit one vector
+			int width = job->destination->width;
+			int lastX = source->width - 1;
+			for (int x = 0; x < width; ++x) {
+				int first = x * 2 + kernel->offset;
+				if (channels == 4) {
+#if defined(KROM_SSE2)
+					__m128 sum = _mm_setzero_ps();
+					for (int tap = 0; tap < kernel->taps; ++tap) {
+						int sx = first + tap;
+						sx = sx < 0 ? 0 : (sx > lastX ? lastX : sx);
+						sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&vertical[sx * 4]), _mm_set1_ps(kernel->weights[tap])));
+					}
+					_mm_storeu_ps(&out[x * 4], sum);
+					continue;
+#elif defined(KROM_NEON)
+					float32x4_t sum = vdupq_n_f32(0.0f);
+					for (int tap = 0; tap < kernel->taps; ++tap) {
+						int sx = first + tap;
+						sx = sx < 0 ? 0 : (sx > lastX ? lastX : sx);
+						sum = vmlaq_n_f32(sum, vld1q_f32(&vertical[sx * 4]), kernel->weights[tap]);
+					}
+					vst1q_f32(&out[x * 4], sum);
+					continue;
+#endif
+				}
+				for (int c = 0; c < channels; ++c) {
+					float sum = 0.0f;
+					for (int tap = 0; tap < kernel->taps; ++tap) {
+						int sx = first + tap;
+						sx = sx < 0 ? 0 : (sx > lastX ? lastX : sx);
+						sum += vertical[sx * channels + c] * kernel->weights[tap];
+					}
+					out[x * channels + c] = sum;
+				}
+			}
+
+			storeRow(job, y, out);
+		}
+	}
+
+	void filterJobRows(void *data, int first, int last) {
+		filterRows((const Job *)data, first, last);
+	}
+
+	int bytesPerChannelOf(kinc_image_format_t format) {
+		if (format == KINC_IMAGE_FORMAT_RGBA128 || format == KINC_IMAGE_FORMAT_A32) {
+			return 4;
+		}
+		return format == KINC_IMAGE_FORMAT_RGBA64 || format == KINC_IMAGE_FORMAT_A16 ? 2 : 1;
+	}
+
+	bool canFilter(kinc_image_t *image) {
+		if (channelsOf(image->format) == 0 || image->compression != KINC_IMAGE_COMPRESSION_NONE) {
+			kinc_log(KINC_LOG_LEVEL_WARNING, "Can not generate mipmaps for image format %i.", (int)image->format);
+			return false;
+		}
+		if (!tablesReady) {
+			initTables();
+		}
+		return true;
+	}
+
+	// Allocates and fills the level below source
+	Level filterLevel(const Level *source, kinc_image_format_t format, KromMipmapFilter filter, bool srgb) {
+		int channels = channelsOf(format);
+		int bytesPerChannel = bytesPerChannelOf(format);
+		Level destination;
+		destination.width = source->width > 1 ? source->width / 2 : 1;
+		destination.height = source->height > 1 ? source->height / 2 : 1;
+		destination.data = (uint8_t *)malloc((size_t)destination.width * destination.height * channels * bytesPerChannel);
+
+		Job job;
+		job.source = source;
+		job.destination = &destination;
+		job.format = format;
+		job.channels = channels;
+		job.srgb = srgb && bytesPerChannel == 1;
+		job.kernel = filter == KROM_MIPMAP_KAISER ? &kaiserKernel : &boxKernel;
+		parallelFor(destination.height, rowsPerChunk, filterJobRows, &job);
+		return destination;
+	}
+}
+
+int generateMipmapChain(kinc_g4_texture_t *texture, kinc_image_t *image, KromMipmapFilter filter, bool srgb) {
+	if (filter == KROM_MIPMAP_NONE || !canFilter(image)) {
+		return 0;
+	}
+	if (texture->tex_width != image->width || texture->tex_height != image->height) {
+		kinc_log(KINC_LOG_LEVEL_WARNING, "Can not generate mipmaps for a texture that was padded to %ix%i.", texture->tex_width, texture->tex_height);
+		return 0;
+	}
+
+	double start = kinc_time();
+	Level source;
+	source.data = (uint8_t *)kinc_image_get_pixels(image);
+	source.width = image->width;
+	source.height = image->height;
+	double pixels = 0.0;
+	int levels = 0;
+	uint8_t *previous = nullptr;
+	while (source.width > 1 || source.height > 1) {
+		Level destination = filterLevel(&source, image->format, filter, srgb);
+		pixels += (double)source.width * source.height;
+
+		// Uploads right away, so every level can be freed once the next one is built from it
+		++levels;
+		kinc_image_t mipmap;
+		kinc_image_init_from_bytes(&mipmap, destination.data, destination.width, destination.height, image->format);
+		kinc_g4_texture_set_mipmap(texture, &mipmap, levels);
+		kinc_image_destroy(&mipmap);
+
+		free(previous);
+		previous = destination.data;
+		source = destination;
+	}
+	free(previous);
+
+	double seconds = kinc_time() - start;
+	if (seconds > 0.0) {
+		lastMegapixelsPerSecond = pixels / 1000000.0 / seconds;
+	}
+	return levels;
+}
+
+int buildMipmapChain(kinc_image_t *image, KromMipmapFilter filter, bool srgb, uint8_t **levels, int maxLevels) {
+	if (filter == KROM_MIPMAP_NONE || !canFilter(image)) {
+		return 0;
+	}
+	Level source;
+	source.data = (uint8_t *)kinc_image_get_pixels(image);
+	source.width = image->width;
+	source.height = image->height;
+	levels[0] = source.data;
+	int count = 1;
+	while ((source.width > 1 || source.height > 1) && count < maxLevels) {
+		source = filterLevel(&source, image->format, filter, srgb);
+		levels[count++] = source.data;
+	}
+	return count;
+}
+
+void mipmapStats(KromMipmapStats *stats) {
+	stats->megapixelsPerSecond = lastMegapixelsPerSecond;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <kinc/graphics4/texture.h>
+#include <kinc/image.h>
+
+enum KromMipmapFilter { KROM_MIPMAP_NONE = 0, KROM_MIPMAP_BOX = 1, KROM_MIPMAP_KAISER = 2 };
+
+// Builds the whole mip chain of image on the CPU and uploads it into texture, the rows of every level are
+// split across a small thread pool. srgb filters the color channels of 8 bit formats in linear space.
+// Returns the number of levels uploaded besides the base level, 0 when the format is not supported.
+int generateMipmapChain(kinc_g4_texture_t *texture, kinc_image_t *image, KromMipmapFilter filter, bool srgb);
+
+// Filters the chain on the CPU without uploading it, for levels that are uploaded later. levels[0] is set to the pixels of image,
+// the following levels are allocated with malloc and belong to the caller. Returns the number of levels including level 0,
+// at most maxLevels, or 0 when the format is not supported.
+int buildMipmapChain(kinc_image_t *image, KromMipmapFilter filter, bool srgb, uint8_t **levels, int maxLevels);
+
+struct KromMipmapStats {
+	double megapixelsPerSecond; // source pixels filtered, over the last chain
+};
+
+void mipmapStats(KromMipmapStats *stats);
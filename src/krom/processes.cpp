@@ -0,0 +1,177 @@
+#include "processes.h"
+
+#include <kinc/system.h>
+
+#include <uv.h>
+
+#include <stdlib.h>
+
+#include <deque>
+
+namespace {
+	struct Process {
+		int id;
+		std::string command;
+		uv_process_t handle;
+		uv_pipe_t pipes[2]; // stdout and stderr
+		int openHandles;    // the result is handed out once every handle is closed
+		KromProcessResult result;
+		double start;
+	};
+
+	uv_loop_t loop;
+	bool loopStarted = false;
+	std::deque<Process *> queue;
+	std::vector<Process *> done;
+	int running = 0;
+	int limit = 0;
+	int nextId = 1;
+	int finishedCount = 0;
+
+	// Reads are handed to their callback right away on this one thread, so all pipes can share a buffer
+	char readBuffer[64 * 1024];
+
+	void startLoop() {
+		if (!loopStarted) {
+			uv_loop_init(&loop);
+			if (limit <= 0) {
+				limit = kinc_hardware_threads();
+			}
+			loopStarted = true;
+		}
+	}
+
+	void spawn(Process *process);
+
+	void startQueued() {
+		while (running < limit && !queue.empty()) {
+			Process *process = queue.front();
+			queue.pop_front();
+			spawn(process);
+		}
+	}
+
+	void onClose(uv_handle_t *handle) {
+		Process *process = (Process *)handle->data;
+		if (--process->openHandles == 0) {
+			--running;
+			done.push_back(process);
+			// Keeps batches going without waiting for the next frame
+			startQueued();
+		}
+	}
+
+	void onExit(uv_process_t *handle, int64_t exitStatus, int termSignal) {
+		Process *process = (Process *)handle->data;
+		process->result.exitStatus = exitStatus;
+		process->result.termSignal = termSignal;
+		process->result.seconds = kinc_time() - process->start;
+		uv_close((uv_handle_t *)handle, onClose);
+	}
+
+	void onAlloc(uv_handle_t *, size_t, uv_buf_t *buffer) {
+		*buffer = uv_buf_init(readBuffer, sizeof(readBuffer));
+	}
+
+	void onRead(uv_stream_t *stream, ssize_t size, const uv_buf_t *buffer) {
+		Process *process = (Process *)stream->data;
+		if (size > 0) {
+			std::string &target = stream == (uv_stream_t *)&process->pipes[0] ? process->result.output : process->result.errors;
+			target.append(buffer->base, size);
+		}
+		else if (size < 0) {
+			// EOF or an error, either way nothing more is coming
+			uv_close((uv_handle_t *)stream, onClose);
+		}
+	}
+
+	void spawn(Process *process) {
+		for (int i = 0; i < 2; ++i) {
+			uv_pipe_init(&loop, &process->pipes[i], 0);
+			process->pipes[i].data = process;
+		}
+		process->handle.data = process;
+
+		uv_stdio_container_t stdio[3];
+		stdio[0].flags = UV_IGNORE;
+		stdio[1].flags = (uv_stdio_flags)(UV_CREATE_PIPE | UV_WRITABLE_PIPE);
+		stdio[1].data.stream = (uv_stream_t *)&process->pipes[0];
+		stdio[2].flags = (uv_stdio_flags)(UV_CREATE_PIPE | UV_WRITABLE_PIPE);
+		stdio[2].data.stream = (uv_stream_t *)&process->pipes[1];
+
+		// Runs the command through the shell the way system() and child_process with shell: true do
+#ifdef KORE_WINDOWS
+		const char *comspec = getenv("ComSpec");
+		std::string quoted = "\"" + process->command + "\"";
+		char *args[] = {(char *)(comspec != nullptr ? comspec : "cmd.exe"), (char *)"/d", (char *)"/s", (char *)"/c", (char *)quoted.c_str(), nullptr};
+#else
+		char *args[] = {(char *)"/bin/sh", (char *)"-c", (char *)process->command.c_str(), nullptr};
+#endif
+
+		uv_process_options_t options = {};
+		options.exit_cb = onExit;
+		options.file = args[0];
+		options.args = args;
+		options.stdio = stdio;
+		options.stdio_count = 3;
+#ifdef KORE_WINDOWS
+		options.flags = UV_PROCESS_WINDOWS_VERBATIM_ARGUMENTS | UV_PROCESS_WINDOWS_HIDE;
+#endif
+
+		++running;
+		process->openHandles = 3;
+		process->start = kinc_time();
+		int error = uv_spawn(&loop, &process->handle, &options);
+		if (error < 0) {
+			// The handles were initialized all the same and have to be closed
+			process->result.spawned = false;
+			process->result.exitStatus = error;
+			uv_close((uv_handle_t *)&process->handle, onClose);
+			uv_close((uv_handle_t *)&process->pipes[0], onClose);
+			uv_close((uv_handle_t *)&process->pipes[1], onClose);
+			return;
+		}
+		for (int i = 0; i < 2; ++i) {
+			uv_read_start((uv_stream_t *)&process->pipes[i], onAlloc, onRead);
+		}
+	}
+}
+
+int queueProcess(const char *command) {
+	startLoop();
+	Process *process = new Process;
+	process->id = nextId++;
+	process->command = command;
+	process->result.id = process->id;
+	process->result.spawned = true;
+	process->result.exitStatus = 0;
+	process->result.termSignal = 0;
+	process->result.seconds = 0.0;
+	queue.push_back(process);
+	return process->id;
+}
+
+void setProcessLimit(int processLimit) {
+	limit = processLimit > 0 ? processLimit : 1;
+}
+
+void updateProcesses(std::vector<KromProcessResult> *finished) {
+	if (!loopStarted) return;
+
+	startQueued();
+	uv_run(&loop, UV_RUN_NOWAIT);
+
+	for (size_t i = 0; i < done.size(); ++i) {
+		finished->push_back(std::move(done[i]->result));
+		delete done[i];
+		++finishedCount;
+	}
+	done.clear();
+}
+
+void processStats(KromProcessStats *stats) {
+	stats->queued = (int)queue.size();
+	stats->running = running;
+	stats->limit = limit > 0 ? limit : kinc_hardware_threads();
+	stats->finished = finishedCount;
+}
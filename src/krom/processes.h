@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+struct KromProcessResult {
+	int id;
+	bool spawned;       // false when the command could not be started, exitStatus holds the libuv error then
+	int64_t exitStatus;
+	int termSignal;
+	std::string output; // stdout
+	std::string errors; // stderr
+	double seconds;     // from the start of the process to its exit
+};
+
+struct KromProcessStats {
+	int queued;
+	int running;
+	int limit;
+	int finished;
+};
+
+// Queues a command for the shell, like system() would run it, and returns the id its result will carry.
+// The processes run on a libuv loop of their own, which updateProcesses polls.
+int queueProcess(const char *command);
+
+// How many processes run at the same time, the rest waits in the queue. Defaults to the number of hardware threads.
+void setProcessLimit(int limit);
+
+// Main thread only: starts queued commands while below the limit, collects output and appends the results
+// of processes that exited and closed their pipes. Never blocks.
+void updateProcesses(std::vector<KromProcessResult> *finished);
+void processStats(KromProcessStats *stats);
@@ -0,0 +1,216 @@
+#include "render_state.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include <vector>
+
+namespace {
+	struct TextureUnitState {
+		unsigned char unit[KROM_RENDER_MAX_KEY_SIZE];
+		void *texture;
+		bool parametersSet;
+		int parameters[5];
+	};
+
+	struct UniformState {
+		unsigned char location[KROM_RENDER_MAX_KEY_SIZE];
+		KromUniformType type;
+		float data[16];
+	};
+
+	// Stands for a binding that is not known, so that binding nullptr is not mistaken for a repeat
+	char unknownObject;
+	void *const unknown = &unknownObject;
+
+	const KromRenderCalls *calls = nullptr;
+	size_t unitSize = 0;
+	size_t locationSize = 0;
+	void *currentPipeline = unknown;
+	void *currentIndexBuffer = unknown;
+	void *currentVertexBuffers[KROM_RENDER_MAX_VERTEX_BUFFERS];
+	int currentVertexBufferCount = -1; // -1 when unknown
+	std::vector<TextureUnitState> textureUnitStates;
+	std::vector<UniformState> uniformStates;
+	int filteredCalls = 0;
+
+	size_t uniformSize(KromUniformType type) {
+		switch (type) {
+		case KROM_UNIFORM_BOOL:
+		case KROM_UNIFORM_INT:
+		case KROM_UNIFORM_FLOAT:
+			return 4;
+		case KROM_UNIFORM_FLOAT2:
+			return 8;
+		case KROM_UNIFORM_FLOAT3:
+			return 12;
+		case KROM_UNIFORM_FLOAT4:
+			return 16;
+		case KROM_UNIFORM_MATRIX3:
+			return 9 * 4;
+		case KROM_UNIFORM_MATRIX4:
+			return 16 * 4;
+		default:
+			return 0;
+		}
+	}
+
+	TextureUnitState *textureUnitState(const void *unit) {
+		for (size_t i = 0; i < textureUnitStates.size(); ++i) {
+			if (memcmp(textureUnitStates[i].unit, unit, unitSize) == 0) {
+				return &textureUnitStates[i];
+			}
+		}
+		TextureUnitState state;
+		memset(state.unit, 0, sizeof(state.unit));
+		memcpy(state.unit, unit, unitSize);
+		state.texture = unknown;
+		state.parametersSet = false;
+		textureUnitStates.push_back(state);
+		return &textureUnitStates.back();
+	}
+
+	void forgetUniform(const void *location) {
+		for (size_t i = 0; i < uniformStates.size(); ++i) {
+			if (memcmp(uniformStates[i].location, location, locationSize) == 0) {
+				uniformStates.erase(uniformStates.begin() + i);
+				return;
+			}
+		}
+	}
+
+	// Returns true and counts the call when the uniform already holds exactly these values
+	bool uniformUnchanged(const void *location, KromUniformType type, const void *data, size_t size) {
+		for (size_t i = 0; i < uniformStates.size(); ++i) {
+			UniformState &state = uniformStates[i];
+			if (memcmp(state.location, location, locationSize) == 0) {
+				if (state.type == type && memcmp(state.data, data, size) == 0) {
+					++filteredCalls;
+					return true;
+				}
+				state.type = type;
+				memcpy(state.data, data, size);
+				return false;
+			}
+		}
+		UniformState state;
+		memset(state.location, 0, sizeof(state.location));
+		memcpy(state.location, location, locationSize);
+		state.type = type;
+		memcpy(state.data, data, size);
+		uniformStates.push_back(state);
+		return false;
+	}
+}
+
+void initRenderState(const KromRenderCalls *renderCalls, size_t renderUnitSize, size_t renderLocationSize) {
+	assert(renderUnitSize <= KROM_RENDER_MAX_KEY_SIZE && renderLocationSize <= KROM_RENDER_MAX_KEY_SIZE);
+	calls = renderCalls;
+	unitSize = renderUnitSize;
+	locationSize = renderLocationSize;
+	invalidateGraphicsState();
+	filteredCalls = 0;
+}
+
+void bindPipeline(void *pipeline) {
+	if (pipeline == currentPipeline) {
+		++filteredCalls;
+		return;
+	}
+
+	// Uniform values and texture bindings are only known to stay valid while the same pipeline is bound
+	currentPipeline = pipeline;
+	invalidateTextureState();
+	uniformStates.clear();
+	calls->setPipeline(pipeline);
+}
+
+void bindIndexBuffer(void *buffer) {
+	if (buffer == currentIndexBuffer) {
+		++filteredCalls;
+		return;
+	}
+	currentIndexBuffer = buffer;
+	calls->setIndexBuffer(buffer);
+}
+
+void bindVertexBuffers(void **buffers, int count) {
+	if (count == currentVertexBufferCount && (count == 0 || memcmp(buffers, currentVertexBuffers, count * sizeof(void *)) == 0)) {
+		++filteredCalls;
+		return;
+	}
+	if (count >= 0 && count <= KROM_RENDER_MAX_VERTEX_BUFFERS) {
+		for (int i = 0; i < count; ++i) {
+			currentVertexBuffers[i] = buffers[i];
+		}
+		currentVertexBufferCount = count;
+	}
+	else {
+		currentVertexBufferCount = -1;
+	}
+	calls->setVertexBuffers(buffers, count);
+}
+
+void bindTexture(const void *unit, void *texture) {
+	TextureUnitState *state = textureUnitState(unit);
+	if (state->texture == texture) {
+		++filteredCalls;
+		return;
+	}
+	state->texture = texture;
+	calls->setTexture(unit, texture);
+}
+
+void bindTextureParameters(const void *unit, const int parameters[5]) {
+	TextureUnitState *state = textureUnitState(unit);
+	if (state->parametersSet && memcmp(state->parameters, parameters, sizeof(state->parameters)) == 0) {
+		++filteredCalls;
+		return;
+	}
+	state->parametersSet = true;
+	memcpy(state->parameters, parameters, sizeof(state->parameters));
+	calls->setTextureParameters(unit, parameters);
+}
+
+void bindUniform(const void *location, KromUniformType type, const void *data, int count) {
+	size_t size = uniformSize(type);
+	if (size == 0) {
+		forgetUniform(location);
+	}
+	else if (uniformUnchanged(location, type, data, size)) {
+		return;
+	}
+	calls->setUniform(location, type, data, count);
+}
+
+void forgetTexture(const void *unit) {
+	textureUnitState(unit)->texture = unknown;
+}
+
+void forgetPipeline(void *pipeline) {
+	if (pipeline == currentPipeline) {
+		invalidateGraphicsState();
+	}
+}
+
+void invalidateBufferState() {
+	currentIndexBuffer = unknown;
+	currentVertexBufferCount = -1;
+}
+
+void invalidateTextureState() {
+	textureUnitStates.clear();
+}
+
+void invalidateGraphicsState() {
+	currentPipeline = unknown;
+	invalidateBufferState();
+	invalidateTextureState();
+	uniformStates.clear();
+}
+
+int takeFilteredRenderCalls() {
+	int count = filteredCalls;
+	filteredCalls = 0;
+	return count;
+}
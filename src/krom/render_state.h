@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stddef.h>
+
+// Shadow copy of what is currently bound in kinc so that repeated identical calls from Kha can be skipped.
+// Anything that might touch bindings behind our back (render target switches, buffer/texture locks,
+// compute dispatches, resource destruction) has to invalidate the affected part.
+// The state knows nothing about kinc, pipelines, buffers and textures are only compared by address and texture
+// units and constant locations by their bytes. The calls that get through go to a KromRenderCalls.
+
+#define KROM_RENDER_MAX_KEY_SIZE 64   // bytes of a texture unit or constant location
+#define KROM_RENDER_MAX_VERTEX_BUFFERS 8
+
+enum KromUniformType {
+	KROM_UNIFORM_BOOL,   // one int, 0 or 1
+	KROM_UNIFORM_INT,
+	KROM_UNIFORM_FLOAT,
+	KROM_UNIFORM_FLOAT2,
+	KROM_UNIFORM_FLOAT3,
+	KROM_UNIFORM_FLOAT4,
+	KROM_UNIFORM_FLOATS, // count floats, never filtered
+	KROM_UNIFORM_MATRIX3, // 9 floats, column major
+	KROM_UNIFORM_MATRIX4  // 16 floats, column major
+};
+
+// What main.cpp forwards to kinc_g4 and the tests to a recording stub
+struct KromRenderCalls {
+	void (*setPipeline)(void *pipeline);
+	void (*setIndexBuffer)(void *buffer);
+	void (*setVertexBuffers)(void **buffers, int count);
+	void (*setTexture)(const void *unit, void *texture);
+	void (*setTextureParameters)(const void *unit, const int parameters[5]); // u and v addressing, min, mag and mip filter
+	void (*setUniform)(const void *location, KromUniformType type, const void *data, int count);
+};
+
+// Drops the shadow state. unitSize and locationSize are the sizeof of the backend's texture unit and constant location,
+// at most KROM_RENDER_MAX_KEY_SIZE.
+void initRenderState(const KromRenderCalls *calls, size_t unitSize, size_t locationSize);
+
+void bindPipeline(void *pipeline);
+void bindIndexBuffer(void *buffer);
+void bindVertexBuffers(void **buffers, int count);
+void bindTexture(const void *unit, void *texture);
+void bindTextureParameters(const void *unit, const int parameters[5]);
+// count is only used for KROM_UNIFORM_FLOATS
+void bindUniform(const void *location, KromUniformType type, const void *data, int count);
+
+// Something other than bindTexture was bound to the unit, a render target or an image texture
+void forgetTexture(const void *unit);
+// Call before the pipeline is destroyed or recompiled
+void forgetPipeline(void *pipeline);
+
+void invalidateBufferState();
+void invalidateTextureState();
+void invalidateGraphicsState();
+
+// Calls skipped since the last call
+int takeFilteredRenderCalls();
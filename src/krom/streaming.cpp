@@ -0,0 +1,395 @@
+#include "streaming.h"
+
+#include "mipmaps.h"
+#include "streaming_policy.h"
+
+#include <kinc/image.h>
+#include <kinc/log.h>
+#include <kinc/system.h>
+#include <kinc/threads/event.h>
+#include <kinc/threads/mutex.h>
+#include <kinc/threads/thread.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+namespace {
+	const int maxLevels = 16;
+	const int usageFrames = 8; // a texture keeps asking for its levels this long after its last bind
+}
+
+struct KromStreamingTexture {
+	kinc_g4_texture_t texture; // first, so that the texture pointer is the streaming texture pointer
+	char *filename;
+	bool srgb;
+	KromStreamingState state;
+	uint8_t *levels[maxLevels]; // copies of the levels coarser than state.residentLevel, nullptr for the others
+
+	int pendingLoads; // main thread only, the texture is freed once released and no more loads are in flight
+	bool released;
+};
+
+namespace {
+	struct Request {
+		KromStreamingTexture *texture; // its filename and srgb never change, so the thread reads them directly
+		int level;
+	};
+
+	struct Result {
+		KromStreamingTexture *texture;
+		int level;
+		int levelCount; // 0 when decoding failed
+		int width, height;
+		uint8_t *levels[maxLevels];
+	};
+
+	kinc_thread_t thread;
+	bool threadStarted = false;
+	kinc_mutex_t mutex;
+	kinc_event_t requestEvent;
+	std::vector<Request> requests;
+	std::vector<Result> results;
+
+	std::vector<KromStreamingTexture *> textures;
+	std::map<kinc_g4_texture_t *, KromStreamingTexture *> byHandle;
+	size_t budget = 256 * 1024 * 1024;
+	int frame = 0;
+
+	int loadsFinished = 0;
+	double loadSeconds = 0.0;
+	int lastLoads = 0;
+	int lastEvictions = 0;
+	std::vector<KromStreamingState> states;
+	std::vector<KromStreamingAction> actions;
+
+	int levelWidth(const KromStreamingState *state, int level) {
+		return state->width >> level > 0 ? state->width >> level : 1;
+	}
+
+	int levelHeight(const KromStreamingState *state, int level) {
+		return state->height >> level > 0 ? state->height >> level : 1;
+	}
+
+	// Decodes filename and filters its whole chain. levels receives the levels from first on, the finer ones are freed.
+	// Returns the number of levels, 0 when the image can not be streamed.
+	int decodeChain(const char *filename, bool srgb, int first, uint8_t **levels, int *width, int *height) {
+		size_t size = kinc_image_size_from_file(filename);
+		if (size == 0) {
+			return 0;
+		}
+		void *memory = malloc(size);
+		kinc_image_t image;
+		kinc_image_init_from_file(&image, memory, filename);
+		if (image.format != KINC_IMAGE_FORMAT_RGBA32 || image.compression != KINC_IMAGE_COMPRESSION_NONE) {
+			kinc_image_destroy(&image);
+			free(memory);
+			return 0;
+		}
+
+		uint8_t *chain[maxLevels];
+		int count = buildMipmapChain(&image, KROM_MIPMAP_BOX, srgb, chain, maxLevels);
+		*width = image.width;
+		*height = image.height;
+		kinc_image_destroy(&image);
+		if (count == 0) {
+			free(memory);
+			return 0;
+		}
+		for (int level = 0; level < count; ++level) {
+			if (level < first) {
+				// Level 0 is the decoded file
+				free(level == 0 ? memory : chain[level]);
+			}
+			else {
+				levels[level] = level == 0 ? (uint8_t *)memory : chain[level];
+			}
+		}
+		return count;
+	}
+
+	void loadThread(void *) {
+		std::vector<Request> work;
+		for (;;) {
+			kinc_event_wait(&requestEvent);
+
+			kinc_mutex_lock(&mutex);
+			work.swap(requests);
+			kinc_mutex_unlock(&mutex);
+
+			for (size_t i = 0; i < work.size(); ++i) {
+				double start = kinc_time();
+				Result result;
+				result.texture = work[i].texture;
+				result.level = work[i].level;
+				result.levelCount = decodeChain(work[i].texture->filename, work[i].texture->srgb, work[i].level, result.levels, &result.width, &result.height);
+				double seconds = kinc_time() - start;
+
+				kinc_mutex_lock(&mutex);
+				results.push_back(result);
+				++loadsFinished;
+				loadSeconds += seconds;
+				kinc_mutex_unlock(&mutex);
+			}
+			work.clear();
+		}
+	}
+
+	// Replaces the texture's levels by levels[level] to the last one. The handle stays the same, the
+	// texture state is invalidated after updateStreamingTextures so that it gets bound again.
+	void upload(KromStreamingTexture *texture, int level, uint8_t **levels, bool initialized) {
+		const KromStreamingState *state = &texture->state;
+		if (initialized) {
+			kinc_g4_texture_destroy(&texture->texture);
+		}
+		kinc_image_t image;
+		kinc_image_init_from_bytes(&image, levels[level], levelWidth(state, level), levelHeight(state, level), KINC_IMAGE_FORMAT_RGBA32);
+		kinc_g4_texture_init_from_image(&texture->texture, &image);
+		kinc_image_destroy(&image);
+
+		// Padded textures get no mipmaps, like in generateMipmapChain
+		if (texture->texture.tex_width != levelWidth(state, level) || texture->texture.tex_height != levelHeight(state, level)) {
+			return;
+		}
+		for (int i = level + 1; i < state->levelCount; ++i) {
+			kinc_image_t mipmap;
+			kinc_image_init_from_bytes(&mipmap, levels[i], levelWidth(state, i), levelHeight(state, i), KINC_IMAGE_FORMAT_RGBA32);
+			kinc_g4_texture_set_mipmap(&texture->texture, &mipmap, i - level);
+			kinc_image_destroy(&mipmap);
+		}
+	}
+
+	void freeLevels(KromStreamingTexture *texture) {
+		for (int i = 0; i < maxLevels; ++i) {
+			free(texture->levels[i]);
+			texture->levels[i] = nullptr;
+		}
+	}
+
+	void freeTexture(KromStreamingTexture *texture) {
+		freeLevels(texture);
+		free(texture->filename);
+		delete texture;
+	}
+
+	void evict(KromStreamingTexture *texture, int level) {
+		upload(texture, level, texture->levels, true);
+		for (int i = texture->state.residentLevel; i <= level; ++i) {
+			free(texture->levels[i]);
+			texture->levels[i] = nullptr;
+		}
+		lastEvictions += level - texture->state.residentLevel;
+		texture->state.residentLevel = level;
+	}
+
+	void finishLoad(KromStreamingTexture *texture, Result *result) {
+		if (result->levelCount != texture->state.levelCount || result->width != texture->state.width || result->height != texture->state.height) {
+			// The file is gone or changed its size, stay with what is resident
+			kinc_log(KINC_LOG_LEVEL_WARNING, "Could not stream %s.", texture->filename);
+			texture->state.finestLevel = texture->state.residentLevel;
+			texture->state.loadingLevel = -1;
+			for (int i = result->level; i < result->levelCount; ++i) {
+				free(result->levels[i]);
+			}
+			return;
+		}
+
+		upload(texture, result->level, result->levels, true);
+		free(result->levels[result->level]);
+		for (int i = result->level + 1; i < result->levelCount; ++i) {
+			// Keeps the copies it already had and takes the ones for the levels that were resident before
+			if (texture->levels[i] == nullptr) {
+				texture->levels[i] = result->levels[i];
+			}
+			else {
+				free(result->levels[i]);
+			}
+		}
+		texture->state.residentLevel = result->level;
+		texture->state.loadingLevel = -1;
+		++lastLoads;
+	}
+}
+
+KromStreamingTexture *createStreamingTexture(const char *filename, int startSize, bool srgb) {
+	// The full chain is decoded once up front, which also sets up the filter tables before the load thread uses them
+	uint8_t *levels[maxLevels] = {};
+	int width, height;
+	int count = decodeChain(filename, srgb, 0, levels, &width, &height);
+	if (count == 0) {
+		kinc_log(KINC_LOG_LEVEL_WARNING, "Can not stream %s, only RGBA32 images are supported.", filename);
+		return nullptr;
+	}
+
+	KromStreamingTexture *texture = new KromStreamingTexture;
+	texture->filename = strdup(filename);
+	texture->srgb = srgb;
+	texture->state.width = width;
+	texture->state.height = height;
+	texture->state.levelCount = count;
+	texture->state.loadingLevel = -1;
+	texture->state.finestLevel = 0;
+	texture->state.priority = 0;
+	texture->state.lastUsedFrame = -1;
+	texture->state.residentLevel = count - 1;
+	for (int level = 0; level < count; ++level) {
+		if (levelWidth(&texture->state, level) <= startSize && levelHeight(&texture->state, level) <= startSize) {
+			texture->state.residentLevel = level;
+			break;
+		}
+	}
+	texture->pendingLoads = 0;
+	texture->released = false;
+
+	upload(texture, texture->state.residentLevel, levels, false);
+	for (int level = 0; level < maxLevels; ++level) {
+		if (level <= texture->state.residentLevel) {
+			free(levels[level]);
+			texture->levels[level] = nullptr;
+		}
+		else {
+			texture->levels[level] = levels[level];
+		}
+	}
+
+	if (!threadStarted) {
+		kinc_mutex_init(&mutex);
+		kinc_event_init(&requestEvent, true);
+		kinc_thread_init(&thread, loadThread, nullptr);
+		threadStarted = true;
+	}
+	textures.push_back(texture);
+	byHandle[&texture->texture] = texture;
+	return texture;
+}
+
+void destroyStreamingTexture(KromStreamingTexture *texture) {
+	texture->released = true;
+	textures.erase(std::remove(textures.begin(), textures.end(), texture), textures.end());
+	byHandle.erase(&texture->texture);
+	kinc_g4_texture_destroy(&texture->texture);
+	if (texture->pendingLoads == 0) {
+		freeTexture(texture);
+	}
+}
+
+kinc_g4_texture_t *streamingTextureHandle(KromStreamingTexture *texture) {
+	return &texture->texture;
+}
+
+KromStreamingTexture *findStreamingTexture(kinc_g4_texture_t *texture) {
+	std::map<kinc_g4_texture_t *, KromStreamingTexture *>::iterator it = byHandle.find(texture);
+	return it == byHandle.end() ? nullptr : it->second;
+}
+
+size_t streamingTextureByteSize(KromStreamingTexture *texture) {
+	return streamingChainBytes(&texture->state, texture->state.residentLevel);
+}
+
+void streamingTextureSize(KromStreamingTexture *texture, int *width, int *height) {
+	*width = texture->state.width;
+	*height = texture->state.height;
+}
+
+void setStreamingHints(KromStreamingTexture *texture, int priority, int finestLevel) {
+	texture->state.priority = priority;
+	texture->state.finestLevel = finestLevel;
+}
+
+void setTextureBudget(size_t bytes) {
+	budget = bytes;
+}
+
+void touchStreamingTexture(kinc_g4_texture_t *texture) {
+	if (byHandle.empty()) return;
+	KromStreamingTexture *streaming = findStreamingTexture(texture);
+	if (streaming != nullptr) {
+		streaming->state.lastUsedFrame = frame;
+	}
+}
+
+void updateStreamingTextures() {
+	if (!threadStarted) return;
+
+	std::vector<Result> finished;
+	kinc_mutex_lock(&mutex);
+	finished.swap(results);
+	kinc_mutex_unlock(&mutex);
+
+	lastLoads = 0;
+	lastEvictions = 0;
+	for (size_t i = 0; i < finished.size(); ++i) {
+		KromStreamingTexture *texture = finished[i].texture;
+		--texture->pendingLoads;
+		if (texture->released) {
+			for (int level = finished[i].level; level < finished[i].levelCount; ++level) {
+				free(finished[i].levels[level]);
+			}
+			if (texture->pendingLoads == 0) {
+				freeTexture(texture);
+			}
+		}
+		else {
+			finishLoad(texture, &finished[i]);
+		}
+	}
+
+	states.resize(textures.size());
+	actions.resize(textures.size());
+	for (size_t i = 0; i < textures.size(); ++i) {
+		states[i] = textures[i]->state;
+	}
+	int count = planTextureStreaming(states.data(), (int)states.size(), budget, frame, usageFrames, actions.data());
+
+	bool requested = false;
+	for (int i = 0; i < count; ++i) {
+		KromStreamingTexture *texture = textures[actions[i].texture];
+		if (actions[i].level > texture->state.residentLevel) {
+			evict(texture, actions[i].level);
+		}
+		else {
+			Request request;
+			request.texture = texture;
+			request.level = actions[i].level;
+			kinc_mutex_lock(&mutex);
+			requests.push_back(request);
+			kinc_mutex_unlock(&mutex);
+			texture->state.loadingLevel = actions[i].level;
+			++texture->pendingLoads;
+			requested = true;
+		}
+	}
+	if (requested) {
+		kinc_event_signal(&requestEvent);
+	}
+	++frame;
+}
+
+void streamingStats(KromStreamingStats *stats) {
+	stats->textures = (int)textures.size();
+	stats->loadsInFlight = 0;
+	stats->loads = lastLoads;
+	stats->evictions = lastEvictions;
+	stats->residentBytes = 0;
+	stats->committedBytes = 0;
+	stats->cpuBytes = 0;
+	stats->budget = budget;
+	for (size_t i = 0; i < textures.size(); ++i) {
+		const KromStreamingState *state = &textures[i]->state;
+		if (state->loadingLevel >= 0) {
+			++stats->loadsInFlight;
+		}
+		stats->residentBytes += streamingChainBytes(state, state->residentLevel);
+		stats->committedBytes += streamingCommittedBytes(state);
+		stats->cpuBytes += streamingChainBytes(state, state->residentLevel + 1);
+	}
+	stats->loadSeconds = 0.0;
+	if (threadStarted) {
+		kinc_mutex_lock(&mutex);
+		stats->loadSeconds = loadsFinished > 0 ? loadSeconds / loadsFinished : 0.0;
+		kinc_mutex_unlock(&mutex);
+	}
+}
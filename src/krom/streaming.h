@@ -0,0 +1,42 @@
+#pragma once
+
+#include <kinc/graphics4/texture.h>
+
+#include <stddef.h>
+
+struct KromStreamingTexture;
+
+struct KromStreamingStats {
+	int textures;
+	int loadsInFlight;
+	int loads;     // finished during the previous frame
+	int evictions; // levels dropped during the previous frame
+	size_t residentBytes;
+	size_t committedBytes; // resident plus loads in flight, what the budget is checked against
+	size_t cpuBytes;       // copies of the levels below the resident ones, kept for evictions
+	size_t budget;
+	double loadSeconds; // average decode time of a load
+};
+
+// Decodes an RGBA32 image and keeps only the levels that are at most startSize pixels wide and high on the GPU,
+// the rest is streamed in on demand once the texture gets bound. Returns nullptr when the file can not be read or
+// has a different format.
+KromStreamingTexture *createStreamingTexture(const char *filename, int startSize, bool srgb);
+void destroyStreamingTexture(KromStreamingTexture *texture);
+
+// Stays the same for the life of the streaming texture, the levels it holds change between frames
+kinc_g4_texture_t *streamingTextureHandle(KromStreamingTexture *texture);
+KromStreamingTexture *findStreamingTexture(kinc_g4_texture_t *texture);
+void streamingTextureSize(KromStreamingTexture *texture, int *width, int *height);
+size_t streamingTextureByteSize(KromStreamingTexture *texture); // resident levels at the time of the call
+
+// Higher priorities are loaded first and evicted last, finestLevel caps the resolution (0 for the full one)
+void setStreamingHints(KromStreamingTexture *texture, int priority, int finestLevel);
+void setTextureBudget(size_t bytes);
+
+// Called for every texture bind, marks a streaming texture as used in this frame
+void touchStreamingTexture(kinc_g4_texture_t *texture);
+
+// Main thread only, between frames: uploads finished loads, evicts and starts new loads
+void updateStreamingTextures();
+void streamingStats(KromStreamingStats *stats);
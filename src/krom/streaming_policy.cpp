@@ -0,0 +1,177 @@
+#include "streaming_policy.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+	struct Plan {
+		const KromStreamingState *states;
+		int count;
+		std::vector<int> levels; // committed level per texture, updated while planning
+		std::vector<bool> locked; // loading or already given a load by this plan
+		size_t total;
+	};
+
+	bool lessImportant(const KromStreamingState *a, int aIndex, const KromStreamingState *b, int bIndex) {
+		if (a->lastUsedFrame != b->lastUsedFrame) {
+			return a->lastUsedFrame < b->lastUsedFrame;
+		}
+		if (a->priority != b->priority) {
+			return a->priority < b->priority;
+		}
+		return aIndex < bIndex;
+	}
+
+	// Textures bound in the same frame with the same priority do not evict each other, that would only make them take turns
+	bool canEvictFor(const KromStreamingState *victim, const KromStreamingState *requester) {
+		return victim->lastUsedFrame < requester->lastUsedFrame ||
+		       (victim->lastUsedFrame == requester->lastUsedFrame && victim->priority < requester->priority);
+	}
+
+	// The least important texture that still has a level to give up and may be evicted for requester,
+	// -1 when there is none. A requester of -1 accepts every texture.
+	int findVictim(const Plan &plan, int requester) {
+		int victim = -1;
+		for (int i = 0; i < plan.count; ++i) {
+			const KromStreamingState *state = &plan.states[i];
+			if (i == requester || plan.locked[i] || plan.levels[i] >= state->levelCount - 1) {
+				continue;
+			}
+			if (requester >= 0 && !canEvictFor(state, &plan.states[requester])) {
+				continue;
+			}
+			if (victim < 0 || lessImportant(state, i, &plan.states[victim], victim)) {
+				victim = i;
+			}
+		}
+		return victim;
+	}
+
+	void evictLevel(Plan &plan, int victim) {
+		const KromStreamingState *state = &plan.states[victim];
+		int level = plan.levels[victim];
+		plan.total -= streamingChainBytes(state, level) - streamingChainBytes(state, level + 1);
+		plan.levels[victim] = level + 1;
+	}
+
+	// Bytes that evictions on behalf of requester could free at most
+	size_t evictableBytes(const Plan &plan, int requester) {
+		size_t bytes = 0;
+		for (int i = 0; i < plan.count; ++i) {
+			const KromStreamingState *state = &plan.states[i];
+			if (i == requester || plan.locked[i] || plan.levels[i] >= state->levelCount - 1) {
+				continue;
+			}
+			if (canEvictFor(state, &plan.states[requester])) {
+				bytes += streamingChainBytes(state, plan.levels[i]) - streamingChainBytes(state, state->levelCount - 1);
+			}
+		}
+		return bytes;
+	}
+
+	int wantedLevel(const KromStreamingState *state) {
+		return std::min(std::max(state->finestLevel, 0), state->levelCount - 1);
+	}
+}
+
+size_t streamingChainBytes(const KromStreamingState *state, int level) {
+	size_t bytes = 0;
+	for (int i = level; i < state->levelCount; ++i) {
+		size_t width = state->width >> i > 0 ? state->width >> i : 1;
+		size_t height = state->height >> i > 0 ? state->height >> i : 1;
+		bytes += width * height * 4;
+	}
+	return bytes;
+}
+
+size_t streamingCommittedBytes(const KromStreamingState *state) {
+	int level = state->loadingLevel >= 0 && state->loadingLevel < state->residentLevel ? state->loadingLevel : state->residentLevel;
+	return streamingChainBytes(state, level);
+}
+
+int planTextureStreaming(const KromStreamingState *states, int count, size_t budget, int frame, int usageFrames, KromStreamingAction *actions) {
+	Plan plan;
+	plan.states = states;
+	plan.count = count;
+	plan.levels.resize(count);
+	plan.locked.resize(count);
+	plan.total = 0;
+	for (int i = 0; i < count; ++i) {
+		const KromStreamingState *state = &states[i];
+		bool loading = state->loadingLevel >= 0 && state->loadingLevel < state->residentLevel;
+		plan.levels[i] = loading ? state->loadingLevel : state->residentLevel;
+		plan.locked[i] = loading;
+		plan.total += streamingChainBytes(state, plan.levels[i]);
+	}
+
+	// The budget may have been lowered
+	while (plan.total > budget) {
+		int victim = findVictim(plan, -1);
+		if (victim < 0) {
+			break;
+		}
+		evictLevel(plan, victim);
+	}
+
+	std::vector<int> requesters;
+	for (int i = 0; i < count; ++i) {
+		const KromStreamingState *state = &states[i];
+		if (!plan.locked[i] && state->lastUsedFrame >= 0 && frame - state->lastUsedFrame < usageFrames && wantedLevel(state) < plan.levels[i]) {
+			requesters.push_back(i);
+		}
+	}
+	std::sort(requesters.begin(), requesters.end(), [states](int a, int b) {
+		if (states[a].priority != states[b].priority) {
+			return states[a].priority > states[b].priority;
+		}
+		if (states[a].lastUsedFrame != states[b].lastUsedFrame) {
+			return states[a].lastUsedFrame > states[b].lastUsedFrame;
+		}
+		return a < b;
+	});
+
+	for (int requester : requesters) {
+		const KromStreamingState *state = &states[requester];
+		int level = plan.levels[requester];
+		size_t current = streamingChainBytes(state, level);
+		size_t free = plan.total < budget ? budget - plan.total : 0;
+		size_t available = free + evictableBytes(plan, requester);
+
+		// The finest level that fits, even if it takes evictions
+		int target = level;
+		for (int candidate = wantedLevel(state); candidate < level; ++candidate) {
+			if (streamingChainBytes(state, candidate) - current <= available) {
+				target = candidate;
+				break;
+			}
+		}
+		if (target == level) {
+			continue;
+		}
+
+		size_t needed = streamingChainBytes(state, target) - current;
+		while (plan.total + needed > budget) {
+			int victim = findVictim(plan, requester);
+			if (victim < 0) {
+				break;
+			}
+			evictLevel(plan, victim);
+		}
+		plan.levels[requester] = target;
+		plan.locked[requester] = true;
+		plan.total += needed;
+	}
+
+	int actionCount = 0;
+	for (int i = 0; i < count; ++i) {
+		const KromStreamingState *state = &states[i];
+		bool loading = state->loadingLevel >= 0 && state->loadingLevel < state->residentLevel;
+		int committed = loading ? state->loadingLevel : state->residentLevel;
+		if (plan.levels[i] != committed) {
+			actions[actionCount].texture = i;
+			actions[actionCount].level = plan.levels[i];
+			++actionCount;
+		}
+	}
+	return actionCount;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+
+// The residency decisions of texture streaming, kept free of any graphics code so they can be simulated.
+// Level 0 is the full resolution, a texture with residentLevel n has levels n to levelCount - 1 on the GPU.
+
+struct KromStreamingState {
+	int width, height; // of level 0
+	int levelCount;
+	int residentLevel;
+	int loadingLevel;  // finest level of the load in flight, -1 when there is none
+	int finestLevel;   // levels finer than this are never requested
+	int priority;      // higher is loaded first and evicted last
+	int lastUsedFrame; // -1 when never bound
+};
+
+struct KromStreamingAction {
+	int texture; // index into the states
+	int level;   // finer than residentLevel starts a load, coarser evicts
+};
+
+// Bytes the RGBA32 levels from level to the last one take
+size_t streamingChainBytes(const KromStreamingState *state, int level);
+
+// Bytes a state takes against the budget, loads in flight count with the size they will have
+size_t streamingCommittedBytes(const KromStreamingState *state);
+
+// Plans loads for the textures bound during the last usageFrames frames and the evictions that make room for them.
+// Evictions drop one level at a time from the least recently used and then lowest priority textures, only from
+// textures bound earlier than the one that needs the room or in the same frame with a lower priority, and from any
+// texture until the budget holds again when it was lowered.
+// The levels each texture is left with are written to actions, which needs room for count entries, one action per
+// changed texture in texture order, and the number of actions is returned. The caller applies evictions right away and
+// loads once they finished, updating residentLevel and loadingLevel itself. The result only depends on the arguments.
+int planTextureStreaming(const KromStreamingState *states, int count, size_t budget, int frame, int usageFrames, KromStreamingAction *actions);
@@ -0,0 +1,522 @@
+#include "vertices.h"
+
+#include "jobs.h"
+
+#include <kinc/system.h>
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KROM_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define KROM_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+	enum ComponentType { COMPONENT_F32, COMPONENT_I8, COMPONENT_U8, COMPONENT_I16, COMPONENT_U16, COMPONENT_I32, COMPONENT_U32 };
+
+	struct Format {
+		ComponentType type;
+		int components;
+		bool normalized;
+	};
+
+	const int maxElements = 16;
+	const int blockVertices = 256;
+	const int maxElementSize = 64; // F32_4X4
+	const int verticesPerChunk = 16 * 1024;
+
+	double lastVerticesPerSecond = 0.0;
+	size_t packedBytes = 0;
+	size_t float32Bytes = 0;
+
+	bool describe(kinc_g4_vertex_data_t data, Format *format) {
+		switch (data) {
+		case KINC_G4_VERTEX_DATA_F32_1X:
+			*format = {COMPONENT_F32, 1, false};
+			return true;
+		case KINC_G4_VERTEX_DATA_F32_2X:
+			*format = {COMPONENT_F32, 2, false};
+			return true;
+		case KINC_G4_VERTEX_DATA_F32_3X:
+			*format = {COMPONENT_F32, 3, false};
+			return true;
+		case KINC_G4_VERTEX_DATA_F32_4X:
+			*format = {COMPONENT_F32, 4, false};
+			return true;
+		case KINC_G4_VERTEX_DATA_F32_4X4:
+			*format = {COMPONENT_F32, 16, false};
+			return true;
+		case KINC_G4_VERTEX_DATA_I8_1X:
+			*format = {COMPONENT_I8, 1, false};
+			return true;
+		case KINC_G4_VERTEX_DATA_U8_1X:
+			*format = {COMPONENT_U8, 1, false};
+			return true;
+		case KINC_G4_VERTEX_DATA_I8_1X_NORMALIZED:
+			*format = {COMPONENT_I8, 1, true};
+			return true;
+		case KINC_G4_VERTEX_DATA_U8_1X_NORMALIZED:
+			*format = {COMPONENT_U8, 1, true};
+			return true;
+		case KINC_G4_VERTEX_DATA_I8_2X:
+			*format = {COMPONENT_I8, 2, false};
+			return true;
+		case KINC_G4_VERTEX_DATA_U8_2X:
+			*format = {COMPONENT_U8, 2, false};
+			return true;
+		case KINC_G4_VERTEX_DATA_I8_2X_NORMALIZED:
+			*format = {COMPONENT_I8, 2, true};
+			return true;
+		case KINC_G4_VERTEX_DATA_U8_2X_NORMALIZED:
+			*format = {COMPONENT_U8, 2, true};
+			return true;
+		case KINC_G4_VERTEX_DATA_I8_4X:
+			*format = {COMPONENT_I8, 4, false};
+			return true;
+		case KINC_G4_VERTEX_DATA_U8_4X:
+			*format = {COMPONENT_U8, 4, false};
+			return true;
+		case KINC_G4_VERTEX_DATA_I8_4X_NORMALIZED:
+			*format = {COMPONENT_I8, 4, true};
+			return true;
+		case KINC_G4_VERTEX_DATA_U8_4X_NORMALIZED:
+			*format = {COMPONENT_U8, 4, true};
+			return true;
+		case KINC_G4_VERTEX_DATA_I16_1X:
+			*format = {COMPONENT_I16, 1, false};
+			return true;
+		case KINC_G4_VERTEX_DATA_U16_1X:
+			*format = {COMPONENT_U16, 1, false};
+			return true;
+		case KINC_G4_VERTEX_DATA_I16_1X_NORMALIZED:
+			*format = {COMPONENT_I16, 1, true};
+			return true;
+		case KINC_G4_VERTEX_DATA_U16_1X_NORMALIZED:
+			*format = {COMPONENT_U16, 1, true};
+			return true;
+		case KINC_G4_VERTEX_DATA_I16_2X:
+			*format = {COMPONENT_I16, 2, false};
+			return true;
+		case KINC_G4_VERTEX_DATA_U16_2X:
+			*format = {COMPONENT_U16, 2, false};
+			return true;
+		case KINC_G4_VERTEX_DATA_I16_2X_NORMALIZED:
+			*format = {COMPONENT_I16, 2, true};
+			return true;
+		case KINC_G4_VERTEX_DATA_U16_2X_NORMALIZED:
+			*format = {COMPONENT_U16, 2, true};
+			return true;
+		case KINC_G4_VERTEX_DATA_I16_4X:
+			*format = {COMPONENT_I16, 4, false};
+			return true;
+		case KINC_G4_VERTEX_DATA_U16_4X:
+			*format = {COMPONENT_U16, 4, false};
+			return true;
+		case KINC_G4_VERTEX_DATA_I16_4X_NORMALIZED:
+			*format = {COMPONENT_I16, 4, true};
+			return true;
+		case KINC_G4_VERTEX_DATA_U16_4X_NORMALIZED:
+			*format = {COMPONENT_U16, 4, true};
+			return true;
+		case KINC_G4_VERTEX_DATA_I32_1X:
+			*format = {COMPONENT_I32, 1, false};
+			return true;
+		case KINC_G4_VERTEX_DATA_U32_1X:
+			*format = {COMPONENT_U32, 1, false};
+			return true;
+		case KINC_G4_VERTEX_DATA_I32_2X:
+			*format = {COMPONENT_I32, 2, false};
+			return true;
+		case KINC_G4_VERTEX_DATA_U32_2X:
+			*format = {COMPONENT_U32, 2, false};
+			return true;
+		case KINC_G4_VERTEX_DATA_I32_3X:
+			*format = {COMPONENT_I32, 3, false};
+			return true;
+		case KINC_G4_VERTEX_DATA_U32_3X:
+			*format = {COMPONENT_U32, 3, false};
+			return true;
+		case KINC_G4_VERTEX_DATA_I32_4X:
+			*format = {COMPONENT_I32, 4, false};
+			return true;
+		case KINC_G4_VERTEX_DATA_U32_4X:
+			*format = {COMPONENT_U32, 4, false};
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	int componentSize(ComponentType type) {
+		switch (type) {
+		case COMPONENT_I8:
+		case COMPONENT_U8:
+			return 1;
+		case COMPONENT_I16:
+		case COMPONENT_U16:
+			return 2;
+		default:
+			return 4;
+		}
+	}
+
+	int sourceComponentSize(KromVertexSourceType type) {
+		switch (type) {
+		case KROM_VERTEX_SOURCE_INT8:
+		case KROM_VERTEX_SOURCE_UINT8:
+			return 1;
+		case KROM_VERTEX_SOURCE_INT16:
+		case KROM_VERTEX_SOURCE_UINT16:
+			return 2;
+		default:
+			return 4;
+		}
+	}
+
+	bool sameType(KromVertexSourceType source, ComponentType target) {
+		switch (source) {
+		case KROM_VERTEX_SOURCE_FLOAT32:
+			return target == COMPONENT_F32;
+		case KROM_VERTEX_SOURCE_INT8:
+			return target == COMPONENT_I8;
+		case KROM_VERTEX_SOURCE_UINT8:
+			return target == COMPONENT_U8;
+		case KROM_VERTEX_SOURCE_INT16:
+			return target == COMPONENT_I16;
+		case KROM_VERTEX_SOURCE_UINT16:
+			return target == COMPONENT_U16;
+		case KROM_VERTEX_SOURCE_INT32:
+			return target == COMPONENT_I32;
+		case KROM_VERTEX_SOURCE_UINT32:
+		default:
+			return target == COMPONENT_U32;
+		}
+	}
+
+	// What float sources are clamped to before scaling, the integer range itself for formats that are not normalized
+	void floatRange(const Format &format, float *low, float *high, float *scale) {
+		*scale = 1.0f;
+		switch (format.type) {
+		case COMPONENT_I8:
+			*low = format.normalized ? -1.0f : -128.0f;
+			*high = format.normalized ? 1.0f : 127.0f;
+			*scale = format.normalized ? 127.0f : 1.0f;
+			break;
+		case COMPONENT_U8:
+			*low = 0.0f;
+			*high = format.normalized ? 1.0f : 255.0f;
+			*scale = format.normalized ? 255.0f : 1.0f;
+			break;
+		case COMPONENT_I16:
+			*low = format.normalized ? -1.0f : -32768.0f;
+			*high = format.normalized ? 1.0f : 32767.0f;
+			*scale = format.normalized ? 32767.0f : 1.0f;
+			break;
+		case COMPONENT_U16:
+			*low = 0.0f;
+			*high = format.normalized ? 1.0f : 65535.0f;
+			*scale = format.normalized ? 65535.0f : 1.0f;
+			break;
+		case COMPONENT_I32:
+			// The largest floats below the limits
+			*low = -2147483648.0f;
+			*high = 2147483520.0f;
+			break;
+		case COMPONENT_U32:
+			*low = 0.0f;
+			*high = 4294967040.0f;
+			break;
+		case COMPONENT_F32:
+			*low = -INFINITY;
+			*high = INFINITY;
+			break;
+		}
+	}
+
+	void storeInteger(void *out, size_t index, ComponentType type, int64_t value) {
+		switch (type) {
+		case COMPONENT_I8:
+			((int8_t *)out)[index] = (int8_t)(value < -128 ? -128 : (value > 127 ? 127 : value));
+			break;
+		case COMPONENT_U8:
+			((uint8_t *)out)[index] = (uint8_t)(value < 0 ? 0 : (value > 255 ? 255 : value));
+			break;
+		case COMPONENT_I16:
+			((int16_t *)out)[index] = (int16_t)(value < -32768 ? -32768 : (value > 32767 ? 32767 : value));
+			break;
+		case COMPONENT_U16:
+			((uint16_t *)out)[index] = (uint16_t)(value < 0 ? 0 : (value > 65535 ? 65535 : value));
+			break;
+		case COMPONENT_I32:
+			((int32_t *)out)[index] = (int32_t)(value < INT32_MIN ? INT32_MIN : (value > INT32_MAX ? INT32_MAX : value));
+			break;
+		case COMPONENT_U32:
+			((uint32_t *)out)[index] = (uint32_t)(value < 0 ? 0 : (value > UINT32_MAX ? UINT32_MAX : value));
+			break;
+		case COMPONENT_F32:
+			((float *)out)[index] = (float)value;
+			break;
+		}
+	}
+
+	int64_t loadInteger(const void *in, size_t index, KromVertexSourceType type) {
+		switch (type) {
+		case KROM_VERTEX_SOURCE_INT8:
+			return ((const int8_t *)in)[index];
+		case KROM_VERTEX_SOURCE_UINT8:
+			return ((const uint8_t *)in)[index];
+		case KROM_VERTEX_SOURCE_INT16:
+			return ((const int16_t *)in)[index];
+		case KROM_VERTEX_SOURCE_UINT16:
+			return ((const uint16_t *)in)[index];
+		case KROM_VERTEX_SOURCE_INT32:
+			return ((const int32_t *)in)[index];
+		case KROM_VERTEX_SOURCE_UINT32:
+			return ((const uint32_t *)in)[index];
+		case KROM_VERTEX_SOURCE_FLOAT32:
+		default:
+			return (int64_t)((const float *)in)[index];
+		}
+	}
+
+#if defined(KROM_SSE2)
+	// Four clamped and scaled floats, rounded to the nearest integer. max_ps returns low for NaN.
+	inline __m128i convert4(const float *in, __m128 low, __m128 high, __m128 scale) {
+		__m128 value = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in), low), high);
+		return _mm_cvtps_epi32(_mm_mul_ps(value, scale));
+	}
+#elif defined(KROM_NEON)
+	inline int32x4_t convert4(const float *in, float32x4_t low, float32x4_t high, float32x4_t scale) {
+		float32x4_t value = vmulq_f32(vminq_f32(vmaxq_f32(vld1q_f32(in), low), high), scale);
+#if defined(__aarch64__)
+		return vcvtnq_s32_f32(value);
+#else
+		// Rounds halves away from zero where the other paths round them to even
+		float32x4_t half = vbslq_f32(vcltq_f32(value, vdupq_n_f32(0.0f)), vdupq_n_f32(-0.5f), vdupq_n_f32(0.5f));
+		return vcvtq_s32_f32(vaddq_f32(value, half));
+#endif
+	}
+#endif
+
+	void convertFloats(const float *in, size_t count, const Format &format, void *out) {
+		if (format.type == COMPONENT_F32) {
+			memcpy(out, in, count * sizeof(float));
+			return;
+		}
+		float low = 0.0f, high = 0.0f, scale = 1.0f;
+		floatRange(format, &low, &high, &scale);
+
+		size_t i = 0;
+#if defined(KROM_SSE2)
+		__m128 lowVector = _mm_set1_ps(low);
+		__m128 highVector = _mm_set1_ps(high);
+		__m128 scaleVector = _mm_set1_ps(scale);
+		switch (format.type) {
+		case COMPONENT_I16:
+			for (; i + 8 <= count; i += 8) {
+				__m128i a = convert4(&in[i], lowVector, highVector, scaleVector);
+				__m128i b = convert4(&in[i + 4], lowVector, highVector, scaleVector);
+				_mm_storeu_si128((__m128i *)((int16_t *)out + i), _mm_packs_epi32(a, b));
+			}
+			break;
+		case COMPONENT_U16: {
+			// SSE2 has no unsigned 32 to 16 bit pack, so the values are moved into the signed range and back
+			__m128i bias = _mm_set1_epi32(32768);
+			__m128i flip = _mm_set1_epi16((short)0x8000);
+			for (; i + 8 <= count; i += 8) {
+				__m128i a = _mm_sub_epi32(convert4(&in[i], lowVector, highVector, scaleVector), bias);
+				__m128i b = _mm_sub_epi32(convert4(&in[i + 4], lowVector, highVector, scaleVector), bias);
+				_mm_storeu_si128((__m128i *)((uint16_t *)out + i), _mm_xor_si128(_mm_packs_epi32(a, b), flip));
+			}
+			break;
+		}
+		case COMPONENT_I8:
+		case COMPONENT_U8:
+			for (; i + 16 <= count; i += 16) {
+				__m128i a = _mm_packs_epi32(convert4(&in[i], lowVector, highVector, scaleVector), convert4(&in[i + 4], lowVector, highVector, scaleVector));
+				__m128i b = _mm_packs_epi32(convert4(&in[i + 8], lowVector, highVector, scaleVector), convert4(&in[i + 12], lowVector, highVector, scaleVector));
+				__m128i packed = format.type == COMPONENT_I8 ? _mm_packs_epi16(a, b) : _mm_packus_epi16(a, b);
+				_mm_storeu_si128((__m128i *)((uint8_t *)out + i), packed);
+			}
+			break;
+		default:
+			break;
+		}
+#elif defined(KROM_NEON)
+		float32x4_t lowVector = vdupq_n_f32(low);
+		float32x4_t highVector = vdupq_n_f32(high);
+		float32x4_t scaleVector = vdupq_n_f32(scale);
+		switch (format.type) {
+		case COMPONENT_I16:
+			for (; i + 8 <= count; i += 8) {
+				int32x4_t a = convert4(&in[i], lowVector, highVector, scaleVector);
+				int32x4_t b = convert4(&in[i + 4], lowVector, highVector, scaleVector);
+				vst1q_s16((int16_t *)out + i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+			}
+			break;
+		case COMPONENT_U16:
+			for (; i + 8 <= count; i += 8) {
+				int32x4_t a = convert4(&in[i], lowVector, highVector, scaleVector);
+				int32x4_t b = convert4(&in[i + 4], lowVector, highVector, scaleVector);
+				vst1q_u16((uint16_t *)out + i, vcombine_u16(vqmovun_s32(a), vqmovun_s32(b)));
+			}
+			break;
+		case COMPONENT_I8:
+		case COMPONENT_U8:
+			for (; i + 16 <= count; i += 16) {
+				int16x8_t a = vcombine_s16(vqmovn_s32(convert4(&in[i], lowVector, highVector, scaleVector)),
+				                           vqmovn_s32(convert4(&in[i + 4], lowVector, highVector, scaleVector)));
+				int16x8_t b = vcombine_s16(vqmovn_s32(convert4(&in[i + 8], lowVector, highVector, scaleVector)),
+				                           vqmovn_s32(convert4(&in[i + 12], lowVector, highVector, scaleVector)));
+				if (format.type == COMPONENT_I8) {
+					vst1q_s8((int8_t *)out + i, vcombine_s8(vqmovn_s16(a), vqmovn_s16(b)));
+				}
+				else {
+					vst1q_u8((uint8_t *)out + i, vcombine_u8(vqmovun_s16(a), vqmovun_s16(b)));
+				}
+			}
+			break;
+		default:
+			break;
+		}
+#endif
+		for (; i < count; ++i) {
+			float value = in[i];
+			// Written so that NaN ends up at low like in the vector paths
+			value = value >= low ? value : low;
+			value = value <= high ? value : high;
+			storeInteger(out, i, format.type, (int64_t)llrintf(value * scale));
+		}
+	}
+
+	// count components of source from first on into out, in the format's component type
+	void convertRun(const KromVertexSource *source, size_t first, size_t count, const Format &format, void *out) {
+		if (source->type == KROM_VERTEX_SOURCE_FLOAT32) {
+			convertFloats((const float *)source->data + first, count, format, out);
+		}
+		else if (sameType(source->type, format.type)) {
+			int size = sourceComponentSize(source->type);
+			memcpy(out, (const uint8_t *)source->data + first * size, count * size);
+		}
+		else {
+			for (size_t i = 0; i < count; ++i) {
+				storeInteger(out, i, format.type, loadInteger(source->data, first + i, source->type));
+			}
+		}
+	}
+
+	// Copies count elements of size bytes into every stride bytes, with fixed sizes for the common elements
+	void scatter(const uint8_t *in, int size, int count, uint8_t *out, int stride) {
+		switch (size) {
+		case 4:
+			for (int i = 0; i < count; ++i) memcpy(out + (size_t)i * stride, in + i * 4, 4);
+			break;
+		case 8:
+			for (int i = 0; i < count; ++i) memcpy(out + (size_t)i * stride, in + i * 8, 8);
+			break;
+		case 12:
+			for (int i = 0; i < count; ++i) memcpy(out + (size_t)i * stride, in + i * 12, 12);
+			break;
+		case 16:
+			for (int i = 0; i < count; ++i) memcpy(out + (size_t)i * stride, in + i * 16, 16);
+			break;
+		default:
+			for (int i = 0; i < count; ++i) memcpy(out + (size_t)i * stride, in + i * size, size);
+			break;
+		}
+	}
+
+	struct PackJob {
+		Format formats[maxElements];
+		int offsets[maxElements];
+		const KromVertexSource *sources;
+		int elementCount;
+		uint8_t *out;
+		int stride;
+	};
+
+	void packRange(const PackJob *job, int first, int last) {
+		uint8_t block[blockVertices * maxElementSize];
+		for (int start = first; start < last; start += blockVertices) {
+			int vertices = last - start < blockVertices ? last - start : blockVertices;
+			for (int element = 0; element < job->elementCount; ++element) {
+				const Format &format = job->formats[element];
+				convertRun(&job->sources[element], (size_t)start * format.components, (size_t)vertices * format.components, format, block);
+				scatter(block, format.components * componentSize(format.type), vertices, job->out + (size_t)start * job->stride + job->offsets[element],
+				        job->stride);
+			}
+		}
+	}
+
+	void packJobRange(void *data, int first, int last) {
+		packRange((const PackJob *)data, first, last);
+	}
+}
+
+int vertexDataSize(kinc_g4_vertex_data_t data) {
+	Format format;
+	if (!describe(data, &format)) {
+		return 0;
+	}
+	return format.components * componentSize(format.type);
+}
+
+int vertexDataComponents(kinc_g4_vertex_data_t data) {
+	Format format;
+	return describe(data, &format) ? format.components : 0;
+}
+
+bool checkVertexSources(const kinc_g4_vertex_data_t *elements, const KromVertexSource *sources, int elementCount, int count, int stride) {
+	if (elementCount > maxElements || count < 0) {
+		return false;
+	}
+	int size = 0;
+	for (int i = 0; i < elementCount; ++i) {
+		Format format;
+		if (!describe(elements[i], &format) || sources[i].length < (size_t)count * format.components) {
+			return false;
+		}
+		size += format.components * componentSize(format.type);
+	}
+	return size == stride;
+}
+
+bool packVertices(const kinc_g4_vertex_data_t *elements, const KromVertexSource *sources, int elementCount, int count, uint8_t *out, int stride) {
+	if (!checkVertexSources(elements, sources, elementCount, count, stride)) {
+		return false;
+	}
+	PackJob job;
+	int offset = 0;
+	int floatStride = 0;
+	for (int i = 0; i < elementCount; ++i) {
+		describe(elements[i], &job.formats[i]);
+		job.offsets[i] = offset;
+		offset += job.formats[i].components * componentSize(job.formats[i].type);
+		floatStride += job.formats[i].components * 4;
+	}
+	job.sources = sources;
+	job.elementCount = elementCount;
+	job.out = out;
+	job.stride = stride;
+
+	double start = kinc_time();
+	parallelFor(count, verticesPerChunk, packJobRange, &job);
+	double seconds = kinc_time() - start;
+
+	if (seconds > 0.0) {
+		lastVerticesPerSecond = count / seconds;
+	}
+	packedBytes += (size_t)count * stride;
+	float32Bytes += (size_t)count * floatStride;
+	return true;
+}
+
+void vertexStats(KromVertexStats *stats) {
+	stats->verticesPerSecond = lastVerticesPerSecond;
+	stats->packedBytes = packedBytes;
+	stats->float32Bytes = float32Bytes;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <kinc/graphics4/vertexstructure.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum KromVertexSourceType {
+	KROM_VERTEX_SOURCE_FLOAT32,
+	KROM_VERTEX_SOURCE_INT8,
+	KROM_VERTEX_SOURCE_UINT8,
+	KROM_VERTEX_SOURCE_INT16,
+	KROM_VERTEX_SOURCE_UINT16,
+	KROM_VERTEX_SOURCE_INT32,
+	KROM_VERTEX_SOURCE_UINT32
+};
+
+// One attribute of every vertex, tightly packed
+struct KromVertexSource {
+	const void *data;
+	KromVertexSourceType type;
+	size_t length; // in components
+};
+
+// Bytes one element of the format takes in a vertex, 0 for KINC_G4_VERTEX_DATA_NONE
+int vertexDataSize(kinc_g4_vertex_data_t data);
+int vertexDataComponents(kinc_g4_vertex_data_t data);
+
+// Whether packVertices would accept the arguments, to check them before a buffer gets locked
+bool checkVertexSources(const kinc_g4_vertex_data_t *elements, const KromVertexSource *sources, int elementCount, int count, int stride);
+
+// Interleaves count vertices from one source per element into out, converting to the element formats on the way.
+// Float sources are clamped to [-1, 1] or [0, 1] and scaled for normalized formats and rounded for the other
+// integer formats, integer sources are taken as the integers they hold. Big meshes are split across the job pool.
+// Returns false without writing anything when checkVertexSources fails.
+bool packVertices(const kinc_g4_vertex_data_t *elements, const KromVertexSource *sources, int elementCount, int count, uint8_t *out, int stride);
+
+struct KromVertexStats {
+	double verticesPerSecond; // over the last packVertices
+	size_t packedBytes;       // written by packVertices so far
+	size_t float32Bytes;      // what the same attributes would have taken as 32 bit floats
+};
+
+void vertexStats(KromVertexStats *stats);
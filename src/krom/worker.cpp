@@ -5,6 +5,7 @@
 
 #include <kinc/log.h>
 #include <kinc/io/filereader.h>
+#include <kinc/threads/event.h>
 #include <kinc/threads/mutex.h>
 #include <kinc/threads/thread.h>
 #include <kinc/system.h>
@@ -31,13 +32,15 @@ struct MessageQueue {
 	size_t messageCapacity;
 	kinc_mutex_t messageMutex;
 	JsValueRef messageFunc;
+	kinc_event_t *wakeEvent; // of the thread reading the queue, nullptr for the main thread which polls every frame
 };
 
 struct WorkerMessagePort {
 	MessageQueue workerMessages;
 	MessageQueue ownerMessages;
 
-	bool isTerminated;
+	kinc_event_t wakeEvent;
+	volatile bool isTerminated;
 };
 
 struct WorkerData {
@@ -54,22 +57,118 @@ struct ContextData {
 	OwnedWorker *workers;
 	size_t workersCount;
 	size_t workersCapacity;
+	kinc_event_t *wakeEvent;
 };
 
-struct IntervalFunction {
+struct Timer {
 	JsValueRef function;
 	double interval;
 	double nextCallTime;
 	int id;
+	bool repeat;
 };
 
-struct IntervalFunctions {
-	IntervalFunction *functions;
-	size_t functionCount;
-	size_t functionCapacity;
+// Binary min-heap ordered by nextCallTime
+struct Timers {
+	Timer *timers;
+	size_t timerCount;
+	size_t timerCapacity;
 	int latestId;
+	int runningId;
+	bool runningCleared;
 };
 
+// Browsers clamp timer delays as well, this also keeps a zero interval from starving the message queue
+static const double minimumTimerDelay = 0.001;
+
+static void siftTimerUp(Timers *timers, size_t index) {
+	Timer timer = timers->timers[index];
+	while (index > 0) {
+		size_t parent = (index - 1) / 2;
+		if (timers->timers[parent].nextCallTime <= timer.nextCallTime) {
+			break;
+		}
+		timers->timers[index] = timers->timers[parent];
+		index = parent;
+	}
+	timers->timers[index] = timer;
+}
+
+static void siftTimerDown(Timers *timers, size_t index) {
+	Timer timer = timers->timers[index];
+	for (;;) {
+		size_t child = index * 2 + 1;
+		if (child >= timers->timerCount) {
+			break;
+		}
+		if (child + 1 < timers->timerCount && timers->timers[child + 1].nextCallTime < timers->timers[child].nextCallTime) {
+			child++;
+		}
+		if (timer.nextCallTime <= timers->timers[child].nextCallTime) {
+			break;
+		}
+		timers->timers[index] = timers->timers[child];
+		index = child;
+	}
+	timers->timers[index] = timer;
+}
+
+static void pushTimer(Timers *timers, Timer timer) {
+	if (timers->timerCount == timers->timerCapacity) {
+		timers->timerCapacity = (timers->timerCapacity == 0) ? 4 : (2 * timers->timerCapacity);
+		timers->timers = (Timer *)realloc(timers->timers, timers->timerCapacity * sizeof(Timer));
+	}
+	timers->timers[timers->timerCount] = timer;
+	timers->timerCount++;
+	siftTimerUp(timers, timers->timerCount - 1);
+}
+
+static Timer removeTimer(Timers *timers, size_t index) {
+	Timer timer = timers->timers[index];
+	timers->timerCount--;
+	if (index != timers->timerCount) {
+		timers->timers[index] = timers->timers[timers->timerCount];
+		siftTimerDown(timers, index);
+		siftTimerUp(timers, index);
+	}
+	return timer;
+}
+
+static void wakeQueue(MessageQueue *messageQueue) {
+	if (messageQueue->wakeEvent != nullptr) {
+		kinc_event_signal(messageQueue->wakeEvent);
+	}
+}
+
+static void terminateWorker(WorkerMessagePort *messagePort) {
+	messagePort->isTerminated = true;
+	kinc_event_signal(&messagePort->wakeEvent);
+}
+
+static void initMessageQueue(MessageQueue *messageQueue, kinc_event_t *wakeEvent) {
+	messageQueue->messages = nullptr;
+	messageQueue->messageCount = 0;
+	messageQueue->messageCapacity = 0;
+	messageQueue->messageFunc = JS_INVALID_REFERENCE;
+	messageQueue->wakeEvent = wakeEvent;
+	kinc_mutex_init(&messageQueue->messageMutex);
+}
+
+static void destroyMessagePort(WorkerMessagePort *messagePort) {
+	for (size_t i = 0; i < messagePort->ownerMessages.messageCount; ++i) {
+		free(messagePort->ownerMessages.messages[i].message);
+	}
+	for (size_t i = 0; i < messagePort->workerMessages.messageCount; ++i) {
+		free(messagePort->workerMessages.messages[i].message);
+	}
+	free(messagePort->ownerMessages.messages);
+	free(messagePort->workerMessages.messages);
+	kinc_mutex_destroy(&messagePort->ownerMessages.messageMutex);
+	kinc_mutex_destroy(&messagePort->workerMessages.messageMutex);
+	kinc_event_destroy(&messagePort->wakeEvent);
+	free(messagePort);
+}
+
 static void setOnmessage(MessageQueue* messageQueue, JsValueRef callback) {
 	JsValueType type;
 	JsGetValueType(callback, &type);
@@ -124,6 +223,8 @@ static void postMessage(MessageQueue* messageQueue, JsValueRef messageObject) {
 	messageQueue->messageCount++;
 
 	kinc_mutex_unlock(&messageQueue->messageMutex);
+
+	wakeQueue(messageQueue);
 }
 
 static void checkAndClearExceptions(void) {
@@ -250,51 +351,70 @@ static JsValueRef CALLBACK worker_add_event_listener(JsValueRef callee, bool isC
 	return arguments[1];
 }
 
-static JsValueRef CALLBACK worker_set_interval(JsValueRef callee, bool isConstructCall, JsValueRef *arguments, unsigned short argumentCount,
-                                                     void *callbackState) {
-	IntervalFunctions *intervalFunctions = (IntervalFunctions *)callbackState;
+static JsValueRef addTimer(Timers *timers, JsValueRef *arguments, unsigned short argumentCount, bool repeat) {
+	if (argumentCount < 2) {
+		return JS_INVALID_REFERENCE;
+	}
 
 	JsValueRef function = arguments[1];
 	JsAddRef(function, nullptr);
 
-	double frequency;
+	double delay;
 	if (argumentCount > 2) {
-		JsNumberToDouble(arguments[2], &frequency);
-		frequency /= 1000.0;
+		JsNumberToDouble(arguments[2], &delay);
+		delay /= 1000.0;
 	}
 	else {
-		frequency = 0.016;
+		delay = repeat ? 0.016 : 0.0;
 	}
-
-	if (intervalFunctions->functionCount == intervalFunctions->functionCapacity) {
-		intervalFunctions->functionCapacity = (intervalFunctions->functionCapacity == 0) ? 4 : (2 * intervalFunctions->functionCapacity);
-		intervalFunctions->functions = (IntervalFunction *)realloc(intervalFunctions->functions, intervalFunctions->functionCapacity * sizeof(IntervalFunction));
+	if (!(delay >= minimumTimerDelay)) {
+		delay = minimumTimerDelay;
 	}
 
-	IntervalFunction *intervalFunction = &intervalFunctions->functions[intervalFunctions->functionCount];
-	intervalFunction->function = function;
-	intervalFunction->interval = frequency;
-	intervalFunction->nextCallTime = kinc_time() + frequency;
-	intervalFunction->id = intervalFunctions->latestId;
-
-	intervalFunctions->latestId++;
-	intervalFunctions->functionCount++;
+	Timer timer;
+	timer.function = function;
+	timer.interval = delay;
+	timer.nextCallTime = kinc_time() + delay;
+	timer.id = timers->latestId;
+	timer.repeat = repeat;
+	timers->latestId++;
+	pushTimer(timers, timer);
 
 	JsValueRef id;
-	JsIntToNumber(intervalFunction->id, &id);
+	JsIntToNumber(timer.id, &id);
 	return id;
 }
 
-static JsValueRef CALLBACK worker_clear_interval(JsValueRef callee, bool isConstructCall, JsValueRef *arguments, unsigned short argumentCount,
+static JsValueRef CALLBACK worker_set_interval(JsValueRef callee, bool isConstructCall, JsValueRef *arguments, unsigned short argumentCount,
                                                void *callbackState) {
-	IntervalFunctions *intervalFunctions = (IntervalFunctions *)callbackState;
+	return addTimer((Timers *)callbackState, arguments, argumentCount, true);
+}
+
+static JsValueRef CALLBACK worker_set_timeout(JsValueRef callee, bool isConstructCall, JsValueRef *arguments, unsigned short argumentCount,
+                                              void *callbackState) {
+	return addTimer((Timers *)callbackState, arguments, argumentCount, false);
+}
+
+// Serves clearInterval and clearTimeout, both share one id space like in browsers
+static JsValueRef CALLBACK worker_clear_timer(JsValueRef callee, bool isConstructCall, JsValueRef *arguments, unsigned short argumentCount,
+                                              void *callbackState) {
+	Timers *timers = (Timers *)callbackState;
+	if (argumentCount < 2) {
+		return JS_INVALID_REFERENCE;
+	}
 
 	int id;
 	JsNumberToInt(arguments[1], &id);
 
+	// The running timer is not in the heap, runTimers releases it instead of rescheduling
+	if (id == timers->runningId) {
+		timers->runningCleared = true;
+		return JS_INVALID_REFERENCE;
+	}
+
 	int index = -1;
-	for (int i = 0; i < intervalFunctions->functionCount; ++i) {
-		if (intervalFunctions->functions[i].id == id) {
+	for (int i = 0; i < timers->timerCount; ++i) {
+		if (timers->timers[i].id == id) {
 			index = i;
 			break;
 		}
@@ -304,15 +424,43 @@ static JsValueRef CALLBACK worker_clear_interval(JsValueRef callee, bool isConst
 		kinc_log(KINC_LOG_LEVEL_WARNING, "[clearInterval] attempting to remove function with id %d which isn't set", id);
 	}
 	else {
-		JsRelease(intervalFunctions->functions[index].function, nullptr);
+		Timer timer = removeTimer(timers, index);
+		JsRelease(timer.function, nullptr);
+	}
+
+	return JS_INVALID_REFERENCE;
+}
+
+// Calls every timer that is due and returns the time of the next deadline, or a negative value when no timer is left
+static double runTimers(Timers *timers) {
+	JsValueRef undefined;
+	JsGetUndefinedValue(&undefined);
 
-		intervalFunctions->functionCount--;
-		if (index != intervalFunctions->functionCount) {
-			intervalFunctions->functions[index] = intervalFunctions->functions[intervalFunctions->functionCount];
+	double time = kinc_time();
+	while (timers->timerCount > 0 && timers->timers[0].nextCallTime <= time) {
+		Timer timer = removeTimer(timers, 0);
+		timers->runningId = timer.id;
+		timers->runningCleared = false;
+
+		JsValueRef result;
+		JsCallFunction(timer.function, &undefined, 1, &result);
+		checkAndClearExceptions();
+
+		timers->runningId = -1;
+		if (timer.repeat && !timers->runningCleared) {
+			// Keep the original cadence but do not try to catch up on calls that were missed
+			timer.nextCallTime += timer.interval;
+			if (timer.nextCallTime <= time) {
+				timer.nextCallTime = time + timer.interval;
+			}
+			pushTimer(timers, timer);
+		}
+		else {
+			JsRelease(timer.function, nullptr);
 		}
 	}
 
-	return JS_INVALID_REFERENCE;
+	return timers->timerCount > 0 ? timers->timers[0].nextCallTime : -1.0;
 }
 
 static void worker_thread_func(void* param) {
@@ -331,6 +479,10 @@ static void worker_thread_func(void* param) {
 
 	bindWorkerClass();
 
+	ContextData *contextData;
+	JsGetContextData(context, (void **)&contextData);
+	contextData->wakeEvent = &messagePort->wakeEvent;
+
 	JsValueRef global;
 	JsGetGlobalObject(&global);
 
@@ -363,20 +515,27 @@ static void worker_thread_func(void* param) {
 	JsCreateFunction(worker_add_event_listener, messagePort, &addEventListener);
 	JsSetProperty(global, getId("addEventListener"), addEventListener, false);
 
-	IntervalFunctions intervalFunctions = {
+	Timers timers = {
 		nullptr,
 		0,
 		0,
-		0
+		0,
+		-1,
+		false
 	};
 
 	JsValueRef setInterval;
-	JsCreateFunction(worker_set_interval, &intervalFunctions, &setInterval);
+	JsCreateFunction(worker_set_interval, &timers, &setInterval);
 	JsSetProperty(global, getId("setInterval"), setInterval, false);
 
-	JsValueRef clearInterval;
-	JsCreateFunction(worker_clear_interval, &intervalFunctions, &clearInterval);
-	JsSetProperty(global, getId("clearInterval"), clearInterval, false);
+	JsValueRef setTimeout;
+	JsCreateFunction(worker_set_timeout, &timers, &setTimeout);
+	JsSetProperty(global, getId("setTimeout"), setTimeout, false);
+
+	JsValueRef clearTimer;
+	JsCreateFunction(worker_clear_timer, &timers, &clearTimer);
+	JsSetProperty(global, getId("clearInterval"), clearTimer, false);
+	JsSetProperty(global, getId("clearTimeout"), clearTimer, false);
 
 	kinc_file_reader_t reader;
 	if (!kinc_file_reader_open(&reader, workerData->fileName, KINC_FILE_TYPE_ASSET)) {
@@ -399,47 +558,40 @@ static void worker_thread_func(void* param) {
 
 	checkAndClearExceptions();
 
-	JsValueRef undefined;
-	JsGetUndefinedValue(&undefined);
-
+	// Sleeps until the next timer is due or a message arrives, postMessage and terminate signal wakeEvent
 	while (!messagePort->isTerminated) {
-		double time = kinc_time();
-		for (int i = 0; i < intervalFunctions.functionCount; ++i) {
-			if (intervalFunctions.functions[i].nextCallTime <= time) {
-				JsCallFunction(intervalFunctions.functions[i].function, &undefined, 1, &result);
-				checkAndClearExceptions();
-
-				intervalFunctions.functions[i].nextCallTime = time + intervalFunctions.functions[i].interval;
-			}
-		}
+		double nextCallTime = runTimers(&timers);
 
 		handleMessageQueue(&messagePort->ownerMessages);
 
 		handleWorkerMessages();
-	}
 
-	ContextData *contextData;
-	JsGetContextData(context, (void **)&contextData);
+		if (messagePort->isTerminated) {
+			break;
+		}
+		if (nextCallTime < 0.0) {
+			kinc_event_wait(&messagePort->wakeEvent);
+		}
+		else {
+			double timeout = nextCallTime - kinc_time();
+			if (timeout > 0.0) {
+				kinc_event_try_to_wait(&messagePort->wakeEvent, timeout);
+			}
+		}
+	}
 
 	for (int i = 0; i < contextData->workersCount; ++i) {
-		WorkerMessagePort *workerPort = contextData->workers[i].workerMessagePort;
-		workerPort->isTerminated = true;
+		terminateWorker(contextData->workers[i].workerMessagePort);
 		kinc_thread_wait_and_destroy(contextData->workers[i].workerThread);
 
 		free(contextData->workers[i].workerThread);
-		free(contextData->workers[i].workerMessagePort->ownerMessages.messages);
-		free(contextData->workers[i].workerMessagePort->workerMessages.messages);
-		kinc_mutex_destroy(&contextData->workers[i].workerMessagePort->ownerMessages.messageMutex);
-		kinc_mutex_destroy(&contextData->workers[i].workerMessagePort->workerMessages.messageMutex);
-		free(contextData->workers[i].workerMessagePort);
-		free(workerPort->ownerMessages.messages);
-		free(workerPort->workerMessages.messages);
-		kinc_mutex_destroy(&workerPort->ownerMessages.messageMutex);
-		kinc_mutex_destroy(&workerPort->workerMessages.messageMutex);
-		free(workerPort);
-	}
-
-	free(intervalFunctions.functions);
+		destroyMessagePort(contextData->workers[i].workerMessagePort);
+	}
+
+	for (int i = 0; i < timers.timerCount; ++i) {
+		JsRelease(timers.timers[i].function, nullptr);
+	}
+	free(timers.timers);
 	free(code);
 	free(workerData);
 	free(contextData->workers);
@@ -452,7 +604,7 @@ static void worker_thread_func(void* param) {
 static void CALLBACK worker_finalizer(void *data) {
 	WorkerMessagePort *messagePort = (WorkerMessagePort *)data;
 	
-	messagePort->isTerminated = true;
+	terminateWorker(messagePort);
 
 	JsContextRef context;
 	JsGetCurrentContext(&context);
@@ -482,11 +634,7 @@ static void CALLBACK worker_finalizer(void *data) {
 		}
 	}
 
-	free(messagePort->ownerMessages.messages);
-	free(messagePort->workerMessages.messages);
-	kinc_mutex_destroy(&messagePort->ownerMessages.messageMutex);
-	kinc_mutex_destroy(&messagePort->workerMessages.messageMutex);
-	free(messagePort);
+	destroyMessagePort(messagePort);
 }
 
 static JsValueRef CALLBACK owner_onmessage_get(JsValueRef callee, bool isConstructCall, JsValueRef* arguments, unsigned short argumentCount, void* callbackState) {
@@ -544,7 +692,7 @@ static JsValueRef CALLBACK owner_worker_terminate(JsValueRef callee, bool isCons
                                               void *callbackState) {
 	WorkerMessagePort *messagePort;
 	JsGetExternalData(arguments[0], (void **)&messagePort);
-	messagePort->isTerminated = true;
+	terminateWorker(messagePort);
 
 	return JS_INVALID_REFERENCE;
 }
@@ -577,18 +725,17 @@ static JsValueRef CALLBACK worker_constructor(JsValueRef callee, bool isConstruc
 		kinc_log(KINC_LOG_LEVEL_WARNING, "Krom only supports one argument for worker constructor, ignoring extra arguments");
 	}
 
+	JsContextRef context;
+	JsGetCurrentContext(&context);
+	ContextData *contextData;
+	JsGetContextData(context, (void **)&contextData);
+
 	WorkerMessagePort *messagePort = (WorkerMessagePort *)malloc(sizeof(WorkerMessagePort));
-	messagePort->ownerMessages.messages = nullptr;
-	messagePort->ownerMessages.messageCount = 0;
-	messagePort->ownerMessages.messageCapacity= 0;
-	messagePort->ownerMessages.messageFunc = JS_INVALID_REFERENCE;
-	messagePort->workerMessages.messages = nullptr;
-	messagePort->workerMessages.messageCapacity = 0;
-	messagePort->workerMessages.messageCount= 0;
-	messagePort->workerMessages.messageFunc = JS_INVALID_REFERENCE;
+	kinc_event_init(&messagePort->wakeEvent, true);
+	// The worker thread sleeps on the port's event, the owner on its own one if it is a worker itself
+	initMessageQueue(&messagePort->ownerMessages, &messagePort->wakeEvent);
+	initMessageQueue(&messagePort->workerMessages, contextData->wakeEvent);
 	messagePort->isTerminated = false;
-	kinc_mutex_init(&messagePort->ownerMessages.messageMutex);
-	kinc_mutex_init(&messagePort->workerMessages.messageMutex);
 	JsValueRef global;
 	JsGetGlobalObject(&global);
 	JsValueRef workerPrototype;
@@ -625,11 +772,6 @@ static JsValueRef CALLBACK worker_constructor(JsValueRef callee, bool isConstruc
 
 	kinc_thread_init(ownedWorker.workerThread, worker_thread_func, workerData);
 
-	JsContextRef context;
-	JsGetCurrentContext(&context);
-	ContextData *contextData;
-	JsGetContextData(context, (void **)&contextData);
-
 	if (contextData->workersCount == contextData->workersCapacity) {
 		contextData->workersCapacity = (contextData->workersCapacity == 0) ? 4 : (contextData->workersCapacity * 2);
 		contextData->workers = (OwnedWorker *)realloc(contextData->workers, contextData->workersCapacity * sizeof(OwnedWorker));
@@ -691,6 +833,7 @@ void bindWorkerClass() {
 	contextData->workers = nullptr;
 	contextData->workersCount = 0;
 	contextData->workersCapacity = 0;
+	contextData->wakeEvent = nullptr;
 
 	JsContextRef context;
 	JsGetCurrentContext(&context);
@@ -0,0 +1,297 @@
+#include "module_stat_cache.h"
+
+#include <sys/stat.h>
+
+#include <limits>
+
+namespace node {
+namespace fs {
+
+namespace {
+
+// Names read from a directory at once.
+constexpr unsigned int kDirentBatch = 64;
+
+int64_t ToNs(const uv_timespec_t& time) {
+  return static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+}
+
+bool SameTime(const uv_timespec_t& a, const uv_timespec_t& b) {
+  return a.tv_sec == b.tv_sec && a.tv_nsec == b.tv_nsec;
+}
+
+int64_t NowNs() {
+  uv_timeval64_t now;
+  if (uv_gettimeofday(&now) != 0)
+    return 0;
+  return now.tv_sec * 1000000000 + static_cast<int64_t>(now.tv_usec) * 1000;
+}
+
+bool IsAscii(const std::string& name) {
+  for (char c : name) {
+    if (static_cast<unsigned char>(c) >= 0x80)
+      return false;
+  }
+  return true;
+}
+
+// Errors with which every path inside of a directory fails as well.
+bool IsMissing(int err) {
+  return err == UV_ENOENT || err == UV_ENOTDIR;
+}
+
+}  // anonymous namespace
+
+int ModuleStatCache::StatPath(const std::string& path) {
+  uv_fs_t req;
+  int rc = uv_fs_stat(loop_, &req, path.c_str(), nullptr);
+  if (rc == 0) {
+    const uv_stat_t* const s = static_cast<const uv_stat_t*>(req.ptr);
+    rc = !!(s->st_mode & S_IFDIR);
+  }
+  uv_fs_req_cleanup(&req);
+  return rc;
+}
+
+int ModuleStatCache::Stat(const std::string& path, uint64_t pass) {
+#ifdef _WIN32
+  // Names are matched case-insensitively and with 8.3 aliases on Windows,
+  // which a listing cannot answer for.
+  return StatPath(path);
+#else
+  const size_t slash = path.rfind('/');
+  if (slash == std::string::npos)
+    return StatPath(path);
+  const std::string name = path.substr(slash + 1);
+  if (name.empty() || name == "." || name == "..")
+    return StatPath(path);
+  const std::string dir_path = slash == 0 ? "/" : path.substr(0, slash);
+
+  Directory* dir;
+  bool checked = false;
+  auto found = directories_.find(dir_path);
+  if (found != directories_.end()) {
+    listings_.splice(listings_.begin(), listings_, found->second);
+    dir = &found->second->second;
+  } else {
+    if (dir_path != last_unlisted_) {
+      last_unlisted_ = dir_path;
+      return StatPath(path);
+    }
+    dir = Add(dir_path);
+    if (dir == nullptr)
+      return StatPath(path);
+    checked = true;
+  }
+
+  auto it = dir->entries.find(name);
+  if (!checked && (pass == 0 || dir->checked_pass != pass ||
+                   it == dir->entries.end())) {
+    total_entries_ -= dir->entries.size();
+    if (!Check(dir, dir_path)) {
+      Remove(dir_path);
+      return StatPath(path);
+    }
+    total_entries_ += dir->entries.size();
+    Trim();
+    it = dir->entries.find(name);
+  }
+  dir->checked_pass = pass;
+
+  if (dir->error != 0)
+    return dir->error;
+  if (it == dir->entries.end())
+    return dir->exact_names && IsAscii(name) ? UV_ENOENT : StatPath(path);
+  // Symbolic links and file systems that do not report types.
+  if (it->second == kUnknown)
+    return StatPath(path);
+  return it->second;
+#endif  // _WIN32
+}
+
+// Lists a directory that is not kept yet, returning nullptr if that fails.
+ModuleStatCache::Directory* ModuleStatCache::Add(const std::string& dir_path) {
+  Directory dir;
+  auto unlisted = unlisted_.find(dir_path);
+  if (unlisted != unlisted_.end())
+    dir.list_after_ns = unlisted->second;
+  if (!List(&dir, dir_path)) {
+    if (unlisted != unlisted_.end()) {
+      unlisted->second = dir.list_after_ns;
+    } else {
+      if (unlisted_.size() >= kMaxUnlistedDirectories)
+        unlisted_.clear();
+      unlisted_.emplace(dir_path, dir.list_after_ns);
+    }
+    return nullptr;
+  }
+  if (unlisted != unlisted_.end())
+    unlisted_.erase(unlisted);
+  last_unlisted_.clear();
+
+  total_entries_ += dir.entries.size();
+  listings_.emplace_front(dir_path, std::move(dir));
+  directories_.emplace(dir_path, listings_.begin());
+  Trim();
+  return &listings_.front().second;
+}
+
+// Drops a directory whose listing could not be brought up to date.
+void ModuleStatCache::Remove(const std::string& dir_path) {
+  auto found = directories_.find(dir_path);
+  const std::list<Listing>::iterator listing = found->second;
+  total_entries_ -= listing->second.entries.size();
+  if (unlisted_.size() >= kMaxUnlistedDirectories)
+    unlisted_.clear();
+  unlisted_[dir_path] = listing->second.list_after_ns;
+  directories_.erase(found);
+  listings_.erase(listing);
+}
+
+// Drops the least recently used listings until the bounds hold again. The
+// most recent one is kept even if it alone is too large.
+void ModuleStatCache::Trim() {
+  while (listings_.size() > 1 &&
+         (listings_.size() > kMaxListedDirectories ||
+          total_entries_ > kMaxTotalEntries)) {
+    total_entries_ -= listings_.back().second.entries.size();
+    directories_.erase(listings_.back().first);
+    listings_.pop_back();
+  }
+}
+
+// Returns whether the listing of dir is up to date, reading it again if not.
+bool ModuleStatCache::Check(Directory* dir, const std::string& dir_path) {
+  uv_fs_t req;
+  const int rc = uv_fs_stat(loop_, &req, dir_path.c_str(), nullptr);
+  bool unchanged;
+  if (rc == 0) {
+    const uv_stat_t* const s = static_cast<const uv_stat_t*>(req.ptr);
+    unchanged = dir->error == 0 &&
+                s->st_dev == dir->dev &&
+                s->st_ino == dir->ino &&
+                SameTime(s->st_mtim, dir->mtime) &&
+                SameTime(s->st_ctim, dir->ctime);
+  } else {
+    unchanged = rc == dir->error;
+  }
+  uv_fs_req_cleanup(&req);
+  return unchanged || List(dir, dir_path);
+}
+
+bool ModuleStatCache::List(Directory* dir, const std::string& dir_path) {
+  dir->entries.clear();
+  if (NowNs() < dir->list_after_ns)
+    return false;
+
+  // The directory is stat()ed before it is read, so that a change made while
+  // reading it shows up as a newer mtime on the next check.
+  uv_fs_t req;
+  int rc = uv_fs_stat(loop_, &req, dir_path.c_str(), nullptr);
+  if (rc == 0) {
+    const uv_stat_t* const s = static_cast<const uv_stat_t*>(req.ptr);
+    dir->dev = s->st_dev;
+    dir->ino = s->st_ino;
+    dir->mtime = s->st_mtim;
+    dir->ctime = s->st_ctim;
+    if ((s->st_mode & S_IFMT) != S_IFDIR)
+      rc = UV_ENOTDIR;
+  }
+  uv_fs_req_cleanup(&req);
+  if (rc < 0) {
+    if (!IsMissing(rc)) {
+      dir->list_after_ns = std::numeric_limits<int64_t>::max();
+      return false;
+    }
+    dir->error = rc;
+    return true;
+  }
+  dir->error = 0;
+
+  rc = uv_fs_opendir(loop_, &req, dir_path.c_str(), nullptr);
+  uv_dir_t* const handle = static_cast<uv_dir_t*>(req.ptr);
+  uv_fs_req_cleanup(&req);
+  if (rc < 0) {
+    dir->list_after_ns = std::numeric_limits<int64_t>::max();
+    return false;
+  }
+
+  uv_dirent_t dirents[kDirentBatch];
+  handle->dirents = dirents;
+  handle->nentries = kDirentBatch;
+  for (;;) {
+    rc = uv_fs_readdir(loop_, &req, handle, nullptr);
+    for (int i = 0; i < rc; i++) {
+      EntryType type = kUnknown;
+      if (dirents[i].type == UV_DIRENT_FILE)
+        type = kFile;
+      else if (dirents[i].type == UV_DIRENT_DIR)
+        type = kDirectory;
+      dir->entries.emplace(dirents[i].name, type);
+    }
+    uv_fs_req_cleanup(&req);
+    if (rc <= 0)
+      break;
+    if (dir->entries.size() > kMaxListedEntries) {
+      rc = UV_E2BIG;
+      break;
+    }
+  }
+  uv_fs_t close_req;
+  uv_fs_closedir(loop_, &close_req, handle, nullptr);
+  uv_fs_req_cleanup(&close_req);
+
+  if (rc < 0) {
+    dir->entries.clear();
+    dir->list_after_ns = std::numeric_limits<int64_t>::max();
+    return false;
+  }
+  if (NowNs() - ToNs(dir->mtime) < kRacyWindowNs) {
+    dir->entries.clear();
+    dir->list_after_ns = ToNs(dir->mtime) + kRacyWindowNs;
+    return false;
+  }
+
+  dir->exact_names = ProbeExactNames(dir, dir_path);
+  return true;
+}
+
+// Looks up an entry with the case of its letters swapped, which only exists
+// if the directory ignores case, e.g. on macOS, vfat or with ext4's casefold.
+bool ModuleStatCache::ProbeExactNames(Directory* dir,
+                                      const std::string& dir_path) {
+  for (const auto& entry : dir->entries) {
+    std::string swapped = entry.first;
+    bool has_letter = false;
+    for (char& c : swapped) {
+      if (c >= 'a' && c <= 'z') {
+        c -= 'a' - 'A';
+        has_letter = true;
+      } else if (c >= 'A' && c <= 'Z') {
+        c += 'a' - 'A';
+        has_letter = true;
+      }
+    }
+    if (!has_letter || dir->entries.count(swapped) != 0)
+      continue;
+    return StatPath(dir_path + "/" + swapped) == UV_ENOENT;
+  }
+  return false;
+}
+
+size_t ModuleStatCache::SelfSize() const {
+  size_t size = sizeof(*this) + last_unlisted_.capacity();
+  for (const Listing& listing : listings_) {
+    // The path is held by the listing and by its index in directories_.
+    size += sizeof(listing) + 2 * listing.first.capacity() +
+            sizeof(*directories_.begin());
+    for (const auto& entry : listing.second.entries)
+      size += sizeof(entry) + entry.first.capacity();
+  }
+  for (const auto& unlisted : unlisted_)
+    size += sizeof(unlisted) + unlisted.first.capacity();
+  return size;
+}
+
+}  // namespace fs
+}  // namespace node
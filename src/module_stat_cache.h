@@ -0,0 +1,104 @@
+#ifndef SRC_MODULE_STAT_CACHE_H_
+#define SRC_MODULE_STAT_CACHE_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "uv.h"
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace node {
+namespace fs {
+
+// Answers the stat() calls of module resolution from directory listings.
+//
+// Resolving a module probes many names in the same directory (`foo`, then
+// `foo.js`, `foo.json`, ...). A directory that is looked up twice in a row is
+// read once and then checked with a single stat() of the directory itself:
+// entries are added, removed and renamed only by changing its mtime. Only
+// directories that have been read are kept, and the least recently used ones
+// are dropped when there are too many of them or of their entries.
+//
+// Lookups happen in passes, one for every lifetime of the CommonJS loader's
+// own stat cache, i.e. while it runs a module that is not loaded by another
+// one. A directory that was checked in the current pass is trusted for names
+// that it contains, the same way the loader trusts its stat cache. Names that
+// are missing always cause a check, so that a file that is written and then
+// required in the same pass is found. Pass 0 is outside of any pass and checks
+// every lookup.
+class ModuleStatCache {
+ public:
+  explicit ModuleStatCache(uv_loop_t* loop) : loop_(loop) {}
+
+  ModuleStatCache(const ModuleStatCache&) = delete;
+  ModuleStatCache& operator=(const ModuleStatCache&) = delete;
+
+  // Returns 0 if path refers to a file, 1 if it is a directory, or a negative
+  // error code, like InternalModuleStat().
+  int Stat(const std::string& path, uint64_t pass);
+
+  size_t SelfSize() const;
+
+  // Larger directories are not kept in memory.
+  static constexpr size_t kMaxListedEntries = 1 << 14;
+  // Bounds on the listings kept, in directories and in entries of all of them.
+  static constexpr size_t kMaxListedDirectories = 1 << 12;
+  static constexpr size_t kMaxTotalEntries = 1 << 18;
+  // Directories that could not be listed, remembered so that they are not read
+  // again on every lookup. All are forgotten when there are more.
+  static constexpr size_t kMaxUnlistedDirectories = 1 << 10;
+  // A listing is only kept if the directory's mtime is at least this much
+  // older than the listing, so that a change in the same timestamp tick
+  // cannot go unnoticed. Two seconds covers FAT, the coarsest common case.
+  static constexpr int64_t kRacyWindowNs = 2000000000;
+
+ private:
+  enum EntryType : int8_t { kFile = 0, kDirectory = 1, kUnknown = -1 };
+
+  struct Directory {
+    std::unordered_map<std::string, EntryType> entries;
+    // 0 if the directory exists, else the error that paths in it fail with.
+    int error = 0;
+    // Whether a missing name means that the path does not exist: the
+    // directory compares names byte by byte and the name is ASCII.
+    bool exact_names = false;
+    uint64_t checked_pass = 0;
+    // Not listed again before this time, when the last attempt was racy.
+    int64_t list_after_ns = 0;
+    uint64_t dev = 0;
+    uint64_t ino = 0;
+    uv_timespec_t mtime = {0, 0};
+    uv_timespec_t ctime = {0, 0};
+  };
+
+  using Listing = std::pair<std::string, Directory>;
+
+  int StatPath(const std::string& path);
+  Directory* Add(const std::string& dir_path);
+  void Remove(const std::string& dir_path);
+  void Trim();
+  bool Check(Directory* dir, const std::string& dir_path);
+  bool List(Directory* dir, const std::string& dir_path);
+  bool ProbeExactNames(Directory* dir, const std::string& dir_path);
+
+  uv_loop_t* const loop_;
+  // Most recently used first.
+  std::list<Listing> listings_;
+  std::unordered_map<std::string, std::list<Listing>::iterator> directories_;
+  size_t total_entries_ = 0;
+  // The last directory that was looked up without being listed.
+  std::string last_unlisted_;
+  // The list_after_ns of directories whose listing failed.
+  std::unordered_map<std::string, int64_t> unlisted_;
+};
+
+}  // namespace fs
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_MODULE_STAT_CACHE_H_
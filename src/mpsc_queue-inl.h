@@ -0,0 +1,72 @@
+#ifndef SRC_MPSC_QUEUE_INL_H_
+#define SRC_MPSC_QUEUE_INL_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "mpsc_queue.h"
+
+#include <utility>
+
+namespace node {
+
+template <typename T>
+MPSCQueue<T>::MPSCQueue() : head_(new Node()), tail_(head_.load()) {}
+
+template <typename T>
+MPSCQueue<T>::~MPSCQueue() {
+  Node* node = tail_;
+  while (node != nullptr) {
+    Node* next = node->next.load(std::memory_order_acquire);
+    delete node;
+    node = next;
+  }
+}
+
+template <typename T>
+void MPSCQueue<T>::Push(T value) {
+  Node* node = new Node(std::move(value));
+  // Counted first, so that size() never drops below the number of values
+  // that can be popped.
+  size_.fetch_add(1, std::memory_order_relaxed);
+  Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+  // Until this store, the consumer cannot get past `prev`.
+  prev->next.store(node, std::memory_order_release);
+}
+
+template <typename T>
+bool MPSCQueue<T>::Pop(T* value) {
+  Node* next = tail_->next.load(std::memory_order_acquire);
+  if (next == nullptr) return false;
+  *value = std::move(next->value);
+  delete tail_;
+  tail_ = next;
+  size_.fetch_sub(1, std::memory_order_relaxed);
+  return true;
+}
+
+template <typename T>
+T* MPSCQueue<T>::Peek() {
+  Node* next = tail_->next.load(std::memory_order_acquire);
+  return next != nullptr ? &next->value : nullptr;
+}
+
+template <typename T>
+template <typename Fn>
+void MPSCQueue<T>::ForEach(Fn&& fn) const {
+  for (Node* node = tail_->next.load(std::memory_order_acquire);
+       node != nullptr;
+       node = node->next.load(std::memory_order_acquire)) {
+    fn(node->value);
+  }
+}
+
+template <typename T>
+size_t MPSCQueue<T>::size() const {
+  return size_.load(std::memory_order_relaxed);
+}
+
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_MPSC_QUEUE_INL_H_
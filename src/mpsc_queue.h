@@ -0,0 +1,67 @@
+#ifndef SRC_MPSC_QUEUE_H_
+#define SRC_MPSC_QUEUE_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include <atomic>
+#include <cstddef>
+
+namespace node {
+
+// An unbounded multi-producer, single-consumer queue that does not lock.
+// Push() may be called from any thread, all other methods only from the
+// consumer thread. The consumer may change, but only with a happens-before
+// relationship between the old and the new one, e.g. through a mutex or
+// another queue.
+//
+// Pushing takes a single atomic exchange, so producers never wait for each
+// other or for the consumer. The price is that a value becomes visible only
+// once the Push() that precedes it has finished as well: Pop() may find the
+// queue empty while a producer is between the two steps of Push(). Producers
+// that need the consumer to see their value therefore notify it after Push()
+// returns.
+template <typename T>
+class MPSCQueue {
+ public:
+  inline MPSCQueue();
+  inline ~MPSCQueue();
+
+  MPSCQueue(const MPSCQueue&) = delete;
+  MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+  inline void Push(T value);
+  // Returns false if no value is available.
+  inline bool Pop(T* value);
+  // Returns the value that Pop() would return next, or nullptr.
+  inline T* Peek();
+  // Calls fn with every value that is available, in order.
+  template <typename Fn>
+  inline void ForEach(Fn&& fn) const;
+
+  // The number of values that were pushed and not popped yet. May be called
+  // from any thread, and includes values that are not available yet.
+  inline size_t size() const;
+
+ private:
+  struct Node {
+    Node() = default;
+    explicit Node(T&& value) : value(std::move(value)) {}
+
+    std::atomic<Node*> next {nullptr};
+    T value;
+  };
+
+  // The node that was pushed last. Producers swap themselves in here.
+  std::atomic<Node*> head_;
+  std::atomic<size_t> size_ {0};
+  // A node whose value has been popped already (or the initial empty node);
+  // its successor holds the next value. Kept apart from head_ so that pushes
+  // and pops do not contend for the same cache line.
+  alignas(64) Node* tail_;
+};
+
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_MPSC_QUEUE_H_
@@ -35,6 +35,7 @@
 
 #include <cstring>
 #include <climits>
+#include <vector>
 
 #define THROW_AND_RETURN_UNLESS_BUFFER(env, obj)                            \
   THROW_AND_RETURN_IF_NOT_BUFFER(env, obj, "argument")                      \
@@ -49,6 +50,7 @@
 namespace node {
 namespace Buffer {
 
+using v8::Array;
 using v8::ArrayBuffer;
 using v8::ArrayBufferView;
 using v8::BackingStore;
@@ -732,8 +734,9 @@ void ByteLengthUtf8(const FunctionCallbackInfo<Value> &args) {
   Environment* env = Environment::GetCurrent(args);
   CHECK(args[0]->IsString());
 
-  // Fast case: avoid StringBytes on UTF8 string. Jump to v8.
-  args.GetReturnValue().Set(args[0].As<String>()->Utf8Length(env->isolate()));
+  // Fast case: skip the type checks and conversions of StringBytes::Size.
+  args.GetReturnValue().Set(static_cast<double>(
+      StringBytes::Utf8Length(env->isolate(), args[0].As<String>())));
 }
 
 // Normalize val to be an integer in the range of [1, -1] since
@@ -1072,6 +1075,47 @@ void IndexOfNumber(const FunctionCallbackInfo<Value>& args) {
                                 : -1);
 }
 
+void IndexOfAny(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args[1]->IsArray());
+  CHECK(args[2]->IsNumber());
+
+  THROW_AND_RETURN_UNLESS_BUFFER(env, args[0]);
+  ArrayBufferViewContents<uint8_t> haystack(args[0]);
+  Local<Array> values = args[1].As<Array>();
+  int64_t offset_i64 = args[2].As<Integer>()->Value();
+
+  // Read in place, as the contents may point into their own storage.
+  const size_t count = values->Length();
+  std::vector<ArrayBufferViewContents<uint8_t>> contents(count);
+  std::vector<stringsearch::Needle> needles(count);
+  for (size_t i = 0; i < count; i++) {
+    Local<Value> value;
+    if (!values->Get(env->context(), i).ToLocal(&value))
+      return;
+    CHECK(value->IsArrayBufferView());
+    contents[i].Read(value.As<ArrayBufferView>());
+    needles[i] = {contents[i].data(), contents[i].length()};
+  }
+
+  int64_t opt_offset = IndexOfOffset(haystack.length(), offset_i64, 0, true);
+  if (count == 0 || opt_offset <= -1) {
+    return args.GetReturnValue().Set(-1);
+  }
+
+  size_t which = count;
+  size_t result = stringsearch::FindAnyBytes(haystack.data(),
+                                             haystack.length(),
+                                             needles.data(),
+                                             count,
+                                             static_cast<size_t>(opt_offset),
+                                             &which);
+  // An empty value matches even at the end of the buffer, like indexOf('').
+  if (which == count)
+    return args.GetReturnValue().Set(-1);
+  args.GetReturnValue().Set(static_cast<double>(result));
+}
+
 
 void Swap16(const FunctionCallbackInfo<Value>& args) {
   Environment* env = Environment::GetCurrent(args);
@@ -1109,7 +1153,7 @@ static void EncodeUtf8String(const FunctionCallbackInfo<Value>& args) {
   CHECK(args[0]->IsString());
 
   Local<String> str = args[0].As<String>();
-  size_t length = str->Utf8Length(isolate);
+  size_t length = StringBytes::Utf8Length(isolate, str);
 
   Local<ArrayBuffer> ab;
   {
@@ -1119,11 +1163,11 @@ static void EncodeUtf8String(const FunctionCallbackInfo<Value>& args) {
 
     CHECK(bs);
 
-    str->WriteUtf8(isolate,
-                   static_cast<char*>(bs->Data()),
-                   -1,  // We are certain that `data` is sufficiently large
-                   nullptr,
-                   String::NO_NULL_TERMINATION | String::REPLACE_INVALID_UTF8);
+    StringBytes::Write(isolate,
+                       static_cast<char*>(bs->Data()),
+                       length,
+                       str,
+                       UTF8);
 
     ab = ArrayBuffer::New(isolate, std::move(bs));
   }
@@ -1156,12 +1200,12 @@ static void EncodeInto(const FunctionCallbackInfo<Value>& args) {
       result_arr->ByteOffset());
 
   int nchars;
-  int written = source->WriteUtf8(
-      isolate,
-      write_result,
-      dest_length,
-      &nchars,
-      String::NO_NULL_TERMINATION | String::REPLACE_INVALID_UTF8);
+  size_t written = StringBytes::Write(isolate,
+                                      write_result,
+                                      dest_length,
+                                      source,
+                                      UTF8,
+                                      &nchars);
   results[0] = nchars;
   results[1] = written;
 }
@@ -1272,6 +1316,7 @@ void Initialize(Local<Object> target,
   env->SetMethodNoSideEffect(target, "compare", Compare);
   env->SetMethodNoSideEffect(target, "compareOffset", CompareOffset);
   env->SetMethod(target, "fill", Fill);
+  env->SetMethodNoSideEffect(target, "indexOfAny", IndexOfAny);
   env->SetMethodNoSideEffect(target, "indexOfBuffer", IndexOfBuffer);
   env->SetMethodNoSideEffect(target, "indexOfNumber", IndexOfNumber);
   env->SetMethodNoSideEffect(target, "indexOfString", IndexOfString);
@@ -1324,6 +1369,7 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(Compare);
   registry->Register(CompareOffset);
   registry->Register(Fill);
+  registry->Register(IndexOfAny);
   registry->Register(IndexOfBuffer);
   registry->Register(IndexOfNumber);
   registry->Register(IndexOfString);
@@ -3,6 +3,7 @@
 #include "async_wrap-inl.h"
 #include "debug_utils-inl.h"
 #include "memory_tracker-inl.h"
+#include "mpsc_queue-inl.h"
 #include "node_buffer.h"
 #include "node_contextify.h"
 #include "node_errors.h"
@@ -14,6 +15,7 @@ using node::contextify::ContextifyContext;
 using node::errors::TryCatchScope;
 using v8::Array;
 using v8::ArrayBuffer;
+using v8::ArrayBufferView;
 using v8::BackingStore;
 using v8::CompiledWasmModule;
 using v8::Context;
@@ -33,6 +35,7 @@ using v8::Object;
 using v8::SharedArrayBuffer;
 using v8::String;
 using v8::Symbol;
+using v8::TypedArray;
 using v8::Value;
 using v8::ValueDeserializer;
 using v8::ValueSerializer;
@@ -74,7 +77,8 @@ Message::Message(MallocedBuffer<char>&& buffer)
     : main_message_buf_(std::move(buffer)) {}
 
 bool Message::IsCloseMessage() const {
-  return main_message_buf_.data == nullptr;
+  return main_message_buf_.data == nullptr &&
+         array_buffer_type_ == ArrayBufferMessageType::kNone;
 }
 
 namespace {
@@ -127,10 +131,14 @@ class DeserializerDelegate : public ValueDeserializer::Delegate {
 
 MaybeLocal<Value> Message::Deserialize(Environment* env,
                                        Local<Context> context,
-                                       Local<Value>* port_list) {
+                                       Local<Value>* port_list,
+                                       bool exclusive) {
   Context::Scope context_scope(context);
 
   CHECK(!IsCloseMessage());
+  if (array_buffer_type_ != ArrayBufferMessageType::kNone)
+    return DeserializeArrayBuffer(env, exclusive);
+
   if (port_list != nullptr && !transferables_.empty()) {
     // Need to create this outside of the EscapableHandleScope, but inside
     // the Context::Scope.
@@ -225,6 +233,41 @@ void Message::AddTransferable(std::unique_ptr<TransferData>&& data) {
   transferables_.emplace_back(std::move(data));
 }
 
+MaybeLocal<Value> Message::DeserializeArrayBuffer(Environment* env,
+                                                  bool exclusive) {
+  std::shared_ptr<BackingStore> contents;
+  if (exclusive) {
+    contents = std::move(array_buffer_contents_);
+  } else {
+    // Other threads receive the same message from a BroadcastChannel.
+    {
+      NoArrayBufferZeroFillScope no_zero_fill_scope(env->isolate_data());
+      contents = ArrayBuffer::NewBackingStore(
+          env->isolate(), array_buffer_contents_->ByteLength());
+    }
+    memcpy(contents->Data(),
+           array_buffer_contents_->Data(),
+           array_buffer_contents_->ByteLength());
+  }
+  Local<ArrayBuffer> buffer =
+      ArrayBuffer::New(env->isolate(), std::move(contents));
+
+  switch (array_buffer_type_) {
+    case ArrayBufferMessageType::kArrayBuffer:
+      return buffer;
+#define V(Type)                                                               \
+    case ArrayBufferMessageType::k##Type:                                     \
+      return v8::Type::New(buffer,                                            \
+                           array_buffer_view_offset_,                         \
+                           array_buffer_view_length_);
+    ARRAY_BUFFER_VIEW_MESSAGE_TYPES(V)
+#undef V
+    case ArrayBufferMessageType::kNone:
+      break;
+  }
+  UNREACHABLE();
+}
+
 uint32_t Message::AddWASMModule(CompiledWasmModule&& mod) {
   wasm_modules_.emplace_back(std::move(mod));
   return wasm_modules_.size() - 1;
@@ -413,6 +456,10 @@ Maybe<bool> Message::Serialize(Environment* env,
 
   // Verify that we're not silently overwriting an existing message.
   CHECK(main_message_buf_.is_empty());
+  CHECK_EQ(array_buffer_type_, ArrayBufferMessageType::kNone);
+
+  if (transfer_list_v.length() == 0 && SerializeArrayBuffer(env, input))
+    return Just(true);
 
   SerializerDelegate delegate(env, context, this);
   ValueSerializer serializer(env->isolate(), &delegate);
@@ -532,7 +579,55 @@ Maybe<bool> Message::Serialize(Environment* env,
   return Just(true);
 }
 
+bool Message::SerializeArrayBuffer(Environment* env, Local<Value> input) {
+  if (!input->IsArrayBuffer() && !input->IsArrayBufferView())
+    return false;
+
+  Local<ArrayBuffer> buffer;
+  ArrayBufferMessageType type = ArrayBufferMessageType::kNone;
+  size_t offset = 0;
+  size_t length = 0;
+  if (input->IsArrayBuffer()) {
+    buffer = input.As<ArrayBuffer>();
+    type = ArrayBufferMessageType::kArrayBuffer;
+  } else {
+#define V(Type)                                                               \
+    if (type == ArrayBufferMessageType::kNone && input->Is##Type())           \
+      type = ArrayBufferMessageType::k##Type;
+    ARRAY_BUFFER_VIEW_MESSAGE_TYPES(V)
+#undef V
+    if (type == ArrayBufferMessageType::kNone) return false;
+
+    Local<ArrayBufferView> view = input.As<ArrayBufferView>();
+    buffer = view->Buffer();
+    offset = view->ByteOffset();
+    length = input->IsTypedArray() ? input.As<TypedArray>()->Length()
+                                   : view->ByteLength();
+  }
+
+  // Detached buffers, which cannot be cloned, and SharedArrayBuffers, which
+  // are not copied, are left to the ValueSerializer.
+  std::shared_ptr<BackingStore> source = buffer->GetBackingStore();
+  if (source->ByteLength() == 0 || source->IsShared())
+    return false;
+
+  std::unique_ptr<BackingStore> contents;
+  {
+    NoArrayBufferZeroFillScope no_zero_fill_scope(env->isolate_data());
+    contents = ArrayBuffer::NewBackingStore(env->isolate(),
+                                            source->ByteLength());
+  }
+  memcpy(contents->Data(), source->Data(), source->ByteLength());
+
+  array_buffer_contents_ = std::move(contents);
+  array_buffer_type_ = type;
+  array_buffer_view_offset_ = offset;
+  array_buffer_view_length_ = length;
+  return true;
+}
+
 void Message::MemoryInfo(MemoryTracker* tracker) const {
+  tracker->TrackField("array_buffer_contents", array_buffer_contents_);
   tracker->TrackField("array_buffers_", array_buffers_);
   tracker->TrackField("shared_array_buffers", shared_array_buffers_);
   tracker->TrackField("transferables", transferables_);
@@ -548,15 +643,23 @@ MessagePortData::~MessagePortData() {
 }
 
 void MessagePortData::MemoryInfo(MemoryTracker* tracker) const {
-  Mutex::ScopedLock lock(mutex_);
-  tracker->TrackField("incoming_messages", incoming_messages_);
+  // This runs on the thread that reads the queue, so the messages in it
+  // stay alive.
+  incoming_messages_.ForEach([&](const std::shared_ptr<Message>& message) {
+    tracker->TrackField("incoming_message", message);
+  });
 }
 
 void MessagePortData::AddToIncomingQueue(std::shared_ptr<Message> message) {
   // This function will be called by other threads.
-  Mutex::ScopedLock lock(mutex_);
-  incoming_messages_.emplace_back(std::move(message));
+  incoming_messages_.Push(std::move(message));
 
+  // The owner clears the flag before it reads the queue, so it is going to
+  // see this message unless this call wakes it up.
+  if (wakeup_pending_.exchange(true, std::memory_order_acq_rel))
+    return;
+
+  Mutex::ScopedLock lock(mutex_);
   if (owner_ != nullptr) {
     Debug(owner_, "Adding message to incoming queue");
     owner_->TriggerAsync();
@@ -692,8 +795,9 @@ MaybeLocal<Value> MessagePort::ReceiveMessage(Local<Context> context,
                                               Local<Value>* port_list) {
   std::shared_ptr<Message> received;
   {
-    // Get the head of the message queue.
-    Mutex::ScopedLock lock(data_->mutex_);
+    // Get the head of the message queue. This is the only thread that takes
+    // messages out of it, so no lock is needed.
+    std::shared_ptr<Message>* front = data_->incoming_messages_.Peek();
 
     Debug(this, "MessagePort has message");
 
@@ -704,14 +808,12 @@ MaybeLocal<Value> MessagePort::ReceiveMessage(Local<Context> context,
     // - There are no pending messages
     // - We are not intending to receive messages, and the message we would
     //   receive is not the final "close" message.
-    if (data_->incoming_messages_.empty() ||
-        (!wants_message &&
-         !data_->incoming_messages_.front()->IsCloseMessage())) {
+    if (front == nullptr ||
+        (!wants_message && !(*front)->IsCloseMessage())) {
       return env()->no_message_symbol();
     }
 
-    received = data_->incoming_messages_.front();
-    data_->incoming_messages_.pop_front();
+    CHECK(data_->incoming_messages_.Pop(&received));
   }
 
   if (received->IsCloseMessage()) {
@@ -721,7 +823,13 @@ MaybeLocal<Value> MessagePort::ReceiveMessage(Local<Context> context,
 
   if (!env()->can_call_into_js()) return MaybeLocal<Value>();
 
-  return received->Deserialize(env(), context, port_list);
+  // Once the sender and all other receivers let go of the message, none of
+  // them can access it anymore, and its contents do not need to be copied.
+  // The fence orders their reads before the moves done by Deserialize().
+  bool exclusive = received.use_count() == 1;
+  if (exclusive) std::atomic_thread_fence(std::memory_order_acquire);
+
+  return received->Deserialize(env(), context, port_list, exclusive);
 }
 
 void MessagePort::OnMessage(MessageProcessingMode mode) {
@@ -730,10 +838,15 @@ void MessagePort::OnMessage(MessageProcessingMode mode) {
   Local<Context> context =
       object(env()->isolate())->GetCreationContext().ToLocalChecked();
 
+  // Messages that are added from now on need to wake this port up again.
+  // Taking the flag also makes the messages of those producers that did not
+  // wake up this port visible to it.
+  if (data_)
+    data_->wakeup_pending_.exchange(false, std::memory_order_acq_rel);
+
   size_t processing_limit;
   if (mode == MessageProcessingMode::kNormalOperation) {
-    Mutex::ScopedLock(data_->mutex_);
-    processing_limit = std::max(data_->incoming_messages_.size(),
+    processing_limit = std::max(data_ ? data_->incoming_messages_.size() : 0,
                                 static_cast<size_t>(1000));
   } else {
     processing_limit = std::numeric_limits<size_t>::max();
@@ -994,8 +1107,7 @@ void MessagePort::PostMessage(const FunctionCallbackInfo<Value>& args) {
 void MessagePort::Start() {
   Debug(this, "Start receiving messages");
   receiving_messages_ = true;
-  Mutex::ScopedLock lock(data_->mutex_);
-  if (!data_->incoming_messages_.empty())
+  if (data_->incoming_messages_.Peek() != nullptr)
     TriggerAsync();
 }
 
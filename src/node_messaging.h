@@ -4,9 +4,10 @@
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
 #include "env.h"
+#include "mpsc_queue.h"
 #include "node_mutex.h"
 #include "v8.h"
-#include <deque>
+#include <atomic>
 #include <string>
 #include <unordered_map>
 #include <set>
@@ -62,10 +63,13 @@ class Message : public MemoryRetainer {
 
   // Deserialize the contained JS value. May only be called once, and only
   // after Serialize() has been called (e.g. by another thread).
+  // If `exclusive` is true, no other thread can deserialize this message and
+  // the contents of an ArrayBuffer message are moved rather than copied.
   v8::MaybeLocal<v8::Value> Deserialize(
       Environment* env,
       v8::Local<v8::Context> context,
-      v8::Local<v8::Value>* port_list = nullptr);
+      v8::Local<v8::Value>* port_list = nullptr,
+      bool exclusive = false);
 
   // Serialize a JS value, and optionally transfer objects, into this message.
   // The Message object retains ownership of all transferred objects until
@@ -106,6 +110,35 @@ class Message : public MemoryRetainer {
   SET_SELF_SIZE(Message)
 
  private:
+#define ARRAY_BUFFER_VIEW_MESSAGE_TYPES(V)                                    \
+  V(Uint8Array)                                                               \
+  V(Uint8ClampedArray)                                                        \
+  V(Int8Array)                                                                \
+  V(Uint16Array)                                                              \
+  V(Int16Array)                                                               \
+  V(Uint32Array)                                                              \
+  V(Int32Array)                                                               \
+  V(Float32Array)                                                             \
+  V(Float64Array)                                                             \
+  V(BigInt64Array)                                                            \
+  V(BigUint64Array)                                                           \
+  V(DataView)
+
+  enum class ArrayBufferMessageType : uint8_t {
+    kNone,
+    kArrayBuffer,
+#define V(Type) k##Type,
+    ARRAY_BUFFER_VIEW_MESSAGE_TYPES(V)
+#undef V
+  };
+
+  // Serializes messages that consist of a single ArrayBuffer or view on one
+  // by copying the buffer, without going through v8::ValueSerializer.
+  // Returns false if the input needs to be serialized the regular way.
+  bool SerializeArrayBuffer(Environment* env, v8::Local<v8::Value> input);
+  v8::MaybeLocal<v8::Value> DeserializeArrayBuffer(Environment* env,
+                                                   bool exclusive);
+
   MallocedBuffer<char> main_message_buf_;
   // TODO(addaleax): Make this a std::variant to save storage size in the common
   // case (which is that all of these vectors are empty) once that is available
@@ -114,6 +147,12 @@ class Message : public MemoryRetainer {
   std::vector<std::shared_ptr<v8::BackingStore>> shared_array_buffers_;
   std::vector<std::unique_ptr<TransferData>> transferables_;
   std::vector<v8::CompiledWasmModule> wasm_modules_;
+  // Used instead of main_message_buf_ by SerializeArrayBuffer(). This is a
+  // copy of the whole buffer, like structured cloning makes of it.
+  std::shared_ptr<v8::BackingStore> array_buffer_contents_;
+  ArrayBufferMessageType array_buffer_type_ = ArrayBufferMessageType::kNone;
+  size_t array_buffer_view_offset_ = 0;
+  size_t array_buffer_view_length_ = 0;
 
   friend class MessagePort;
 };
@@ -202,13 +241,17 @@ class MessagePortData : public TransferData {
   SET_SELF_SIZE(MessagePortData)
 
  private:
-  // This mutex protects all fields below it, with the exception of
-  // sibling_.
+  // This mutex protects owner_, and makes sure that the owner's handle is not
+  // closed while another thread calls TriggerAsync() on it.
   mutable Mutex mutex_;
+  // Any thread may add messages, only the owner's thread takes them out.
   // TODO(addaleax): Make this a std::variant<std::shared_ptr, std::unique_ptr>
   // once that is available with C++17, because std::shared_ptr comes with
   // overhead that is only necessary for BroadcastChannel.
-  std::deque<std::shared_ptr<Message>> incoming_messages_;
+  MPSCQueue<std::shared_ptr<Message>> incoming_messages_;
+  // Set by the first message that is added after the owner started to read
+  // the queue, which is the only one that needs to wake it up.
+  std::atomic<bool> wakeup_pending_ {false};
   MessagePort* owner_ = nullptr;
   std::shared_ptr<SiblingGroup> group_;
   friend class MessagePort;
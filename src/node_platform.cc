@@ -6,6 +6,7 @@
 #include <algorithm>  // find_if(), find(), move()
 #include <cmath>  // llround()
 #include <memory>  // unique_ptr(), shared_ptr(), make_shared()
+#include <thread>  // this_thread::yield()
 
 namespace node {
 
@@ -17,7 +18,7 @@ using v8::Task;
 namespace {
 
 struct PlatformWorkerData {
-  TaskQueue<Task>* task_queue;
+  WorkerTaskQueue* task_queue;
   Mutex* platform_workers_mutex;
   ConditionVariable* platform_workers_ready;
   int* pending_platform_workers;
@@ -28,7 +29,7 @@ static void PlatformWorkerThread(void* data) {
   std::unique_ptr<PlatformWorkerData>
       worker_data(static_cast<PlatformWorkerData*>(data));
 
-  TaskQueue<Task>* pending_worker_tasks = worker_data->task_queue;
+  WorkerTaskQueue* pending_worker_tasks = worker_data->task_queue;
   TRACE_EVENT_METADATA1("__metadata", "thread_name", "name",
                         "PlatformWorkerThread");
 
@@ -39,7 +40,8 @@ static void PlatformWorkerThread(void* data) {
     worker_data->platform_workers_ready->Signal(lock);
   }
 
-  while (std::unique_ptr<Task> task = pending_worker_tasks->BlockingPop()) {
+  int id = worker_data->id;
+  while (std::unique_ptr<Task> task = pending_worker_tasks->BlockingPop(id)) {
     task->Run();
     pending_worker_tasks->NotifyOfCompletion();
   }
@@ -49,7 +51,7 @@ static void PlatformWorkerThread(void* data) {
 
 class WorkerThreadsTaskRunner::DelayedTaskScheduler {
  public:
-  explicit DelayedTaskScheduler(TaskQueue<Task>* tasks)
+  explicit DelayedTaskScheduler(WorkerTaskQueue* tasks)
     : pending_worker_tasks_(tasks) {}
 
   std::unique_ptr<uv_thread_t> Start() {
@@ -155,7 +157,7 @@ class WorkerThreadsTaskRunner::DelayedTaskScheduler {
   }
 
   uv_sem_t ready_;
-  TaskQueue<Task>* pending_worker_tasks_;
+  WorkerTaskQueue* pending_worker_tasks_;
 
   TaskQueue<Task> tasks_;
   uv_loop_t loop_;
@@ -163,7 +165,8 @@ class WorkerThreadsTaskRunner::DelayedTaskScheduler {
   std::unordered_set<uv_timer_t*> timers_;
 };
 
-WorkerThreadsTaskRunner::WorkerThreadsTaskRunner(int thread_pool_size) {
+WorkerThreadsTaskRunner::WorkerThreadsTaskRunner(int thread_pool_size)
+    : pending_worker_tasks_(thread_pool_size) {
   Mutex platform_workers_mutex;
   ConditionVariable platform_workers_ready;
 
@@ -194,6 +197,9 @@ WorkerThreadsTaskRunner::WorkerThreadsTaskRunner(int thread_pool_size) {
   }
 }
 
+// Out of line so that DelayedTaskScheduler is a complete type here.
+WorkerThreadsTaskRunner::~WorkerThreadsTaskRunner() = default;
+
 void WorkerThreadsTaskRunner::PostTask(std::unique_ptr<Task> task) {
   pending_worker_tasks_.Push(std::move(task));
 }
@@ -628,4 +634,200 @@ std::queue<std::unique_ptr<T>> TaskQueue<T>::PopAll() {
   return result;
 }
 
+namespace {
+
+// The worker, if any, that the current thread runs for. Tasks it posts go to
+// its own deque instead of the injection queue.
+thread_local WorkerTaskQueue* current_task_queue = nullptr;
+thread_local int current_worker_id = -1;
+
+// How many tasks a worker moves from the injection queue to its own deque in
+// one go, so that the others can steal them without taking the lock.
+constexpr size_t kInjectedBatch = 32;
+// Owners pop their deque LIFO; every so often they look at the injection queue
+// first so that a task that keeps reposting itself cannot starve it.
+constexpr unsigned kInjectedCheckInterval = 61;
+
+}  // namespace
+
+// Fixed size Chase-Lev deque, see "Correct and Efficient Work-Stealing for
+// Weak Memory Models" (Lê et al., 2013). Push and Pop are for the owner only,
+// Steal may be called from any thread. A full deque rejects the push and the
+// task goes to the injection queue instead, which keeps the buffer from ever
+// having to be reallocated under a concurrent thief.
+class alignas(64) WorkerTaskQueue::Deque {
+ public:
+  Deque() : top_(0), bottom_(0) {
+    for (std::atomic<Task*>& slot : buffer_)
+      slot.store(nullptr, std::memory_order_relaxed);
+  }
+
+  bool Push(Task* task) {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    int64_t top = top_.load(std::memory_order_acquire);
+    if (bottom - top >= kCapacity) return false;
+    buffer_[bottom & kMask].store(task, std::memory_order_relaxed);
+    bottom_.store(bottom + 1, std::memory_order_release);
+    return true;
+  }
+
+  Task* Pop() {
+    // The store to bottom_ has to be visible before top_ is read, the
+    // sequentially consistent pair stands in for the paper's fence.
+    int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    bottom_.store(bottom, std::memory_order_seq_cst);
+    int64_t top = top_.load(std::memory_order_seq_cst);
+    if (top > bottom) {
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    Task* task = buffer_[bottom & kMask].load(std::memory_order_relaxed);
+    if (top == bottom) {
+      // Last one, race the thieves for it.
+      if (!top_.compare_exchange_strong(top, top + 1,
+                                        std::memory_order_seq_cst,
+                                        std::memory_order_relaxed)) {
+        task = nullptr;
+      }
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return task;
+  }
+
+  Task* Steal() {
+    int64_t top = top_.load(std::memory_order_seq_cst);
+    int64_t bottom = bottom_.load(std::memory_order_seq_cst);
+    if (top >= bottom) return nullptr;
+    Task* task = buffer_[top & kMask].load(std::memory_order_relaxed);
+    if (!top_.compare_exchange_strong(top, top + 1,
+                                      std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return task;
+  }
+
+  // Counts the owner's pops, for the periodic injection queue check.
+  unsigned NextPop() { return ++pops_; }
+
+ private:
+  static constexpr int64_t kCapacity = 512;
+  static constexpr int64_t kMask = kCapacity - 1;
+
+  std::atomic<int64_t> top_;
+  alignas(64) std::atomic<int64_t> bottom_;
+  unsigned pops_ = 0;
+  std::atomic<Task*> buffer_[kCapacity];
+};
+
+WorkerTaskQueue::WorkerTaskQueue(int worker_count)
+    : injected_size_(0), queued_tasks_(0), parked_workers_(0),
+      stopped_(false), outstanding_tasks_(0) {
+  for (int i = 0; i < worker_count; i++)
+    deques_.emplace_back(new Deque());
+}
+
+WorkerTaskQueue::~WorkerTaskQueue() {
+  // Like TaskQueue, tasks that never ran are deleted without running them.
+  for (const std::unique_ptr<Deque>& deque : deques_) {
+    while (Task* task = deque->Steal())
+      delete task;
+  }
+  for (Task* task : injected_)
+    delete task;
+}
+
+void WorkerTaskQueue::Push(std::unique_ptr<Task> task) {
+  outstanding_tasks_.fetch_add(1, std::memory_order_relaxed);
+  Task* raw = task.release();
+  if (current_task_queue != this ||
+      !deques_[current_worker_id]->Push(raw)) {
+    Mutex::ScopedLock scoped_lock(injected_lock_);
+    injected_.push_back(raw);
+    injected_size_.store(injected_.size(), std::memory_order_relaxed);
+  }
+  queued_tasks_.fetch_add(1, std::memory_order_seq_cst);
+  WakeWorker();
+}
+
+void WorkerTaskQueue::WakeWorker() {
+  // Pairs with the parked_workers_ increment in BlockingPop: either the
+  // worker sees the new task before waiting, or we see it parked here.
+  if (parked_workers_.load(std::memory_order_seq_cst) == 0) return;
+  Mutex::ScopedLock scoped_lock(park_lock_);
+  tasks_available_.Signal(scoped_lock);
+}
+
+Task* WorkerTaskQueue::PopInjected(Deque* local) {
+  if (injected_size_.load(std::memory_order_relaxed) == 0) return nullptr;
+  Mutex::ScopedLock scoped_lock(injected_lock_);
+  if (injected_.empty()) return nullptr;
+  Task* task = injected_.front();
+  injected_.pop_front();
+  // Take a share of the rest along, spreading it over the workers.
+  size_t batch = std::min(kInjectedBatch, injected_.size() / deques_.size());
+  while (batch-- > 0 && local->Push(injected_.front()))
+    injected_.pop_front();
+  injected_size_.store(injected_.size(), std::memory_order_relaxed);
+  return task;
+}
+
+Task* WorkerTaskQueue::FindTask(int worker_id) {
+  Deque* local = deques_[worker_id].get();
+  Task* task = nullptr;
+  if (local->NextPop() % kInjectedCheckInterval == 0)
+    task = PopInjected(local);
+  if (task == nullptr)
+    task = local->Pop();
+  if (task == nullptr)
+    task = PopInjected(local);
+  for (size_t i = 1; task == nullptr && i < deques_.size(); i++)
+    task = deques_[(worker_id + i) % deques_.size()]->Steal();
+  return task;
+}
+
+std::unique_ptr<Task> WorkerTaskQueue::BlockingPop(int worker_id) {
+  current_task_queue = this;
+  current_worker_id = worker_id;
+  while (!stopped_.load(std::memory_order_acquire)) {
+    if (Task* task = FindTask(worker_id)) {
+      queued_tasks_.fetch_sub(1, std::memory_order_relaxed);
+      return std::unique_ptr<Task>(task);
+    }
+    if (queued_tasks_.load(std::memory_order_seq_cst) > 0) {
+      // Lost a race with a thief or the owner, the task is still around.
+      std::this_thread::yield();
+      continue;
+    }
+    Mutex::ScopedLock scoped_lock(park_lock_);
+    parked_workers_.fetch_add(1, std::memory_order_seq_cst);
+    while (queued_tasks_.load(std::memory_order_seq_cst) == 0 &&
+           !stopped_.load(std::memory_order_acquire)) {
+      tasks_available_.Wait(scoped_lock);
+    }
+    parked_workers_.fetch_sub(1, std::memory_order_relaxed);
+  }
+  return std::unique_ptr<Task>(nullptr);
+}
+
+void WorkerTaskQueue::NotifyOfCompletion() {
+  if (outstanding_tasks_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    Mutex::ScopedLock scoped_lock(drain_lock_);
+    tasks_drained_.Broadcast(scoped_lock);
+  }
+}
+
+void WorkerTaskQueue::BlockingDrain() {
+  Mutex::ScopedLock scoped_lock(drain_lock_);
+  while (outstanding_tasks_.load(std::memory_order_acquire) > 0) {
+    tasks_drained_.Wait(scoped_lock);
+  }
+}
+
+void WorkerTaskQueue::Stop() {
+  Mutex::ScopedLock scoped_lock(park_lock_);
+  stopped_.store(true, std::memory_order_release);
+  tasks_available_.Broadcast(scoped_lock);
+}
+
 }  // namespace node
@@ -3,6 +3,8 @@
 
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
+#include <atomic>
+#include <deque>
 #include <queue>
 #include <unordered_map>
 #include <vector>
@@ -42,6 +44,48 @@ class TaskQueue {
   std::queue<std::unique_ptr<T>> task_queue_;
 };
 
+// Feeds the platform workers without funnelling every task through one lock.
+// Each worker owns a Chase-Lev deque that only it pushes to and pops from,
+// tasks posted by other threads go into a shared injection queue, and idle
+// workers steal from the other deques before parking on a condition variable.
+class WorkerTaskQueue {
+ public:
+  explicit WorkerTaskQueue(int worker_count);
+  ~WorkerTaskQueue();
+
+  void Push(std::unique_ptr<v8::Task> task);
+  // Called by worker |worker_id| only, returns nullptr once stopped.
+  std::unique_ptr<v8::Task> BlockingPop(int worker_id);
+  void NotifyOfCompletion();
+  void BlockingDrain();
+  void Stop();
+
+ private:
+  class Deque;
+
+  v8::Task* FindTask(int worker_id);
+  v8::Task* PopInjected(Deque* local);
+  void WakeWorker();
+
+  std::vector<std::unique_ptr<Deque>> deques_;
+
+  Mutex injected_lock_;
+  std::deque<v8::Task*> injected_;
+  std::atomic<size_t> injected_size_;
+
+  // Tasks pushed but not yet taken by a worker, and workers parked waiting
+  // for one. Pushers only take park_lock_ when somebody is parked.
+  std::atomic<int64_t> queued_tasks_;
+  std::atomic<int> parked_workers_;
+  std::atomic<bool> stopped_;
+  Mutex park_lock_;
+  ConditionVariable tasks_available_;
+
+  std::atomic<int64_t> outstanding_tasks_;
+  Mutex drain_lock_;
+  ConditionVariable tasks_drained_;
+};
+
 struct DelayedTask {
   std::unique_ptr<v8::Task> task;
   uv_timer_t timer;
@@ -116,6 +160,7 @@ class PerIsolatePlatformData :
 class WorkerThreadsTaskRunner {
  public:
   explicit WorkerThreadsTaskRunner(int thread_pool_size);
+  ~WorkerThreadsTaskRunner();
 
   void PostTask(std::unique_ptr<v8::Task> task);
   void PostDelayedTask(std::unique_ptr<v8::Task> task,
@@ -127,7 +172,7 @@ class WorkerThreadsTaskRunner {
   int NumberOfWorkerThreads() const;
 
  private:
-  TaskQueue<v8::Task> pending_worker_tasks_;
+  WorkerTaskQueue pending_worker_tasks_;
 
   class DelayedTaskScheduler;
   std::unique_ptr<DelayedTaskScheduler> delayed_task_scheduler_;
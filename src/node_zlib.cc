@@ -40,11 +40,14 @@
 #include <cerrno>
 #include <cstdlib>
 #include <cstring>
+#include <algorithm>
 #include <atomic>
+#include <memory>
 
 namespace node {
 
 using v8::ArrayBuffer;
+using v8::BackingStore;
 using v8::Context;
 using v8::Function;
 using v8::FunctionCallbackInfo;
@@ -53,7 +56,10 @@ using v8::Global;
 using v8::HandleScope;
 using v8::Int32;
 using v8::Integer;
+using v8::Isolate;
 using v8::Local;
+using v8::MaybeLocal;
+using v8::Number;
 using v8::Object;
 using v8::Uint32Array;
 using v8::Value;
@@ -724,6 +730,370 @@ class BrotliCompressionStream : public CompressionStream<CompressionContext> {
 using BrotliEncoderStream = BrotliCompressionStream<BrotliEncoderContext>;
 using BrotliDecoderStream = BrotliCompressionStream<BrotliDecoderContext>;
 
+// The operating system byte of the gzip headers that deflate() writes. zlib
+// picks it when it is built, e.g. 3 on Linux but 19 on macOS, so it is taken
+// from the header of an empty stream.
+unsigned char GzipOsCode() {
+  static const unsigned char os_code = []() {
+    unsigned char code = 3;  // Unix, the default of zlib.
+    unsigned char out[32];
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if (deflateInit2(&strm, 0, Z_DEFLATED, 16 + 9, 1, Z_DEFAULT_STRATEGY) !=
+        Z_OK) {
+      return code;
+    }
+    strm.next_out = out;
+    strm.avail_out = sizeof(out);
+    if (deflate(&strm, Z_FINISH) == Z_STREAM_END)
+      code = out[9];
+    deflateEnd(&strm);
+    return code;
+  }();
+  return os_code;
+}
+
+// Compresses a whole input on several threads, the way pigz does. The input is
+// split into blocks that are deflated independently, each one primed with the
+// window of input that precedes it so that little compression is lost. All
+// blocks but the last end with a sync flush, which aligns them to a byte
+// boundary, so that they can be concatenated into a single deflate stream. The
+// zlib or gzip trailer is made by combining the checksums of the blocks.
+class ParallelDeflate final : public AsyncWrap {
+ public:
+  ParallelDeflate(Environment* env,
+                  Local<Object> wrap,
+                  node_zlib_mode mode,
+                  int level,
+                  int window_bits,
+                  int mem_level,
+                  int strategy,
+                  size_t block_size,
+                  uint32_t threads)
+      : AsyncWrap(env, wrap, AsyncWrap::PROVIDER_ZLIB),
+        mode_(mode),
+        level_(level),
+        // Like deflateInit2(), which does not support a window of 256 bytes.
+        window_bits_(window_bits == 8 ? 9 : window_bits),
+        mem_level_(mem_level),
+        strategy_(strategy),
+        block_size_(block_size),
+        threads_(threads) {
+    MakeWeak();
+  }
+
+  ~ParallelDeflate() override {
+    CHECK_EQ(false, running_ && "compression in progress");
+  }
+
+  // new ParallelDeflate(mode, level, windowBits, memLevel, strategy,
+  //                     blockSize, threads)
+  static void New(const FunctionCallbackInfo<Value>& args) {
+    Environment* env = Environment::GetCurrent(args);
+    CHECK_EQ(args.Length(), 7);
+    for (int i = 0; i < args.Length(); i++)
+      CHECK(args[i]->IsInt32());
+    const node_zlib_mode mode =
+        static_cast<node_zlib_mode>(args[0].As<Int32>()->Value());
+    CHECK(mode == DEFLATE || mode == GZIP || mode == DEFLATERAW);
+    const int block_size = args[5].As<Int32>()->Value();
+    const int threads = args[6].As<Int32>()->Value();
+    CHECK_GT(block_size, 0);
+    CHECK_GT(threads, 0);
+    new ParallelDeflate(env, args.This(), mode,
+                        args[1].As<Int32>()->Value(),
+                        args[2].As<Int32>()->Value(),
+                        args[3].As<Int32>()->Value(),
+                        args[4].As<Int32>()->Value(),
+                        block_size,
+                        threads);
+  }
+
+  // compress(input, maxOutputLength) calls ondone(result) once it is done,
+  // compressSync(input, maxOutputLength) returns the result. It is a Buffer,
+  // or a zlib error code: Z_BUF_ERROR if the output would be larger than
+  // maxOutputLength.
+  template <bool async>
+  static void Compress(const FunctionCallbackInfo<Value>& args) {
+    ParallelDeflate* deflate;
+    ASSIGN_OR_RETURN_UNWRAP(&deflate, args.Holder());
+    CHECK_EQ(false, deflate->running_);
+    CHECK(args[1]->IsNumber());
+    SPREAD_BUFFER_ARG(args[0], input);
+
+    deflate->input_ = input_data;
+    deflate->input_length_ = input_length;
+    deflate->max_output_length_ = args[1].As<Number>()->Value();
+    deflate->blocks_ = std::vector<Block>(std::max<size_t>(
+        1, (input_length + deflate->block_size_ - 1) / deflate->block_size_));
+    deflate->next_block_ = 0;
+    deflate->running_ = true;
+    const size_t workers =
+        std::min<size_t>(deflate->threads_, deflate->blocks_.size());
+
+    if (!async) {
+      deflate->env()->PrintSyncTrace();
+      std::vector<uv_thread_t> threads(workers - 1);
+      size_t started = 0;
+      // If a thread cannot be started, the others compress its blocks.
+      while (started < threads.size() &&
+             uv_thread_create(&threads[started], RunThread, deflate) == 0) {
+        started++;
+      }
+      deflate->CompressBlocks();
+      for (size_t i = 0; i < started; i++)
+        CHECK_EQ(uv_thread_join(&threads[i]), 0);
+      deflate->running_ = false;
+
+      Local<Value> result;
+      if (deflate->Finish().ToLocal(&result))
+        args.GetReturnValue().Set(result);
+      return;
+    }
+
+    // The backing store is kept alive, the input must not be modified.
+    deflate->input_store_ = std::move(input_bs);
+    deflate->ClearWeak();
+    deflate->cancelled_ = false;
+    deflate->pending_workers_ = workers;
+    deflate->workers_.clear();
+    for (size_t i = 0; i < workers; i++) {
+      deflate->workers_.emplace_back(
+          std::make_unique<Worker>(deflate->env(), deflate));
+    }
+    for (const auto& worker : deflate->workers_)
+      worker->ScheduleWork();
+  }
+
+  void MemoryInfo(MemoryTracker* tracker) const override {
+    size_t size = 0;
+    for (const Block& block : blocks_)
+      size += block.out.size;
+    tracker->TrackFieldWithSize("blocks", size);
+  }
+
+  SET_MEMORY_INFO_NAME(ParallelDeflate)
+  SET_SELF_SIZE(ParallelDeflate)
+
+ private:
+  struct Block {
+    // Truncated to the compressed length once the block is done.
+    MallocedBuffer<char> out;
+    uLong check = 0;
+    int err = Z_OK;
+  };
+
+  class Worker final : public ThreadPoolWork {
+   public:
+    Worker(Environment* env, ParallelDeflate* deflate)
+        : ThreadPoolWork(env), deflate_(deflate) {}
+
+    void DoThreadPoolWork() override { deflate_->CompressBlocks(); }
+    void AfterThreadPoolWork(int status) override {
+      deflate_->AfterWorker(status);
+    }
+
+   private:
+    ParallelDeflate* const deflate_;
+  };
+
+  static void RunThread(void* data) {
+    static_cast<ParallelDeflate*>(data)->CompressBlocks();
+  }
+
+  // Every worker takes the next block that nobody has taken yet, so a worker
+  // that starts late, or not at all, does not hold up the others.
+  void CompressBlocks() {
+    size_t index;
+    while ((index = next_block_.fetch_add(1, std::memory_order_relaxed)) <
+           blocks_.size()) {
+      CompressBlock(index);
+    }
+  }
+
+  void CompressBlock(size_t index) {
+    Block* block = &blocks_[index];
+    const size_t start = index * block_size_;
+    const size_t length = std::min(block_size_, input_length_ - start);
+    const bool last = index + 1 == blocks_.size();
+    const Bytef* in = reinterpret_cast<const Bytef*>(input_) + start;
+
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    block->err = deflateInit2(
+        &strm, level_, Z_DEFLATED, -window_bits_, mem_level_, strategy_);
+    if (block->err != Z_OK) return;
+    auto on_scope_leave = OnScopeLeave([&]() { deflateEnd(&strm); });
+
+    if (start > 0) {
+      const size_t dictionary_length =
+          std::min(start, static_cast<size_t>(1) << window_bits_);
+      block->err = deflateSetDictionary(
+          &strm, in - dictionary_length, dictionary_length);
+      if (block->err != Z_OK) return;
+    }
+
+    // deflateBound() does not include the empty stored block that the sync
+    // flush adds at the end.
+    size_t capacity = deflateBound(&strm, length) + 16;
+    char* out = UncheckedMalloc(capacity);
+    if (out == nullptr) {
+      block->err = Z_MEM_ERROR;
+      return;
+    }
+    strm.next_in = const_cast<Bytef*>(in);
+    strm.avail_in = length;
+    strm.next_out = reinterpret_cast<Bytef*>(out);
+    strm.avail_out = capacity;
+    const int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+    int err;
+    while ((err = deflate(&strm, flush)) == Z_OK && strm.avail_out == 0) {
+      char* grown = UncheckedRealloc(out, capacity * 2);
+      if (grown == nullptr) {
+        free(out);
+        block->err = Z_MEM_ERROR;
+        return;
+      }
+      out = grown;
+      strm.next_out = reinterpret_cast<Bytef*>(out + capacity);
+      strm.avail_out = capacity;
+      capacity *= 2;
+    }
+    block->out = MallocedBuffer<char>(out, capacity - strm.avail_out);
+    if (err != (last ? Z_STREAM_END : Z_OK)) {
+      block->err = err;
+      return;
+    }
+
+    if (mode_ == GZIP)
+      block->check = crc32(0, in, length);
+    else if (mode_ == DEFLATE)
+      block->check = adler32(1, in, length);
+  }
+
+  void AfterWorker(int status) {
+    if (status == UV_ECANCELED)
+      cancelled_ = true;
+    else
+      CHECK_EQ(status, 0);
+    if (--pending_workers_ > 0) return;
+
+    running_ = false;
+    input_store_.reset();
+    MakeWeak();
+    // The environment is being torn down.
+    if (cancelled_) return;
+
+    Environment* env = this->env();
+    HandleScope handle_scope(env->isolate());
+    Context::Scope context_scope(env->context());
+    Local<Value> result;
+    if (!Finish().ToLocal(&result)) return;
+    MakeCallback(env->ondone_string(), 1, &result);
+  }
+
+  MaybeLocal<Value> Finish() {
+    Isolate* isolate = env()->isolate();
+    auto on_scope_leave = OnScopeLeave([&]() { blocks_.clear(); });
+
+    const size_t header_size = mode_ == GZIP ? 10 : mode_ == DEFLATE ? 2 : 0;
+    const size_t trailer_size = mode_ == GZIP ? 8 : mode_ == DEFLATE ? 4 : 0;
+    size_t total = header_size + trailer_size;
+    for (const Block& block : blocks_) {
+      if (block.err != Z_OK)
+        return Integer::New(isolate, block.err);
+      total += block.out.size;
+    }
+    if (total > max_output_length_)
+      return Integer::New(isolate, Z_BUF_ERROR);
+
+    Local<Object> buffer;
+    if (!Buffer::New(env(), total).ToLocal(&buffer))
+      return MaybeLocal<Value>();
+    unsigned char* out =
+        reinterpret_cast<unsigned char*>(Buffer::Data(buffer));
+
+    // The headers that deflate() writes, without a file name or timestamp.
+    if (mode_ == GZIP) {
+      const unsigned char header[] = {
+        GZIP_HEADER_ID1, GZIP_HEADER_ID2, Z_DEFLATED, 0, 0, 0, 0, 0,
+        static_cast<unsigned char>(
+            level_ == 9 ? 2 :
+            (strategy_ >= Z_HUFFMAN_ONLY || (level_ >= 0 && level_ < 2)) ?
+                4 : 0),
+        GzipOsCode(),
+      };
+      static_assert(sizeof(header) == 10, "gzip header size");
+      memcpy(out, header, sizeof(header));
+    } else if (mode_ == DEFLATE) {
+      unsigned int level_flags;
+      if (strategy_ >= Z_HUFFMAN_ONLY || (level_ >= 0 && level_ < 2))
+        level_flags = 0;
+      else if (level_ >= 0 && level_ < 6)
+        level_flags = 1;
+      else if (level_ == 6 || level_ == Z_DEFAULT_COMPRESSION)
+        level_flags = 2;
+      else
+        level_flags = 3;
+      unsigned int header =
+          ((Z_DEFLATED + ((window_bits_ - 8) << 4)) << 8) | (level_flags << 6);
+      header += 31 - (header % 31);
+      out[0] = header >> 8;
+      out[1] = header & 0xff;
+    }
+    out += header_size;
+
+    uLong check = mode_ == GZIP ? crc32(0, nullptr, 0) : adler32(0, nullptr, 0);
+    for (size_t i = 0; i < blocks_.size(); i++) {
+      Block* block = &blocks_[i];
+      if (block->out.size > 0)
+        memcpy(out, block->out.data, block->out.size);
+      out += block->out.size;
+      block->out = MallocedBuffer<char>();
+
+      const z_off_t length =
+          std::min(block_size_, input_length_ - i * block_size_);
+      if (mode_ == GZIP)
+        check = crc32_combine(check, block->check, length);
+      else if (mode_ == DEFLATE)
+        check = adler32_combine(check, block->check, length);
+    }
+
+    if (mode_ == GZIP) {
+      // CRC-32 and the input length modulo 2^32, least significant byte first.
+      const uint64_t fields[] = { check, input_length_ };
+      for (uint64_t field : fields) {
+        for (int i = 0; i < 4; i++)
+          *out++ = (field >> (8 * i)) & 0xff;
+      }
+    } else if (mode_ == DEFLATE) {
+      // Adler-32, most significant byte first.
+      for (int i = 3; i >= 0; i--)
+        *out++ = (check >> (8 * i)) & 0xff;
+    }
+    return buffer;
+  }
+
+  const node_zlib_mode mode_;
+  const int level_;
+  const int window_bits_;
+  const int mem_level_;
+  const int strategy_;
+  const size_t block_size_;
+  const uint32_t threads_;
+
+  const char* input_ = nullptr;
+  size_t input_length_ = 0;
+  std::shared_ptr<BackingStore> input_store_;
+  double max_output_length_ = 0;
+  std::vector<Block> blocks_;
+  std::atomic<size_t> next_block_{0};
+  std::vector<std::unique_ptr<Worker>> workers_;
+  size_t pending_workers_ = 0;
+  bool cancelled_ = false;
+  bool running_ = false;
+};
+
 void ZlibContext::Close() {
   {
     Mutex::ScopedLock lock(mutex_);
@@ -1289,6 +1659,17 @@ void Initialize(Local<Object> target,
   MakeClass<BrotliEncoderStream>::Make(env, target, "BrotliEncoder");
   MakeClass<BrotliDecoderStream>::Make(env, target, "BrotliDecoder");
 
+  Local<FunctionTemplate> parallel_deflate =
+      env->NewFunctionTemplate(ParallelDeflate::New);
+  parallel_deflate->InstanceTemplate()->SetInternalFieldCount(
+      ParallelDeflate::kInternalFieldCount);
+  parallel_deflate->Inherit(AsyncWrap::GetConstructorTemplate(env));
+  env->SetProtoMethod(parallel_deflate, "compress",
+                      ParallelDeflate::Compress<true>);
+  env->SetProtoMethod(parallel_deflate, "compressSync",
+                      ParallelDeflate::Compress<false>);
+  env->SetConstructorFunction(target, "ParallelDeflate", parallel_deflate);
+
   target->Set(env->context(),
               FIXED_ONE_BYTE_STRING(env->isolate(), "ZLIB_VERSION"),
               FIXED_ONE_BYTE_STRING(env->isolate(), ZLIB_VERSION)).Check();
@@ -1298,6 +1679,9 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   MakeClass<ZlibStream>::Make(registry);
   MakeClass<BrotliEncoderStream>::Make(registry);
   MakeClass<BrotliDecoderStream>::Make(registry);
+  registry->Register(ParallelDeflate::New);
+  registry->Register(ParallelDeflate::Compress<true>);
+  registry->Register(ParallelDeflate::Compress<false>);
 }
 
 }  // anonymous namespace
@@ -10,10 +10,12 @@
 #include "node_errors.h"
 #include "node_external_reference.h"
 #include "string_bytes.h"
+#include "utf8.h"
 #include "util-inl.h"
 #include "v8.h"
 
 #include <climits>  // INT_MAX
+#include <functional>
 
 namespace node {
 
@@ -80,6 +82,40 @@ void StreamBase::SetWriteResult(const StreamWriteResult& res) {
   env_->stream_base_state()[kLastWriteWasAsync] = res.async;
 }
 
+// Bytes of strings and small Buffers that Writev() gathers on the stack, and
+// keeps there if the stream takes all of them right away.
+static constexpr size_t kWritevStackStorageSize = 16384;
+// Buffers up to this size are copied next to the chunks around them, so that
+// runs of small chunks take a single uv_buf_t.
+static constexpr size_t kMaxCoalescedBufferSize = 512;
+
+// Points *buf at the bytes of an external one-byte string if they are also
+// the bytes that it is written as, which is the case for ASCII and Latin-1
+// and, as long as every character is ASCII, for UTF-8.
+static bool GetExternalOneByteData(Local<String> string,
+                                   enum encoding encoding,
+                                   uv_buf_t* buf) {
+  if (!string->IsExternalOneByte())
+    return false;
+  if (encoding != ASCII && encoding != LATIN1 &&
+      encoding != UTF8 && encoding != BUFFER) {
+    return false;
+  }
+  const String::ExternalOneByteStringResource* resource =
+      string->GetExternalOneByteStringResource();
+  const char* data = resource->data();
+  const size_t length = resource->length();
+  if (data == nullptr)
+    return false;
+  if (encoding != ASCII && encoding != LATIN1 &&
+      utf8::AsciiPrefixLength(data, length) != length) {
+    return false;
+  }
+  buf->base = const_cast<char*>(data);
+  buf->len = length;
+  return true;
+}
+
 int StreamBase::Writev(const FunctionCallbackInfo<Value>& args) {
   Environment* env = Environment::GetCurrent(args);
   Isolate* isolate = env->isolate();
@@ -100,98 +136,169 @@ int StreamBase::Writev(const FunctionCallbackInfo<Value>& args) {
 
   MaybeStackBuffer<uv_buf_t, 16> bufs(count);
 
-  size_t storage_size = 0;
-  size_t offset;
-
-  if (!all_buffers) {
-    // Determine storage size first
+  if (all_buffers) {
     for (size_t i = 0; i < count; i++) {
       Local<Value> chunk;
-      if (!chunks->Get(context, i * 2).ToLocal(&chunk))
+      if (!chunks->Get(context, i).ToLocal(&chunk))
         return -1;
+      bufs[i].base = Buffer::Data(chunk);
+      bufs[i].len = Buffer::Length(chunk);
+    }
 
-      if (Buffer::HasInstance(chunk))
-        continue;
-        // Buffer chunk, no additional storage required
+    StreamWriteResult res = Write(*bufs, count, nullptr, req_wrap_obj);
+    SetWriteResult(res);
+    return res.err;
+  }
 
-      // String chunk
-      Local<String> string;
-      if (!chunk->ToString(context).ToLocal(&string))
-        return -1;
-      Local<Value> next_chunk;
-      if (!chunks->Get(context, i * 2 + 1).ToLocal(&next_chunk))
-        return -1;
-      enum encoding encoding = ParseEncoding(isolate, next_chunk);
-      size_t chunk_size;
-      if ((encoding == UTF8 &&
-             string->Length() > 65535 &&
-             !StringBytes::Size(isolate, string, encoding).To(&chunk_size)) ||
-              !StringBytes::StorageSize(isolate, string, encoding)
-                  .To(&chunk_size)) {
-        return -1;
+  // Buffers that are not coalesced and external one-byte strings are written
+  // from where they are, the other chunks are copied into storage. Their
+  // entries in bufs have a null base until then.
+  MaybeStackBuffer<Local<Value>, 16> copied(count);
+  MaybeStackBuffer<enum encoding, 16> encodings(count);
+  size_t storage_size = 0;
+
+  for (size_t i = 0; i < count; i++) {
+    Local<Value> chunk;
+    if (!chunks->Get(context, i * 2).ToLocal(&chunk))
+      return -1;
+
+    if (Buffer::HasInstance(chunk)) {
+      const size_t length = Buffer::Length(chunk);
+      if (length > kMaxCoalescedBufferSize) {
+        bufs[i].base = Buffer::Data(chunk);
+        bufs[i].len = length;
+        continue;
       }
-      storage_size += chunk_size;
+      bufs[i] = uv_buf_init(nullptr, 0);
+      copied[i] = chunk;
+      storage_size += length;
+      continue;
     }
 
-    if (storage_size > INT_MAX)
-      return UV_ENOBUFS;
-  } else {
-    for (size_t i = 0; i < count; i++) {
-      Local<Value> chunk;
-      if (!chunks->Get(context, i).ToLocal(&chunk))
-        return -1;
-      bufs[i].base = Buffer::Data(chunk);
-      bufs[i].len = Buffer::Length(chunk);
+    Local<String> string;
+    if (!chunk->ToString(context).ToLocal(&string))
+      return -1;
+    Local<Value> next_chunk;
+    if (!chunks->Get(context, i * 2 + 1).ToLocal(&next_chunk))
+      return -1;
+    enum encoding encoding = ParseEncoding(isolate, next_chunk);
+    if (GetExternalOneByteData(string, encoding, &bufs[i]))
+      continue;
+
+    size_t chunk_size;
+    if ((encoding == UTF8 &&
+           string->Length() > 65535 &&
+           !StringBytes::Size(isolate, string, encoding).To(&chunk_size)) ||
+            !StringBytes::StorageSize(isolate, string, encoding)
+                .To(&chunk_size)) {
+      return -1;
     }
+    bufs[i] = uv_buf_init(nullptr, 0);
+    copied[i] = string;
+    encodings[i] = encoding;
+    storage_size += chunk_size;
   }
 
+  if (storage_size > INT_MAX)
+    return UV_ENOBUFS;
+
+  char stack_storage[kWritevStackStorageSize];
   std::unique_ptr<BackingStore> bs;
-  if (storage_size > 0) {
+  char* storage = stack_storage;
+  if (storage_size > sizeof(stack_storage)) {
     NoArrayBufferZeroFillScope no_zero_fill_scope(env->isolate_data());
     bs = ArrayBuffer::NewBackingStore(isolate, storage_size);
+    storage = static_cast<char*>(bs->Data());
   }
 
-  offset = 0;
-  if (!all_buffers) {
-    for (size_t i = 0; i < count; i++) {
-      Local<Value> chunk;
-      if (!chunks->Get(context, i * 2).ToLocal(&chunk))
-        return -1;
-
-      // Write buffer
-      if (Buffer::HasInstance(chunk)) {
-        bufs[i].base = Buffer::Data(chunk);
-        bufs[i].len = Buffer::Length(chunk);
-        continue;
-      }
+  // Copy the chunks, merging every one that follows another in storage into
+  // the entry of the one before.
+  size_t offset = 0;
+  size_t nbufs = 0;
+  bool last_in_storage = false;
+  for (size_t i = 0; i < count; i++) {
+    if (bufs[i].base != nullptr) {
+      bufs[nbufs++] = bufs[i];
+      last_in_storage = false;
+      continue;
+    }
 
-      // Write string
+    char* const data = storage + offset;
+    size_t size;
+    if (copied[i]->IsString()) {
       CHECK_LE(offset, storage_size);
-      char* str_storage =
-          static_cast<char*>(bs ? bs->Data() : nullptr) + offset;
-      size_t str_size = (bs ? bs->ByteLength() : 0) - offset;
+      size = StringBytes::Write(isolate,
+                                data,
+                                storage_size - offset,
+                                copied[i].As<String>(),
+                                encodings[i]);
+    } else {
+      size = Buffer::Length(copied[i]);
+      memcpy(data, Buffer::Data(copied[i]), size);
+    }
+    offset += size;
 
-      Local<String> string;
-      if (!chunk->ToString(context).ToLocal(&string))
-        return -1;
-      Local<Value> next_chunk;
-      if (!chunks->Get(context, i * 2 + 1).ToLocal(&next_chunk))
-        return -1;
-      enum encoding encoding = ParseEncoding(isolate, next_chunk);
-      str_size = StringBytes::Write(isolate,
-                                    str_storage,
-                                    str_size,
-                                    string,
-                                    encoding);
-      bufs[i].base = str_storage;
-      bufs[i].len = str_size;
-      offset += str_size;
+    if (last_in_storage)
+      bufs[nbufs - 1].len += size;
+    else
+      bufs[nbufs++] = uv_buf_init(data, size);
+    last_in_storage = true;
+  }
+
+  if (bs) {
+    StreamWriteResult res = Write(*bufs, nbufs, nullptr, req_wrap_obj);
+    SetWriteResult(res);
+    if (res.wrap != nullptr)
+      res.wrap->SetBackingStore(std::move(bs));
+    return res.err;
+  }
+
+  // The copies are on the stack, which only works if they are written right
+  // away. Like in WriteString(), try that first and move what is left into a
+  // BackingStore otherwise.
+  size_t total_size = 0;
+  for (size_t i = 0; i < nbufs; i++)
+    total_size += bufs[i].len;
+
+  uv_buf_t* pending = *bufs;
+  size_t pending_count = nbufs;
+  const int err = DoTryWrite(&pending, &pending_count);
+  size_t synchronously_written = total_size;
+  for (size_t i = 0; i < pending_count; i++)
+    synchronously_written -= pending[i].len;
+  bytes_written_ += synchronously_written;
+
+  if (err != 0 || pending_count == 0) {
+    SetWriteResult(StreamWriteResult { false, err, nullptr, total_size, {} });
+    return err;
+  }
+
+  auto in_stack_storage = [&](const uv_buf_t& buf) {
+    return std::less_equal<const char*>()(stack_storage, buf.base) &&
+           std::less<const char*>()(buf.base, stack_storage + offset);
+  };
+  size_t pending_storage_size = 0;
+  for (size_t i = 0; i < pending_count; i++) {
+    if (in_stack_storage(pending[i]))
+      pending_storage_size += pending[i].len;
+  }
+  if (pending_storage_size > 0) {
+    NoArrayBufferZeroFillScope no_zero_fill_scope(env->isolate_data());
+    bs = ArrayBuffer::NewBackingStore(isolate, pending_storage_size);
+    char* data = static_cast<char*>(bs->Data());
+    for (size_t i = 0; i < pending_count; i++) {
+      if (in_stack_storage(pending[i])) {
+        memcpy(data, pending[i].base, pending[i].len);
+        pending[i].base = data;
+        data += pending[i].len;
+      }
     }
   }
 
-  StreamWriteResult res = Write(*bufs, count, nullptr, req_wrap_obj);
+  StreamWriteResult res = Write(pending, pending_count, nullptr, req_wrap_obj);
+  res.bytes += synchronously_written;
   SetWriteResult(res);
-  if (res.wrap != nullptr && storage_size > 0)
+  if (res.wrap != nullptr && bs)
     res.wrap->SetBackingStore(std::move(bs));
   return res.err;
 }
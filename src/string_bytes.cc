@@ -25,6 +25,7 @@
 #include "env-inl.h"
 #include "node_buffer.h"
 #include "node_errors.h"
+#include "utf8.h"
 #include "util.h"
 
 #include <climits>
@@ -197,6 +198,133 @@ MaybeLocal<Value> ExternTwoByteString::NewSimpleFromCopy(Isolate* isolate,
   return str.ToLocalChecked();
 }
 
+inline void DecodeUtf8(const char* buf, size_t buflen, char* dst) {
+  utf8::ConvertToLatin1(buf, buflen, dst);
+}
+
+inline void DecodeUtf8(const char* buf, size_t buflen, uint16_t* dst) {
+  utf8::ConvertToUtf16(buf, buflen, dst);
+}
+
+// Decodes the well-formed UTF-8 in buf into a string of length characters.
+// Strings V8 copies anyway are decoded into a temporary buffer.
+template <typename ExternType, typename TypeName>
+MaybeLocal<Value> NewFromWellFormedUtf8(Isolate* isolate,
+                                        const char* buf,
+                                        size_t buflen,
+                                        size_t length,
+                                        Local<Value>* error) {
+  if (length < EXTERN_APEX) {
+    MaybeStackBuffer<TypeName> out(length);
+    DecodeUtf8(buf, buflen, out.out());
+    return ExternType::NewFromCopy(isolate, out.out(), length, error);
+  }
+
+  TypeName* out = node::UncheckedMalloc<TypeName>(length);
+  if (out == nullptr) {
+    *error = node::ERR_MEMORY_ALLOCATION_FAILED(isolate);
+    return MaybeLocal<Value>();
+  }
+  DecodeUtf8(buf, buflen, out);
+  return ExternType::New(isolate, out, length, error);
+}
+
+// String::WriteUtf8 and String::Utf8Length go through two-byte strings one
+// code unit at a time. The kernels in utf8.h work on characters copied out
+// of the string in chunks that stay in cache instead.
+constexpr size_t kUtf8Chunk = 4096;
+constexpr int kUtf8ChunkFlags = String::HINT_MANY_WRITES_EXPECTED |
+                                String::NO_NULL_TERMINATION;
+
+inline void CopyChunk(Isolate* isolate,
+                      Local<String> str,
+                      uint8_t* dst,
+                      size_t start,
+                      size_t length) {
+  str->WriteOneByte(isolate, dst, start, length, kUtf8ChunkFlags);
+}
+
+inline void CopyChunk(Isolate* isolate,
+                      Local<String> str,
+                      uint16_t* dst,
+                      size_t start,
+                      size_t length) {
+  str->Write(isolate, dst, start, length, kUtf8ChunkFlags);
+}
+
+// A chunk that is followed by more characters must not end between the two
+// halves of a surrogate pair, which would be encoded as two U+FFFD.
+inline size_t ChunkEnd(const uint8_t* chunk, size_t length, bool more) {
+  return length;
+}
+
+inline size_t ChunkEnd(const uint16_t* chunk, size_t length, bool more) {
+  if (more && (chunk[length - 1] & 0xfc00) == 0xd800)
+    return length - 1;
+  return length;
+}
+
+inline size_t EncodeChunk(const uint8_t* chunk, size_t length,
+                          char* dst, size_t dstlen, size_t* read) {
+  return utf8::FromLatin1(chunk, length, dst, dstlen, read);
+}
+
+inline size_t EncodeChunk(const uint16_t* chunk, size_t length,
+                          char* dst, size_t dstlen, size_t* read) {
+  return utf8::FromUtf16(chunk, length, dst, dstlen, read);
+}
+
+// Encodes the characters of str from start on into buf for as long as they
+// fit, and sets *chars_read to the index of the first one that did not.
+template <typename Char>
+size_t WriteUtf8Chunks(Isolate* isolate,
+                       Local<String> str,
+                       size_t start,
+                       char* buf,
+                       size_t buflen,
+                       size_t* chars_read) {
+  Char chunk[kUtf8Chunk];
+  const size_t length = str->Length();
+  size_t nbytes = 0;
+  size_t i = start;
+  while (i < length && nbytes < buflen) {
+    // Every character takes at least a byte, so there is no point in copying
+    // more than there is room for, plus one to see the end of a pair.
+    const size_t n = std::min({kUtf8Chunk, length - i, buflen - nbytes + 1});
+    CopyChunk(isolate, str, chunk, i, n);
+    const size_t end = ChunkEnd(chunk, n, i + n < length);
+    size_t read;
+    nbytes += EncodeChunk(chunk, end, buf + nbytes, buflen - nbytes, &read);
+    i += read;
+    if (read < end)
+      break;
+  }
+  *chars_read = i;
+  return nbytes;
+}
+
+// Same as String::WriteUtf8 with REPLACE_INVALID_UTF8.
+size_t WriteUtf8(Isolate* isolate,
+                 char* buf,
+                 size_t buflen,
+                 Local<String> str,
+                 size_t* chars_read) {
+  if (!str->IsOneByte())
+    return WriteUtf8Chunks<uint16_t>(isolate, str, 0, buf, buflen, chars_read);
+
+  // Most one-byte strings are ASCII, which is written in place.
+  const size_t length = std::min<size_t>(buflen, str->Length());
+  str->WriteOneByte(isolate, reinterpret_cast<uint8_t*>(buf), 0, length,
+                    kUtf8ChunkFlags);
+  const size_t ascii = utf8::AsciiPrefixLength(buf, length);
+  if (ascii == length) {
+    *chars_read = length;
+    return length;
+  }
+  return ascii + WriteUtf8Chunks<uint8_t>(isolate, str, ascii, buf + ascii,
+                                          buflen - ascii, chars_read);
+}
+
 }  // anonymous namespace
 
 // supports regular and URL-safe base64
@@ -338,9 +466,12 @@ size_t StringBytes::Write(Isolate* isolate,
       break;
 
     case BUFFER:
-    case UTF8:
-      nbytes = str->WriteUtf8(isolate, buf, buflen, chars_written, flags);
+    case UTF8: {
+      size_t nchars;
+      nbytes = WriteUtf8(isolate, buf, buflen, str, &nchars);
+      *chars_written = static_cast<int>(nchars);
       break;
+    }
 
     case UCS2: {
       size_t nchars;
@@ -446,6 +577,24 @@ Maybe<size_t> StringBytes::StorageSize(Isolate* isolate,
   return Just(data_size);
 }
 
+size_t StringBytes::Utf8Length(Isolate* isolate, Local<String> str) {
+  // V8 counts one-byte strings in a loop compilers vectorize.
+  if (str->IsOneByte())
+    return str->Utf8Length(isolate);
+
+  uint16_t chunk[kUtf8Chunk];
+  const size_t length = str->Length();
+  size_t nbytes = 0;
+  for (size_t i = 0; i < length;) {
+    const size_t n = std::min(kUtf8Chunk, length - i);
+    CopyChunk(isolate, str, chunk, i, n);
+    const size_t end = ChunkEnd(chunk, n, i + n < length);
+    nbytes += utf8::Utf16Length(chunk, end);
+    i += end;
+  }
+  return nbytes;
+}
+
 Maybe<size_t> StringBytes::Size(Isolate* isolate,
                                 Local<Value> val,
                                 enum encoding encoding) {
@@ -465,7 +614,7 @@ Maybe<size_t> StringBytes::Size(Isolate* isolate,
 
     case BUFFER:
     case UTF8:
-      return Just<size_t>(str->Utf8Length(isolate));
+      return Just(Utf8Length(isolate, str));
 
     case UCS2:
       return Just(str->Length() * sizeof(uint16_t));
@@ -487,57 +636,6 @@ Maybe<size_t> StringBytes::Size(Isolate* isolate,
 
 
 
-static bool contains_non_ascii_slow(const char* buf, size_t len) {
-  for (size_t i = 0; i < len; ++i) {
-    if (buf[i] & 0x80)
-      return true;
-  }
-  return false;
-}
-
-
-static bool contains_non_ascii(const char* src, size_t len) {
-  if (len < 16) {
-    return contains_non_ascii_slow(src, len);
-  }
-
-  const unsigned bytes_per_word = sizeof(uintptr_t);
-  const unsigned align_mask = bytes_per_word - 1;
-  const unsigned unaligned = reinterpret_cast<uintptr_t>(src) & align_mask;
-
-  if (unaligned > 0) {
-    const unsigned n = bytes_per_word - unaligned;
-    if (contains_non_ascii_slow(src, n))
-      return true;
-    src += n;
-    len -= n;
-  }
-
-
-#if defined(_WIN64) || defined(_LP64)
-  const uintptr_t mask = 0x8080808080808080ll;
-#else
-  const uintptr_t mask = 0x80808080l;
-#endif
-
-  const uintptr_t* srcw = reinterpret_cast<const uintptr_t*>(src);
-
-  for (size_t i = 0, n = len / bytes_per_word; i < n; ++i) {
-    if (srcw[i] & mask)
-      return true;
-  }
-
-  const unsigned remainder = len & align_mask;
-  if (remainder > 0) {
-    const size_t offset = len - remainder;
-    if (contains_non_ascii_slow(src + offset, remainder))
-      return true;
-  }
-
-  return false;
-}
-
-
 static void force_ascii_slow(const char* src, char* dst, size_t len) {
   for (size_t i = 0; i < len; ++i) {
     dst[i] = src[i] & 0x7f;
@@ -655,7 +753,7 @@ MaybeLocal<Value> StringBytes::Encode(Isolate* isolate,
       }
 
     case ASCII:
-      if (contains_non_ascii(buf, buflen)) {
+      if (utf8::AsciiPrefixLength(buf, buflen) != buflen) {
         char* out = node::UncheckedMalloc(buflen);
         if (out == nullptr) {
           *error = node::ERR_MEMORY_ALLOCATION_FAILED(isolate);
@@ -669,6 +767,23 @@ MaybeLocal<Value> StringBytes::Encode(Isolate* isolate,
 
     case UTF8:
       {
+        const size_t ascii = utf8::AsciiPrefixLength(buf, buflen);
+        if (ascii == buflen)
+          return ExternOneByteString::NewFromCopy(isolate, buf, buflen, error);
+
+        size_t length;
+        bool latin1;
+        if (utf8::Validate(buf + ascii, buflen - ascii, &length, &latin1)) {
+          length += ascii;
+          if (latin1) {
+            return NewFromWellFormedUtf8<ExternOneByteString, char>(
+                isolate, buf, buflen, length, error);
+          }
+          return NewFromWellFormedUtf8<ExternTwoByteString, uint16_t>(
+              isolate, buf, buflen, length, error);
+        }
+
+        // V8 replaces malformed sequences with U+FFFD.
         val = String::NewFromUtf8(isolate,
                                   buf,
                                   v8::NewStringType::kNormal,
@@ -67,6 +67,9 @@ class StringBytes {
                                 v8::Local<v8::Value> val,
                                 enum encoding enc);
 
+  // Number of bytes str takes as UTF-8, the same as String::Utf8Length.
+  static size_t Utf8Length(v8::Isolate* isolate, v8::Local<v8::String> str);
+
   // Write the bytes from the string or buffer into the char*
   // returns the number of bytes written, which will always be
   // <= buflen.  Use StorageSize/Size first to know how much
@@ -0,0 +1,362 @@
+#include "string_search.h"
+
+#include <algorithm>
+#include <cstring>
+
+// GCC and clang compile the x86 kernel for AVX2 through a target attribute
+// and check the CPU at runtime. Other compilers use the scalar code on x86.
+// AArch64 always has NEON.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NODE_SEARCH_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define NODE_SEARCH_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(NODE_SEARCH_X86) || defined(NODE_SEARCH_NEON)
+#define NODE_SEARCH_SIMD 1
+#endif
+
+namespace node {
+namespace stringsearch {
+
+namespace {
+
+// Positions that pass the filter without matching, beyond which FindBytes
+// leaves the search to StringSearch: a fixed allowance plus one per this many
+// bytes searched.
+constexpr size_t kFalseCandidateAllowance = 64;
+constexpr size_t kBytesPerFalseCandidate = 32;
+
+// Up to this many needles are filtered together by FindAnyBytes.
+constexpr size_t kMaxFilteredNeedles = 8;
+
+inline bool Matches(const uint8_t* at, const Needle& needle) {
+  return memcmp(at, needle.data, needle.length) == 0;
+}
+
+size_t FindAnyScalar(const uint8_t* haystack, size_t length,
+                     const Needle* needles, size_t count,
+                     size_t i, size_t* which) {
+  bool first_bytes[256] = {};
+  for (size_t j = 0; j < count; j++)
+    first_bytes[needles[j].data[0]] = true;
+  for (; i < length; i++) {
+    if (!first_bytes[haystack[i]])
+      continue;
+    for (size_t j = 0; j < count; j++) {
+      if (needles[j].length <= length - i &&
+          Matches(haystack + i, needles[j])) {
+        *which = j;
+        return i;
+      }
+    }
+  }
+  return length;
+}
+
+#ifdef NODE_SEARCH_X86
+
+#define SIMD_TARGET __attribute__((target("avx2")))
+
+// Operations on 32 bytes the searches below are written in.
+struct Simd {
+  using Vec = __m256i;
+  static constexpr Kernel kKernel = Kernel::AVX2;
+  static constexpr size_t kWidth = 32;
+  // Mask has this many bits per byte, of which only the highest can be set.
+  static constexpr int kMaskBits = 1;
+
+  SIMD_TARGET static inline Vec Load(const uint8_t* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+  }
+
+  SIMD_TARGET static inline Vec Splat(uint8_t c) {
+    return _mm256_set1_epi8(static_cast<char>(c));
+  }
+
+  SIMD_TARGET static inline Vec Equal(Vec a, Vec b) {
+    return _mm256_cmpeq_epi8(a, b);
+  }
+
+  SIMD_TARGET static inline Vec And(Vec a, Vec b) {
+    return _mm256_and_si256(a, b);
+  }
+
+  SIMD_TARGET static inline Vec Or(Vec a, Vec b) {
+    return _mm256_or_si256(a, b);
+  }
+
+  SIMD_TARGET static inline Vec Zero() {
+    return _mm256_setzero_si256();
+  }
+
+  SIMD_TARGET static inline uint64_t Mask(Vec v) {
+    return static_cast<uint32_t>(_mm256_movemask_epi8(v));
+  }
+};
+
+#endif  // NODE_SEARCH_X86
+
+#ifdef NODE_SEARCH_NEON
+
+#define SIMD_TARGET
+
+struct Simd {
+  using Vec = uint8x16_t;
+  static constexpr Kernel kKernel = Kernel::NEON;
+  static constexpr size_t kWidth = 16;
+  static constexpr int kMaskBits = 4;
+
+  static inline Vec Load(const uint8_t* p) {
+    return vld1q_u8(p);
+  }
+
+  static inline Vec Splat(uint8_t c) {
+    return vdupq_n_u8(c);
+  }
+
+  static inline Vec Equal(Vec a, Vec b) {
+    return vceqq_u8(a, b);
+  }
+
+  static inline Vec And(Vec a, Vec b) {
+    return vandq_u8(a, b);
+  }
+
+  static inline Vec Or(Vec a, Vec b) {
+    return vorrq_u8(a, b);
+  }
+
+  static inline Vec Zero() {
+    return vdupq_n_u8(0);
+  }
+
+  // Narrows every byte to a nibble, which is cheaper than gathering single
+  // bits on NEON.
+  static inline uint64_t Mask(Vec v) {
+    const uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(v), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(nibbles), 0) &
+           0x8888888888888888ull;
+  }
+};
+
+#endif  // NODE_SEARCH_NEON
+
+#ifdef NODE_SEARCH_SIMD
+
+using Vec = Simd::Vec;
+
+inline size_t LowestPosition(uint64_t mask) {
+  return __builtin_ctzll(mask) / Simd::kMaskBits;
+}
+
+inline size_t HighestPosition(uint64_t mask) {
+  return (63 - __builtin_clzll(mask)) / Simd::kMaskBits;
+}
+
+inline uint64_t ClearHighest(uint64_t mask) {
+  return mask & ~(uint64_t{1} << (63 - __builtin_clzll(mask)));
+}
+
+SIMD_TARGET inline uint64_t Candidates(const uint8_t* at, Vec first, Vec last,
+                                       size_t last_offset) {
+  return Simd::Mask(Simd::And(Simd::Equal(Simd::Load(at), first),
+                              Simd::Equal(Simd::Load(at + last_offset),
+                                          last)));
+}
+
+SIMD_TARGET bool FindForwardSimd(const uint8_t* haystack, size_t length,
+                                 const uint8_t* needle, size_t needle_length,
+                                 size_t* index) {
+  const Vec first = Simd::Splat(needle[0]);
+  const Vec last = Simd::Splat(needle[needle_length - 1]);
+  const size_t last_offset = needle_length - 1;
+  const size_t start = *index;
+  size_t false_candidates = 0;
+  size_t i = start;
+  for (; i + Simd::kWidth + last_offset <= length; i += Simd::kWidth) {
+    uint64_t mask = Candidates(haystack + i, first, last, last_offset);
+    while (mask != 0) {
+      const size_t pos = i + LowestPosition(mask);
+      if (memcmp(haystack + pos + 1, needle + 1, needle_length - 2) == 0) {
+        *index = pos;
+        return true;
+      }
+      if (++false_candidates > kFalseCandidateAllowance +
+                               (i - start) / kBytesPerFalseCandidate) {
+        *index = pos + 1;
+        return false;
+      }
+      mask &= mask - 1;
+    }
+  }
+  for (; i + needle_length <= length; i++) {
+    if (haystack[i] == needle[0] &&
+        memcmp(haystack + i + 1, needle + 1, needle_length - 1) == 0) {
+      *index = i;
+      return true;
+    }
+  }
+  *index = length;
+  return true;
+}
+
+SIMD_TARGET bool FindBackwardSimd(const uint8_t* haystack, size_t length,
+                                  const uint8_t* needle, size_t needle_length,
+                                  size_t* index) {
+  const Vec first = Simd::Splat(needle[0]);
+  const Vec last = Simd::Splat(needle[needle_length - 1]);
+  const size_t last_offset = needle_length - 1;
+  const size_t start = *index;
+  size_t false_candidates = 0;
+  // Positions below end are left to search.
+  size_t end = start + 1;
+  for (; end >= Simd::kWidth; end -= Simd::kWidth) {
+    const size_t block = end - Simd::kWidth;
+    uint64_t mask = Candidates(haystack + block, first, last, last_offset);
+    while (mask != 0) {
+      const size_t pos = block + HighestPosition(mask);
+      if (memcmp(haystack + pos + 1, needle + 1, needle_length - 2) == 0) {
+        *index = pos;
+        return true;
+      }
+      if (pos > 0 &&
+          ++false_candidates > kFalseCandidateAllowance +
+                               (start - block) / kBytesPerFalseCandidate) {
+        *index = pos - 1;
+        return false;
+      }
+      mask = ClearHighest(mask);
+    }
+  }
+  for (; end > 0; end--) {
+    const size_t pos = end - 1;
+    if (haystack[pos] == needle[0] &&
+        memcmp(haystack + pos + 1, needle + 1, needle_length - 1) == 0) {
+      *index = pos;
+      return true;
+    }
+  }
+  *index = length;
+  return true;
+}
+
+SIMD_TARGET size_t FindAnySimd(const uint8_t* haystack, size_t length,
+                               const Needle* needles, size_t count,
+                               size_t i, size_t* which) {
+  Vec first[kMaxFilteredNeedles];
+  Vec last[kMaxFilteredNeedles];
+  size_t longest = 0;
+  for (size_t j = 0; j < count; j++) {
+    first[j] = Simd::Splat(needles[j].data[0]);
+    last[j] = Simd::Splat(needles[j].data[needles[j].length - 1]);
+    longest = std::max(longest, needles[j].length);
+  }
+  for (; i + Simd::kWidth + longest - 1 <= length; i += Simd::kWidth) {
+    const Vec block = Simd::Load(haystack + i);
+    Vec any = Simd::Zero();
+    for (size_t j = 0; j < count; j++) {
+      any = Simd::Or(any, Simd::And(
+          Simd::Equal(block, first[j]),
+          Simd::Equal(Simd::Load(haystack + i + needles[j].length - 1),
+                      last[j])));
+    }
+    for (uint64_t mask = Simd::Mask(any); mask != 0; mask &= mask - 1) {
+      const size_t pos = i + LowestPosition(mask);
+      for (size_t j = 0; j < count; j++) {
+        if (Matches(haystack + pos, needles[j])) {
+          *which = j;
+          return pos;
+        }
+      }
+    }
+  }
+  return FindAnyScalar(haystack, length, needles, count, i, which);
+}
+
+#undef SIMD_TARGET
+
+#endif  // NODE_SEARCH_SIMD
+
+Kernel BestKernel() {
+  if (KernelSupported(Kernel::AVX2))
+    return Kernel::AVX2;
+  if (KernelSupported(Kernel::NEON))
+    return Kernel::NEON;
+  return Kernel::SCALAR;
+}
+
+Kernel selected_kernel = BestKernel();
+
+inline bool UseSimd() {
+#ifdef NODE_SEARCH_SIMD
+  return selected_kernel == Simd::kKernel;
+#else
+  return false;
+#endif
+}
+
+}  // anonymous namespace
+
+bool KernelSupported(Kernel kernel) {
+  switch (kernel) {
+    case Kernel::SCALAR:
+      return true;
+#ifdef NODE_SEARCH_X86
+    case Kernel::AVX2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2");
+#endif
+#ifdef NODE_SEARCH_NEON
+    case Kernel::NEON:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+Kernel CurrentKernel() {
+  return selected_kernel;
+}
+
+void SetKernel(Kernel kernel) {
+  CHECK(KernelSupported(kernel));
+  selected_kernel = kernel;
+}
+
+bool FindBytes(const uint8_t* haystack, size_t length,
+               const uint8_t* needle, size_t needle_length,
+               bool is_forward, size_t* index) {
+  CHECK_GT(needle_length, 1);
+  CHECK_LE(needle_length, length);
+#ifdef NODE_SEARCH_SIMD
+  if (UseSimd()) {
+    return is_forward ?
+        FindForwardSimd(haystack, length, needle, needle_length, index) :
+        FindBackwardSimd(haystack, length, needle, needle_length, index);
+  }
+#endif
+  return false;
+}
+
+size_t FindAnyBytes(const uint8_t* haystack, size_t length,
+                    const Needle* needles, size_t count,
+                    size_t index, size_t* which) {
+  for (size_t j = 0; j < count; j++) {
+    if (needles[j].length == 0) {
+      *which = j;
+      return std::min(index, length);
+    }
+  }
+#ifdef NODE_SEARCH_SIMD
+  if (UseSimd() && count <= kMaxFilteredNeedles)
+    return FindAnySimd(haystack, length, needles, count, index, which);
+#endif
+  return FindAnyScalar(haystack, length, needles, count, index, which);
+}
+
+}  // namespace stringsearch
+}  // namespace node
@@ -47,6 +47,46 @@ class Vector {
 };
 
 
+//---------------------------------------------------------------------
+// Vectorized byte search.
+//---------------------------------------------------------------------
+
+// The searches through bytes below compare the first and the last byte of
+// the needle at a whole vector of positions at once and only look at the
+// rest of it where both match. The best kernel the CPU supports is picked at
+// startup; tests switch between them to compare their results with the
+// scalar code.
+enum class Kernel {
+  SCALAR,
+  AVX2,
+  NEON
+};
+
+bool KernelSupported(Kernel kernel);
+Kernel CurrentKernel();
+void SetKernel(Kernel kernel);
+
+// Searches haystack for a needle of at least two bytes, forward from *index
+// or backward from it. Returns true with *index set to the position of the
+// match, or to length if there is none. Returns false if there is no vector
+// kernel or too many positions pass the filter without matching, with
+// *index set to where the search should continue.
+bool FindBytes(const uint8_t* haystack, size_t length,
+               const uint8_t* needle, size_t needle_length,
+               bool is_forward, size_t* index);
+
+struct Needle {
+  const uint8_t* data;
+  size_t length;
+};
+
+// Position of the first occurrence of any of the needles at or after index,
+// or length if there is none. *which is set to the first of the needles that
+// occurs there. An empty needle occurs everywhere.
+size_t FindAnyBytes(const uint8_t* haystack, size_t length,
+                    const Needle* needles, size_t count,
+                    size_t index, size_t* which);
+
 //---------------------------------------------------------------------
 // String Search object.
 //---------------------------------------------------------------------
@@ -606,6 +646,18 @@ size_t SearchString(const Char* haystack,
   stringsearch::Vector<const Char> v_haystack(
       haystack, haystack_length, is_forward);
   size_t diff = haystack_length - needle_length;
+  if (sizeof(Char) == 1 && needle_length > 1) {
+    size_t index = is_forward ? start_index : std::min(start_index, diff);
+    if (stringsearch::FindBytes(reinterpret_cast<const uint8_t*>(haystack),
+                                haystack_length,
+                                reinterpret_cast<const uint8_t*>(needle),
+                                needle_length,
+                                is_forward,
+                                &index)) {
+      return index;
+    }
+    start_index = index;
+  }
   size_t relative_start_index;
   if (is_forward) {
     relative_start_index = start_index;
@@ -1,38 +1,92 @@
 #include "tracing/node_trace_buffer.h"
 
+#include <algorithm>
 #include <memory>
+#include <thread>  // NOLINT(build/c++11)
 #include "util-inl.h"
 
 namespace node {
 namespace tracing {
 
+namespace {
+
+// The chunk the current thread fills in each of the two buffers of a
+// NodeTraceBuffer, which get consecutive instance numbers.
+struct ThreadChunk {
+  uint64_t buffer;
+  uint32_t epoch;
+  size_t index;
+};
+
+thread_local ThreadChunk thread_chunks[2];
+std::atomic<uint64_t> next_buffer_instance {1};
+
+}  // namespace
+
 InternalTraceBuffer::InternalTraceBuffer(size_t max_chunks, uint32_t id,
                                          Agent* agent)
     : flushing_(false), max_chunks_(max_chunks),
-      agent_(agent), id_(id) {
-  chunks_.resize(max_chunks);
-}
+      agent_(agent), slots_(new ChunkSlot[max_chunks]), next_chunk_(0),
+      epoch_(1), current_chunk_seq_(1), id_(id),
+      instance_(next_buffer_instance.fetch_add(1)) {}
 
 TraceObject* InternalTraceBuffer::AddTraceEvent(uint64_t* handle) {
-  Mutex::ScopedLock scoped_lock(mutex_);
-  // Create new chunk if last chunk is full or there is no chunk.
-  if (total_chunks_ == 0 || chunks_[total_chunks_ - 1]->IsFull()) {
-    auto& chunk = chunks_[total_chunks_++];
-    if (chunk) {
-      chunk->Reset(current_chunk_seq_++);
-    } else {
-      chunk = std::make_unique<TraceBufferChunk>(current_chunk_seq_++);
+  ThreadChunk& cached = thread_chunks[instance_ % 2];
+  for (;;) {
+    uint32_t epoch = epoch_.load(std::memory_order_acquire);
+    if (cached.buffer != instance_ || cached.epoch != epoch) {
+      size_t index = next_chunk_.fetch_add(1, std::memory_order_seq_cst);
+      if (index >= max_chunks_) {
+        *handle = 0;
+        return nullptr;
+      }
+      cached = ThreadChunk { instance_, epoch, index };
+    }
+
+    ChunkSlot& slot = slots_[cached.index];
+    // Pairs with Flush(): either it sees the slot busy and waits, or we see
+    // the flush and stay away from the chunk.
+    slot.busy.fetch_add(1, std::memory_order_seq_cst);
+    if (flushing_.load(std::memory_order_seq_cst)) {
+      // Wait for the flush to finish instead of dropping the event, as adding
+      // events did when they took the buffer's lock. The flush has reset the
+      // chunks by the time the lock is free, so this claims one anew.
+      slot.busy.fetch_sub(1, std::memory_order_release);
+      Mutex::ScopedLock wait_for_flush(flush_mutex_);
+      continue;
+    }
+    if (epoch_.load(std::memory_order_seq_cst) != epoch) {
+      // Flushed since the chunk was claimed.
+      slot.busy.fetch_sub(1, std::memory_order_release);
+      cached.buffer = 0;
+      continue;
+    }
+
+    if (slot.epoch.load(std::memory_order_relaxed) != epoch) {
+      uint32_t seq = current_chunk_seq_.fetch_add(1, std::memory_order_relaxed);
+      if (slot.chunk) {
+        slot.chunk->Reset(seq);
+      } else {
+        slot.chunk = std::make_unique<TraceBufferChunk>(seq);
+      }
+      slot.seq.store(seq, std::memory_order_release);
+      slot.epoch.store(epoch, std::memory_order_release);
+    }
+    TraceBufferChunk* chunk = slot.chunk.get();
+    if (chunk->IsFull()) {
+      slot.busy.fetch_sub(1, std::memory_order_release);
+      cached.buffer = 0;
+      continue;
     }
+    size_t event_index;
+    TraceObject* trace_object = chunk->AddTraceEvent(&event_index);
+    *handle = MakeHandle(cached.index, chunk->seq(), event_index);
+    slot.busy.fetch_sub(1, std::memory_order_release);
+    return trace_object;
   }
-  auto& chunk = chunks_[total_chunks_ - 1];
-  size_t event_index;
-  TraceObject* trace_object = chunk->AddTraceEvent(&event_index);
-  *handle = MakeHandle(total_chunks_ - 1, chunk->seq(), event_index);
-  return trace_object;
 }
 
 TraceObject* InternalTraceBuffer::GetEventByHandle(uint64_t handle) {
-  Mutex::ScopedLock scoped_lock(mutex_);
   if (handle == 0) {
     // A handle value of zero never has a trace event associated with it.
     return nullptr;
@@ -40,40 +94,50 @@ TraceObject* InternalTraceBuffer::GetEventByHandle(uint64_t handle) {
   size_t chunk_index, event_index;
   uint32_t buffer_id, chunk_seq;
   ExtractHandle(handle, &buffer_id, &chunk_index, &chunk_seq, &event_index);
-  if (buffer_id != id_ || chunk_index >= total_chunks_) {
-    // Either the chunk belongs to the other buffer, or is outside the current
-    // range of chunks loaded in memory (the latter being true suggests that
-    // the chunk has already been flushed and is no longer in memory.)
+  if (buffer_id != id_ || chunk_index >= max_chunks_) {
+    // The chunk belongs to the other buffer.
     return nullptr;
   }
-  auto& chunk = chunks_[chunk_index];
-  if (chunk->seq() != chunk_seq) {
-    // Chunk is no longer in memory.
+  ChunkSlot& slot = slots_[chunk_index];
+  if (slot.seq.load(std::memory_order_acquire) != chunk_seq ||
+      slot.epoch.load(std::memory_order_acquire) !=
+          epoch_.load(std::memory_order_acquire)) {
+    // The chunk has been flushed, and possibly reused, since.
     return nullptr;
   }
-  return chunk->GetEventAt(event_index);
+  return slot.chunk->GetEventAt(event_index);
 }
 
 void InternalTraceBuffer::Flush(bool blocking) {
   {
-    Mutex::ScopedLock scoped_lock(mutex_);
-    if (total_chunks_ > 0) {
-      flushing_ = true;
-      for (size_t i = 0; i < total_chunks_; ++i) {
-        auto& chunk = chunks_[i];
-        for (size_t j = 0; j < chunk->size(); ++j) {
-          TraceObject* trace_event = chunk->GetEventAt(j);
-          // Another thread may have added a trace that is yet to be
-          // initialized. Skip such traces.
-          // https://github.com/nodejs/node/issues/21038.
-          if (trace_event->name()) {
-            agent_->AppendTraceEvent(trace_event);
-          }
+    Mutex::ScopedLock scoped_lock(flush_mutex_);
+    flushing_.store(true, std::memory_order_seq_cst);
+    uint32_t epoch = epoch_.load(std::memory_order_relaxed);
+    size_t chunks = std::min(next_chunk_.load(std::memory_order_seq_cst),
+                             max_chunks_);
+    for (size_t i = 0; i < chunks; ++i) {
+      ChunkSlot& slot = slots_[i];
+      while (slot.busy.load(std::memory_order_seq_cst) != 0)
+        std::this_thread::yield();
+      // Claimed, but the flush started before the owner got to reset it.
+      if (slot.epoch.load(std::memory_order_acquire) != epoch)
+        continue;
+      TraceBufferChunk* chunk = slot.chunk.get();
+      for (size_t j = 0; j < chunk->size(); ++j) {
+        TraceObject* trace_event = chunk->GetEventAt(j);
+        // Another thread may have added a trace that is yet to be
+        // initialized. Skip such traces.
+        // https://github.com/nodejs/node/issues/21038.
+        if (trace_event->name()) {
+          agent_->AppendTraceEvent(trace_event);
         }
       }
-      total_chunks_ = 0;
-      flushing_ = false;
     }
+    // Chunk indices are handed out anew for the next epoch; a thread that
+    // claimed one before the epoch moves on sees the change and claims again.
+    next_chunk_.store(0, std::memory_order_seq_cst);
+    epoch_.fetch_add(1, std::memory_order_seq_cst);
+    flushing_.store(false, std::memory_order_seq_cst);
   }
   agent_->Flush(blocking);
 }
@@ -129,7 +193,11 @@ TraceObject* NodeTraceBuffer::AddTraceEvent(uint64_t* handle) {
     *handle = 0;
     return nullptr;
   }
-  return current_buf_.load()->AddTraceEvent(handle);
+  TraceObject* trace_object = current_buf_.load()->AddTraceEvent(handle);
+  // Other threads may have claimed the last chunks in the meantime.
+  if (trace_object == nullptr && TryLoadAvailableBuffer())
+    trace_object = current_buf_.load()->AddTraceEvent(handle);
+  return trace_object;
 }
 
 TraceObject* NodeTraceBuffer::GetEventByHandle(uint64_t handle) {
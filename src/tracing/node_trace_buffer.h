@@ -6,6 +6,7 @@
 #include "libplatform/v8-tracing.h"
 
 #include <atomic>
+#include <memory>
 
 namespace node {
 namespace tracing {
@@ -17,6 +18,12 @@ using v8::platform::tracing::TraceObject;
 // forward declaration
 class NodeTraceBuffer;
 
+// Recording threads each claim a chunk of their own and fill it without
+// taking a lock. Claiming a chunk is one atomic increment per
+// TraceBufferChunk::kChunkSize events, and Flush() waits for the owners that
+// are in the middle of adding an event before it reads their chunks. Threads
+// that add an event while a flush runs wait for it to finish; events are only
+// dropped when the buffer is full.
 class InternalTraceBuffer {
  public:
   InternalTraceBuffer(size_t max_chunks, uint32_t id, Agent* agent);
@@ -25,27 +32,44 @@ class InternalTraceBuffer {
   TraceObject* GetEventByHandle(uint64_t handle);
   void Flush(bool blocking);
   bool IsFull() const {
-    return total_chunks_ == max_chunks_ && chunks_[total_chunks_ - 1]->IsFull();
+    return next_chunk_.load(std::memory_order_relaxed) >= max_chunks_;
   }
   bool IsFlushing() const {
-    return flushing_;
+    return flushing_.load(std::memory_order_relaxed);
   }
 
  private:
+  struct alignas(64) ChunkSlot {
+    std::unique_ptr<TraceBufferChunk> chunk;
+    // The chunk's sequence number and the flush epoch it was reset for,
+    // published after the reset so that other threads can check handles.
+    std::atomic<uint32_t> seq {0};
+    std::atomic<uint32_t> epoch {0};
+    // Threads in the middle of adding an event to the chunk. Besides the
+    // owner, a thread that claimed the index just before a flush reset the
+    // claims can briefly count itself in before it notices and backs off.
+    std::atomic<uint32_t> busy {0};
+  };
+
   uint64_t MakeHandle(size_t chunk_index, uint32_t chunk_seq,
                       size_t event_index) const;
   void ExtractHandle(uint64_t handle, uint32_t* buffer_id, size_t* chunk_index,
                      uint32_t* chunk_seq, size_t* event_index) const;
   size_t Capacity() const { return max_chunks_ * TraceBufferChunk::kChunkSize; }
 
-  Mutex mutex_;
-  bool flushing_;
+  // Serializes flushes of this buffer, adding events never takes it.
+  Mutex flush_mutex_;
+  std::atomic<bool> flushing_;
   size_t max_chunks_;
   Agent* agent_;
-  std::vector<std::unique_ptr<TraceBufferChunk>> chunks_;
-  size_t total_chunks_ = 0;
-  uint32_t current_chunk_seq_ = 1;
+  std::unique_ptr<ChunkSlot[]> slots_;
+  std::atomic<size_t> next_chunk_;
+  // Advanced by every flush, invalidating the chunks threads hold on to.
+  std::atomic<uint32_t> epoch_;
+  std::atomic<uint32_t> current_chunk_seq_;
   uint32_t id_;
+  // Tells this buffer apart in the per-thread chunk caches.
+  uint64_t instance_;
 };
 
 class NodeTraceBuffer : public TraceBuffer {
@@ -8,8 +8,23 @@
 namespace node {
 namespace tracing {
 
+namespace {
+
+bool EndsWith(const std::string& str, const char* suffix) {
+  size_t length = strlen(suffix);
+  return str.size() >= length &&
+         str.compare(str.size() - length, length, suffix) == 0;
+}
+
+}  // namespace
+
 NodeTraceWriter::NodeTraceWriter(const std::string& log_file_pattern)
-    : log_file_pattern_(log_file_pattern) {}
+    : log_file_pattern_(log_file_pattern) {
+  if (EndsWith(log_file_pattern, ".pftrace") ||
+      EndsWith(log_file_pattern, ".perfetto-trace")) {
+    perfetto_ = std::make_unique<PerfettoEncoder>();
+  }
+}
 
 void NodeTraceWriter::InitializeOnThread(uv_loop_t* loop) {
   CHECK_NULL(tracing_loop_);
@@ -98,6 +113,18 @@ void NodeTraceWriter::OpenNewFileForStreaming() {
 
 void NodeTraceWriter::AppendTraceEvent(TraceObject* trace_event) {
   Mutex::ScopedLock scoped_lock(stream_mutex_);
+  if (perfetto_) {
+    if (total_traces_ == 0) {
+      OpenNewFileForStreaming();
+      // A Perfetto trace is a plain sequence of packets, without a header or
+      // a footer, but every file starts over with its interning state.
+      perfetto_->Reset();
+      perfetto_file_open_ = true;
+    }
+    ++total_traces_;
+    perfetto_->AppendTraceEvent(trace_event);
+    return;
+  }
   // If this is the first trace event, open a new file for streaming.
   if (total_traces_ == 0) {
     OpenNewFileForStreaming();
@@ -123,11 +150,17 @@ void NodeTraceWriter::FlushPrivate() {
       // Destroying the member JSONTraceWriter object appends "]}" to
       // stream_ - in other words, ending a JSON file.
       json_trace_writer_.reset();
+      perfetto_file_open_ = false;
+    }
+    if (perfetto_) {
+      // The encoded packets are handed over without copying them.
+      str.swap(*perfetto_->output());
+    } else {
+      // str() makes a copy of the contents of the stream.
+      str = stream_.str();
+      stream_.str("");
+      stream_.clear();
     }
-    // str() makes a copy of the contents of the stream.
-    str = stream_.str();
-    stream_.str("");
-    stream_.clear();
   }
   {
     Mutex::ScopedLock request_scoped_lock(request_mutex_);
@@ -143,7 +176,7 @@ void NodeTraceWriter::Flush(bool blocking) {
     // protects json_trace_writer_, and without request_mutex_ there might be
     // a time window in which the stream state changes?
     Mutex::ScopedLock stream_mutex_lock(stream_mutex_);
-    if (!json_trace_writer_)
+    if (!HasOpenTraceFile())
       return;
   }
   int request_id = ++num_write_requests_;
@@ -159,6 +192,10 @@ void NodeTraceWriter::Flush(bool blocking) {
   }
 }
 
+bool NodeTraceWriter::HasOpenTraceFile() const {
+  return perfetto_ ? perfetto_file_open_ : json_trace_writer_ != nullptr;
+}
+
 void NodeTraceWriter::WriteToFile(std::string&& str, int highest_request_id) {
   if (fd_ == -1) return;
 
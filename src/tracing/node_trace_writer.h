@@ -6,6 +6,7 @@
 
 #include "libplatform/v8-tracing.h"
 #include "tracing/agent.h"
+#include "tracing/perfetto_encoder.h"
 #include "uv.h"
 
 namespace node {
@@ -14,6 +15,8 @@ namespace tracing {
 using v8::platform::tracing::TraceObject;
 using v8::platform::tracing::TraceWriter;
 
+// Writes trace events to the files named by log_file_pattern, as JSON or, when
+// the pattern ends in .pftrace or .perfetto-trace, as Perfetto protobuf.
 class NodeTraceWriter : public AsyncTraceWriter {
  public:
   explicit NodeTraceWriter(const std::string& log_file_pattern);
@@ -37,6 +40,7 @@ class NodeTraceWriter : public AsyncTraceWriter {
   void WriteToFile(std::string&& str, int highest_request_id);
   void WriteSuffix();
   void FlushPrivate();
+  bool HasOpenTraceFile() const;
   static void ExitSignalCb(uv_async_t* signal);
 
   uv_loop_t* tracing_loop_ = nullptr;
@@ -46,7 +50,7 @@ class NodeTraceWriter : public AsyncTraceWriter {
   uv_async_t exit_signal_;
   // Prevents concurrent R/W on state related to serialized trace data
   // before it's written to disk, namely stream_ and total_traces_
-  // as well as json_trace_writer_.
+  // as well as json_trace_writer_ and perfetto_.
   Mutex stream_mutex_;
   // Prevents concurrent R/W on state related to write requests.
   // If both mutexes are locked, request_mutex_ has to be locked first.
@@ -66,6 +70,9 @@ class NodeTraceWriter : public AsyncTraceWriter {
   std::string log_file_pattern_;
   std::ostringstream stream_;
   std::unique_ptr<TraceWriter> json_trace_writer_;
+  // Set in Perfetto mode, which bypasses stream_ and json_trace_writer_.
+  std::unique_ptr<PerfettoEncoder> perfetto_;
+  bool perfetto_file_open_ = false;
   bool exited_ = false;
 };
 
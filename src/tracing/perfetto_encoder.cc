@@ -0,0 +1,391 @@
+#include "tracing/perfetto_encoder.h"
+
+#include "tracing/trace_event_common.h"
+#include "util.h"
+
+#include <cstring>
+
+namespace node {
+namespace tracing {
+
+using v8::ConvertableToTraceFormat;
+
+namespace {
+
+// Field numbers from perfetto/trace/trace_packet.proto and the messages it
+// nests. Only what trace events map to is listed.
+enum TraceField { kTracePacket = 1 };
+enum TracePacketField {
+  kPacketTimestamp = 8,
+  kPacketSequenceId = 10,
+  kPacketTrackEvent = 11,
+  kPacketInternedData = 12,
+  kPacketSequenceFlags = 13,
+  kPacketTimestampClockId = 58,
+  kPacketDefaults = 59,
+  kPacketTrackDescriptor = 60
+};
+enum TrackEventField {
+  kEventCategoryIids = 3,
+  kEventDebugAnnotations = 4,
+  kEventLegacyEvent = 6,
+  kEventType = 9,
+  kEventNameIid = 10,
+  kEventTrackUuid = 11
+};
+enum TrackEventType {
+  kTypeUnspecified = 0,
+  kTypeSliceBegin = 1,
+  kTypeSliceEnd = 2,
+  kTypeInstant = 3
+};
+enum InternedDataField {
+  kInternedCategories = 1,
+  kInternedNames = 2,
+  kInternedArgNames = 3
+};
+enum DebugAnnotationField {
+  kArgNameIid = 1,
+  kArgBool = 2,
+  kArgUint = 3,
+  kArgInt = 4,
+  kArgDouble = 5,
+  kArgString = 6,
+  kArgPointer = 7,
+  kArgJson = 9
+};
+enum LegacyEventField {
+  kLegacyPhase = 2,
+  kLegacyUnscopedId = 6,
+  kLegacyIdScope = 7,
+  kLegacyBindId = 8,
+  kLegacyLocalId = 10,
+  kLegacyGlobalId = 11
+};
+enum TrackDescriptorField {
+  kTrackUuid = 1,
+  kTrackProcess = 3,
+  kTrackThread = 4,
+  kTrackParentUuid = 5
+};
+enum ProcessDescriptorField { kProcessPid = 1, kProcessName = 6 };
+enum ThreadDescriptorField { kThreadPid = 1, kThreadTid = 2, kThreadName = 5 };
+
+enum SequenceFlags {
+  kIncrementalStateCleared = 1,
+  kNeedsIncrementalState = 2
+};
+constexpr uint32_t kSequenceId = 1;
+// uv_hrtime(), which TracingController timestamps come from.
+constexpr uint32_t kBuiltinClockMonotonic = 3;
+
+enum WireType { kVarint = 0, kFixed64 = 1, kLengthDelimited = 2 };
+
+void WriteVarint(std::string* out, uint64_t value) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+void WriteTag(std::string* out, uint32_t field, WireType type) {
+  WriteVarint(out, (static_cast<uint64_t>(field) << 3) | type);
+}
+
+void WriteUint(std::string* out, uint32_t field, uint64_t value) {
+  WriteTag(out, field, kVarint);
+  WriteVarint(out, value);
+}
+
+void WriteInt(std::string* out, uint32_t field, int64_t value) {
+  // int64 fields are plain two's complement varints, not zigzag.
+  WriteUint(out, field, static_cast<uint64_t>(value));
+}
+
+void WriteDouble(std::string* out, uint32_t field, double value) {
+  WriteTag(out, field, kFixed64);
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  for (int i = 0; i < 8; i++)
+    out->push_back(static_cast<char>(bits >> (i * 8)));
+}
+
+void WriteBytes(std::string* out, uint32_t field,
+                const char* data, size_t length) {
+  WriteTag(out, field, kLengthDelimited);
+  WriteVarint(out, length);
+  out->append(data, length);
+}
+
+void WriteString(std::string* out, uint32_t field, const char* str) {
+  WriteBytes(out, field, str, strlen(str));
+}
+
+void WriteMessage(std::string* out, uint32_t field, const std::string& msg) {
+  WriteBytes(out, field, msg.data(), msg.size());
+}
+
+uint64_t ProcessTrackUuid(int pid) {
+  return (static_cast<uint64_t>(static_cast<uint32_t>(pid)) << 32) |
+         0xffffffffu;
+}
+
+}  // namespace
+
+void PerfettoEncoder::Reset() {
+  started_ = false;
+  names_.clear();
+  name_pointers_.clear();
+  categories_.clear();
+  category_pointers_.clear();
+  arg_names_.clear();
+  arg_name_pointers_.clear();
+  process_tracks_.clear();
+  thread_tracks_.clear();
+}
+
+uint64_t PerfettoEncoder::Intern(const char* str, bool copied,
+                                 int interned_field, InternTable* table,
+                                 PointerInternTable* pointer_table) {
+  // Strings that are not copied into the event are static, so their address
+  // identifies them without hashing the contents.
+  if (!copied) {
+    auto it = pointer_table->find(str);
+    if (it != pointer_table->end())
+      return it->second;
+  }
+  uint64_t iid;
+  auto it = table->find(str);
+  if (it != table->end()) {
+    iid = it->second;
+  } else {
+    iid = table->size() + 1;
+    table->emplace(str, iid);
+    // New on this sequence, so the packet that uses it defines it.
+    entry_.clear();
+    WriteUint(&entry_, 1, iid);
+    WriteString(&entry_, 2, str);
+    WriteMessage(&interned_, interned_field, entry_);
+  }
+  if (!copied)
+    pointer_table->emplace(str, iid);
+  return iid;
+}
+
+uint64_t PerfettoEncoder::ThreadTrack(int pid, int tid) {
+  uint64_t uuid = (static_cast<uint64_t>(static_cast<uint32_t>(pid)) << 32) |
+                  static_cast<uint32_t>(tid);
+  if (thread_tracks_.count(uuid) > 0)
+    return uuid;
+  thread_tracks_.insert(uuid);
+
+  if (process_tracks_.insert(pid).second) {
+    nested_.clear();
+    WriteInt(&nested_, kProcessPid, pid);
+    packet_.clear();
+    WriteUint(&packet_, kTrackUuid, ProcessTrackUuid(pid));
+    WriteMessage(&packet_, kTrackProcess, nested_);
+    nested_.swap(packet_);
+    packet_.clear();
+    WriteMessage(&packet_, kPacketTrackDescriptor, nested_);
+    WriteMessage(&output_, kTracePacket, packet_);
+  }
+
+  nested_.clear();
+  WriteInt(&nested_, kThreadPid, pid);
+  WriteInt(&nested_, kThreadTid, tid);
+  packet_.clear();
+  WriteUint(&packet_, kTrackUuid, uuid);
+  WriteUint(&packet_, kTrackParentUuid, ProcessTrackUuid(pid));
+  WriteMessage(&packet_, kTrackThread, nested_);
+  nested_.swap(packet_);
+  packet_.clear();
+  WriteMessage(&packet_, kPacketTrackDescriptor, nested_);
+  WriteMessage(&output_, kTracePacket, packet_);
+  return uuid;
+}
+
+void PerfettoEncoder::WriteMetadata(TraceObject* trace_event) {
+  // Thread and process names become track names, other metadata has no
+  // counterpart in TrackEvent.
+  bool thread_name = strcmp(trace_event->name(), "thread_name") == 0;
+  bool process_name = strcmp(trace_event->name(), "process_name") == 0;
+  if ((!thread_name && !process_name) || trace_event->num_args() < 1)
+    return;
+  uint8_t type = trace_event->arg_types()[0];
+  if (type != TRACE_VALUE_TYPE_STRING && type != TRACE_VALUE_TYPE_COPY_STRING)
+    return;
+  const char* name = trace_event->arg_values()[0].as_string;
+  if (name == nullptr)
+    return;
+
+  int pid = trace_event->pid();
+  uint64_t uuid = ThreadTrack(pid, trace_event->tid());
+  nested_.clear();
+  WriteInt(&nested_, kThreadPid, pid);
+  packet_.clear();
+  if (thread_name) {
+    WriteInt(&nested_, kThreadTid, trace_event->tid());
+    WriteString(&nested_, kThreadName, name);
+    WriteUint(&packet_, kTrackUuid, uuid);
+    WriteUint(&packet_, kTrackParentUuid, ProcessTrackUuid(pid));
+    WriteMessage(&packet_, kTrackThread, nested_);
+  } else {
+    WriteString(&nested_, kProcessName, name);
+    WriteUint(&packet_, kTrackUuid, ProcessTrackUuid(pid));
+    WriteMessage(&packet_, kTrackProcess, nested_);
+  }
+  nested_.swap(packet_);
+  packet_.clear();
+  WriteMessage(&packet_, kPacketTrackDescriptor, nested_);
+  WriteMessage(&output_, kTracePacket, packet_);
+}
+
+void PerfettoEncoder::WriteArgs(TraceObject* trace_event, bool copied) {
+  const char** arg_names = trace_event->arg_names();
+  const uint8_t* arg_types = trace_event->arg_types();
+  TraceObject::ArgValue* arg_values = trace_event->arg_values();
+  std::unique_ptr<ConvertableToTraceFormat>* arg_convertables =
+      trace_event->arg_convertables();
+  for (int i = 0; i < trace_event->num_args(); i++) {
+    uint64_t name_iid = Intern(arg_names[i], copied, kInternedArgNames,
+                               &arg_names_, &arg_name_pointers_);
+    nested_.clear();
+    WriteUint(&nested_, kArgNameIid, name_iid);
+    TraceObject::ArgValue value = arg_values[i];
+    switch (arg_types[i]) {
+      case TRACE_VALUE_TYPE_BOOL:
+        WriteUint(&nested_, kArgBool, value.as_uint ? 1 : 0);
+        break;
+      case TRACE_VALUE_TYPE_UINT:
+        WriteUint(&nested_, kArgUint, value.as_uint);
+        break;
+      case TRACE_VALUE_TYPE_INT:
+        WriteInt(&nested_, kArgInt, value.as_int);
+        break;
+      case TRACE_VALUE_TYPE_DOUBLE:
+        WriteDouble(&nested_, kArgDouble, value.as_double);
+        break;
+      case TRACE_VALUE_TYPE_POINTER:
+        WriteUint(&nested_, kArgPointer,
+                  reinterpret_cast<uintptr_t>(value.as_pointer));
+        break;
+      case TRACE_VALUE_TYPE_STRING:
+      case TRACE_VALUE_TYPE_COPY_STRING:
+        WriteString(&nested_, kArgString,
+                    value.as_string != nullptr ? value.as_string : "nullptr");
+        break;
+      case TRACE_VALUE_TYPE_CONVERTABLE: {
+        std::string json;
+        arg_convertables[i]->AppendAsTraceFormat(&json);
+        WriteBytes(&nested_, kArgJson, json.data(), json.size());
+        break;
+      }
+      default:
+        UNREACHABLE();
+    }
+    WriteMessage(&event_, kEventDebugAnnotations, nested_);
+  }
+}
+
+void PerfettoEncoder::WritePacket(uint64_t timestamp_us,
+                                  bool needs_interned_state) {
+  packet_.clear();
+  WriteUint(&packet_, kPacketTimestamp, timestamp_us * 1000);
+  WriteUint(&packet_, kPacketSequenceId, kSequenceId);
+  if (needs_interned_state)
+    WriteUint(&packet_, kPacketSequenceFlags, kNeedsIncrementalState);
+  if (!interned_.empty())
+    WriteMessage(&packet_, kPacketInternedData, interned_);
+  WriteMessage(&packet_, kPacketTrackEvent, event_);
+  WriteMessage(&output_, kTracePacket, packet_);
+}
+
+void PerfettoEncoder::AppendTraceEvent(TraceObject* trace_event) {
+  if (!started_) {
+    // Opens the sequence: no interned state yet, and every timestamp that
+    // follows is in the monotonic clock.
+    started_ = true;
+    nested_.clear();
+    WriteUint(&nested_, kPacketTimestampClockId, kBuiltinClockMonotonic);
+    packet_.clear();
+    WriteUint(&packet_, kPacketSequenceId, kSequenceId);
+    WriteUint(&packet_, kPacketSequenceFlags, kIncrementalStateCleared);
+    WriteMessage(&packet_, kPacketDefaults, nested_);
+    WriteMessage(&output_, kTracePacket, packet_);
+  }
+
+  char phase = trace_event->phase();
+  if (phase == TRACE_EVENT_PHASE_METADATA) {
+    WriteMetadata(trace_event);
+    return;
+  }
+
+  bool copied = (trace_event->flags() & TRACE_EVENT_FLAG_COPY) != 0;
+  uint64_t track = ThreadTrack(trace_event->pid(), trace_event->tid());
+
+  TrackEventType type;
+  switch (phase) {
+    case TRACE_EVENT_PHASE_BEGIN:
+    case TRACE_EVENT_PHASE_COMPLETE:
+      type = kTypeSliceBegin;
+      break;
+    case TRACE_EVENT_PHASE_END:
+      type = kTypeSliceEnd;
+      break;
+    case TRACE_EVENT_PHASE_INSTANT:
+    case TRACE_EVENT_PHASE_MARK:
+      type = kTypeInstant;
+      break;
+    default:
+      // Async, flow, counter and object events keep their JSON phase.
+      type = kTypeUnspecified;
+  }
+
+  event_.clear();
+  interned_.clear();
+  const char* category =
+      v8::platform::tracing::TracingController::GetCategoryGroupName(
+          trace_event->category_enabled_flag());
+  WriteUint(&event_, kEventCategoryIids,
+            Intern(category, false, kInternedCategories,
+                   &categories_, &category_pointers_));
+  WriteUint(&event_, kEventNameIid,
+            Intern(trace_event->name(), copied, kInternedNames,
+                   &names_, &name_pointers_));
+  if (type != kTypeUnspecified)
+    WriteUint(&event_, kEventType, type);
+  WriteUint(&event_, kEventTrackUuid, track);
+  WriteArgs(trace_event, copied);
+
+  if (type == kTypeUnspecified) {
+    unsigned int flags = trace_event->flags();
+    nested_.clear();
+    WriteInt(&nested_, kLegacyPhase, phase);
+    if (flags & TRACE_EVENT_FLAG_HAS_LOCAL_ID) {
+      WriteUint(&nested_, kLegacyLocalId, trace_event->id());
+    } else if (flags & TRACE_EVENT_FLAG_HAS_GLOBAL_ID) {
+      WriteUint(&nested_, kLegacyGlobalId, trace_event->id());
+    } else if (flags & TRACE_EVENT_FLAG_HAS_ID) {
+      WriteUint(&nested_, kLegacyUnscopedId, trace_event->id());
+    }
+    if (trace_event->scope() != nullptr)
+      WriteString(&nested_, kLegacyIdScope, trace_event->scope());
+    if (trace_event->bind_id() != 0)
+      WriteUint(&nested_, kLegacyBindId, trace_event->bind_id());
+    WriteMessage(&event_, kEventLegacyEvent, nested_);
+  }
+  WritePacket(trace_event->ts(), true);
+
+  if (phase == TRACE_EVENT_PHASE_COMPLETE) {
+    event_.clear();
+    interned_.clear();
+    WriteUint(&event_, kEventType, kTypeSliceEnd);
+    WriteUint(&event_, kEventTrackUuid, track);
+    WritePacket(trace_event->ts() + trace_event->duration(), true);
+  }
+}
+
+}  // namespace tracing
+}  // namespace node
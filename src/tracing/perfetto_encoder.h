@@ -0,0 +1,63 @@
+#ifndef SRC_TRACING_PERFETTO_ENCODER_H_
+#define SRC_TRACING_PERFETTO_ENCODER_H_
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "libplatform/v8-tracing.h"
+
+namespace node {
+namespace tracing {
+
+using v8::platform::tracing::TraceObject;
+
+// Encodes trace events as a stream of Perfetto TracePacket protos, which is
+// what a Perfetto trace file consists of. Event names, categories and
+// argument names are interned, so a repeated event takes a few bytes for its
+// timestamp, track and interning ids. Not thread-safe; NodeTraceWriter
+// serializes calls.
+class PerfettoEncoder {
+ public:
+  // Starts a new trace file, which has to carry its own interning state and
+  // track descriptors.
+  void Reset();
+  void AppendTraceEvent(TraceObject* trace_event);
+
+  // Encoded packets not handed out yet. Callers swap them out.
+  std::string* output() { return &output_; }
+
+ private:
+  using InternTable = std::unordered_map<std::string, uint64_t>;
+  using PointerInternTable = std::unordered_map<const char*, uint64_t>;
+
+  uint64_t Intern(const char* str, bool copied, int interned_field,
+                  InternTable* table, PointerInternTable* pointer_table);
+  uint64_t ThreadTrack(int pid, int tid);
+  void WriteMetadata(TraceObject* trace_event);
+  void WriteArgs(TraceObject* trace_event, bool copied);
+  void WritePacket(uint64_t timestamp_us, bool needs_interned_state);
+
+  std::string output_;
+  // Scratch space for the nested messages of the packet being encoded.
+  std::string packet_;
+  std::string event_;
+  std::string nested_;
+  std::string interned_;
+  std::string entry_;
+
+  bool started_ = false;
+  InternTable names_;
+  PointerInternTable name_pointers_;
+  InternTable categories_;
+  PointerInternTable category_pointers_;
+  InternTable arg_names_;
+  PointerInternTable arg_name_pointers_;
+  std::unordered_set<int> process_tracks_;
+  std::unordered_set<uint64_t> thread_tracks_;
+};
+
+}  // namespace tracing
+}  // namespace node
+
+#endif  // SRC_TRACING_PERFETTO_ENCODER_H_
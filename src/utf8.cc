@@ -0,0 +1,1196 @@
+#include "utf8.h"
+#include "util.h"
+
+#include <algorithm>
+#include <cstring>
+
+// GCC and clang compile the x86 kernel for SSSE3 through a target attribute
+// and check the CPU at runtime. Other compilers use the scalar code on x86.
+// AArch64 always has NEON.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NODE_UTF8_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define NODE_UTF8_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(NODE_UTF8_X86) || defined(NODE_UTF8_NEON)
+#define NODE_UTF8_SIMD 1
+#endif
+
+namespace node {
+namespace utf8 {
+
+namespace {
+
+inline bool IsContinuation(uint8_t c) {
+  return (c & 0xc0) == 0x80;
+}
+
+inline bool IsSurrogate(uint16_t c) {
+  return (c & 0xf800) == 0xd800;
+}
+
+inline bool IsLeadSurrogate(uint16_t c) {
+  return (c & 0xfc00) == 0xd800;
+}
+
+inline bool IsTrailSurrogate(uint16_t c) {
+  return (c & 0xfc00) == 0xdc00;
+}
+
+// UTF-16 code units the byte accounts for in well-formed UTF-8: one for the
+// first byte of every character and another one for the lead of a 4 byte
+// sequence, which becomes a surrogate pair.
+inline size_t Utf16UnitsOf(uint8_t c) {
+  return !IsContinuation(c) + (c >= 0xf0);
+}
+
+// The kernels only count the bits of 16 bit masks. __builtin_popcount turns
+// into a libgcc call unless the whole file is built for POPCNT, which SSSE3
+// does not imply.
+inline uint32_t PopCount16(uint32_t v) {
+  v = v - ((v >> 1) & 0x5555);
+  v = (v & 0x3333) + ((v >> 2) & 0x3333);
+  v = (v + (v >> 4)) & 0x0f0f;
+  return (v + (v >> 8)) & 0x1f;
+}
+
+size_t AsciiPrefixScalar(const uint8_t* s, size_t i, size_t length) {
+  for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, s + i, sizeof(word));
+    if (word & 0x8080808080808080ull)
+      break;
+  }
+  while (i < length && s[i] < 0x80)
+    i++;
+  return i;
+}
+
+bool ValidateScalar(const uint8_t* s, size_t length,
+                    size_t* utf16_length, bool* latin1) {
+  size_t units = 0;
+  bool only_latin1 = true;
+  size_t i = 0;
+  while (i < length) {
+    const uint8_t c = s[i];
+    if (c < 0x80) {
+      i += 1;
+      units += 1;
+      continue;
+    }
+    if (c < 0xc2)  // Continuation or overlong 2 byte form.
+      return false;
+    if (c < 0xe0) {
+      if (i + 1 >= length || !IsContinuation(s[i + 1]))
+        return false;
+      only_latin1 = only_latin1 && c < 0xc4;
+      i += 2;
+      units += 1;
+      continue;
+    }
+    only_latin1 = false;
+    if (c < 0xf0) {
+      if (i + 2 >= length)
+        return false;
+      const uint8_t c1 = s[i + 1];
+      if (!IsContinuation(c1) || !IsContinuation(s[i + 2]))
+        return false;
+      if ((c == 0xe0 && c1 < 0xa0) ||  // Overlong.
+          (c == 0xed && c1 >= 0xa0))   // Surrogate.
+        return false;
+      i += 3;
+      units += 1;
+      continue;
+    }
+    if (c < 0xf5) {
+      if (i + 3 >= length)
+        return false;
+      const uint8_t c1 = s[i + 1];
+      if (!IsContinuation(c1) || !IsContinuation(s[i + 2]) ||
+          !IsContinuation(s[i + 3]))
+        return false;
+      if ((c == 0xf0 && c1 < 0x90) ||  // Overlong.
+          (c == 0xf4 && c1 >= 0x90))   // Past U+10FFFF.
+        return false;
+      i += 4;
+      units += 2;
+      continue;
+    }
+    return false;
+  }
+  *utf16_length = units;
+  *latin1 = only_latin1;
+  return true;
+}
+
+// Finishes a validation the vectorized code did up to i. Its blocks only
+// check the bytes they hold, so a sequence that starts in the last block and
+// ends past it is validated again from its lead byte.
+bool FinishValidation(const uint8_t* s, size_t length, size_t i,
+                      size_t units, bool only_latin1,
+                      size_t* utf16_length, bool* latin1) {
+  size_t j = i;
+  while (j > 0 && i - j < 3 && IsContinuation(s[j - 1]))
+    j--;
+  if (j > 0 && s[j - 1] >= 0xc0)
+    j--;
+  for (size_t p = j; p < i; p++)
+    units -= Utf16UnitsOf(s[p]);
+  size_t tail_units;
+  bool tail_latin1;
+  if (!ValidateScalar(s + j, length - j, &tail_units, &tail_latin1))
+    return false;
+  *utf16_length = units + tail_units;
+  *latin1 = only_latin1 && tail_latin1;
+  return true;
+}
+
+// Decodes the well-formed sequence at s + *i.
+inline uint32_t DecodeScalar(const uint8_t* s, size_t* i) {
+  const uint32_t c = s[*i];
+  if (c < 0x80) {
+    *i += 1;
+    return c;
+  }
+  if (c < 0xe0) {
+    const uint32_t cp = (c & 0x1f) << 6 | (s[*i + 1] & 0x3f);
+    *i += 2;
+    return cp;
+  }
+  if (c < 0xf0) {
+    const uint32_t cp = (c & 0x0f) << 12 | (s[*i + 1] & 0x3f) << 6 |
+                        (s[*i + 2] & 0x3f);
+    *i += 3;
+    return cp;
+  }
+  const uint32_t cp = (c & 0x07) << 18 | (s[*i + 1] & 0x3f) << 12 |
+                      (s[*i + 2] & 0x3f) << 6 | (s[*i + 3] & 0x3f);
+  *i += 4;
+  return cp;
+}
+
+void ConvertToLatin1Scalar(const uint8_t* s, size_t end,
+                           size_t* i, char* dst, size_t* k) {
+  while (*i < end)
+    dst[(*k)++] = static_cast<char>(DecodeScalar(s, i));
+}
+
+void ConvertToUtf16Scalar(const uint8_t* s, size_t end,
+                          size_t* i, uint16_t* dst, size_t* k) {
+  while (*i < end) {
+    const uint32_t cp = DecodeScalar(s, i);
+    if (cp < 0x10000) {
+      dst[(*k)++] = static_cast<uint16_t>(cp);
+    } else {
+      dst[(*k)++] = static_cast<uint16_t>(0xd7c0 + (cp >> 10));
+      dst[(*k)++] = static_cast<uint16_t>(0xdc00 + (cp & 0x3ff));
+    }
+  }
+}
+
+size_t Latin1LengthScalar(const uint8_t* src, size_t i, size_t length) {
+  size_t bytes = 0;
+  for (; i < length; i++)
+    bytes += 1 + (src[i] >> 7);
+  return bytes;
+}
+
+size_t Utf16LengthScalar(const uint16_t* src, size_t length,
+                         size_t end, size_t* i) {
+  size_t bytes = 0;
+  while (*i < end) {
+    const uint16_t c = src[*i];
+    if (c < 0x80) {
+      bytes += 1;
+    } else if (c < 0x800) {
+      bytes += 2;
+    } else if (IsLeadSurrogate(c) && *i + 1 < length &&
+               IsTrailSurrogate(src[*i + 1])) {
+      bytes += 4;
+      *i += 1;
+    } else {
+      bytes += 3;
+    }
+    *i += 1;
+  }
+  return bytes;
+}
+
+// Encode src[*i] into dst + *k if it fits and return whether it did.
+inline bool EncodeLatin1Scalar(const uint8_t* src, size_t* i,
+                               uint8_t* dst, size_t dstlen, size_t* k) {
+  const uint8_t c = src[*i];
+  if (c < 0x80) {
+    if (*k == dstlen)
+      return false;
+    dst[(*k)++] = c;
+  } else {
+    if (dstlen - *k < 2)
+      return false;
+    dst[(*k)++] = 0xc0 | (c >> 6);
+    dst[(*k)++] = 0x80 | (c & 0x3f);
+  }
+  *i += 1;
+  return true;
+}
+
+inline bool EncodeUtf16Scalar(const uint16_t* src, size_t length, size_t* i,
+                              uint8_t* dst, size_t dstlen, size_t* k) {
+  uint32_t c = src[*i];
+  if (c < 0x80) {
+    if (*k == dstlen)
+      return false;
+    dst[(*k)++] = static_cast<uint8_t>(c);
+    *i += 1;
+    return true;
+  }
+  if (c < 0x800) {
+    if (dstlen - *k < 2)
+      return false;
+    dst[(*k)++] = 0xc0 | (c >> 6);
+    dst[(*k)++] = 0x80 | (c & 0x3f);
+    *i += 1;
+    return true;
+  }
+  if (IsLeadSurrogate(c) && *i + 1 < length && IsTrailSurrogate(src[*i + 1])) {
+    if (dstlen - *k < 4)
+      return false;
+    const uint32_t cp = 0x10000 + ((c - 0xd800) << 10) + (src[*i + 1] - 0xdc00);
+    dst[(*k)++] = 0xf0 | (cp >> 18);
+    dst[(*k)++] = 0x80 | ((cp >> 12) & 0x3f);
+    dst[(*k)++] = 0x80 | ((cp >> 6) & 0x3f);
+    dst[(*k)++] = 0x80 | (cp & 0x3f);
+    *i += 2;
+    return true;
+  }
+  if (IsSurrogate(c))
+    c = 0xfffd;
+  if (dstlen - *k < 3)
+    return false;
+  dst[(*k)++] = 0xe0 | (c >> 12);
+  dst[(*k)++] = 0x80 | ((c >> 6) & 0x3f);
+  dst[(*k)++] = 0x80 | (c & 0x3f);
+  *i += 1;
+  return true;
+}
+
+bool FromLatin1Scalar(const uint8_t* src, size_t end, size_t* i,
+                        uint8_t* dst, size_t dstlen, size_t* k) {
+  while (*i < end) {
+    if (!EncodeLatin1Scalar(src, i, dst, dstlen, k))
+      return false;
+  }
+  return true;
+}
+
+bool FromUtf16Scalar(const uint16_t* src, size_t length, size_t end,
+                       size_t* i, uint8_t* dst, size_t dstlen, size_t* k) {
+  while (*i < end) {
+    if (!EncodeUtf16Scalar(src, length, i, dst, dstlen, k))
+      return false;
+  }
+  return true;
+}
+
+#ifdef NODE_UTF8_SIMD
+
+// Lookup tables of the validation algorithm from John Keiser and Daniel
+// Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte". Every
+// pair of adjacent bytes is looked up by the high nibble of the first byte,
+// the low nibble of the first byte and the high nibble of the second byte;
+// a bit that is set in all three results marks an error.
+constexpr uint8_t kTooShort = 1 << 0;
+constexpr uint8_t kTooLong = 1 << 1;
+constexpr uint8_t kOverlong3 = 1 << 2;
+constexpr uint8_t kTooLarge = 1 << 3;
+constexpr uint8_t kSurrogate = 1 << 4;
+constexpr uint8_t kOverlong2 = 1 << 5;
+constexpr uint8_t kTooLarge1000 = 1 << 6;
+constexpr uint8_t kOverlong4 = 1 << 6;
+constexpr uint8_t kTwoConts = 1 << 7;
+constexpr uint8_t kCarry = kTooShort | kTooLong | kTwoConts;
+
+alignas(16) constexpr uint8_t kByte1High[16] = {
+  // 0_______ ________
+  kTooLong, kTooLong, kTooLong, kTooLong,
+  kTooLong, kTooLong, kTooLong, kTooLong,
+  // 10______ ________
+  kTwoConts, kTwoConts, kTwoConts, kTwoConts,
+  // 1100____ ________
+  kTooShort | kOverlong2,
+  // 1101____ ________
+  kTooShort,
+  // 1110____ ________
+  kTooShort | kOverlong3 | kSurrogate,
+  // 1111____ ________
+  kTooShort | kTooLarge | kTooLarge1000 | kOverlong4
+};
+
+alignas(16) constexpr uint8_t kByte1Low[16] = {
+  // ____0000 ________
+  kCarry | kOverlong3 | kOverlong2 | kOverlong4,
+  // ____0001 ________
+  kCarry | kOverlong2,
+  // ____001_ ________
+  kCarry,
+  kCarry,
+  // ____0100 ________
+  kCarry | kTooLarge,
+  // ____0101 ________
+  kCarry | kTooLarge | kTooLarge1000,
+  // ____011_ ________
+  kCarry | kTooLarge | kTooLarge1000,
+  kCarry | kTooLarge | kTooLarge1000,
+  // ____1___ ________
+  kCarry | kTooLarge | kTooLarge1000,
+  kCarry | kTooLarge | kTooLarge1000,
+  kCarry | kTooLarge | kTooLarge1000,
+  kCarry | kTooLarge | kTooLarge1000,
+  kCarry | kTooLarge | kTooLarge1000,
+  // ____1101 ________
+  kCarry | kTooLarge | kTooLarge1000 | kSurrogate,
+  kCarry | kTooLarge | kTooLarge1000,
+  kCarry | kTooLarge | kTooLarge1000
+};
+
+alignas(16) constexpr uint8_t kByte2High[16] = {
+  // ________ 0_______
+  kTooShort, kTooShort, kTooShort, kTooShort,
+  kTooShort, kTooShort, kTooShort, kTooShort,
+  // ________ 1000____
+  kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge1000 | kOverlong4,
+  // ________ 1001____
+  kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge,
+  // ________ 101_____
+  kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+  kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+  // ________ 11______
+  kTooShort, kTooShort, kTooShort, kTooShort
+};
+
+// Last bytes of a block that start a sequence the block does not finish.
+alignas(16) constexpr uint8_t kIncomplete[16] = {
+  255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 0xf0 - 1, 0xe0 - 1, 0xc0 - 1
+};
+
+// Encoding 8 units below U+0800 produces two bytes per unit, a lead byte and
+// a continuation, except for ASCII, which only keeps the second one. Entry n
+// selects the bytes to keep when bit j of n marks unit j as ASCII.
+struct CompactTable {
+  uint8_t shuffle[256][16];
+  uint8_t length[256];
+};
+
+constexpr CompactTable MakeCompactTable() {
+  CompactTable table = {};
+  for (int mask = 0; mask < 256; mask++) {
+    int length = 0;
+    for (int j = 0; j < 8; j++) {
+      if ((mask & (1 << j)) == 0)
+        table.shuffle[mask][length++] = 2 * j;
+      table.shuffle[mask][length++] = 2 * j + 1;
+    }
+    table.length[mask] = length;
+    for (int j = length; j < 16; j++)
+      table.shuffle[mask][j] = 0x80;
+  }
+  return table;
+}
+
+alignas(16) constexpr CompactTable kCompact = MakeCompactTable();
+
+// Encoding 4 units outside the surrogates lays out up to three bytes per unit
+// in the lanes of a 32 bit vector. Entry n selects the bytes to keep when bit
+// j of n marks unit j as taking at least two bytes and bit j + 4 as taking
+// three.
+constexpr CompactTable MakeMixedTable() {
+  CompactTable table = {};
+  for (int mask = 0; mask < 256; mask++) {
+    int length = 0;
+    for (int j = 0; j < 4; j++) {
+      const int bytes = 1 + ((mask >> j) & 1) + ((mask >> (j + 4)) & 1);
+      for (int b = 0; b < bytes; b++)
+        table.shuffle[mask][length++] = 4 * j + b;
+    }
+    table.length[mask] = length;
+    for (int j = length; j < 16; j++)
+      table.shuffle[mask][j] = 0x80;
+  }
+  return table;
+}
+
+alignas(16) constexpr CompactTable kMixed = MakeMixedTable();
+
+#endif  // NODE_UTF8_SIMD
+
+#ifdef NODE_UTF8_X86
+
+#define SIMD_TARGET __attribute__((target("ssse3")))
+
+// Operations on 16 bytes or 8 UTF-16 units the vectorized conversions below
+// are written in.
+struct Simd {
+  using Vec = __m128i;
+  static constexpr Kernel kKernel = Kernel::SSSE3;
+
+  // DecodeThreeByte reads kThreeByteRead bytes and decodes the first
+  // kThreeByteConsumed of them into kThreeByteUnits units.
+  static constexpr size_t kThreeByteRead = 16;
+  static constexpr size_t kThreeByteConsumed = 15;
+  static constexpr size_t kThreeByteUnits = 5;
+
+  SIMD_TARGET static inline Vec Load(const void* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  }
+
+  SIMD_TARGET static inline void Store(Vec v, void* p) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+  }
+
+  SIMD_TARGET static inline Vec Zero() {
+    return _mm_setzero_si128();
+  }
+
+  SIMD_TARGET static inline Vec Or(Vec a, Vec b) {
+    return _mm_or_si128(a, b);
+  }
+
+  SIMD_TARGET static inline bool AnySet(Vec v) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xffff;
+  }
+
+  // Bit n is set if byte n is 0x80 or above.
+  SIMD_TARGET static inline uint32_t HighBits(Vec v) {
+    return _mm_movemask_epi8(v);
+  }
+
+  SIMD_TARGET static inline Vec Nibbles(Vec v) {
+    return _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0f));
+  }
+
+  SIMD_TARGET static inline Vec CheckBlock(Vec in, Vec prev) {
+    const Vec prev1 = _mm_alignr_epi8(in, prev, 15);
+    const Vec prev2 = _mm_alignr_epi8(in, prev, 14);
+    const Vec prev3 = _mm_alignr_epi8(in, prev, 13);
+    const Vec byte_1_high = _mm_shuffle_epi8(Load(kByte1High), Nibbles(prev1));
+    const Vec byte_1_low = _mm_shuffle_epi8(
+        Load(kByte1Low), _mm_and_si128(prev1, _mm_set1_epi8(0x0f)));
+    const Vec byte_2_high = _mm_shuffle_epi8(Load(kByte2High), Nibbles(in));
+    const Vec special =
+        _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+    // The second and third continuation bytes of 3 and 4 byte sequences are
+    // the only pairs of continuations that are allowed.
+    const Vec must_continue = _mm_or_si128(
+        _mm_subs_epu8(prev2, _mm_set1_epi8(static_cast<char>(0xe0 - 0x80))),
+        _mm_subs_epu8(prev3, _mm_set1_epi8(static_cast<char>(0xf0 - 0x80))));
+    return _mm_xor_si128(
+        _mm_and_si128(must_continue, _mm_set1_epi8(static_cast<char>(0x80))),
+        special);
+  }
+
+  SIMD_TARGET static inline Vec Incomplete(Vec in) {
+    return _mm_subs_epu8(in, Load(kIncomplete));
+  }
+
+  SIMD_TARGET static inline size_t Utf16Units(Vec in) {
+    // Continuation bytes are -128 to -65 as signed bytes.
+    const Vec starts = _mm_cmpgt_epi8(in, _mm_set1_epi8(-65));
+    const Vec four_byte = _mm_cmpeq_epi8(
+        _mm_max_epu8(in, _mm_set1_epi8(static_cast<char>(0xf0))), in);
+    return PopCount16(_mm_movemask_epi8(starts)) +
+           PopCount16(_mm_movemask_epi8(four_byte));
+  }
+
+  SIMD_TARGET static inline bool NonLatin1(Vec in) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(
+        _mm_max_epu8(in, _mm_set1_epi8(static_cast<char>(0xc4))), in)) != 0;
+  }
+
+  SIMD_TARGET static inline void Widen(Vec in, uint16_t* dst) {
+    Store(_mm_unpacklo_epi8(in, _mm_setzero_si128()), dst);
+    Store(_mm_unpackhi_epi8(in, _mm_setzero_si128()), dst + 8);
+  }
+
+  // Decodes five 3 byte sequences, or returns false if the first 15 bytes
+  // are something else. The input has been validated, so checking the lead
+  // bytes is enough.
+  SIMD_TARGET static inline bool DecodeThreeByte(const uint8_t* src,
+                                                 uint16_t* dst) {
+    const Vec in = Load(src);
+    const Vec lead = _mm_shuffle_epi8(
+        in, _mm_setr_epi8(0, -1, 3, -1, 6, -1, 9, -1, 12, -1,
+                          -1, -1, -1, -1, -1, -1));
+    const Vec is_lead = _mm_cmpeq_epi16(
+        _mm_and_si128(lead, _mm_set1_epi16(0xf0)), _mm_set1_epi16(0xe0));
+    if ((_mm_movemask_epi8(is_lead) & 0x3ff) != 0x3ff)
+      return false;
+    const Vec cont1 = _mm_shuffle_epi8(
+        in, _mm_setr_epi8(1, -1, 4, -1, 7, -1, 10, -1, 13, -1,
+                          -1, -1, -1, -1, -1, -1));
+    const Vec cont2 = _mm_shuffle_epi8(
+        in, _mm_setr_epi8(2, -1, 5, -1, 8, -1, 11, -1, 14, -1,
+                          -1, -1, -1, -1, -1, -1));
+    const Vec units = _mm_or_si128(
+        _mm_or_si128(
+            _mm_slli_epi16(_mm_and_si128(lead, _mm_set1_epi16(0x0f)), 12),
+            _mm_slli_epi16(_mm_and_si128(cont1, _mm_set1_epi16(0x3f)), 6)),
+        _mm_and_si128(cont2, _mm_set1_epi16(0x3f)));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), units);
+    dst[4] = static_cast<uint16_t>(_mm_extract_epi16(units, 4));
+    return true;
+  }
+
+  // Sets *bytes to what 8 units of UTF-16 take as UTF-8, or returns false if
+  // there is a surrogate among them.
+  SIMD_TARGET static inline bool Utf8Bytes8(const uint16_t* src,
+                                            size_t* bytes) {
+    const Vec units = Load(src);
+    const Vec surrogate = _mm_cmpeq_epi16(
+        _mm_and_si128(units, _mm_set1_epi16(-0x800)), _mm_set1_epi16(-0x2800));
+    if (_mm_movemask_epi8(surrogate) != 0)
+      return false;
+    const Vec one_byte = _mm_cmpeq_epi16(
+        _mm_subs_epu16(units, _mm_set1_epi16(0x7f)), _mm_setzero_si128());
+    const Vec up_to_two_bytes = _mm_cmpeq_epi16(
+        _mm_subs_epu16(units, _mm_set1_epi16(0x7ff)), _mm_setzero_si128());
+    *bytes = 24 - PopCount16(_mm_movemask_epi8(one_byte)) / 2 -
+             PopCount16(_mm_movemask_epi8(up_to_two_bytes)) / 2;
+    return true;
+  }
+
+  // Narrows 16 units if all of them are ASCII.
+  SIMD_TARGET static inline bool Ascii16(const uint16_t* src, uint8_t* dst) {
+    const Vec low = Load(src);
+    const Vec high = Load(src + 8);
+    const Vec non_ascii =
+        _mm_and_si128(_mm_or_si128(low, high), _mm_set1_epi16(-0x80));
+    if (AnySet(non_ascii))
+      return false;
+    Store(_mm_packus_epi16(low, high), dst);
+    return true;
+  }
+
+  // Encodes 8 units below U+0800 into up to 16 bytes and returns how many
+  // of them are UTF-8.
+  SIMD_TARGET static inline size_t TwoByte8(Vec units, uint8_t* dst) {
+    const Vec ascii = _mm_cmpeq_epi16(
+        _mm_subs_epu16(units, _mm_set1_epi16(0x7f)), _mm_setzero_si128());
+    const Vec lead =
+        _mm_or_si128(_mm_srli_epi16(units, 6), _mm_set1_epi16(0xc0));
+    const Vec cont = _mm_or_si128(
+        _mm_and_si128(units, _mm_set1_epi16(0x3f)), _mm_set1_epi16(0x80));
+    const Vec second = _mm_or_si128(_mm_and_si128(ascii, units),
+                                    _mm_andnot_si128(ascii, cont));
+    const Vec words = _mm_or_si128(lead, _mm_slli_epi16(second, 8));
+    const uint32_t mask =
+        _mm_movemask_epi8(_mm_packs_epi16(ascii, _mm_setzero_si128()));
+    Store(_mm_shuffle_epi8(words, Load(kCompact.shuffle[mask])), dst);
+    return kCompact.length[mask];
+  }
+
+  // Encodes 16 Latin-1 characters into up to 32 bytes.
+  SIMD_TARGET static inline size_t Latin1Block(Vec in, uint8_t* dst) {
+    const size_t low =
+        TwoByte8(_mm_unpacklo_epi8(in, _mm_setzero_si128()), dst);
+    return low +
+           TwoByte8(_mm_unpackhi_epi8(in, _mm_setzero_si128()), dst + low);
+  }
+
+  // Encodes 8 units from U+0800 to U+FFFF, none of them surrogates.
+  SIMD_TARGET static inline void ThreeByte8(Vec units, uint8_t* dst) {
+    const Vec lead =
+        _mm_or_si128(_mm_srli_epi16(units, 12), _mm_set1_epi16(0xe0));
+    const Vec cont1 = _mm_or_si128(
+        _mm_and_si128(_mm_srli_epi16(units, 6), _mm_set1_epi16(0x3f)),
+        _mm_set1_epi16(0x80));
+    const Vec cont2 = _mm_or_si128(
+        _mm_and_si128(units, _mm_set1_epi16(0x3f)), _mm_set1_epi16(0x80));
+    // Bytes 0-7 are the leads and 8-15 the first continuations.
+    const Vec lead_cont1 = _mm_packus_epi16(lead, cont1);
+    const Vec cont2_bytes = _mm_packus_epi16(cont2, cont2);
+    const Vec first = _mm_or_si128(
+        _mm_shuffle_epi8(lead_cont1,
+                         _mm_setr_epi8(0, 8, -1, 1, 9, -1, 2, 10, -1,
+                                       3, 11, -1, 4, 12, -1, 5)),
+        _mm_shuffle_epi8(cont2_bytes,
+                         _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2,
+                                       -1, -1, 3, -1, -1, 4, -1)));
+    const Vec second = _mm_or_si128(
+        _mm_shuffle_epi8(lead_cont1,
+                         _mm_setr_epi8(13, -1, 6, 14, -1, 7, 15, -1,
+                                       -1, -1, -1, -1, -1, -1, -1, -1)),
+        _mm_shuffle_epi8(cont2_bytes,
+                         _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7,
+                                       -1, -1, -1, -1, -1, -1, -1, -1)));
+    Store(first, dst);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + 16), second);
+  }
+
+  // Encodes 4 units in the 32 bit lanes of units, none of them surrogates,
+  // into up to 16 bytes and returns how many of them are UTF-8.
+  SIMD_TARGET static inline size_t Mixed4(Vec units, uint8_t* dst) {
+    const Vec ascii = _mm_cmplt_epi32(units, _mm_set1_epi32(0x80));
+    const Vec three = _mm_cmpgt_epi32(units, _mm_set1_epi32(0x7ff));
+    const Vec last = _mm_or_si128(
+        _mm_and_si128(units, _mm_set1_epi32(0x3f)), _mm_set1_epi32(0x80));
+    const Vec shifted = _mm_srli_epi32(units, 6);
+    const Vec two_lead = _mm_or_si128(shifted, _mm_set1_epi32(0xc0));
+    const Vec three_lead =
+        _mm_or_si128(_mm_srli_epi32(units, 12), _mm_set1_epi32(0xe0));
+    const Vec three_mid = _mm_or_si128(
+        _mm_and_si128(shifted, _mm_set1_epi32(0x3f)), _mm_set1_epi32(0x80));
+    const Vec lead = _mm_or_si128(
+        _mm_and_si128(ascii, units),
+        _mm_andnot_si128(ascii, _mm_or_si128(
+            _mm_and_si128(three, three_lead),
+            _mm_andnot_si128(three, two_lead))));
+    const Vec mid = _mm_or_si128(_mm_and_si128(three, three_mid),
+                                 _mm_andnot_si128(three, last));
+    const Vec lanes = _mm_or_si128(
+        _mm_or_si128(lead, _mm_slli_epi32(mid, 8)), _mm_slli_epi32(last, 16));
+    const uint32_t mask =
+        (_mm_movemask_ps(_mm_castsi128_ps(ascii)) ^ 0xf) |
+        _mm_movemask_ps(_mm_castsi128_ps(three)) << 4;
+    Store(_mm_shuffle_epi8(lanes, Load(kMixed.shuffle[mask])), dst);
+    return kMixed.length[mask];
+  }
+
+  // Encodes 8 units into up to 28 bytes, of which up to 24 are UTF-8, unless
+  // there is a surrogate among them. Returns the number of bytes, or 0 for
+  // surrogates.
+  SIMD_TARGET static inline size_t Encode8(const uint16_t* src,
+                                           uint8_t* dst) {
+    const Vec units = Load(src);
+    const uint32_t two_byte = _mm_movemask_epi8(_mm_cmpeq_epi16(
+        _mm_subs_epu16(units, _mm_set1_epi16(0x7ff)), _mm_setzero_si128()));
+    if (two_byte == 0xffff)
+      return TwoByte8(units, dst);
+    const Vec surrogate = _mm_cmpeq_epi16(
+        _mm_and_si128(units, _mm_set1_epi16(-0x800)), _mm_set1_epi16(-0x2800));
+    if (_mm_movemask_epi8(surrogate) != 0)
+      return 0;
+    if (two_byte == 0) {
+      ThreeByte8(units, dst);
+      return 24;
+    }
+    const size_t low =
+        Mixed4(_mm_unpacklo_epi16(units, _mm_setzero_si128()), dst);
+    return low +
+           Mixed4(_mm_unpackhi_epi16(units, _mm_setzero_si128()), dst + low);
+  }
+};
+
+#endif  // NODE_UTF8_X86
+
+#ifdef NODE_UTF8_NEON
+
+#define SIMD_TARGET
+
+struct Simd {
+  using Vec = uint8x16_t;
+  static constexpr Kernel kKernel = Kernel::NEON;
+
+  static constexpr size_t kThreeByteRead = 48;
+  static constexpr size_t kThreeByteConsumed = 48;
+  static constexpr size_t kThreeByteUnits = 16;
+
+  static inline Vec Load(const void* p) {
+    return vld1q_u8(static_cast<const uint8_t*>(p));
+  }
+
+  static inline void Store(Vec v, void* p) {
+    vst1q_u8(static_cast<uint8_t*>(p), v);
+  }
+
+  static inline Vec Zero() {
+    return vdupq_n_u8(0);
+  }
+
+  static inline Vec Or(Vec a, Vec b) {
+    return vorrq_u8(a, b);
+  }
+
+  static inline bool AnySet(Vec v) {
+    return vmaxvq_u8(v) != 0;
+  }
+
+  static inline uint32_t HighBits(Vec v) {
+    const int8x16_t shifts = {0, 1, 2, 3, 4, 5, 6, 7, 0, 1, 2, 3, 4, 5, 6, 7};
+    const uint8x16_t bits = vshlq_u8(vshrq_n_u8(v, 7), shifts);
+    return vaddv_u8(vget_low_u8(bits)) |
+           static_cast<uint32_t>(vaddv_u8(vget_high_u8(bits))) << 8;
+  }
+
+  static inline Vec CheckBlock(Vec in, Vec prev) {
+    const Vec prev1 = vextq_u8(prev, in, 15);
+    const Vec prev2 = vextq_u8(prev, in, 14);
+    const Vec prev3 = vextq_u8(prev, in, 13);
+    const Vec byte_1_high = vqtbl1q_u8(Load(kByte1High), vshrq_n_u8(prev1, 4));
+    const Vec byte_1_low =
+        vqtbl1q_u8(Load(kByte1Low), vandq_u8(prev1, vdupq_n_u8(0x0f)));
+    const Vec byte_2_high = vqtbl1q_u8(Load(kByte2High), vshrq_n_u8(in, 4));
+    const Vec special =
+        vandq_u8(vandq_u8(byte_1_high, byte_1_low), byte_2_high);
+    const Vec must_continue =
+        vorrq_u8(vqsubq_u8(prev2, vdupq_n_u8(0xe0 - 0x80)),
+                 vqsubq_u8(prev3, vdupq_n_u8(0xf0 - 0x80)));
+    return veorq_u8(vandq_u8(must_continue, vdupq_n_u8(0x80)), special);
+  }
+
+  static inline Vec Incomplete(Vec in) {
+    return vqsubq_u8(in, Load(kIncomplete));
+  }
+
+  static inline size_t Utf16Units(Vec in) {
+    const Vec starts = vcgtq_s8(vreinterpretq_s8_u8(in), vdupq_n_s8(-65));
+    const Vec four_byte = vcgeq_u8(in, vdupq_n_u8(0xf0));
+    return vaddvq_u8(vshrq_n_u8(starts, 7)) +
+           vaddvq_u8(vshrq_n_u8(four_byte, 7));
+  }
+
+  static inline bool NonLatin1(Vec in) {
+    return vmaxvq_u8(in) >= 0xc4;
+  }
+
+  static inline void Widen(Vec in, uint16_t* dst) {
+    vst1q_u16(dst, vmovl_u8(vget_low_u8(in)));
+    vst1q_u16(dst + 8, vmovl_high_u8(in));
+  }
+
+  // Decodes sixteen 3 byte sequences, or returns false if the 48 bytes are
+  // something else. The input has been validated, so checking the lead bytes
+  // is enough.
+  static inline bool DecodeThreeByte(const uint8_t* src, uint16_t* dst) {
+    const uint8x16x3_t in = vld3q_u8(src);
+    const Vec is_lead = vceqq_u8(vandq_u8(in.val[0], vdupq_n_u8(0xf0)),
+                                 vdupq_n_u8(0xe0));
+    if (vminvq_u8(is_lead) != 0xff)
+      return false;
+    const Vec lead = vandq_u8(in.val[0], vdupq_n_u8(0x0f));
+    const Vec cont1 = vandq_u8(in.val[1], vdupq_n_u8(0x3f));
+    const Vec cont2 = vandq_u8(in.val[2], vdupq_n_u8(0x3f));
+    const uint16x8_t low = vorrq_u16(
+        vorrq_u16(vshlq_n_u16(vmovl_u8(vget_low_u8(lead)), 12),
+                  vshlq_n_u16(vmovl_u8(vget_low_u8(cont1)), 6)),
+        vmovl_u8(vget_low_u8(cont2)));
+    const uint16x8_t high = vorrq_u16(
+        vorrq_u16(vshlq_n_u16(vmovl_high_u8(lead), 12),
+                  vshlq_n_u16(vmovl_high_u8(cont1), 6)),
+        vmovl_high_u8(cont2));
+    vst1q_u16(dst, low);
+    vst1q_u16(dst + 8, high);
+    return true;
+  }
+
+  static inline bool Utf8Bytes8(const uint16_t* src, size_t* bytes) {
+    const uint16x8_t units = vld1q_u16(src);
+    const uint16x8_t surrogate = vceqq_u16(
+        vandq_u16(units, vdupq_n_u16(0xf800)), vdupq_n_u16(0xd800));
+    if (vmaxvq_u16(surrogate) != 0)
+      return false;
+    const uint16x8_t two_bytes =
+        vshrq_n_u16(vcgeq_u16(units, vdupq_n_u16(0x80)), 15);
+    const uint16x8_t three_bytes =
+        vshrq_n_u16(vcgeq_u16(units, vdupq_n_u16(0x800)), 15);
+    *bytes = 8 + vaddvq_u16(vaddq_u16(two_bytes, three_bytes));
+    return true;
+  }
+
+  static inline bool Ascii16(const uint16_t* src, uint8_t* dst) {
+    const uint16x8_t low = vld1q_u16(src);
+    const uint16x8_t high = vld1q_u16(src + 8);
+    if (vmaxvq_u16(vorrq_u16(low, high)) >= 0x80)
+      return false;
+    vst1q_u8(dst, vcombine_u8(vmovn_u16(low), vmovn_u16(high)));
+    return true;
+  }
+
+  static inline size_t TwoByte8(uint16x8_t units, uint8_t* dst) {
+    const uint16x8_t ascii = vcltq_u16(units, vdupq_n_u16(0x80));
+    const uint16x8_t lead =
+        vorrq_u16(vshrq_n_u16(units, 6), vdupq_n_u16(0xc0));
+    const uint16x8_t cont =
+        vorrq_u16(vandq_u16(units, vdupq_n_u16(0x3f)), vdupq_n_u16(0x80));
+    const uint16x8_t words =
+        vorrq_u16(lead, vshlq_n_u16(vbslq_u16(ascii, units, cont), 8));
+    const uint16x8_t bits = {1, 2, 4, 8, 16, 32, 64, 128};
+    const uint32_t mask = vaddvq_u16(vandq_u16(ascii, bits));
+    vst1q_u8(dst, vqtbl1q_u8(vreinterpretq_u8_u16(words),
+                             vld1q_u8(kCompact.shuffle[mask])));
+    return kCompact.length[mask];
+  }
+
+  static inline size_t Latin1Block(Vec in, uint8_t* dst) {
+    const size_t low = TwoByte8(vmovl_u8(vget_low_u8(in)), dst);
+    return low + TwoByte8(vmovl_high_u8(in), dst + low);
+  }
+
+  static inline void ThreeByte8(uint16x8_t units, uint8_t* dst) {
+    uint8x8x3_t out;
+    out.val[0] = vmovn_u16(
+        vorrq_u16(vshrq_n_u16(units, 12), vdupq_n_u16(0xe0)));
+    out.val[1] = vmovn_u16(vorrq_u16(
+        vandq_u16(vshrq_n_u16(units, 6), vdupq_n_u16(0x3f)),
+        vdupq_n_u16(0x80)));
+    out.val[2] = vmovn_u16(vorrq_u16(
+        vandq_u16(units, vdupq_n_u16(0x3f)), vdupq_n_u16(0x80)));
+    vst3_u8(dst, out);
+  }
+
+  static inline size_t Mixed4(uint32x4_t units, uint8_t* dst) {
+    const uint32x4_t ascii = vcltq_u32(units, vdupq_n_u32(0x80));
+    const uint32x4_t three = vcgtq_u32(units, vdupq_n_u32(0x7ff));
+    const uint32x4_t last =
+        vorrq_u32(vandq_u32(units, vdupq_n_u32(0x3f)), vdupq_n_u32(0x80));
+    const uint32x4_t shifted = vshrq_n_u32(units, 6);
+    const uint32x4_t two_lead = vorrq_u32(shifted, vdupq_n_u32(0xc0));
+    const uint32x4_t three_lead =
+        vorrq_u32(vshrq_n_u32(units, 12), vdupq_n_u32(0xe0));
+    const uint32x4_t three_mid =
+        vorrq_u32(vandq_u32(shifted, vdupq_n_u32(0x3f)), vdupq_n_u32(0x80));
+    const uint32x4_t lead =
+        vbslq_u32(ascii, units, vbslq_u32(three, three_lead, two_lead));
+    const uint32x4_t mid = vbslq_u32(three, three_mid, last);
+    const uint32x4_t lanes = vorrq_u32(
+        vorrq_u32(lead, vshlq_n_u32(mid, 8)), vshlq_n_u32(last, 16));
+    const uint32x4_t bits = {1, 2, 4, 8};
+    const uint32_t mask = (vaddvq_u32(vandq_u32(ascii, bits)) ^ 0xf) |
+                          vaddvq_u32(vandq_u32(three, bits)) << 4;
+    vst1q_u8(dst, vqtbl1q_u8(vreinterpretq_u8_u32(lanes),
+                             vld1q_u8(kMixed.shuffle[mask])));
+    return kMixed.length[mask];
+  }
+
+  static inline size_t Encode8(const uint16_t* src, uint8_t* dst) {
+    const uint16x8_t units = vld1q_u16(src);
+    const uint16x8_t two_byte = vcltq_u16(units, vdupq_n_u16(0x800));
+    if (vminvq_u16(two_byte) != 0)
+      return TwoByte8(units, dst);
+    const uint16x8_t surrogate = vceqq_u16(
+        vandq_u16(units, vdupq_n_u16(0xf800)), vdupq_n_u16(0xd800));
+    if (vmaxvq_u16(surrogate) != 0)
+      return 0;
+    if (vmaxvq_u16(two_byte) == 0) {
+      ThreeByte8(units, dst);
+      return 24;
+    }
+    const size_t low = Mixed4(vmovl_u16(vget_low_u16(units)), dst);
+    return low + Mixed4(vmovl_high_u16(units), dst + low);
+  }
+};
+
+#endif  // NODE_UTF8_NEON
+
+#ifdef NODE_UTF8_SIMD
+
+using Vec = Simd::Vec;
+
+// Mixed text that none of the vector paths take is handed to the scalar code
+// this many units at a time, so that it does not pay for a failed attempt at
+// every block.
+constexpr size_t kScalarRun = 64;
+
+SIMD_TARGET size_t AsciiPrefixSimd(const uint8_t* s, size_t length) {
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    const uint32_t high = Simd::HighBits(Simd::Load(s + i));
+    if (high != 0)
+      return i + __builtin_ctz(high);
+  }
+  return AsciiPrefixScalar(s, i, length);
+}
+
+SIMD_TARGET bool ValidateSimd(const uint8_t* s, size_t length,
+                              size_t* utf16_length, bool* latin1) {
+  Vec prev = Simd::Zero();
+  Vec error = Simd::Zero();
+  Vec incomplete = Simd::Zero();
+  size_t units = 0;
+  bool non_latin1 = false;
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    const Vec in = Simd::Load(s + i);
+    if (Simd::HighBits(in) == 0) {
+      // An ASCII block cannot finish what the previous one started.
+      error = Simd::Or(error, incomplete);
+      incomplete = Simd::Zero();
+      units += 16;
+    } else {
+      error = Simd::Or(error, Simd::CheckBlock(in, prev));
+      incomplete = Simd::Incomplete(in);
+      units += Simd::Utf16Units(in);
+      non_latin1 = non_latin1 || Simd::NonLatin1(in);
+    }
+    prev = in;
+  }
+  if (Simd::AnySet(error))
+    return false;
+  return FinishValidation(s, length, i, units, !non_latin1,
+                          utf16_length, latin1);
+}
+
+SIMD_TARGET void ConvertToLatin1Simd(const uint8_t* s, size_t length,
+                                     char* dst) {
+  size_t i = 0;
+  size_t k = 0;
+  while (i < length) {
+    if (i + 16 <= length) {
+      const Vec in = Simd::Load(s + i);
+      if (Simd::HighBits(in) == 0) {
+        Simd::Store(in, dst + k);
+        i += 16;
+        k += 16;
+        continue;
+      }
+    }
+    ConvertToLatin1Scalar(s, std::min(length, i + 16), &i, dst, &k);
+  }
+}
+
+SIMD_TARGET void ConvertToUtf16Simd(const uint8_t* s, size_t length,
+                                    uint16_t* dst) {
+  size_t i = 0;
+  size_t k = 0;
+  while (i < length) {
+    if (i + 16 <= length) {
+      const Vec in = Simd::Load(s + i);
+      if (Simd::HighBits(in) == 0) {
+        Simd::Widen(in, dst + k);
+        i += 16;
+        k += 16;
+        continue;
+      }
+    }
+    if (i + Simd::kThreeByteRead <= length &&
+        Simd::DecodeThreeByte(s + i, dst + k)) {
+      i += Simd::kThreeByteConsumed;
+      k += Simd::kThreeByteUnits;
+      continue;
+    }
+    ConvertToUtf16Scalar(s, std::min(length, i + kScalarRun), &i, dst, &k);
+  }
+}
+
+SIMD_TARGET size_t Latin1LengthSimd(const uint8_t* src, size_t length) {
+  size_t bytes = 0;
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16)
+    bytes += 16 + PopCount16(Simd::HighBits(Simd::Load(src + i)));
+  return bytes + Latin1LengthScalar(src, i, length);
+}
+
+SIMD_TARGET size_t Utf16LengthSimd(const uint16_t* src, size_t length) {
+  size_t bytes = 0;
+  size_t i = 0;
+  while (i < length) {
+    size_t block_bytes;
+    if (i + 8 <= length && Simd::Utf8Bytes8(src + i, &block_bytes)) {
+      bytes += block_bytes;
+      i += 8;
+      continue;
+    }
+    bytes += Utf16LengthScalar(src, length, std::min(length, i + 8), &i);
+  }
+  return bytes;
+}
+
+SIMD_TARGET size_t FromLatin1Simd(const uint8_t* src, size_t length,
+                                  uint8_t* dst, size_t dstlen, size_t* read) {
+  size_t i = 0;
+  size_t k = 0;
+  while (i < length) {
+    if (i + 16 <= length && dstlen - k >= 16) {
+      const Vec in = Simd::Load(src + i);
+      if (Simd::HighBits(in) == 0) {
+        Simd::Store(in, dst + k);
+        i += 16;
+        k += 16;
+        continue;
+      }
+      if (dstlen - k >= 32) {
+        k += Simd::Latin1Block(in, dst + k);
+        i += 16;
+        continue;
+      }
+    }
+    if (!FromLatin1Scalar(src, std::min(length, i + 16), &i, dst, dstlen, &k))
+      break;
+  }
+  *read = i;
+  return k;
+}
+
+SIMD_TARGET size_t FromUtf16Simd(const uint16_t* src, size_t length,
+                                 uint8_t* dst, size_t dstlen, size_t* read) {
+  size_t i = 0;
+  size_t k = 0;
+  while (i < length) {
+    if (i + 16 <= length && dstlen - k >= 16 &&
+        Simd::Ascii16(src + i, dst + k)) {
+      i += 16;
+      k += 16;
+      continue;
+    }
+    if (i + 8 <= length && dstlen - k >= 28) {
+      const size_t bytes = Simd::Encode8(src + i, dst + k);
+      if (bytes != 0) {
+        i += 8;
+        k += bytes;
+        continue;
+      }
+    }
+    if (!FromUtf16Scalar(src, length, std::min(length, i + kScalarRun), &i,
+                         dst, dstlen, &k))
+      break;
+  }
+  *read = i;
+  return k;
+}
+
+#undef SIMD_TARGET
+
+#endif  // NODE_UTF8_SIMD
+
+Kernel BestKernel() {
+  if (KernelSupported(Kernel::SSSE3))
+    return Kernel::SSSE3;
+  if (KernelSupported(Kernel::NEON))
+    return Kernel::NEON;
+  return Kernel::SCALAR;
+}
+
+Kernel selected_kernel = BestKernel();
+
+inline bool UseSimd() {
+#ifdef NODE_UTF8_SIMD
+  return selected_kernel == Simd::kKernel;
+#else
+  return false;
+#endif
+}
+
+}  // anonymous namespace
+
+bool KernelSupported(Kernel kernel) {
+  switch (kernel) {
+    case Kernel::SCALAR:
+      return true;
+#ifdef NODE_UTF8_X86
+    case Kernel::SSSE3:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("ssse3");
+#endif
+#ifdef NODE_UTF8_NEON
+    case Kernel::NEON:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+Kernel CurrentKernel() {
+  return selected_kernel;
+}
+
+void SetKernel(Kernel kernel) {
+  CHECK(KernelSupported(kernel));
+  selected_kernel = kernel;
+}
+
+size_t AsciiPrefixLength(const char* src, size_t length) {
+  const uint8_t* s = reinterpret_cast<const uint8_t*>(src);
+#ifdef NODE_UTF8_SIMD
+  if (UseSimd())
+    return AsciiPrefixSimd(s, length);
+#endif
+  return AsciiPrefixScalar(s, 0, length);
+}
+
+bool Validate(const char* src, size_t length,
+              size_t* utf16_length, bool* latin1) {
+  const uint8_t* s = reinterpret_cast<const uint8_t*>(src);
+#ifdef NODE_UTF8_SIMD
+  if (UseSimd())
+    return ValidateSimd(s, length, utf16_length, latin1);
+#endif
+  return ValidateScalar(s, length, utf16_length, latin1);
+}
+
+void ConvertToLatin1(const char* src, size_t length, char* dst) {
+  const uint8_t* s = reinterpret_cast<const uint8_t*>(src);
+#ifdef NODE_UTF8_SIMD
+  if (UseSimd()) {
+    ConvertToLatin1Simd(s, length, dst);
+    return;
+  }
+#endif
+  size_t i = 0;
+  size_t k = 0;
+  ConvertToLatin1Scalar(s, length, &i, dst, &k);
+}
+
+void ConvertToUtf16(const char* src, size_t length, uint16_t* dst) {
+  const uint8_t* s = reinterpret_cast<const uint8_t*>(src);
+#ifdef NODE_UTF8_SIMD
+  if (UseSimd()) {
+    ConvertToUtf16Simd(s, length, dst);
+    return;
+  }
+#endif
+  size_t i = 0;
+  size_t k = 0;
+  ConvertToUtf16Scalar(s, length, &i, dst, &k);
+}
+
+size_t Latin1Length(const uint8_t* src, size_t length) {
+#ifdef NODE_UTF8_SIMD
+  if (UseSimd())
+    return Latin1LengthSimd(src, length);
+#endif
+  return Latin1LengthScalar(src, 0, length);
+}
+
+size_t Utf16Length(const uint16_t* src, size_t length) {
+#ifdef NODE_UTF8_SIMD
+  if (UseSimd())
+    return Utf16LengthSimd(src, length);
+#endif
+  size_t i = 0;
+  return Utf16LengthScalar(src, length, length, &i);
+}
+
+size_t FromLatin1(const uint8_t* src, size_t length,
+                  char* dst, size_t dstlen, size_t* read) {
+  uint8_t* d = reinterpret_cast<uint8_t*>(dst);
+#ifdef NODE_UTF8_SIMD
+  if (UseSimd())
+    return FromLatin1Simd(src, length, d, dstlen, read);
+#endif
+  size_t i = 0;
+  size_t k = 0;
+  FromLatin1Scalar(src, length, &i, d, dstlen, &k);
+  *read = i;
+  return k;
+}
+
+size_t FromUtf16(const uint16_t* src, size_t length,
+                 char* dst, size_t dstlen, size_t* read) {
+  uint8_t* d = reinterpret_cast<uint8_t*>(dst);
+#ifdef NODE_UTF8_SIMD
+  if (UseSimd())
+    return FromUtf16Simd(src, length, d, dstlen, read);
+#endif
+  size_t i = 0;
+  size_t k = 0;
+  FromUtf16Scalar(src, length, length, &i, d, dstlen, &k);
+  *read = i;
+  return k;
+}
+
+}  // namespace utf8
+}  // namespace node
@@ -0,0 +1,63 @@
+#ifndef SRC_UTF8_H_
+#define SRC_UTF8_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include <cstddef>
+#include <cstdint>
+
+namespace node {
+namespace utf8 {
+
+// Vectorized conversions between UTF-8, Latin-1 and UTF-16 for the paths that
+// turn strings into bytes and back. The best kernel the CPU supports is picked
+// at startup; tests switch between them to compare their results with the
+// scalar code.
+enum class Kernel {
+  SCALAR,
+  SSSE3,
+  NEON
+};
+
+bool KernelSupported(Kernel kernel);
+Kernel CurrentKernel();
+void SetKernel(Kernel kernel);
+
+// Number of leading bytes of src below 0x80.
+size_t AsciiPrefixLength(const char* src, size_t length);
+
+// Whether src is well-formed UTF-8, which rules out overlong forms, encoded
+// surrogates and code points past U+10FFFF, the input String::NewFromUtf8
+// would replace with U+FFFD. If it is, *utf16_length is set to the number of
+// UTF-16 code units src decodes to and *latin1 to whether all of its code
+// points are below U+0100.
+bool Validate(const char* src, size_t length,
+              size_t* utf16_length, bool* latin1);
+
+// Decode input Validate accepted, for which dst has to have room for
+// *utf16_length units. ConvertToLatin1 requires *latin1 as well.
+void ConvertToLatin1(const char* src, size_t length, char* dst);
+void ConvertToUtf16(const char* src, size_t length, uint16_t* dst);
+
+// Bytes the Latin-1 src takes as UTF-8.
+size_t Latin1Length(const uint8_t* src, size_t length);
+
+// Bytes the UTF-16 src takes as UTF-8, with every unpaired surrogate taking
+// the three bytes of U+FFFD.
+size_t Utf16Length(const uint16_t* src, size_t length);
+
+// Encode src as UTF-8 for as long as the next character fits into dst, like
+// String::WriteUtf8 with REPLACE_INVALID_UTF8: unpaired surrogates become
+// U+FFFD and a surrogate pair is never split. Return the number of bytes
+// written and set *read to the number of units of src they encode.
+size_t FromLatin1(const uint8_t* src, size_t length,
+                  char* dst, size_t dstlen, size_t* read);
+size_t FromUtf16(const uint16_t* src, size_t length,
+                 char* dst, size_t dstlen, size_t* read);
+
+}  // namespace utf8
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_UTF8_H_
@@ -2,11 +2,17 @@
 
 #include <cstddef>
 #include <cstring>
+#include <random>
+#include <string>
+#include <vector>
 
 #include "gtest/gtest.h"
 
 using node::base64_decode;
 using node::base64_encode;
+using node::base64_encoded_size;
+using node::Base64Kernel;
+using node::Base64Mode;
 
 TEST(Base64Test, Encode) {
   auto test = [](const char* string, const char* base64_string) {
@@ -140,3 +146,102 @@ TEST(Base64Test, Decode) {
        "dCBjdXBpZGF0YXQgbm9uIHByb2lkZW50LCBzdW50IGluIGN1bHBhIHF1aSBvZmZpY2lh\n"
        "IGRlc2VydW50IG1vbGxpdCBhbmltIGlkIGVzdCBsYWJvcnVtLg", text);
 }
+
+namespace {
+
+std::vector<Base64Kernel> SupportedKernels() {
+  std::vector<Base64Kernel> kernels;
+  for (Base64Kernel kernel : {Base64Kernel::SCALAR, Base64Kernel::SSSE3,
+                              Base64Kernel::AVX2, Base64Kernel::NEON}) {
+    if (node::base64_kernel_supported(kernel))
+      kernels.push_back(kernel);
+  }
+  return kernels;
+}
+
+std::string Encode(Base64Kernel kernel, const std::string& input,
+                   Base64Mode mode) {
+  node::base64_set_kernel(kernel);
+  std::string output(base64_encoded_size(input.size(), mode), '\0');
+  base64_encode(input.data(), input.size(), &output[0], output.size(), mode);
+  return output;
+}
+
+std::string Decode(Base64Kernel kernel, const std::string& input,
+                   size_t dstlen) {
+  node::base64_set_kernel(kernel);
+  // Anything written past what base64_decode reports shows up as a mismatch.
+  std::string output(dstlen, '\xaa');
+  const size_t written =
+      base64_decode(&output[0], output.size(), input.data(), input.size());
+  EXPECT_LE(written, dstlen);
+  output.resize(written);
+  return output;
+}
+
+std::string RandomBytes(std::mt19937* rng, size_t size) {
+  std::uniform_int_distribution<int> byte(0, 255);
+  std::string bytes(size, '\0');
+  for (char& c : bytes)
+    c = static_cast<char>(byte(*rng));
+  return bytes;
+}
+
+// Sprinkles whitespace and characters outside the alphabet into encoded,
+// which the decoder skips, and sometimes an early '=', where it stops.
+std::string AddNoise(std::mt19937* rng, const std::string& encoded) {
+  static const char noise[] = {' ', '\n', '\r', '\t', '*', '\x80', '\xff'};
+  std::uniform_int_distribution<int> gap(0, 80);
+  std::uniform_int_distribution<int> pick(0, sizeof(noise) - 1);
+  std::uniform_int_distribution<int> stop(0, 15);
+  std::string noisy;
+  size_t next = gap(*rng);
+  for (size_t i = 0; i < encoded.size(); i++) {
+    if (i == next) {
+      noisy += stop(*rng) == 0 ? '=' : noise[pick(*rng)];
+      next += gap(*rng);
+    }
+    noisy += encoded[i];
+  }
+  return noisy;
+}
+
+}  // anonymous namespace
+
+TEST(Base64Test, KernelsMatchScalar) {
+  const Base64Kernel original = node::base64_kernel();
+  const std::vector<Base64Kernel> kernels = SupportedKernels();
+  std::mt19937 rng(0x6e6f6465);
+  std::vector<size_t> sizes;
+  for (size_t size = 0; size <= 200; size++)
+    sizes.push_back(size);
+  std::uniform_int_distribution<size_t> large(201, 70000);
+  for (int i = 0; i < 20; i++)
+    sizes.push_back(large(rng));
+
+  for (size_t size : sizes) {
+    const std::string input = RandomBytes(&rng, size);
+    for (Base64Mode mode : {Base64Mode::NORMAL, Base64Mode::URL}) {
+      const std::string encoded = Encode(Base64Kernel::SCALAR, input, mode);
+      const std::string noisy = AddNoise(&rng, encoded);
+      std::uniform_int_distribution<size_t> short_dst(0, size);
+      const size_t dstlen = short_dst(rng);
+      EXPECT_EQ(input, Decode(Base64Kernel::SCALAR, encoded, size));
+
+      const std::string expected_noisy =
+          Decode(Base64Kernel::SCALAR, noisy, size);
+      const std::string expected_short =
+          Decode(Base64Kernel::SCALAR, encoded, dstlen);
+      for (Base64Kernel kernel : kernels) {
+        SCOPED_TRACE(static_cast<int>(kernel));
+        SCOPED_TRACE(size);
+        EXPECT_EQ(encoded, Encode(kernel, input, mode));
+        EXPECT_EQ(input, Decode(kernel, encoded, size));
+        EXPECT_EQ(expected_noisy, Decode(kernel, noisy, size));
+        EXPECT_EQ(expected_short, Decode(kernel, encoded, dstlen));
+      }
+    }
+  }
+
+  node::base64_set_kernel(original);
+}
@@ -0,0 +1,418 @@
+#include "krom/block_compression.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+struct Pixel {
+  int r, g, b, a;
+};
+
+std::vector<uint8_t> Decode(KromBlockFormat format,
+                            std::vector<uint8_t> block) {
+  std::vector<uint8_t> out(64, 0xcd);
+  decodeCompressedBlock(format, block.data(), out.data());
+  return out;
+}
+
+void ExpectPixels(const std::vector<uint8_t>& out,
+                  const std::vector<Pixel>& expected) {
+  ASSERT_EQ(expected.size(), 16u);
+  for (int i = 0; i < 16; ++i) {
+    SCOPED_TRACE(testing::Message() << "pixel " << i % 4 << ", " << i / 4);
+    EXPECT_EQ(out[i * 4], expected[i].r);
+    EXPECT_EQ(out[i * 4 + 1], expected[i].g);
+    EXPECT_EQ(out[i * 4 + 2], expected[i].b);
+    EXPECT_EQ(out[i * 4 + 3], expected[i].a);
+  }
+}
+
+// Every row of the block has the same color.
+std::vector<Pixel> Rows(Pixel row0, Pixel row1, Pixel row2, Pixel row3) {
+  std::vector<Pixel> pixels;
+  for (const Pixel& row : {row0, row1, row2, row3}) {
+    pixels.insert(pixels.end(), 4, row);
+  }
+  return pixels;
+}
+
+// Every column of the block has the same color.
+std::vector<Pixel> Columns(Pixel column0, Pixel column1, Pixel column2,
+                           Pixel column3) {
+  std::vector<Pixel> pixels;
+  for (int y = 0; y < 4; ++y) {
+    pixels.insert(pixels.end(), {column0, column1, column2, column3});
+  }
+  return pixels;
+}
+
+TEST(KromCompressedTest, Bc1FourColors) {
+  // Red and blue endpoints, the indices of every row are 0 1 2 3
+  ExpectPixels(Decode(KROM_BLOCK_BC1,
+                      {0x00, 0xf8, 0x1f, 0x00, 0xe4, 0xe4, 0xe4, 0xe4}),
+               Columns({255, 0, 0, 255}, {0, 0, 255, 255}, {170, 0, 85, 255},
+                       {85, 0, 170, 255}));
+}
+
+TEST(KromCompressedTest, Bc1ThreeColorsAndTransparent) {
+  // The first endpoint is not the larger one, index 3 is transparent black
+  ExpectPixels(Decode(KROM_BLOCK_BC1,
+                      {0x1f, 0x00, 0x00, 0xf8, 0xe4, 0xe4, 0xe4, 0xe4}),
+               Columns({0, 0, 255, 255}, {255, 0, 0, 255}, {127, 0, 127, 255},
+                       {0, 0, 0, 0}));
+}
+
+TEST(KromCompressedTest, Bc2) {
+  // Explicit alpha of 0 to 15 and a color block that always has four colors
+  std::vector<uint8_t> out = Decode(
+      KROM_BLOCK_BC2, {0x10, 0x32, 0x54, 0x76, 0x98, 0xba, 0xdc, 0xfe, 0x00,
+                       0x00, 0xff, 0xff, 0xe4, 0xe4, 0xe4, 0xe4});
+  std::vector<Pixel> expected;
+  const int gray[4] = {0, 255, 85, 170};
+  for (int i = 0; i < 16; ++i) {
+    expected.push_back({gray[i % 4], gray[i % 4], gray[i % 4], i * 17});
+  }
+  ExpectPixels(out, expected);
+}
+
+TEST(KromCompressedTest, Bc3) {
+  // Eight alpha values between 255 and 0, alpha index i % 8 for pixel i,
+  // over green and blue in four color mode
+  std::vector<uint8_t> out = Decode(
+      KROM_BLOCK_BC3, {0xff, 0x00, 0x88, 0xc6, 0xfa, 0x88, 0xc6, 0xfa, 0xe0,
+                       0x07, 0x1f, 0x00, 0x1b, 0x1b, 0x1b, 0x1b});
+  const int alpha[8] = {255, 0, 218, 182, 145, 109, 72, 36};
+  const Pixel colors[4] = {{0, 85, 170, 0}, {0, 170, 85, 0}, {0, 0, 255, 0},
+                           {0, 255, 0, 0}};
+  std::vector<Pixel> expected;
+  for (int i = 0; i < 16; ++i) {
+    Pixel pixel = colors[i % 4];
+    pixel.a = alpha[i % 8];
+    expected.push_back(pixel);
+  }
+  ExpectPixels(out, expected);
+}
+
+TEST(KromCompressedTest, Bc4SixValues) {
+  // The first value is not the larger one, which adds 0 and 255
+  std::vector<uint8_t> out = Decode(
+      KROM_BLOCK_BC4, {0x00, 0xff, 0x88, 0xc6, 0xfa, 0x88, 0xc6, 0xfa});
+  const int values[8] = {0, 255, 51, 102, 153, 204, 0, 255};
+  std::vector<Pixel> expected;
+  for (int i = 0; i < 16; ++i) {
+    int value = values[i % 8];
+    expected.push_back({value, value, value, 255});
+  }
+  ExpectPixels(out, expected);
+}
+
+TEST(KromCompressedTest, Bc5) {
+  // Red is index 2 of eight values everywhere, green goes through six values
+  std::vector<uint8_t> out = Decode(
+      KROM_BLOCK_BC5, {0xff, 0x00, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x0a,
+                       0xc8, 0x88, 0xc6, 0xfa, 0x88, 0xc6, 0xfa});
+  const int green[8] = {10, 200, 48, 86, 124, 162, 0, 255};
+  std::vector<Pixel> expected;
+  for (int i = 0; i < 16; ++i) {
+    expected.push_back({218, green[i % 8], 0, 255});
+  }
+  ExpectPixels(out, expected);
+}
+
+struct Bc7Block {
+  std::vector<uint8_t> block;
+  std::vector<Pixel> pixels;
+};
+
+TEST(KromCompressedTest, Bc7AllModes) {
+  // Random endpoints and indices, decoded with a second BC7 implementation
+  const Bc7Block blocks[] = {
+    // mode 0: three subsets, partition 1, endpoint p-bits
+    {{0x43, 0xb3, 0x5a, 0x38, 0xe4, 0xb6, 0x17, 0x00,
+      0xf1, 0x59, 0x52, 0x57, 0xf0, 0x9b, 0xbb, 0x13},
+     {{162, 23, 2, 255}, {162, 23, 2, 255}, {156, 41, 8, 255},
+      {119, 134, 132, 255}, {162, 23, 2, 255}, {165, 16, 0, 255},
+      {195, 172, 132, 255}, {214, 181, 132, 255}, {63, 216, 247, 255},
+      {107, 205, 231, 255}, {195, 172, 132, 255}, {177, 162, 132, 255},
+      {107, 205, 231, 255}, {198, 181, 198, 255}, {132, 198, 222, 255},
+      {82, 115, 132, 255}}},
+    // mode 1: two subsets, partition 13, shared p-bits
+    {{0x36, 0x5e, 0x6e, 0x5a, 0xbb, 0xa2, 0x21, 0xa5,
+      0x57, 0x79, 0x79, 0x31, 0xf9, 0x56, 0x49, 0xb9},
+     {{153, 184, 143, 255}, {231, 42, 122, 255}, {153, 184, 143, 255},
+      {185, 125, 134, 255}, {137, 211, 147, 255}, {137, 211, 147, 255},
+      {231, 42, 122, 255}, {168, 156, 139, 255}, {126, 74, 99, 255},
+      {106, 52, 110, 255}, {135, 84, 94, 255}, {135, 84, 94, 255},
+      {135, 84, 94, 255}, {144, 94, 89, 255}, {88, 32, 120, 255},
+      {135, 84, 94, 255}}},
+    // mode 2: three subsets, partition 1
+    {{0x0c, 0xe2, 0x14, 0x58, 0x47, 0x39, 0xfe, 0xc1,
+      0x14, 0xcc, 0x32, 0x17, 0xd3, 0x9d, 0x82, 0x9d},
+     {{140, 148, 0, 255}, {145, 107, 51, 255}, {156, 24, 156, 255},
+      {76, 190, 79, 255}, {151, 65, 105, 255}, {156, 24, 156, 255},
+      {16, 255, 41, 255}, {76, 190, 79, 255}, {190, 187, 93, 255},
+      {214, 198, 90, 255}, {16, 255, 41, 255}, {138, 122, 118, 255},
+      {190, 187, 93, 255}, {140, 165, 99, 255}, {190, 187, 93, 255},
+      {138, 122, 118, 255}}},
+    // mode 3: two subsets, partition 33, endpoint p-bits
+    {{0x18, 0x62, 0x48, 0xce, 0x35, 0x9b, 0xcb, 0x51,
+      0x73, 0xb7, 0xf7, 0x75, 0x02, 0x89, 0x19, 0xe6},
+     {{49, 217, 185, 255}, {49, 217, 185, 255}, {49, 217, 185, 255},
+      {64, 195, 183, 255}, {156, 56, 238, 255}, {175, 108, 230, 255},
+      {156, 56, 238, 255}, {215, 213, 215, 255}, {49, 217, 185, 255},
+      {72, 184, 182, 255}, {49, 217, 185, 255}, {49, 217, 185, 255},
+      {215, 213, 215, 255}, {156, 56, 238, 255}, {215, 213, 215, 255},
+      {175, 108, 230, 255}}},
+    // mode 4: rotation 2, 3-bit indices for color
+    {{0xd0, 0xea, 0x61, 0x6d, 0xc0, 0xef, 0xf9, 0x8d,
+      0xe5, 0xd0, 0xca, 0xe3, 0x85, 0xc2, 0x54, 0xd6},
+     {{88, 255, 42, 200}, {88, 121, 42, 200}, {123, 121, 0, 214},
+      {88, 121, 42, 200}, {117, 165, 7, 212}, {99, 211, 28, 205},
+      {88, 255, 42, 200}, {106, 121, 21, 207}, {94, 165, 35, 203},
+      {82, 255, 49, 198}, {99, 121, 28, 205}, {94, 211, 35, 203},
+      {111, 255, 14, 210}, {106, 165, 21, 207}, {111, 165, 14, 210},
+      {117, 211, 7, 212}}},
+    // mode 5: rotation 3
+    {{0xe0, 0x44, 0xbe, 0x80, 0xed, 0x34, 0x25, 0x13,
+      0x93, 0xfa, 0x8c, 0xda, 0x6d, 0xcb, 0x2a, 0x02},
+     {{137, 4, 201, 157}, {212, 147, 196, 103}, {137, 4, 198, 157},
+      {174, 74, 199, 130}, {174, 74, 196, 130}, {249, 217, 198, 76},
+      {249, 217, 201, 76}, {174, 74, 196, 130}, {212, 147, 198, 103},
+      {174, 74, 198, 130}, {137, 4, 198, 157}, {174, 74, 201, 130},
+      {174, 74, 198, 130}, {249, 217, 201, 76}, {212, 147, 201, 103},
+      {249, 217, 201, 76}}},
+    // mode 6: one subset with 4-bit indices
+    {{0xc0, 0x59, 0x96, 0xbf, 0xc9, 0x23, 0xaf, 0xca,
+      0x17, 0x1e, 0x5f, 0x35, 0x7d, 0x3e, 0xff, 0x94},
+     {{118, 210, 223, 170}, {108, 237, 237, 173}, {174, 67, 151, 151},
+      {108, 237, 237, 173}, {179, 55, 145, 149}, {128, 185, 211, 166},
+      {128, 185, 211, 166}, {118, 210, 223, 170}, {168, 82, 159, 153},
+      {139, 158, 197, 163}, {174, 67, 151, 151}, {118, 210, 223, 170},
+      {179, 55, 145, 149}, {179, 55, 145, 149}, {123, 197, 217, 168},
+      {148, 134, 185, 160}}},
+    // mode 7: two subsets with alpha, partition 17
+    {{0x80, 0x91, 0x80, 0x77, 0x3e, 0x30, 0x4b, 0x60,
+      0x07, 0xdb, 0x4c, 0x7c, 0x4d, 0xc4, 0xab, 0x62},
+     {{56, 84, 40, 189}, {178, 119, 104, 104}, {190, 158, 60, 36},
+      {178, 119, 104, 104}, {20, 125, 12, 182}, {56, 84, 40, 189},
+      {20, 125, 12, 182}, {154, 40, 195, 243}, {130, 0, 97, 203},
+      {94, 41, 69, 196}, {94, 41, 69, 196}, {94, 41, 69, 196},
+      {94, 41, 69, 196}, {20, 125, 12, 182}, {94, 41, 69, 196},
+      {56, 84, 40, 189}}},
+  };
+  for (int mode = 0; mode < 8; ++mode) {
+    SCOPED_TRACE(testing::Message() << "mode " << mode);
+    EXPECT_EQ(blocks[mode].block[0] & ((2 << mode) - 1), 1 << mode);
+    ExpectPixels(Decode(KROM_BLOCK_BC7, blocks[mode].block),
+                 blocks[mode].pixels);
+  }
+}
+
+TEST(KromCompressedTest, Bc7ReservedMode) {
+  std::vector<uint8_t> out = Decode(KROM_BLOCK_BC7, std::vector<uint8_t>(16));
+  ExpectPixels(out, std::vector<Pixel>(16, {0, 0, 0, 0}));
+}
+
+// Pixel indices of the ETC2 blocks below, stored column by column:
+// every pixel uses index 0 but for pixel 0, 0 (index 3) and 3, 0 (index 1)
+const uint8_t etcIndicesMostlyZero[4] = {0x00, 0x01, 0x10, 0x01};
+// row y uses index y
+const uint8_t etcIndicesByRow[4] = {0xcc, 0xcc, 0xaa, 0xaa};
+
+std::vector<uint8_t> EtcBlock(std::vector<uint8_t> colors,
+                              const uint8_t indices[4]) {
+  colors.insert(colors.end(), indices, indices + 4);
+  return colors;
+}
+
+// Individual mode: red and blue halves with modifier tables 0 and 7
+std::vector<uint8_t> EtcIndividualBlock() {
+  return EtcBlock({0xf0, 0x00, 0x0f, 0x1c}, etcIndicesMostlyZero);
+}
+
+std::vector<Pixel> EtcIndividualPixels() {
+  std::vector<Pixel> pixels =
+      Columns({255, 2, 2, 255}, {255, 2, 2, 255}, {47, 47, 255, 255},
+              {47, 47, 255, 255});
+  pixels[0] = {247, 0, 0, 255};
+  pixels[3] = {183, 183, 255, 255};
+  return pixels;
+}
+
+TEST(KromCompressedTest, Etc2Individual) {
+  ExpectPixels(Decode(KROM_BLOCK_ETC2_RGB, EtcIndividualBlock()),
+               EtcIndividualPixels());
+}
+
+TEST(KromCompressedTest, Etc2DifferentialFlipped) {
+  // Base colors 16, 0, 31 and 12, 3, 31 in 5 bits, split into top and bottom,
+  // every pixel at index 2
+  ExpectPixels(Decode(KROM_BLOCK_ETC2_RGB,
+                      {0x84, 0x03, 0xf8, 0x57, 0xff, 0xff, 0x00, 0x00}),
+               Rows({123, 0, 246, 255}, {123, 0, 246, 255}, {75, 0, 231, 255},
+                    {75, 0, 231, 255}));
+}
+
+TEST(KromCompressedTest, Etc2TMode) {
+  // Red overflows: red and gray 8, 8, 8 at distance 32
+  ExpectPixels(
+      Decode(KROM_BLOCK_ETC2_RGB,
+             EtcBlock({0xfb, 0x00, 0x88, 0x8b}, etcIndicesByRow)),
+      Rows({255, 0, 0, 255}, {168, 168, 168, 255}, {136, 136, 136, 255},
+           {104, 104, 104, 255}));
+}
+
+TEST(KromCompressedTest, Etc2HMode) {
+  // Green overflows: 4, 2, 6 and 2, 10, 12 at distance 32, picked by the
+  // order of the two colors
+  ExpectPixels(
+      Decode(KROM_BLOCK_ETC2_RGB,
+             EtcBlock({0x21, 0x07, 0x15, 0x66}, etcIndicesByRow)),
+      Rows({100, 66, 134, 255}, {36, 2, 70, 255}, {66, 202, 236, 255},
+           {2, 138, 172, 255}));
+}
+
+TEST(KromCompressedTest, Etc2Planar) {
+  // Blue overflows: origin 130, 129, 65, horizontal 255, 255, 0 and
+  // vertical 0, 64, 255
+  std::vector<uint8_t> out = Decode(
+      KROM_BLOCK_ETC2_RGB, {0x41, 0x00, 0x14, 0x7f, 0xfe, 0x00, 0x08, 0x3f});
+  const int origin[3] = {130, 129, 65};
+  const int horizontal[3] = {255, 255, 0};
+  const int vertical[3] = {0, 64, 255};
+  std::vector<Pixel> expected;
+  for (int y = 0; y < 4; ++y) {
+    for (int x = 0; x < 4; ++x) {
+      int channels[3];
+      for (int c = 0; c < 3; ++c) {
+        int value = (x * (horizontal[c] - origin[c]) +
+                     y * (vertical[c] - origin[c]) + 4 * origin[c] + 2) >> 2;
+        channels[c] = value < 0 ? 0 : (value > 255 ? 255 : value);
+      }
+      expected.push_back({channels[0], channels[1], channels[2], 255});
+    }
+  }
+  ExpectPixels(out, expected);
+}
+
+TEST(KromCompressedTest, Etc2PunchthroughOpaque) {
+  // With the opaque bit set the block decodes like ETC2 RGB
+  ExpectPixels(Decode(KROM_BLOCK_ETC2_RGBA1,
+                      {0x84, 0x03, 0xf8, 0x57, 0xff, 0xff, 0x00, 0x00}),
+               Rows({123, 0, 246, 255}, {123, 0, 246, 255}, {75, 0, 231, 255},
+                    {75, 0, 231, 255}));
+}
+
+TEST(KromCompressedTest, Etc2PunchthroughTransparent) {
+  // Without it index 2 is transparent black and index 0 has no modifier
+  ExpectPixels(
+      Decode(KROM_BLOCK_ETC2_RGBA1,
+             EtcBlock({0x84, 0x03, 0xf8, 0x55}, etcIndicesByRow)),
+      Rows({132, 0, 255, 255}, {161, 29, 255, 255}, {0, 0, 0, 0},
+           {19, 0, 175, 255}));
+}
+
+TEST(KromCompressedTest, Etc2PunchthroughTMode) {
+  ExpectPixels(
+      Decode(KROM_BLOCK_ETC2_RGBA1,
+             EtcBlock({0xfb, 0x00, 0x88, 0x89}, etcIndicesByRow)),
+      Rows({255, 0, 0, 255}, {168, 168, 168, 255}, {0, 0, 0, 0},
+           {104, 104, 104, 255}));
+}
+
+TEST(KromCompressedTest, Etc2Eac) {
+  // Alpha index i % 8 for pixel i counted column by column, modifier table 0
+  const int modifiers[8] = {-3, -6, -9, -15, 2, 5, 8, 14};
+  const struct {
+    int base, multiplier;
+  } alphas[] = {{128, 3}, {250, 15}};
+  for (const auto& alpha : alphas) {
+    SCOPED_TRACE(testing::Message() << "base " << alpha.base);
+    std::vector<uint8_t> block = {(uint8_t)alpha.base,
+                                  (uint8_t)(alpha.multiplier << 4), 0x05, 0x39,
+                                  0x77, 0x05, 0x39, 0x77};
+    std::vector<uint8_t> color = EtcIndividualBlock();
+    block.insert(block.end(), color.begin(), color.end());
+
+    std::vector<Pixel> expected = EtcIndividualPixels();
+    for (int i = 0; i < 16; ++i) {
+      int value = alpha.base + modifiers[((i % 4) * 4 + i / 4) % 8] *
+                                   alpha.multiplier;
+      expected[i].a = value < 0 ? 0 : (value > 255 ? 255 : value);
+    }
+    ExpectPixels(Decode(KROM_BLOCK_ETC2_RGBA, block), expected);
+  }
+}
+
+// A DDS file with a DX10 header and two levels of blocks of 8 bytes.
+std::vector<uint8_t> Dds(int width, int height, uint32_t dxgiFormat,
+                         uint32_t resourceDimension, uint32_t miscFlag,
+                         uint32_t arraySize) {
+  std::vector<uint8_t> file(148);
+  auto write = [&](size_t offset, uint32_t value) {
+    memcpy(&file[offset], &value, 4);
+  };
+  memcpy(&file[0], "DDS ", 4);
+  write(4, 124);
+  write(12, height);
+  write(16, width);
+  write(28, 2);    // levels
+  write(80, 0x4);  // fourCC
+  memcpy(&file[84], "DX10", 4);
+  write(128, dxgiFormat);
+  write(132, resourceDimension);
+  write(136, miscFlag);
+  write(140, arraySize);
+  auto levelSize = [](int width, int height) {
+    return ((width + 3) / 4) * ((height + 3) / 4) * 8;
+  };
+  file.resize(file.size() + levelSize(width, height) +
+              levelSize(width / 2, height / 2));
+  return file;
+}
+
+TEST(KromCompressedTest, DdsDx10Header) {
+  KromCompressedImage image;
+  std::vector<uint8_t> file = Dds(8, 4, 71, 3, 0, 1);
+  ASSERT_TRUE(parseCompressedImage(file.data(), file.size(), &image));
+  EXPECT_EQ(image.format, KROM_BLOCK_BC1);
+  EXPECT_EQ(image.levelCount, 2);
+  EXPECT_EQ(image.levels[0].size, 16u);
+  EXPECT_EQ(image.levels[0].data, &file[148]);
+  EXPECT_EQ(image.levels[1].size, 8u);
+  EXPECT_EQ(image.levels[1].data, &file[164]);
+
+  // Array size 0 is read as 1
+  file = Dds(8, 4, 71, 3, 0, 0);
+  EXPECT_TRUE(parseCompressedImage(file.data(), file.size(), &image));
+}
+
+TEST(KromCompressedTest, DdsRejectsAnythingButOne2DTexture) {
+  KromCompressedImage image;
+  std::vector<uint8_t> file = Dds(8, 4, 71, 3, 0x4, 1);  // cube map
+  EXPECT_FALSE(parseCompressedImage(file.data(), file.size(), &image));
+  file = Dds(8, 4, 71, 3, 0, 6);  // array
+  EXPECT_FALSE(parseCompressedImage(file.data(), file.size(), &image));
+  file = Dds(8, 4, 71, 4, 0, 1);  // 3D
+  EXPECT_FALSE(parseCompressedImage(file.data(), file.size(), &image));
+  file = Dds(8, 4, 71, 3, 0, 1);
+  file.resize(147);
+  EXPECT_FALSE(parseCompressedImage(file.data(), file.size(), &image));
+}
+
+TEST(KromCompressedTest, DdsRejectsHugeSizes) {
+  KromCompressedImage image;
+  std::vector<uint8_t> file = Dds(4, 4, 71, 3, 0, 1);
+  uint32_t huge = 0x80000000u;
+  memcpy(&file[16], &huge, 4);
+  EXPECT_FALSE(parseCompressedImage(file.data(), file.size(), &image));
+  huge = 0x20000;
+  memcpy(&file[12], &huge, 4);
+  EXPECT_FALSE(parseCompressedImage(file.data(), file.size(), &image));
+}
+
+}  // namespace
@@ -0,0 +1,506 @@
+#include "krom/render_state.h"
+
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+// Stand-ins for kinc's texture unit and constant location, which the state
+// only compares by their bytes.
+struct Unit {
+  int stages[6];
+};
+
+struct Location {
+  int vertex;
+  int fragment;
+};
+
+// A resource is its address and how often that address was released before,
+// so that a resource created where a released one was is a new binding.
+struct Binding {
+  const void* address;
+  int generation;  // -1 while nothing is bound
+
+  bool operator==(const Binding& other) const {
+    return address == other.address && generation == other.generation;
+  }
+};
+
+const Binding kUnbound = { nullptr, -1 };
+
+std::string Key(const void* data, size_t size) {
+  return std::string(static_cast<const char*>(data), size);
+}
+
+size_t UniformBytes(KromUniformType type, int count) {
+  switch (type) {
+    case KROM_UNIFORM_FLOAT2: return 8;
+    case KROM_UNIFORM_FLOAT3: return 12;
+    case KROM_UNIFORM_FLOAT4: return 16;
+    case KROM_UNIFORM_FLOATS: return count * sizeof(float);
+    case KROM_UNIFORM_MATRIX3: return 9 * sizeof(float);
+    case KROM_UNIFORM_MATRIX4: return 16 * sizeof(float);
+    default: return 4;
+  }
+}
+
+struct Uniform {
+  KromUniformType type;
+  std::string data;
+
+  bool operator==(const Uniform& other) const {
+    return type == other.type && data == other.data;
+  }
+};
+
+// What a draw would see.
+struct BoundState {
+  Binding pipeline;
+  Binding index_buffer;
+  std::vector<Binding> vertex_buffers;
+  std::map<std::string, Binding> textures;
+  std::map<std::string, std::vector<int>> parameters;
+  std::map<std::string, Uniform> uniforms;  // of the bound pipeline
+};
+
+// A graphics backend that records what is bound. Uniform values belong to the
+// pipeline they were set for, as with GL programs.
+class RecordingBackend {
+ public:
+  explicit RecordingBackend(std::map<const void*, int>* generations)
+      : generations_(generations) { DropAll(); }
+
+  void SetPipeline(void* pipeline) {
+    ++calls_;
+    pipeline_ = Bind(pipeline);
+  }
+
+  void SetIndexBuffer(void* buffer) {
+    ++calls_;
+    index_buffer_ = Bind(buffer);
+  }
+
+  void SetVertexBuffers(void** buffers, int count) {
+    ++calls_;
+    vertex_buffers_.clear();
+    for (int i = 0; i < count; ++i)
+      vertex_buffers_.push_back(Bind(buffers[i]));
+  }
+
+  void SetTexture(const void* unit, void* texture) {
+    ++calls_;
+    textures_[Key(unit, sizeof(Unit))] = Bind(texture);
+  }
+
+  void SetTextureParameters(const void* unit, const int parameters[5]) {
+    ++calls_;
+    parameters_[Key(unit, sizeof(Unit))].assign(parameters, parameters + 5);
+  }
+
+  void SetUniform(const void* location, KromUniformType type,
+                  const void* data, int count) {
+    ++calls_;
+    uniforms_[std::make_pair(pipeline_.address, pipeline_.generation)]
+             [Key(location, sizeof(Location))] =
+        { type, Key(data, UniformBytes(type, count)) };
+  }
+
+  // What drivers may do behind Krom's back.
+  void DropAll() {
+    pipeline_ = kUnbound;
+    textures_.clear();
+    parameters_.clear();
+    DropBuffers();
+  }
+
+  void DropBuffers() {
+    index_buffer_ = kUnbound;
+    vertex_buffers_.clear();
+  }
+
+  void DropTextures() {
+    textures_.clear();
+    parameters_.clear();
+  }
+
+  BoundState Bound() const {
+    BoundState state { pipeline_, index_buffer_, vertex_buffers_, textures_,
+                       parameters_, {} };
+    auto it = uniforms_.find(
+        std::make_pair(pipeline_.address, pipeline_.generation));
+    if (it != uniforms_.end())
+      state.uniforms = it->second;
+    return state;
+  }
+
+  int calls() const { return calls_; }
+
+ private:
+  Binding Bind(const void* address) {
+    return { address, (*generations_)[address] };
+  }
+
+  std::map<const void*, int>* generations_;
+  int calls_ = 0;
+  Binding pipeline_;
+  Binding index_buffer_;
+  std::vector<Binding> vertex_buffers_;
+  std::map<std::string, Binding> textures_;
+  std::map<std::string, std::vector<int>> parameters_;
+  std::map<std::pair<const void*, int>, std::map<std::string, Uniform>>
+      uniforms_;
+};
+
+RecordingBackend* recording = nullptr;
+
+const KromRenderCalls kRecordingCalls = {
+  [](void* pipeline) { recording->SetPipeline(pipeline); },
+  [](void* buffer) { recording->SetIndexBuffer(buffer); },
+  [](void** buffers, int count) {
+    recording->SetVertexBuffers(buffers, count);
+  },
+  [](const void* unit, void* texture) { recording->SetTexture(unit, texture); },
+  [](const void* unit, const int parameters[5]) {
+    recording->SetTextureParameters(unit, parameters);
+  },
+  [](const void* location, KromUniformType type, const void* data,
+     int count) {
+    recording->SetUniform(location, type, data, count);
+  },
+};
+
+void ExpectSameState(const BoundState& expected, const BoundState& actual) {
+  EXPECT_TRUE(expected.pipeline == actual.pipeline);
+  EXPECT_TRUE(expected.index_buffer == actual.index_buffer);
+  EXPECT_TRUE(expected.vertex_buffers == actual.vertex_buffers);
+  EXPECT_TRUE(expected.textures == actual.textures);
+  EXPECT_TRUE(expected.parameters == actual.parameters);
+  EXPECT_TRUE(expected.uniforms == actual.uniforms);
+}
+
+// Replays a call stream the way main.cpp issues it: every call goes straight
+// to a reference backend, and through the shadow state to a recording one.
+// Whatever reaches the recording backend has to leave it in the state the
+// reference is in.
+class Replay {
+ public:
+  Replay() : reference_(&generations_), filtered_(&generations_) {
+    recording = &filtered_;
+    initRenderState(&kRecordingCalls, sizeof(Unit), sizeof(Location));
+  }
+
+  ~Replay() { recording = nullptr; }
+
+  void Pipeline(void* pipeline) {
+    reference_.SetPipeline(pipeline);
+    bindPipeline(pipeline);
+  }
+
+  void IndexBuffer(void* buffer) {
+    reference_.SetIndexBuffer(buffer);
+    bindIndexBuffer(buffer);
+  }
+
+  void VertexBuffers(std::vector<void*> buffers) {
+    int count = static_cast<int>(buffers.size());
+    reference_.SetVertexBuffers(buffers.data(), count);
+    bindVertexBuffers(buffers.data(), count);
+  }
+
+  void Texture(const Unit& unit, void* texture) {
+    reference_.SetTexture(&unit, texture);
+    bindTexture(&unit, texture);
+  }
+
+  void TextureParameters(const Unit& unit, std::vector<int> parameters) {
+    reference_.SetTextureParameters(&unit, parameters.data());
+    bindTextureParameters(&unit, parameters.data());
+  }
+
+  void SetUniform(const Location& location, KromUniformType type,
+                  std::vector<float> values) {
+    int count = static_cast<int>(values.size());
+    reference_.SetUniform(&location, type, values.data(), count);
+    bindUniform(&location, type, values.data(), count);
+  }
+
+  // krom_set_render_target binds past the shadow state.
+  void RenderTargetAsTexture(const Unit& unit, void* render_target) {
+    reference_.SetTexture(&unit, render_target);
+    filtered_.SetTexture(&unit, render_target);
+    forgetTexture(&unit);
+  }
+
+  void SwitchRenderTarget() {
+    reference_.DropAll();
+    filtered_.DropAll();
+    invalidateGraphicsState();
+  }
+
+  void LockBuffer() {
+    reference_.DropBuffers();
+    filtered_.DropBuffers();
+    invalidateBufferState();
+  }
+
+  void LockTexture() {
+    reference_.DropTextures();
+    filtered_.DropTextures();
+    invalidateTextureState();
+  }
+
+  // The next resource created at the address is a different one.
+  void Release(const void* address) {
+    ++generations_[address];
+    invalidateGraphicsState();
+  }
+
+  void DeletePipeline(void* pipeline) {
+    forgetPipeline(pipeline);
+    ++generations_[pipeline];
+  }
+
+  void Draw() {
+    ++draws_;
+    SCOPED_TRACE(testing::Message() << "draw " << draws_);
+    ExpectSameState(reference_.Bound(), filtered_.Bound());
+  }
+
+  int reference_calls() const { return reference_.calls(); }
+  int filtered_calls() const { return filtered_.calls(); }
+
+ private:
+  std::map<const void*, int> generations_;
+  RecordingBackend reference_;
+  RecordingBackend filtered_;
+  int draws_ = 0;
+};
+
+int pipelines[3];
+int buffers[3];
+int textures[3];
+int render_targets[2];
+const Unit kUnits[2] = { {{0, 1, -1, -1, -1, -1}}, {{1, 2, -1, -1, -1, -1}} };
+const Location kLocations[2] = { {0, 4}, {16, -1} };
+
+}  // namespace
+
+TEST(KromRenderStateTest, SkipsRepeatedCalls) {
+  Replay replay;
+  for (int i = 0; i < 3; ++i) {
+    replay.Pipeline(&pipelines[0]);
+    replay.IndexBuffer(&buffers[0]);
+    replay.VertexBuffers({&buffers[1], &buffers[2]});
+    replay.Texture(kUnits[0], &textures[0]);
+    replay.TextureParameters(kUnits[0], {0, 0, 1, 1, 0});
+    replay.SetUniform(kLocations[0], KROM_UNIFORM_FLOAT2, {1, 2});
+    replay.SetUniform(kLocations[1], KROM_UNIFORM_MATRIX4,
+                      std::vector<float>(16, 0.5f));
+    replay.Draw();
+  }
+  EXPECT_EQ(replay.reference_calls(), 3 * 7);
+  EXPECT_EQ(replay.filtered_calls(), 7);
+  EXPECT_EQ(takeFilteredRenderCalls(), 2 * 7);
+  EXPECT_EQ(takeFilteredRenderCalls(), 0);
+}
+
+TEST(KromRenderStateTest, SendsChangedValues) {
+  Replay replay;
+  replay.Pipeline(&pipelines[0]);
+  replay.SetUniform(kLocations[0], KROM_UNIFORM_FLOAT, {1});
+  replay.SetUniform(kLocations[0], KROM_UNIFORM_FLOAT, {2});
+  // Same bytes, other type.
+  replay.SetUniform(kLocations[0], KROM_UNIFORM_INT, {2});
+  replay.TextureParameters(kUnits[0], {0, 0, 1, 1, 0});
+  replay.TextureParameters(kUnits[0], {0, 0, 1, 1, 1});
+  replay.VertexBuffers({&buffers[1], &buffers[2]});
+  replay.VertexBuffers({&buffers[1]});
+  // Floats are never filtered.
+  replay.SetUniform(kLocations[1], KROM_UNIFORM_FLOATS, {1, 2, 3});
+  replay.SetUniform(kLocations[1], KROM_UNIFORM_FLOATS, {1, 2, 3});
+  replay.Draw();
+  EXPECT_EQ(replay.filtered_calls(), replay.reference_calls());
+  EXPECT_EQ(takeFilteredRenderCalls(), 0);
+}
+
+TEST(KromRenderStateTest, BindsAgainAfterPipelineChange) {
+  Replay replay;
+  replay.Pipeline(&pipelines[0]);
+  replay.Texture(kUnits[0], &textures[0]);
+  replay.SetUniform(kLocations[0], KROM_UNIFORM_FLOAT, {1});
+  replay.Pipeline(&pipelines[1]);
+  replay.Texture(kUnits[0], &textures[0]);
+  replay.SetUniform(kLocations[0], KROM_UNIFORM_FLOAT, {1});
+  replay.Draw();
+  EXPECT_EQ(replay.filtered_calls(), 6);
+}
+
+TEST(KromRenderStateTest, BindsAgainAfterLocks) {
+  Replay replay;
+  replay.IndexBuffer(&buffers[0]);
+  replay.VertexBuffers({&buffers[1]});
+  replay.Texture(kUnits[0], &textures[0]);
+  replay.LockBuffer();
+  replay.IndexBuffer(&buffers[0]);
+  replay.VertexBuffers({&buffers[1]});
+  replay.Texture(kUnits[0], &textures[0]);
+  replay.Draw();
+  EXPECT_EQ(replay.filtered_calls(), 5);
+
+  replay.LockTexture();
+  replay.IndexBuffer(&buffers[0]);
+  replay.Texture(kUnits[0], &textures[0]);
+  replay.Draw();
+  EXPECT_EQ(replay.filtered_calls(), 6);
+}
+
+TEST(KromRenderStateTest, BindsAgainAfterRenderTargetSwitch) {
+  Replay replay;
+  replay.Pipeline(&pipelines[0]);
+  replay.IndexBuffer(&buffers[0]);
+  replay.VertexBuffers({&buffers[1]});
+  replay.Texture(kUnits[0], &textures[0]);
+  replay.TextureParameters(kUnits[0], {0, 0, 1, 1, 0});
+  replay.SetUniform(kLocations[0], KROM_UNIFORM_BOOL, {1});
+  replay.SwitchRenderTarget();
+  replay.Draw();
+  replay.Pipeline(&pipelines[0]);
+  replay.IndexBuffer(&buffers[0]);
+  replay.VertexBuffers({&buffers[1]});
+  replay.Texture(kUnits[0], &textures[0]);
+  replay.TextureParameters(kUnits[0], {0, 0, 1, 1, 0});
+  replay.SetUniform(kLocations[0], KROM_UNIFORM_BOOL, {1});
+  replay.Draw();
+  EXPECT_EQ(replay.filtered_calls(), replay.reference_calls());
+}
+
+TEST(KromRenderStateTest, BindsAgainAfterRelease) {
+  Replay replay;
+  replay.Pipeline(&pipelines[0]);
+  replay.Texture(kUnits[0], &textures[0]);
+  replay.IndexBuffer(&buffers[0]);
+  replay.Draw();
+  // A new texture and buffer at the addresses of the released ones.
+  replay.Release(&textures[0]);
+  replay.Release(&buffers[0]);
+  replay.Pipeline(&pipelines[0]);
+  replay.Texture(kUnits[0], &textures[0]);
+  replay.IndexBuffer(&buffers[0]);
+  replay.Draw();
+  EXPECT_EQ(replay.filtered_calls(), 6);
+
+  // Deleting the bound pipeline forgets everything, deleting another one
+  // leaves the bindings alone.
+  replay.DeletePipeline(&pipelines[1]);
+  replay.Pipeline(&pipelines[0]);
+  replay.DeletePipeline(&pipelines[0]);
+  replay.Pipeline(&pipelines[0]);
+  replay.Draw();
+  EXPECT_EQ(replay.filtered_calls(), 7);
+}
+
+TEST(KromRenderStateTest, BindsAgainAfterRenderTargetTexture) {
+  Replay replay;
+  replay.Texture(kUnits[0], &textures[0]);
+  replay.Texture(kUnits[1], &textures[1]);
+  replay.RenderTargetAsTexture(kUnits[0], &render_targets[0]);
+  replay.Draw();
+  replay.Texture(kUnits[0], &textures[0]);
+  replay.Texture(kUnits[1], &textures[1]);
+  replay.Draw();
+  EXPECT_EQ(replay.filtered_calls(), 4);
+}
+
+TEST(KromRenderStateTest, NullIsNotARepeat) {
+  Replay replay;
+  replay.Pipeline(nullptr);
+  replay.IndexBuffer(nullptr);
+  replay.VertexBuffers({});
+  replay.Texture(kUnits[0], nullptr);
+  replay.Draw();
+  EXPECT_EQ(replay.filtered_calls(), 4);
+  replay.SwitchRenderTarget();
+  replay.Pipeline(nullptr);
+  replay.Texture(kUnits[0], nullptr);
+  replay.Draw();
+  EXPECT_EQ(replay.filtered_calls(), 6);
+}
+
+TEST(KromRenderStateTest, ReplaysRandomStreams) {
+  std::mt19937 random(27);
+  auto pick = [&](int count) {
+    return std::uniform_int_distribution<int>(0, count - 1)(random);
+  };
+  const KromUniformType types[] = {
+    KROM_UNIFORM_BOOL, KROM_UNIFORM_INT, KROM_UNIFORM_FLOAT,
+    KROM_UNIFORM_FLOAT2, KROM_UNIFORM_FLOAT3, KROM_UNIFORM_FLOAT4,
+    KROM_UNIFORM_FLOATS, KROM_UNIFORM_MATRIX3, KROM_UNIFORM_MATRIX4
+  };
+
+  for (int stream = 0; stream < 20; ++stream) {
+    SCOPED_TRACE(testing::Message() << "stream " << stream);
+    Replay replay;
+    for (int i = 0; i < 2000; ++i) {
+      switch (pick(16)) {
+        case 0:
+        case 1:
+          replay.Pipeline(&pipelines[pick(3)]);
+          break;
+        case 2:
+          replay.IndexBuffer(&buffers[pick(3)]);
+          break;
+        case 3: {
+          std::vector<void*> bound;
+          for (int count = pick(3); count > 0; --count)
+            bound.push_back(&buffers[pick(3)]);
+          replay.VertexBuffers(bound);
+          break;
+        }
+        case 4:
+        case 5:
+          replay.Texture(kUnits[pick(2)], &textures[pick(3)]);
+          break;
+        case 6:
+          replay.TextureParameters(kUnits[pick(2)],
+                                   {pick(2), 0, pick(2), 1, 0});
+          break;
+        case 7:
+        case 8: {
+          KromUniformType type = types[pick(9)];
+          size_t floats = UniformBytes(type, 2) / sizeof(float);
+          std::vector<float> values(floats, static_cast<float>(pick(2)));
+          replay.SetUniform(kLocations[pick(2)], type, values);
+          break;
+        }
+        case 9:
+          replay.RenderTargetAsTexture(kUnits[pick(2)],
+                                       &render_targets[pick(2)]);
+          break;
+        case 10:
+          switch (pick(5)) {
+            case 0: replay.SwitchRenderTarget(); break;
+            case 1: replay.LockBuffer(); break;
+            case 2: replay.LockTexture(); break;
+            case 3: replay.Release(&textures[pick(3)]); break;
+            case 4: replay.DeletePipeline(&pipelines[pick(3)]); break;
+          }
+          break;
+        default:
+          replay.Draw();
+          break;
+      }
+      if (HasFailure()) return;
+    }
+    replay.Draw();
+    EXPECT_LT(replay.filtered_calls(), replay.reference_calls());
+    EXPECT_EQ(takeFilteredRenderCalls(),
+              replay.reference_calls() - replay.filtered_calls());
+  }
+}
@@ -0,0 +1,260 @@
+#include "krom/streaming_policy.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+int LevelCount(int width, int height) {
+  int levels = 1;
+  while (width > 1 || height > 1) {
+    width = width > 1 ? width / 2 : 1;
+    height = height > 1 ? height / 2 : 1;
+    ++levels;
+  }
+  return levels;
+}
+
+// Runs the policy the way the runtime does: evictions apply right away,
+// loads land `latency` frames after they were planned.
+class StreamingSimulation {
+ public:
+  explicit StreamingSimulation(size_t budget, int latency = 2)
+      : budget_(budget), latency_(latency) {}
+
+  int Add(int width, int height, int priority = 0) {
+    KromStreamingState state;
+    state.width = width;
+    state.height = height;
+    state.levelCount = LevelCount(width, height);
+    state.residentLevel = state.levelCount - 1;
+    state.loadingLevel = -1;
+    state.finestLevel = 0;
+    state.priority = priority;
+    state.lastUsedFrame = -1;
+    states_.push_back(state);
+    finish_frames_.push_back(0);
+    return static_cast<int>(states_.size()) - 1;
+  }
+
+  void Use(int texture) { states_[texture].lastUsedFrame = frame_; }
+
+  void Step() {
+    for (size_t i = 0; i < states_.size(); ++i) {
+      if (states_[i].loadingLevel >= 0 && finish_frames_[i] <= frame_) {
+        states_[i].residentLevel = states_[i].loadingLevel;
+        states_[i].loadingLevel = -1;
+      }
+    }
+    std::vector<KromStreamingAction> actions(states_.size());
+    int count = planTextureStreaming(states_.data(),
+                                     static_cast<int>(states_.size()),
+                                     budget_, frame_, 4, actions.data());
+    for (int i = 0; i < count; ++i) {
+      KromStreamingState* state = &states_[actions[i].texture];
+      trace_.push_back(
+          (static_cast<uint64_t>(frame_) << 32) |
+          (static_cast<uint64_t>(actions[i].texture) << 8) |
+          static_cast<uint64_t>(actions[i].level));
+      if (actions[i].level > state->residentLevel) {
+        state->residentLevel = actions[i].level;
+      } else {
+        state->loadingLevel = actions[i].level;
+        finish_frames_[actions[i].texture] = frame_ + latency_;
+      }
+    }
+    ++frame_;
+  }
+
+  size_t Committed() const {
+    size_t bytes = 0;
+    for (const KromStreamingState& state : states_)
+      bytes += streamingCommittedBytes(&state);
+    return bytes;
+  }
+
+  const KromStreamingState& State(int texture) const {
+    return states_[texture];
+  }
+  void SetBudget(size_t budget) { budget_ = budget; }
+  void SetFinestLevel(int texture, int level) {
+    states_[texture].finestLevel = level;
+  }
+  const std::vector<uint64_t>& Trace() const { return trace_; }
+
+ private:
+  std::vector<KromStreamingState> states_;
+  std::vector<int> finish_frames_;
+  std::vector<uint64_t> trace_;
+  size_t budget_;
+  int latency_;
+  int frame_ = 0;
+};
+
+size_t FullChain(int size) {
+  KromStreamingState state = {};
+  state.width = size;
+  state.height = size;
+  state.levelCount = LevelCount(size, size);
+  return streamingChainBytes(&state, 0);
+}
+
+// The usage pattern and texture sizes of a small scene, from a fixed LCG
+std::vector<uint64_t> RunRandomScene(size_t budget, bool check_budget) {
+  StreamingSimulation simulation(budget, 3);
+  uint32_t seed = 12345;
+  auto next = [&seed]() {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+  };
+  const int textures = 48;
+  for (int i = 0; i < textures; ++i)
+    simulation.Add(64 << (next() % 5), 64 << (next() % 5), next() % 3);
+
+  for (int frame = 0; frame < 600; ++frame) {
+    // A camera slowly panning across the scene
+    int first = (frame / 20) % textures;
+    for (int i = 0; i < 8; ++i)
+      simulation.Use((first + i) % textures);
+    if (next() % 4 == 0) simulation.Use(next() % textures);
+    simulation.Step();
+    if (check_budget) {
+      EXPECT_LE(simulation.Committed(), budget);
+    }
+  }
+  return simulation.Trace();
+}
+
+}  // namespace
+
+TEST(KromStreamingTest, ChainBytes) {
+  KromStreamingState state = {};
+  state.width = 4;
+  state.height = 2;
+  state.levelCount = LevelCount(4, 2);
+  EXPECT_EQ(3, state.levelCount);
+  EXPECT_EQ((8u + 2u + 1u) * 4u, streamingChainBytes(&state, 0));
+  EXPECT_EQ(4u, streamingChainBytes(&state, 2));
+  EXPECT_EQ(0u, streamingChainBytes(&state, 3));
+}
+
+TEST(KromStreamingTest, LoadsFullResolutionWithinBudget) {
+  StreamingSimulation simulation(4 * FullChain(256));
+  int textures[4];
+  for (int& texture : textures) texture = simulation.Add(256, 256);
+  for (int frame = 0; frame < 4; ++frame) {
+    for (int texture : textures) simulation.Use(texture);
+    simulation.Step();
+  }
+  for (int texture : textures)
+    EXPECT_EQ(0, simulation.State(texture).residentLevel);
+  EXPECT_EQ(4 * FullChain(256), simulation.Committed());
+}
+
+TEST(KromStreamingTest, UnusedTexturesStayLow) {
+  StreamingSimulation simulation(FullChain(1024));
+  int used = simulation.Add(256, 256);
+  int unused = simulation.Add(256, 256);
+  for (int frame = 0; frame < 4; ++frame) {
+    simulation.Use(used);
+    simulation.Step();
+  }
+  EXPECT_EQ(0, simulation.State(used).residentLevel);
+  EXPECT_EQ(simulation.State(unused).levelCount - 1,
+            simulation.State(unused).residentLevel);
+}
+
+TEST(KromStreamingTest, EvictsLeastRecentlyUsed) {
+  const int tail = 1;
+  StreamingSimulation simulation(2 * FullChain(256) + 4 * tail);
+  int a = simulation.Add(256, 256);
+  int b = simulation.Add(256, 256);
+  int c = simulation.Add(256, 256);
+
+  simulation.Use(a);
+  simulation.Use(b);
+  for (int frame = 0; frame < 3; ++frame) simulation.Step();
+  ASSERT_EQ(0, simulation.State(a).residentLevel);
+  ASSERT_EQ(0, simulation.State(b).residentLevel);
+
+  // b was bound later than a, so a makes room for c
+  simulation.Use(b);
+  simulation.Step();
+  simulation.Use(c);
+  simulation.Step();
+  EXPECT_EQ(0, simulation.State(c).loadingLevel);
+  EXPECT_EQ(0, simulation.State(b).residentLevel);
+  EXPECT_EQ(simulation.State(a).levelCount - 1,
+            simulation.State(a).residentLevel);
+}
+
+TEST(KromStreamingTest, DoesNotEvictMoreRecentTextures) {
+  StreamingSimulation simulation(FullChain(256) + FullChain(64));
+  int recent = simulation.Add(256, 256);
+  int old = simulation.Add(256, 256);
+  simulation.Use(recent);
+  for (int frame = 0; frame < 3; ++frame) simulation.Step();
+  ASSERT_EQ(0, simulation.State(recent).residentLevel);
+
+  // Bound in the same frame with the same priority, old only gets what is
+  // left instead of taking turns with recent
+  for (int frame = 0; frame < 3; ++frame) {
+    simulation.Use(recent);
+    simulation.Use(old);
+    simulation.Step();
+  }
+  EXPECT_EQ(0, simulation.State(recent).residentLevel);
+  EXPECT_EQ(2, simulation.State(old).residentLevel);
+}
+
+TEST(KromStreamingTest, PriorityDecidesWithinAFrame) {
+  StreamingSimulation simulation(FullChain(512) + FullChain(32));
+  int low = simulation.Add(512, 512, 0);
+  int high = simulation.Add(512, 512, 1);
+  for (int frame = 0; frame < 4; ++frame) {
+    simulation.Use(low);
+    simulation.Use(high);
+    simulation.Step();
+  }
+  EXPECT_EQ(0, simulation.State(high).residentLevel);
+  EXPECT_EQ(4, simulation.State(low).residentLevel);
+}
+
+TEST(KromStreamingTest, RespectsFinestLevel) {
+  StreamingSimulation simulation(FullChain(1024));
+  int texture = simulation.Add(1024, 1024);
+  simulation.SetFinestLevel(texture, 2);
+  for (int frame = 0; frame < 4; ++frame) {
+    simulation.Use(texture);
+    simulation.Step();
+  }
+  EXPECT_EQ(2, simulation.State(texture).residentLevel);
+}
+
+TEST(KromStreamingTest, LoweredBudgetEvicts) {
+  StreamingSimulation simulation(4 * FullChain(256));
+  int textures[4];
+  for (int& texture : textures) texture = simulation.Add(256, 256);
+  for (int frame = 0; frame < 4; ++frame) {
+    for (int texture : textures) simulation.Use(texture);
+    simulation.Step();
+  }
+  ASSERT_EQ(4 * FullChain(256), simulation.Committed());
+
+  simulation.SetBudget(FullChain(256));
+  simulation.Step();
+  EXPECT_LE(simulation.Committed(), FullChain(256));
+}
+
+TEST(KromStreamingTest, RandomSceneStaysWithinBudget) {
+  RunRandomScene(8 * 1024 * 1024, true);
+}
+
+TEST(KromStreamingTest, Deterministic) {
+  std::vector<uint64_t> first = RunRandomScene(4 * 1024 * 1024, false);
+  std::vector<uint64_t> second = RunRandomScene(4 * 1024 * 1024, false);
+  EXPECT_FALSE(first.empty());
+  EXPECT_EQ(first, second);
+}
@@ -0,0 +1,237 @@
+#include "module_stat_cache.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "uv.h"
+
+using node::fs::ModuleStatCache;
+
+namespace {
+
+class ModuleStatCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_EQ(0, uv_loop_init(&loop_));
+    char tmp[1024];
+    size_t size = sizeof(tmp);
+    ASSERT_EQ(0, uv_os_tmpdir(tmp, &size));
+    uv_fs_t req;
+    const std::string pattern = std::string(tmp) + "/module-stat-XXXXXX";
+    ASSERT_EQ(0, uv_fs_mkdtemp(&loop_, &req, pattern.c_str(), nullptr));
+    root_ = req.path;
+    uv_fs_req_cleanup(&req);
+  }
+
+  void TearDown() override {
+    Remove(root_);
+    ASSERT_EQ(0, uv_loop_close(&loop_));
+  }
+
+  std::string Path(const std::string& name) { return root_ + "/" + name; }
+
+  void WriteFile(const std::string& name) {
+    uv_fs_t req;
+    const int fd = uv_fs_open(&loop_, &req, Path(name).c_str(),
+                              UV_FS_O_WRONLY | UV_FS_O_CREAT, 0644, nullptr);
+    uv_fs_req_cleanup(&req);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(0, uv_fs_close(&loop_, &req, fd, nullptr));
+    uv_fs_req_cleanup(&req);
+  }
+
+  void MakeDirectory(const std::string& name) {
+    uv_fs_t req;
+    ASSERT_EQ(0, uv_fs_mkdir(&loop_, &req, Path(name).c_str(), 0755,
+                             nullptr));
+    uv_fs_req_cleanup(&req);
+  }
+
+  void Unlink(const std::string& name) {
+    uv_fs_t req;
+    ASSERT_EQ(0, uv_fs_unlink(&loop_, &req, Path(name).c_str(), nullptr));
+    uv_fs_req_cleanup(&req);
+  }
+
+  // Moves the times of a directory into the past, so that its listing is not
+  // considered racy and is kept.
+  void Age(const std::string& path) {
+    uv_timeval64_t now;
+    ASSERT_EQ(0, uv_gettimeofday(&now));
+    const double past = static_cast<double>(now.tv_sec) - 60;
+    uv_fs_t req;
+    ASSERT_EQ(0, uv_fs_utime(&loop_, &req, path.c_str(), past, past,
+                             nullptr));
+    uv_fs_req_cleanup(&req);
+  }
+
+  void Remove(const std::string& path) {
+    uv_fs_t req;
+    if (uv_fs_scandir(&loop_, &req, path.c_str(), 0, nullptr) >= 0) {
+      uv_dirent_t dirent;
+      while (uv_fs_scandir_next(&req, &dirent) != UV_EOF)
+        Remove(path + "/" + dirent.name);
+      uv_fs_req_cleanup(&req);
+      uv_fs_rmdir(&loop_, &req, path.c_str(), nullptr);
+    } else {
+      uv_fs_req_cleanup(&req);
+      uv_fs_unlink(&loop_, &req, path.c_str(), nullptr);
+    }
+    uv_fs_req_cleanup(&req);
+  }
+
+  int PlainStat(const std::string& path) {
+    uv_fs_t req;
+    int rc = uv_fs_stat(&loop_, &req, path.c_str(), nullptr);
+    if (rc == 0)
+      rc = !!(static_cast<uv_stat_t*>(req.ptr)->st_mode & S_IFDIR);
+    uv_fs_req_cleanup(&req);
+    return rc;
+  }
+
+  uv_loop_t loop_;
+  std::string root_;
+};
+
+}  // anonymous namespace
+
+TEST_F(ModuleStatCacheTest, MatchesStat) {
+  WriteFile("index.js");
+  WriteFile("lib.json");
+  MakeDirectory("node_modules");
+  Age(root_);
+  ModuleStatCache cache(&loop_);
+
+  const char* const names[] = {
+    "index", "index.js", "INDEX.JS", "lib.json", "lib", "node_modules",
+    "node_modules/a", "index.js/a", "missing/a", "missing/a/b", "",
+    ".", "..", "\xc3\xa9.js",
+  };
+  for (uint64_t pass : {0, 0, 1, 1, 2}) {
+    for (const char* name : names) {
+      SCOPED_TRACE(name);
+      EXPECT_EQ(PlainStat(Path(name)), cache.Stat(Path(name), pass));
+    }
+  }
+  EXPECT_EQ(PlainStat("/"), cache.Stat("/", 0));
+}
+
+TEST_F(ModuleStatCacheTest, FindsNewFiles) {
+  WriteFile("a.js");
+  Age(root_);
+  ModuleStatCache cache(&loop_);
+  for (uint64_t pass : {0, 1}) {
+    SCOPED_TRACE(pass);
+    EXPECT_EQ(0, cache.Stat(Path("a.js"), pass));
+    EXPECT_EQ(UV_ENOENT, cache.Stat(Path("b.js"), pass));
+    // A name that was missing is looked up again within the same pass.
+    WriteFile("b.js");
+    EXPECT_EQ(0, cache.Stat(Path("b.js"), pass));
+    Unlink("b.js");
+    Age(root_);
+  }
+}
+
+TEST_F(ModuleStatCacheTest, TrustsCheckedDirectoriesWithinPass) {
+  WriteFile("a.js");
+  WriteFile("b.js");
+  Age(root_);
+  ModuleStatCache cache(&loop_);
+  EXPECT_EQ(0, cache.Stat(Path("a.js"), 1));
+  EXPECT_EQ(0, cache.Stat(Path("b.js"), 1));
+  Unlink("b.js");
+  EXPECT_EQ(0, cache.Stat(Path("b.js"), 1));
+  // A new pass or no pass at all notices that the file is gone.
+  EXPECT_EQ(UV_ENOENT, cache.Stat(Path("b.js"), 0));
+  WriteFile("b.js");
+  EXPECT_EQ(0, cache.Stat(Path("b.js"), 2));
+  Unlink("b.js");
+  EXPECT_EQ(UV_ENOENT, cache.Stat(Path("b.js"), 3));
+}
+
+TEST_F(ModuleStatCacheTest, FollowsMissingDirectories) {
+  Age(root_);
+  ModuleStatCache cache(&loop_);
+  for (int i = 0; i < 3; i++)
+    EXPECT_EQ(UV_ENOENT, cache.Stat(Path("lib/index.js"), 1));
+  MakeDirectory("lib");
+  WriteFile("lib/index.js");
+  EXPECT_EQ(0, cache.Stat(Path("lib/index.js"), 2));
+  EXPECT_EQ(1, cache.Stat(Path("lib"), 2));
+}
+
+TEST_F(ModuleStatCacheTest, RecentDirectoriesAreNotListed) {
+  WriteFile("a.js");
+  ModuleStatCache cache(&loop_);
+  for (int i = 0; i < 3; i++) {
+    EXPECT_EQ(0, cache.Stat(Path("a.js"), 1));
+    EXPECT_EQ(UV_ENOENT, cache.Stat(Path("b.js"), 1));
+  }
+  WriteFile("b.js");
+  EXPECT_EQ(0, cache.Stat(Path("b.js"), 1));
+}
+
+#ifndef _WIN32
+TEST_F(ModuleStatCacheTest, StatsSymbolicLinks) {
+  WriteFile("a.js");
+  MakeDirectory("dir");
+  uv_fs_t req;
+  ASSERT_EQ(0, uv_fs_symlink(&loop_, &req, "a.js", Path("file-link").c_str(),
+                             0, nullptr));
+  uv_fs_req_cleanup(&req);
+  ASSERT_EQ(0, uv_fs_symlink(&loop_, &req, "dir", Path("dir-link").c_str(),
+                             0, nullptr));
+  uv_fs_req_cleanup(&req);
+  Age(root_);
+  ModuleStatCache cache(&loop_);
+  for (int i = 0; i < 3; i++) {
+    EXPECT_EQ(0, cache.Stat(Path("file-link"), 1));
+    EXPECT_EQ(1, cache.Stat(Path("dir-link"), 1));
+  }
+  // The target changes without changing the directory of the link.
+  Unlink("a.js");
+  EXPECT_EQ(UV_ENOENT, cache.Stat(Path("file-link"), 1));
+}
+#endif  // _WIN32
+
+TEST_F(ModuleStatCacheTest, KeepsOnlyListedDirectories) {
+  Age(root_);
+  ModuleStatCache cache(&loop_);
+  // Paths of the same length, so that the sizes compare.
+  EXPECT_EQ(UV_ENOENT, cache.Stat(Path("missing-10/index.js"), 1));
+  const size_t size = cache.SelfSize();
+  for (int i = 11; i < 100; i++) {
+    const std::string name = "missing-" + std::to_string(i) + "/index.js";
+    EXPECT_EQ(UV_ENOENT, cache.Stat(Path(name), 1));
+  }
+  EXPECT_EQ(size, cache.SelfSize());
+}
+
+TEST_F(ModuleStatCacheTest, DropsLeastRecentlyUsedListings) {
+  const size_t count = ModuleStatCache::kMaxListedDirectories + 1;
+  std::vector<std::string> names;
+  for (size_t i = 0; i < count; i++) {
+    char name[16];
+    snprintf(name, sizeof(name), "d%05zu", i);
+    names.push_back(name);
+    MakeDirectory(name);
+    Age(Path(name));
+  }
+  Age(root_);
+
+  ModuleStatCache cache(&loop_);
+  size_t full_size = 0;
+  for (size_t i = 0; i < count; i++) {
+    const std::string path = Path(names[i] + "/index.js");
+    for (int lookup = 0; lookup < 2; lookup++)
+      EXPECT_EQ(UV_ENOENT, cache.Stat(path, 1));
+    if (i == count - 2)
+      full_size = cache.SelfSize();
+  }
+  // Listing one more directory dropped the first one.
+  EXPECT_EQ(full_size, cache.SelfSize());
+  EXPECT_EQ(UV_ENOENT, cache.Stat(Path(names[0] + "/index.js"), 2));
+  EXPECT_EQ(1, cache.Stat(Path(names[0]), 2));
+}
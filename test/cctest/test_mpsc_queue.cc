@@ -0,0 +1,81 @@
+#include "mpsc_queue-inl.h"
+
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "uv.h"
+
+using node::MPSCQueue;
+
+TEST(MPSCQueueTest, PopsInOrder) {
+  MPSCQueue<std::unique_ptr<int>> queue;
+  std::unique_ptr<int> value;
+  EXPECT_FALSE(queue.Pop(&value));
+  EXPECT_EQ(queue.Peek(), nullptr);
+
+  for (int i = 0; i < 10; i++)
+    queue.Push(std::make_unique<int>(i));
+  EXPECT_EQ(queue.size(), 10u);
+  ASSERT_NE(queue.Peek(), nullptr);
+  EXPECT_EQ(**queue.Peek(), 0);
+
+  int sum = 0;
+  queue.ForEach([&](const std::unique_ptr<int>& value) { sum += *value; });
+  EXPECT_EQ(sum, 45);
+
+  for (int i = 0; i < 10; i++) {
+    ASSERT_TRUE(queue.Pop(&value));
+    EXPECT_EQ(*value, i);
+  }
+  EXPECT_FALSE(queue.Pop(&value));
+  EXPECT_EQ(queue.size(), 0u);
+}
+
+TEST(MPSCQueueTest, DestroysRemainingValues) {
+  auto value = std::make_shared<int>(42);
+  {
+    MPSCQueue<std::shared_ptr<int>> queue;
+    queue.Push(value);
+    queue.Push(value);
+    std::shared_ptr<int> popped;
+    ASSERT_TRUE(queue.Pop(&popped));
+    EXPECT_EQ(value.use_count(), 3);
+  }
+  EXPECT_EQ(value.use_count(), 1);
+}
+
+TEST(MPSCQueueTest, KeepsTheOrderOfEveryProducer) {
+  constexpr int kProducers = 4;
+  constexpr int kValuesPerProducer = 100000;
+  MPSCQueue<int> queue;
+
+  struct Producer {
+    MPSCQueue<int>* queue;
+    int index;
+    uv_thread_t thread;
+  };
+  std::vector<Producer> producers(kProducers);
+  for (int p = 0; p < kProducers; p++) {
+    producers[p] = { &queue, p, {} };
+    ASSERT_EQ(0, uv_thread_create(&producers[p].thread, [](void* data) {
+      Producer* producer = static_cast<Producer*>(data);
+      for (int i = 0; i < kValuesPerProducer; i++)
+        producer->queue->Push(producer->index * kValuesPerProducer + i);
+    }, &producers[p]));
+  }
+
+  std::vector<int> last(kProducers, -1);
+  for (int received = 0; received < kProducers * kValuesPerProducer;) {
+    int value;
+    if (!queue.Pop(&value)) continue;
+    const int producer = value / kValuesPerProducer;
+    ASSERT_EQ(value % kValuesPerProducer, last[producer] + 1);
+    last[producer]++;
+    received++;
+  }
+
+  for (Producer& producer : producers)
+    ASSERT_EQ(0, uv_thread_join(&producer.thread));
+  EXPECT_EQ(queue.size(), 0u);
+}
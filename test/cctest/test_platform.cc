@@ -1,6 +1,7 @@
 #include "node_internals.h"
 #include "libplatform/libplatform.h"
 
+#include <atomic>
 #include <string>
 #include "gtest/gtest.h"
 #include "node_test_fixture.h"
@@ -123,3 +124,108 @@ TEST_F(PlatformTest, TracingControllerNullptr) {
   node::SetTracingController(orig_controller);
   EXPECT_EQ(node::GetTracingController(), orig_controller);
 }
+
+// Counts its runs and posts |children| more of its kind to the same runner,
+// from whatever worker thread it ends up on.
+class CountingTask : public v8::Task {
+ public:
+  CountingTask(std::atomic<int>* run_count,
+               node::WorkerThreadsTaskRunner* runner,
+               int children)
+      : run_count_(run_count), runner_(runner), children_(children) {}
+
+  void Run() final {
+    run_count_->fetch_add(1, std::memory_order_relaxed);
+    for (int i = 0; i < children_; i++) {
+      runner_->PostTask(
+          std::make_unique<CountingTask>(run_count_, runner_, children_ - 1));
+    }
+  }
+
+ private:
+  std::atomic<int>* run_count_;
+  node::WorkerThreadsTaskRunner* runner_;
+  int children_;
+};
+
+struct PosterData {
+  node::WorkerThreadsTaskRunner* runner;
+  std::atomic<int>* run_count;
+  int tasks;
+  int children;
+};
+
+static void PostCountingTasks(void* arg) {
+  PosterData* data = static_cast<PosterData*>(arg);
+  for (int i = 0; i < data->tasks; i++) {
+    data->runner->PostTask(std::make_unique<CountingTask>(
+        data->run_count, data->runner, data->children));
+  }
+}
+
+// Posts |tasks_per_thread| tasks from each of |thread_count| threads at once
+// and returns when they are all done.
+static void PostFromThreads(node::WorkerThreadsTaskRunner* runner,
+                            std::atomic<int>* run_count,
+                            int thread_count,
+                            int tasks_per_thread,
+                            int children) {
+  PosterData data { runner, run_count, tasks_per_thread, children };
+  std::vector<uv_thread_t> threads(thread_count);
+  for (uv_thread_t& thread : threads)
+    CHECK_EQ(0, uv_thread_create(&thread, PostCountingTasks, &data));
+  for (uv_thread_t& thread : threads)
+    CHECK_EQ(0, uv_thread_join(&thread));
+  runner->BlockingDrain();
+}
+
+TEST_F(NodeZeroIsolateTestFixture, WorkerTasksFromManyThreadsAllRun) {
+  node::WorkerThreadsTaskRunner runner(4);
+  std::atomic<int> run_count {0};
+  PostFromThreads(&runner, &run_count, 4, 10000, 0);
+  EXPECT_EQ(40000, run_count.load());
+  runner.Shutdown();
+}
+
+TEST_F(NodeZeroIsolateTestFixture, WorkerTasksPostedByWorkersAreDrained) {
+  node::WorkerThreadsTaskRunner runner(4);
+  std::atomic<int> run_count {0};
+  // Every task posts a tree of 1 + 3 + 3 * 2 + 3 * 2 * 1 = 16 tasks, most of
+  // them from worker threads where they land on that worker's own deque.
+  PostFromThreads(&runner, &run_count, 2, 1000, 3);
+  EXPECT_EQ(2 * 1000 * 16, run_count.load());
+  // A single deep tree, which only spreads over the workers by stealing.
+  runner.PostTask(std::make_unique<CountingTask>(&run_count, &runner, 7));
+  runner.BlockingDrain();
+  EXPECT_EQ(2 * 1000 * 16 + 13700, run_count.load());
+  runner.Shutdown();
+}
+
+TEST_F(NodeZeroIsolateTestFixture, WorkerTasksWithSingleWorker) {
+  node::WorkerThreadsTaskRunner runner(1);
+  std::atomic<int> run_count {0};
+  PostFromThreads(&runner, &run_count, 3, 1000, 2);
+  EXPECT_EQ(3 * 1000 * 5, run_count.load());
+  runner.Shutdown();
+}
+
+// Throughput of tiny worker tasks posted from four threads, not run by
+// default: cctest --gtest_also_run_disabled_tests
+//                 --gtest_filter=*WorkerTaskThroughput
+TEST_F(NodeZeroIsolateTestFixture, DISABLED_WorkerTaskThroughput) {
+  constexpr int kPosters = 4;
+  constexpr int kTasksPerPoster = 1000000;
+  for (int workers : {4, 16, 64}) {
+    for (int children : {0, 2}) {
+      node::WorkerThreadsTaskRunner runner(workers);
+      std::atomic<int> run_count {0};
+      uint64_t start = uv_hrtime();
+      PostFromThreads(&runner, &run_count, kPosters, kTasksPerPoster,
+                      children);
+      double seconds = (uv_hrtime() - start) / 1e9;
+      runner.Shutdown();
+      printf("%2d workers, %d children per task: %.2f million tasks/s\n",
+             workers, children, run_count.load() / seconds / 1e6);
+    }
+  }
+}
@@ -0,0 +1,166 @@
+#include "string_search.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using node::stringsearch::Kernel;
+using node::stringsearch::Needle;
+
+namespace {
+
+std::vector<Kernel> SupportedKernels() {
+  std::vector<Kernel> kernels;
+  for (Kernel kernel : {Kernel::SCALAR, Kernel::AVX2, Kernel::NEON}) {
+    if (node::stringsearch::KernelSupported(kernel))
+      kernels.push_back(kernel);
+  }
+  return kernels;
+}
+
+// Restores the kernel picked at startup when a test is done with it.
+class StringSearchTest : public ::testing::Test {
+ protected:
+  void SetUp() override { original_ = node::stringsearch::CurrentKernel(); }
+  void TearDown() override { node::stringsearch::SetKernel(original_); }
+
+ private:
+  Kernel original_;
+};
+
+// Text over a small alphabet, so that needles taken from it occur often and
+// many positions share their first and last byte without matching.
+std::string RandomText(std::mt19937* rng, size_t length, int alphabet) {
+  std::uniform_int_distribution<int> pick(0, alphabet - 1);
+  std::string text(length, '\0');
+  for (char& c : text)
+    c = static_cast<char>('a' + pick(*rng));
+  return text;
+}
+
+// Copies without the terminating NUL of std::string, so that reading past
+// the end is caught by sanitizers.
+std::vector<uint8_t> Bytes(const std::string& text) {
+  return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+size_t Search(const std::string& haystack, const std::string& needle,
+              size_t start, bool is_forward) {
+  const std::vector<uint8_t> haystack_bytes = Bytes(haystack);
+  const std::vector<uint8_t> needle_bytes = Bytes(needle);
+  return node::SearchString(haystack_bytes.data(), haystack_bytes.size(),
+                            needle_bytes.data(), needle_bytes.size(),
+                            start, is_forward);
+}
+
+size_t Expected(const std::string& haystack, const std::string& needle,
+                size_t start, bool is_forward) {
+  const size_t pos = is_forward ? haystack.find(needle, start)
+                                : haystack.rfind(needle, start);
+  return pos == std::string::npos ? haystack.size() : pos;
+}
+
+}  // anonymous namespace
+
+TEST_F(StringSearchTest, KernelsMatchScalar) {
+  std::mt19937 rng(0x73656172);
+  for (int round = 0; round < 3000; round++) {
+    const int alphabet = 2 + round % 5;
+    std::uniform_int_distribution<size_t> size(1, round < 2000 ? 200 : 5000);
+    const std::string haystack = RandomText(&rng, size(rng), alphabet);
+    std::uniform_int_distribution<size_t> needle_size(
+        1, std::min<size_t>(haystack.size(), round % 3 ? 8 : 70));
+    std::string needle = RandomText(&rng, needle_size(rng), alphabet);
+    if (round % 4 == 0) {
+      // A needle that is known to occur.
+      std::uniform_int_distribution<size_t> at(
+          0, haystack.size() - needle.size());
+      needle = haystack.substr(at(rng), needle.size());
+    }
+    std::uniform_int_distribution<size_t> start(0, haystack.size());
+    const size_t forward_start = start(rng);
+    const size_t backward_start = start(rng);
+
+    for (Kernel kernel : SupportedKernels()) {
+      node::stringsearch::SetKernel(kernel);
+      SCOPED_TRACE(static_cast<int>(kernel));
+      SCOPED_TRACE(round);
+      if (forward_start + needle.size() <= haystack.size()) {
+        EXPECT_EQ(Expected(haystack, needle, forward_start, true),
+                  Search(haystack, needle, forward_start, true));
+      }
+      EXPECT_EQ(Expected(haystack, needle, backward_start, false),
+                Search(haystack, needle, backward_start, false));
+    }
+  }
+}
+
+TEST_F(StringSearchTest, GivesUpOnFalseCandidates) {
+  // Every position starts and ends like the needle, which only matches where
+  // it is put, at all distances from where the filter gives up.
+  const std::string needle = "ab" + std::string(30, 'a');
+  const std::string reversed(needle.rbegin(), needle.rend());
+  for (Kernel kernel : SupportedKernels()) {
+    node::stringsearch::SetKernel(kernel);
+    SCOPED_TRACE(static_cast<int>(kernel));
+    for (size_t at = 0; at < 300; at++) {
+      const std::string filler(at, 'a');
+      const std::string tail = filler + needle + std::string(300, 'a');
+      const std::string head = std::string(300, 'a') + reversed + filler;
+      EXPECT_EQ(at, Search(tail, needle, 0, true));
+      EXPECT_EQ(300u, Search(head, reversed, head.size(), false));
+    }
+    const std::string filler(100000, 'a');
+    EXPECT_EQ(filler.size(), Search(filler, needle, 0, true));
+    EXPECT_EQ(filler.size(), Search(filler, reversed, filler.size(), false));
+  }
+}
+
+TEST_F(StringSearchTest, FindsAnyNeedle) {
+  std::mt19937 rng(0x616e7921);
+  for (int round = 0; round < 2000; round++) {
+    const int alphabet = 3 + round % 4;
+    std::uniform_int_distribution<size_t> size(0, round < 1500 ? 200 : 3000);
+    const std::string haystack = RandomText(&rng, size(rng), alphabet);
+    std::uniform_int_distribution<size_t> count(1, round % 2 ? 4 : 12);
+    std::uniform_int_distribution<size_t> needle_size(1, round % 3 ? 6 : 40);
+    std::vector<std::string> values(count(rng));
+    for (std::string& value : values)
+      value = RandomText(&rng, needle_size(rng), alphabet);
+    const std::vector<uint8_t> haystack_bytes = Bytes(haystack);
+    std::vector<std::vector<uint8_t>> value_bytes;
+    std::vector<Needle> needles;
+    for (const std::string& value : values)
+      value_bytes.push_back(Bytes(value));
+    for (const std::vector<uint8_t>& bytes : value_bytes)
+      needles.push_back({bytes.data(), bytes.size()});
+    std::uniform_int_distribution<size_t> start(0, haystack.size());
+    const size_t index = start(rng);
+
+    size_t expected = haystack.size();
+    size_t expected_which = 0;
+    for (size_t j = 0; j < values.size(); j++) {
+      const size_t pos = haystack.find(values[j], index);
+      if (pos != std::string::npos && pos < expected) {
+        expected = pos;
+        expected_which = j;
+      }
+    }
+
+    for (Kernel kernel : SupportedKernels()) {
+      node::stringsearch::SetKernel(kernel);
+      SCOPED_TRACE(static_cast<int>(kernel));
+      SCOPED_TRACE(round);
+      size_t which = values.size();
+      EXPECT_EQ(expected, node::stringsearch::FindAnyBytes(
+          haystack_bytes.data(), haystack_bytes.size(),
+          needles.data(), needles.size(), index, &which));
+      if (expected < haystack.size()) {
+        EXPECT_EQ(expected_which, which);
+      }
+    }
+  }
+}
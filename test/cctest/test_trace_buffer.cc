@@ -0,0 +1,168 @@
+#include "tracing/agent.h"
+#include "tracing/node_trace_buffer.h"
+
+#include <atomic>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "uv.h"
+
+using node::tracing::Agent;
+using node::tracing::AgentWriterHandle;
+using node::tracing::AsyncTraceWriter;
+using node::tracing::InternalTraceBuffer;
+using v8::platform::tracing::TraceBufferChunk;
+using v8::platform::tracing::TraceObject;
+
+namespace {
+
+const uint8_t kCategoryEnabled = 1;
+
+class CountingTraceWriter : public AsyncTraceWriter {
+ public:
+  explicit CountingTraceWriter(std::atomic<size_t>* appended)
+      : appended_(appended) {}
+
+  void AppendTraceEvent(TraceObject* trace_event) override {
+    appended_->fetch_add(1, std::memory_order_relaxed);
+  }
+  void Flush(bool blocking) override {}
+
+ private:
+  std::atomic<size_t>* appended_;
+};
+
+void InitializeEvent(TraceObject* trace_object, uint64_t id) {
+  trace_object->Initialize('I', &kCategoryEnabled, "event", nullptr, id, 0, 0,
+                           nullptr, nullptr, nullptr, nullptr, 0, 0, 0);
+}
+
+}  // namespace
+
+TEST(InternalTraceBufferTest, FlushesEveryEventOnce) {
+  std::atomic<size_t> appended {0};
+  Agent agent;
+  AgentWriterHandle handle = agent.AddClient(
+      std::set<std::string>(),
+      std::make_unique<CountingTraceWriter>(&appended),
+      Agent::kIgnoreDefaultCategories);
+  InternalTraceBuffer buffer(4, 0, &agent);
+
+  uint64_t handles[100];
+  for (uint64_t i = 0; i < 100; i++) {
+    TraceObject* trace_object = buffer.AddTraceEvent(&handles[i]);
+    ASSERT_NE(trace_object, nullptr);
+    InitializeEvent(trace_object, i);
+    EXPECT_EQ(buffer.GetEventByHandle(handles[i]), trace_object);
+  }
+  buffer.Flush(true);
+  EXPECT_EQ(appended.load(), 100u);
+
+  // Handles from before the flush no longer find their events, even once the
+  // chunks are reused.
+  uint64_t reused;
+  InitializeEvent(buffer.AddTraceEvent(&reused), 100);
+  for (uint64_t old_handle : handles)
+    EXPECT_EQ(buffer.GetEventByHandle(old_handle), nullptr);
+  EXPECT_NE(buffer.GetEventByHandle(reused), nullptr);
+  buffer.Flush(true);
+  EXPECT_EQ(appended.load(), 101u);
+}
+
+TEST(InternalTraceBufferTest, FillsUpWithoutAFlush) {
+  std::atomic<size_t> appended {0};
+  Agent agent;
+  AgentWriterHandle handle = agent.AddClient(
+      std::set<std::string>(),
+      std::make_unique<CountingTraceWriter>(&appended),
+      Agent::kIgnoreDefaultCategories);
+  InternalTraceBuffer buffer(2, 0, &agent);
+
+  uint64_t trace_handle;
+  for (size_t i = 0; i < 2 * TraceBufferChunk::kChunkSize; i++)
+    InitializeEvent(buffer.AddTraceEvent(&trace_handle), i);
+  EXPECT_TRUE(buffer.IsFull());
+  EXPECT_EQ(buffer.AddTraceEvent(&trace_handle), nullptr);
+  EXPECT_EQ(trace_handle, 0u);
+
+  buffer.Flush(true);
+  EXPECT_FALSE(buffer.IsFull());
+  EXPECT_NE(buffer.AddTraceEvent(&trace_handle), nullptr);
+}
+
+// Threads that claim chunks while another thread flushes wait for the flush
+// rather than losing their events, and never get an event through a handle
+// that belongs to another one.
+TEST(InternalTraceBufferTest, AddsEventsWhileFlushing) {
+  constexpr int kThreads = 4;
+  constexpr int kEventsPerThread = 10000;
+  std::atomic<size_t> appended {0};
+  Agent agent;
+  AgentWriterHandle handle = agent.AddClient(
+      std::set<std::string>(),
+      std::make_unique<CountingTraceWriter>(&appended),
+      Agent::kIgnoreDefaultCategories);
+  // Big enough for every event without a flush, so none may be dropped.
+  InternalTraceBuffer buffer(
+      kThreads * (kEventsPerThread / TraceBufferChunk::kChunkSize + 2), 0,
+      &agent);
+
+  struct Recorder {
+    InternalTraceBuffer* buffer;
+    int index;
+    int dropped;
+    int mismatched;
+    uv_thread_t thread;
+  };
+  std::vector<Recorder> recorders(kThreads);
+  for (int t = 0; t < kThreads; t++) {
+    recorders[t] = { &buffer, t, 0, 0, {} };
+    ASSERT_EQ(0, uv_thread_create(&recorders[t].thread, [](void* data) {
+      Recorder* recorder = static_cast<Recorder*>(data);
+      for (int i = 0; i < kEventsPerThread; i++) {
+        uint64_t trace_handle;
+        TraceObject* trace_object =
+            recorder->buffer->AddTraceEvent(&trace_handle);
+        if (trace_object == nullptr) {
+          recorder->dropped++;
+          continue;
+        }
+        InitializeEvent(trace_object, recorder->index * kEventsPerThread + i);
+        // Flushed in between, or still this thread's event.
+        TraceObject* found = recorder->buffer->GetEventByHandle(trace_handle);
+        if (found != nullptr && found != trace_object)
+          recorder->mismatched++;
+      }
+    }, &recorders[t]));
+  }
+
+  std::atomic<int> running {kThreads};
+  uv_thread_t flusher;
+  struct Flusher {
+    InternalTraceBuffer* buffer;
+    std::atomic<int>* running;
+  } flusher_data = { &buffer, &running };
+  ASSERT_EQ(0, uv_thread_create(&flusher, [](void* data) {
+    Flusher* flusher = static_cast<Flusher*>(data);
+    while (flusher->running->load() > 0)
+      flusher->buffer->Flush(true);
+  }, &flusher_data));
+
+  for (Recorder& recorder : recorders) {
+    ASSERT_EQ(0, uv_thread_join(&recorder.thread));
+    running--;
+  }
+  ASSERT_EQ(0, uv_thread_join(&flusher));
+  buffer.Flush(true);
+
+  for (const Recorder& recorder : recorders) {
+    EXPECT_EQ(recorder.dropped, 0);
+    EXPECT_EQ(recorder.mismatched, 0);
+  }
+  EXPECT_FALSE(buffer.IsFlushing());
+  EXPECT_GT(appended.load(), 0u);
+  EXPECT_LE(appended.load(), static_cast<size_t>(kThreads * kEventsPerThread));
+}
@@ -0,0 +1,310 @@
+#include "utf8.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using node::utf8::Kernel;
+
+namespace {
+
+std::vector<Kernel> SupportedKernels() {
+  std::vector<Kernel> kernels;
+  for (Kernel kernel : {Kernel::SCALAR, Kernel::SSSE3, Kernel::NEON}) {
+    if (node::utf8::KernelSupported(kernel))
+      kernels.push_back(kernel);
+  }
+  return kernels;
+}
+
+// Restores the kernel picked at startup when a test is done with it.
+class Utf8Test : public ::testing::Test {
+ protected:
+  void SetUp() override { original_ = node::utf8::CurrentKernel(); }
+  void TearDown() override { node::utf8::SetKernel(original_); }
+
+ private:
+  Kernel original_;
+};
+
+void AppendUtf8(std::string* out, uint32_t cp) {
+  if (cp < 0x80) {
+    *out += static_cast<char>(cp);
+  } else if (cp < 0x800) {
+    *out += static_cast<char>(0xc0 | (cp >> 6));
+    *out += static_cast<char>(0x80 | (cp & 0x3f));
+  } else if (cp < 0x10000) {
+    *out += static_cast<char>(0xe0 | (cp >> 12));
+    *out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+    *out += static_cast<char>(0x80 | (cp & 0x3f));
+  } else {
+    *out += static_cast<char>(0xf0 | (cp >> 18));
+    *out += static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+    *out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+    *out += static_cast<char>(0x80 | (cp & 0x3f));
+  }
+}
+
+void AppendUtf16(std::u16string* out, uint32_t cp) {
+  if (cp < 0x10000) {
+    *out += static_cast<char16_t>(cp);
+  } else {
+    *out += static_cast<char16_t>(0xd7c0 + (cp >> 10));
+    *out += static_cast<char16_t>(0xdc00 + (cp & 0x3ff));
+  }
+}
+
+// Code points from ASCII, Latin-1, the rest of the BMP and the astral planes
+// in runs, so that the vectorized paths for each of them get exercised, and
+// runs of the code points at the edges of those ranges.
+std::vector<uint32_t> RandomCodePoints(std::mt19937* rng, size_t count) {
+  static const uint32_t ranges[][2] = {
+    {0, 0x7f}, {0x80, 0xff}, {0x100, 0x7ff}, {0x800, 0xd7ff},
+    {0xe000, 0xffff}, {0x10000, 0x10ffff}
+  };
+  static const uint32_t edges[] = {
+    0, 0x7f, 0x80, 0xff, 0x100, 0x7ff, 0x800, 0xd7ff, 0xe000, 0xffff,
+    0x10000, 0x10ffff
+  };
+  std::uniform_int_distribution<int> pick_range(0, 6);
+  std::uniform_int_distribution<size_t> pick_edge(0, 11);
+  std::uniform_int_distribution<int> run(1, 40);
+  std::vector<uint32_t> code_points;
+  while (code_points.size() < count) {
+    const int range = pick_range(*rng);
+    for (int i = run(*rng); i > 0 && code_points.size() < count; i--) {
+      if (range == 6) {
+        code_points.push_back(edges[pick_edge(*rng)]);
+      } else {
+        std::uniform_int_distribution<uint32_t> pick(ranges[range][0],
+                                                     ranges[range][1]);
+        code_points.push_back(pick(*rng));
+      }
+    }
+  }
+  return code_points;
+}
+
+struct Validation {
+  bool valid;
+  size_t utf16_length;
+  bool latin1;
+
+  bool operator==(const Validation& other) const {
+    return valid == other.valid &&
+           (!valid || (utf16_length == other.utf16_length &&
+                       latin1 == other.latin1));
+  }
+};
+
+Validation Validate(Kernel kernel, const std::string& input) {
+  node::utf8::SetKernel(kernel);
+  Validation result = {false, 0, false};
+  result.valid = node::utf8::Validate(input.data(), input.size(),
+                                      &result.utf16_length, &result.latin1);
+  return result;
+}
+
+}  // anonymous namespace
+
+TEST_F(Utf8Test, RejectsMalformedInput) {
+  const char* malformed[] = {
+    "\x80",                  // Lone continuation.
+    "\xbf",
+    "\xc2",                  // Truncated.
+    "\xc0",
+    "\xe0",
+    "\xf4",
+    "\xe2\x82",
+    "\xf0\x9f\x98",
+    "\xe0\xa0",
+    "\xf0\x90\x80",
+    "\xc0\x80",              // Overlong.
+    "\xc1\xbf",
+    "\xe0\x80\x80",
+    "\xe0\x9f\xbf",
+    "\xf0\x80\x80\x80",
+    "\xf0\x8f\xbf\xbf",
+    "\xed\xa0\x80",          // Surrogates.
+    "\xed\xbf\xbf",
+    "\xf4\x90\x80\x80",      // Past U+10FFFF.
+    "\xf5\x80\x80\x80",
+    "\xff",
+    "\xc3\xa9\xa9",          // Extra continuation.
+    "\xe2\x82\xac\x80",
+    "\xe2\x28\xa1",          // Missing continuation.
+  };
+  for (Kernel kernel : SupportedKernels()) {
+    for (const char* sequence : malformed) {
+      // At every offset within a block and across block boundaries.
+      for (size_t offset = 0; offset < 70; offset++) {
+        for (size_t padding : {0, 1, 17, 40}) {
+          const std::string input = std::string(offset, 'a') + sequence +
+                                    std::string(padding, 'b');
+          SCOPED_TRACE(static_cast<int>(kernel));
+          SCOPED_TRACE(offset);
+          EXPECT_FALSE(Validate(kernel, input).valid);
+        }
+      }
+    }
+  }
+}
+
+TEST_F(Utf8Test, DetectsLatin1) {
+  for (Kernel kernel : SupportedKernels()) {
+    for (uint32_t cp : {0xe9, 0xff, 0x100, 0x13f, 0x140, 0x20ac}) {
+      for (size_t offset = 0; offset < 40; offset++) {
+        std::string input;
+        for (size_t i = 0; i < offset; i++)
+          AppendUtf8(&input, i % 2 ? 'x' : 0xe9);
+        AppendUtf8(&input, cp);
+        input += "0123456789abcdefghij";
+        SCOPED_TRACE(static_cast<int>(kernel));
+        SCOPED_TRACE(offset);
+        const Validation validation = Validate(kernel, input);
+        ASSERT_TRUE(validation.valid);
+        EXPECT_EQ(cp < 0x100, validation.latin1);
+      }
+    }
+  }
+}
+
+TEST_F(Utf8Test, ConvertsValidInput) {
+  std::mt19937 rng(0x75746638);
+  for (int round = 0; round < 300; round++) {
+    std::uniform_int_distribution<size_t> size(0, round < 200 ? 80 : 5000);
+    std::string utf8;
+    std::u16string utf16;
+    bool latin1 = true;
+    for (uint32_t cp : RandomCodePoints(&rng, size(rng))) {
+      AppendUtf8(&utf8, cp);
+      AppendUtf16(&utf16, cp);
+      latin1 = latin1 && cp < 0x100;
+    }
+    const uint16_t* units = reinterpret_cast<const uint16_t*>(utf16.data());
+
+    for (Kernel kernel : SupportedKernels()) {
+      SCOPED_TRACE(static_cast<int>(kernel));
+      const Validation validation = Validate(kernel, utf8);
+      ASSERT_TRUE(validation.valid);
+      EXPECT_EQ(utf16.size(), validation.utf16_length);
+      EXPECT_EQ(latin1, validation.latin1);
+
+      std::vector<uint16_t> decoded(utf16.size());
+      node::utf8::ConvertToUtf16(utf8.data(), utf8.size(), decoded.data());
+      EXPECT_EQ(std::vector<uint16_t>(units, units + utf16.size()), decoded);
+
+      EXPECT_EQ(utf8.size(), node::utf8::Utf16Length(units, utf16.size()));
+      std::string encoded(utf8.size(), '\0');
+      size_t read;
+      EXPECT_EQ(utf8.size(),
+                node::utf8::FromUtf16(units, utf16.size(), &encoded[0],
+                                      encoded.size(), &read));
+      EXPECT_EQ(utf16.size(), read);
+      EXPECT_EQ(utf8, encoded);
+
+      if (latin1) {
+        std::string narrowed(utf16.begin(), utf16.end());
+        std::string converted(utf16.size(), '\0');
+        node::utf8::ConvertToLatin1(utf8.data(), utf8.size(), &converted[0]);
+        EXPECT_EQ(narrowed, converted);
+      }
+    }
+  }
+}
+
+TEST_F(Utf8Test, KernelsMatchScalar) {
+  std::mt19937 rng(0x6c617431);
+  std::uniform_int_distribution<int> byte(0, 255);
+  for (int round = 0; round < 2000; round++) {
+    // Valid text with a few bytes replaced, so that most errors are close to
+    // valid sequences.
+    std::string input;
+    for (uint32_t cp : RandomCodePoints(&rng, round % 150))
+      AppendUtf8(&input, cp);
+    std::uniform_int_distribution<int> damage(0, 3);
+    for (int i = damage(rng); i > 0 && !input.empty(); i--) {
+      std::uniform_int_distribution<size_t> at(0, input.size() - 1);
+      input[at(rng)] = static_cast<char>(byte(rng));
+    }
+    const Validation expected = Validate(Kernel::SCALAR, input);
+
+    // Latin-1 and UTF-16 with unpaired surrogates, into short buffers.
+    std::vector<uint8_t> latin1(input.begin(), input.end());
+    std::vector<uint16_t> utf16;
+    for (size_t i = 0; i + 1 < input.size(); i += 2) {
+      utf16.push_back(static_cast<uint8_t>(input[i]) << 8 |
+                      static_cast<uint8_t>(input[i + 1]));
+    }
+    std::uniform_int_distribution<size_t> capacity(0, input.size() * 2);
+    const size_t dstlen = capacity(rng);
+
+    node::utf8::SetKernel(Kernel::SCALAR);
+    const size_t ascii = node::utf8::AsciiPrefixLength(input.data(),
+                                                       input.size());
+    const size_t latin1_length =
+        node::utf8::Latin1Length(latin1.data(), latin1.size());
+    const size_t utf16_length =
+        node::utf8::Utf16Length(utf16.data(), utf16.size());
+    std::string latin1_out(dstlen, '\0');
+    size_t latin1_read;
+    latin1_out.resize(node::utf8::FromLatin1(latin1.data(), latin1.size(),
+                                             &latin1_out[0], dstlen,
+                                             &latin1_read));
+    std::string utf16_out(dstlen, '\0');
+    size_t utf16_read;
+    utf16_out.resize(node::utf8::FromUtf16(utf16.data(), utf16.size(),
+                                           &utf16_out[0], dstlen,
+                                           &utf16_read));
+
+    for (Kernel kernel : SupportedKernels()) {
+      SCOPED_TRACE(static_cast<int>(kernel));
+      SCOPED_TRACE(round);
+      EXPECT_TRUE(expected == Validate(kernel, input));
+      EXPECT_EQ(ascii,
+                node::utf8::AsciiPrefixLength(input.data(), input.size()));
+      EXPECT_EQ(latin1_length,
+                node::utf8::Latin1Length(latin1.data(), latin1.size()));
+      EXPECT_EQ(utf16_length,
+                node::utf8::Utf16Length(utf16.data(), utf16.size()));
+
+      std::string out(dstlen, '\0');
+      size_t read;
+      out.resize(node::utf8::FromLatin1(latin1.data(), latin1.size(),
+                                        &out[0], dstlen, &read));
+      EXPECT_EQ(latin1_out, out);
+      EXPECT_EQ(latin1_read, read);
+
+      out.assign(dstlen, '\0');
+      out.resize(node::utf8::FromUtf16(utf16.data(), utf16.size(),
+                                       &out[0], dstlen, &read));
+      EXPECT_EQ(utf16_out, out);
+      EXPECT_EQ(utf16_read, read);
+    }
+  }
+}
+
+TEST_F(Utf8Test, ReplacesUnpairedSurrogates) {
+  const uint16_t units[] = {'a', 0xd800, 'b', 0xdc00, 0xd83d, 0xde00, 0xdbff};
+  const size_t length = sizeof(units) / sizeof(units[0]);
+  const std::string expected =
+      "a\xef\xbf\xbd" "b\xef\xbf\xbd\xf0\x9f\x98\x80\xef\xbf\xbd";
+  for (Kernel kernel : SupportedKernels()) {
+    node::utf8::SetKernel(kernel);
+    EXPECT_EQ(expected.size(), node::utf8::Utf16Length(units, length));
+    std::string out(expected.size(), '\0');
+    size_t read;
+    EXPECT_EQ(expected.size(),
+              node::utf8::FromUtf16(units, length, &out[0], out.size(),
+                                    &read));
+    EXPECT_EQ(length, read);
+    EXPECT_EQ(expected, out);
+
+    // A surrogate pair that does not fit is not split.
+    EXPECT_EQ(8u, node::utf8::FromUtf16(units, length, &out[0], 11, &read));
+    EXPECT_EQ(4u, read);
+  }
+}
@@ -0,0 +1,515 @@
+#include "fake_chakra.h"
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>  // NOLINT(build/c++11)
+#include <utility>
+
+namespace fake_chakra {
+
+namespace {
+
+struct Value {
+  explicit Value(JsValueType type) : type(type) {}
+
+  JsValueType type;
+  double number = 0;
+  std::string string;  // also the bytes of an array buffer
+  std::map<std::string, Value*> properties;
+  std::map<std::string, std::pair<Value*, Value*>> accessors;  // get, set
+  Value* prototype = nullptr;
+  JsNativeFunction native = nullptr;
+  void* callback_state = nullptr;
+  Function function;
+  void* external = nullptr;
+  JsFinalizeCallback finalizer = nullptr;
+};
+
+struct Context {
+  Value* global;
+  void* data = nullptr;
+};
+
+// Never destroyed, so that everything the tests allocated stays reachable
+// from here when the leak checker runs after the static destructors.
+std::mutex registry_mutex;
+std::vector<Value*>& values = *new std::vector<Value*>;
+std::vector<Context*>& contexts = *new std::vector<Context*>;
+std::map<std::string, std::pair<std::string, Script>> scripts;
+
+thread_local Context* current_context = nullptr;
+thread_local Value* pending_exception = nullptr;
+
+Value* stack_trace = nullptr;
+JsDiagStepType last_step_type = JsDiagStepTypeContinue;
+
+Value* New(JsValueType type) {
+  Value* value = new Value(type);
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  values.push_back(value);
+  return value;
+}
+
+Value* AsValue(JsValueRef ref) { return static_cast<Value*>(ref); }
+
+Value* UndefinedValue() {
+  static Value* undefined = New(JsUndefined);
+  return undefined;
+}
+
+JsValueRef Invoke(Value* function, bool construct, JsValueRef* arguments,
+                  uint16_t count) {
+  if (function->type != JsFunction) {
+    fprintf(stderr, "fake_chakra: calling a value that is no function\n");
+    return UndefinedValue();
+  }
+  if (function->native != nullptr) {
+    JsValueRef result = function->native(function, construct, arguments,
+                                         count, function->callback_state);
+    return result == JS_INVALID_REFERENCE ? UndefinedValue() : result;
+  }
+  return function->function(arguments, count);
+}
+
+Value* GetProperty(Value* object, const std::string& key) {
+  for (Value* holder = object; holder != nullptr; holder = holder->prototype) {
+    auto accessor = holder->accessors.find(key);
+    if (accessor != holder->accessors.end()) {
+      if (accessor->second.first == nullptr) return UndefinedValue();
+      JsValueRef self = object;
+      return AsValue(Invoke(accessor->second.first, false, &self, 1));
+    }
+    auto property = holder->properties.find(key);
+    if (property != holder->properties.end()) return property->second;
+  }
+  return UndefinedValue();
+}
+
+void SetProperty(Value* object, const std::string& key, Value* value) {
+  for (Value* holder = object; holder != nullptr; holder = holder->prototype) {
+    auto accessor = holder->accessors.find(key);
+    if (accessor != holder->accessors.end()) {
+      if (accessor->second.second != nullptr) {
+        JsValueRef arguments[2] = { object, value };
+        Invoke(accessor->second.second, false, arguments, 2);
+      }
+      return;
+    }
+  }
+  object->properties[key] = value;
+}
+
+// JSON for the values the tests send, numbers and strings without escapes.
+JsValueRef Stringify(JsValueRef* arguments, uint16_t count) {
+  Value* value = count > 1 ? AsValue(arguments[1]) : UndefinedValue();
+  if (value->type == JsString) return String("\"" + value->string + "\"");
+  if (value->type == JsNumber) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.17g", value->number);
+    return String(text);
+  }
+  return String("null");
+}
+
+JsValueRef Parse(JsValueRef* arguments, uint16_t count) {
+  std::string text = count > 1 ? ToString(arguments[1]) : "";
+  if (text.size() >= 2 && text[0] == '"')
+    return String(text.substr(1, text.size() - 2));
+  if (text == "null") return UndefinedValue();
+  return Number(strtod(text.c_str(), nullptr));
+}
+
+}  // namespace
+
+void RegisterScript(const std::string& file, Script script) {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  // The contents only have to lead JsRun back to the script.
+  scripts[file] = std::make_pair("// " + file, std::move(script));
+}
+
+const std::string* ScriptSource(const std::string& file) {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  auto it = scripts.find(file);
+  return it == scripts.end() ? nullptr : &it->second.first;
+}
+
+JsContextRef StartContext() {
+  JsRuntimeHandle runtime;
+  JsContextRef context;
+  JsCreateRuntime(JsRuntimeAttributeNone, nullptr, &runtime);
+  JsCreateContext(runtime, &context);
+  JsSetCurrentContext(context);
+  return context;
+}
+
+void Collect(JsValueRef object) {
+  Value* value = AsValue(object);
+  JsFinalizeCallback finalizer = value->finalizer;
+  value->finalizer = nullptr;
+  if (finalizer != nullptr) finalizer(value->external);
+}
+
+JsValueRef Undefined() { return UndefinedValue(); }
+
+JsValueRef Number(double number) {
+  Value* value = New(JsNumber);
+  value->number = number;
+  return value;
+}
+
+JsValueRef String(const std::string& string) {
+  Value* value = New(JsString);
+  value->string = string;
+  return value;
+}
+
+JsValueRef NewObject() { return New(JsObject); }
+
+JsValueRef NewFunction(Function function) {
+  Value* value = New(JsFunction);
+  value->function = std::move(function);
+  return value;
+}
+
+JsValueRef NewArray(const std::vector<JsValueRef>& elements) {
+  Value* array = New(JsArray);
+  for (size_t i = 0; i < elements.size(); ++i)
+    array->properties[std::to_string(i)] = AsValue(elements[i]);
+  array->properties["length"] = AsValue(Number(elements.size()));
+  return array;
+}
+
+JsValueRef Get(JsValueRef object, const std::string& name) {
+  return GetProperty(AsValue(object), name);
+}
+
+void Set(JsValueRef object, const std::string& name, JsValueRef value) {
+  SetProperty(AsValue(object), name, AsValue(value));
+}
+
+JsValueRef Call(JsValueRef function, std::vector<JsValueRef> arguments) {
+  return Invoke(AsValue(function), false, arguments.data(),
+                static_cast<uint16_t>(arguments.size()));
+}
+
+JsValueRef Construct(JsValueRef function, std::vector<JsValueRef> arguments) {
+  return Invoke(AsValue(function), true, arguments.data(),
+                static_cast<uint16_t>(arguments.size()));
+}
+
+double ToNumber(JsValueRef value) { return AsValue(value)->number; }
+
+std::string ToString(JsValueRef value) { return AsValue(value)->string; }
+
+JsValueRef TakeException() {
+  Value* exception = pending_exception;
+  pending_exception = nullptr;
+  return exception;
+}
+
+void SetStackTrace(JsValueRef trace) { stack_trace = AsValue(trace); }
+
+JsDiagStepType LastStepType() { return last_step_type; }
+
+}  // namespace fake_chakra
+
+using fake_chakra::AsValue;
+using fake_chakra::Context;
+using fake_chakra::Value;
+
+JsErrorCode JsCreateRuntime(JsRuntimeAttributes attributes,
+                            JsThreadServiceCallback thread_service,
+                            JsRuntimeHandle* runtime) {
+  static int runtime_object;
+  *runtime = &runtime_object;
+  return JsNoError;
+}
+
+JsErrorCode JsDisableRuntimeExecution(JsRuntimeHandle runtime) {
+  return JsNoError;
+}
+
+JsErrorCode JsDisposeRuntime(JsRuntimeHandle runtime) { return JsNoError; }
+
+JsErrorCode JsCreateContext(JsRuntimeHandle runtime,
+                            JsContextRef* new_context) {
+  Context* context = new Context;
+  context->global = fake_chakra::New(JsObject);
+  Value* json = fake_chakra::New(JsObject);
+  json->properties["stringify"] =
+      AsValue(fake_chakra::NewFunction(fake_chakra::Stringify));
+  json->properties["parse"] =
+      AsValue(fake_chakra::NewFunction(fake_chakra::Parse));
+  context->global->properties["JSON"] = json;
+  std::lock_guard<std::mutex> lock(fake_chakra::registry_mutex);
+  fake_chakra::contexts.push_back(context);
+  *new_context = context;
+  return JsNoError;
+}
+
+JsErrorCode JsGetCurrentContext(JsContextRef* current_context) {
+  *current_context = fake_chakra::current_context;
+  return JsNoError;
+}
+
+JsErrorCode JsSetCurrentContext(JsContextRef context) {
+  fake_chakra::current_context = static_cast<Context*>(context);
+  return JsNoError;
+}
+
+JsErrorCode JsGetContextData(JsContextRef context, void** data) {
+  *data = static_cast<Context*>(context)->data;
+  return JsNoError;
+}
+
+JsErrorCode JsSetContextData(JsContextRef context, void* data) {
+  static_cast<Context*>(context)->data = data;
+  return JsNoError;
+}
+
+JsErrorCode JsAddRef(JsRef ref, unsigned int* count) { return JsNoError; }
+
+JsErrorCode JsRelease(JsRef ref, unsigned int* count) { return JsNoError; }
+
+JsErrorCode JsRun(JsValueRef script, JsSourceContext source_context,
+                  JsValueRef source_url, JsParseScriptAttributes attributes,
+                  JsValueRef* result) {
+  fake_chakra::Script run;
+  {
+    std::lock_guard<std::mutex> lock(fake_chakra::registry_mutex);
+    for (auto& entry : fake_chakra::scripts) {
+      if (entry.second.first == AsValue(script)->string)
+        run = entry.second.second;
+    }
+  }
+  *result = fake_chakra::UndefinedValue();
+  if (!run) return JsErrorInvalidArgument;
+  run(fake_chakra::current_context->global);
+  return JsNoError;
+}
+
+JsErrorCode JsCallFunction(JsValueRef function, JsValueRef* arguments,
+                           uint16_t argument_count, JsValueRef* result) {
+  *result = fake_chakra::Invoke(AsValue(function), false, arguments,
+                                argument_count);
+  return JsNoError;
+}
+
+JsErrorCode JsCreateFunction(JsNativeFunction native_function,
+                             void* callback_state, JsValueRef* function) {
+  Value* value = fake_chakra::New(JsFunction);
+  value->native = native_function;
+  value->callback_state = callback_state;
+  *function = value;
+  return JsNoError;
+}
+
+JsErrorCode JsGetGlobalObject(JsValueRef* global_object) {
+  *global_object = fake_chakra::current_context->global;
+  return JsNoError;
+}
+
+JsErrorCode JsGetUndefinedValue(JsValueRef* undefined_value) {
+  *undefined_value = fake_chakra::UndefinedValue();
+  return JsNoError;
+}
+
+JsErrorCode JsGetValueType(JsValueRef value, JsValueType* type) {
+  *type = AsValue(value)->type;
+  return JsNoError;
+}
+
+JsErrorCode JsCreateObject(JsValueRef* object) {
+  *object = fake_chakra::New(JsObject);
+  return JsNoError;
+}
+
+JsErrorCode JsCreateExternalObjectWithPrototype(
+    void* data, JsFinalizeCallback finalize_callback, JsValueRef prototype,
+    JsValueRef* object) {
+  Value* value = fake_chakra::New(JsObject);
+  value->external = data;
+  value->finalizer = finalize_callback;
+  value->prototype = AsValue(prototype);
+  *object = value;
+  return JsNoError;
+}
+
+JsErrorCode JsGetExternalData(JsValueRef object, void** external_data) {
+  *external_data = AsValue(object)->external;
+  return JsNoError;
+}
+
+JsErrorCode JsCreateExternalArrayBuffer(void* data, unsigned int byte_length,
+                                        JsFinalizeCallback finalize_callback,
+                                        void* callback_state,
+                                        JsValueRef* result) {
+  Value* value = fake_chakra::New(JsArrayBuffer);
+  value->string.assign(static_cast<const char*>(data), byte_length);
+  *result = value;
+  return JsNoError;
+}
+
+JsErrorCode JsCreatePropertyId(const char* name, size_t length,
+                               JsPropertyIdRef* property_id) {
+  *property_id = fake_chakra::String(std::string(name, length));
+  return JsNoError;
+}
+
+JsErrorCode JsGetProperty(JsValueRef object, JsPropertyIdRef property_id,
+                          JsValueRef* value) {
+  *value = fake_chakra::GetProperty(AsValue(object),
+                                    AsValue(property_id)->string);
+  return JsNoError;
+}
+
+JsErrorCode JsSetProperty(JsValueRef object, JsPropertyIdRef property_id,
+                          JsValueRef value, bool use_strict_rules) {
+  fake_chakra::SetProperty(AsValue(object), AsValue(property_id)->string,
+                           AsValue(value));
+  return JsNoError;
+}
+
+JsErrorCode JsGetIndexedProperty(JsValueRef object, JsValueRef index,
+                                 JsValueRef* result) {
+  int position = static_cast<int>(AsValue(index)->number);
+  *result = fake_chakra::GetProperty(AsValue(object),
+                                     std::to_string(position));
+  return JsNoError;
+}
+
+JsErrorCode JsObjectSetProperty(JsValueRef object, JsValueRef key,
+                                JsValueRef value, bool use_strict_rules) {
+  fake_chakra::SetProperty(AsValue(object), AsValue(key)->string,
+                           AsValue(value));
+  return JsNoError;
+}
+
+JsErrorCode JsObjectDefineProperty(JsValueRef object, JsValueRef key,
+                                   JsValueRef property_descriptor,
+                                   bool* result) {
+  Value* descriptor = AsValue(property_descriptor);
+  auto field = [descriptor](const char* name) -> Value* {
+    auto it = descriptor->properties.find(name);
+    return it == descriptor->properties.end() ? nullptr : it->second;
+  };
+  AsValue(object)->accessors[AsValue(key)->string] =
+      std::make_pair(field("get"), field("set"));
+  *result = true;
+  return JsNoError;
+}
+
+JsErrorCode JsCreateString(const char* content, size_t length,
+                           JsValueRef* value) {
+  *value = fake_chakra::String(std::string(content, length));
+  return JsNoError;
+}
+
+JsErrorCode JsCopyString(JsValueRef value, char* buffer, size_t buffer_size,
+                         size_t* length) {
+  const std::string& string = AsValue(value)->string;
+  if (AsValue(value)->type != JsString) {
+    *length = 0;
+    return JsErrorInvalidArgument;
+  }
+  if (buffer == nullptr) {
+    *length = string.size();
+    return JsNoError;
+  }
+  *length = std::min(buffer_size, string.size());
+  memcpy(buffer, string.data(), *length);
+  return JsNoError;
+}
+
+JsErrorCode JsIntToNumber(int int_value, JsValueRef* value) {
+  *value = fake_chakra::Number(int_value);
+  return JsNoError;
+}
+
+JsErrorCode JsNumberToInt(JsValueRef value, int* int_value) {
+  *int_value = static_cast<int>(AsValue(value)->number);
+  return JsNoError;
+}
+
+JsErrorCode JsNumberToDouble(JsValueRef value, double* double_value) {
+  *double_value = AsValue(value)->number;
+  return JsNoError;
+}
+
+JsErrorCode JsCreateError(JsValueRef message, JsValueRef* error) {
+  Value* value = fake_chakra::New(JsError);
+  value->properties["message"] = AsValue(message);
+  value->properties["stack"] = AsValue(message);
+  *error = value;
+  return JsNoError;
+}
+
+JsErrorCode JsCreateTypeError(JsValueRef message, JsValueRef* error) {
+  return JsCreateError(message, error);
+}
+
+JsErrorCode JsSetException(JsValueRef exception) {
+  fake_chakra::pending_exception = AsValue(exception);
+  return JsNoError;
+}
+
+JsErrorCode JsHasException(bool* has_exception) {
+  *has_exception = fake_chakra::pending_exception != nullptr;
+  return JsNoError;
+}
+
+JsErrorCode JsGetAndClearExceptionWithMetadata(JsValueRef* metadata) {
+  Value* value = fake_chakra::New(JsObject);
+  value->properties["exception"] = AsValue(fake_chakra::TakeException());
+  value->properties["source"] = AsValue(fake_chakra::String(""));
+  value->properties["column"] = AsValue(fake_chakra::Number(0));
+  *metadata = value;
+  return JsNoError;
+}
+
+JsErrorCode JsDiagGetStackTrace(JsValueRef* stack_trace) {
+  *stack_trace = fake_chakra::stack_trace != nullptr
+                     ? fake_chakra::stack_trace
+                     : AsValue(fake_chakra::NewArray({}));
+  return JsNoError;
+}
+
+JsErrorCode JsDiagGetStackProperties(unsigned int stack_frame_index,
+                                     JsValueRef* properties) {
+  Value* value = fake_chakra::New(JsObject);
+  value->properties["locals"] = AsValue(fake_chakra::NewArray({}));
+  *properties = value;
+  return JsNoError;
+}
+
+JsErrorCode JsDiagSetBreakpoint(unsigned int script_id,
+                                unsigned int line_number,
+                                unsigned int column_number,
+                                JsValueRef* breakpoint) {
+  *breakpoint = fake_chakra::New(JsObject);
+  return JsNoError;
+}
+
+JsErrorCode JsDiagGetBreakpoints(JsValueRef* breakpoints) {
+  *breakpoints = fake_chakra::NewArray({});
+  return JsNoError;
+}
+
+JsErrorCode JsDiagRemoveBreakpoint(unsigned int breakpoint_id) {
+  return JsNoError;
+}
+
+JsErrorCode JsDiagRequestAsyncBreak(JsRuntimeHandle runtime_handle) {
+  return JsNoError;
+}
+
+JsErrorCode JsDiagSetStepType(JsDiagStepType step_type) {
+  fake_chakra::last_step_type = step_type;
+  return JsNoError;
+}
+
+// What main.cpp provides to debug_server.cpp in the ChakraCore build.
+JsRuntimeHandle runtime = nullptr;
+
+int scriptId() { return 0; }
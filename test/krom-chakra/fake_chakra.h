@@ -0,0 +1,59 @@
+#ifndef TEST_KROM_CHAKRA_FAKE_CHAKRA_H_
+#define TEST_KROM_CHAKRA_FAKE_CHAKRA_H_
+
+#include <ChakraDebug.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// A stand-in for ChakraCore that is just enough to run worker.cpp and
+// debug_server.cpp. Scripts are C++ functions that get the global object of
+// the context they run in, functions they create are C++ lambdas. Values are
+// never collected, except that Collect() runs the finalizer of an external
+// object the way the garbage collector would.
+namespace fake_chakra {
+
+using Script = std::function<void(JsValueRef global)>;
+// arguments[0] is `this`.
+using Function =
+    std::function<JsValueRef(JsValueRef* arguments, uint16_t count)>;
+
+// Makes `file` loadable through kinc_file_reader_open. JsRun calls `script`
+// with the global object when the file's contents are run.
+void RegisterScript(const std::string& file, Script script);
+// The contents kinc_file_reader_open returns, nullptr for unknown files.
+const std::string* ScriptSource(const std::string& file);
+
+// Creates a runtime and a context for the calling thread and makes it
+// current, like the main thread of the ChakraCore build has.
+JsContextRef StartContext();
+void Collect(JsValueRef object);
+
+JsValueRef Undefined();
+JsValueRef Number(double value);
+JsValueRef String(const std::string& value);
+JsValueRef NewObject();
+JsValueRef NewFunction(Function function);
+JsValueRef NewArray(const std::vector<JsValueRef>& elements);
+
+JsValueRef Get(JsValueRef object, const std::string& name);
+void Set(JsValueRef object, const std::string& name, JsValueRef value);
+JsValueRef Call(JsValueRef function, std::vector<JsValueRef> arguments);
+JsValueRef Construct(JsValueRef function, std::vector<JsValueRef> arguments);
+
+double ToNumber(JsValueRef value);
+std::string ToString(JsValueRef value);
+
+// Returns and clears the exception pending on the calling thread, nullptr
+// when there is none.
+JsValueRef TakeException();
+
+// What JsDiagGetStackTrace returns, and the last JsDiagSetStepType.
+void SetStackTrace(JsValueRef stack_trace);
+JsDiagStepType LastStepType();
+
+}  // namespace fake_chakra
+
+#endif  // TEST_KROM_CHAKRA_FAKE_CHAKRA_H_
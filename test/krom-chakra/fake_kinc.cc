@@ -0,0 +1,145 @@
+// The kinc threads, events, file reader and log on top of the standard
+// library, with the semantics of Kinc's POSIX backend.
+
+#include <kinc/io/filereader.h>
+#include <kinc/log.h>
+#include <kinc/system.h>
+#include <kinc/threads/event.h>
+#include <kinc/threads/mutex.h>
+#include <kinc/threads/thread.h>
+
+#include <chrono>  // NOLINT(build/c++11)
+#include <condition_variable>  // NOLINT(build/c++11)
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <mutex>  // NOLINT(build/c++11)
+#include <set>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+
+#include "fake_chakra.h"
+
+namespace {
+
+struct Event {
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool signaled = false;
+  bool auto_reset;
+};
+
+Event* AsEvent(kinc_event_t* event) { return static_cast<Event*>(event->impl); }
+
+// Threads that are never joined, like the debug server's, stay reachable.
+std::mutex threads_mutex;
+std::set<std::thread*>& threads = *new std::set<std::thread*>;
+
+}  // namespace
+
+void kinc_event_init(kinc_event_t* event, bool auto_reset) {
+  Event* impl = new Event;
+  impl->auto_reset = auto_reset;
+  event->impl = impl;
+}
+
+void kinc_event_destroy(kinc_event_t* event) {
+  delete AsEvent(event);
+  event->impl = nullptr;
+}
+
+void kinc_event_signal(kinc_event_t* event) {
+  Event* impl = AsEvent(event);
+  std::lock_guard<std::mutex> lock(impl->mutex);
+  impl->signaled = true;
+  impl->condition.notify_all();
+}
+
+void kinc_event_wait(kinc_event_t* event) {
+  Event* impl = AsEvent(event);
+  std::unique_lock<std::mutex> lock(impl->mutex);
+  impl->condition.wait(lock, [impl] { return impl->signaled; });
+  if (impl->auto_reset) impl->signaled = false;
+}
+
+bool kinc_event_try_to_wait(kinc_event_t* event, double seconds) {
+  Event* impl = AsEvent(event);
+  std::unique_lock<std::mutex> lock(impl->mutex);
+  if (!impl->condition.wait_for(lock, std::chrono::duration<double>(seconds),
+                                [impl] { return impl->signaled; })) {
+    return false;
+  }
+  if (impl->auto_reset) impl->signaled = false;
+  return true;
+}
+
+void kinc_mutex_init(kinc_mutex_t* mutex) { mutex->impl = new std::mutex; }
+
+void kinc_mutex_destroy(kinc_mutex_t* mutex) {
+  delete static_cast<std::mutex*>(mutex->impl);
+  mutex->impl = nullptr;
+}
+
+void kinc_mutex_lock(kinc_mutex_t* mutex) {
+  static_cast<std::mutex*>(mutex->impl)->lock();
+}
+
+void kinc_mutex_unlock(kinc_mutex_t* mutex) {
+  static_cast<std::mutex*>(mutex->impl)->unlock();
+}
+
+void kinc_thread_init(kinc_thread_t* thread, void (*func)(void* param),
+                      void* param) {
+  std::thread* impl = new std::thread(func, param);
+  std::lock_guard<std::mutex> lock(threads_mutex);
+  threads.insert(impl);
+  thread->impl = impl;
+}
+
+void kinc_thread_wait_and_destroy(kinc_thread_t* thread) {
+  std::thread* impl = static_cast<std::thread*>(thread->impl);
+  impl->join();
+  {
+    std::lock_guard<std::mutex> lock(threads_mutex);
+    threads.erase(impl);
+  }
+  delete impl;
+  thread->impl = nullptr;
+}
+
+double kinc_time() {
+  return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void kinc_log(kinc_log_level_t level, const char* format, ...) {
+  va_list arguments;
+  va_start(arguments, format);
+  vfprintf(stderr, format, arguments);
+  va_end(arguments);
+  fputc('\n', stderr);
+}
+
+bool kinc_file_reader_open(kinc_file_reader_t* reader, const char* filepath,
+                           int type) {
+  const std::string* source = fake_chakra::ScriptSource(filepath);
+  if (source == nullptr) return false;
+  reader->data = source->data();
+  reader->size = source->size();
+  reader->offset = 0;
+  return true;
+}
+
+size_t kinc_file_reader_read(kinc_file_reader_t* reader, void* data,
+                             size_t size) {
+  size_t count = std::min(size, reader->size - reader->offset);
+  memcpy(data, reader->data + reader->offset, count);
+  reader->offset += count;
+  return count;
+}
+
+size_t kinc_file_reader_size(kinc_file_reader_t* reader) {
+  return reader->size;
+}
+
+void kinc_file_reader_close(kinc_file_reader_t* reader) {}
@@ -0,0 +1,73 @@
+#pragma once
+
+// The subset of the ChakraCore API that worker.cpp and debug_server.cpp use, with ChakraCore's signatures.
+// fake_chakra.cc implements it.
+
+#include <stddef.h>
+
+#define CHAKRA_CALLBACK
+#define JS_INVALID_REFERENCE nullptr
+#define JS_SOURCE_CONTEXT_NONE ((JsSourceContext)-1)
+
+typedef void *JsRef;
+typedef JsRef JsValueRef;
+typedef JsRef JsContextRef;
+typedef JsRef JsPropertyIdRef;
+typedef void *JsRuntimeHandle;
+typedef size_t JsSourceContext;
+
+enum JsErrorCode { JsNoError = 0, JsErrorInvalidArgument = 0x10001, JsErrorScriptException = 0x30001 };
+
+enum JsValueType { JsUndefined = 0, JsNull = 1, JsNumber = 2, JsString = 3, JsBoolean = 4, JsObject = 5, JsFunction = 6, JsError = 7, JsArray = 8, JsArrayBuffer = 10 };
+
+enum JsRuntimeAttributes { JsRuntimeAttributeNone = 0, JsRuntimeAttributeEnableIdleProcessing = 0x4 };
+
+enum JsParseScriptAttributes { JsParseScriptAttributeNone = 0 };
+
+typedef JsValueRef(CHAKRA_CALLBACK *JsNativeFunction)(JsValueRef callee, bool isConstructCall, JsValueRef *arguments, unsigned short argumentCount,
+                                                      void *callbackState);
+typedef void(CHAKRA_CALLBACK *JsFinalizeCallback)(void *data);
+typedef bool(CHAKRA_CALLBACK *JsThreadServiceCallback)(void *callback, void *callbackState);
+
+JsErrorCode JsCreateRuntime(JsRuntimeAttributes attributes, JsThreadServiceCallback threadService, JsRuntimeHandle *runtime);
+JsErrorCode JsDisableRuntimeExecution(JsRuntimeHandle runtime);
+JsErrorCode JsDisposeRuntime(JsRuntimeHandle runtime);
+JsErrorCode JsCreateContext(JsRuntimeHandle runtime, JsContextRef *newContext);
+JsErrorCode JsGetCurrentContext(JsContextRef *currentContext);
+JsErrorCode JsSetCurrentContext(JsContextRef context);
+JsErrorCode JsGetContextData(JsContextRef context, void **data);
+JsErrorCode JsSetContextData(JsContextRef context, void *data);
+JsErrorCode JsAddRef(JsRef ref, unsigned int *count);
+JsErrorCode JsRelease(JsRef ref, unsigned int *count);
+
+JsErrorCode JsRun(JsValueRef script, JsSourceContext sourceContext, JsValueRef sourceUrl, JsParseScriptAttributes parseAttributes, JsValueRef *result);
+JsErrorCode JsCallFunction(JsValueRef function, JsValueRef *arguments, unsigned short argumentCount, JsValueRef *result);
+JsErrorCode JsCreateFunction(JsNativeFunction nativeFunction, void *callbackState, JsValueRef *function);
+
+JsErrorCode JsGetGlobalObject(JsValueRef *globalObject);
+JsErrorCode JsGetUndefinedValue(JsValueRef *undefinedValue);
+JsErrorCode JsGetValueType(JsValueRef value, JsValueType *type);
+JsErrorCode JsCreateObject(JsValueRef *object);
+JsErrorCode JsCreateExternalObjectWithPrototype(void *data, JsFinalizeCallback finalizeCallback, JsValueRef prototype, JsValueRef *object);
+JsErrorCode JsGetExternalData(JsValueRef object, void **externalData);
+JsErrorCode JsCreateExternalArrayBuffer(void *data, unsigned int byteLength, JsFinalizeCallback finalizeCallback, void *callbackState,
+                                        JsValueRef *result);
+
+JsErrorCode JsCreatePropertyId(const char *name, size_t length, JsPropertyIdRef *propertyId);
+JsErrorCode JsGetProperty(JsValueRef object, JsPropertyIdRef propertyId, JsValueRef *value);
+JsErrorCode JsSetProperty(JsValueRef object, JsPropertyIdRef propertyId, JsValueRef value, bool useStrictRules);
+JsErrorCode JsGetIndexedProperty(JsValueRef object, JsValueRef index, JsValueRef *result);
+JsErrorCode JsObjectSetProperty(JsValueRef object, JsValueRef key, JsValueRef value, bool useStrictRules);
+JsErrorCode JsObjectDefineProperty(JsValueRef object, JsValueRef key, JsValueRef propertyDescriptor, bool *result);
+
+JsErrorCode JsCreateString(const char *content, size_t length, JsValueRef *value);
+JsErrorCode JsCopyString(JsValueRef value, char *buffer, size_t bufferSize, size_t *length);
+JsErrorCode JsIntToNumber(int intValue, JsValueRef *value);
+JsErrorCode JsNumberToInt(JsValueRef value, int *intValue);
+JsErrorCode JsNumberToDouble(JsValueRef value, double *doubleValue);
+
+JsErrorCode JsCreateError(JsValueRef message, JsValueRef *error);
+JsErrorCode JsCreateTypeError(JsValueRef message, JsValueRef *error);
+JsErrorCode JsSetException(JsValueRef exception);
+JsErrorCode JsHasException(bool *hasException);
+JsErrorCode JsGetAndClearExceptionWithMetadata(JsValueRef *metadata);
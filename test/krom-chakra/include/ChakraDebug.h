@@ -0,0 +1,13 @@
+#pragma once
+
+#include "ChakraCore.h"
+
+enum JsDiagStepType { JsDiagStepTypeStepIn = 0, JsDiagStepTypeStepOut = 1, JsDiagStepTypeStepOver = 2, JsDiagStepTypeStepBack = 3, JsDiagStepTypeReverseContinue = 4, JsDiagStepTypeContinue = 5 };
+
+JsErrorCode JsDiagGetStackTrace(JsValueRef *stackTrace);
+JsErrorCode JsDiagGetStackProperties(unsigned int stackFrameIndex, JsValueRef *properties);
+JsErrorCode JsDiagSetBreakpoint(unsigned int scriptId, unsigned int lineNumber, unsigned int columnNumber, JsValueRef *breakpoint);
+JsErrorCode JsDiagGetBreakpoints(JsValueRef *breakpoints);
+JsErrorCode JsDiagRemoveBreakpoint(unsigned int breakpointId);
+JsErrorCode JsDiagRequestAsyncBreak(JsRuntimeHandle runtimeHandle);
+JsErrorCode JsDiagSetStepType(JsDiagStepType stepType);
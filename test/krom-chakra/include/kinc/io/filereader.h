@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stddef.h>
+
+#define KINC_FILE_TYPE_ASSET 0
+#define KINC_FILE_TYPE_SAVE 1
+
+// Reads the scripts the tests registered with fake_chakra::RegisterScript
+typedef struct kinc_file_reader {
+	const char *data;
+	size_t size;
+	size_t offset;
+} kinc_file_reader_t;
+
+bool kinc_file_reader_open(kinc_file_reader_t *reader, const char *filepath, int type);
+size_t kinc_file_reader_read(kinc_file_reader_t *reader, void *data, size_t size);
+size_t kinc_file_reader_size(kinc_file_reader_t *reader);
+void kinc_file_reader_close(kinc_file_reader_t *reader);
@@ -0,0 +1,5 @@
+#pragma once
+
+typedef enum { KINC_LOG_LEVEL_INFO, KINC_LOG_LEVEL_WARNING, KINC_LOG_LEVEL_ERROR } kinc_log_level_t;
+
+void kinc_log(kinc_log_level_t level, const char *format, ...);
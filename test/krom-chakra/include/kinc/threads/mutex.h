@@ -0,0 +1,10 @@
+#pragma once
+
+typedef struct {
+	void *impl;
+} kinc_mutex_t;
+
+void kinc_mutex_init(kinc_mutex_t *mutex);
+void kinc_mutex_destroy(kinc_mutex_t *mutex);
+void kinc_mutex_lock(kinc_mutex_t *mutex);
+void kinc_mutex_unlock(kinc_mutex_t *mutex);
@@ -0,0 +1,8 @@
+#pragma once
+
+typedef struct {
+	void *impl;
+} kinc_thread_t;
+
+void kinc_thread_init(kinc_thread_t *thread, void (*func)(void *param), void *param);
+void kinc_thread_wait_and_destroy(kinc_thread_t *thread);
@@ -0,0 +1,324 @@
+#include "debug_server.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT(build/c++11)
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "fake_chakra.h"
+#include "gtest/gtest.h"
+#include "kinc/system.h"
+
+namespace {
+
+// The version main.cpp expects in DEBUGGER_MESSAGE_START since packets are
+// length prefixed.
+const int kDebugApi = 3;
+
+int server_port = 0;
+
+// A port that nothing listens on right now.
+int FreePort() {
+  int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  bind(sock, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+  socklen_t length = sizeof(address);
+  getsockname(sock, reinterpret_cast<sockaddr*>(&address), &length);
+  close(sock);
+  return ntohs(address.sin_port);
+}
+
+// What an IDE does: connects over loopback and exchanges length prefixed
+// packets with the server.
+class LoopbackClient {
+ public:
+  LoopbackClient() {
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(server_port);
+    // The server thread might not listen yet.
+    for (int attempt = 0; attempt < 500; ++attempt) {
+      socket_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+      if (connect(socket_, reinterpret_cast<sockaddr*>(&address),
+                  sizeof(address)) == 0) {
+        break;
+      }
+      close(socket_);
+      socket_ = -1;
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_GE(socket_, 0);
+    int no_delay = 1;
+    setsockopt(socket_, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+    // Fail instead of hanging when the server does not answer.
+    timeval timeout = { 5, 0 };
+    setsockopt(socket_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  }
+
+  ~LoopbackClient() { close(socket_); }
+
+  void SendBytes(const std::string& bytes) {
+    ASSERT_EQ(send(socket_, bytes.data(), bytes.size(), 0),
+              static_cast<ssize_t>(bytes.size()));
+  }
+
+  static std::string Packet(const std::vector<int>& data) {
+    uint32_t length = data.size() * sizeof(int);
+    std::string packet(reinterpret_cast<const char*>(&length),
+                       sizeof(length));
+    packet.append(reinterpret_cast<const char*>(data.data()), length);
+    return packet;
+  }
+
+  void Send(const std::vector<int>& data) { SendBytes(Packet(data)); }
+
+  // The payload of the next packet, empty when the connection is closed.
+  std::string Receive() {
+    uint32_t length;
+    if (!ReceiveAll(reinterpret_cast<char*>(&length), sizeof(length)))
+      return std::string();
+    std::string payload(length, '\0');
+    if (!ReceiveAll(&payload[0], length)) return std::string();
+    return payload;
+  }
+
+  // True when the server closed the connection, false when it stays quiet.
+  // Closing with unread bytes resets the connection instead of ending it.
+  bool Closed() {
+    char byte;
+    ssize_t received = recv(socket_, &byte, 1, 0);
+    return received == 0 || (received < 0 && errno == ECONNRESET);
+  }
+
+ private:
+  bool ReceiveAll(char* data, size_t size) {
+    while (size > 0) {
+      ssize_t received = recv(socket_, data, size, 0);
+      if (received <= 0) return false;
+      data += received;
+      size -= received;
+    }
+    return true;
+  }
+
+  int socket_ = -1;
+};
+
+// Reads the ints and length prefixed strings of a reply.
+class ReplyReader {
+ public:
+  explicit ReplyReader(const std::string& reply) : reply_(reply) {}
+
+  int Int() {
+    int value = 0;
+    if (offset_ + sizeof(value) <= reply_.size())
+      memcpy(&value, &reply_[offset_], sizeof(value));
+    offset_ += sizeof(value);
+    return value;
+  }
+
+  std::string String() {
+    size_t length = Int();
+    std::string text = reply_.substr(std::min(offset_, reply_.size()), length);
+    offset_ += length;
+    return text;
+  }
+
+  bool AtEnd() const { return offset_ == reply_.size(); }
+
+ private:
+  std::string reply_;
+  size_t offset_ = 0;
+};
+
+// Waits for the next packet the server queued, size 0 after `seconds`.
+Message NextMessage(double seconds = 5) {
+  double deadline = kinc_time() + seconds;
+  for (;;) {
+    Message message = receiveMessage();
+    if (message.size > 0 || kinc_time() > deadline) return message;
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+}
+
+std::vector<int> Data(const Message& message) {
+  return std::vector<int>(message.data, message.data + message.size);
+}
+
+JsValueRef Frame(int index, int line, const std::string& source) {
+  JsValueRef frame = fake_chakra::NewObject();
+  fake_chakra::Set(frame, "index", fake_chakra::Number(index));
+  fake_chakra::Set(frame, "scriptId", fake_chakra::Number(7));
+  fake_chakra::Set(frame, "line", fake_chakra::Number(line));
+  fake_chakra::Set(frame, "column", fake_chakra::Number(4));
+  fake_chakra::Set(frame, "sourceLength", fake_chakra::Number(source.size()));
+  fake_chakra::Set(frame, "sourceText", fake_chakra::String(source));
+  fake_chakra::Set(frame, "functionHandle", fake_chakra::Number(100 + index));
+  return frame;
+}
+
+class DebugServerTest : public ::testing::Test {
+ protected:
+  // The server thread runs for the rest of the process.
+  static void SetUpTestSuite() {
+    if (server_port == 0) {
+      server_port = FreePort();
+      startServer(server_port);
+    }
+  }
+
+  void SetUp() override {
+    while (receiveMessage().size > 0) {}
+  }
+};
+
+TEST_F(DebugServerTest, RoundTripLatency) {
+  fake_chakra::SetStackTrace(
+      fake_chakra::NewArray({ Frame(0, 9, "update();") }));
+
+  // The break loop of debug.cpp: sleeps in waitForMessage and answers until
+  // the IDE continues.
+  std::thread halted([] {
+    for (;;) {
+      Message message = waitForMessage();
+      if (handleDebugMessage(message, true)) break;
+    }
+  });
+
+  LoopbackClient client;
+  const int kRoundTrips = 1000;
+  std::vector<double> round_trips;
+  for (int i = 0; i < kRoundTrips; ++i) {
+    double start = kinc_time();
+    client.Send({ DEBUGGER_MESSAGE_STACKTRACE, i });
+    std::string reply = client.Receive();
+    round_trips.push_back(kinc_time() - start);
+    ReplyReader reader(reply);
+    ASSERT_EQ(reader.Int(), IDE_MESSAGE_STACKTRACE);
+    ASSERT_EQ(reader.Int(), i);
+  }
+  client.Send({ DEBUGGER_MESSAGE_CONTINUE });
+  halted.join();
+  EXPECT_EQ(fake_chakra::LastStepType(), JsDiagStepTypeContinue);
+
+  std::sort(round_trips.begin(), round_trips.end());
+  double p50 = round_trips[kRoundTrips / 2] * 1e6;
+  double p99 = round_trips[kRoundTrips * 99 / 100] * 1e6;
+  RecordProperty("p50_us", std::to_string(p50));
+  RecordProperty("p99_us", std::to_string(p99));
+  printf("stack trace round trip p50 %.0f us, p99 %.0f us\n", p50, p99);
+  // Polling every 100 ms took up to 100 ms.
+  EXPECT_LT(p99, 20000);
+}
+
+TEST_F(DebugServerTest, StackTraceRepliesSendStringsAsBytes) {
+  std::string source = "function update() { return \"\xc3\xa4\"; }";
+  fake_chakra::SetStackTrace(fake_chakra::NewArray(
+      { Frame(0, 9, source), Frame(1, 41, "") }));
+  LoopbackClient client;
+  // Replies only go out once the server thread took the connection.
+  client.Send({ DEBUGGER_MESSAGE_START, kDebugApi });
+  ASSERT_GT(NextMessage().size, 0);
+  Message message = { { DEBUGGER_MESSAGE_STACKTRACE, 12 }, 2 };
+  handleDebugMessage(message, true);
+
+  ReplyReader reader(client.Receive());
+  EXPECT_EQ(reader.Int(), IDE_MESSAGE_STACKTRACE);
+  EXPECT_EQ(reader.Int(), 12);
+  EXPECT_EQ(reader.Int(), 2);
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_EQ(reader.Int(), i);
+    EXPECT_EQ(reader.Int(), 7);
+    EXPECT_EQ(reader.Int(), i == 0 ? 10 : 42);  // lines are one based
+    EXPECT_EQ(reader.Int(), 4);
+    EXPECT_EQ(reader.Int(), i == 0 ? static_cast<int>(source.size()) : 0);
+    EXPECT_EQ(reader.Int(), 100 + i);
+    EXPECT_EQ(reader.String(), i == 0 ? source : "");
+  }
+  EXPECT_TRUE(reader.AtEnd());
+}
+
+TEST_F(DebugServerTest, StartCarriesTheDebugApiVersion) {
+  LoopbackClient client;
+  client.Send({ DEBUGGER_MESSAGE_START, kDebugApi });
+  EXPECT_EQ(Data(NextMessage()),
+            std::vector<int>({ DEBUGGER_MESSAGE_START, kDebugApi }));
+}
+
+TEST_F(DebugServerTest, PartialPacketsAreReassembled) {
+  LoopbackClient client;
+  std::string packet = LoopbackClient::Packet({ DEBUGGER_MESSAGE_BREAKPOINT,
+                                                 1234567, -1 });
+  // One byte per segment, the length prefix included.
+  for (size_t i = 0; i + 1 < packet.size(); ++i) {
+    client.SendBytes(packet.substr(i, 1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_EQ(receiveMessage().size, 0);
+  }
+  client.SendBytes(packet.substr(packet.size() - 1));
+  EXPECT_EQ(Data(NextMessage()),
+            std::vector<int>({ DEBUGGER_MESSAGE_BREAKPOINT, 1234567, -1 }));
+}
+
+TEST_F(DebugServerTest, CoalescedPacketsAreSplit) {
+  LoopbackClient client;
+  client.SendBytes(LoopbackClient::Packet({ DEBUGGER_MESSAGE_PAUSE }) +
+                   LoopbackClient::Packet({ DEBUGGER_MESSAGE_VARIABLES, 5 }));
+  EXPECT_EQ(Data(NextMessage()), std::vector<int>({ DEBUGGER_MESSAGE_PAUSE }));
+  EXPECT_EQ(Data(NextMessage()),
+            std::vector<int>({ DEBUGGER_MESSAGE_VARIABLES, 5 }));
+}
+
+TEST_F(DebugServerTest, LargestPacketIsAccepted) {
+  LoopbackClient client;
+  std::vector<int> data(RCVBUFSIZE);
+  for (int i = 0; i < RCVBUFSIZE; ++i) data[i] = i;
+  client.Send(data);
+  EXPECT_EQ(Data(NextMessage()), data);
+}
+
+TEST_F(DebugServerTest, OversizedPacketDropsTheConnection) {
+  {
+    LoopbackClient client;
+    client.Send(std::vector<int>(RCVBUFSIZE + 1, DEBUGGER_MESSAGE_PAUSE));
+    EXPECT_TRUE(client.Closed());
+  }
+  EXPECT_EQ(NextMessage(0.05).size, 0);
+
+  // The server goes on accepting the next IDE.
+  LoopbackClient client;
+  client.Send({ DEBUGGER_MESSAGE_PAUSE });
+  EXPECT_EQ(Data(NextMessage()), std::vector<int>({ DEBUGGER_MESSAGE_PAUSE }));
+}
+
+TEST_F(DebugServerTest, MisalignedPacketDropsTheConnection) {
+  {
+    LoopbackClient client;
+    uint32_t length = 6;
+    client.SendBytes(std::string(reinterpret_cast<char*>(&length),
+                                 sizeof(length)) + "abcdef");
+    EXPECT_TRUE(client.Closed());
+  }
+  EXPECT_EQ(NextMessage(0.05).size, 0);
+
+  LoopbackClient client;
+  client.Send({ DEBUGGER_MESSAGE_PAUSE });
+  EXPECT_EQ(Data(NextMessage()), std::vector<int>({ DEBUGGER_MESSAGE_PAUSE }));
+}
+
+}  // namespace
@@ -0,0 +1,266 @@
+#include "worker.h"
+
+#include <time.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT(build/c++11)
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "fake_chakra.h"
+#include "gtest/gtest.h"
+#include "kinc/system.h"
+
+using fake_chakra::Call;
+using fake_chakra::Get;
+using fake_chakra::NewFunction;
+using fake_chakra::Number;
+using fake_chakra::Set;
+using fake_chakra::String;
+using fake_chakra::Undefined;
+
+namespace {
+
+double ProcessCpuSeconds() {
+  timespec time;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+// Calls a function of the worker scope from a script running in it.
+JsValueRef CallGlobal(JsValueRef global, const char* name,
+                      std::vector<JsValueRef> arguments) {
+  arguments.insert(arguments.begin(), Undefined());
+  return Call(Get(global, name), arguments);
+}
+
+JsValueRef Callback(std::function<void()> callback) {
+  return NewFunction([callback](JsValueRef*, uint16_t) {
+    callback();
+    return Undefined();
+  });
+}
+
+// Posts `message` to the owner after `milliseconds`.
+void PostLater(JsValueRef global, const std::string& message,
+               double milliseconds) {
+  CallGlobal(global, "setTimeout",
+             { Callback([global, message] {
+                 CallGlobal(global, "postMessage", { String(message) });
+               }),
+               Number(milliseconds) });
+}
+
+// The main thread of a Krom app: a context with the Worker class bound that
+// handles the messages of its workers once per frame.
+class WorkerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    fake_chakra::StartContext();
+    bindWorkerClass();
+    JsGetGlobalObject(&global_);
+  }
+
+  void TearDown() override {
+    while (!workers_.empty()) Terminate(workers_.back());
+  }
+
+  // Starts a worker whose messages end up in received_.
+  JsValueRef Start(const std::string& file) {
+    JsValueRef worker = fake_chakra::Construct(Get(global_, "Worker"),
+                                               { Undefined(), String(file) });
+    EXPECT_EQ(fake_chakra::TakeException(), nullptr);
+    Set(worker, "onmessage",
+        NewFunction([this](JsValueRef* arguments, uint16_t count) {
+          received_.push_back(Get(arguments[1], "data"));
+          return Undefined();
+        }));
+    workers_.push_back(worker);
+    return worker;
+  }
+
+  void Post(JsValueRef worker, JsValueRef message) {
+    Call(Get(worker, "postMessage"), { worker, message });
+  }
+
+  // Terminates the worker and runs its finalizer, which joins the thread.
+  void Terminate(JsValueRef worker) {
+    Call(Get(worker, "terminate"), { worker });
+    fake_chakra::Collect(worker);
+    workers_.erase(std::remove(workers_.begin(), workers_.end(), worker),
+                   workers_.end());
+  }
+
+  // Runs frames until `count` messages arrived, gives up after `seconds`.
+  bool Receive(size_t count, double seconds = 5) {
+    double deadline = kinc_time() + seconds;
+    while (received_.size() < count && kinc_time() < deadline) {
+      handleWorkerMessages();
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    return received_.size() >= count;
+  }
+
+  std::vector<std::string> ReceivedStrings() {
+    std::vector<std::string> strings;
+    for (JsValueRef message : received_)
+      strings.push_back(fake_chakra::ToString(message));
+    return strings;
+  }
+
+  JsValueRef global_;
+  std::vector<JsValueRef> workers_;
+  std::vector<JsValueRef> received_;
+};
+
+TEST_F(WorkerTest, IdleWorkersSleep) {
+  // Half of the workers have nothing scheduled, half wait for a far timer.
+  fake_chakra::RegisterScript("idle.js", [](JsValueRef global) {
+    CallGlobal(global, "postMessage", { String("ready") });
+  });
+  fake_chakra::RegisterScript("far-timer.js", [](JsValueRef global) {
+    PostLater(global, "late", 60 * 1000);
+    CallGlobal(global, "postMessage", { String("ready") });
+  });
+  for (int i = 0; i < 8; ++i) Start(i % 2 == 0 ? "idle.js" : "far-timer.js");
+  ASSERT_TRUE(Receive(8));
+
+  double cpu = ProcessCpuSeconds();
+  std::this_thread::sleep_for(std::chrono::seconds(10));
+  cpu = ProcessCpuSeconds() - cpu;
+
+  RecordProperty("cpu_ms", std::to_string(cpu * 1000));
+  printf("8 idle workers used %.1f ms of CPU in 10 s\n", cpu * 1000);
+  // A spinning worker alone would take the whole 10 s.
+  EXPECT_LT(cpu, 0.1);
+}
+
+TEST_F(WorkerTest, MessageLatencyUnderLoad) {
+  // Replies with how long the message took to get to the worker. The worker
+  // sleeps in a timed wait for its interval when a message comes in.
+  fake_chakra::RegisterScript("latency.js", [](JsValueRef global) {
+    CallGlobal(global, "setInterval", { Callback([] {}), Number(1000) });
+    Set(global, "onmessage",
+        NewFunction([global](JsValueRef* arguments, uint16_t count) {
+          double sent = fake_chakra::ToNumber(Get(arguments[1], "data"));
+          CallGlobal(global, "postMessage", { Number(kinc_time() - sent) });
+          return Undefined();
+        }));
+  });
+  // Keeps the other workers waking up every millisecond to do some work.
+  fake_chakra::RegisterScript("load.js", [](JsValueRef global) {
+    CallGlobal(global, "setInterval", { Callback([] {
+                 double end = kinc_time() + 0.0002;
+                 while (kinc_time() < end) {}
+               }),
+               Number(1) });
+  });
+  for (int i = 0; i < 7; ++i) Start("load.js");
+  JsValueRef worker = Start("latency.js");
+
+  const int kMessages = 1000;
+  std::vector<double> latencies;
+  for (int i = 0; i < kMessages; ++i) {
+    Post(worker, Number(kinc_time()));
+    // Less than the interval, so that a missed wakeup fails right away.
+    ASSERT_TRUE(Receive(i + 1, 0.5));
+    latencies.push_back(fake_chakra::ToNumber(received_.back()));
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  double p50 = latencies[kMessages / 2] * 1e6;
+  double p99 = latencies[kMessages * 99 / 100] * 1e6;
+  RecordProperty("p50_us", std::to_string(p50));
+  RecordProperty("p99_us", std::to_string(p99));
+  printf("owner to worker latency p50 %.0f us, p99 %.0f us\n", p50, p99);
+  EXPECT_LT(p99, 20000);
+}
+
+TEST_F(WorkerTest, TimersRunInDeadlineOrder) {
+  fake_chakra::RegisterScript("timers.js", [](JsValueRef global) {
+    PostLater(global, "30", 30);
+    PostLater(global, "10", 10);
+    JsValueRef cleared = CallGlobal(
+        global, "setTimeout",
+        { Callback([global] {
+            CallGlobal(global, "postMessage", { String("cleared") });
+          }),
+          Number(20) });
+    CallGlobal(global, "clearTimeout", { cleared });
+
+    // Clears itself from inside its third call.
+    auto interval = std::make_shared<JsValueRef>();
+    auto ticks = std::make_shared<int>(0);
+    *interval = CallGlobal(
+        global, "setInterval",
+        { Callback([global, interval, ticks] {
+            CallGlobal(global, "postMessage", { String("tick") });
+            JsValueRef id = *interval;
+            if (++*ticks == 3) CallGlobal(global, "clearInterval", { id });
+          }),
+          Number(5) });
+
+    // Delays below 1 ms are clamped, but still run.
+    PostLater(global, "0", 0);
+    PostLater(global, "done", 80);
+  });
+  Start("timers.js");
+  ASSERT_TRUE(Receive(1));
+  while (ReceivedStrings().back() != "done")
+    ASSERT_TRUE(Receive(received_.size() + 1));
+
+  std::vector<std::string> messages = ReceivedStrings();
+  EXPECT_EQ(messages.front(), "0");
+  EXPECT_EQ(std::count(messages.begin(), messages.end(), "tick"), 3);
+  EXPECT_EQ(std::count(messages.begin(), messages.end(), "cleared"), 0);
+  auto ten = std::find(messages.begin(), messages.end(), "10");
+  auto thirty = std::find(messages.begin(), messages.end(), "30");
+  ASSERT_NE(ten, messages.end());
+  ASSERT_NE(thirty, messages.end());
+  EXPECT_LT(ten, thirty);
+  EXPECT_EQ(messages.size(), 7u);
+}
+
+TEST_F(WorkerTest, TerminateWakesSleepingWorkers) {
+  fake_chakra::RegisterScript("waiting.js", [](JsValueRef global) {
+    CallGlobal(global, "postMessage", { String("ready") });
+  });
+  fake_chakra::RegisterScript("timed.js", [](JsValueRef global) {
+    PostLater(global, "late", 60 * 1000);
+    CallGlobal(global, "postMessage", { String("ready") });
+  });
+  JsValueRef waiting = Start("waiting.js");
+  JsValueRef timed = Start("timed.js");
+  ASSERT_TRUE(Receive(2));
+
+  double start = kinc_time();
+  Terminate(waiting);
+  Terminate(timed);
+  EXPECT_LT(kinc_time() - start, 1.0);
+}
+
+TEST_F(WorkerTest, NestedWorkerWakesItsOwner) {
+  // The owner has nothing scheduled, only its child's message wakes it.
+  fake_chakra::RegisterScript("child.js", [](JsValueRef global) {
+    PostLater(global, "from child", 20);
+  });
+  fake_chakra::RegisterScript("owner.js", [](JsValueRef global) {
+    JsValueRef child = fake_chakra::Construct(
+        Get(global, "Worker"), { Undefined(), String("child.js") });
+    Set(child, "onmessage",
+        NewFunction([global](JsValueRef* arguments, uint16_t count) {
+          CallGlobal(global, "postMessage", { Get(arguments[1], "data") });
+          return Undefined();
+        }));
+  });
+  JsValueRef owner = Start("owner.js");
+  ASSERT_TRUE(Receive(1));
+  EXPECT_EQ(ReceivedStrings(), std::vector<std::string>{ "from child" });
+
+  // Shutting the owner down terminates and frees the child exactly once.
+  Terminate(owner);
+}
+
+}  // namespace
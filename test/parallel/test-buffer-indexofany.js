@@ -0,0 +1,61 @@
+'use strict';
+require('../common');
+const assert = require('assert');
+
+const b = Buffer.from('abcdef abcdef');
+
+assert.strictEqual(b.indexOfAny(['cd', 'f']), 2);
+assert.strictEqual(b.indexOfAny(['f', 'cd']), 2);
+assert.strictEqual(b.indexOfAny(['cd', 'f'], 3), 5);
+assert.strictEqual(b.indexOfAny(['cd', 'f'], -4), 9);
+assert.strictEqual(b.indexOfAny(['cd', 'f'], -100), 2);
+assert.strictEqual(b.indexOfAny(['cd', 'f'], 100), -1);
+assert.strictEqual(b.indexOfAny(['cd', 'f'], NaN), 2);
+assert.strictEqual(b.indexOfAny(['cd', 'f'], {}), 2);
+assert.strictEqual(b.indexOfAny(['x', 'yz']), -1);
+assert.strictEqual(b.indexOfAny([]), -1);
+assert.strictEqual(b.indexOfAny(['abcdef abcdefg']), -1);
+assert.strictEqual(b.indexOfAny(['xyz', Buffer.from(' a')]), 6);
+assert.strictEqual(b.indexOfAny([new Uint8Array([0x65, 0x66])]), 4);
+assert.strictEqual(b.indexOfAny([0x20, 0x66]), 5);
+assert.strictEqual(b.indexOfAny([0x100 + 0x20]), 6);
+assert.strictEqual(Buffer.alloc(0).indexOfAny(['a']), -1);
+
+// Empty values match like they do with indexOf().
+assert.strictEqual(b.indexOfAny(['x', '']), 0);
+assert.strictEqual(b.indexOfAny(['x', ''], 4), 4);
+assert.strictEqual(b.indexOfAny(['x', ''], 100), b.length);
+assert.strictEqual(b.indexOfAny(['abc', ''], 7), 7);
+
+// Strings are encoded with the given encoding.
+assert.strictEqual(b.indexOfAny(['6566', 'ff'], 'hex'), 4);
+assert.strictEqual(b.indexOfAny(['6566', 'ff'], 6, 'hex'), 11);
+const utf16 = Buffer.from('ΚΑΣΣΕ', 'utf16le');
+assert.strictEqual(utf16.indexOfAny(['Σ', 'Ε'], 'utf16le'), 4);
+assert.throws(() => b.indexOfAny(['a'], 'nope'), {
+  code: 'ERR_UNKNOWN_ENCODING'
+});
+
+// The needles can be many, long, and at the very end of a large buffer.
+{
+  const haystack = Buffer.alloc(100000, 'abc');
+  const needles = [];
+  for (let i = 0; i < 20; i++)
+    needles.push(`abc${'x'.repeat(i)}y`);
+  assert.strictEqual(haystack.indexOfAny(needles), -1);
+  assert.strictEqual(haystack.indexOfAny(needles.slice(0, 8)), -1);
+  haystack.write('abcxxxxy', haystack.length - 8);
+  assert.strictEqual(haystack.indexOfAny(needles), haystack.length - 8);
+  assert.strictEqual(haystack.indexOfAny(needles.slice(0, 8)),
+                     haystack.length - 8);
+}
+
+assert.throws(() => b.indexOfAny('abc'), {
+  code: 'ERR_INVALID_ARG_TYPE',
+  name: 'TypeError'
+});
+assert.throws(() => b.indexOfAny(['a', {}]), {
+  code: 'ERR_INVALID_ARG_TYPE',
+  name: 'TypeError',
+  message: /values\[1\]/
+});
@@ -0,0 +1,56 @@
+'use strict';
+// Corked writes of strings in all encodings, external strings and Buffers of
+// every size arrive in order, whether they are copied, coalesced or written
+// from where they are.
+const common = require('../common');
+const assert = require('assert');
+const net = require('net');
+
+// Strings of this size that are made from a Buffer are external.
+const externalLength = 2 * 1024 * 1024;
+const latin1 = Buffer.alloc(externalLength, 'x');
+latin1[12345] = 0xe9;
+const ascii = Buffer.alloc(externalLength, 'y');
+
+const writes = [
+  ['GET / HTTP/1.1\r\n', 'latin1'],
+  ['Host: localhost\r\n', 'ascii'],
+  ['x-ünicode: ✓\r\n', 'utf8'],
+  [Buffer.from('\r\n')],
+  ['', 'utf8'],
+  [Buffer.alloc(0)],
+  [Buffer.alloc(512, 'a')],
+  [Buffer.alloc(513, 'b')],
+  ['68656c6c6f', 'hex'],
+  ['d29ybGQ=', 'base64'],
+  ['ucs2 text', 'ucs2'],
+  [latin1.toString('latin1'), 'latin1'],
+  [ascii.toString('latin1'), 'utf8'],
+  // Not ASCII, so it has to be encoded as UTF-8 first.
+  [latin1.toString('latin1'), 'utf8'],
+  [Buffer.alloc(100 * 1024, 'c')],
+  ['z'.repeat(20000), 'utf8'],
+];
+
+const expected = Buffer.concat(writes.map(([chunk, encoding]) => {
+  return typeof chunk === 'string' ? Buffer.from(chunk, encoding) : chunk;
+}));
+
+const server = net.createServer(common.mustCall((socket) => {
+  const received = [];
+  socket.on('data', (data) => received.push(data));
+  socket.on('end', common.mustCall(() => {
+    assert.ok(Buffer.concat(received).equals(expected));
+    server.close();
+  }));
+}));
+
+server.listen(0, common.mustCall(() => {
+  const socket = net.connect(server.address().port, common.mustCall(() => {
+    socket.cork();
+    for (const [chunk, encoding] of writes)
+      socket.write(chunk, encoding);
+    socket.uncork();
+    socket.end();
+  }));
+}));
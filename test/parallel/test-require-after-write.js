@@ -0,0 +1,44 @@
+'use strict';
+// Modules that are written after their directory has been looked up are found
+// by later calls to require().
+require('../common');
+const assert = require('assert');
+const fs = require('fs');
+const path = require('path');
+const tmpdir = require('../common/tmpdir');
+
+tmpdir.refresh();
+const dir = path.join(tmpdir.path, 'modules');
+fs.mkdirSync(dir);
+for (let i = 0; i < 10; i++)
+  fs.writeFileSync(path.join(dir, `m${i}.js`), `module.exports = ${i};`);
+// Directories changed within the last seconds are not listed.
+const past = new Date(Date.now() - 60 * 1000);
+fs.utimesSync(dir, past, past);
+
+for (let i = 0; i < 10; i++)
+  assert.strictEqual(require(path.join(dir, `m${i}`)), i);
+
+const notFound = { code: 'MODULE_NOT_FOUND' };
+const created = path.join(dir, 'created');
+assert.throws(() => require(created), notFound);
+fs.writeFileSync(`${created}.js`, 'module.exports = "created";');
+assert.strictEqual(require(created), 'created');
+
+// Within the loading of a module as well.
+const generated = path.join(dir, 'generated');
+fs.writeFileSync(path.join(dir, 'generator.js'), `
+  const fs = require('fs');
+  let error;
+  try {
+    require('./generated');
+  } catch (err) {
+    error = err;
+  }
+  fs.writeFileSync(${JSON.stringify(`${generated}.js`)},
+                   'module.exports = "generated";');
+  module.exports = [error.code, require('./generated')];
+`);
+fs.utimesSync(dir, past, past);
+assert.deepStrictEqual(require(path.join(dir, 'generator')),
+                       ['MODULE_NOT_FOUND', 'generated']);
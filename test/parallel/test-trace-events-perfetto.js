@@ -0,0 +1,165 @@
+'use strict';
+// A .pftrace file pattern writes the trace as Perfetto TracePacket protos.
+// Decode them and check the framing, the interning and that complete (X)
+// events become begin/end pairs.
+const common = require('../common');
+const assert = require('assert');
+const cp = require('child_process');
+const fs = require('fs');
+const path = require('path');
+
+const CODE =
+  'for (let i = 0; i < 10; i++) require("fs").statSync(".");' +
+  'setTimeout(() => { for (let i = 0; i < 100000; i++) { "test" + i } }, 1)';
+
+const tmpdir = require('../common/tmpdir');
+tmpdir.refresh();
+const FILE_NAME = path.join(tmpdir.path, 'node_trace.1.pftrace');
+
+const kTypeSliceBegin = 1n;
+const kTypeSliceEnd = 2n;
+const kIncrementalStateCleared = 1n;
+const kNeedsIncrementalState = 2n;
+
+// Splits a message into { field, value } pairs. Varints are BigInts, length
+// delimited fields are Buffers that can be decoded in turn.
+function decode(buffer) {
+  const fields = [];
+  let offset = 0;
+  function varint() {
+    let value = 0n;
+    let shift = 0n;
+    for (;;) {
+      assert(offset < buffer.length, 'truncated varint');
+      const byte = buffer[offset++];
+      value |= BigInt(byte & 0x7f) << shift;
+      if ((byte & 0x80) === 0)
+        return value;
+      shift += 7n;
+    }
+  }
+  while (offset < buffer.length) {
+    const tag = varint();
+    const field = Number(tag >> 3n);
+    switch (Number(tag & 7n)) {
+      case 0:
+        fields.push({ field, value: varint() });
+        break;
+      case 1:
+        assert(offset + 8 <= buffer.length, 'truncated fixed64');
+        fields.push({ field, value: buffer.readDoubleLE(offset) });
+        offset += 8;
+        break;
+      case 2: {
+        const length = Number(varint());
+        assert(offset + length <= buffer.length,
+               `field ${field} runs past the end of its message`);
+        fields.push({ field, value: buffer.subarray(offset, offset + length) });
+        offset += length;
+        break;
+      }
+      default:
+        assert.fail(`unexpected wire type in tag ${tag}`);
+    }
+  }
+  return fields;
+}
+
+function get(fields, field) {
+  const found = fields.find((f) => f.field === field);
+  return found === undefined ? undefined : found.value;
+}
+
+const proc = cp.spawn(process.execPath,
+                      [ '--trace-event-categories', 'v8,node.fs.sync',
+                        '--trace-event-file-pattern',
+                        // eslint-disable-next-line no-template-curly-in-string
+                        'node_trace.${rotation}.pftrace',
+                        '-e', CODE ],
+                      { cwd: tmpdir.path });
+
+proc.once('exit', common.mustCall(() => {
+  assert(fs.existsSync(FILE_NAME));
+  // A trace is a repeated TracePacket field, number 1.
+  const packets = decode(fs.readFileSync(FILE_NAME)).map((packet) => {
+    assert.strictEqual(packet.field, 1);
+    assert(Buffer.isBuffer(packet.value));
+    return decode(packet.value);
+  });
+  assert(packets.length > 0);
+
+  // The first packet starts the sequence and sets its clock.
+  assert.strictEqual(get(packets[0], 13), kIncrementalStateCleared);
+  assert.notStrictEqual(get(packets[0], 59), undefined);
+
+  const interned = { 1: new Map(), 2: new Map() };  // categories, names
+  const events = [];
+  for (const packet of packets) {
+    const internedData = get(packet, 12);
+    if (internedData !== undefined) {
+      for (const { field, value } of decode(internedData)) {
+        if (!(field in interned)) continue;
+        const entry = decode(value);
+        const iid = get(entry, 1);
+        // Every iid is defined once per sequence.
+        assert(!interned[field].has(iid), `iid ${iid} defined twice`);
+        interned[field].set(iid, get(entry, 2).toString());
+      }
+    }
+
+    const trackEvent = get(packet, 11);
+    if (trackEvent === undefined) continue;
+    assert.strictEqual(get(packet, 13), kNeedsIncrementalState);
+    const fields = decode(trackEvent);
+    const event = {
+      ts: get(packet, 8),
+      type: get(fields, 9),
+      track: get(fields, 11),
+    };
+    // Interned ids refer to entries of this or an earlier packet.
+    const nameIid = get(fields, 10);
+    if (nameIid !== undefined) {
+      assert(interned[2].has(nameIid), `name iid ${nameIid} is not defined`);
+      event.name = interned[2].get(nameIid);
+    }
+    const categoryIid = get(fields, 3);
+    if (categoryIid !== undefined) {
+      assert(interned[1].has(categoryIid),
+             `category iid ${categoryIid} is not defined`);
+      event.category = interned[1].get(categoryIid);
+    }
+    assert.notStrictEqual(event.track, undefined);
+    events.push(event);
+  }
+
+  // V8.GCScavenger is a complete event: its begin is followed right away by
+  // the end the duration turns into, on the same track.
+  const scavenges = events.filter((event, i) => {
+    if (event.name !== 'V8.GCScavenger') return false;
+    assert.strictEqual(event.type, kTypeSliceBegin);
+    const end = events[i + 1];
+    assert.strictEqual(end.type, kTypeSliceEnd);
+    assert.strictEqual(end.track, event.track);
+    assert(end.ts >= event.ts);
+    return true;
+  });
+  assert(scavenges.length > 0);
+
+  // fs.sync.stat is written as separate begin and end events.
+  const stats = events.filter((event) => event.name === 'fs.sync.stat');
+  const begins = stats.filter((event) => event.type === kTypeSliceBegin);
+  assert(begins.length >= 10);
+  assert.strictEqual(stats.length, 2 * begins.length);
+  assert(stats.every((event) => event.category.includes('node.fs.sync')));
+
+  // Slices never end on a track they were not begun on.
+  const depths = new Map();
+  for (const event of events) {
+    if (event.type !== kTypeSliceBegin && event.type !== kTypeSliceEnd)
+      continue;
+    const depth = (depths.get(event.track) || 0) +
+                  (event.type === kTypeSliceBegin ? 1 : -1);
+    assert(depth >= 0, `unbalanced end on track ${event.track}`);
+    depths.set(event.track, depth);
+  }
+}));
@@ -0,0 +1,84 @@
+'use strict';
+// Messages that are a single ArrayBuffer or view on one are copied with the
+// whole buffer, and do not share memory with the sender or other receivers.
+const common = require('../common');
+const assert = require('assert');
+
+const { BroadcastChannel, MessageChannel } = require('worker_threads');
+
+const buffer = new ArrayBuffer(32);
+new Uint8Array(buffer).forEach((_, i, array) => array[i] = i);
+
+const messages = [
+  buffer,
+  new Uint8Array(buffer),
+  new Uint8Array(buffer, 3, 5),
+  new Uint8ClampedArray(buffer, 1),
+  new Int16Array(buffer, 2, 4),
+  new Float64Array(buffer, 8, 2),
+  new BigUint64Array(buffer, 16),
+  new DataView(buffer, 5, 7),
+  Buffer.from('small strings are allocated from the pool'),
+  new Uint8Array(10),
+];
+
+function check(received, sent) {
+  assert.strictEqual(received.constructor.name,
+                     sent instanceof Buffer ? 'Uint8Array' :
+                       sent.constructor.name);
+  const sentBuffer = sent instanceof ArrayBuffer ? sent : sent.buffer;
+  const receivedBuffer =
+    received instanceof ArrayBuffer ? received : received.buffer;
+  assert.notStrictEqual(receivedBuffer, sentBuffer);
+  assert.deepStrictEqual(new Uint8Array(receivedBuffer),
+                         new Uint8Array(sentBuffer));
+  if (!(sent instanceof ArrayBuffer)) {
+    assert.strictEqual(received.byteOffset, sent.byteOffset);
+    assert.strictEqual(received.byteLength, sent.byteLength);
+  }
+}
+
+{
+  const { port1, port2 } = new MessageChannel();
+  let i = 0;
+  port2.on('message', common.mustCall((received) => {
+    check(received, messages[i]);
+    // Later messages are compared to the sender's buffer again.
+    new Uint8Array(
+      received instanceof ArrayBuffer ? received : received.buffer).fill(0);
+    if (++i === messages.length) port2.close();
+  }, messages.length));
+  for (const message of messages)
+    port1.postMessage(message);
+}
+
+{
+  const channels = [0, 1, 2].map(() => new BroadcastChannel('clone'));
+  const message = new Uint16Array(buffer, 4, 6);
+  const received = [];
+  for (const channel of channels.slice(1)) {
+    channel.onmessage = common.mustCall(({ data }) => {
+      check(data, message);
+      data[0] = 0xffff;
+      received.push(data);
+      channel.close();
+      if (received.length === 2) {
+        assert.notStrictEqual(received[0].buffer, received[1].buffer);
+        channels[0].close();
+      }
+    });
+  }
+  channels[0].postMessage(message);
+}
+
+{
+  // Detached buffers still fail to be cloned.
+  const { port1, port2 } = new MessageChannel();
+  const detached = new ArrayBuffer(8);
+  port1.postMessage(0, [detached]);
+  assert.throws(() => port1.postMessage(detached), {
+    name: 'DataCloneError',
+  });
+  port1.close();
+  port2.close();
+}
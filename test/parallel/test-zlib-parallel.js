@@ -0,0 +1,100 @@
+'use strict';
+// Inputs that are compressed on several threads can be decompressed by the
+// standard inflate() into what went in.
+const common = require('../common');
+const assert = require('assert');
+const zlib = require('zlib');
+
+const blockSize = 128 * 1024;
+
+// Text with some noise, so that blocks refer back into the previous one.
+function makeInput(length) {
+  const input = Buffer.alloc(length);
+  let seed = 1;
+  for (let i = 0; i < length; i++) {
+    seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+    input[i] = seed % 13 === 0 ? seed >> 16 : 'node.js zlib '.charCodeAt(i % 13);
+  }
+  return input;
+}
+
+const methods = [
+  ['deflate', 'inflateSync'],
+  ['gzip', 'gunzipSync'],
+  ['deflateRaw', 'inflateRawSync'],
+];
+const lengths = [0, 1, blockSize, blockSize + 1, 5 * blockSize + 1000];
+
+for (const [method, inflate] of methods) {
+  for (const length of lengths) {
+    const input = makeInput(length);
+    for (const threads of [1, 2, 3, 8]) {
+      for (const options of [{}, { level: 1 }, { level: 9, windowBits: 9 },
+                             { strategy: zlib.constants.Z_HUFFMAN_ONLY },
+                             { level: 0 }]) {
+        const opts = { ...options, threads };
+        const output = zlib[`${method}Sync`](input, opts);
+        assert.ok(zlib[inflate](output).equals(input),
+                  `${method} of ${length} bytes with ${JSON.stringify(opts)}`);
+      }
+
+      zlib[method](input, { threads }, common.mustSucceed((output) => {
+        assert.ok(zlib[inflate](output).equals(input));
+      }));
+    }
+  }
+}
+
+{
+  // The headers and the checksums in the trailers are the same as those of a
+  // single thread.
+  const input = makeInput(3 * blockSize + 7);
+  const parallel = zlib.gzipSync(input, { threads: 4 });
+  const serial = zlib.gzipSync(input);
+  assert.ok(parallel.subarray(0, 10).equals(serial.subarray(0, 10)));
+  assert.ok(parallel.subarray(-8).equals(serial.subarray(-8)));
+  assert.ok(zlib.deflateSync(input, { threads: 4 }).subarray(-4)
+    .equals(zlib.deflateSync(input).subarray(-4)));
+
+  // Strings, other views and ArrayBuffers are accepted.
+  const string = input.toString('latin1');
+  assert.ok(zlib.gunzipSync(zlib.gzipSync(string, { threads: 2 }))
+    .equals(Buffer.from(string)));
+  const view = new DataView(input.buffer, input.byteOffset, input.length);
+  assert.ok(zlib.gunzipSync(zlib.gzipSync(view, { threads: 2 })).equals(input));
+  const arrayBuffer = input.buffer.slice(input.byteOffset,
+                                         input.byteOffset + input.length);
+  zlib.gzip(arrayBuffer, { threads: 2 }, common.mustSucceed((output) => {
+    assert.ok(zlib.gunzipSync(output).equals(input));
+  }));
+  zlib.gzip(string, { threads: 2 }, common.mustSucceed((output) => {
+    assert.ok(zlib.gunzipSync(output).equals(Buffer.from(string)));
+  }));
+
+  // The `info` option returns the engine as well.
+  const { buffer, engine } = zlib.deflateSync(input, { threads: 2, info: true });
+  assert.ok(zlib.inflateSync(buffer).equals(input));
+  assert.ok(engine instanceof zlib.Deflate);
+
+  // A dictionary is used by a single thread.
+  const dictionary = input.subarray(0, 1024);
+  assert.ok(zlib.inflateSync(zlib.deflateSync(input, { threads: 2, dictionary }),
+                             { dictionary }).equals(input));
+
+  // Output that is larger than maxOutputLength is an error.
+  const maxOutputLength = 64;
+  assert.throws(() => {
+    zlib.gzipSync(input, { threads: 2, maxOutputLength });
+  }, { code: 'ERR_BUFFER_TOO_LARGE' });
+  zlib.gzip(input, { threads: 2, maxOutputLength }, common.expectsError({
+    code: 'ERR_BUFFER_TOO_LARGE',
+    message: 'Cannot create a Buffer larger than 64 bytes'
+  }));
+}
+
+for (const threads of [0, -1, 1.5, 1025, '2', null]) {
+  assert.throws(() => zlib.gzipSync('x', { threads }), {
+    code: typeof threads === 'number' ? 'ERR_OUT_OF_RANGE' :
+      'ERR_INVALID_ARG_TYPE',
+  });
+}